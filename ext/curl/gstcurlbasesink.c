@@ -36,6 +36,16 @@
  *     use-content-length=false
  * ]|
  * </refsect2>
+ *
+ * By default every rendered buffer is uploaded before render returns. When
+ * #GstCurlBaseSink:max-size-bytes is set, rendered buffers are put in an
+ * upload queue of up to that size and uploaded by a separate transfer
+ * thread, so encoding and uploading can overlap. The streaming thread only
+ * blocks when the queue is full, and upload errors are returned by a later
+ * render. The queue is not used by the HTTP sink with use-content-length.
+ * The #GstCurlBaseSink:upload-rate, #GstCurlBaseSink:current-level-bytes
+ * and #GstCurlBaseSink:stall-time properties can be used to monitor the
+ * upload.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -70,6 +80,7 @@
 #define DEFAULT_URL                    "localhost:5555"
 #define DEFAULT_TIMEOUT                30
 #define DEFAULT_QOS_DSCP               0
+#define DEFAULT_MAX_SIZE_BYTES         0
 
 #define DSCP_MIN                       0
 #define DSCP_MAX                       63
@@ -91,9 +102,20 @@ enum
   PROP_USER_PASSWD,
   PROP_FILE_NAME,
   PROP_TIMEOUT,
-  PROP_QOS_DSCP
+  PROP_QOS_DSCP,
+  PROP_MAX_SIZE_BYTES,
+  PROP_CURRENT_LEVEL_BYTES,
+  PROP_UPLOAD_RATE,
+  PROP_STALL_TIME
 };
 
+/* an entry of the upload queue, either a buffer or a new file name */
+typedef struct
+{
+  GstBuffer *buffer;
+  gchar *file_name;
+} QueueItem;
+
 /* Object class function declarations */
 static void gst_curl_base_sink_finalize (GObject * gobject);
 static void gst_curl_base_sink_set_property (GObject * object, guint prop_id,
@@ -139,6 +161,9 @@ static void gst_curl_base_sink_wait_for_transfer_thread_to_send_unlocked
 static void gst_curl_base_sink_data_sent_notify (GstCurlBaseSink * sink);
 static void gst_curl_base_sink_wait_for_response (GstCurlBaseSink * sink);
 static void gst_curl_base_sink_got_response_notify (GstCurlBaseSink * sink);
+static gboolean gst_curl_base_sink_queue_pop_unlocked (GstCurlBaseSink * sink);
+static void gst_curl_base_sink_queue_clear_unlocked (GstCurlBaseSink * sink);
+static void gst_curl_base_sink_wait_for_queue_drain (GstCurlBaseSink * sink);
 
 static void handle_transfer (GstCurlBaseSink * sink);
 static size_t transfer_data_buffer (void *curl_ptr, TransferBuffer * buf,
@@ -150,7 +175,7 @@ G_DEFINE_TYPE (GstCurlBaseSink, gst_curl_base_sink, GST_TYPE_BASE_SINK);
 static gboolean
 gst_curl_base_sink_default_has_buffered_data_unlocked (GstCurlBaseSink * sink)
 {
-  return sink->transfer_buf->len > 0;
+  return sink->transfer_buf->len > 0 || !g_queue_is_empty (sink->queue);
 }
 
 static gboolean
@@ -230,6 +255,24 @@ gst_curl_base_sink_class_init (GstCurlBaseSinkClass * klass)
           "Quality of Service, differentiated services code point (0 default)",
           DSCP_MIN, DSCP_MAX, DEFAULT_QOS_DSCP,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes", "Max. size (bytes)",
+          "Max. amount of data queued for upload (0 = upload every buffer "
+          "before returning from render)",
+          0, G_MAXUINT, DEFAULT_MAX_SIZE_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_CURRENT_LEVEL_BYTES,
+      g_param_spec_uint ("current-level-bytes", "Current level (bytes)",
+          "Current amount of data queued for upload",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_UPLOAD_RATE,
+      g_param_spec_uint64 ("upload-rate", "Upload rate",
+          "Average upload rate while data was available (bytes per second)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_STALL_TIME,
+      g_param_spec_uint64 ("stall-time", "Stall time",
+          "Total time the streaming thread waited for the upload (in ns)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&sinktemplate));
@@ -251,6 +294,9 @@ gst_curl_base_sink_init (GstCurlBaseSink * sink)
   sink->new_file = TRUE;
   sink->flow_ret = GST_FLOW_OK;
   sink->is_live = FALSE;
+  sink->queue_supported = TRUE;
+  sink->queue = g_queue_new ();
+  sink->max_size_bytes = DEFAULT_MAX_SIZE_BYTES;
 }
 
 static void
@@ -264,6 +310,8 @@ gst_curl_base_sink_finalize (GObject * gobject)
   }
 
   gst_curl_base_sink_transfer_cleanup (this);
+  gst_curl_base_sink_queue_clear_unlocked (this);
+  g_queue_free (this->queue);
   g_cond_clear (&this->transfer_cond->cond);
   g_free (this->transfer_cond);
   g_free (this->transfer_buf);
@@ -287,7 +335,7 @@ gst_curl_base_sink_transfer_thread_notify_unlocked (GstCurlBaseSink * sink)
   sink->transfer_cond->data_available = TRUE;
   sink->transfer_cond->data_sent = FALSE;
   sink->transfer_cond->wait_for_response = TRUE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  g_cond_broadcast (&sink->transfer_cond->cond);
 }
 
 void
@@ -296,7 +344,7 @@ gst_curl_base_sink_transfer_thread_close (GstCurlBaseSink * sink)
   GST_OBJECT_LOCK (sink);
   GST_LOG_OBJECT (sink, "setting transfer thread close flag");
   sink->transfer_thread_close = TRUE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  g_cond_broadcast (&sink->transfer_cond->cond);
   GST_OBJECT_UNLOCK (sink);
 
   if (sink->transfer_thread != NULL) {
@@ -335,38 +383,72 @@ gst_curl_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
   GstCurlBaseSink *sink = GST_CURL_BASE_SINK (bsink);
   GstMapInfo map;
-  guint8 *data;
-  size_t size;
+  gsize size;
+  gint64 start;
   GstFlowReturn ret;
 
   GST_LOG ("enter render");
 
   sink = GST_CURL_BASE_SINK (bsink);
-  gst_buffer_map (buf, &map, GST_MAP_READ);
-  data = map.data;
-  size = map.size;
+  size = gst_buffer_get_size (buf);
 
   GST_OBJECT_LOCK (sink);
 
   /* check if the transfer thread has encountered problems while the
    * pipeline thread was working elsewhere */
   if (sink->flow_ret != GST_FLOW_OK) {
+    ret = sink->flow_ret;
     goto done;
   }
 
-  g_assert (sink->transfer_cond->data_available == FALSE);
-
   /* if there is no transfer thread created, lets create one */
   if (sink->transfer_thread == NULL) {
     if (!gst_curl_base_sink_transfer_start_unlocked (sink)) {
-      sink->flow_ret = GST_FLOW_ERROR;
+      sink->flow_ret = ret = GST_FLOW_ERROR;
       goto done;
     }
   }
 
+  start = g_get_monotonic_time ();
+
+  if (sink->queue_supported && sink->max_size_bytes > 0) {
+    QueueItem *item;
+
+    /* wait for room in the queue, a buffer bigger than the queue is queued
+     * on its own */
+    while (sink->cur_level_bytes > 0 &&
+        sink->cur_level_bytes + size > sink->max_size_bytes &&
+        sink->flow_ret == GST_FLOW_OK && !sink->flushing) {
+      GST_LOG_OBJECT (sink, "queue full, waiting");
+      g_cond_wait (&sink->transfer_cond->cond, GST_OBJECT_GET_LOCK (sink));
+    }
+    sink->stall_time += (g_get_monotonic_time () - start) * GST_USECOND;
+
+    if (sink->flushing) {
+      ret = GST_FLOW_FLUSHING;
+      goto done;
+    }
+    if (sink->flow_ret != GST_FLOW_OK) {
+      ret = sink->flow_ret;
+      goto done;
+    }
+
+    item = g_slice_new0 (QueueItem);
+    item->buffer = gst_buffer_ref (buf);
+    g_queue_push_tail (sink->queue, item);
+    sink->cur_level_bytes += size;
+    g_cond_broadcast (&sink->transfer_cond->cond);
+
+    ret = GST_FLOW_OK;
+    goto done;
+  }
+
+  g_assert (sink->transfer_cond->data_available == FALSE);
+
   /* make data available for the transfer thread and notify */
-  sink->transfer_buf->ptr = data;
-  sink->transfer_buf->len = size;
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  sink->transfer_buf->ptr = map.data;
+  sink->transfer_buf->len = map.size;
   sink->transfer_buf->offset = 0;
   gst_curl_base_sink_transfer_thread_notify_unlocked (sink);
 
@@ -374,14 +456,20 @@ gst_curl_base_sink_render (GstBaseSink * bsink, GstBuffer * buf)
    * either when transfer is completed by the curl read callback or by
    * the thread function if an error has occured. */
   gst_curl_base_sink_wait_for_transfer_thread_to_send_unlocked (sink);
-
-done:
+  sink->stall_time += (g_get_monotonic_time () - start) * GST_USECOND;
   ret = sink->flow_ret;
   GST_OBJECT_UNLOCK (sink);
   gst_buffer_unmap (buf, &map);
 
   GST_LOG ("exit render");
 
+  return ret;
+
+done:
+  GST_OBJECT_UNLOCK (sink);
+
+  GST_LOG ("exit render");
+
   return ret;
 }
 
@@ -394,6 +482,7 @@ gst_curl_base_sink_event (GstBaseSink * bsink, GstEvent * event)
   switch (event->type) {
     case GST_EVENT_EOS:
       GST_DEBUG_OBJECT (sink, "received EOS");
+      gst_curl_base_sink_wait_for_queue_drain (sink);
       gst_curl_base_sink_transfer_thread_close (sink);
       gst_curl_base_sink_wait_for_response (sink);
       break;
@@ -425,6 +514,15 @@ gst_curl_base_sink_start (GstBaseSink * bsink)
   sink->transfer_thread_close = FALSE;
   sink->new_file = TRUE;
   sink->flow_ret = GST_FLOW_OK;
+  sink->flushing = FALSE;
+
+  /* reset statistics */
+  GST_OBJECT_LOCK (sink);
+  sink->bytes_sent = 0;
+  sink->transfer_time = 0;
+  sink->idle_time = 0;
+  sink->stall_time = 0;
+  GST_OBJECT_UNLOCK (sink);
 
   if ((sink->fdset = gst_poll_new (TRUE)) == NULL) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_READ_WRITE,
@@ -446,6 +544,11 @@ gst_curl_base_sink_stop (GstBaseSink * bsink)
     sink->fdset = NULL;
   }
 
+  /* drop whatever could not be uploaded */
+  GST_OBJECT_LOCK (sink);
+  gst_curl_base_sink_queue_clear_unlocked (sink);
+  GST_OBJECT_UNLOCK (sink);
+
   return TRUE;
 }
 
@@ -459,6 +562,12 @@ gst_curl_base_sink_unlock (GstBaseSink * bsink)
   GST_LOG_OBJECT (sink, "Flushing");
   gst_poll_set_flushing (sink->fdset, TRUE);
 
+  /* wake up render if it waits for room in the queue */
+  GST_OBJECT_LOCK (sink);
+  sink->flushing = TRUE;
+  g_cond_broadcast (&sink->transfer_cond->cond);
+  GST_OBJECT_UNLOCK (sink);
+
   return TRUE;
 }
 
@@ -472,6 +581,10 @@ gst_curl_base_sink_unlock_stop (GstBaseSink * bsink)
   GST_LOG_OBJECT (sink, "No longer flushing");
   gst_poll_set_flushing (sink->fdset, FALSE);
 
+  GST_OBJECT_LOCK (sink);
+  sink->flushing = FALSE;
+  GST_OBJECT_UNLOCK (sink);
+
   return TRUE;
 }
 
@@ -519,6 +632,11 @@ gst_curl_base_sink_set_property (GObject * object, guint prop_id,
         gst_curl_base_sink_setup_dscp_unlocked (sink);
         GST_DEBUG_OBJECT (sink, "dscp set to %d", sink->qos_dscp);
         break;
+      case PROP_MAX_SIZE_BYTES:
+        sink->max_size_bytes = g_value_get_uint (value);
+        GST_DEBUG_OBJECT (sink, "max_size_bytes set to %u",
+            sink->max_size_bytes);
+        break;
       default:
         GST_DEBUG_OBJECT (sink, "invalid property id %d", prop_id);
         break;
@@ -534,6 +652,18 @@ gst_curl_base_sink_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_FILE_NAME:
+      if (sink->queue_supported && sink->max_size_bytes > 0) {
+        QueueItem *item;
+
+        /* the buffers already queued still belong to the current file, the
+         * transfer thread switches file when it gets to this item */
+        item = g_slice_new0 (QueueItem);
+        item->file_name = g_value_dup_string (value);
+        g_queue_push_tail (sink->queue, item);
+        GST_DEBUG_OBJECT (sink, "file_name %s queued", item->file_name);
+        g_cond_broadcast (&sink->transfer_cond->cond);
+        break;
+      }
       g_free (sink->file_name);
       sink->file_name = g_value_dup_string (value);
       GST_DEBUG_OBJECT (sink, "file_name set to %s", sink->file_name);
@@ -576,14 +706,56 @@ gst_curl_base_sink_get_property (GObject * object, guint prop_id,
       g_value_set_string (value, sink->passwd);
       break;
     case PROP_FILE_NAME:
-      g_value_set_string (value, sink->file_name);
+    {
+      GList *l;
+      const gchar *file_name;
+
+      /* a file name set while playing is queued behind the data of the
+       * current file, report the latest one */
+      GST_OBJECT_LOCK (sink);
+      file_name = sink->file_name;
+      for (l = g_queue_peek_tail_link (sink->queue); l; l = l->prev) {
+        QueueItem *item = l->data;
+
+        if (item->file_name) {
+          file_name = item->file_name;
+          break;
+        }
+      }
+      g_value_set_string (value, file_name);
+      GST_OBJECT_UNLOCK (sink);
       break;
+    }
     case PROP_TIMEOUT:
       g_value_set_int (value, sink->timeout);
       break;
     case PROP_QOS_DSCP:
       g_value_set_int (value, sink->qos_dscp);
       break;
+    case PROP_MAX_SIZE_BYTES:
+      g_value_set_uint (value, sink->max_size_bytes);
+      break;
+    case PROP_CURRENT_LEVEL_BYTES:
+      GST_OBJECT_LOCK (sink);
+      g_value_set_uint (value, sink->cur_level_bytes);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+    case PROP_UPLOAD_RATE:
+    {
+      gint64 active;
+
+      GST_OBJECT_LOCK (sink);
+      active = sink->transfer_time - sink->idle_time;
+      g_value_set_uint64 (value, active > 0 ?
+          gst_util_uint64_scale (sink->bytes_sent, G_USEC_PER_SEC, active) : 0);
+      GST_OBJECT_UNLOCK (sink);
+      break;
+    }
+    case PROP_STALL_TIME:
+      GST_OBJECT_LOCK (sink);
+      g_value_set_uint64 (value, sink->stall_time);
+      GST_OBJECT_UNLOCK (sink);
+      break;
     default:
       GST_DEBUG_OBJECT (sink, "invalid property id");
       break;
@@ -695,8 +867,10 @@ gst_curl_base_sink_transfer_read_cb (void *curl_ptr, size_t size, size_t nmemb,
   GstCurlBaseSink *sink;
   GstCurlBaseSinkClass *klass;
   size_t max_bytes_to_send;
-  size_t bytes_to_send;
-  guint last_chunk = 0;
+  size_t bytes_to_send = 0;
+  guint last_chunk;
+  gint64 start;
+  gboolean data_available;
 
   sink = (GstCurlBaseSink *) stream;
   klass = GST_CURL_BASE_SINK_GET_CLASS (sink);
@@ -706,7 +880,10 @@ gst_curl_base_sink_transfer_read_cb (void *curl_ptr, size_t size, size_t nmemb,
   /* wait for data to come available, if new file or thread close is set
    * then zero will be returned to indicate end of current transfer */
   GST_OBJECT_LOCK (sink);
-  if (gst_curl_base_sink_wait_for_data_unlocked (sink) == FALSE) {
+  start = g_get_monotonic_time ();
+  data_available = gst_curl_base_sink_wait_for_data_unlocked (sink);
+  sink->idle_time += g_get_monotonic_time () - start;
+  if (data_available == FALSE) {
 
     if (gst_curl_base_sink_has_buffered_data_unlocked (sink) &&
         sink->transfer_thread_close) {
@@ -732,15 +909,27 @@ gst_curl_base_sink_transfer_read_cb (void *curl_ptr, size_t size, size_t nmemb,
     return 0;
   }
 
-  GST_OBJECT_UNLOCK (sink);
+  /* fill as much of the curl buffer as the queued buffers allow, without
+   * waiting for more data or going past a file change */
+  do {
+    GST_OBJECT_UNLOCK (sink);
 
-  bytes_to_send = klass->transfer_data_buffer (sink, curl_ptr,
-      max_bytes_to_send, &last_chunk);
+    last_chunk = 0;
+    bytes_to_send += klass->transfer_data_buffer (sink,
+        (guint8 *) curl_ptr + bytes_to_send, max_bytes_to_send - bytes_to_send,
+        &last_chunk);
 
-  /* the last data chunk */
-  if (last_chunk) {
-    gst_curl_base_sink_data_sent_notify (sink);
-  }
+    /* the last data chunk */
+    if (last_chunk) {
+      gst_curl_base_sink_data_sent_notify (sink);
+    }
+
+    GST_OBJECT_LOCK (sink);
+  } while (last_chunk && bytes_to_send < max_bytes_to_send &&
+      gst_curl_base_sink_queue_pop_unlocked (sink));
+
+  sink->bytes_sent += bytes_to_send;
+  GST_OBJECT_UNLOCK (sink);
 
   return bytes_to_send;
 }
@@ -962,6 +1151,7 @@ gst_curl_base_sink_transfer_thread_func (gpointer data)
   GstCurlBaseSinkClass *klass = GST_CURL_BASE_SINK_GET_CLASS (sink);
   GstFlowReturn ret;
   gboolean data_available;
+  gint64 start;
 
   GST_LOG ("transfer thread started");
   GST_OBJECT_LOCK (sink);
@@ -1010,7 +1200,11 @@ gst_curl_base_sink_transfer_thread_func (gpointer data)
       }
 
       /* Start driving the transfer. */
+      start = g_get_monotonic_time ();
       klass->handle_transfer (sink);
+      GST_OBJECT_LOCK (sink);
+      sink->transfer_time += g_get_monotonic_time () - start;
+      GST_OBJECT_UNLOCK (sink);
 
       /* easy handle will be possibly re-used for next transfer, thus it needs to
        * be removed from the multi stack and re-added again */
@@ -1101,8 +1295,11 @@ gst_curl_base_sink_wait_for_data_unlocked (GstCurlBaseSink * sink)
   gboolean data_available = FALSE;
 
   GST_LOG ("waiting for data");
-  while (!sink->transfer_cond->data_available &&
-      !sink->transfer_thread_close && !sink->new_file) {
+  for (;;) {
+    gst_curl_base_sink_queue_pop_unlocked (sink);
+    if (sink->transfer_cond->data_available || sink->transfer_thread_close ||
+        sink->new_file)
+      break;
     g_cond_wait (&sink->transfer_cond->cond, GST_OBJECT_GET_LOCK (sink));
   }
 
@@ -1123,7 +1320,7 @@ gst_curl_base_sink_new_file_notify_unlocked (GstCurlBaseSink * sink)
 {
   GST_LOG ("new file name");
   sink->new_file = TRUE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  g_cond_broadcast (&sink->transfer_cond->cond);
 }
 
 static void
@@ -1147,12 +1344,97 @@ gst_curl_base_sink_data_sent_notify (GstCurlBaseSink * sink)
 {
   GST_LOG ("transfer completed");
   GST_OBJECT_LOCK (sink);
+  if (sink->transfer_buffer) {
+    gst_buffer_unmap (sink->transfer_buffer, &sink->transfer_map);
+    gst_buffer_unref (sink->transfer_buffer);
+    sink->transfer_buffer = NULL;
+  }
   sink->transfer_cond->data_available = FALSE;
   sink->transfer_cond->data_sent = TRUE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  g_cond_broadcast (&sink->transfer_cond->cond);
   GST_OBJECT_UNLOCK (sink);
 }
 
+/* Makes the next queued buffer the transfer buffer, or switches to the next
+ * file if that is what comes next in the queue. Returns TRUE if new data is
+ * available. Called by the transfer thread with the object lock. */
+static gboolean
+gst_curl_base_sink_queue_pop_unlocked (GstCurlBaseSink * sink)
+{
+  QueueItem *item;
+  gboolean ret = FALSE;
+
+  if (sink->transfer_cond->data_available || sink->new_file)
+    return FALSE;
+
+  if ((item = g_queue_pop_head (sink->queue)) == NULL)
+    return FALSE;
+
+  if (item->buffer) {
+    sink->transfer_buffer = item->buffer;
+    gst_buffer_map (sink->transfer_buffer, &sink->transfer_map, GST_MAP_READ);
+    sink->transfer_buf->ptr = sink->transfer_map.data;
+    sink->transfer_buf->len = sink->transfer_map.size;
+    sink->transfer_buf->offset = 0;
+    sink->cur_level_bytes -= sink->transfer_map.size;
+
+    sink->transfer_cond->data_available = TRUE;
+    sink->transfer_cond->data_sent = FALSE;
+    sink->transfer_cond->wait_for_response = TRUE;
+    ret = TRUE;
+  } else {
+    GST_LOG ("switching to file %s", item->file_name);
+    g_free (sink->file_name);
+    sink->file_name = item->file_name;
+    sink->new_file = TRUE;
+  }
+  g_slice_free (QueueItem, item);
+
+  /* there is room in the queue again */
+  g_cond_broadcast (&sink->transfer_cond->cond);
+
+  return ret;
+}
+
+static void
+gst_curl_base_sink_queue_clear_unlocked (GstCurlBaseSink * sink)
+{
+  QueueItem *item;
+
+  while ((item = g_queue_pop_head (sink->queue))) {
+    if (item->buffer)
+      gst_buffer_unref (item->buffer);
+    g_free (item->file_name);
+    g_slice_free (QueueItem, item);
+  }
+  sink->cur_level_bytes = 0;
+
+  if (sink->transfer_buffer) {
+    gst_buffer_unmap (sink->transfer_buffer, &sink->transfer_map);
+    gst_buffer_unref (sink->transfer_buffer);
+    sink->transfer_buffer = NULL;
+    sink->transfer_buf->len = 0;
+    sink->transfer_cond->data_available = FALSE;
+  }
+}
+
+/* wait until everything rendered so far has been handed to curl */
+static void
+gst_curl_base_sink_wait_for_queue_drain (GstCurlBaseSink * sink)
+{
+  GST_LOG ("waiting for the upload queue to drain");
+
+  GST_OBJECT_LOCK (sink);
+  while (sink->transfer_thread != NULL && sink->flow_ret == GST_FLOW_OK &&
+      !sink->flushing && (!g_queue_is_empty (sink->queue) ||
+          sink->transfer_buffer != NULL)) {
+    g_cond_wait (&sink->transfer_cond->cond, GST_OBJECT_GET_LOCK (sink));
+  }
+  GST_OBJECT_UNLOCK (sink);
+
+  GST_LOG ("upload queue drained");
+}
+
 static void
 gst_curl_base_sink_wait_for_response (GstCurlBaseSink * sink)
 {
@@ -1174,7 +1456,7 @@ gst_curl_base_sink_got_response_notify (GstCurlBaseSink * sink)
 
   GST_OBJECT_LOCK (sink);
   sink->transfer_cond->wait_for_response = FALSE;
-  g_cond_signal (&sink->transfer_cond->cond);
+  g_cond_broadcast (&sink->transfer_cond->cond);
   GST_OBJECT_UNLOCK (sink);
 }
 
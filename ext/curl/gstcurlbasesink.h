@@ -81,6 +81,23 @@ struct _GstCurlBaseSink
   gboolean transfer_thread_close;
   gboolean new_file;
   gboolean is_live;
+
+  /* upload queue, filled by render and drained by the transfer thread.
+   * Subclasses that need every buffer handed over synchronously clear
+   * queue_supported, only while not PAUSED or PLAYING */
+  gboolean queue_supported;
+  gboolean flushing;
+  GQueue *queue;
+  guint max_size_bytes;
+  guint cur_level_bytes;
+  GstBuffer *transfer_buffer;
+  GstMapInfo transfer_map;
+
+  /* statistics */
+  guint64 bytes_sent;
+  gint64 transfer_time;
+  gint64 idle_time;
+  GstClockTime stall_time;
 };
 
 struct _GstCurlBaseSinkClass
@@ -243,6 +243,10 @@ gst_curl_http_sink_set_property (GObject * object, guint prop_id,
         break;
       case PROP_USE_CONTENT_LENGTH:
         sink->use_content_length = g_value_get_boolean (value);
+        /* the Content-Length is the size of the buffer being handed over,
+         * the read callback must not merge it with the queued ones */
+        GST_CURL_BASE_SINK (sink)->queue_supported =
+            !sink->use_content_length;
         GST_DEBUG_OBJECT (sink, "use_content_length set to %d",
             sink->use_content_length);
         break;
@@ -343,6 +343,10 @@ gst_curl_smtp_sink_init (GstCurlSmtpSink * sink)
   sink->pop_passwd = NULL;
   sink->pop_location = NULL;
   sink->pop_curl = NULL;
+
+  /* every buffer is base64 encoded into the mail while curl reads it, which
+   * relies on render handing the buffers over one by one */
+  GST_CURL_BASE_SINK (sink)->queue_supported = FALSE;
 }
 
 static void
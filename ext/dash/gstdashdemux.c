@@ -170,6 +170,8 @@ enum
   PROP_MAX_BUFFERING_TIME,
   PROP_BANDWIDTH_USAGE,
   PROP_MAX_BITRATE,
+  PROP_MANIFEST_PARSE_TIME,
+  PROP_MANIFEST_PARSE_BYTES,
   PROP_LAST
 };
 
@@ -304,6 +306,16 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
           1000, G_MAXUINT, DEFAULT_MAX_BITRATE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_MANIFEST_PARSE_TIME,
+      g_param_spec_uint64 ("manifest-parse-time", "Manifest parse time",
+          "Time spent parsing the last manifest update (in nanoseconds)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MANIFEST_PARSE_BYTES,
+      g_param_spec_uint64 ("manifest-parse-bytes", "Manifest parse bytes",
+          "Size of the last parsed manifest update (in bytes)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_dash_demux_change_state);
 
@@ -399,6 +411,16 @@ gst_dash_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_MAX_BITRATE:
       g_value_set_uint (value, demux->max_bitrate);
       break;
+    case PROP_MANIFEST_PARSE_TIME:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->manifest_parse_time);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_MANIFEST_PARSE_BYTES:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->manifest_parse_bytes);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1472,11 +1494,25 @@ gst_dash_demux_all_streams_have_data (GstDashDemux * demux)
   return TRUE;
 }
 
+static void
+gst_dash_demux_update_manifest_stats (GstDashDemux * demux,
+    GstClockTime parse_start, gsize size)
+{
+  GST_OBJECT_LOCK (demux);
+  demux->manifest_parse_time = gst_util_get_timestamp () - parse_start;
+  demux->manifest_parse_bytes = size;
+  GST_OBJECT_UNLOCK (demux);
+
+  GST_DEBUG_OBJECT (demux, "Parsed %" G_GSIZE_FORMAT " bytes of manifest in %"
+      GST_TIME_FORMAT, size, GST_TIME_ARGS (demux->manifest_parse_time));
+}
+
 static GstFlowReturn
 gst_dash_demux_refresh_mpd (GstDashDemux * demux)
 {
   GstFragment *download;
   GstBuffer *buffer;
+  GstClockTime parse_start;
   GstClockTime duration, now = gst_util_get_timestamp ();
   gint64 update_period = demux->client->mpd_node->minimumUpdatePeriod;
 
@@ -1510,11 +1546,28 @@ gst_dash_demux_refresh_mpd (GstDashDemux * demux)
       if (buffer != NULL) {
         GstMapInfo mapinfo;
 
+        gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
+        parse_start = gst_util_get_timestamp ();
+
+        /* most updates only extend the segment timelines, try to merge them
+         * into the current client before doing a full parse */
+        if (gst_mpd_client_update (demux->client, (gchar *) mapinfo.data,
+                mapinfo.size)) {
+          gst_dash_demux_update_manifest_stats (demux, parse_start,
+              mapinfo.size);
+          gst_buffer_unmap (buffer, &mapinfo);
+          gst_buffer_unref (buffer);
+
+          demux->last_manifest_update = gst_util_get_timestamp ();
+          GST_DEBUG_OBJECT (demux, "Manifest file successfully merged");
+          return GST_FLOW_OK;
+        }
+
+        /* only account for the full parse */
+        parse_start = gst_util_get_timestamp ();
         new_client = gst_mpd_client_new ();
         new_client->mpd_uri = g_strdup (demux->client->mpd_uri);
 
-        gst_buffer_map (buffer, &mapinfo, GST_MAP_READ);
-
         if (gst_mpd_parse (new_client, (gchar *) mapinfo.data, mapinfo.size)) {
           const gchar *period_id;
           guint period_idx;
@@ -1523,6 +1576,8 @@ gst_dash_demux_refresh_mpd (GstDashDemux * demux)
           /* prepare the new manifest and try to transfer the stream position
            * status from the old manifest client  */
 
+          gst_dash_demux_update_manifest_stats (demux, parse_start,
+              mapinfo.size);
           gst_buffer_unmap (buffer, &mapinfo);
           gst_buffer_unref (buffer);
 
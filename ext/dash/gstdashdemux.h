@@ -141,6 +141,8 @@ struct _GstDashDemux
 
   /* Manifest update */
   GstClockTime last_manifest_update;
+  GstClockTime manifest_parse_time;     /* time spent parsing the last update */
+  guint64 manifest_parse_bytes;         /* size of the last update            */
 };
 
 struct _GstDashDemuxClass
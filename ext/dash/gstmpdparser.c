@@ -27,6 +27,7 @@
 #include <string.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
 
@@ -63,6 +64,8 @@ static gboolean gst_mpdparser_get_xml_prop_cond_uint (xmlNode * a_node,
     const gchar * property_name, GstConditionalUintType ** property_value);
 static gboolean gst_mpdparser_get_xml_prop_dateTime (xmlNode * a_node,
     const gchar * property_name, GstDateTime ** property_value);
+static gboolean gst_mpdparser_parse_duration (const gchar * str,
+    gint64 * value);
 static gboolean gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
     const gchar * property_name, gint64 default_value, gint64 * property_value);
 static gboolean gst_mpdparser_get_xml_node_content (xmlNode * a_node,
@@ -803,137 +806,149 @@ convert_to_millisecs (gint decimals, gint pos)
 }
 
 static gboolean
-gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
-    const gchar * property_name, gint64 default_value, gint64 * property_value)
+gst_mpdparser_parse_duration (const gchar * str, gint64 * value)
 {
-  xmlChar *prop_string;
-  gchar *str;
   gint ret, read, len, pos, posT;
   gint years = 0, months = 0, days = 0, hours = 0, minutes = 0, seconds =
       0, decimals = 0;
   gint sign = 1;
   gboolean have_ms = FALSE;
-  gboolean exists = FALSE;
 
-  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
-  if (prop_string) {
-    len = xmlStrlen (prop_string);
-    str = (gchar *) prop_string;
-    GST_TRACE ("duration: %s, len %d", str, len);
-    /* read "-" for sign, if present */
-    pos = strcspn (str, "-");
-    if (pos < len) {            /* found "-" */
-      if (pos != 0) {
-        GST_WARNING ("sign \"-\" non at the beginning of the string");
-        goto error;
-      }
-      GST_TRACE ("found - sign at the beginning");
-      sign = -1;
-      str++;
-      len--;
-    }
-    /* read "P" for period */
-    pos = strcspn (str, "P");
+  len = strlen (str);
+  GST_TRACE ("duration: %s, len %d", str, len);
+  /* read "-" for sign, if present */
+  pos = strcspn (str, "-");
+  if (pos < len) {            /* found "-" */
     if (pos != 0) {
-      GST_WARNING ("P not found at the beginning of the string!");
+      GST_WARNING ("sign \"-\" non at the beginning of the string");
       goto error;
     }
+    GST_TRACE ("found - sign at the beginning");
+    sign = -1;
     str++;
     len--;
-    /* read "T" for time (if present) */
-    posT = strcspn (str, "T");
-    len -= posT;
-    if (posT > 0) {
-      /* there is some room between P and T, so there must be a period section */
-      /* read years, months, days */
-      do {
-        GST_TRACE ("parsing substring %s", str);
-        pos = strcspn (str, "YMD");
-        ret = sscanf (str, "%d", &read);
-        if (ret != 1) {
-          GST_WARNING ("can not read integer value from string %s!", str);
-          goto error;
-        }
-        switch (str[pos]) {
-          case 'Y':
-            years = read;
-            break;
-          case 'M':
-            months = read;
-            break;
-          case 'D':
-            days = read;
-            break;
-          default:
-            GST_WARNING ("unexpected char %c!", str[pos]);
-            goto error;
-            break;
-        }
-        GST_TRACE ("read number %d type %c", read, str[pos]);
-        str += (pos + 1);
-        posT -= (pos + 1);
-      } while (posT > 0);
-
-      GST_TRACE ("Y:M:D=%d:%d:%d", years, months, days);
-    }
-    /* read "T" for time (if present) */
-    /* here T is at pos == 0 */
-    str++;
-    len--;
-    pos = 0;
-    if (pos < len) {
-      /* T found, there is a time section */
-      /* read hours, minutes, seconds, cents of second */
-      do {
-        GST_TRACE ("parsing substring %s", str);
-        pos = strcspn (str, "HMS,.");
-        ret = sscanf (str, "%d", &read);
-        if (ret != 1) {
-          GST_WARNING ("can not read integer value from string %s!", str);
+  }
+  /* read "P" for period */
+  pos = strcspn (str, "P");
+  if (pos != 0) {
+    GST_WARNING ("P not found at the beginning of the string!");
+    goto error;
+  }
+  str++;
+  len--;
+  /* read "T" for time (if present) */
+  posT = strcspn (str, "T");
+  len -= posT;
+  if (posT > 0) {
+    /* there is some room between P and T, so there must be a period section */
+    /* read years, months, days */
+    do {
+      GST_TRACE ("parsing substring %s", str);
+      pos = strcspn (str, "YMD");
+      ret = sscanf (str, "%d", &read);
+      if (ret != 1) {
+        GST_WARNING ("can not read integer value from string %s!", str);
+        goto error;
+      }
+      switch (str[pos]) {
+        case 'Y':
+          years = read;
+          break;
+        case 'M':
+          months = read;
+          break;
+        case 'D':
+          days = read;
+          break;
+        default:
+          GST_WARNING ("unexpected char %c!", str[pos]);
           goto error;
-        }
-        switch (str[pos]) {
-          case 'H':
-            hours = read;
-            break;
-          case 'M':
-            minutes = read;
-            break;
-          case 'S':
-            if (have_ms) {
-              /* we have read the decimal part of the seconds */
-              decimals = convert_to_millisecs (read, pos);
-              GST_TRACE ("decimal number %d (%d digits) -> %d ms", read, pos,
-                  decimals);
-            } else {
-              /* no decimals */
-              seconds = read;
-            }
-            break;
-          case '.':
-          case ',':
-            /* we have read the integer part of a decimal number in seconds */
+          break;
+      }
+      GST_TRACE ("read number %d type %c", read, str[pos]);
+      str += (pos + 1);
+      posT -= (pos + 1);
+    } while (posT > 0);
+
+    GST_TRACE ("Y:M:D=%d:%d:%d", years, months, days);
+  }
+  /* read "T" for time (if present) */
+  /* here T is at pos == 0 */
+  str++;
+  len--;
+  pos = 0;
+  if (pos < len) {
+    /* T found, there is a time section */
+    /* read hours, minutes, seconds, cents of second */
+    do {
+      GST_TRACE ("parsing substring %s", str);
+      pos = strcspn (str, "HMS,.");
+      ret = sscanf (str, "%d", &read);
+      if (ret != 1) {
+        GST_WARNING ("can not read integer value from string %s!", str);
+        goto error;
+      }
+      switch (str[pos]) {
+        case 'H':
+          hours = read;
+          break;
+        case 'M':
+          minutes = read;
+          break;
+        case 'S':
+          if (have_ms) {
+            /* we have read the decimal part of the seconds */
+            decimals = convert_to_millisecs (read, pos);
+            GST_TRACE ("decimal number %d (%d digits) -> %d ms", read, pos,
+                decimals);
+          } else {
+            /* no decimals */
             seconds = read;
-            have_ms = TRUE;
-            break;
-          default:
-            GST_WARNING ("unexpected char %c!", str[pos]);
-            goto error;
-            break;
-        }
-        GST_TRACE ("read number %d type %c", read, str[pos]);
-        str += pos + 1;
-        len -= (pos + 1);
-      } while (len > 0);
+          }
+          break;
+        case '.':
+        case ',':
+          /* we have read the integer part of a decimal number in seconds */
+          seconds = read;
+          have_ms = TRUE;
+          break;
+        default:
+          GST_WARNING ("unexpected char %c!", str[pos]);
+          goto error;
+          break;
+      }
+      GST_TRACE ("read number %d type %c", read, str[pos]);
+      str += pos + 1;
+      len -= (pos + 1);
+    } while (len > 0);
 
-      GST_TRACE ("H:M:S.MS=%d:%d:%d.%03d", hours, minutes, seconds, decimals);
-    }
+    GST_TRACE ("H:M:S.MS=%d:%d:%d.%03d", hours, minutes, seconds, decimals);
+  }
+
+  *value =
+      sign * ((((((gint64) years * 365 + months * 30 + days) * 24 +
+                  hours) * 60 + minutes) * 60 + seconds) * 1000 + decimals);
+  return TRUE;
+
+error:
+  return FALSE;
+}
+
+static gboolean
+gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
+    const gchar * property_name, gint64 default_value, gint64 * property_value)
+{
+  xmlChar *prop_string;
+  gboolean exists = FALSE;
 
+  prop_string = xmlGetProp (a_node, (const xmlChar *) property_name);
+  if (prop_string) {
+    if (!gst_mpdparser_parse_duration ((gchar *) prop_string, property_value)) {
+      xmlFree (prop_string);
+      return FALSE;
+    }
     xmlFree (prop_string);
     exists = TRUE;
-    *property_value =
-        sign * ((((((gint64) years * 365 + months * 30 + days) * 24 +
-                    hours) * 60 + minutes) * 60 + seconds) * 1000 + decimals);
     GST_LOG (" - %s: %" G_GINT64_FORMAT, property_name, *property_value);
   }
 
@@ -941,10 +956,6 @@ gst_mpdparser_get_xml_prop_duration (xmlNode * a_node,
     *property_value = default_value;
   }
   return exists;
-
-error:
-  xmlFree (prop_string);
-  return FALSE;
 }
 
 static gboolean
@@ -2987,6 +2998,607 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
   return FALSE;
 }
 
+/* Differential MPD update
+ *
+ * A refreshed live manifest usually differs from the previous one only by
+ * the S entries appended to (and expired from) its SegmentTimelines. Instead
+ * of building a new DOM and a new client, the update is streamed through an
+ * xmlTextReader, its Period, AdaptationSet and Representation nodes are
+ * matched by id against the ones of the current client and only the
+ * timelines are merged in place. Anything that is not a timeline change
+ * makes gst_mpd_client_update() fail so that the caller can fall back to a
+ * full gst_mpd_parse().
+ */
+
+typedef enum
+{
+  GST_MPD_UPDATE_LEVEL_MPD,
+  GST_MPD_UPDATE_LEVEL_PERIOD,
+  GST_MPD_UPDATE_LEVEL_ADAPTATION_SET,
+  GST_MPD_UPDATE_LEVEL_REPRESENTATION,
+  GST_MPD_UPDATE_LEVEL_COUNT
+} GstMpdUpdateLevel;
+
+typedef struct
+{
+  GstMultSegmentBaseType *target;
+  GstSegmentTimelineNode *timeline;
+} GstMpdTimelineMerge;
+
+typedef struct
+{
+  GstMpdClient *client;
+  gboolean valid;
+  gboolean done;
+
+  GstMpdUpdateLevel level;
+  GstPeriodNode *period;
+  GstAdaptationSetNode *adapt_set;
+  GstRepresentationNode *representation;
+  guint n_periods;
+  guint n_adapt_sets;
+  guint n_representations;
+
+  /* SegmentTimeline read from the update for each level, NULL if none */
+  GstSegmentTimelineNode *timelines[GST_MPD_UPDATE_LEVEL_COUNT];
+  /* whether the update has a SegmentTemplate at each level */
+  gboolean templates[GST_MPD_UPDATE_LEVEL_COUNT];
+  gboolean in_template;
+  GstSegmentTimelineNode *cur_timeline;
+
+  /* all timelines read from the update */
+  GList *parsed;
+  /* list of GstMpdTimelineMerge, applied once the whole update was read */
+  GList *merges;
+
+  gint64 minimumUpdatePeriod;
+} GstMpdUpdate;
+
+static gboolean
+gst_mpdparser_get_reader_prop_unsigned_integer_64 (xmlTextReaderPtr reader,
+    const gchar * property_name, guint64 default_val, guint64 * property_value)
+{
+  xmlChar *prop_string;
+  gboolean exists = FALSE;
+
+  *property_value = default_val;
+  prop_string = xmlTextReaderGetAttribute (reader,
+      (const xmlChar *) property_name);
+  if (prop_string) {
+    if (sscanf ((gchar *) prop_string, "%" G_GUINT64_FORMAT, property_value)) {
+      exists = TRUE;
+    } else {
+      GST_WARNING
+          ("failed to parse unsigned integer property %s from xml string %s",
+          property_name, prop_string);
+    }
+    xmlFree (prop_string);
+  }
+
+  return exists;
+}
+
+static gboolean
+gst_mpdparser_get_reader_prop_duration (xmlTextReaderPtr reader,
+    const gchar * property_name, gint64 default_value, gint64 * property_value)
+{
+  xmlChar *prop_string;
+  gboolean exists = FALSE;
+
+  *property_value = default_value;
+  prop_string = xmlTextReaderGetAttribute (reader,
+      (const xmlChar *) property_name);
+  if (prop_string) {
+    exists = gst_mpdparser_parse_duration ((gchar *) prop_string,
+        property_value);
+    xmlFree (prop_string);
+  }
+
+  return exists;
+}
+
+static GstSegmentTimelineNode *
+gst_mpdparser_update_get_timeline (GstMpdUpdate * update,
+    GstMpdUpdateLevel level)
+{
+  /* SegmentTimeline elements are inherited from the enclosing levels */
+  for (; level > GST_MPD_UPDATE_LEVEL_MPD; level--) {
+    if (update->timelines[level])
+      return update->timelines[level];
+  }
+  return NULL;
+}
+
+/* The client gives a copy of the SegmentTimeline of the enclosing levels to
+ * the SegmentTemplate of each node that has one, so the timeline that
+ * applies at @level is merged into the template of the node at @level, if
+ * any. Nodes without a SegmentTemplate use the one of their parent, which is
+ * merged when the parent ends. */
+static void
+gst_mpdparser_update_add_merge (GstMpdUpdate * update,
+    GstSegmentTemplateNode * seg_template, GstMpdUpdateLevel level)
+{
+  GstSegmentTimelineNode *timeline;
+  GstMultSegmentBaseType *target = NULL;
+  GstMpdTimelineMerge *merge;
+
+  if ((seg_template != NULL) != update->templates[level]) {
+    GST_DEBUG ("SegmentTemplate added or removed by the update");
+    update->valid = FALSE;
+    return;
+  }
+  if (seg_template == NULL)
+    return;
+
+  timeline = gst_mpdparser_update_get_timeline (update, level);
+  if (seg_template->MultSegBaseType
+      && seg_template->MultSegBaseType->SegmentTimeline)
+    target = seg_template->MultSegBaseType;
+
+  if (target == NULL && timeline == NULL)
+    return;
+
+  if (target == NULL || timeline == NULL) {
+    GST_DEBUG ("SegmentTimeline added or removed by the update");
+    update->valid = FALSE;
+    return;
+  }
+
+  merge = g_slice_new (GstMpdTimelineMerge);
+  merge->target = target;
+  merge->timeline = timeline;
+  update->merges = g_list_prepend (update->merges, merge);
+}
+
+static void
+gst_mpdparser_update_start_element (GstMpdUpdate * update,
+    xmlTextReaderPtr reader)
+{
+  const xmlChar *name = xmlTextReaderConstLocalName (reader);
+  xmlChar *prop_string;
+
+  if (xmlStrcmp (name, (xmlChar *) "MPD") == 0) {
+    gint64 duration;
+
+    prop_string = xmlTextReaderGetAttribute (reader, (xmlChar *) "type");
+    if (prop_string) {
+      if (xmlStrcmp (prop_string, (xmlChar *) "static") == 0) {
+        GST_DEBUG ("MPD became static");
+        update->valid = FALSE;
+      }
+      xmlFree (prop_string);
+    }
+    gst_mpdparser_get_reader_prop_duration (reader,
+        "mediaPresentationDuration", -1, &duration);
+    if (duration != update->client->mpd_node->mediaPresentationDuration) {
+      GST_DEBUG ("mediaPresentationDuration changed");
+      update->valid = FALSE;
+    }
+    gst_mpdparser_get_reader_prop_duration (reader, "minimumUpdatePeriod", -1,
+        &update->minimumUpdatePeriod);
+    update->level = GST_MPD_UPDATE_LEVEL_MPD;
+  } else if (xmlStrcmp (name, (xmlChar *) "Period") == 0) {
+    GList *list = update->client->mpd_node->Periods;
+
+    prop_string = xmlTextReaderGetAttribute (reader, (xmlChar *) "id");
+    if (prop_string) {
+      for (; list; list = g_list_next (list)) {
+        GstPeriodNode *period = list->data;
+        if (period->id && xmlStrcmp (prop_string, (xmlChar *) period->id) == 0)
+          break;
+      }
+      xmlFree (prop_string);
+    } else {
+      list = g_list_nth (list, update->n_periods);
+    }
+    if (list == NULL) {
+      GST_DEBUG ("Period %u of the update is not known", update->n_periods);
+      update->valid = FALSE;
+      return;
+    }
+    update->period = list->data;
+    update->n_periods++;
+    update->n_adapt_sets = 0;
+    update->timelines[GST_MPD_UPDATE_LEVEL_PERIOD] = NULL;
+    update->templates[GST_MPD_UPDATE_LEVEL_PERIOD] = FALSE;
+    update->level = GST_MPD_UPDATE_LEVEL_PERIOD;
+  } else if (xmlStrcmp (name, (xmlChar *) "AdaptationSet") == 0) {
+    GList *list;
+    guint id;
+
+    if (update->level != GST_MPD_UPDATE_LEVEL_PERIOD)
+      return;
+
+    list = update->period->AdaptationSets;
+    prop_string = xmlTextReaderGetAttribute (reader, (xmlChar *) "id");
+    if (prop_string) {
+      if (sscanf ((gchar *) prop_string, "%u", &id) != 1)
+        id = 0;
+      for (; list; list = g_list_next (list)) {
+        GstAdaptationSetNode *adapt_set = list->data;
+        if (adapt_set->id == id)
+          break;
+      }
+      xmlFree (prop_string);
+    } else {
+      list = g_list_nth (list, update->n_adapt_sets);
+    }
+    if (list == NULL) {
+      GST_DEBUG ("AdaptationSet %u of the update is not known",
+          update->n_adapt_sets);
+      update->valid = FALSE;
+      return;
+    }
+    update->adapt_set = list->data;
+    update->n_adapt_sets++;
+    update->n_representations = 0;
+    update->timelines[GST_MPD_UPDATE_LEVEL_ADAPTATION_SET] = NULL;
+    update->templates[GST_MPD_UPDATE_LEVEL_ADAPTATION_SET] = FALSE;
+    update->level = GST_MPD_UPDATE_LEVEL_ADAPTATION_SET;
+  } else if (xmlStrcmp (name, (xmlChar *) "Representation") == 0) {
+    GList *list;
+
+    if (update->level != GST_MPD_UPDATE_LEVEL_ADAPTATION_SET)
+      return;
+
+    list = update->adapt_set->Representations;
+    prop_string = xmlTextReaderGetAttribute (reader, (xmlChar *) "id");
+    if (prop_string) {
+      for (; list; list = g_list_next (list)) {
+        GstRepresentationNode *representation = list->data;
+        if (representation->id
+            && xmlStrcmp (prop_string, (xmlChar *) representation->id) == 0)
+          break;
+      }
+      xmlFree (prop_string);
+    } else {
+      list = g_list_nth (list, update->n_representations);
+    }
+    if (list == NULL) {
+      GST_DEBUG ("Representation %u of the update is not known",
+          update->n_representations);
+      update->valid = FALSE;
+      return;
+    }
+    update->representation = list->data;
+    update->n_representations++;
+    update->timelines[GST_MPD_UPDATE_LEVEL_REPRESENTATION] = NULL;
+    update->templates[GST_MPD_UPDATE_LEVEL_REPRESENTATION] = FALSE;
+    update->level = GST_MPD_UPDATE_LEVEL_REPRESENTATION;
+  } else if (xmlStrcmp (name, (xmlChar *) "SegmentList") == 0) {
+    /* SegmentURL lists can not be merged */
+    if (update->level > GST_MPD_UPDATE_LEVEL_MPD) {
+      GST_DEBUG ("SegmentList found, can not merge the update");
+      update->valid = FALSE;
+    }
+  } else if (xmlStrcmp (name, (xmlChar *) "SegmentTemplate") == 0) {
+    if (update->level == GST_MPD_UPDATE_LEVEL_MPD)
+      return;
+    /* the schema puts SegmentTemplate before the child AdaptationSet and
+     * Representation nodes, we rely on that to merge in a single pass */
+    if ((update->level == GST_MPD_UPDATE_LEVEL_PERIOD
+            && update->n_adapt_sets > 0)
+        || (update->level == GST_MPD_UPDATE_LEVEL_ADAPTATION_SET
+            && update->n_representations > 0)) {
+      GST_DEBUG ("SegmentTemplate after child nodes, can not merge the update");
+      update->valid = FALSE;
+      return;
+    }
+    update->in_template = TRUE;
+    update->templates[update->level] = TRUE;
+  } else if (xmlStrcmp (name, (xmlChar *) "SegmentTimeline") == 0) {
+    if (!update->in_template)
+      return;
+    update->cur_timeline = gst_mpdparser_segment_timeline_node_new ();
+    update->parsed = g_list_prepend (update->parsed, update->cur_timeline);
+    update->timelines[update->level] = update->cur_timeline;
+  } else if (xmlStrcmp (name, (xmlChar *) "S") == 0) {
+    GstSNode *s_node;
+    guint64 r;
+
+    if (update->cur_timeline == NULL)
+      return;
+    s_node = g_slice_new0 (GstSNode);
+    gst_mpdparser_get_reader_prop_unsigned_integer_64 (reader, "t", 0,
+        &s_node->t);
+    gst_mpdparser_get_reader_prop_unsigned_integer_64 (reader, "d", 0,
+        &s_node->d);
+    gst_mpdparser_get_reader_prop_unsigned_integer_64 (reader, "r", 0, &r);
+    s_node->r = r;
+    g_queue_push_tail (&update->cur_timeline->S, s_node);
+  }
+}
+
+static void
+gst_mpdparser_update_end_element (GstMpdUpdate * update,
+    xmlTextReaderPtr reader)
+{
+  const xmlChar *name = xmlTextReaderConstLocalName (reader);
+
+  if (xmlStrcmp (name, (xmlChar *) "MPD") == 0) {
+    if (update->n_periods != g_list_length (update->client->mpd_node->Periods)) {
+      GST_DEBUG ("Periods were removed by the update");
+      update->valid = FALSE;
+    }
+    update->done = TRUE;
+  } else if (xmlStrcmp (name, (xmlChar *) "Period") == 0) {
+    if (update->level != GST_MPD_UPDATE_LEVEL_PERIOD)
+      return;
+    if (update->n_adapt_sets != g_list_length (update->period->AdaptationSets)) {
+      GST_DEBUG ("AdaptationSets were removed by the update");
+      update->valid = FALSE;
+    }
+    gst_mpdparser_update_add_merge (update, update->period->SegmentTemplate,
+        GST_MPD_UPDATE_LEVEL_PERIOD);
+    update->level = GST_MPD_UPDATE_LEVEL_MPD;
+  } else if (xmlStrcmp (name, (xmlChar *) "AdaptationSet") == 0) {
+    if (update->level != GST_MPD_UPDATE_LEVEL_ADAPTATION_SET)
+      return;
+    if (update->n_representations !=
+        g_list_length (update->adapt_set->Representations)) {
+      GST_DEBUG ("Representations were removed by the update");
+      update->valid = FALSE;
+    }
+    gst_mpdparser_update_add_merge (update, update->adapt_set->SegmentTemplate,
+        GST_MPD_UPDATE_LEVEL_ADAPTATION_SET);
+    update->level = GST_MPD_UPDATE_LEVEL_PERIOD;
+  } else if (xmlStrcmp (name, (xmlChar *) "Representation") == 0) {
+    if (update->level != GST_MPD_UPDATE_LEVEL_REPRESENTATION)
+      return;
+    gst_mpdparser_update_add_merge (update,
+        update->representation->SegmentTemplate,
+        GST_MPD_UPDATE_LEVEL_REPRESENTATION);
+    update->level = GST_MPD_UPDATE_LEVEL_ADAPTATION_SET;
+  } else if (xmlStrcmp (name, (xmlChar *) "SegmentTemplate") == 0) {
+    update->in_template = FALSE;
+  } else if (xmlStrcmp (name, (xmlChar *) "SegmentTimeline") == 0) {
+    update->cur_timeline = NULL;
+  }
+}
+
+/* merges the S nodes of @timeline into the SegmentTimeline of @target:
+ * segments starting after the end of the current timeline are appended and
+ * segments that ended before the start of the updated timeline are dropped,
+ * startNumber is moved accordingly */
+static guint
+gst_mpdparser_merge_segment_timeline (GstMultSegmentBaseType * target,
+    GstSegmentTimelineNode * timeline)
+{
+  GstSegmentTimelineNode *current = target->SegmentTimeline;
+  GstSNode *S, *tail;
+  GList *list;
+  guint64 end = 0, start = 0, window_start = 0;
+  guint removed = 0, added = 0;
+
+  for (list = g_queue_peek_head_link (&current->S); list;
+      list = g_list_next (list)) {
+    S = list->data;
+    if (S->t > 0)
+      end = S->t;
+    end += S->d * (S->r + 1);
+  }
+
+  S = g_queue_peek_head (&timeline->S);
+  if (S)
+    window_start = S->t;
+
+  for (list = g_queue_peek_head_link (&timeline->S); list;
+      list = g_list_next (list)) {
+    guint64 count, skip;
+
+    S = list->data;
+    if (S->t > 0)
+      start = S->t;
+    count = (guint64) S->r + 1;
+    if (S->d == 0 || start + S->d * count <= end) {
+      start += S->d * count;
+      continue;
+    }
+
+    skip = start >= end ? 0 : (end - start + S->d - 1) / S->d;
+    start += S->d * skip;
+    count -= skip;
+
+    tail = g_queue_peek_tail (&current->S);
+    if (tail && tail->d == S->d && start == end) {
+      tail->r += count;
+    } else {
+      GstSNode *new_s_node = g_slice_new0 (GstSNode);
+      new_s_node->t = start;
+      new_s_node->d = S->d;
+      new_s_node->r = count - 1;
+      g_queue_push_tail (&current->S, new_s_node);
+    }
+    added += count;
+    start += S->d * count;
+    end = start;
+  }
+
+  /* expire the segments that left the time shift buffer */
+  start = 0;
+  while (window_start > 0 && (S = g_queue_peek_head (&current->S))) {
+    guint64 count = (guint64) S->r + 1;
+
+    if (S->t > 0)
+      start = S->t;
+    if (S->d == 0 || start + S->d * count <= window_start) {
+      start += S->d * count;
+      removed += count;
+      gst_mpdparser_free_s_node (g_queue_pop_head (&current->S));
+      continue;
+    }
+    if (start + S->d <= window_start) {
+      count = (window_start - start) / S->d;
+      start += S->d * count;
+      S->r -= count;
+      removed += count;
+    }
+    S->t = start;
+    break;
+  }
+  target->startNumber += removed;
+
+  GST_LOG ("Merged SegmentTimeline: %u segments added, %u removed", added,
+      removed);
+
+  return added;
+}
+
+/* brings the segment list of an active stream in sync with its merged
+ * SegmentTimeline, keeping the position of the stream */
+static void
+gst_mpdparser_update_active_stream_segments (GstActiveStream * stream)
+{
+  GstSegmentTimelineNode *timeline;
+  GstMediaSegment *last;
+  GstClockTime start_time, duration;
+  GstSNode *S;
+  GList *list;
+  guint64 start = 0;
+  guint timescale, removed = 0, number;
+
+  if (stream->segments == NULL || stream->segments->len == 0
+      || stream->cur_seg_template == NULL
+      || stream->cur_seg_template->MultSegBaseType == NULL
+      || stream->cur_seg_template->MultSegBaseType->SegmentTimeline == NULL)
+    return;
+
+  timeline = stream->cur_seg_template->MultSegBaseType->SegmentTimeline;
+  timescale = stream->cur_seg_template->MultSegBaseType->SegBaseType->timescale;
+
+  /* drop the segments that expired */
+  S = g_queue_peek_head (&timeline->S);
+  if (S && S->t > 0) {
+    while (removed < stream->segments->len
+        && ((GstMediaSegment *) g_ptr_array_index (stream->segments,
+                removed))->start < S->t)
+      removed++;
+    if (removed == stream->segments->len)
+      removed = 0;
+    if (removed > 0) {
+      g_ptr_array_remove_range (stream->segments, 0, removed);
+      if (stream->segment_idx >= removed)
+        stream->segment_idx -= removed;
+      else
+        stream->segment_idx = 0;
+    }
+  }
+
+  /* append the new ones, computing the times like
+   * gst_mpd_client_setup_representation() does */
+  last = g_ptr_array_index (stream->segments, stream->segments->len - 1);
+  number = last->number + 1;
+  start_time = last->start_time;
+  for (list = g_queue_peek_head_link (&timeline->S); list;
+      list = g_list_next (list)) {
+    guint j;
+
+    S = list->data;
+    duration = S->d * GST_SECOND;
+    if (timescale > 1)
+      duration /= timescale;
+    if (S->t > 0) {
+      start = S->t;
+      start_time = S->t * GST_SECOND;
+      if (timescale > 1)
+        start_time /= timescale;
+    }
+    if (start + S->d * S->r <= last->start) {
+      start += S->d * (S->r + 1);
+      start_time += duration * (S->r + 1);
+      continue;
+    }
+
+    for (j = 0; j <= S->r; j++) {
+      if (start > last->start) {
+        if (!gst_mpd_client_add_media_segment (stream, NULL, number, start,
+                start_time, duration))
+          return;
+        number++;
+      }
+      start += S->d;
+      start_time += duration;
+    }
+  }
+
+  GST_LOG ("Stream %p now has %u segments (%u removed), next is %u", stream,
+      stream->segments->len, removed, stream->segment_idx);
+}
+
+gboolean
+gst_mpd_client_update (GstMpdClient * client, const gchar * data, gint size)
+{
+  xmlTextReaderPtr reader;
+  GstMpdUpdate update;
+  GList *list;
+  gint ret = 1;
+
+  g_return_val_if_fail (client != NULL, FALSE);
+
+  if (data == NULL || client->mpd_node == NULL)
+    return FALSE;
+
+  LIBXML_TEST_VERSION
+      reader = xmlReaderForMemory (data, size, "noname.xml", NULL, 0);
+  if (reader == NULL) {
+    GST_ERROR ("failed to create a reader for the MPD file");
+    return FALSE;
+  }
+
+  GST_MPD_CLIENT_LOCK (client);
+  memset (&update, 0, sizeof (update));
+  update.client = client;
+  update.valid = TRUE;
+  update.minimumUpdatePeriod = -1;
+
+  while (update.valid && !update.done
+      && (ret = xmlTextReaderRead (reader)) == 1) {
+    switch (xmlTextReaderNodeType (reader)) {
+      case XML_READER_TYPE_ELEMENT:
+        gst_mpdparser_update_start_element (&update, reader);
+        if (xmlTextReaderIsEmptyElement (reader))
+          gst_mpdparser_update_end_element (&update, reader);
+        break;
+      case XML_READER_TYPE_END_ELEMENT:
+        gst_mpdparser_update_end_element (&update, reader);
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (ret < 0 || !update.done)
+    update.valid = FALSE;
+
+  if (update.valid) {
+    guint added = 0;
+
+    for (list = update.merges; list; list = g_list_next (list)) {
+      GstMpdTimelineMerge *merge = list->data;
+      added += gst_mpdparser_merge_segment_timeline (merge->target,
+          merge->timeline);
+    }
+    for (list = client->active_streams; list; list = g_list_next (list))
+      gst_mpdparser_update_active_stream_segments (list->data);
+    client->mpd_node->minimumUpdatePeriod = update.minimumUpdatePeriod;
+
+    GST_DEBUG ("MPD update merged, %u segments added", added);
+  } else {
+    GST_DEBUG ("MPD update can not be merged");
+  }
+
+  for (list = update.merges; list; list = g_list_next (list))
+    g_slice_free (GstMpdTimelineMerge, list->data);
+  g_list_free (update.merges);
+  g_list_free_full (update.parsed,
+      (GDestroyNotify) gst_mpdparser_free_segment_timeline_node);
+
+  GST_MPD_CLIENT_UNLOCK (client);
+  xmlFreeTextReader (reader);
+
+  return update.valid;
+}
+
 const gchar *
 gst_mpdparser_get_baseURL (GstMpdClient * client, guint indexStream)
 {
@@ -479,6 +479,7 @@ void gst_media_fragment_info_clear (GstMediaFragmentInfo * fragment);
 
 /* MPD file parsing */
 gboolean gst_mpd_parse (GstMpdClient *client, const gchar *data, gint size);
+gboolean gst_mpd_client_update (GstMpdClient *client, const gchar *data, gint size);
 
 /* Streaming management */
 gboolean gst_mpd_client_setup_media_presentation (GstMpdClient *client);
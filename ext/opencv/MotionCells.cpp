@@ -91,8 +91,12 @@ MotionCells::MotionCells ()
   m_motioncellsidxcstr = NULL;
   m_saveInDatafile = false;
   mc_savefile = NULL;
-  m_pcurFrame = NULL;
-  m_pprevFrame = NULL;
+  m_pcurgreyImage = NULL;
+  m_pprevgreyImage = NULL;
+  m_pdownImage = NULL;
+  m_pCells = NULL;
+  m_cellsgridx = 0;
+  m_cellsgridy = 0;
   transparencyimg = NULL;
   m_pdifferenceImage = NULL;
   m_pbwImage = NULL;
@@ -117,10 +121,19 @@ MotionCells::~MotionCells ()
   delete[]m_savedatafilefailed;
   if (m_motioncellsidxcstr)
     delete[]m_motioncellsidxcstr;
-  if (m_pcurFrame)
-    cvReleaseImage (&m_pcurFrame);
-  if (m_pprevFrame)
-    cvReleaseImage (&m_pprevFrame);
+  releaseImages ();
+  freeMotionCells ();
+}
+
+void
+MotionCells::releaseImages ()
+{
+  if (m_pcurgreyImage)
+    cvReleaseImage (&m_pcurgreyImage);
+  if (m_pprevgreyImage)
+    cvReleaseImage (&m_pprevgreyImage);
+  if (m_pdownImage)
+    cvReleaseImage (&m_pdownImage);
   if (transparencyimg)
     cvReleaseImage (&transparencyimg);
   if (m_pdifferenceImage)
@@ -129,6 +142,64 @@ MotionCells::~MotionCells ()
     cvReleaseImage (&m_pbwImage);
 }
 
+void
+MotionCells::allocateImages (IplImage * p_frame)
+{
+  CvSize size = cvGetSize (p_frame);
+
+  releaseImages ();
+
+  //the motion is detected on a half sized grey image
+  m_frameSize = cvSize (size.width / 2, size.height / 2);
+  m_pcurgreyImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
+  m_pprevgreyImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
+  m_pdownImage =
+      cvCreateImage (m_frameSize, p_frame->depth, p_frame->nChannels);
+  m_pdifferenceImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
+  m_pbwImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
+  transparencyimg = cvCreateImage (size, p_frame->depth, 3);
+}
+
+//Scales the RGB frame down by 2 and converts it to grey. The fast version
+//averages every 2x2 block instead of the gaussian pyramid and does both in
+//a single pass over the frame, without the intermediate RGB image.
+void
+MotionCells::downscaleToGrey (IplImage * p_frame, IplImage * p_grey,
+    bool p_fastdownscale)
+{
+  if (!p_fastdownscale) {
+    cvPyrDown (p_frame, m_pdownImage);
+    cvCvtColor (m_pdownImage, p_grey, CV_RGB2GRAY);
+    return;
+  }
+
+  for (int i = 0; i < p_grey->height; i++) {
+    const uchar *src0 =
+        (const uchar *) p_frame->imageData + p_frame->widthStep * 2 * i;
+    const uchar *src1 = src0 + p_frame->widthStep;
+    uchar *dst = (uchar *) p_grey->imageData + p_grey->widthStep * i;
+
+    for (int j = 0; j < p_grey->width; j++, src0 += 6, src1 += 6) {
+      int r = src0[0] + src0[3] + src1[0] + src1[3];
+      int g = src0[1] + src0[4] + src1[1] + src1[4];
+      int b = src0[2] + src0[5] + src1[2] + src1[5];
+
+      //CV_RGB2GRAY weights in 14 bits fixed point, plus 2 bits for the sum
+      dst[j] = (r * 4899 + g * 9617 + b * 1868 + (1 << 15)) >> 16;
+    }
+  }
+}
+
+void
+MotionCells::setPrevFrame (IplImage * p_prevframe, bool p_fastdownscale)
+{
+  if (!m_pprevgreyImage
+      || m_pprevgreyImage->width != p_prevframe->width / 2
+      || m_pprevgreyImage->height != p_prevframe->height / 2)
+    allocateImages (p_prevframe);
+  downscaleToGrey (p_prevframe, m_pprevgreyImage, p_fastdownscale);
+}
+
 int
 MotionCells::performDetectionMotionCells (IplImage * p_frame,
     double p_sensitivity, double p_framerate, int p_gridx, int p_gridy,
@@ -137,7 +208,7 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
     int motionmaskcells_count, motioncellidx * motionmaskcellsidx,
     cellscolor motioncellscolor, int motioncells_count,
     motioncellidx * motioncellsidx, gint64 starttime, char *p_datafile,
-    bool p_changed_datafile, int p_thickness)
+    bool p_changed_datafile, int p_thickness, bool p_fastdownscale)
 {
 
   int sumframecnt = 0;
@@ -160,26 +231,15 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
         return ret;
     }
 
-    m_frameSize = cvGetSize (p_frame);
-    m_frameSize.width /= 2;
-    m_frameSize.height /= 2;
+    //new frame size, there is nothing to compare this frame with yet
+    if (!m_pcurgreyImage || m_pcurgreyImage->width != p_frame->width / 2
+        || m_pcurgreyImage->height != p_frame->height / 2)
+      setPrevFrame (p_frame, p_fastdownscale);
+
     setMotionCells (m_frameSize.width, m_frameSize.height);
     m_sensitivity = 1 - p_sensitivity;
     m_isVisible = p_isVisible;
-    m_pcurFrame = cvCloneImage (p_frame);
-    IplImage *m_pcurgreyImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
-    IplImage *m_pprevgreyImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
-    IplImage *m_pgreyImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
-    IplImage *m_pcurDown =
-        cvCreateImage (m_frameSize, m_pcurFrame->depth, m_pcurFrame->nChannels);
-    IplImage *m_pprevDown = cvCreateImage (m_frameSize, m_pprevFrame->depth,
-        m_pprevFrame->nChannels);
-    m_pbwImage = cvCreateImage (m_frameSize, IPL_DEPTH_8U, 1);
-    cvPyrDown (m_pprevFrame, m_pprevDown);
-    cvCvtColor (m_pprevDown, m_pprevgreyImage, CV_RGB2GRAY);
-    cvPyrDown (m_pcurFrame, m_pcurDown);
-    cvCvtColor (m_pcurDown, m_pcurgreyImage, CV_RGB2GRAY);
-    m_pdifferenceImage = cvCloneImage (m_pcurgreyImage);
+    downscaleToGrey (p_frame, m_pcurgreyImage, p_fastdownscale);
     //cvSmooth(m_pcurgreyImage, m_pcurgreyImage, CV_GAUSSIAN, 3, 0);//TODO camera noise reduce,something smoothing, and rethink runningavg weights
 
     //Minus the current gray frame from the 8U moving average.
@@ -202,14 +262,11 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
       GST_DEBUG ("DETECT MOTION \n");
       if (m_MotionCells.size () > 0)    //it contains previous motioncells what we used when frames dropped
         m_MotionCells.clear ();
-      if (transparencyimg)
-        cvReleaseImage (&transparencyimg);
       (motioncells_count > 0) ?
           calculateMotionPercentInMotionCells (motioncellsidx,
           motioncells_count)
           : calculateMotionPercentInMotionCells (motionmaskcellsidx, 0);
 
-      transparencyimg = cvCreateImage (cvGetSize (p_frame), p_frame->depth, 3);
       cvSetZero (transparencyimg);
       if (m_motioncellsidxcstr)
         delete[]m_motioncellsidxcstr;
@@ -271,42 +328,17 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
       m_motioncells_idx_count = 0;
       if (m_MotionCells.size () > 0)
         m_MotionCells.clear ();
-      if (transparencyimg)
-        cvReleaseImage (&transparencyimg);
     }
 
-    if (m_pprevFrame)
-      cvReleaseImage (&m_pprevFrame);
-    m_pprevFrame = cvCloneImage (m_pcurFrame);
+    //the current grey image is the previous one of the next frame
+    IplImage *tmp = m_pprevgreyImage;
+    m_pprevgreyImage = m_pcurgreyImage;
+    m_pcurgreyImage = tmp;
     m_framecnt = 0;
-    if (m_pcurFrame)
-      cvReleaseImage (&m_pcurFrame);
-    if (m_pdifferenceImage)
-      cvReleaseImage (&m_pdifferenceImage);
-    if (m_pcurgreyImage)
-      cvReleaseImage (&m_pcurgreyImage);
-    if (m_pprevgreyImage)
-      cvReleaseImage (&m_pprevgreyImage);
-    if (m_pgreyImage)
-      cvReleaseImage (&m_pgreyImage);
-    if (m_pbwImage)
-      cvReleaseImage (&m_pbwImage);
-    if (m_pprevDown)
-      cvReleaseImage (&m_pprevDown);
-    if (m_pcurDown)
-      cvReleaseImage (&m_pcurDown);
-    if (m_pCells) {
-      for (int i = 0; i < m_gridy; ++i) {
-        delete[]m_pCells[i];
-      }
-      delete[]m_pCells;
-    }
 
     if (p_framerate <= 5) {
       if (m_MotionCells.size () > 0)
         m_MotionCells.clear ();
-      if (transparencyimg)
-        cvReleaseImage (&transparencyimg);
     }
   } else {                      //we do frame drop
     m_motioncells_idx_count = 0;
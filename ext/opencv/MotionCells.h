@@ -140,12 +140,10 @@ public:
       motionmaskcoordrect * motionmaskcoords, int motionmaskcells_count,
       motioncellidx * motionmaskcellsidx, cellscolor motioncellscolor,
       int motioncells_count, motioncellidx * motioncellsidx, gint64 starttime,
-      char *datafile, bool p_changed_datafile, int p_thickness);
+      char *datafile, bool p_changed_datafile, int p_thickness,
+      bool p_fastdownscale);
 
-  void setPrevFrame (IplImage * p_prevframe)
-  {
-    m_pprevFrame = cvCloneImage (p_prevframe);
-  }
+  void setPrevFrame (IplImage * p_prevframe, bool p_fastdownscale);
   char *getMotionCellsIdx ()
   {
     return m_motioncellsidxcstr;
@@ -204,6 +202,10 @@ private:
   int initDataFile (char *p_datafile, gint64 starttime);
   void blendImages (IplImage * p_actFrame, IplImage * p_cellsFrame,
       float p_alpha, float p_beta);
+  void allocateImages (IplImage * p_frame);
+  void releaseImages ();
+  void downscaleToGrey (IplImage * p_frame, IplImage * p_grey,
+      bool p_fastdownscale);
 
   void setData (IplImage * img, int lin, int col, uchar valor)
   {
@@ -225,13 +227,30 @@ private:
     return false;
   }
 
+  void freeMotionCells ()
+  {
+    if (m_pCells) {
+      for (int i = 0; i < m_cellsgridy; ++i)
+        delete[]m_pCells[i];
+      delete[]m_pCells;
+      m_pCells = NULL;
+    }
+  }
+
   void setMotionCells (int p_frameWidth, int p_frameHeight)
   {
     m_cellwidth = (double) p_frameWidth / (double) m_gridx;
     m_cellheight = (double) p_frameHeight / (double) m_gridy;
-    m_pCells = new Cell *[m_gridy];
-    for (int i = 0; i < m_gridy; i++)
-      m_pCells[i] = new Cell[m_gridx];
+
+    //the cells are only reallocated when the grid changes
+    if (!m_pCells || m_cellsgridx != m_gridx || m_cellsgridy != m_gridy) {
+      freeMotionCells ();
+      m_pCells = new Cell *[m_gridy];
+      for (int i = 0; i < m_gridy; i++)
+        m_pCells[i] = new Cell[m_gridx];
+      m_cellsgridx = m_gridx;
+      m_cellsgridy = m_gridy;
+    }
 
     //init cells
     for (int i = 0; i < m_gridy; i++)
@@ -243,14 +262,16 @@ private:
       }
   }
 
-  IplImage *m_pcurFrame, *m_pprevFrame, *m_pdifferenceImage,
-      *m_pbwImage,*transparencyimg;
+  //kept between frames, only reallocated when the frame size changes. The
+  //grey images are swapped after every processed frame.
+  IplImage *m_pcurgreyImage, *m_pprevgreyImage, *m_pdownImage,
+      *m_pdifferenceImage, *m_pbwImage, *transparencyimg;
   CvSize m_frameSize;
   bool m_isVisible, m_changed_datafile, m_useAlpha, m_saveInDatafile;
   Cell **m_pCells;
   vector < MotionCellsIdx > m_MotionCells;
   vector < OverlayRegions > m_OverlayRegions;
-  int m_gridx, m_gridy;
+  int m_gridx, m_gridy, m_cellsgridx, m_cellsgridy;
   double m_cellwidth, m_cellheight;
   double m_alpha, m_beta;
   double m_thresholdBoundingboxArea, m_cellArea, m_sensitivity;
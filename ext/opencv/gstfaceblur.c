@@ -48,6 +48,10 @@
  *
  * Blurs faces in images and videos.
  *
+ * With GstFaceBlur::async-detection the faces are detected in a separate
+ * thread, at most GstFaceBlur::detection-rate times per second, and every
+ * frame is blurred where the most recent detection found faces.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -70,6 +74,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_face_blur_debug);
 
 #define HAAR_CASCADES_DIR OPENCV_PREFIX "/share/opencv/haarcascades/"
 #define DEFAULT_PROFILE HAAR_CASCADES_DIR "haarcascade_frontalface_default.xml"
+#define DEFAULT_ASYNC_DETECTION FALSE
+#define DEFAULT_DETECTION_RATE 5.0
+#define DEFAULT_DETECTION_SCALE 1.0
+#define DEFAULT_EXTRAPOLATE FALSE
+#define MIN_FACE_SIZE 30
 
 /* Filter signals and args */
 enum
@@ -81,7 +90,11 @@ enum
 enum
 {
   PROP_0,
-  PROP_PROFILE
+  PROP_PROFILE,
+  PROP_ASYNC_DETECTION,
+  PROP_DETECTION_RATE,
+  PROP_DETECTION_SCALE,
+  PROP_EXTRAPOLATE
 };
 
 /* the capabilities of the inputs and outputs.
@@ -109,6 +122,8 @@ static gboolean gst_face_blur_handle_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
 static GstFlowReturn gst_face_blur_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buf);
+static GstStateChangeReturn gst_face_blur_change_state (GstElement * element,
+    GstStateChange transition);
 
 static void gst_face_blur_load_profile (GstFaceBlur * filter);
 
@@ -118,10 +133,21 @@ gst_face_blur_finalize (GObject * obj)
 {
   GstFaceBlur *filter = GST_FACE_BLUR (obj);
 
-  if (filter->cvImage) {
-    cvReleaseImage (&filter->cvImage);
+  if (filter->worker)
+    gst_opencv_detect_worker_free (filter->worker);
+  g_array_free (filter->faces, TRUE);
+  g_mutex_clear (&filter->detect_lock);
+
+  if (filter->cvImage)
+    cvReleaseImageHeader (&filter->cvImage);
+  if (filter->cvGray)
     cvReleaseImage (&filter->cvGray);
-  }
+  if (filter->cvSmall)
+    cvReleaseImage (&filter->cvSmall);
+  if (filter->cvStorage)
+    cvReleaseMemStorage (&filter->cvStorage);
+  if (filter->cvCascade)
+    cvReleaseHaarClassifierCascade (&filter->cvCascade);
 
   g_free (filter->profile);
 
@@ -142,10 +168,32 @@ gst_face_blur_class_init (GstFaceBlurClass * klass)
   gobject_class->set_property = gst_face_blur_set_property;
   gobject_class->get_property = gst_face_blur_get_property;
 
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_face_blur_change_state);
+
   g_object_class_install_property (gobject_class, PROP_PROFILE,
       g_param_spec_string ("profile", "Profile",
           "Location of Haar cascade file to use for face blurion",
           DEFAULT_PROFILE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_ASYNC_DETECTION,
+      g_param_spec_boolean ("async-detection", "Asynchronous detection",
+          "Run the detection in a separate thread and blur the frames with "
+          "the most recent results", DEFAULT_ASYNC_DETECTION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_RATE,
+      g_param_spec_double ("detection-rate", "Detection rate",
+          "Maximum number of detections per second in asynchronous mode "
+          "(0 = as often as possible)", 0.0, G_MAXDOUBLE,
+          DEFAULT_DETECTION_RATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_SCALE,
+      g_param_spec_double ("detection-scale", "Detection scale",
+          "Factor by which the frame is scaled down before detection",
+          0.05, 1.0, DEFAULT_DETECTION_SCALE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_EXTRAPOLATE,
+      g_param_spec_boolean ("extrapolate", "Extrapolate",
+          "Move the results of asynchronous detection along the motion "
+          "between the last two detections", DEFAULT_EXTRAPOLATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (element_class,
       "faceblur",
@@ -180,6 +228,12 @@ gst_face_blur_init (GstFaceBlur * filter)
   gst_element_add_pad (GST_ELEMENT (filter), filter->sinkpad);
   gst_element_add_pad (GST_ELEMENT (filter), filter->srcpad);
   filter->profile = g_strdup (DEFAULT_PROFILE);
+  filter->async_detection = DEFAULT_ASYNC_DETECTION;
+  filter->detection_rate = DEFAULT_DETECTION_RATE;
+  filter->detection_scale = DEFAULT_DETECTION_SCALE;
+  filter->extrapolate = DEFAULT_EXTRAPOLATE;
+  g_mutex_init (&filter->detect_lock);
+  filter->faces = g_array_new (FALSE, FALSE, sizeof (CvRect));
   gst_face_blur_load_profile (filter);
 }
 
@@ -195,6 +249,18 @@ gst_face_blur_set_property (GObject * object, guint prop_id,
       filter->profile = g_value_dup_string (value);
       gst_face_blur_load_profile (filter);
       break;
+    case PROP_ASYNC_DETECTION:
+      filter->async_detection = g_value_get_boolean (value);
+      break;
+    case PROP_DETECTION_RATE:
+      filter->detection_rate = g_value_get_double (value);
+      break;
+    case PROP_DETECTION_SCALE:
+      filter->detection_scale = g_value_get_double (value);
+      break;
+    case PROP_EXTRAPOLATE:
+      filter->extrapolate = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -211,6 +277,18 @@ gst_face_blur_get_property (GObject * object, guint prop_id,
     case PROP_PROFILE:
       g_value_set_string (value, filter->profile);
       break;
+    case PROP_ASYNC_DETECTION:
+      g_value_set_boolean (value, filter->async_detection);
+      break;
+    case PROP_DETECTION_RATE:
+      g_value_set_double (value, filter->detection_rate);
+      break;
+    case PROP_DETECTION_SCALE:
+      g_value_set_double (value, filter->detection_scale);
+      break;
+    case PROP_EXTRAPOLATE:
+      g_value_set_boolean (value, filter->extrapolate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -241,9 +319,24 @@ gst_face_blur_handle_sink_event (GstPad * pad, GstObject * parent,
       gst_structure_get_int (structure, "width", &width);
       gst_structure_get_int (structure, "height", &height);
 
-      filter->cvImage = cvCreateImage (cvSize (width, height), IPL_DEPTH_8U, 3);
-      filter->cvGray = cvCreateImage (cvSize (width, height), IPL_DEPTH_8U, 1);
-      filter->cvStorage = cvCreateMemStorage (0);
+      /* only a header, the data is the mapped buffer. The grey images are
+       * (re)allocated at the detection size when used */
+      if (filter->cvImage)
+        cvReleaseImageHeader (&filter->cvImage);
+      filter->cvImage =
+          cvCreateImageHeader (cvSize (width, height), IPL_DEPTH_8U, 3);
+      g_mutex_lock (&filter->detect_lock);
+      if (!filter->cvStorage)
+        filter->cvStorage = cvCreateMemStorage (0);
+      g_mutex_unlock (&filter->detect_lock);
+      if (filter->worker)
+        gst_opencv_detect_worker_reset (filter->worker);
+      break;
+    }
+    case GST_EVENT_FLUSH_STOP:
+    {
+      if (filter->worker)
+        gst_opencv_detect_worker_reset (filter->worker);
       break;
     }
     default:
@@ -255,6 +348,48 @@ gst_face_blur_handle_sink_event (GstPad * pad, GstObject * parent,
   return res;
 }
 
+/* Detects the faces on @grey, which is the frame scaled by @scale, and
+ * appends them in full size frame coordinates to @results. Called from the
+ * streaming thread or from the detection thread. */
+static void
+gst_face_blur_detect (IplImage * grey, gdouble scale, GArray * results,
+    gconstpointer params, gpointer user_data)
+{
+  GstFaceBlur *filter = GST_FACE_BLUR (user_data);
+  gint min_size = cvRound (MIN_FACE_SIZE * scale);
+  CvSeq *faces;
+  int i;
+
+  g_mutex_lock (&filter->detect_lock);
+  if (!filter->cvCascade || !filter->cvStorage)
+    goto done;
+
+  cvClearMemStorage (filter->cvStorage);
+
+  faces =
+      cvHaarDetectObjects (grey, filter->cvCascade,
+      filter->cvStorage, 1.1, 2, 0, cvSize (min_size, min_size)
+#if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
+      , cvSize (min_size + 2, min_size + 2)
+#endif
+      );
+
+  for (i = 0; i < (faces ? faces->total : 0); i++) {
+    CvRect r = *(CvRect *) cvGetSeqElem (faces, i);
+
+    if (scale != 1.0) {
+      r.x = cvRound (r.x / scale);
+      r.y = cvRound (r.y / scale);
+      r.width = cvRound (r.width / scale);
+      r.height = cvRound (r.height / scale);
+    }
+    g_array_append_val (results, r);
+  }
+
+done:
+  g_mutex_unlock (&filter->detect_lock);
+}
+
 /* chain function
  * this function does the actual processing
  */
@@ -262,9 +397,8 @@ static GstFlowReturn
 gst_face_blur_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstFaceBlur *filter;
-  CvSeq *faces;
   GstMapInfo info;
-  int i;
+  guint i;
 
   filter = GST_FACE_BLUR (GST_OBJECT_PARENT (pad));
 
@@ -272,44 +406,76 @@ gst_face_blur_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   gst_buffer_map (buf, &info, GST_MAP_READWRITE);
   filter->cvImage->imageData = (char *) info.data;
 
-  cvCvtColor (filter->cvImage, filter->cvGray, CV_RGB2GRAY);
-  cvClearMemStorage (filter->cvStorage);
-
-  if (filter->cvCascade) {
-    faces =
-        cvHaarDetectObjects (filter->cvGray, filter->cvCascade,
-        filter->cvStorage, 1.1, 2, 0, cvSize (30, 30)
-#if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
-        , cvSize (32, 32)
-#endif
-        );
+  if (filter->async_detection) {
+    /* never wait for the detection, blur where the latest one found faces */
+    if (!filter->worker)
+      filter->worker = gst_opencv_detect_worker_new ("faceblur",
+          sizeof (CvRect), 0, gst_face_blur_detect, filter);
+    gst_opencv_detect_worker_set_params (filter->worker,
+        filter->detection_scale, filter->detection_rate);
+    gst_opencv_detect_worker_push (filter->worker, filter->cvImage,
+        GST_BUFFER_TIMESTAMP (buf), NULL);
+    gst_opencv_detect_worker_get_results (filter->worker, filter->faces,
+        GST_BUFFER_TIMESTAMP (buf), filter->extrapolate);
+  } else {
+    gst_opencv_detect_downscale_grey (filter->cvImage, filter->detection_scale,
+        &filter->cvSmall, &filter->cvGray);
+    g_array_set_size (filter->faces, 0);
+    gst_face_blur_detect (filter->cvGray, filter->detection_scale,
+        filter->faces, NULL, filter);
+  }
 
-    if (faces && faces->total > 0) {
-      buf = gst_buffer_make_writable (buf);
-    }
-    for (i = 0; i < (faces ? faces->total : 0); i++) {
-      CvRect *r = (CvRect *) cvGetSeqElem (faces, i);
-      cvSetImageROI (filter->cvImage, *r);
-      cvSmooth (filter->cvImage, filter->cvImage, CV_BLUR, 11, 11, 0, 0);
-      cvSmooth (filter->cvImage, filter->cvImage, CV_GAUSSIAN, 11, 11, 0, 0);
-      cvResetImageROI (filter->cvImage);
-    }
+  for (i = 0; i < filter->faces->len; i++) {
+    CvRect *r = &g_array_index (filter->faces, CvRect, i);
+    cvSetImageROI (filter->cvImage, *r);
+    cvSmooth (filter->cvImage, filter->cvImage, CV_BLUR, 11, 11, 0, 0);
+    cvSmooth (filter->cvImage, filter->cvImage, CV_GAUSSIAN, 11, 11, 0, 0);
+    cvResetImageROI (filter->cvImage);
   }
 
+  gst_buffer_unmap (buf, &info);
+
   /* these filters operate in place, so we push the same buffer */
 
   return gst_pad_push (filter->srcpad, buf);
 }
 
+static GstStateChangeReturn
+gst_face_blur_change_state (GstElement * element, GstStateChange transition)
+{
+  GstFaceBlur *filter = GST_FACE_BLUR (element);
+  GstStateChangeReturn ret;
+
+  ret = GST_ELEMENT_CLASS (gst_face_blur_parent_class)->change_state (element,
+      transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      if (filter->worker) {
+        gst_opencv_detect_worker_free (filter->worker);
+        filter->worker = NULL;
+      }
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 
 static void
 gst_face_blur_load_profile (GstFaceBlur * filter)
 {
+  g_mutex_lock (&filter->detect_lock);
+  if (filter->cvCascade)
+    cvReleaseHaarClassifierCascade (&filter->cvCascade);
   filter->cvCascade =
       (CvHaarClassifierCascade *) cvLoad (filter->profile, 0, 0, 0);
   if (!filter->cvCascade) {
     GST_WARNING ("Couldn't load Haar classifier cascade: %s.", filter->profile);
   }
+  g_mutex_unlock (&filter->detect_lock);
 }
 
 
@@ -48,6 +48,7 @@
 
 #include <gst/gst.h>
 #include <cv.h>
+#include "gstopencvdetectworker.h"
 
 #if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
 #include <opencv2/objdetect/objdetect.hpp>
@@ -77,8 +78,17 @@ struct _GstFaceBlur
   gboolean display;
 
   gchar *profile;
+  gboolean async_detection;
+  gdouble detection_rate;
+  gdouble detection_scale;
+  gboolean extrapolate;
 
-  IplImage *cvImage, *cvGray;
+  /* protects the cascade and the storage */
+  GMutex detect_lock;
+  GstOpencvDetectWorker *worker;
+  GArray *faces;
+
+  IplImage *cvImage, *cvGray, *cvSmall;
   CvHaarClassifierCascade *cvCascade;
   CvMemStorage *cvStorage;
 };
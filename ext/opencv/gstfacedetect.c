@@ -53,6 +53,13 @@
  * until the size is &lt;= GstFaceDetect::min-size-width or 
  * GstFaceDetect::min-size-height. 
  *
+ * With GstFaceDetect::async-detection the detection runs in a separate
+ * thread on frames scaled by GstFaceDetect::detection-scale, at most
+ * GstFaceDetect::detection-rate times per second. Frames are not held
+ * back by the detection, each frame gets the results of the most recent
+ * detection, optionally moved along the motion between the last two
+ * detections with GstFaceDetect::extrapolate.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -93,6 +100,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_face_detect_debug);
 #define DEFAULT_MIN_NEIGHBORS 3
 #define DEFAULT_MIN_SIZE_WIDTH 0
 #define DEFAULT_MIN_SIZE_HEIGHT 0
+#define DEFAULT_ASYNC_DETECTION FALSE
+#define DEFAULT_DETECTION_RATE 5.0
+#define DEFAULT_DETECTION_SCALE 1.0
+#define DEFAULT_EXTRAPOLATE FALSE
 
 /* Filter signals and args */
 enum
@@ -114,9 +125,34 @@ enum
   PROP_FLAGS,
   PROP_MIN_SIZE_WIDTH,
   PROP_MIN_SIZE_HEIGHT,
-  PROP_UPDATES
+  PROP_UPDATES,
+  PROP_ASYNC_DETECTION,
+  PROP_DETECTION_RATE,
+  PROP_DETECTION_SCALE,
+  PROP_EXTRAPOLATE
 };
 
+/* a detected face, the features are relative to the face and have a width
+ * of 0 if they were not found */
+typedef struct
+{
+  CvRect face;
+  CvRect nose;
+  CvRect mouth;
+  CvRect eyes;
+} GstFaceDetectFace;
+
+/* the cascade parameters, copied under the object lock for every
+ * detection so that the detection thread never reads the properties */
+typedef struct
+{
+  gdouble scale_factor;
+  gint min_neighbors;
+  gint flags;
+  gint min_size_width;
+  gint min_size_height;
+} GstFaceDetectParams;
+
 
 /*
  * GstOpencvFaceDetectFlags:
@@ -203,6 +239,9 @@ static gboolean gst_face_detect_set_caps (GstOpencvVideoFilter * transform,
     gint out_width, gint out_height, gint out_depth, gint out_channels);
 static GstFlowReturn gst_face_detect_transform_ip (GstOpencvVideoFilter * base,
     GstBuffer * buf, IplImage * img);
+static gboolean gst_face_detect_stop (GstBaseTransform * trans);
+static gboolean gst_face_detect_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
 
 static CvHaarClassifierCascade *gst_face_detect_load_profile (GstFaceDetect *
     filter, gchar * profile);
@@ -213,8 +252,15 @@ gst_face_detect_finalize (GObject * obj)
 {
   GstFaceDetect *filter = GST_FACE_DETECT (obj);
 
+  if (filter->worker)
+    gst_opencv_detect_worker_free (filter->worker);
+  g_array_free (filter->faces, TRUE);
+  g_mutex_clear (&filter->detect_lock);
+
   if (filter->cvGray)
     cvReleaseImage (&filter->cvGray);
+  if (filter->cvSmall)
+    cvReleaseImage (&filter->cvSmall);
   if (filter->cvStorage)
     cvReleaseMemStorage (&filter->cvStorage);
 
@@ -240,10 +286,12 @@ static void
 gst_face_detect_class_init (GstFaceDetectClass * klass)
 {
   GObjectClass *gobject_class;
+  GstBaseTransformClass *basetrans_class;
   GstOpencvVideoFilterClass *gstopencvbasefilter_class;
 
   GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
   gobject_class = (GObjectClass *) klass;
+  basetrans_class = (GstBaseTransformClass *) klass;
   gstopencvbasefilter_class = (GstOpencvVideoFilterClass *) klass;
 
   gobject_class->finalize = GST_DEBUG_FUNCPTR (gst_face_detect_finalize);
@@ -253,6 +301,9 @@ gst_face_detect_class_init (GstFaceDetectClass * klass)
   gstopencvbasefilter_class->cv_trans_ip_func = gst_face_detect_transform_ip;
   gstopencvbasefilter_class->cv_set_caps = gst_face_detect_set_caps;
 
+  basetrans_class->stop = GST_DEBUG_FUNCPTR (gst_face_detect_stop);
+  basetrans_class->sink_event = GST_DEBUG_FUNCPTR (gst_face_detect_sink_event);
+
   g_object_class_install_property (gobject_class, PROP_DISPLAY,
       g_param_spec_boolean ("display", "Display",
           "Sets whether the detected faces should be highlighted in the output",
@@ -302,6 +353,26 @@ gst_face_detect_class_init (GstFaceDetectClass * klass)
           "When send update bus messages, if at all",
           GST_TYPE_FACE_DETECT_UPDATES, GST_FACEDETECT_UPDATES_EVERY_FRAME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_ASYNC_DETECTION,
+      g_param_spec_boolean ("async-detection", "Asynchronous detection",
+          "Run the detection in a separate thread and pass frames through "
+          "with the most recent results", DEFAULT_ASYNC_DETECTION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_RATE,
+      g_param_spec_double ("detection-rate", "Detection rate",
+          "Maximum number of detections per second in asynchronous mode "
+          "(0 = as often as possible)", 0.0, G_MAXDOUBLE,
+          DEFAULT_DETECTION_RATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_SCALE,
+      g_param_spec_double ("detection-scale", "Detection scale",
+          "Factor by which the frame is scaled down before detection",
+          0.05, 1.0, DEFAULT_DETECTION_SCALE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_EXTRAPOLATE,
+      g_param_spec_boolean ("extrapolate", "Extrapolate",
+          "Move the results of asynchronous detection along the motion "
+          "between the last two detections", DEFAULT_EXTRAPOLATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (element_class,
       "facedetect",
@@ -332,6 +403,12 @@ gst_face_detect_init (GstFaceDetect * filter)
   filter->flags = DEFAULT_FLAGS;
   filter->min_size_width = DEFAULT_MIN_SIZE_WIDTH;
   filter->min_size_height = DEFAULT_MIN_SIZE_HEIGHT;
+  filter->async_detection = DEFAULT_ASYNC_DETECTION;
+  filter->detection_rate = DEFAULT_DETECTION_RATE;
+  filter->detection_scale = DEFAULT_DETECTION_SCALE;
+  filter->extrapolate = DEFAULT_EXTRAPOLATE;
+  g_mutex_init (&filter->detect_lock);
+  filter->faces = g_array_new (FALSE, FALSE, sizeof (GstFaceDetectFace));
   filter->cvFaceDetect =
       gst_face_detect_load_profile (filter, filter->face_profile);
   filter->cvNoseDetect =
@@ -354,58 +431,88 @@ gst_face_detect_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_FACE_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->face_profile);
       if (filter->cvFaceDetect)
         cvReleaseHaarClassifierCascade (&filter->cvFaceDetect);
       filter->face_profile = g_value_dup_string (value);
       filter->cvFaceDetect =
           gst_face_detect_load_profile (filter, filter->face_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_NOSE_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->nose_profile);
       if (filter->cvNoseDetect)
         cvReleaseHaarClassifierCascade (&filter->cvNoseDetect);
       filter->nose_profile = g_value_dup_string (value);
       filter->cvNoseDetect =
           gst_face_detect_load_profile (filter, filter->nose_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_MOUTH_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->mouth_profile);
       if (filter->cvMouthDetect)
         cvReleaseHaarClassifierCascade (&filter->cvMouthDetect);
       filter->mouth_profile = g_value_dup_string (value);
       filter->cvMouthDetect =
           gst_face_detect_load_profile (filter, filter->mouth_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_EYES_PROFILE:
+      g_mutex_lock (&filter->detect_lock);
       g_free (filter->eyes_profile);
       if (filter->cvEyesDetect)
         cvReleaseHaarClassifierCascade (&filter->cvEyesDetect);
       filter->eyes_profile = g_value_dup_string (value);
       filter->cvEyesDetect =
           gst_face_detect_load_profile (filter, filter->eyes_profile);
+      g_mutex_unlock (&filter->detect_lock);
       break;
     case PROP_DISPLAY:
       filter->display = g_value_get_boolean (value);
       break;
     case PROP_SCALE_FACTOR:
+      GST_OBJECT_LOCK (filter);
       filter->scale_factor = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_MIN_NEIGHBORS:
+      GST_OBJECT_LOCK (filter);
       filter->min_neighbors = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_MIN_SIZE_WIDTH:
+      GST_OBJECT_LOCK (filter);
       filter->min_size_width = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_MIN_SIZE_HEIGHT:
+      GST_OBJECT_LOCK (filter);
       filter->min_size_height = g_value_get_int (value);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_FLAGS:
+      GST_OBJECT_LOCK (filter);
       filter->flags = g_value_get_flags (value);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_UPDATES:
       filter->updates = g_value_get_enum (value);
       break;
+    case PROP_ASYNC_DETECTION:
+      filter->async_detection = g_value_get_boolean (value);
+      break;
+    case PROP_DETECTION_RATE:
+      filter->detection_rate = g_value_get_double (value);
+      break;
+    case PROP_DETECTION_SCALE:
+      filter->detection_scale = g_value_get_double (value);
+      break;
+    case PROP_EXTRAPOLATE:
+      filter->extrapolate = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -435,23 +542,45 @@ gst_face_detect_get_property (GObject * object, guint prop_id,
       g_value_set_boolean (value, filter->display);
       break;
     case PROP_SCALE_FACTOR:
+      GST_OBJECT_LOCK (filter);
       g_value_set_double (value, filter->scale_factor);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_MIN_NEIGHBORS:
+      GST_OBJECT_LOCK (filter);
       g_value_set_int (value, filter->min_neighbors);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_MIN_SIZE_WIDTH:
+      GST_OBJECT_LOCK (filter);
       g_value_set_int (value, filter->min_size_width);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_MIN_SIZE_HEIGHT:
+      GST_OBJECT_LOCK (filter);
       g_value_set_int (value, filter->min_size_height);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_FLAGS:
+      GST_OBJECT_LOCK (filter);
       g_value_set_flags (value, filter->flags);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_UPDATES:
       g_value_set_enum (value, filter->updates);
       break;
+    case PROP_ASYNC_DETECTION:
+      g_value_set_boolean (value, filter->async_detection);
+      break;
+    case PROP_DETECTION_RATE:
+      g_value_set_double (value, filter->detection_rate);
+      break;
+    case PROP_DETECTION_SCALE:
+      g_value_set_double (value, filter->detection_scale);
+      break;
+    case PROP_EXTRAPOLATE:
+      g_value_set_boolean (value, filter->extrapolate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -470,22 +599,52 @@ gst_face_detect_set_caps (GstOpencvVideoFilter * transform, gint in_width,
 
   filter = GST_FACE_DETECT (transform);
 
-  if (filter->cvGray)
-    cvReleaseImage (&filter->cvGray);
-
-  filter->cvGray = cvCreateImage (cvSize (in_width, in_height), IPL_DEPTH_8U,
-      1);
-
+  /* the grey images are (re)allocated at the detection size when used */
+  g_mutex_lock (&filter->detect_lock);
   if (!filter->cvStorage)
     filter->cvStorage = cvCreateMemStorage (0);
   else
     cvClearMemStorage (filter->cvStorage);
+  g_mutex_unlock (&filter->detect_lock);
+
+  if (filter->worker)
+    gst_opencv_detect_worker_reset (filter->worker);
+
+  return TRUE;
+}
+
+static gboolean
+gst_face_detect_stop (GstBaseTransform * trans)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (trans);
+
+  if (filter->worker) {
+    gst_opencv_detect_worker_free (filter->worker);
+    filter->worker = NULL;
+  }
+
+  if (GST_BASE_TRANSFORM_CLASS (gst_face_detect_parent_class)->stop)
+    return GST_BASE_TRANSFORM_CLASS (gst_face_detect_parent_class)->stop
+        (trans);
 
   return TRUE;
 }
 
+static gboolean
+gst_face_detect_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP && filter->worker)
+    gst_opencv_detect_worker_reset (filter->worker);
+
+  return GST_BASE_TRANSFORM_CLASS (gst_face_detect_parent_class)->sink_event
+      (trans, event);
+}
+
 static GstMessage *
-gst_face_detect_message_new (GstFaceDetect * filter, GstBuffer * buf)
+gst_face_detect_message_new (GstFaceDetect * filter, GstBuffer * buf,
+    GstClockTime detection_ts)
 {
   GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (filter);
   GstStructure *s;
@@ -500,26 +659,133 @@ gst_face_detect_message_new (GstFaceDetect * filter, GstBuffer * buf)
       "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (buf),
       "stream-time", G_TYPE_UINT64, stream_time,
       "running-time", G_TYPE_UINT64, running_time,
-      "duration", G_TYPE_UINT64, GST_BUFFER_DURATION (buf), NULL);
+      "duration", G_TYPE_UINT64, GST_BUFFER_DURATION (buf),
+      "detection-timestamp", G_TYPE_UINT64, detection_ts, NULL);
 
   return gst_message_new_element (GST_OBJECT (filter), s);
 }
 
+static void
+gst_face_detect_get_params (GstFaceDetect * filter,
+    GstFaceDetectParams * params)
+{
+  GST_OBJECT_LOCK (filter);
+  params->scale_factor = filter->scale_factor;
+  params->min_neighbors = filter->min_neighbors;
+  params->flags = filter->flags;
+  params->min_size_width = filter->min_size_width;
+  params->min_size_height = filter->min_size_height;
+  GST_OBJECT_UNLOCK (filter);
+}
+
 static CvSeq *
-gst_face_detect_run_detector (GstFaceDetect * filter,
-    CvHaarClassifierCascade * detector, gint min_size_width,
-    gint min_size_height)
+gst_face_detect_run_detector (GstFaceDetect * filter, IplImage * grey,
+    CvHaarClassifierCascade * detector, const GstFaceDetectParams * params,
+    gint min_size_width, gint min_size_height)
 {
-  return cvHaarDetectObjects (filter->cvGray, detector,
-      filter->cvStorage, filter->scale_factor, filter->min_neighbors,
-      filter->flags, cvSize (min_size_width, min_size_height)
+  return cvHaarDetectObjects (grey, detector,
+      filter->cvStorage, params->scale_factor, params->min_neighbors,
+      params->flags, cvSize (min_size_width, min_size_height)
 #if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
       , cvSize (min_size_width + 2, min_size_height + 2)
 #endif
       );
 }
 
-/* 
+/* runs @detector on the part @sub of the face @r and returns the first
+ * feature found, relative to the face, or a rectangle of width 0 */
+static CvRect
+gst_face_detect_run_feature_detector (GstFaceDetect * filter, IplImage * grey,
+    CvHaarClassifierCascade * detector, const GstFaceDetectParams * params,
+    CvRect * r, CvRect sub, gint min_size_width, gint min_size_height)
+{
+  CvRect feature = cvRect (0, 0, 0, 0);
+  CvSeq *seq;
+
+  cvSetImageROI (grey, cvRect (r->x + sub.x, r->y + sub.y, sub.width,
+          sub.height));
+  seq = gst_face_detect_run_detector (filter, grey, detector, params,
+      min_size_width, min_size_height);
+  if (seq && seq->total) {
+    CvRect *sr = (CvRect *) cvGetSeqElem (seq, 0);
+
+    feature = cvRect (sub.x + sr->x, sub.y + sr->y, sr->width, sr->height);
+  }
+  cvResetImageROI (grey);
+
+  return feature;
+}
+
+static void
+gst_face_detect_scale_rect (CvRect * r, gdouble scale)
+{
+  r->x = cvRound (r->x * scale);
+  r->y = cvRound (r->y * scale);
+  r->width = cvRound (r->width * scale);
+  r->height = cvRound (r->height * scale);
+}
+
+/* Runs the detectors with @params on @grey, which is the frame scaled by
+ * @scale, and appends the faces found in full size frame coordinates to
+ * @results. Called from the streaming thread or from the detection thread. */
+static void
+gst_face_detect_detect (IplImage * grey, gdouble scale, GArray * results,
+    gconstpointer params, gpointer user_data)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (user_data);
+  const GstFaceDetectParams *p = params;
+  gint min_size_width = p->min_size_width * scale;
+  gint min_size_height = p->min_size_height * scale;
+  CvSeq *faces;
+  gint i;
+
+  g_mutex_lock (&filter->detect_lock);
+  if (!filter->cvFaceDetect || !filter->cvStorage)
+    goto done;
+
+  cvClearMemStorage (filter->cvStorage);
+
+  faces = gst_face_detect_run_detector (filter, grey, filter->cvFaceDetect, p,
+      min_size_width, min_size_height);
+
+  for (i = 0; i < (faces ? faces->total : 0); i++) {
+    CvRect *r = (CvRect *) cvGetSeqElem (faces, i);
+    gint mw = min_size_width / 8;
+    gint mh = min_size_height / 8;
+    GstFaceDetectFace face = { {0,}, };
+
+    face.face = *r;
+
+    /* detect face features */
+
+    if (filter->cvNoseDetect)
+      face.nose = gst_face_detect_run_feature_detector (filter, grey,
+          filter->cvNoseDetect, p, r, cvRect (r->width / 4, r->height / 4,
+              r->width / 2, r->height / 2), mw, mh);
+    if (filter->cvMouthDetect)
+      face.mouth = gst_face_detect_run_feature_detector (filter, grey,
+          filter->cvMouthDetect, p, r, cvRect (0, r->height / 2, r->width,
+              r->height / 2), mw, mh);
+    if (filter->cvEyesDetect)
+      face.eyes = gst_face_detect_run_feature_detector (filter, grey,
+          filter->cvEyesDetect, p, r, cvRect (0, 0, r->width, r->height / 2),
+          mw, mh);
+
+    if (scale != 1.0) {
+      gst_face_detect_scale_rect (&face.face, 1.0 / scale);
+      gst_face_detect_scale_rect (&face.nose, 1.0 / scale);
+      gst_face_detect_scale_rect (&face.mouth, 1.0 / scale);
+      gst_face_detect_scale_rect (&face.eyes, 1.0 / scale);
+    }
+
+    g_array_append_val (results, face);
+  }
+
+done:
+  g_mutex_unlock (&filter->detect_lock);
+}
+
+/*
  * Performs the face detection
  */
 static GstFlowReturn
@@ -533,9 +799,9 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
     GstStructure *s;
     GValue facelist = { 0 };
     GValue facedata = { 0 };
-    CvSeq *faces;
-    CvSeq *mouth = NULL, *nose = NULL, *eyes = NULL;
-    gint i;
+    GstFaceDetectParams params;
+    GstClockTime detection_ts;
+    gint i, n_faces;
     gboolean do_display = FALSE;
     gboolean post_msg = FALSE;
 
@@ -547,18 +813,36 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
       }
     }
 
-    cvCvtColor (img, filter->cvGray, CV_RGB2GRAY);
-    cvClearMemStorage (filter->cvStorage);
-
-    faces = gst_face_detect_run_detector (filter, filter->cvFaceDetect,
-        filter->min_size_width, filter->min_size_height);
+    gst_face_detect_get_params (filter, &params);
+
+    if (filter->async_detection) {
+      /* never wait for the detection, use the latest results we have */
+      if (!filter->worker)
+        filter->worker = gst_opencv_detect_worker_new ("facedetect",
+            sizeof (GstFaceDetectFace), sizeof (GstFaceDetectParams),
+            gst_face_detect_detect, filter);
+      gst_opencv_detect_worker_set_params (filter->worker,
+          filter->detection_scale, filter->detection_rate);
+      gst_opencv_detect_worker_push (filter->worker, img,
+          GST_BUFFER_TIMESTAMP (buf), &params);
+      detection_ts = gst_opencv_detect_worker_get_results (filter->worker,
+          filter->faces, GST_BUFFER_TIMESTAMP (buf), filter->extrapolate);
+    } else {
+      gst_opencv_detect_downscale_grey (img, filter->detection_scale,
+          &filter->cvSmall, &filter->cvGray);
+      g_array_set_size (filter->faces, 0);
+      gst_face_detect_detect (filter->cvGray, filter->detection_scale,
+          filter->faces, &params, filter);
+      detection_ts = GST_BUFFER_TIMESTAMP (buf);
+    }
+    n_faces = filter->faces->len;
 
     switch (filter->updates) {
       case GST_FACEDETECT_UPDATES_EVERY_FRAME:
         post_msg = TRUE;
         break;
       case GST_FACEDETECT_UPDATES_ON_CHANGE:
-        if (faces && faces->total > 0) {
+        if (n_faces > 0) {
           post_msg = TRUE;
         } else {
           if (filter->face_detected) {
@@ -567,7 +851,7 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
         }
         break;
       case GST_FACEDETECT_UPDATES_ON_FACE:
-        if (faces && faces->total > 0) {
+        if (n_faces > 0) {
           post_msg = TRUE;
         } else {
           post_msg = FALSE;
@@ -581,70 +865,26 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
         break;
     }
 
-    filter->face_detected = faces ? faces->total > 0 : FALSE;
+    filter->face_detected = n_faces > 0;
 
     if (post_msg) {
-      msg = gst_face_detect_message_new (filter, buf);
+      msg = gst_face_detect_message_new (filter, buf, detection_ts);
       g_value_init (&facelist, GST_TYPE_LIST);
     }
 
-    for (i = 0; i < (faces ? faces->total : 0); i++) {
-      CvRect *r = (CvRect *) cvGetSeqElem (faces, i);
-      guint mw = filter->min_size_width / 8;
-      guint mh = filter->min_size_height / 8;
-      guint rnx = 0, rny = 0, rnw, rnh;
-      guint rmx = 0, rmy = 0, rmw, rmh;
-      guint rex = 0, rey = 0, rew, reh;
+    for (i = 0; i < n_faces; i++) {
+      GstFaceDetectFace *face =
+          &g_array_index (filter->faces, GstFaceDetectFace, i);
+      CvRect *r = &face->face;
       gboolean have_nose, have_mouth, have_eyes;
 
-      /* detect face features */
-
-      if (filter->cvNoseDetect) {
-        rnx = r->x + r->width / 4;
-        rny = r->y + r->height / 4;
-        rnw = r->width / 2;
-        rnh = r->height / 2;
-        cvSetImageROI (filter->cvGray, cvRect (rnx, rny, rnw, rnh));
-        nose =
-            gst_face_detect_run_detector (filter, filter->cvNoseDetect, mw, mh);
-        have_nose = (nose && nose->total);
-        cvResetImageROI (filter->cvGray);
-      } else {
-        have_nose = FALSE;
-      }
-
-      if (filter->cvMouthDetect) {
-        rmx = r->x;
-        rmy = r->y + r->height / 2;
-        rmw = r->width;
-        rmh = r->height / 2;
-        cvSetImageROI (filter->cvGray, cvRect (rmx, rmy, rmw, rmh));
-        mouth =
-            gst_face_detect_run_detector (filter, filter->cvMouthDetect, mw,
-            mh);
-        have_mouth = (mouth && mouth->total);
-        cvResetImageROI (filter->cvGray);
-      } else {
-        have_mouth = FALSE;
-      }
-
-      if (filter->cvEyesDetect) {
-        rex = r->x;
-        rey = r->y;
-        rew = r->width;
-        reh = r->height / 2;
-        cvSetImageROI (filter->cvGray, cvRect (rex, rey, rew, reh));
-        eyes =
-            gst_face_detect_run_detector (filter, filter->cvEyesDetect, mw, mh);
-        have_eyes = (eyes && eyes->total);
-        cvResetImageROI (filter->cvGray);
-      } else {
-        have_eyes = FALSE;
-      }
+      have_nose = face->nose.width > 0;
+      have_mouth = face->mouth.width > 0;
+      have_eyes = face->eyes.width > 0;
 
       GST_LOG_OBJECT (filter,
           "%2d/%2d: x,y = %4u,%4u: w.h = %4u,%4u : features(e,n,m) = %d,%d,%d",
-          i, faces->total, r->x, r->y, r->width, r->height,
+          i, n_faces, r->x, r->y, r->width, r->height,
           have_eyes, have_nose, have_mouth);
       if (post_msg) {
         s = gst_structure_new ("face",
@@ -653,32 +893,32 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
             "width", G_TYPE_UINT, r->width,
             "height", G_TYPE_UINT, r->height, NULL);
         if (have_nose) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (nose, 0);
-          GST_LOG_OBJECT (filter, "nose/%d: x,y = %4u,%4u: w.h = %4u,%4u",
-              nose->total, rnx + sr->x, rny + sr->y, sr->width, sr->height);
+          CvRect *sr = &face->nose;
+          GST_LOG_OBJECT (filter, "nose: x,y = %4u,%4u: w.h = %4u,%4u",
+              r->x + sr->x, r->y + sr->y, sr->width, sr->height);
           gst_structure_set (s,
-              "nose->x", G_TYPE_UINT, rnx + sr->x,
-              "nose->y", G_TYPE_UINT, rny + sr->y,
+              "nose->x", G_TYPE_UINT, r->x + sr->x,
+              "nose->y", G_TYPE_UINT, r->y + sr->y,
               "nose->width", G_TYPE_UINT, sr->width,
               "nose->height", G_TYPE_UINT, sr->height, NULL);
         }
         if (have_mouth) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (mouth, 0);
-          GST_LOG_OBJECT (filter, "mouth/%d: x,y = %4u,%4u: w.h = %4u,%4u",
-              mouth->total, rmx + sr->x, rmy + sr->y, sr->width, sr->height);
+          CvRect *sr = &face->mouth;
+          GST_LOG_OBJECT (filter, "mouth: x,y = %4u,%4u: w.h = %4u,%4u",
+              r->x + sr->x, r->y + sr->y, sr->width, sr->height);
           gst_structure_set (s,
-              "mouth->x", G_TYPE_UINT, rmx + sr->x,
-              "mouth->y", G_TYPE_UINT, rmy + sr->y,
+              "mouth->x", G_TYPE_UINT, r->x + sr->x,
+              "mouth->y", G_TYPE_UINT, r->y + sr->y,
               "mouth->width", G_TYPE_UINT, sr->width,
               "mouth->height", G_TYPE_UINT, sr->height, NULL);
         }
         if (have_eyes) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (eyes, 0);
-          GST_LOG_OBJECT (filter, "eyes/%d: x,y = %4u,%4u: w.h = %4u,%4u",
-              eyes->total, rex + sr->x, rey + sr->y, sr->width, sr->height);
+          CvRect *sr = &face->eyes;
+          GST_LOG_OBJECT (filter, "eyes: x,y = %4u,%4u: w.h = %4u,%4u",
+              r->x + sr->x, r->y + sr->y, sr->width, sr->height);
           gst_structure_set (s,
-              "eyes->x", G_TYPE_UINT, rex + sr->x,
-              "eyes->y", G_TYPE_UINT, rey + sr->y,
+              "eyes->x", G_TYPE_UINT, r->x + sr->x,
+              "eyes->y", G_TYPE_UINT, r->y + sr->y,
               "eyes->width", G_TYPE_UINT, sr->width,
               "eyes->height", G_TYPE_UINT, sr->height, NULL);
         }
@@ -708,36 +948,36 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
             3, 8, 0);
 
         if (have_nose) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (nose, 0);
+          CvRect *sr = &face->nose;
 
           w = sr->width / 2;
           h = sr->height / 2;
-          center.x = cvRound ((rnx + sr->x + w));
-          center.y = cvRound ((rny + sr->y + h));
+          center.x = cvRound ((r->x + sr->x + w));
+          center.y = cvRound ((r->y + sr->y + h));
           axes.width = w;
           axes.height = h * 1.25;       /* tweak for nose form */
           cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
               1, 8, 0);
         }
         if (have_mouth) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (mouth, 0);
+          CvRect *sr = &face->mouth;
 
           w = sr->width / 2;
           h = sr->height / 2;
-          center.x = cvRound ((rmx + sr->x + w));
-          center.y = cvRound ((rmy + sr->y + h));
+          center.x = cvRound ((r->x + sr->x + w));
+          center.y = cvRound ((r->y + sr->y + h));
           axes.width = w * 1.5; /* tweak for mouth form */
           axes.height = h;
           cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
               1, 8, 0);
         }
         if (have_eyes) {
-          CvRect *sr = (CvRect *) cvGetSeqElem (eyes, 0);
+          CvRect *sr = &face->eyes;
 
           w = sr->width / 2;
           h = sr->height / 2;
-          center.x = cvRound ((rex + sr->x + w));
-          center.y = cvRound ((rey + sr->y + h));
+          center.x = cvRound ((r->x + sr->x + w));
+          center.y = cvRound ((r->y + sr->y + h));
           axes.width = w * 1.5; /* tweak for eyes form */
           axes.height = h;
           cvEllipse (img, center, axes, 0.0, 0.0, 360.0, CV_RGB (cr, cg, cb),
@@ -50,6 +50,7 @@
 #include <gst/gst.h>
 #include <cv.h>
 #include "gstopencvvideofilter.h"
+#include "gstopencvdetectworker.h"
 
 #if (CV_MAJOR_VERSION >= 2) && (CV_MINOR_VERSION >= 2)
 #include <opencv2/objdetect/objdetect.hpp>
@@ -103,8 +104,18 @@ struct _GstFaceDetect
   gint min_size_width;
   gint min_size_height;
   gint updates;
+  gboolean async_detection;
+  gdouble detection_rate;
+  gdouble detection_scale;
+  gboolean extrapolate;
 
-  IplImage *cvGray;
+  /* protects the cascades and the storage, which are used from the
+   * detection thread in asynchronous mode */
+  GMutex detect_lock;
+  GstOpencvDetectWorker *worker;
+  GArray *faces;
+
+  IplImage *cvGray, *cvSmall;
   CvHaarClassifierCascade *cvFaceDetect;
   CvHaarClassifierCascade *cvNoseDetect;
   CvHaarClassifierCascade *cvMouthDetect;
@@ -135,7 +135,8 @@ enum
   PROP_CALCULATEMOTION,
   PROP_POSTALLMOTION,
   PROP_USEALPHA,
-  PROP_MOTIONCELLTHICKNESS
+  PROP_MOTIONCELLTHICKNESS,
+  PROP_FASTDOWNSCALE
 };
 
 /* the capabilities of the inputs and outputs.
@@ -186,7 +187,7 @@ gst_motion_cells_finalize (GObject * obj)
   }
 
   if (filter->cvImage) {
-    cvReleaseImage (&filter->cvImage);
+    cvReleaseImageHeader (&filter->cvImage);
   }
 
   GFREE (filter->motioncellscolor);
@@ -303,6 +304,11 @@ gst_motion_cells_class_init (GstMotioncellsClass * klass)
           "Motion Cell Border Thickness, if it's -1 then motion cell will be fill",
           THICKNESS_MIN, THICKNESS_MAX, THICKNESS_DEF,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FASTDOWNSCALE,
+      g_param_spec_boolean ("fastdownscale", "Fast downscale",
+          "Downscale and convert the frames to grey in a single pass with a "
+          "2x2 box filter instead of a gaussian pyramid", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (element_class,
       "motioncells",
@@ -390,6 +396,7 @@ gst_motion_cells_init (GstMotioncells * filter)
   filter->sent_init_error_msg = false;
   filter->sent_save_error_msg = false;
   filter->thickness = THICKNESS_DEF;
+  filter->fastdownscale = false;
 
   filter->datafileidx = 0;
   filter->id = motion_cells_init ();
@@ -606,6 +613,9 @@ gst_motion_cells_set_property (GObject * object, guint prop_id,
     case PROP_MOTIONCELLTHICKNESS:
       filter->thickness = g_value_get_int (value);
       break;
+    case PROP_FASTDOWNSCALE:
+      filter->fastdownscale = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -729,6 +739,9 @@ gst_motion_cells_get_property (GObject * object, guint prop_id,
     case PROP_MOTIONCELLTHICKNESS:
       g_value_set_int (value, filter->thickness);
       break;
+    case PROP_FASTDOWNSCALE:
+      g_value_set_boolean (value, filter->fastdownscale);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -834,11 +847,14 @@ gst_motion_cells_handle_sink_event (GstPad * pad, GstObject * parent,
       filter->height = info.height;
 
       filter->framerate = (double) info.fps_n / (double) info.fps_d;
+      filter->info = info;
+      /* only a header, the data is set to the mapped frame in the chain
+       * function */
       if (filter->cvImage)
-        cvReleaseImage (&filter->cvImage);
+        cvReleaseImageHeader (&filter->cvImage);
       filter->cvImage =
-          cvCreateImage (cvSize (filter->width, filter->height), IPL_DEPTH_8U,
-          3);
+          cvCreateImageHeader (cvSize (filter->width, filter->height),
+          IPL_DEPTH_8U, 3);
       break;
     }
     default:
@@ -859,7 +875,7 @@ static GstFlowReturn
 gst_motion_cells_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstMotioncells *filter;
-  GstMapInfo info;
+  GstVideoFrame frame;
   filter = gst_motion_cells (parent);
   GST_OBJECT_LOCK (filter);
   if (filter->calculate_motion) {
@@ -871,7 +887,7 @@ gst_motion_cells_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     int mincellsOfInterestNumber, motiondetect, minimum_motion_frames,
         postnomotion;
     char *datafile;
-    bool display, changed_datafile, useAlpha;
+    bool display, changed_datafile, useAlpha, fastdownscale;
     gint64 starttime;
     motionmaskcoordrect *motionmaskcoords;
     motioncellidx *motionmaskcellsidx;
@@ -879,10 +895,19 @@ gst_motion_cells_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     motioncellidx *motioncellsidx;
 
     buf = gst_buffer_make_writable (buf);
-    gst_buffer_map (buf, &info, GST_MAP_WRITE);
-    filter->cvImage->imageData = (char *) info.data;
+    if (!gst_video_frame_map (&frame, &filter->info, buf, GST_MAP_READWRITE)) {
+      GST_OBJECT_UNLOCK (filter);
+      GST_ELEMENT_ERROR (filter, RESOURCE, FAILED, (NULL),
+          ("Failed to map the video frame"));
+      gst_buffer_unref (buf);
+      return GST_FLOW_ERROR;
+    }
+    /* work on the mapped frame directly, honouring its stride */
+    cvSetData (filter->cvImage, GST_VIDEO_FRAME_PLANE_DATA (&frame, 0),
+        GST_VIDEO_FRAME_PLANE_STRIDE (&frame, 0));
+    fastdownscale = filter->fastdownscale;
     if (filter->firstframe) {
-      setPrevFrame (filter->cvImage, filter->id);
+      setPrevFrame (filter->cvImage, fastdownscale, filter->id);
       filter->firstframe = FALSE;
     }
     minimum_motion_frames = filter->minimum_motion_frames;
@@ -962,7 +987,8 @@ gst_motion_cells_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
         filter->diff_timestamp, display, useAlpha, motionmaskcoord_count,
         motionmaskcoords, motionmaskcells_count, motionmaskcellsidx,
         motioncellscolor, motioncells_count, motioncellsidx, starttime,
-        datafile, changed_datafile, thickness, filter->id);
+        datafile, changed_datafile, thickness, fastdownscale, filter->id);
+    gst_video_frame_unmap (&frame);
 
     if ((success == 1) && (filter->sent_init_error_msg == false)) {
       char *initfailedreason;
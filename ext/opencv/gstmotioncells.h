@@ -46,6 +46,7 @@
 #define __GST_MOTIONCELLS_H__
 
 #include <gst/gst.h>
+#include <gst/video/video.h>
 #include <cv.h>
 
 G_BEGIN_DECLS
@@ -89,7 +90,7 @@ struct _GstMotioncells
   gboolean display, calculate_motion, firstgridx, firstgridy, changed_gridx,
       changed_gridy, changed_startime;
   gboolean previous_motion, changed_datafile, postallmotion, usealpha,
-      firstdatafile, firstframe;
+      firstdatafile, firstframe, fastdownscale;
   gboolean sent_init_error_msg, sent_save_error_msg;
   gchar *prev_datafile, *cur_datafile, *basename_datafile, *datafile_extension;
   gint prevgridx, gridx, prevgridy, gridy, id;
@@ -105,6 +106,7 @@ struct _GstMotioncells
   gint64 diff_timestamp, starttime;
   guint64 consecutive_motion;
   gint width, height;
+  GstVideoInfo info;
   //time stuff
   struct timeval tv;
   double framerate;
@@ -0,0 +1,397 @@
+/* GStreamer
+ *
+ * gstopencvdetectworker.c: runs object detection in a separate thread
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The streaming thread hands a downscaled grey copy of a frame to the
+ * worker whenever the worker is idle and the detection interval has
+ * passed, and otherwise only picks up the most recent results. The grey
+ * image is only written while no detection is pending and only read by the
+ * worker while one is, so it is not protected by the lock. The same goes
+ * for the copy of the detection parameters that is taken along with the
+ * frame, so that property changes don't affect a running detection. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstopencvdetectworker.h"
+
+/* don't extrapolate positions further than this from the detection */
+#define MAX_EXTRAPOLATION (GST_SECOND / 2)
+
+struct _GstOpencvDetectWorker
+{
+  GThread *thread;
+  GMutex lock;
+  GCond cond;
+  gboolean running;
+  gboolean pending;
+  guint generation;
+
+  GstOpencvDetectFunc func;
+  gpointer user_data;
+  guint result_size;
+  guint params_size;
+
+  gdouble scale;
+  GstClockTime interval;
+
+  /* frame handed to the worker */
+  IplImage *small, *grey;
+  gpointer params;
+  gdouble grey_scale;
+  GstClockTime grey_ts;
+  GstClockTime pushed_ts;
+  gint width, height;
+
+  /* latest and previous results and the timestamps of their frames */
+  GArray *results, *prev_results;
+  GstClockTime results_ts, prev_results_ts;
+};
+
+#define RESULT_RECT(array,size,i) \
+    ((CvRect *) ((array)->data + (i) * (size)))
+
+static gpointer
+gst_opencv_detect_worker_thread (gpointer data)
+{
+  GstOpencvDetectWorker *worker = data;
+  GArray *results, *tmp;
+  GstClockTime ts;
+  gdouble scale;
+  guint generation;
+
+  results = g_array_new (FALSE, FALSE, worker->result_size);
+
+  g_mutex_lock (&worker->lock);
+  while (TRUE) {
+    while (worker->running && !worker->pending)
+      g_cond_wait (&worker->cond, &worker->lock);
+    if (!worker->running)
+      break;
+
+    ts = worker->grey_ts;
+    scale = worker->grey_scale;
+    generation = worker->generation;
+    g_mutex_unlock (&worker->lock);
+
+    g_array_set_size (results, 0);
+    worker->func (worker->grey, scale, results, worker->params,
+        worker->user_data);
+
+    g_mutex_lock (&worker->lock);
+    worker->pending = FALSE;
+    /* reset while we were busy, these results are stale */
+    if (generation != worker->generation)
+      continue;
+
+    tmp = worker->prev_results;
+    worker->prev_results = worker->results;
+    worker->prev_results_ts = worker->results_ts;
+    worker->results = results;
+    worker->results_ts = ts;
+    results = tmp;
+  }
+  g_mutex_unlock (&worker->lock);
+
+  g_array_free (results, TRUE);
+
+  return NULL;
+}
+
+/**
+ * gst_opencv_detect_worker_new:
+ * @name: name of the thread
+ * @result_size: size of one result element
+ * @params_size: size of the detection parameters, or 0
+ * @func: the detection function
+ * @user_data: data to pass to @func
+ *
+ * Creates a worker and starts its thread. @func is called from that thread.
+ */
+GstOpencvDetectWorker *
+gst_opencv_detect_worker_new (const gchar * name, guint result_size,
+    guint params_size, GstOpencvDetectFunc func, gpointer user_data)
+{
+  GstOpencvDetectWorker *worker;
+
+  g_return_val_if_fail (result_size >= sizeof (CvRect), NULL);
+
+  worker = g_slice_new0 (GstOpencvDetectWorker);
+  g_mutex_init (&worker->lock);
+  g_cond_init (&worker->cond);
+  worker->func = func;
+  worker->user_data = user_data;
+  worker->result_size = result_size;
+  worker->params_size = params_size;
+  worker->params = params_size ? g_malloc0 (params_size) : NULL;
+  worker->scale = 1.0;
+  worker->interval = 0;
+  worker->grey_ts = GST_CLOCK_TIME_NONE;
+  worker->pushed_ts = GST_CLOCK_TIME_NONE;
+  worker->results = g_array_new (FALSE, FALSE, result_size);
+  worker->prev_results = g_array_new (FALSE, FALSE, result_size);
+  worker->results_ts = GST_CLOCK_TIME_NONE;
+  worker->prev_results_ts = GST_CLOCK_TIME_NONE;
+  worker->running = TRUE;
+  worker->thread =
+      g_thread_new (name, gst_opencv_detect_worker_thread, worker);
+
+  return worker;
+}
+
+/**
+ * gst_opencv_detect_worker_free:
+ * @worker: a #GstOpencvDetectWorker
+ *
+ * Waits for a running detection to finish, stops the thread and frees
+ * @worker.
+ */
+void
+gst_opencv_detect_worker_free (GstOpencvDetectWorker * worker)
+{
+  g_mutex_lock (&worker->lock);
+  worker->running = FALSE;
+  g_cond_broadcast (&worker->cond);
+  g_mutex_unlock (&worker->lock);
+
+  g_thread_join (worker->thread);
+
+  if (worker->small)
+    cvReleaseImage (&worker->small);
+  if (worker->grey)
+    cvReleaseImage (&worker->grey);
+  g_free (worker->params);
+  g_array_free (worker->results, TRUE);
+  g_array_free (worker->prev_results, TRUE);
+  g_mutex_clear (&worker->lock);
+  g_cond_clear (&worker->cond);
+  g_slice_free (GstOpencvDetectWorker, worker);
+}
+
+/**
+ * gst_opencv_detect_worker_set_params:
+ * @worker: a #GstOpencvDetectWorker
+ * @scale: factor to scale the frames with before detection
+ * @rate: maximum number of detections per second, 0 for no limit
+ *
+ * Configures the frames handed to the worker by the next
+ * gst_opencv_detect_worker_push() calls.
+ */
+void
+gst_opencv_detect_worker_set_params (GstOpencvDetectWorker * worker,
+    gdouble scale, gdouble rate)
+{
+  g_mutex_lock (&worker->lock);
+  worker->scale = scale;
+  worker->interval = rate > 0.0 ? (GstClockTime) (GST_SECOND / rate) : 0;
+  g_mutex_unlock (&worker->lock);
+}
+
+/**
+ * gst_opencv_detect_worker_reset:
+ * @worker: a #GstOpencvDetectWorker
+ *
+ * Drops all results, including the ones of a detection that is still
+ * running. Call this on flushes and frame size changes.
+ */
+void
+gst_opencv_detect_worker_reset (GstOpencvDetectWorker * worker)
+{
+  g_mutex_lock (&worker->lock);
+  worker->generation++;
+  worker->pushed_ts = GST_CLOCK_TIME_NONE;
+  g_array_set_size (worker->results, 0);
+  g_array_set_size (worker->prev_results, 0);
+  worker->results_ts = GST_CLOCK_TIME_NONE;
+  worker->prev_results_ts = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (&worker->lock);
+}
+
+/**
+ * gst_opencv_detect_worker_push:
+ * @worker: a #GstOpencvDetectWorker
+ * @img: the full size RGB frame
+ * @timestamp: timestamp of the frame
+ * @params: detection parameters, copied along with the frame
+ *
+ * Hands a downscaled grey copy of @img and a copy of @params to the worker
+ * if it is idle and the detection interval has passed since the last frame
+ * it got. Never waits for the detection.
+ *
+ * Returns: %TRUE if the frame will be processed.
+ */
+gboolean
+gst_opencv_detect_worker_push (GstOpencvDetectWorker * worker,
+    IplImage * img, GstClockTime timestamp, gconstpointer params)
+{
+  gdouble scale;
+
+  g_mutex_lock (&worker->lock);
+  if (worker->pending)
+    goto busy;
+  if (GST_CLOCK_TIME_IS_VALID (timestamp)
+      && GST_CLOCK_TIME_IS_VALID (worker->pushed_ts)
+      && timestamp >= worker->pushed_ts
+      && timestamp - worker->pushed_ts < worker->interval)
+    goto busy;
+  scale = worker->scale;
+  g_mutex_unlock (&worker->lock);
+
+  /* the worker is idle, we own the images until pending is set */
+  gst_opencv_detect_downscale_grey (img, scale, &worker->small, &worker->grey);
+  if (worker->params_size)
+    memcpy (worker->params, params, worker->params_size);
+
+  g_mutex_lock (&worker->lock);
+  worker->width = img->width;
+  worker->height = img->height;
+  worker->grey_scale = scale;
+  worker->grey_ts = timestamp;
+  worker->pushed_ts = timestamp;
+  worker->pending = TRUE;
+  g_cond_signal (&worker->cond);
+  g_mutex_unlock (&worker->lock);
+
+  return TRUE;
+
+busy:
+  g_mutex_unlock (&worker->lock);
+  return FALSE;
+}
+
+/* moves every result along the line from its closest match in the previous
+ * results, the same object is assumed to move less than its own size
+ * between two detections */
+static void
+gst_opencv_detect_worker_extrapolate (GstOpencvDetectWorker * worker,
+    GArray * results, GstClockTime timestamp)
+{
+  gdouble dt, t;
+  guint i, j;
+
+  dt = (gdouble) (worker->results_ts - worker->prev_results_ts);
+  t = (gdouble) (timestamp - worker->results_ts) / dt;
+
+  for (i = 0; i < results->len; i++) {
+    CvRect *r = RESULT_RECT (results, worker->result_size, i);
+    gint cx = r->x + r->width / 2, cy = r->y + r->height / 2;
+    gint best = -1, best_dist = MAX (r->width, r->height);
+    gint dx = 0, dy = 0;
+
+    for (j = 0; j < worker->prev_results->len; j++) {
+      CvRect *p = RESULT_RECT (worker->prev_results, worker->result_size, j);
+      gint pdx = cx - (p->x + p->width / 2);
+      gint pdy = cy - (p->y + p->height / 2);
+      gint dist = ABS (pdx) + ABS (pdy);
+
+      if (dist < best_dist) {
+        best = j;
+        best_dist = dist;
+        dx = pdx;
+        dy = pdy;
+      }
+    }
+    if (best < 0)
+      continue;
+
+    r->x = CLAMP (r->x + (gint) (dx * t), 0, MAX (worker->width - r->width,
+            0));
+    r->y = CLAMP (r->y + (gint) (dy * t), 0, MAX (worker->height - r->height,
+            0));
+  }
+}
+
+/**
+ * gst_opencv_detect_worker_get_results:
+ * @worker: a #GstOpencvDetectWorker
+ * @results: array to copy the results to
+ * @timestamp: timestamp of the frame the results are for
+ * @extrapolate: whether to move the results to where they are expected to
+ *     be at @timestamp
+ *
+ * Copies the results of the most recent detection to @results.
+ *
+ * Returns: the timestamp of the frame the results were detected in.
+ */
+GstClockTime
+gst_opencv_detect_worker_get_results (GstOpencvDetectWorker * worker,
+    GArray * results, GstClockTime timestamp, gboolean extrapolate)
+{
+  GstClockTime ts;
+
+  g_mutex_lock (&worker->lock);
+  g_array_set_size (results, 0);
+  g_array_append_vals (results, worker->results->data, worker->results->len);
+  ts = worker->results_ts;
+
+  if (extrapolate && results->len > 0 && worker->prev_results->len > 0
+      && GST_CLOCK_TIME_IS_VALID (timestamp)
+      && GST_CLOCK_TIME_IS_VALID (worker->results_ts)
+      && GST_CLOCK_TIME_IS_VALID (worker->prev_results_ts)
+      && worker->results_ts > worker->prev_results_ts
+      && timestamp > worker->results_ts
+      && timestamp - worker->results_ts <= MAX_EXTRAPOLATION)
+    gst_opencv_detect_worker_extrapolate (worker, results, timestamp);
+  g_mutex_unlock (&worker->lock);
+
+  return ts;
+}
+
+/**
+ * gst_opencv_detect_downscale_grey:
+ * @img: the full size RGB frame
+ * @scale: factor to scale @img with
+ * @small: (inout): intermediate RGB image, (re)allocated as needed
+ * @grey: (inout): the resulting grey image, (re)allocated as needed
+ *
+ * Scales @img down before converting it to grey so that only the small
+ * image is converted.
+ */
+void
+gst_opencv_detect_downscale_grey (IplImage * img, gdouble scale,
+    IplImage ** small, IplImage ** grey)
+{
+  CvSize size;
+
+  size = cvSize (MAX ((gint) (img->width * scale + 0.5), 1),
+      MAX ((gint) (img->height * scale + 0.5), 1));
+
+  if (*grey && ((*grey)->width != size.width
+          || (*grey)->height != size.height))
+    cvReleaseImage (grey);
+  if (!*grey)
+    *grey = cvCreateImage (size, IPL_DEPTH_8U, 1);
+
+  if (size.width == img->width && size.height == img->height) {
+    cvCvtColor (img, *grey, CV_RGB2GRAY);
+    return;
+  }
+
+  if (*small && ((*small)->width != size.width
+          || (*small)->height != size.height))
+    cvReleaseImage (small);
+  if (!*small)
+    *small = cvCreateImage (size, IPL_DEPTH_8U, 3);
+
+  cvResize (img, *small, CV_INTER_LINEAR);
+  cvCvtColor (*small, *grey, CV_RGB2GRAY);
+}
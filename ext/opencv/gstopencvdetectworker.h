@@ -0,0 +1,67 @@
+/* GStreamer
+ *
+ * gstopencvdetectworker.h: runs object detection in a separate thread
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_OPENCV_DETECT_WORKER_H__
+#define __GST_OPENCV_DETECT_WORKER_H__
+
+#include <gst/gst.h>
+#include <cv.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstOpencvDetectWorker GstOpencvDetectWorker;
+
+/**
+ * GstOpencvDetectFunc:
+ * @grey: the downscaled grey frame
+ * @scale: the factor the frame was scaled with
+ * @results: array to append the results to
+ * @params: the detection parameters passed along with the frame
+ * @user_data: user data passed to gst_opencv_detect_worker_new()
+ *
+ * Runs the detection on @grey and appends one element per detected object
+ * to @results. Every element must start with a #CvRect of the object in
+ * full size frame coordinates; anything else it contains must be relative
+ * to that rectangle so that it moves along when the rectangle is
+ * extrapolated.
+ */
+typedef void (*GstOpencvDetectFunc) (IplImage * grey, gdouble scale,
+    GArray * results, gconstpointer params, gpointer user_data);
+
+GstOpencvDetectWorker *gst_opencv_detect_worker_new (const gchar * name,
+    guint result_size, guint params_size, GstOpencvDetectFunc func,
+    gpointer user_data);
+void gst_opencv_detect_worker_free (GstOpencvDetectWorker * worker);
+
+void gst_opencv_detect_worker_set_params (GstOpencvDetectWorker * worker,
+    gdouble scale, gdouble rate);
+void gst_opencv_detect_worker_reset (GstOpencvDetectWorker * worker);
+
+gboolean gst_opencv_detect_worker_push (GstOpencvDetectWorker * worker,
+    IplImage * img, GstClockTime timestamp, gconstpointer params);
+GstClockTime gst_opencv_detect_worker_get_results (GstOpencvDetectWorker *
+    worker, GArray * results, GstClockTime timestamp, gboolean extrapolate);
+
+void gst_opencv_detect_downscale_grey (IplImage * img, gdouble scale,
+    IplImage ** small, IplImage ** grey);
+
+G_END_DECLS
+
+#endif /* __GST_OPENCV_DETECT_WORKER_H__ */
@@ -85,7 +85,8 @@ perform_detection_motion_cells (IplImage * p_image, double p_sensitivity,
     motionmaskcoordrect * motionmaskcoords, int motionmaskcells_count,
     motioncellidx * motionmaskcellsidx, cellscolor motioncellscolor,
     int motioncells_count, motioncellidx * motioncellsidx, gint64 starttime,
-    char *p_datafile, bool p_changed_datafile, int p_thickness, int p_id)
+    char *p_datafile, bool p_changed_datafile, int p_thickness,
+    bool p_fastdownscale, int p_id)
 {
   int idx = 0;
   idx = searchIdx (p_id);
@@ -94,16 +95,16 @@ perform_detection_motion_cells (IplImage * p_image, double p_sensitivity,
       p_isVisible, p_useAlpha, motionmaskcoord_count, motionmaskcoords,
       motionmaskcells_count, motionmaskcellsidx, motioncellscolor,
       motioncells_count, motioncellsidx, starttime, p_datafile,
-      p_changed_datafile, p_thickness);
+      p_changed_datafile, p_thickness, p_fastdownscale);
 }
 
 
 void
-setPrevFrame (IplImage * p_prevFrame, int p_id)
+setPrevFrame (IplImage * p_prevFrame, bool p_fastdownscale, int p_id)
 {
   int idx = 0;
   idx = searchIdx (p_id);
-  motioncellsvector.at (idx).mc->setPrevFrame (p_prevFrame);
+  motioncellsvector.at (idx).mc->setPrevFrame (p_prevFrame, p_fastdownscale);
 }
 
 char *
@@ -70,8 +70,9 @@ extern "C"
       int motionmaskcells_count, motioncellidx * motionmaskcellsidx,
       cellscolor motioncellscolor, int motioncells_count,
       motioncellidx * motioncellsidx, gint64 starttime, char *datafile,
-      bool p_changed_datafile, int p_thickness, int p_id);
-  void setPrevFrame (IplImage * p_prevFrame, int p_id);
+      bool p_changed_datafile, int p_thickness, bool p_fastdownscale,
+      int p_id);
+  void setPrevFrame (IplImage * p_prevFrame, bool p_fastdownscale, int p_id);
   void motion_cells_free (int p_id);
   void motion_cells_free_resources (int p_id);
   char *getMotionCellsIdx (int p_id);
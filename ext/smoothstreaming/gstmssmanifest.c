@@ -26,6 +26,7 @@
 #include <ctype.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 /* for parsing h264 codec data */
 #include <gst/codecparsers/gsth264parser.h>
@@ -45,51 +46,64 @@
 #define MSS_PROP_TIMESCALE            "TimeScale"
 #define MSS_PROP_URL                  "Url"
 
+/* run of consecutive fragments with the same duration */
 typedef struct _GstMssStreamFragment
 {
-  guint number;
-  guint64 time;
-  guint64 duration;
+  guint number;                 /* number of the first fragment of the run */
+  guint64 time;                 /* start time of the first fragment */
+  guint64 duration;             /* duration of each fragment */
+  guint repetitions;            /* number of fragments in the run */
 } GstMssStreamFragment;
 
 typedef struct _GstMssStreamQuality
 {
-  xmlNodePtr xmlnode;
-
   gchar *bitrate_str;
   guint64 bitrate;
+
+  GstCaps *caps;
+  /* fragment url with the bitrate set, split around the start time */
+  gchar **url_parts;
 } GstMssStreamQuality;
 
 struct _GstMssStream
 {
-  xmlNodePtr xmlnode;
-
   gboolean active;              /* if the stream is currently being used */
   gint selectedQualityIndex;
 
-  GList *fragments;
+  GstMssStreamType type;
+  guint64 timescale;
+
+  GArray *fragments;
   GList *qualities;
 
   gchar *url;
 
-  GList *current_fragment;
+  /* index of the current run in fragments and of the fragment in that run,
+   * current_fragment == fragments->len when the stream is over */
+  guint current_fragment;
+  guint current_repetition;
   GList *current_quality;
-
-  /* TODO move this to somewhere static */
-  GRegex *regex_bitrate;
-  GRegex *regex_position;
 };
 
 struct _GstMssManifest
 {
-  xmlDocPtr xml;
-  xmlNodePtr xmlrootnode;
-
   gboolean is_live;
+  guint64 timescale;
+  guint64 duration;
 
   GSList *streams;
 };
 
+/* state used while reading the <c> nodes of a StreamIndex */
+typedef struct _GstMssFragmentParser
+{
+  GstMssStreamFragment pending; /* fragment waiting for its duration */
+  gboolean have_pending;
+  gboolean pending_numbered;    /* if the pending fragment had a "n" */
+  guint number;
+  guint64 time;
+} GstMssFragmentParser;
+
 static GstBuffer *gst_buffer_from_hex_string (const gchar * s);
 
 static gboolean
@@ -98,12 +112,18 @@ node_has_type (xmlNodePtr node, const gchar * name)
   return strcmp ((gchar *) node->name, name) == 0;
 }
 
+static GstCaps *_gst_mss_stream_video_caps_from_qualitylevel_xml
+    (GstMssStreamQuality * q, xmlNodePtr node);
+static GstCaps *_gst_mss_stream_audio_caps_from_qualitylevel_xml
+    (GstMssStreamQuality * q, xmlNodePtr node);
+
 static GstMssStreamQuality *
-gst_mss_stream_quality_new (xmlNodePtr node)
+gst_mss_stream_quality_new (GstMssStream * stream, xmlNodePtr node,
+    GRegex * regex_bitrate, GRegex * regex_position)
 {
-  GstMssStreamQuality *q = g_slice_new (GstMssStreamQuality);
+  GstMssStreamQuality *q = g_slice_new0 (GstMssStreamQuality);
+  gchar *url;
 
-  q->xmlnode = node;
   q->bitrate_str = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_BITRATE);
 
   if (q->bitrate_str != NULL)
@@ -111,6 +131,20 @@ gst_mss_stream_quality_new (xmlNodePtr node)
   else
     q->bitrate = 0;
 
+  if (stream->type == MSS_STREAM_TYPE_VIDEO)
+    q->caps = _gst_mss_stream_video_caps_from_qualitylevel_xml (q, node);
+  else if (stream->type == MSS_STREAM_TYPE_AUDIO)
+    q->caps = _gst_mss_stream_audio_caps_from_qualitylevel_xml (q, node);
+
+  if (stream->url && q->bitrate_str) {
+    url = g_regex_replace_literal (regex_bitrate, stream->url,
+        strlen (stream->url), 0, q->bitrate_str, 0, NULL);
+    if (url) {
+      q->url_parts = g_regex_split (regex_position, url, 0);
+      g_free (url);
+    }
+  }
+
   return q;
 }
 
@@ -120,6 +154,9 @@ gst_mss_stream_quality_free (GstMssStreamQuality * quality)
   g_return_if_fail (quality != NULL);
 
   xmlFree (quality->bitrate_str);
+  if (quality->caps)
+    gst_caps_unref (quality->caps);
+  g_strfreev (quality->url_parts);
   g_slice_free (GstMssStreamQuality, quality);
 }
 
@@ -134,105 +171,255 @@ compare_bitrate (GstMssStreamQuality * a, GstMssStreamQuality * b)
 
 }
 
+static guint64
+gst_mss_stream_fragment_time (GstMssStreamFragment * fragment, guint repetition)
+{
+  return fragment->time + fragment->duration * repetition;
+}
+
+/* fragments without a "n" attribute continue the numbering of the last
+ * known fragment, which a reloaded manifest doesn't start from */
+static void
+gst_mss_stream_append_fragment (GstMssStream * stream, guint number,
+    gboolean numbered, guint64 time, guint64 duration)
+{
+  GstMssStreamFragment *last;
+  GstMssStreamFragment fragment;
+
+  if (stream->fragments->len > 0) {
+    guint64 last_time;
+
+    last = &g_array_index (stream->fragments, GstMssStreamFragment,
+        stream->fragments->len - 1);
+    last_time = gst_mss_stream_fragment_time (last, last->repetitions - 1);
+
+    /* already known */
+    if (time <= last_time)
+      return;
+
+    /* the last fragment of the previous manifest had no duration */
+    if (last->duration == 0 && last->repetitions == 1)
+      last->duration = time - last->time;
+
+    if (!numbered)
+      number = last->number + last->repetitions;
+
+    if (last->duration == duration && last_time + duration == time
+        && last->number + last->repetitions == number) {
+      last->repetitions++;
+      return;
+    }
+  }
+
+  fragment.number = number;
+  fragment.time = time;
+  fragment.duration = duration;
+  fragment.repetitions = 1;
+  g_array_append_val (stream->fragments, fragment);
+}
+
+static void
+gst_mss_fragment_parser_init (GstMssFragmentParser * parser)
+{
+  memset (parser, 0, sizeof (GstMssFragmentParser));
+}
+
+static void
+gst_mss_fragment_parser_push (GstMssFragmentParser * parser,
+    GstMssStream * stream, const gchar * seqnum_str, const gchar * time_str,
+    const gchar * duration_str)
+{
+  guint number;
+  guint64 time;
+
+  /* use the node's seq number or use the previous + 1 */
+  if (seqnum_str)
+    number = g_ascii_strtoull (seqnum_str, NULL, 10);
+  else
+    number = parser->number;
+  parser->number = number + 1;
+
+  if (time_str)
+    time = g_ascii_strtoull (time_str, NULL, 10);
+  else
+    time = parser->time;
+
+  /* if we have a previous fragment, means we need to set its duration */
+  if (parser->have_pending) {
+    gst_mss_stream_append_fragment (stream, parser->pending.number,
+        parser->pending_numbered, parser->pending.time,
+        time - parser->pending.time);
+    parser->have_pending = FALSE;
+  }
+
+  if (duration_str) {
+    guint64 duration = g_ascii_strtoull (duration_str, NULL, 10);
+
+    gst_mss_stream_append_fragment (stream, number, seqnum_str != NULL, time,
+        duration);
+    parser->time = time + duration;
+  } else {
+    /* store to set the duration at the next iteration */
+    parser->pending.number = number;
+    parser->pending.time = time;
+    parser->pending_numbered = seqnum_str != NULL;
+    parser->have_pending = TRUE;
+    parser->time = time;
+  }
+}
+
+/* @end is the end time of the stream, the last fragment lasts until then if
+ * it has no duration. 0 if unknown, the duration will be set by the first
+ * fragment of the next manifest. */
+static void
+gst_mss_fragment_parser_finish (GstMssFragmentParser * parser,
+    GstMssStream * stream, guint64 end)
+{
+  if (parser->have_pending) {
+    guint64 duration = 0;
+
+    if (end > parser->pending.time)
+      duration = end - parser->pending.time;
+    gst_mss_stream_append_fragment (stream, parser->pending.number,
+        parser->pending_numbered, parser->pending.time, duration);
+    parser->have_pending = FALSE;
+  }
+}
+
+/* the end time of @stream in its timescale, 0 if unknown */
+static guint64
+gst_mss_stream_get_end_time (GstMssManifest * manifest, GstMssStream * stream)
+{
+  if (manifest->duration == -1 || manifest->duration == 0
+      || manifest->timescale == 0)
+    return 0;
+
+  return gst_util_uint64_scale_round (manifest->duration, stream->timescale,
+      manifest->timescale);
+}
+
+static GstMssStreamType
+_gst_mss_stream_type_from_xml (xmlNodePtr node)
+{
+  gchar *prop = (gchar *) xmlGetProp (node, (xmlChar *) "Type");
+  GstMssStreamType ret = MSS_STREAM_TYPE_UNKNOWN;
+
+  if (prop == NULL)
+    return MSS_STREAM_TYPE_UNKNOWN;
+
+  if (strcmp (prop, "video") == 0) {
+    ret = MSS_STREAM_TYPE_VIDEO;
+  } else if (strcmp (prop, "audio") == 0) {
+    ret = MSS_STREAM_TYPE_AUDIO;
+  }
+  xmlFree (prop);
+  return ret;
+}
+
+static guint64
+_gst_mss_timescale_from_xml (xmlNodePtr node, guint64 default_timescale)
+{
+  gchar *timescale;
+  guint64 ts = default_timescale;
+
+  timescale = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_TIMESCALE);
+  if (timescale) {
+    ts = g_ascii_strtoull (timescale, NULL, 10);
+    xmlFree (timescale);
+  }
+  return ts;
+}
+
 static void
-_gst_mss_stream_init (GstMssStream * stream, xmlNodePtr node)
+_gst_mss_stream_init (GstMssManifest * manifest, GstMssStream * stream,
+    xmlNodePtr node)
 {
   xmlNodePtr iter;
-  GstMssStreamFragment *previous_fragment = NULL;
-  guint fragment_number = 0;
-  guint64 fragment_time_accum = 0;
+  GstMssFragmentParser parser;
+  GRegex *regex_bitrate;
+  GRegex *regex_position;
 
-  stream->xmlnode = node;
+  stream->type = _gst_mss_stream_type_from_xml (node);
+  stream->timescale = _gst_mss_timescale_from_xml (node, manifest->timescale);
+  stream->fragments = g_array_new (FALSE, FALSE,
+      sizeof (GstMssStreamFragment));
 
   /* get the base url path generator */
   stream->url = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_URL);
 
+  regex_bitrate = g_regex_new ("\\{[Bb]itrate\\}", 0, 0, NULL);
+  regex_position = g_regex_new ("\\{start[ _]time\\}", 0, 0, NULL);
+
+  gst_mss_fragment_parser_init (&parser);
   for (iter = node->children; iter; iter = iter->next) {
     if (node_has_type (iter, MSS_NODE_STREAM_FRAGMENT)) {
       gchar *duration_str;
       gchar *time_str;
       gchar *seqnum_str;
-      GstMssStreamFragment *fragment = g_new (GstMssStreamFragment, 1);
 
       duration_str = (gchar *) xmlGetProp (iter, (xmlChar *) MSS_PROP_DURATION);
       time_str = (gchar *) xmlGetProp (iter, (xmlChar *) MSS_PROP_TIME);
       seqnum_str = (gchar *) xmlGetProp (iter, (xmlChar *) MSS_PROP_NUMBER);
 
-      /* use the node's seq number or use the previous + 1 */
-      if (seqnum_str) {
-        fragment->number = g_ascii_strtoull (seqnum_str, NULL, 10);
-        xmlFree (seqnum_str);
-        fragment_number = fragment->number;
-      } else {
-        fragment->number = fragment_number;
-      }
-      fragment_number = fragment->number + 1;
-
-      if (time_str) {
-        fragment->time = g_ascii_strtoull (time_str, NULL, 10);
+      gst_mss_fragment_parser_push (&parser, stream, seqnum_str, time_str,
+          duration_str);
 
-        xmlFree (time_str);
-        fragment_time_accum = fragment->time;
-      } else {
-        fragment->time = fragment_time_accum;
-      }
-
-      /* if we have a previous fragment, means we need to set its duration */
-      if (previous_fragment)
-        previous_fragment->duration = fragment->time - previous_fragment->time;
-
-      if (duration_str) {
-        fragment->duration = g_ascii_strtoull (duration_str, NULL, 10);
-
-        previous_fragment = NULL;
-        fragment_time_accum += fragment->duration;
-        xmlFree (duration_str);
-      } else {
-        /* store to set the duration at the next iteration */
-        previous_fragment = fragment;
-      }
-
-      /* we reverse it later */
-      stream->fragments = g_list_prepend (stream->fragments, fragment);
+      xmlFree (duration_str);
+      xmlFree (time_str);
+      xmlFree (seqnum_str);
     } else if (node_has_type (iter, MSS_NODE_STREAM_QUALITY)) {
-      GstMssStreamQuality *quality = gst_mss_stream_quality_new (iter);
+      GstMssStreamQuality *quality =
+          gst_mss_stream_quality_new (stream, iter, regex_bitrate,
+          regex_position);
       stream->qualities = g_list_prepend (stream->qualities, quality);
     } else {
       /* TODO gst log this */
     }
   }
+  gst_mss_fragment_parser_finish (&parser, stream,
+      gst_mss_stream_get_end_time (manifest, stream));
 
-  stream->fragments = g_list_reverse (stream->fragments);
+  g_regex_unref (regex_position);
+  g_regex_unref (regex_bitrate);
 
   /* order them from smaller to bigger based on bitrates */
   stream->qualities =
       g_list_sort (stream->qualities, (GCompareFunc) compare_bitrate);
 
-  stream->current_fragment = stream->fragments;
+  stream->current_fragment = 0;
+  stream->current_repetition = 0;
   stream->current_quality = stream->qualities;
-
-  stream->regex_bitrate = g_regex_new ("\\{[Bb]itrate\\}", 0, 0, NULL);
-  stream->regex_position = g_regex_new ("\\{start[ _]time\\}", 0, 0, NULL);
 }
 
 GstMssManifest *
 gst_mss_manifest_new (GstBuffer * data)
 {
   GstMssManifest *manifest;
+  xmlDocPtr xml;
   xmlNodePtr root;
   xmlNodePtr nodeiter;
   gchar *live_str;
+  gchar *duration_str;
   GstMapInfo mapinfo;
 
   if (!gst_buffer_map (data, &mapinfo, GST_MAP_READ)) {
     return NULL;
   }
 
-  manifest = g_malloc0 (sizeof (GstMssManifest));
-
-  manifest->xml = xmlReadMemory ((const gchar *) mapinfo.data,
+  xml = xmlReadMemory ((const gchar *) mapinfo.data,
       mapinfo.size, "manifest", NULL, 0);
-  root = manifest->xmlrootnode = xmlDocGetRootElement (manifest->xml);
+  gst_buffer_unmap (data, &mapinfo);
+
+  if (xml == NULL)
+    return NULL;
+
+  root = xmlDocGetRootElement (xml);
+  if (root == NULL) {
+    xmlFreeDoc (xml);
+    return NULL;
+  }
+
+  manifest = g_malloc0 (sizeof (GstMssManifest));
 
   live_str = (gchar *) xmlGetProp (root, (xmlChar *) "IsLive");
   if (live_str) {
@@ -240,17 +427,28 @@ gst_mss_manifest_new (GstBuffer * data)
     xmlFree (live_str);
   }
 
+  manifest->timescale = _gst_mss_timescale_from_xml (root, DEFAULT_TIMESCALE);
+
+  manifest->duration = -1;
+  duration_str =
+      (gchar *) xmlGetProp (root, (xmlChar *) MSS_PROP_STREAM_DURATION);
+  if (duration_str) {
+    manifest->duration = g_ascii_strtoull (duration_str, NULL, 10);
+    xmlFree (duration_str);
+  }
+
   for (nodeiter = root->children; nodeiter; nodeiter = nodeiter->next) {
     if (nodeiter->type == XML_ELEMENT_NODE
         && (strcmp ((const char *) nodeiter->name, "StreamIndex") == 0)) {
       GstMssStream *stream = g_new0 (GstMssStream, 1);
 
       manifest->streams = g_slist_append (manifest->streams, stream);
-      _gst_mss_stream_init (stream, nodeiter);
+      _gst_mss_stream_init (manifest, stream, nodeiter);
     }
   }
 
-  gst_buffer_unmap (data, &mapinfo);
+  /* everything we need was extracted, the document is not needed anymore */
+  xmlFreeDoc (xml);
 
   return manifest;
 }
@@ -258,12 +456,10 @@ gst_mss_manifest_new (GstBuffer * data)
 static void
 gst_mss_stream_free (GstMssStream * stream)
 {
-  g_list_free_full (stream->fragments, g_free);
+  g_array_free (stream->fragments, TRUE);
   g_list_free_full (stream->qualities,
       (GDestroyNotify) gst_mss_stream_quality_free);
   xmlFree (stream->url);
-  g_regex_unref (stream->regex_position);
-  g_regex_unref (stream->regex_bitrate);
   g_free (stream);
 }
 
@@ -274,7 +470,6 @@ gst_mss_manifest_free (GstMssManifest * manifest)
 
   g_slist_free_full (manifest->streams, (GDestroyNotify) gst_mss_stream_free);
 
-  xmlFreeDoc (manifest->xml);
   g_free (manifest);
 }
 
@@ -287,19 +482,7 @@ gst_mss_manifest_get_streams (GstMssManifest * manifest)
 GstMssStreamType
 gst_mss_stream_get_type (GstMssStream * stream)
 {
-  gchar *prop = (gchar *) xmlGetProp (stream->xmlnode, (xmlChar *) "Type");
-  GstMssStreamType ret = MSS_STREAM_TYPE_UNKNOWN;
-
-  if (prop == NULL)
-    return MSS_STREAM_TYPE_UNKNOWN;
-
-  if (strcmp (prop, "video") == 0) {
-    ret = MSS_STREAM_TYPE_VIDEO;
-  } else if (strcmp (prop, "audio") == 0) {
-    ret = MSS_STREAM_TYPE_AUDIO;
-  }
-  xmlFree (prop);
-  return ret;
+  return stream->type;
 }
 
 static GstCaps *
@@ -451,9 +634,9 @@ _gst_mss_stream_add_h264_codec_data (GstCaps * caps, const gchar * codecdatastr)
 }
 
 static GstCaps *
-_gst_mss_stream_video_caps_from_qualitylevel_xml (GstMssStreamQuality * q)
+_gst_mss_stream_video_caps_from_qualitylevel_xml (GstMssStreamQuality * q,
+    xmlNodePtr node)
 {
-  xmlNodePtr node = q->xmlnode;
   GstCaps *caps;
   GstStructure *structure;
   gchar *fourcc = (gchar *) xmlGetProp (node, (xmlChar *) "FourCC");
@@ -557,9 +740,9 @@ _make_aacl_codec_data (guint64 sampling_rate, guint64 channels)
 }
 
 static GstCaps *
-_gst_mss_stream_audio_caps_from_qualitylevel_xml (GstMssStreamQuality * q)
+_gst_mss_stream_audio_caps_from_qualitylevel_xml (GstMssStreamQuality * q,
+    xmlNodePtr node)
 {
-  xmlNodePtr node = q->xmlnode;
   GstCaps *caps;
   GstStructure *structure;
   gchar *fourcc = (gchar *) xmlGetProp (node, (xmlChar *) "FourCC");
@@ -654,54 +837,19 @@ gst_mss_stream_set_active (GstMssStream * stream, gboolean active)
 guint64
 gst_mss_stream_get_timescale (GstMssStream * stream)
 {
-  gchar *timescale;
-  guint64 ts = DEFAULT_TIMESCALE;
-
-  timescale =
-      (gchar *) xmlGetProp (stream->xmlnode, (xmlChar *) MSS_PROP_TIMESCALE);
-  if (!timescale) {
-    timescale =
-        (gchar *) xmlGetProp (stream->xmlnode->parent,
-        (xmlChar *) MSS_PROP_TIMESCALE);
-  }
-
-  if (timescale) {
-    ts = g_ascii_strtoull (timescale, NULL, 10);
-    xmlFree (timescale);
-  }
-  return ts;
+  return stream->timescale;
 }
 
 guint64
 gst_mss_manifest_get_timescale (GstMssManifest * manifest)
 {
-  gchar *timescale;
-  guint64 ts = DEFAULT_TIMESCALE;
-
-  timescale =
-      (gchar *) xmlGetProp (manifest->xmlrootnode,
-      (xmlChar *) MSS_PROP_TIMESCALE);
-  if (timescale) {
-    ts = g_ascii_strtoull (timescale, NULL, 10);
-    xmlFree (timescale);
-  }
-  return ts;
+  return manifest->timescale;
 }
 
 guint64
 gst_mss_manifest_get_duration (GstMssManifest * manifest)
 {
-  gchar *duration;
-  guint64 dur = -1;
-
-  duration =
-      (gchar *) xmlGetProp (manifest->xmlrootnode,
-      (xmlChar *) MSS_PROP_STREAM_DURATION);
-  if (duration) {
-    dur = g_ascii_strtoull (duration, NULL, 10);
-    xmlFree (duration);
-  }
-  return dur;
+  return manifest->duration;
 }
 
 
@@ -729,46 +877,45 @@ gst_mss_manifest_get_gst_duration (GstMssManifest * manifest)
 GstCaps *
 gst_mss_stream_get_caps (GstMssStream * stream)
 {
-  GstMssStreamType streamtype = gst_mss_stream_get_type (stream);
   GstMssStreamQuality *qualitylevel = stream->current_quality->data;
-  GstCaps *caps = NULL;
 
-  if (streamtype == MSS_STREAM_TYPE_VIDEO)
-    caps = _gst_mss_stream_video_caps_from_qualitylevel_xml (qualitylevel);
-  else if (streamtype == MSS_STREAM_TYPE_AUDIO)
-    caps = _gst_mss_stream_audio_caps_from_qualitylevel_xml (qualitylevel);
+  if (qualitylevel->caps == NULL)
+    return NULL;
 
-  return caps;
+  return gst_caps_ref (qualitylevel->caps);
+}
+
+static GstMssStreamFragment *
+gst_mss_stream_get_current_fragment (GstMssStream * stream)
+{
+  if (stream->current_fragment >= stream->fragments->len)
+    return NULL;
+
+  return &g_array_index (stream->fragments, GstMssStreamFragment,
+      stream->current_fragment);
 }
 
 GstFlowReturn
 gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
 {
-  gchar *tmp;
   gchar *start_time_str;
   GstMssStreamFragment *fragment;
   GstMssStreamQuality *quality = stream->current_quality->data;
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL) /* stream is over */
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (fragment == NULL)         /* stream is over */
     return GST_FLOW_EOS;
 
-  fragment = stream->current_fragment->data;
-
-  start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, fragment->time);
-
-  tmp = g_regex_replace_literal (stream->regex_bitrate, stream->url,
-      strlen (stream->url), 0, quality->bitrate_str, 0, NULL);
-  *url = g_regex_replace_literal (stream->regex_position, tmp,
-      strlen (tmp), 0, start_time_str, 0, NULL);
+  if (quality->url_parts == NULL)
+    return GST_FLOW_ERROR;
 
-  g_free (tmp);
+  start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT,
+      gst_mss_stream_fragment_time (fragment, stream->current_repetition));
+  *url = g_strjoinv (start_time_str, quality->url_parts);
   g_free (start_time_str);
 
-  if (*url == NULL)
-    return GST_FLOW_ERROR;
-
   return GST_FLOW_OK;
 }
 
@@ -776,52 +923,51 @@ GstClockTime
 gst_mss_stream_get_fragment_gst_timestamp (GstMssStream * stream)
 {
   guint64 time;
-  guint64 timescale;
   GstMssStreamFragment *fragment;
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (!stream->current_fragment)
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (!fragment)
     return GST_CLOCK_TIME_NONE;
 
-  fragment = stream->current_fragment->data;
-
-  time = fragment->time;
-  timescale = gst_mss_stream_get_timescale (stream);
+  time = gst_mss_stream_fragment_time (fragment, stream->current_repetition);
   return (GstClockTime) gst_util_uint64_scale_round (time, GST_SECOND,
-      timescale);
+      stream->timescale);
 }
 
 GstClockTime
 gst_mss_stream_get_fragment_gst_duration (GstMssStream * stream)
 {
-  guint64 dur;
-  guint64 timescale;
   GstMssStreamFragment *fragment;
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (!stream->current_fragment)
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (!fragment)
     return GST_CLOCK_TIME_NONE;
 
-  fragment = stream->current_fragment->data;
-
-  dur = fragment->duration;
-  timescale = gst_mss_stream_get_timescale (stream);
-  return (GstClockTime) gst_util_uint64_scale_round (dur, GST_SECOND,
-      timescale);
+  return (GstClockTime) gst_util_uint64_scale_round (fragment->duration,
+      GST_SECOND, stream->timescale);
 }
 
 GstFlowReturn
 gst_mss_stream_advance_fragment (GstMssStream * stream)
 {
+  GstMssStreamFragment *fragment;
+
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL)
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (fragment == NULL)
     return GST_FLOW_EOS;
 
-  stream->current_fragment = g_list_next (stream->current_fragment);
-  if (stream->current_fragment == NULL)
+  stream->current_repetition++;
+  if (stream->current_repetition >= fragment->repetitions) {
+    stream->current_fragment++;
+    stream->current_repetition = 0;
+  }
+  if (stream->current_fragment >= stream->fragments->len)
     return GST_FLOW_EOS;
   return GST_FLOW_OK;
 }
@@ -858,6 +1004,25 @@ gst_mss_manifest_seek (GstMssManifest * manifest, guint64 time)
   return ret;
 }
 
+/* index of the first fragment run that starts after @time */
+static guint
+gst_mss_stream_find_fragment (GstMssStream * stream, guint64 time)
+{
+  guint lower = 0, upper = stream->fragments->len;
+
+  while (lower < upper) {
+    guint middle = lower + (upper - lower) / 2;
+    GstMssStreamFragment *fragment =
+        &g_array_index (stream->fragments, GstMssStreamFragment, middle);
+
+    if (fragment->time > time)
+      upper = middle;
+    else
+      lower = middle + 1;
+  }
+  return lower;
+}
+
 /**
  * Seeks this stream to the fragment that contains the sample at time
  *
@@ -866,32 +1031,38 @@ gst_mss_manifest_seek (GstMssManifest * manifest, guint64 time)
 gboolean
 gst_mss_stream_seek (GstMssStream * stream, guint64 time)
 {
-  GList *iter;
-  guint64 timescale;
+  GstMssStreamFragment *fragment;
+  guint index;
+  guint64 repetition = 0;
 
-  timescale = gst_mss_stream_get_timescale (stream);
-  time = gst_util_uint64_scale_round (time, timescale, GST_SECOND);
+  time = gst_util_uint64_scale_round (time, stream->timescale, GST_SECOND);
 
-  for (iter = stream->fragments; iter; iter = g_list_next (iter)) {
-    GList *next = g_list_next (iter);
-    if (next) {
-      GstMssStreamFragment *fragment = next->data;
+  index = gst_mss_stream_find_fragment (stream, time);
+  if (index == 0) {
+    /* before the first fragment */
+    stream->current_fragment = 0;
+    stream->current_repetition = 0;
+    return TRUE;
+  }
 
-      if (fragment->time > time) {
-        stream->current_fragment = iter;
-        break;
-      }
-    } else {
-      GstMssStreamFragment *fragment = iter->data;
-      if (fragment->time + fragment->duration > time) {
-        stream->current_fragment = iter;
-      } else {
-        stream->current_fragment = NULL;        /* EOS */
-      }
-      break;
+  index--;
+  fragment = &g_array_index (stream->fragments, GstMssStreamFragment, index);
+  if (fragment->duration > 0)
+    repetition = (time - fragment->time) / fragment->duration;
+
+  if (repetition >= fragment->repetitions) {
+    if (index == stream->fragments->len - 1) {
+      stream->current_fragment = stream->fragments->len;        /* EOS */
+      stream->current_repetition = 0;
+      return TRUE;
     }
+    /* in a gap before the next run */
+    repetition = fragment->repetitions - 1;
   }
 
+  stream->current_fragment = index;
+  stream->current_repetition = repetition;
+
   return TRUE;
 }
 
@@ -920,134 +1091,148 @@ gst_mss_manifest_is_live (GstMssManifest * manifest)
   return manifest->is_live;
 }
 
+/* drops the fragments before the current one, they are not going to be
+ * requested anymore and live manifests only keep growing */
 static void
-gst_mss_stream_reload_fragments (GstMssStream * stream, xmlNodePtr streamIndex)
+gst_mss_stream_drop_old_fragments (GstMssStream * stream)
 {
-  xmlNodePtr iter;
-  GList *new_fragments = NULL;
-  GstMssStreamFragment *previous_fragment = NULL;
-  GstMssStreamFragment *current_fragment =
-      stream->current_fragment ? stream->current_fragment->data : NULL;
-  guint64 current_time = gst_mss_stream_get_fragment_gst_timestamp (stream);
-  guint fragment_number = 0;
-  guint64 fragment_time_accum = 0;
-
-  if (!current_fragment && stream->fragments) {
-    current_fragment = g_list_last (stream->fragments)->data;
-  } else if (g_list_previous (stream->current_fragment)) {
-    /* rewind one as this is the next to be pushed */
-    current_fragment = g_list_previous (stream->current_fragment)->data;
-  } else {
-    current_fragment = NULL;
-  }
+  GstMssStreamFragment *fragment;
 
-  if (current_fragment) {
-    current_time = current_fragment->time;
-    fragment_number = current_fragment->number;
-    fragment_time_accum = current_fragment->time;
-  }
+  if (stream->current_fragment >= stream->fragments->len)
+    return;
 
-  for (iter = streamIndex->children; iter; iter = iter->next) {
-    if (node_has_type (iter, MSS_NODE_STREAM_FRAGMENT)) {
-      gchar *duration_str;
-      gchar *time_str;
-      gchar *seqnum_str;
-      GstMssStreamFragment *fragment = g_new (GstMssStreamFragment, 1);
-
-      duration_str = (gchar *) xmlGetProp (iter, (xmlChar *) MSS_PROP_DURATION);
-      time_str = (gchar *) xmlGetProp (iter, (xmlChar *) MSS_PROP_TIME);
-      seqnum_str = (gchar *) xmlGetProp (iter, (xmlChar *) MSS_PROP_NUMBER);
-
-      /* use the node's seq number or use the previous + 1 */
-      if (seqnum_str) {
-        fragment->number = g_ascii_strtoull (seqnum_str, NULL, 10);
-        xmlFree (seqnum_str);
-      } else {
-        fragment->number = fragment_number;
-      }
-      fragment_number = fragment->number + 1;
+  if (stream->current_fragment > 0) {
+    g_array_remove_range (stream->fragments, 0, stream->current_fragment);
+    stream->current_fragment = 0;
+  }
 
-      if (time_str) {
-        fragment->time = g_ascii_strtoull (time_str, NULL, 10);
-        xmlFree (time_str);
-        fragment_time_accum = fragment->time;
-      } else {
-        fragment->time = fragment_time_accum;
-      }
+  fragment = &g_array_index (stream->fragments, GstMssStreamFragment, 0);
+  fragment->time = gst_mss_stream_fragment_time (fragment,
+      stream->current_repetition);
+  fragment->number += stream->current_repetition;
+  fragment->repetitions -= stream->current_repetition;
+  stream->current_repetition = 0;
+}
 
-      /* if we have a previous fragment, means we need to set its duration */
-      if (previous_fragment)
-        previous_fragment->duration = fragment->time - previous_fragment->time;
+static void
+gst_mss_stream_reload_fragments (GstMssStream * stream,
+    xmlTextReaderPtr reader, guint64 end)
+{
+  GstMssFragmentParser parser;
+  GstMssStreamFragment *fragment;
+  guint64 position = 0;
+  gint depth = xmlTextReaderDepth (reader);
+
+  /* remember where we are to restore the position after the reload */
+  fragment = gst_mss_stream_get_current_fragment (stream);
+  if (fragment) {
+    position = gst_mss_stream_fragment_time (fragment,
+        stream->current_repetition);
+  } else if (stream->fragments->len > 0) {
+    fragment = &g_array_index (stream->fragments, GstMssStreamFragment,
+        stream->fragments->len - 1);
+    position = gst_mss_stream_fragment_time (fragment,
+        fragment->repetitions - 1) + 1;
+  }
 
-      if (duration_str) {
-        fragment->duration = g_ascii_strtoull (duration_str, NULL, 10);
+  gst_mss_fragment_parser_init (&parser);
+
+  if (!xmlTextReaderIsEmptyElement (reader)) {
+    while (xmlTextReaderRead (reader) == 1
+        && xmlTextReaderDepth (reader) > depth) {
+      if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT
+          && xmlTextReaderDepth (reader) == depth + 1
+          && strcmp ((const gchar *) xmlTextReaderConstLocalName (reader),
+              MSS_NODE_STREAM_FRAGMENT) == 0) {
+        gchar *duration_str;
+        gchar *time_str;
+        gchar *seqnum_str;
+
+        duration_str = (gchar *) xmlTextReaderGetAttribute (reader,
+            (xmlChar *) MSS_PROP_DURATION);
+        time_str = (gchar *) xmlTextReaderGetAttribute (reader,
+            (xmlChar *) MSS_PROP_TIME);
+        seqnum_str = (gchar *) xmlTextReaderGetAttribute (reader,
+            (xmlChar *) MSS_PROP_NUMBER);
+
+        /* only fragments after the last known one are appended */
+        gst_mss_fragment_parser_push (&parser, stream, seqnum_str, time_str,
+            duration_str);
 
-        previous_fragment = NULL;
-        fragment_time_accum += fragment->duration;
         xmlFree (duration_str);
-      } else {
-        /* store to set the duration at the next iteration */
-        previous_fragment = fragment;
-      }
-
-      if (fragment->time > current_time) {
-        new_fragments = g_list_append (new_fragments, fragment);
-      } else {
-        previous_fragment = NULL;
-        g_free (fragment);
+        xmlFree (time_str);
+        xmlFree (seqnum_str);
       }
-
-    } else {
-      /* TODO gst log this */
     }
   }
-
-  /* store the new fragments list */
-  if (new_fragments) {
-    g_list_free_full (stream->fragments, g_free);
-    stream->fragments = new_fragments;
-    stream->current_fragment = new_fragments;
-  }
-}
-
-static void
-gst_mss_manifest_reload_fragments_from_xml (GstMssManifest * manifest,
-    xmlNodePtr root)
-{
-  xmlNodePtr nodeiter;
-  GSList *streams = manifest->streams;
-
-  /* we assume the server is providing the streams in the same order in
-   * every manifest */
-  for (nodeiter = root->children; nodeiter && streams;
-      nodeiter = nodeiter->next) {
-    if (nodeiter->type == XML_ELEMENT_NODE
-        && (strcmp ((const char *) nodeiter->name, "StreamIndex") == 0)) {
-      gst_mss_stream_reload_fragments (streams->data, nodeiter);
-      streams = g_slist_next (streams);
+  gst_mss_fragment_parser_finish (&parser, stream, end);
+
+  /* position on the first fragment that wasn't downloaded yet */
+  stream->current_fragment = gst_mss_stream_find_fragment (stream, position);
+  stream->current_repetition = 0;
+  if (stream->current_fragment > 0) {
+    fragment = &g_array_index (stream->fragments, GstMssStreamFragment,
+        stream->current_fragment - 1);
+    if (fragment->duration > 0 && position > fragment->time) {
+      guint64 repetition =
+          (position - fragment->time + fragment->duration - 1) /
+          fragment->duration;
+
+      if (repetition < fragment->repetitions) {
+        stream->current_fragment--;
+        stream->current_repetition = repetition;
+      }
+    } else if (position == fragment->time) {
+      stream->current_fragment--;
     }
   }
+
+  gst_mss_stream_drop_old_fragments (stream);
 }
 
 void
 gst_mss_manifest_reload_fragments (GstMssManifest * manifest, GstBuffer * data)
 {
-  xmlDocPtr xml;
-  xmlNodePtr root;
+  xmlTextReaderPtr reader;
+  GSList *streams = manifest->streams;
   GstMapInfo info;
 
   g_return_if_fail (manifest->is_live);
 
   gst_buffer_map (data, &info, GST_MAP_READ);
 
-  xml = xmlReadMemory ((const gchar *) info.data,
-      info.size, "manifest", NULL, 0);
-  root = xmlDocGetRootElement (xml);
+  reader = xmlReaderForMemory ((const gchar *) info.data, info.size,
+      "manifest", NULL, 0);
+  if (reader == NULL) {
+    gst_buffer_unmap (data, &info);
+    return;
+  }
 
-  gst_mss_manifest_reload_fragments_from_xml (manifest, root);
+  /* we assume the server is providing the streams in the same order in
+   * every manifest */
+  while (streams && xmlTextReaderRead (reader) == 1) {
+    if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT)
+      continue;
 
-  xmlFreeDoc (xml);
+    if (xmlTextReaderDepth (reader) == 0) {
+      gchar *duration_str;
+
+      duration_str = (gchar *) xmlTextReaderGetAttribute (reader,
+          (xmlChar *) MSS_PROP_STREAM_DURATION);
+      if (duration_str) {
+        manifest->duration = g_ascii_strtoull (duration_str, NULL, 10);
+        xmlFree (duration_str);
+      }
+    } else if (xmlTextReaderDepth (reader) == 1
+        && strcmp ((const gchar *) xmlTextReaderConstLocalName (reader),
+            "StreamIndex") == 0) {
+      gst_mss_stream_reload_fragments (streams->data, reader,
+          gst_mss_stream_get_end_time (manifest, streams->data));
+      streams = g_slist_next (streams);
+    }
+  }
 
+  xmlFreeTextReader (reader);
   gst_buffer_unmap (data, &info);
 }
 
@@ -0,0 +1,132 @@
+/* GStreamer
+ *
+ * band-pool-private.h: process the bands of a frame in parallel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_BAND_POOL_PRIVATE_H__
+#define __GST_BAND_POOL_PRIVATE_H__
+
+#include <glib.h>
+#include <gst/glib-compat-private.h>
+
+G_BEGIN_DECLS
+
+/* Called with the index of the band to process, from 0 to @n_bands - 1 */
+typedef void (*GstBandFunc) (gpointer user_data, gint band, gint n_bands);
+
+/* Splits the processing of a frame into bands. The first band is processed
+ * in the calling thread and the others by a thread pool, which is only
+ * created when there is more than one band. */
+typedef struct
+{
+  GstBandFunc func;
+  gpointer user_data;
+
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  gint n_bands;
+  gint bands_left;
+} GstBandPool;
+
+static inline void
+gst_band_pool_init (GstBandPool * bp, GstBandFunc func, gpointer user_data)
+{
+  bp->func = func;
+  bp->user_data = user_data;
+  bp->pool = NULL;
+  bp->n_bands = 0;
+  bp->bands_left = 0;
+  g_mutex_init (&bp->lock);
+  g_cond_init (&bp->cond);
+}
+
+/* Stops the threads, they are started again by the next
+ * gst_band_pool_configure() */
+static inline void
+gst_band_pool_stop (GstBandPool * bp)
+{
+  if (bp->pool) {
+    g_thread_pool_free (bp->pool, FALSE, TRUE);
+    bp->pool = NULL;
+  }
+  bp->n_bands = 0;
+}
+
+static inline void
+gst_band_pool_clear (GstBandPool * bp)
+{
+  gst_band_pool_stop (bp);
+  g_mutex_clear (&bp->lock);
+  g_cond_clear (&bp->cond);
+}
+
+static inline void
+gst_band_pool_thread_func (gpointer data, gpointer user_data)
+{
+  GstBandPool *bp = user_data;
+
+  bp->func (bp->user_data, GPOINTER_TO_INT (data), bp->n_bands);
+
+  g_mutex_lock (&bp->lock);
+  if (--bp->bands_left == 0)
+    g_cond_signal (&bp->cond);
+  g_mutex_unlock (&bp->lock);
+}
+
+/* Uses @n_threads bands, or one per CPU for 0, but at most @max_bands.
+ * Returns the number of bands. */
+static inline gint
+gst_band_pool_configure (GstBandPool * bp, guint n_threads, gint max_bands)
+{
+  gint n_bands = n_threads ? n_threads : g_get_num_processors ();
+
+  n_bands = CLAMP (n_bands, 1, MAX (max_bands, 1));
+  if (bp->n_bands != n_bands) {
+    gst_band_pool_stop (bp);
+    if (n_bands > 1)
+      bp->pool = g_thread_pool_new (gst_band_pool_thread_func, bp,
+          n_bands - 1, FALSE, NULL);
+    bp->n_bands = n_bands;
+  }
+
+  return n_bands;
+}
+
+/* Processes all bands and waits for them to be done */
+static inline void
+gst_band_pool_run (GstBandPool * bp)
+{
+  gint i;
+
+  /* the band index is the pool data, which can't be NULL */
+  bp->bands_left = bp->n_bands - 1;
+  for (i = 1; i < bp->n_bands; i++)
+    g_thread_pool_push (bp->pool, GINT_TO_POINTER (i), NULL);
+
+  bp->func (bp->user_data, 0, bp->n_bands);
+
+  g_mutex_lock (&bp->lock);
+  while (bp->bands_left > 0)
+    g_cond_wait (&bp->cond, &bp->lock);
+  g_mutex_unlock (&bp->lock);
+}
+
+G_END_DECLS
+
+#endif /* __GST_BAND_POOL_PRIVATE_H__ */
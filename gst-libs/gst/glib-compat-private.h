@@ -25,6 +25,10 @@
 
 #include <glib.h>
 
+#if !GLIB_CHECK_VERSION (2, 36, 0) && defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+
 G_BEGIN_DECLS
 
 #if !GLIB_CHECK_VERSION(2,25,0)
@@ -133,6 +137,21 @@ gst_g_thread_create (GThreadFunc func, gpointer data, gboolean joinable,
 }
 #endif /* GLIB_CHECK_VERSION (2, 31, 0) */
 
+#if !GLIB_CHECK_VERSION (2, 36, 0)
+#define g_get_num_processors gst_g_get_num_processors
+static inline guint
+gst_g_get_num_processors (void)
+{
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  glong n = sysconf (_SC_NPROCESSORS_ONLN);
+
+  if (n > 0)
+    return n;
+#endif
+  return 1;
+}
+#endif /* !GLIB_CHECK_VERSION (2, 36, 0) */
+
 /* adaptations */
 
 G_END_DECLS
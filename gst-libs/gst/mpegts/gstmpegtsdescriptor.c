@@ -25,6 +25,7 @@
 
 #include "mpegts.h"
 #include "gstmpegts-private.h"
+#include "gstmpegts-charsets.h"
 
 /**
  * SECTION:gstmpegtsdescriptor
@@ -131,6 +132,104 @@ static const gchar *iconvtablename[] = {
       /* Insert more here if needed */
 };
 
+/* Encodings converted with the built-in tables instead of iconv */
+static const guint16 *const charsettables[] = {
+  iso8859_1_table,
+  iso8859_2_table,
+  iso8859_3_table,
+  iso8859_4_table,
+  iso8859_5_table,
+  iso8859_6_table,
+  iso8859_7_table,
+  iso8859_8_table,
+  iso8859_9_table,
+  iso8859_10_table,
+  iso8859_11_table,
+  NULL,                         /* iso-8859-12 */
+  iso8859_13_table,
+  iso8859_14_table,
+  iso8859_15_table,
+  NULL,                         /* ISO-10646/UCS2 */
+  NULL,                         /* EUC-KR */
+  NULL,                         /* GB2312 */
+  NULL,                         /* UTF-16BE */
+  NULL,                         /* ISO-10646/UTF8 */
+  iso6937_table
+};
+
+/* The non-spacing diacritical marks 0xC1 to 0xCF of ISO 6937, as combining
+ * character and as the spacing character they give when followed by a
+ * space */
+static const gunichar iso6937_diacritics[][2] = {
+  {0x0300, 0x0060},             /* grave */
+  {0x0301, 0x00b4},             /* acute */
+  {0x0302, 0x005e},             /* circumflex */
+  {0x0303, 0x007e},             /* tilde */
+  {0x0304, 0x00af},             /* macron */
+  {0x0306, 0x02d8},             /* breve */
+  {0x0307, 0x02d9},             /* dot above */
+  {0x0308, 0x00a8},             /* diaeresis */
+  {0x0308, 0x00a8},             /* umlaut */
+  {0x030a, 0x02da},             /* ring above */
+  {0x0327, 0x00b8},             /* cedilla */
+  {0, 0},                       /* unused */
+  {0x030b, 0x02dd},             /* double acute */
+  {0x0328, 0x02db},             /* ogonek */
+  {0x030c, 0x02c7}              /* caron */
+};
+
+/* Cache of the converted strings, keyed by their raw bytes. EIT and SDT
+ * are repeated all the time and carry the same names and descriptions
+ * over and over, so each of those only has to be converted once. The
+ * number of strings kept can be set with the GST_MPEGTS_TEXT_CACHE_SIZE
+ * environment variable, up to MAX_TEXT_CACHE_SIZE, 0 disables the cache. */
+#define DEFAULT_TEXT_CACHE_SIZE 1024
+#define MAX_TEXT_CACHE_SIZE 65536
+
+typedef struct
+{
+  const guint8 *data;
+  guint length;
+  gchar *text;
+
+  /* in text_cache_lru, most recently used first */
+  GList link;
+} TextCacheEntry;
+
+static GMutex text_cache_lock;
+static GHashTable *text_cache;
+static GQueue text_cache_lru = G_QUEUE_INIT;
+static guint text_cache_size;
+
+static guint
+text_cache_entry_hash (gconstpointer key)
+{
+  const TextCacheEntry *entry = key;
+  guint hash = 5381;
+  guint i;
+
+  for (i = 0; i < entry->length; i++)
+    hash = (hash << 5) + hash + entry->data[i];
+
+  return hash;
+}
+
+static gboolean
+text_cache_entry_equal (gconstpointer a, gconstpointer b)
+{
+  const TextCacheEntry *entry_a = a, *entry_b = b;
+
+  return entry_a->length == entry_b->length &&
+      memcmp (entry_a->data, entry_b->data, entry_a->length) == 0;
+}
+
+static void
+text_cache_entry_free (TextCacheEntry * entry)
+{
+  g_free (entry->text);
+  g_free (entry);
+}
+
 void
 __initialize_descriptors (void)
 {
@@ -140,6 +239,28 @@ __initialize_descriptors (void)
   /* FIXME : How/when should we close them ??? */
   for (i = 0; i < MAX_KNOWN_ICONV; i++)
     __iconvs[i] = ((GIConv) - 1);
+
+  if (text_cache == NULL) {
+    const gchar *env = g_getenv ("GST_MPEGTS_TEXT_CACHE_SIZE");
+
+    text_cache_size = DEFAULT_TEXT_CACHE_SIZE;
+    if (env) {
+      gchar *end;
+      guint64 size;
+
+      /* g_ascii_strtoull() also accepts and negates a leading '-' */
+      size = g_ascii_strtoull (env, &end, 10);
+      if (g_ascii_isdigit (env[0]) && *end == '\0'
+          && size <= MAX_TEXT_CACHE_SIZE)
+        text_cache_size = size;
+      else
+        GST_WARNING ("Invalid GST_MPEGTS_TEXT_CACHE_SIZE '%s', must be "
+            "between 0 and %d", env, MAX_TEXT_CACHE_SIZE);
+    }
+    if (text_cache_size > 0)
+      text_cache = g_hash_table_new (text_cache_entry_hash,
+          text_cache_entry_equal);
+  }
 }
 
 /*
@@ -376,36 +497,119 @@ convert_to_utf8 (const gchar * text, gint length, guint start,
   return new_text;
 }
 
-gchar *
-get_encoding_and_convert (const gchar * text, guint length)
+/*
+ * @text: The text to convert
+ * @length: The length of the string -1 if it's nul-terminated
+ * @start: Where to start converting in the text
+ * @table: The character table of the encoding of text
+ * @error: The location to store the error, or NULL to ignore errors
+ * @returns: UTF-8 encoded string
+ *
+ * Convert text in one of the single byte encodings to UTF-8, skipping and
+ * replacing the control codes in the same pass.
+ */
+static gchar *
+convert_table_to_utf8 (const gchar * text, gint length, guint start,
+    const guint16 * table, GError ** error)
+{
+  const guint8 *data = (const guint8 *) text + start;
+  gchar *new_text, *pos;
+  gunichar c;
+  gint i;
+
+  if (length == -1)
+    length = strlen ((const gchar *) data);
+
+  /* a character, or a diacritical mark and its base character, is never
+   * more than 3 bytes in UTF-8 */
+  pos = new_text = g_malloc (length * 3 + 1);
+
+  for (i = 0; i < length; i++) {
+    guint8 code = data[i];
+
+    if (code < 0xA0) {
+      switch (code) {
+        case 0x86:             /* emphasis on */
+        case 0x87:             /* emphasis off */
+          /* skip it */
+          continue;
+        case 0x8A:
+          c = '\n';
+          break;
+        default:
+          c = code;
+          break;
+      }
+    } else if (table == iso6937_table && code >= 0xC1 && code <= 0xCF) {
+      const gunichar *mark = iso6937_diacritics[code - 0xC1];
+      guint8 base;
+
+      if (mark[0] == 0 || i + 1 >= length)
+        goto invalid;
+
+      base = data[++i];
+      if (base == 0x20)
+        c = mark[1];
+      else if (base >= 0x80 || !g_unichar_compose (base, mark[0], &c))
+        goto invalid;
+    } else {
+      c = table[code - 0xA0];
+      if (c == 0)
+        goto invalid;
+    }
+
+    pos += g_unichar_to_utf8 (c, pos);
+  }
+  *pos = '\0';
+
+  GST_DEBUG ("Converted to : %s", new_text);
+
+  return new_text;
+
+invalid:
+  g_set_error (error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+      "Invalid byte sequence in conversion input at offset %d", i);
+  g_free (new_text);
+
+  return NULL;
+}
+
+static gchar *
+convert_with_encoding (const gchar * text, gint length, guint start,
+    LocalIconvCode encoding, gboolean is_multibyte, GError ** error)
+{
+  GST_DEBUG ("Encoding %s", iconvtablename[encoding]);
+
+  if (charsettables[encoding])
+    return convert_table_to_utf8 (text, length, start,
+        charsettables[encoding], error);
+
+  if (__iconvs[encoding] == ((GIConv) - 1))
+    __iconvs[encoding] = g_iconv_open ("utf-8", iconvtablename[encoding]);
+
+  return convert_to_utf8 (text, length, start, __iconvs[encoding],
+      is_multibyte, error);
+}
+
+static gchar *
+convert_text (const gchar * text, guint length)
 {
   GError *error = NULL;
   gchar *converted_str;
   guint start_text = 0;
   gboolean is_multibyte;
   LocalIconvCode encoding;
-  GIConv giconv = (GIConv) - 1;
-
-  g_return_val_if_fail (text != NULL, NULL);
-
-  if (text == NULL || length == 0)
-    return g_strdup ("");
 
   encoding = get_encoding (text, &start_text, &is_multibyte);
 
-  if (encoding > _ICONV_UNKNOWN && encoding < _ICONV_MAX) {
-    GST_DEBUG ("Encoding %s", iconvtablename[encoding]);
-    if (__iconvs[encoding] == ((GIConv) - 1))
-      __iconvs[encoding] = g_iconv_open ("utf-8", iconvtablename[encoding]);
-    giconv = __iconvs[encoding];
-  } else {
+  if (encoding <= _ICONV_UNKNOWN || encoding >= _ICONV_MAX) {
     GST_FIXME ("Could not detect encoding. Returning NULL string");
     converted_str = NULL;
     goto beach;
   }
 
-  converted_str = convert_to_utf8 (text, length - start_text, start_text,
-      giconv, is_multibyte, &error);
+  converted_str = convert_with_encoding (text, length - start_text,
+      start_text, encoding, is_multibyte, &error);
   if (error != NULL) {
     GST_WARNING ("Could not convert string: %s", error->message);
     if (converted_str)
@@ -415,14 +619,9 @@ get_encoding_and_convert (const gchar * text, guint length)
 
     if (encoding >= _ICONV_ISO8859_2 && encoding <= _ICONV_ISO8859_15) {
       /* Sometimes using the standard 8859-1 set fixes issues */
-      GST_DEBUG ("Encoding %s", iconvtablename[_ICONV_ISO8859_1]);
-      if (__iconvs[_ICONV_ISO8859_1] == (GIConv) - 1)
-        __iconvs[_ICONV_ISO8859_1] =
-            g_iconv_open ("utf-8", iconvtablename[_ICONV_ISO8859_1]);
-      giconv = __iconvs[_ICONV_ISO8859_1];
-
       GST_INFO ("Trying encoding ISO 8859-1");
-      converted_str = convert_to_utf8 (text, length, 1, giconv, FALSE, &error);
+      converted_str = convert_with_encoding (text, length - 1, 1,
+          _ICONV_ISO8859_1, FALSE, &error);
       if (error != NULL) {
         GST_WARNING
             ("Could not convert string while assuming encoding ISO 8859-1: %s",
@@ -437,13 +636,9 @@ get_encoding_and_convert (const gchar * text, guint length)
        * provide the first byte that indicates ISO 8859-9 encoding.
        * If decoding from ISO 6937 failed, we try ISO 8859-9 here.
        */
-      if (__iconvs[_ICONV_ISO8859_9] == (GIConv) - 1)
-        __iconvs[_ICONV_ISO8859_9] =
-            g_iconv_open ("utf-8", iconvtablename[_ICONV_ISO8859_9]);
-      giconv = __iconvs[_ICONV_ISO8859_9];
-
       GST_INFO ("Trying encoding ISO 8859-9");
-      converted_str = convert_to_utf8 (text, length, 0, giconv, FALSE, &error);
+      converted_str = convert_with_encoding (text, length, 0,
+          _ICONV_ISO8859_9, FALSE, &error);
       if (error != NULL) {
         GST_WARNING
             ("Could not convert string while assuming encoding ISO 8859-9: %s",
@@ -465,6 +660,85 @@ failed:
   }
 }
 
+static gchar *
+text_cache_lookup (const gchar * text, guint length)
+{
+  TextCacheEntry key, *entry;
+  gchar *converted_str = NULL;
+
+  key.data = (const guint8 *) text;
+  key.length = length;
+
+  g_mutex_lock (&text_cache_lock);
+  entry = g_hash_table_lookup (text_cache, &key);
+  if (entry) {
+    g_queue_unlink (&text_cache_lru, &entry->link);
+    g_queue_push_head_link (&text_cache_lru, &entry->link);
+    converted_str = g_strdup (entry->text);
+  }
+  g_mutex_unlock (&text_cache_lock);
+
+  return converted_str;
+}
+
+static void
+text_cache_insert (const gchar * text, guint length,
+    const gchar * converted_str)
+{
+  TextCacheEntry *entry, *old = NULL;
+  GList *last;
+
+  /* the raw bytes are stored right after the entry */
+  entry = g_malloc (sizeof (TextCacheEntry) + length);
+  memcpy (entry + 1, text, length);
+  entry->data = (const guint8 *) (entry + 1);
+  entry->length = length;
+  entry->text = g_strdup (converted_str);
+  entry->link.data = entry;
+  entry->link.prev = entry->link.next = NULL;
+
+  g_mutex_lock (&text_cache_lock);
+  if (g_hash_table_contains (text_cache, entry)) {
+    /* converted by another thread in the meantime */
+    old = entry;
+  } else {
+    g_hash_table_insert (text_cache, entry, entry);
+    g_queue_push_head_link (&text_cache_lru, &entry->link);
+    if (text_cache_lru.length > text_cache_size) {
+      last = g_queue_pop_tail_link (&text_cache_lru);
+      old = last->data;
+      g_hash_table_remove (text_cache, old);
+    }
+  }
+  g_mutex_unlock (&text_cache_lock);
+
+  if (old)
+    text_cache_entry_free (old);
+}
+
+gchar *
+get_encoding_and_convert (const gchar * text, guint length)
+{
+  gchar *converted_str;
+
+  g_return_val_if_fail (text != NULL, NULL);
+
+  if (text == NULL || length == 0)
+    return g_strdup ("");
+
+  if (text_cache == NULL)
+    return convert_text (text, length);
+
+  converted_str = text_cache_lookup (text, length);
+  if (converted_str == NULL) {
+    converted_str = convert_text (text, length);
+    if (converted_str)
+      text_cache_insert (text, length, converted_str);
+  }
+
+  return converted_str;
+}
+
 static GstMpegTsDescriptor *
 _copy_descriptor (GstMpegTsDescriptor * desc)
 {
@@ -20,6 +20,7 @@
  */
 
 #include <glib.h>
+#include <string.h>
 #include "gstfragment.h"
 #include "gsturidownloader.h"
 #include "gsturidownloader_debug.h"
@@ -33,7 +34,7 @@ GST_DEBUG_CATEGORY (uridownloader_debug);
 
 struct _GstUriDownloaderPrivate
 {
-  /* Fragments fetcher */
+  /* Fragments fetcher, owned by sources */
   GstElement *urisrc;
   GstBus *bus;
   GstPad *pad;
@@ -41,10 +42,27 @@ struct _GstUriDownloaderPrivate
   GstFragment *download;
   GMutex download_lock;         /* used to restrict to one download only */
 
+  /* GstUriDownloaderSource, the source elements kept between downloads
+   * so that their connections can be reused. Most recently used first.
+   * Protected by download_lock. */
+  GQueue *sources;
+
   GCond cond;
   gboolean cancelled;
 };
 
+/* a source element kept for the URIs of a scheme and host, PLAYING after
+ * its last download */
+typedef struct
+{
+  gchar *key;
+  GstElement *urisrc;
+} GstUriDownloaderSource;
+
+/* more hosts than that at the same time are unusual, the sources of the
+ * others are stopped */
+#define MAX_SOURCES 4
+
 static void gst_uri_downloader_finalize (GObject * object);
 static void gst_uri_downloader_dispose (GObject * object);
 
@@ -54,6 +72,7 @@ static gboolean gst_uri_downloader_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static GstBusSyncReply gst_uri_downloader_bus_handler (GstBus * bus,
     GstMessage * message, gpointer data);
+static void gst_uri_downloader_destroy_source (gpointer data);
 
 static GstStaticPadTemplate sinkpadtemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -102,6 +121,8 @@ gst_uri_downloader_init (GstUriDownloader * downloader)
 
   g_mutex_init (&downloader->priv->download_lock);
   g_cond_init (&downloader->priv->cond);
+
+  downloader->priv->sources = g_queue_new ();
 }
 
 static void
@@ -109,9 +130,11 @@ gst_uri_downloader_dispose (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
-  if (downloader->priv->urisrc != NULL) {
-    gst_object_unref (downloader->priv->urisrc);
-    downloader->priv->urisrc = NULL;
+  downloader->priv->urisrc = NULL;
+  if (downloader->priv->sources != NULL) {
+    g_queue_free_full (downloader->priv->sources,
+        gst_uri_downloader_destroy_source);
+    downloader->priv->sources = NULL;
   }
 
   if (downloader->priv->bus != NULL) {
@@ -239,6 +262,10 @@ gst_uri_downloader_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   GST_LOG_OBJECT (downloader, "The uri fetcher received a new buffer "
       "of size %" G_GSIZE_FORMAT, gst_buffer_get_size (buf));
+  if (!GST_CLOCK_TIME_IS_VALID (downloader->priv->download->
+          download_first_byte_time))
+    downloader->priv->download->download_first_byte_time =
+        gst_util_get_timestamp ();
   if (!gst_fragment_add_buffer (downloader->priv->download, buf))
     GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
   GST_OBJECT_UNLOCK (downloader);
@@ -249,17 +276,103 @@ done:
   }
 }
 
-/* Must be called with mutex locked. */
+static void
+gst_uri_downloader_destroy_source (gpointer data)
+{
+  GstUriDownloaderSource *source = data;
+  GstElement *urisrc = source->urisrc;
+
+  GST_DEBUG ("Stopping source element %s", GST_ELEMENT_NAME (urisrc));
+
+  /* set the element state to NULL */
+  gst_element_set_state (urisrc, GST_STATE_NULL);
+  gst_element_get_state (urisrc, NULL, NULL, GST_CLOCK_TIME_NONE);
+  gst_element_set_bus (urisrc, NULL);
+  gst_object_unref (urisrc);
+
+  g_free (source->key);
+  g_slice_free (GstUriDownloaderSource, source);
+}
+
+static gint
+gst_uri_downloader_source_compare (gconstpointer a, gconstpointer b)
+{
+  const GstUriDownloaderSource *source = a;
+
+  return strcmp (source->key, b);
+}
+
+/* the source element kept for @key, which becomes the most recently used
+ * one, or NULL */
+static GstElement *
+gst_uri_downloader_lookup_source (GstUriDownloader * downloader,
+    const gchar * key)
+{
+  GQueue *sources = downloader->priv->sources;
+  GList *link;
+
+  link = g_queue_find_custom (sources, key, gst_uri_downloader_source_compare);
+  if (link == NULL)
+    return NULL;
+
+  g_queue_unlink (sources, link);
+  g_queue_push_head_link (sources, link);
+
+  return ((GstUriDownloaderSource *) link->data)->urisrc;
+}
+
+/* keeps @urisrc for @key and moves the least recently used sources above
+ * MAX_SOURCES to @dropped. Setting them to NULL waits for their streaming
+ * threads, which can post messages to the sync handler of the bus, so they
+ * must be stopped without the object lock. */
+static void
+gst_uri_downloader_add_source (GstUriDownloader * downloader,
+    const gchar * key, GstElement * urisrc, GList ** dropped)
+{
+  GQueue *sources = downloader->priv->sources;
+  GstUriDownloaderSource *source;
+
+  source = g_slice_new (GstUriDownloaderSource);
+  source->key = g_strdup (key);
+  source->urisrc = urisrc;
+  g_queue_push_head (sources, source);
+
+  while (g_queue_get_length (sources) > MAX_SOURCES) {
+    source = g_queue_pop_tail (sources);
+    GST_DEBUG_OBJECT (downloader, "Dropping the source element of %s",
+        source->key);
+    *dropped = g_list_prepend (*dropped, source);
+  }
+}
+
+/* moves the source kept for @key to @dropped, to be stopped without the
+ * object lock */
+static void
+gst_uri_downloader_remove_source (GstUriDownloader * downloader,
+    const gchar * key, GList ** dropped)
+{
+  GQueue *sources = downloader->priv->sources;
+  GList *link;
+
+  link = g_queue_find_custom (sources, key, gst_uri_downloader_source_compare);
+  if (link == NULL)
+    return;
+
+  *dropped = g_list_prepend (*dropped, link->data);
+  g_queue_delete_link (sources, link);
+}
+
+/* Detaches the source element, which stays in the sources list.
+ * Must be called with mutex locked. */
 static void
 gst_uri_downloader_stop (GstUriDownloader * downloader)
 {
   GstPad *pad;
-  GstElement *urisrc;
 
   if (!downloader->priv->urisrc)
     return;
 
-  GST_DEBUG_OBJECT (downloader, "Stopping source element %s",
+  GST_DEBUG_OBJECT (downloader, "Detaching source element %s",
       GST_ELEMENT_NAME (downloader->priv->urisrc));
 
   /* remove the bus' sync handler */
@@ -270,18 +383,9 @@ gst_uri_downloader_stop (GstUriDownloader * downloader)
     gst_pad_unlink (pad, downloader->priv->pad);
     gst_object_unref (pad);
   }
-  urisrc = downloader->priv->urisrc;
   downloader->priv->urisrc = NULL;
 
-  GST_DEBUG_OBJECT (downloader, "Stopping source element %s",
-      GST_ELEMENT_NAME (urisrc));
-
-  /* set the element state to NULL */
   gst_bus_set_flushing (downloader->priv->bus, TRUE);
-  gst_element_set_state (urisrc, GST_STATE_NULL);
-  gst_element_get_state (urisrc, NULL, NULL, GST_CLOCK_TIME_NONE);
-  gst_element_set_bus (urisrc, NULL);
-  gst_object_unref (urisrc);
 }
 
 void
@@ -317,14 +421,16 @@ gst_uri_downloader_cancel (GstUriDownloader * downloader)
   GST_OBJECT_UNLOCK (downloader);
 }
 
+/* A source that is reused is restarted with a seek even for the whole
+ * resource */
 static gboolean
 gst_uri_downloader_set_range (GstUriDownloader * downloader,
-    gint64 range_start, gint64 range_end)
+    gint64 range_start, gint64 range_end, gboolean restart)
 {
   g_return_val_if_fail (range_start >= 0, FALSE);
   g_return_val_if_fail (range_end >= -1, FALSE);
 
-  if (range_start || (range_end >= 0)) {
+  if (restart || range_start || (range_end >= 0)) {
     GstEvent *seek;
 
     seek = gst_event_new_seek (1.0, GST_FORMAT_BYTES, GST_SEEK_FLAG_FLUSH,
@@ -335,9 +441,27 @@ gst_uri_downloader_set_range (GstUriDownloader * downloader,
   return TRUE;
 }
 
+/* scheme, user info, host and port of @uri */
+static gchar *
+gst_uri_downloader_get_source_key (const gchar * uri)
+{
+  const gchar *host, *end;
+
+  host = strstr (uri, "://");
+  if (host == NULL)
+    return gst_uri_get_protocol (uri);
+
+  host += 3;
+  end = host + strcspn (host, "/?#");
+
+  return g_strndup (uri, end - uri);
+}
+
 static gboolean
-gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri)
+gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
+    const gchar * key, gboolean * reused, GList ** dropped)
 {
+  GstElement *urisrc;
   GstPad *pad;
 
   if (!gst_uri_is_valid (uri))
@@ -345,15 +469,38 @@ gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri)
 
   g_assert (downloader->priv->urisrc == NULL);
 
-  GST_DEBUG_OBJECT (downloader, "Creating source element for the URI:%s", uri);
-  downloader->priv->urisrc =
-      gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
-  if (!downloader->priv->urisrc)
-    return FALSE;
+  *reused = FALSE;
+  urisrc = gst_uri_downloader_lookup_source (downloader, key);
+  if (urisrc) {
+    GError *err = NULL;
+
+    if (gst_uri_handler_set_uri (GST_URI_HANDLER (urisrc), uri, &err)) {
+      GST_DEBUG_OBJECT (downloader, "Reusing source element %s for the URI:%s",
+          GST_ELEMENT_NAME (urisrc), uri);
+      *reused = TRUE;
+    } else {
+      GST_DEBUG_OBJECT (downloader, "Can't reuse source element %s: %s",
+          GST_ELEMENT_NAME (urisrc), err ? err->message : "unknown error");
+      g_clear_error (&err);
+      gst_uri_downloader_remove_source (downloader, key, dropped);
+      urisrc = NULL;
+    }
+  }
+
+  if (urisrc == NULL) {
+    GST_DEBUG_OBJECT (downloader, "Creating source element for the URI:%s",
+        uri);
+    urisrc = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+    if (!urisrc)
+      return FALSE;
+
+    gst_element_set_bus (urisrc, downloader->priv->bus);
+    gst_uri_downloader_add_source (downloader, key,
+        gst_object_ref_sink (urisrc), dropped);
+  }
+  downloader->priv->urisrc = urisrc;
 
   /* add a sync handler for the bus messages to detect errors in the download */
-  gst_element_set_bus (GST_ELEMENT (downloader->priv->urisrc),
-      downloader->priv->bus);
   gst_bus_set_sync_handler (downloader->priv->bus,
       gst_uri_downloader_bus_handler, downloader, NULL);
 
@@ -378,6 +525,10 @@ gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri)
  * @range_start: the starting byte index
  * @range_end: the final byte index, use -1 for unspecified
  *
+ * The source element of a successful download is kept and reused for the
+ * next URI on the same host, so that its connection can be kept alive.
+ * Only the sources of the 4 most recently used hosts are kept.
+ *
  * Returns the downloaded #GstFragment
  */
 GstFragment *
@@ -386,6 +537,9 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader,
 {
   GstStateChangeReturn ret;
   GstFragment *download = NULL;
+  gchar *key = NULL;
+  GList *dropped = NULL;
+  gboolean reused, drop;
 
   GST_DEBUG_OBJECT (downloader, "Fetching URI %s", uri);
 
@@ -397,45 +551,76 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader,
     goto quit;
   }
 
-  if (!gst_uri_downloader_set_uri (downloader, uri)) {
+  key = gst_uri_downloader_get_source_key (uri);
+
+retry:
+  if (!gst_uri_downloader_set_uri (downloader, uri, key, &reused, &dropped)) {
     GST_WARNING_OBJECT (downloader, "Failed to set URI");
     goto quit;
   }
 
   gst_bus_set_flushing (downloader->priv->bus, FALSE);
   downloader->priv->download = gst_fragment_new ();
-  GST_OBJECT_UNLOCK (downloader);
-  ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_READY);
-  GST_OBJECT_LOCK (downloader);
-  if (ret == GST_STATE_CHANGE_FAILURE || downloader->priv->download == NULL) {
-    GST_WARNING_OBJECT (downloader, "Failed to set src to READY");
-    goto quit;
-  }
+  downloader->priv->download->source_reused = reused;
 
-  /* might have been cancelled because of failures in state change */
-  if (downloader->priv->cancelled) {
-    goto quit;
-  }
+  if (reused) {
+    gboolean res;
 
-  if (!gst_uri_downloader_set_range (downloader, range_start, range_end)) {
-    GST_WARNING_OBJECT (downloader, "Failed to set range");
-    goto quit;
-  }
+    /* the source is still PLAYING after the previous download, a flushing
+     * seek restarts it on the new URI */
+    GST_OBJECT_UNLOCK (downloader);
+    res = gst_uri_downloader_set_range (downloader, range_start, range_end,
+        TRUE);
+    GST_OBJECT_LOCK (downloader);
+    if (downloader->priv->cancelled)
+      goto quit;
+
+    if (!res || downloader->priv->download == NULL) {
+      GST_DEBUG_OBJECT (downloader, "Failed to restart the source element, "
+          "creating a new one");
+      if (downloader->priv->download) {
+        g_object_unref (downloader->priv->download);
+        downloader->priv->download = NULL;
+      }
+      gst_uri_downloader_stop (downloader);
+      gst_uri_downloader_remove_source (downloader, key, &dropped);
+      goto retry;
+    }
+  } else {
+    GST_OBJECT_UNLOCK (downloader);
+    ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_READY);
+    GST_OBJECT_LOCK (downloader);
+    if (ret == GST_STATE_CHANGE_FAILURE || downloader->priv->download == NULL) {
+      GST_WARNING_OBJECT (downloader, "Failed to set src to READY");
+      goto quit;
+    }
 
-  GST_OBJECT_UNLOCK (downloader);
-  ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_PLAYING);
-  GST_OBJECT_LOCK (downloader);
-  if (ret == GST_STATE_CHANGE_FAILURE) {
-    if (downloader->priv->download) {
-      g_object_unref (downloader->priv->download);
-      downloader->priv->download = NULL;
+    /* might have been cancelled because of failures in state change */
+    if (downloader->priv->cancelled) {
+      goto quit;
     }
-    goto quit;
-  }
 
-  /* might have been cancelled because of failures in state change */
-  if (downloader->priv->cancelled) {
-    goto quit;
+    if (!gst_uri_downloader_set_range (downloader, range_start, range_end,
+            FALSE)) {
+      GST_WARNING_OBJECT (downloader, "Failed to set range");
+      goto quit;
+    }
+
+    GST_OBJECT_UNLOCK (downloader);
+    ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_PLAYING);
+    GST_OBJECT_LOCK (downloader);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+      if (downloader->priv->download) {
+        g_object_unref (downloader->priv->download);
+        downloader->priv->download = NULL;
+      }
+      goto quit;
+    }
+
+    /* might have been cancelled because of failures in state change */
+    if (downloader->priv->cancelled) {
+      goto quit;
+    }
   }
 
   /* wait until:
@@ -447,25 +632,45 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader,
   g_cond_wait (&downloader->priv->cond, GST_OBJECT_GET_LOCK (downloader));
 
   if (downloader->priv->cancelled) {
-    if (downloader->priv->download) {
-      g_object_unref (downloader->priv->download);
-      downloader->priv->download = NULL;
-    }
     goto quit;
   }
 
   download = downloader->priv->download;
   downloader->priv->download = NULL;
 
-  if (download != NULL)
-    GST_INFO_OBJECT (downloader, "URI fetched successfully");
-  else
+  if (download != NULL) {
+    GstClockTime latency = GST_CLOCK_TIME_NONE;
+
+    if (GST_CLOCK_TIME_IS_VALID (download->download_first_byte_time))
+      latency = download->download_first_byte_time -
+          download->download_start_time;
+    GST_INFO_OBJECT (downloader, "URI fetched successfully, first byte after %"
+        GST_TIME_FORMAT ", total %" GST_TIME_FORMAT ", %s source",
+        GST_TIME_ARGS (latency),
+        GST_TIME_ARGS (download->download_stop_time -
+            download->download_start_time), reused ? "reused" : "new");
+  } else {
     GST_INFO_OBJECT (downloader, "Error fetching URI");
+  }
 
 quit:
   {
+    /* the source of a failed or cancelled download is in an unknown state */
+    drop = (download == NULL && downloader->priv->urisrc != NULL);
+    if (downloader->priv->download) {
+      g_object_unref (downloader->priv->download);
+      downloader->priv->download = NULL;
+    }
     gst_uri_downloader_stop (downloader);
     GST_OBJECT_UNLOCK (downloader);
+
+    /* stop them without the object lock, their streaming threads might
+     * wait for it */
+    if (drop)
+      gst_uri_downloader_remove_source (downloader, key, &dropped);
+    g_list_free_full (dropped, gst_uri_downloader_destroy_source);
+    g_free (key);
+
     g_mutex_unlock (&downloader->priv->download_lock);
     return download;
   }
@@ -27,6 +27,10 @@
  * It also provides several background shading effects. These effects are
  * applied to a previous picture before the render() implementation can draw a
  * new frame.
+ *
+ * With the downscale property set, the render() implementation and the
+ * shading work on a frame that is smaller than the negotiated output, which
+ * is then scaled up.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -35,6 +39,10 @@
 
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <gst/video/video.h>
 #include <gst/video/gstvideometa.h>
 #include <gst/video/gstvideopool.h>
@@ -46,12 +54,14 @@ GST_DEBUG_CATEGORY_STATIC (audio_visualizer_debug);
 
 #define DEFAULT_SHADER GST_AUDIO_VISUALIZER_SHADER_FADE
 #define DEFAULT_SHADE_AMOUNT   0x000a0a0a
+#define DEFAULT_DOWNSCALE      1
 
 enum
 {
   PROP_0,
   PROP_SHADER,
-  PROP_SHADE_AMOUNT
+  PROP_SHADE_AMOUNT,
+  PROP_DOWNSCALE
 };
 
 static GstBaseTransformClass *parent_class = NULL;
@@ -133,38 +143,74 @@ gst_audio_visualizer_shader_get_type (void)
 }
 
 /* we're only supporting GST_VIDEO_FORMAT_xRGB right now) */
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-
-#define SHADE(_d, _s, _i, _r, _g, _b)                     \
-G_STMT_START {                                            \
-    _d[_i * 4 + 0] = (_s[_i * 4 + 0] > _b) ? _s[_i * 4 + 0] - _b : 0; \
-    _d[_i * 4 + 1] = (_s[_i * 4 + 1] > _g) ? _s[_i * 4 + 1] - _g : 0; \
-    _d[_i * 4 + 2] = (_s[_i * 4 + 2] > _r) ? _s[_i * 4 + 2] - _r : 0; \
-    _d[_i * 4 + 3] = 0;                                       \
-} G_STMT_END
-
-#else /* G_BYTE_ORDER == G_LITTLE_ENDIAN */
-
-#define SHADE(_d, _s, _i, _r, _g, _b)                     \
-G_STMT_START {                                            \
-    _d[_i * 4 + 0] = 0;                                       \
-    _d[_i * 4 + 1] = (_s[_i * 4 + 1] > _r) ? _s[_i * 4 + 1] - _r : 0; \
-    _d[_i * 4 + 2] = (_s[_i * 4 + 2] > _g) ? _s[_i * 4 + 2] - _g : 0; \
-    _d[_i * 4 + 3] = (_s[_i * 4 + 3] > _b) ? _s[_i * 4 + 3] - _b : 0; \
-} G_STMT_END
 
+/* The shade amount as a native endian pixel with all bits set in the x byte,
+ * so that the saturating subtraction also clears the padding. */
+#define SHADE_AMOUNT(scope) (0xff000000 | ((scope)->shade_amount & 0x00ffffff))
+
+/* subtracts the bytes of @amount from the ones of @p with saturation, two
+ * pixels at once: t is the per byte difference, bit 7 of each byte in borrow
+ * tells where it wrapped around */
+static inline guint64
+shade_pixels (guint64 p, guint64 amount)
+{
+  const guint64 h = G_GUINT64_CONSTANT (0x8080808080808080);
+  guint64 t, borrow;
+
+  t = ((p | h) - (amount & ~h)) ^ ((p ^ ~amount) & h);
+  borrow = ((~p & amount) | (~(p ^ amount) & t)) & h;
+
+  return t & ~((borrow >> 7) * 0xff);
+}
+
+/* fades @width pixels from @s into @d by subtracting @amount from each
+ * component with saturation */
+static void
+shade_line (guint8 * d, const guint8 * s, gint width, guint32 amount)
+{
+  guint64 amount2 = ((guint64) amount << 32) | amount;
+  gint i = 0;
+
+#ifdef __SSE2__
+  __m128i va = _mm_set1_epi32 (amount);
+
+  for (; i + 8 <= width; i += 8) {
+    __m128i s0 = _mm_loadu_si128 ((const __m128i *) (s + i * 4));
+    __m128i s1 = _mm_loadu_si128 ((const __m128i *) (s + i * 4 + 16));
+
+    _mm_storeu_si128 ((__m128i *) (d + i * 4), _mm_subs_epu8 (s0, va));
+    _mm_storeu_si128 ((__m128i *) (d + i * 4 + 16), _mm_subs_epu8 (s1, va));
+  }
+  for (; i + 4 <= width; i += 4) {
+    __m128i s0 = _mm_loadu_si128 ((const __m128i *) (s + i * 4));
+
+    _mm_storeu_si128 ((__m128i *) (d + i * 4), _mm_subs_epu8 (s0, va));
+  }
 #endif
 
+  for (; i + 2 <= width; i += 2) {
+    guint64 p;
+
+    /* the moving shaders shift by one pixel, not always 8 byte aligned */
+    memcpy (&p, s + i * 4, 8);
+    p = shade_pixels (p, amount2);
+    memcpy (d + i * 4, &p, 8);
+  }
+  if (i < width)
+    ((guint32 *) d)[i] = shade_pixels (((const guint32 *) s)[i], amount);
+}
+
+/* The shaders below fade whole rows with shade_line(). The moving ones shift
+ * by one pixel by offsetting the source or destination row, which is fine as
+ * the source and destination frames never overlap. */
+
 static void
 shader_fade (GstAudioVisualizer * scope, const GstVideoFrame * sframe,
     GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -174,10 +220,14 @@ shader_fade (GstAudioVisualizer * scope, const GstVideoFrame * sframe,
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
+  if (ss == ds && ss == width * 4) {
+    /* contiguous frames, fade them in one go */
+    shade_line (d, s, width * height, amount);
+    return;
+  }
+
   for (j = 0; j < height; j++) {
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
+    shade_line (d, s, width, amount);
     s += ss;
     d += ds;
   }
@@ -187,12 +237,9 @@ static void
 shader_fade_and_move_up (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -202,25 +249,17 @@ shader_fade_and_move_up (GstAudioVisualizer * scope,
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
-  for (j = 1; j < height; j++) {
-    s += ss;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-  }
+  for (j = 0; j < height - 1; j++)
+    shade_line (d + j * ds, s + (j + 1) * ss, width, amount);
 }
 
 static void
 shader_fade_and_move_down (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -230,25 +269,17 @@ shader_fade_and_move_down (GstAudioVisualizer * scope,
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
-  for (j = 1; j < height; j++) {
-    d += ds;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
-  }
+  for (j = 0; j < height - 1; j++)
+    shade_line (d + (j + 1) * ds, s + j * ss, width, amount);
 }
 
 static void
 shader_fade_and_move_left (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -258,29 +289,18 @@ shader_fade_and_move_left (GstAudioVisualizer * scope,
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
-  width -= 1;
-  s += 4;
-
   /* move to the left */
-  for (j = 0; j < height; j++) {
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-    s += ss;
-  }
+  for (j = 0; j < height; j++)
+    shade_line (d + j * ds, s + j * ss + 4, width - 1, amount);
 }
 
 static void
 shader_fade_and_move_right (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -290,29 +310,18 @@ shader_fade_and_move_right (GstAudioVisualizer * scope,
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
-  width -= 1;
-  d += 4;
-
   /* move to the right */
-  for (j = 0; j < height; j++) {
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-    s += ss;
-  }
+  for (j = 0; j < height; j++)
+    shade_line (d + j * ds + 4, s + j * ss, width - 1, amount);
 }
 
 static void
 shader_fade_and_move_horiz_out (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -323,33 +332,20 @@ shader_fade_and_move_horiz_out (GstAudioVisualizer * scope,
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
   /* move upper half up */
-  for (j = 0; j < height / 2; j++) {
-    s += ss;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-  }
+  for (j = 0; j < height / 2; j++)
+    shade_line (d + j * ds, s + (j + 1) * ss, width, amount);
   /* move lower half down */
-  for (j = 0; j < height / 2; j++) {
-    d += ds;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
-  }
+  for (; j < height - 1; j++)
+    shade_line (d + (j + 1) * ds, s + j * ss, width, amount);
 }
 
 static void
 shader_fade_and_move_horiz_in (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
+  guint32 amount = SHADE_AMOUNT (scope);
   guint8 *s, *d;
-  gint ss, ds, width, height;
+  gint j, ss, ds, width, height;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -360,33 +356,20 @@ shader_fade_and_move_horiz_in (GstAudioVisualizer * scope,
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
 
   /* move upper half down */
-  for (j = 0; j < height / 2; j++) {
-    d += ds;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    s += ss;
-  }
+  for (j = 0; j < height / 2; j++)
+    shade_line (d + (j + 1) * ds, s + j * ss, width, amount);
   /* move lower half up */
-  for (j = 0; j < height / 2; j++) {
-    s += ss;
-    for (i = 0; i < width; i++) {
-      SHADE (d, s, i, r, g, b);
-    }
-    d += ds;
-  }
+  for (; j < height - 1; j++)
+    shade_line (d + j * ds, s + (j + 1) * ss, width, amount);
 }
 
 static void
 shader_fade_and_move_vert_out (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
-  guint8 *s, *s1, *d, *d1;
-  gint ss, ds, width, height;
+  guint32 amount = SHADE_AMOUNT (scope);
+  guint8 *s, *d;
+  gint j, ss, ds, width, height, half;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -395,18 +378,13 @@ shader_fade_and_move_vert_out (GstAudioVisualizer * scope,
 
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
+  half = width / 2;
 
   for (j = 0; j < height; j++) {
     /* move left half to the left */
-    s1 = s + 1;
-    for (i = 0; i < width / 2; i++) {
-      SHADE (d, s1, i, r, g, b);
-    }
+    shade_line (d, s + 4, half, amount);
     /* move right half to the right */
-    d1 = d + 1;
-    for (; i < width - 1; i++) {
-      SHADE (d1, s, i, r, g, b);
-    }
+    shade_line (d + (half + 1) * 4, s + half * 4, width - 1 - half, amount);
     s += ss;
     d += ds;
   }
@@ -416,12 +394,9 @@ static void
 shader_fade_and_move_vert_in (GstAudioVisualizer * scope,
     const GstVideoFrame * sframe, GstVideoFrame * dframe)
 {
-  guint i, j;
-  guint r = (scope->shade_amount >> 16) & 0xff;
-  guint g = (scope->shade_amount >> 8) & 0xff;
-  guint b = (scope->shade_amount >> 0) & 0xff;
-  guint8 *s, *s1, *d, *d1;
-  gint ss, ds, width, height;
+  guint32 amount = SHADE_AMOUNT (scope);
+  guint8 *s, *d;
+  gint j, ss, ds, width, height, half;
 
   s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
   ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
@@ -430,23 +405,56 @@ shader_fade_and_move_vert_in (GstAudioVisualizer * scope,
 
   width = GST_VIDEO_FRAME_WIDTH (sframe);
   height = GST_VIDEO_FRAME_HEIGHT (sframe);
+  half = width / 2;
 
   for (j = 0; j < height; j++) {
     /* move left half to the right */
-    d1 = d + 1;
-    for (i = 0; i < width / 2; i++) {
-      SHADE (d1, s, i, r, g, b);
-    }
+    shade_line (d + 4, s, half, amount);
     /* move right half to the left */
-    s1 = s + 1;
-    for (; i < width - 1; i++) {
-      SHADE (d, s1, i, r, g, b);
-    }
+    shade_line (d + half * 4, s + (half + 1) * 4, width - 1 - half, amount);
     s += ss;
     d += ds;
   }
 }
 
+/* nearest neighbour scaling of the reduced resolution rendering to the
+ * output frame, rows that map to the same source row are copied */
+static void
+gst_audio_visualizer_upscale (const GstVideoFrame * sframe,
+    GstVideoFrame * dframe)
+{
+  guint8 *s, *d;
+  gint i, j, ss, ds, sw, sh, dw, dh, sy, last_sy = -1;
+  guint x, xstep;
+
+  s = GST_VIDEO_FRAME_PLANE_DATA (sframe, 0);
+  ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, 0);
+  d = GST_VIDEO_FRAME_PLANE_DATA (dframe, 0);
+  ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, 0);
+
+  sw = GST_VIDEO_FRAME_WIDTH (sframe);
+  sh = GST_VIDEO_FRAME_HEIGHT (sframe);
+  dw = GST_VIDEO_FRAME_WIDTH (dframe);
+  dh = GST_VIDEO_FRAME_HEIGHT (dframe);
+
+  xstep = (sw << 16) / dw;
+
+  for (j = 0; j < dh; j++, d += ds) {
+    const guint32 *srow;
+    guint32 *drow = (guint32 *) d;
+
+    sy = j * sh / dh;
+    if (sy == last_sy) {
+      memcpy (d, d - ds, dw * 4);
+      continue;
+    }
+    srow = (const guint32 *) (s + sy * ss);
+    for (i = 0, x = 0; i < dw; i++, x += xstep)
+      drow[i] = srow[x >> 16];
+    last_sy = sy;
+  }
+}
+
 static void
 gst_audio_visualizer_change_shader (GstAudioVisualizer * scope)
 {
@@ -502,6 +510,13 @@ struct _GstAudioVisualizerPrivate
   GstAllocator *allocator;
   GstAllocationParams params;
   GstQuery *query;
+
+  /* reduced resolution rendering, scope->vinfo is the size the subclass
+   * renders at and out_vinfo the negotiated output size */
+  guint downscale;
+  GstVideoInfo out_vinfo;
+  GstBuffer *renderbuf;
+  GstVideoFrame renderframe;
 };
 
 GType
@@ -564,6 +579,11 @@ gst_audio_visualizer_class_init (GstAudioVisualizerClass * klass)
           "Shading color to use (big-endian ARGB)", 0, G_MAXUINT32,
           DEFAULT_SHADE_AMOUNT,
           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DOWNSCALE,
+      g_param_spec_uint ("downscale", "downscale",
+          "Render the scope at 1/downscale of the output size and scale it "
+          "up, trading detail for speed", 1, 16, DEFAULT_DOWNSCALE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -604,9 +624,11 @@ gst_audio_visualizer_init (GstAudioVisualizer * scope,
   scope->shader_type = DEFAULT_SHADER;
   gst_audio_visualizer_change_shader (scope);
   scope->shade_amount = DEFAULT_SHADE_AMOUNT;
+  scope->priv->downscale = DEFAULT_DOWNSCALE;
 
   /* reset the initial video state */
   gst_video_info_init (&scope->vinfo);
+  gst_video_info_init (&scope->priv->out_vinfo);
   scope->frame_duration = GST_CLOCK_TIME_NONE;
 
   /* reset the initial state */
@@ -630,6 +652,11 @@ gst_audio_visualizer_set_property (GObject * object, guint prop_id,
     case PROP_SHADE_AMOUNT:
       scope->shade_amount = g_value_get_uint (value);
       break;
+    case PROP_DOWNSCALE:
+      scope->priv->downscale = g_value_get_uint (value);
+      /* picked up with the next negotiation */
+      gst_pad_mark_reconfigure (scope->srcpad);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -649,6 +676,9 @@ gst_audio_visualizer_get_property (GObject * object, guint prop_id,
     case PROP_SHADE_AMOUNT:
       g_value_set_uint (value, scope->shade_amount);
       break;
+    case PROP_DOWNSCALE:
+      g_value_set_uint (value, scope->priv->downscale);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -673,6 +703,11 @@ gst_audio_visualizer_dispose (GObject * object)
     gst_buffer_unref (scope->tempbuf);
     scope->tempbuf = NULL;
   }
+  if (scope->priv->renderbuf) {
+    gst_video_frame_unmap (&scope->priv->renderframe);
+    gst_buffer_unref (scope->priv->renderbuf);
+    scope->priv->renderbuf = NULL;
+  }
   if (scope->config_lock.p) {
     g_mutex_clear (&scope->config_lock);
     scope->config_lock.p = NULL;
@@ -729,6 +764,7 @@ gst_audio_visualizer_src_setcaps (GstAudioVisualizer * scope, GstCaps * caps)
 {
   GstVideoInfo info;
   GstAudioVisualizerClass *klass;
+  GstAudioVisualizerPrivate *priv = scope->priv;
   gboolean res;
 
   if (!gst_video_info_from_caps (&info, caps))
@@ -736,8 +772,30 @@ gst_audio_visualizer_src_setcaps (GstAudioVisualizer * scope, GstCaps * caps)
 
   klass = GST_AUDIO_VISUALIZER_CLASS (G_OBJECT_GET_CLASS (scope));
 
+  priv->out_vinfo = info;
   scope->vinfo = info;
 
+  if (priv->renderbuf) {
+    gst_video_frame_unmap (&priv->renderframe);
+    gst_buffer_unref (priv->renderbuf);
+    priv->renderbuf = NULL;
+  }
+  /* FIXME: upscaling assumes 32bpp like the shaders */
+  if (priv->downscale > 1 && GST_VIDEO_INFO_COMP_PSTRIDE (&info, 0) == 4) {
+    gst_video_info_set_format (&scope->vinfo, GST_VIDEO_INFO_FORMAT (&info),
+        MAX (GST_VIDEO_INFO_WIDTH (&info) / priv->downscale, 1),
+        MAX (GST_VIDEO_INFO_HEIGHT (&info) / priv->downscale, 1));
+    GST_VIDEO_INFO_FPS_N (&scope->vinfo) = GST_VIDEO_INFO_FPS_N (&info);
+    GST_VIDEO_INFO_FPS_D (&scope->vinfo) = GST_VIDEO_INFO_FPS_D (&info);
+    GST_VIDEO_INFO_PAR_N (&scope->vinfo) = GST_VIDEO_INFO_PAR_N (&info);
+    GST_VIDEO_INFO_PAR_D (&scope->vinfo) = GST_VIDEO_INFO_PAR_D (&info);
+
+    priv->renderbuf = gst_buffer_new_wrapped (g_malloc0 (scope->vinfo.size),
+        scope->vinfo.size);
+    gst_video_frame_map (&priv->renderframe, &scope->vinfo, priv->renderbuf,
+        GST_MAP_READWRITE);
+  }
+
   scope->frame_duration = gst_util_uint64_scale_int (GST_SECOND,
       GST_VIDEO_INFO_FPS_D (&info), GST_VIDEO_INFO_FPS_N (&info));
   scope->spf = gst_util_uint64_scale_int (GST_AUDIO_INFO_RATE (&scope->ainfo),
@@ -759,6 +817,9 @@ gst_audio_visualizer_src_setcaps (GstAudioVisualizer * scope, GstCaps * caps)
   GST_DEBUG_OBJECT (scope, "video: dimension %dx%d, framerate %d/%d",
       GST_VIDEO_INFO_WIDTH (&info), GST_VIDEO_INFO_HEIGHT (&info),
       GST_VIDEO_INFO_FPS_N (&info), GST_VIDEO_INFO_FPS_D (&info));
+  GST_DEBUG_OBJECT (scope, "rendering at %dx%d",
+      GST_VIDEO_INFO_WIDTH (&scope->vinfo),
+      GST_VIDEO_INFO_HEIGHT (&scope->vinfo));
   GST_DEBUG_OBJECT (scope, "blocks: spf %u, req_spf %u",
       scope->spf, scope->req_spf);
 
@@ -960,7 +1021,7 @@ default_decide_allocation (GstAudioVisualizer * scope, GstQuery * query)
     update_pool = TRUE;
   } else {
     pool = NULL;
-    size = GST_VIDEO_INFO_SIZE (&scope->vinfo);
+    size = GST_VIDEO_INFO_SIZE (&scope->priv->out_vinfo);
     min = max = 0;
     update_pool = FALSE;
   }
@@ -1032,6 +1093,7 @@ gst_audio_visualizer_chain (GstPad * pad, GstObject * parent,
   GstAudioVisualizer *scope;
   GstAudioVisualizerClass *klass;
   GstBuffer *inbuf;
+  GstVideoFrame *rframe;
   guint64 dist, ts;
   guint avail, sbpf;
   gpointer adata;
@@ -1132,16 +1194,20 @@ gst_audio_visualizer_chain (GstPad * pad, GstObject * parent,
     if (!(adata = (gpointer) gst_adapter_map (scope->adapter, sbpf)))
       break;
 
-    gst_video_frame_map (&outframe, &scope->vinfo, outbuf, GST_MAP_READWRITE);
+    gst_video_frame_map (&outframe, &scope->priv->out_vinfo, outbuf,
+        GST_MAP_READWRITE);
+
+    /* the frame the subclass renders into, upscaled to outframe later */
+    rframe = scope->priv->renderbuf ? &scope->priv->renderframe : &outframe;
 
     if (scope->shader) {
-      gst_video_frame_copy (&outframe, &scope->tempframe);
+      gst_video_frame_copy (rframe, &scope->tempframe);
     } else {
       /* gst_video_frame_clear() or is output frame already cleared */
       gint i;
 
       for (i = 0; i < scope->vinfo.finfo->n_planes; i++) {
-        memset (outframe.data[i], 0, outframe.map[i].size);
+        memset (rframe->data[i], 0, rframe->map[i].size);
       }
     }
 
@@ -1151,17 +1217,19 @@ gst_audio_visualizer_chain (GstPad * pad, GstObject * parent,
 
     /* call class->render() vmethod */
     if (klass->render) {
-      if (!klass->render (scope, inbuf, &outframe)) {
+      if (!klass->render (scope, inbuf, rframe)) {
         ret = GST_FLOW_ERROR;
       } else {
         /* run various post processing (shading and geometric transformation) */
         /* FIXME: SHADER assumes 32bpp */
         if (scope->shader &&
             GST_VIDEO_INFO_COMP_PSTRIDE (&scope->vinfo, 0) == 4) {
-          scope->shader (scope, &outframe, &scope->tempframe);
+          scope->shader (scope, rframe, &scope->tempframe);
         }
       }
     }
+    if (rframe != &outframe)
+      gst_audio_visualizer_upscale (rframe, &outframe);
     gst_video_frame_unmap (&outframe);
 
     g_mutex_unlock (&scope->config_lock);
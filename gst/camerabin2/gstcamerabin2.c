@@ -70,6 +70,13 @@
  * In both modes, if #GstCameraBin:post-previews is %TRUE, a #GstBuffer
  * will be post to the #GstBus in a field named 'buffer', in a
  * 'preview-image' message of type %GST_MESSAGE_ELEMENT.
+ *
+ * When the first buffer of a video recording reaches the recording branch,
+ * a %GST_MESSAGE_ELEMENT named 'video-capture-started' is posted, its
+ * 'latency' field holds the time since #GstCameraBin:start-capture in
+ * nanoseconds. Setting #GstCameraBin:warm-recording reduces this latency by
+ * keeping the audio source open between recordings and opening the file of
+ * the next recording in advance.
  * </para>
  * </refsect2>
 
@@ -161,6 +168,8 @@
 
 #include <string.h>
 
+#include <glib/gstdio.h>
+
 #include <gst/basecamerabinsrc/gstbasecamerasrc.h>
 #include "gstcamerabin2.h"
 #include <gst/gst-i18n-plugin.h>
@@ -231,7 +240,8 @@ enum
   PROP_IMAGE_ENCODING_PROFILE,
   PROP_IDLE,
   PROP_FLAGS,
-  PROP_AUDIO_FILTER
+  PROP_AUDIO_FILTER,
+  PROP_WARM_RECORDING
 };
 
 enum
@@ -250,6 +260,7 @@ static guint camerabin_signals[LAST_SIGNAL];
 #define DEFAULT_MUTE_AUDIO FALSE
 #define DEFAULT_IDLE TRUE
 #define DEFAULT_FLAGS 0
+#define DEFAULT_WARM_RECORDING FALSE
 
 #define DEFAULT_AUDIO_SRC "autoaudiosrc"
 
@@ -361,6 +372,7 @@ gst_camera_bin_start_capture (GstCameraBin2 * camerabin)
   const GstTagList *taglist;
   gint capture_index = camerabin->capture_index;
   gchar *location = NULL;
+  GstClockTime start_time = gst_util_get_timestamp ();
   GST_DEBUG_OBJECT (camerabin, "Received start-capture");
 
   /* check that we have a valid location */
@@ -383,6 +395,8 @@ gst_camera_bin_start_capture (GstCameraBin2 * camerabin)
       return;
     }
     camerabin->video_state = GST_CAMERA_BIN_VIDEO_STARTING;
+    camerabin->video_start_time = start_time;
+    g_atomic_int_set (&camerabin->video_start_pending, TRUE);
   }
 
   GST_CAMERA_BIN2_PROCESSING_INC (camerabin);
@@ -471,6 +485,62 @@ gst_camera_bin_stop_capture (GstCameraBin2 * camerabin)
   }
 }
 
+/* With warm-recording, opens the videosink for the next recording right
+ * away so that starting it doesn't need any state changes. Files that
+ * already exist are left alone as filesink would truncate them.
+ * Must be called with the video_capture_mutex held. */
+static void
+gst_camera_bin_prepare_video_sink (GstCameraBin2 * camera)
+{
+  gchar *location;
+
+  if (!camera->warm_recording || camera->mode != MODE_VIDEO ||
+      camera->location == NULL)
+    return;
+
+  /* keep the audio device open between recordings */
+  if (camera->audio_src && GST_STATE (camera->audio_src) < GST_STATE_READY)
+    gst_element_set_state (camera->audio_src, GST_STATE_READY);
+
+  if (camera->video_prepared_location)
+    return;
+
+  location = g_strdup_printf (camera->location, camera->capture_index);
+  if (g_file_test (location, G_FILE_TEST_EXISTS)) {
+    GST_DEBUG_OBJECT (camera, "Not preparing videobin, %s already exists",
+        location);
+    g_free (location);
+    return;
+  }
+
+  GST_DEBUG_OBJECT (camera, "Preparing videobin for %s", location);
+  gst_element_set_state (camera->videosink, GST_STATE_NULL);
+  g_object_set (camera->videosink, "location", location, NULL);
+  if (gst_element_set_state (camera->videosink, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE) {
+    gst_element_set_state (camera->videosink, GST_STATE_NULL);
+    g_free (location);
+    return;
+  }
+  camera->video_prepared_location = location;
+}
+
+/* Closes and removes the file opened in advance if it wasn't used.
+ * Must be called with the video_capture_mutex held. */
+static void
+gst_camera_bin_release_video_sink (GstCameraBin2 * camera)
+{
+  if (camera->video_prepared_location == NULL)
+    return;
+
+  GST_DEBUG_OBJECT (camera, "Removing unused %s",
+      camera->video_prepared_location);
+  gst_element_set_state (camera->videosink, GST_STATE_NULL);
+  g_unlink (camera->video_prepared_location);
+  g_free (camera->video_prepared_location);
+  camera->video_prepared_location = NULL;
+}
+
 static void
 gst_camera_bin_change_mode (GstCameraBin2 * camerabin, gint mode)
 {
@@ -484,6 +554,16 @@ gst_camera_bin_change_mode (GstCameraBin2 * camerabin, gint mode)
   camerabin->mode = mode;
   if (camerabin->src)
     g_object_set (camerabin->src, "mode", mode, NULL);
+
+  if (camerabin->elements_created) {
+    g_mutex_lock (&camerabin->video_capture_mutex);
+    if (mode != MODE_VIDEO)
+      gst_camera_bin_release_video_sink (camerabin);
+    else if (GST_STATE (camerabin) >= GST_STATE_PAUSED &&
+        camerabin->video_state == GST_CAMERA_BIN_VIDEO_IDLE)
+      gst_camera_bin_prepare_video_sink (camerabin);
+    g_mutex_unlock (&camerabin->video_capture_mutex);
+  }
 }
 
 static void
@@ -498,18 +578,30 @@ gst_camera_bin_src_notify_readyforcapture (GObject * obj, GParamSpec * pspec,
     gchar *location = NULL;
 
     if (camera->mode == MODE_VIDEO) {
-      /* a video recording is about to start, change the filesink location */
-      gst_element_set_state (camera->videosink, GST_STATE_NULL);
+      /* a video recording is about to start, change the filesink location.
+       * This is called from start-capture, with the video_capture_mutex
+       * held */
       location = g_strdup_printf (camera->location, camera->capture_index);
-      GST_DEBUG_OBJECT (camera, "Switching videobin location to %s", location);
-      g_object_set (camera->videosink, "location", location, NULL);
-      g_free (location);
-      if (gst_element_set_state (camera->videosink, GST_STATE_PLAYING) ==
-          GST_STATE_CHANGE_FAILURE) {
-        /* Resets the latest state change return, that would be a failure
-         * and could cause problems in a camerabin2 state change */
+      if (camera->video_prepared_location &&
+          strcmp (camera->video_prepared_location, location) == 0) {
+        GST_DEBUG_OBJECT (camera, "Videobin already prepared for %s",
+            location);
+        g_free (camera->video_prepared_location);
+        camera->video_prepared_location = NULL;
+      } else {
+        gst_camera_bin_release_video_sink (camera);
         gst_element_set_state (camera->videosink, GST_STATE_NULL);
+        GST_DEBUG_OBJECT (camera, "Switching videobin location to %s",
+            location);
+        g_object_set (camera->videosink, "location", location, NULL);
+        if (gst_element_set_state (camera->videosink, GST_STATE_PLAYING) ==
+            GST_STATE_CHANGE_FAILURE) {
+          /* Resets the latest state change return, that would be a failure
+           * and could cause problems in a camerabin2 state change */
+          gst_element_set_state (camera->videosink, GST_STATE_NULL);
+        }
       }
+      g_free (location);
     }
 
     camera->capture_index++;
@@ -522,6 +614,7 @@ gst_camera_bin_dispose (GObject * object)
   GstCameraBin2 *camerabin = GST_CAMERA_BIN2_CAST (object);
 
   g_free (camerabin->location);
+  g_free (camerabin->video_prepared_location);
   g_mutex_clear (&camerabin->preview_list_mutex);
   g_mutex_clear (&camerabin->image_capture_mutex);
   g_mutex_clear (&camerabin->video_capture_mutex);
@@ -845,6 +938,21 @@ gst_camera_bin_class_init (GstCameraBin2Class * klass)
           GST_TYPE_CAM_FLAGS, DEFAULT_FLAGS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCameraBin2:warm-recording:
+   *
+   * Keep the audio source open between video recordings and open the file
+   * of the next recording in advance, so that starting a recording doesn't
+   * have to wait for any state changes. The file is only opened in advance
+   * if it doesn't exist yet, and it is removed again if no recording ends
+   * up using it.
+   */
+  g_object_class_install_property (object_class, PROP_WARM_RECORDING,
+      g_param_spec_boolean ("warm-recording", "Warm recording",
+          "Prepare the next video recording in advance to reduce the "
+          "recording start latency", DEFAULT_WARM_RECORDING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstCameraBin2::capture-start:
    * @camera: the camera bin element
@@ -880,6 +988,7 @@ gst_camera_bin_init (GstCameraBin2 * camera)
   camera->zoom = DEFAULT_ZOOM;
   camera->max_zoom = MAX_ZOOM;
   camera->flags = DEFAULT_FLAGS;
+  camera->warm_recording = DEFAULT_WARM_RECORDING;
   g_mutex_init (&camera->preview_list_mutex);
   g_mutex_init (&camera->image_capture_mutex);
   g_mutex_init (&camera->video_capture_mutex);
@@ -935,6 +1044,21 @@ gst_video_capture_bin_post_video_done (GstCameraBin2 * camera)
     GST_WARNING_OBJECT (camera, "Failed to post video-done message");
 }
 
+static void
+gst_video_capture_bin_post_capture_started (GstCameraBin2 * camera,
+    GstClockTime latency)
+{
+  GstMessage *msg;
+
+  msg = gst_message_new_element (GST_OBJECT_CAST (camera),
+      gst_structure_new ("video-capture-started", "latency", G_TYPE_UINT64,
+          latency, NULL));
+
+  if (!gst_element_post_message (GST_ELEMENT_CAST (camera), msg))
+    GST_WARNING_OBJECT (camera,
+        "Failed to post video-capture-started message");
+}
+
 static void
 gst_camera_bin_skip_next_preview (GstCameraBin2 * camerabin)
 {
@@ -982,8 +1106,10 @@ gst_camera_bin_video_reset_elements (gpointer u_data)
      * fixed.
      *
      * Also, we don't reinit the audiosrc to keep audio devices from being open
-     * and running until we really need them */
-    gst_element_set_state (camerabin->audio_src, GST_STATE_NULL);
+     * and running until we really need them, unless warm-recording asks
+     * for exactly that */
+    gst_element_set_state (camerabin->audio_src,
+        camerabin->warm_recording ? GST_STATE_READY : GST_STATE_NULL);
 
     if (camerabin->audio_filter) {
       gst_element_set_state (camerabin->audio_filter, GST_STATE_READY);
@@ -995,6 +1121,8 @@ gst_camera_bin_video_reset_elements (gpointer u_data)
 
   }
 
+  gst_camera_bin_prepare_video_sink (camerabin);
+
   GST_DEBUG_OBJECT (camerabin, "Setting video state to idle");
   camerabin->video_state = GST_CAMERA_BIN_VIDEO_IDLE;
   g_cond_signal (&camerabin->video_state_cond);
@@ -1427,6 +1555,26 @@ gst_camera_bin_image_sink_event_probe (GstPad * pad, GstPadProbeInfo * info,
   return GST_PAD_PROBE_OK;
 }
 
+static GstPadProbeReturn
+gst_camera_bin_video_src_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer data)
+{
+  GstCameraBin2 *camera = data;
+
+  if (G_UNLIKELY (g_atomic_int_get (&camera->video_start_pending)) &&
+      g_atomic_int_compare_and_exchange (&camera->video_start_pending, TRUE,
+          FALSE)) {
+    GstClockTime latency = gst_util_get_timestamp () -
+        camera->video_start_time;
+
+    GST_DEBUG_OBJECT (camera, "First recorded buffer after %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (latency));
+    gst_video_capture_bin_post_capture_started (camera, latency);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
 static GstPadProbeReturn
 gst_camera_bin_audio_src_data_probe (GstPad * pad, GstPadProbeInfo * info,
     gpointer data)
@@ -1631,6 +1779,14 @@ gst_camera_bin_create_elements (GstCameraBin2 * camera)
           gst_camera_bin_image_sink_event_probe, camera, NULL);
 
       gst_object_unref (srcpad);
+
+      /* and one to measure how long recordings take to start */
+      srcpad = gst_element_get_static_pad (camera->videobin_capsfilter, "src");
+
+      gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+          gst_camera_bin_video_src_buffer_probe, camera, NULL);
+
+      gst_object_unref (srcpad);
     }
 
     /*
@@ -1883,6 +2039,10 @@ gst_camera_bin_change_state (GstElement * element, GstStateChange trans)
       camera->audio_send_newseg = FALSE;
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      g_mutex_lock (&camera->video_capture_mutex);
+      gst_camera_bin_release_video_sink (camera);
+      g_atomic_int_set (&camera->video_start_pending, FALSE);
+      g_mutex_unlock (&camera->video_capture_mutex);
       if (GST_STATE (camera->videosink) >= GST_STATE_PAUSED)
         gst_element_set_state (camera->videosink, GST_STATE_READY);
       if (GST_STATE (camera->imagesink) >= GST_STATE_PAUSED)
@@ -1899,6 +2059,13 @@ gst_camera_bin_change_state (GstElement * element, GstStateChange trans)
   ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, trans);
 
   switch (trans) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (ret != GST_STATE_CHANGE_FAILURE) {
+        g_mutex_lock (&camera->video_capture_mutex);
+        gst_camera_bin_prepare_video_sink (camera);
+        g_mutex_unlock (&camera->video_capture_mutex);
+      }
+      break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       if (camera->audio_src && GST_STATE (camera->audio_src) >= GST_STATE_READY)
         gst_element_set_state (camera->audio_src, GST_STATE_READY);
@@ -1953,6 +2120,13 @@ gst_camera_bin_send_event (GstElement * element, GstEvent * event)
   /* avoid losing our ref to send_event */
   gst_event_ref (event);
 
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    /* don't leave an empty file behind */
+    g_mutex_lock (&camera->video_capture_mutex);
+    gst_camera_bin_release_video_sink (camera);
+    g_mutex_unlock (&camera->video_capture_mutex);
+  }
+
   res = GST_ELEMENT_CLASS (parent_class)->send_event (element, event);
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_EOS:
@@ -2226,6 +2400,9 @@ gst_camera_bin_set_property (GObject * object, guint prop_id,
     case PROP_FLAGS:
       camera->flags = g_value_get_flags (value);
       break;
+    case PROP_WARM_RECORDING:
+      camera->warm_recording = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2405,6 +2582,9 @@ gst_camera_bin_get_property (GObject * object, guint prop_id,
     case PROP_FLAGS:
       g_value_set_flags (value, camera->flags);
       break;
+    case PROP_WARM_RECORDING:
+      g_value_set_boolean (value, camera->warm_recording);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
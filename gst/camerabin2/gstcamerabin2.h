@@ -136,6 +136,14 @@ struct _GstCameraBin2
   GCond video_state_cond;
   GstCameraBinVideoState video_state;
 
+  /* location the videosink was opened with in advance for the next
+   * recording when warm-recording is set, protected by video_capture_mutex */
+  gchar *video_prepared_location;
+  /* when the current recording was requested, used to measure the start
+   * latency when its first buffer arrives */
+  GstClockTime video_start_time;
+  gint video_start_pending; /* atomic int */
+
   /* properties */
   gint mode;
   gchar *location;
@@ -147,6 +155,7 @@ struct _GstCameraBin2
   gfloat zoom;
   gfloat max_zoom;
   GstCamFlags flags;
+  gboolean warm_recording;
 
   gboolean elements_created;
 };
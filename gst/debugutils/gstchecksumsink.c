@@ -23,16 +23,48 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <errno.h>
 #include "gstchecksumsink.h"
+#include "gstdebugchecksum.h"
 
+static void gst_checksum_sink_set_property (GObject * object,
+    guint prop_id, const GValue * value, GParamSpec * pspec);
+static void gst_checksum_sink_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
 static void gst_checksum_sink_dispose (GObject * object);
 static void gst_checksum_sink_finalize (GObject * object);
 
 static gboolean gst_checksum_sink_start (GstBaseSink * sink);
 static gboolean gst_checksum_sink_stop (GstBaseSink * sink);
+static gboolean gst_checksum_sink_set_caps (GstBaseSink * sink,
+    GstCaps * caps);
+static gboolean gst_checksum_sink_event (GstBaseSink * sink,
+    GstEvent * event);
 static GstFlowReturn
 gst_checksum_sink_render (GstBaseSink * sink, GstBuffer * buffer);
 
+enum
+{
+  PROP_0,
+  PROP_HASH,
+  PROP_PER_PLANE,
+  PROP_LOCATION
+};
+
+#define DEFAULT_HASH G_CHECKSUM_SHA1
+#define DEFAULT_PER_PLANE FALSE
+
+/* buffers waiting for the worker thread before render blocks */
+#define MAX_PENDING 4
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GChecksumType hash;
+  gboolean per_plane;
+  GstVideoInfo info;
+} GstChecksumSinkJob;
+
 static GstStaticPadTemplate gst_checksum_sink_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -57,12 +89,32 @@ gst_checksum_sink_class_init (GstChecksumSinkClass * klass)
   GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
   GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
 
+  gobject_class->set_property = gst_checksum_sink_set_property;
+  gobject_class->get_property = gst_checksum_sink_get_property;
   gobject_class->dispose = gst_checksum_sink_dispose;
   gobject_class->finalize = gst_checksum_sink_finalize;
   base_sink_class->start = GST_DEBUG_FUNCPTR (gst_checksum_sink_start);
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_checksum_sink_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_checksum_sink_set_caps);
+  base_sink_class->event = GST_DEBUG_FUNCPTR (gst_checksum_sink_event);
   base_sink_class->render = GST_DEBUG_FUNCPTR (gst_checksum_sink_render);
 
+  g_object_class_install_property (gobject_class, PROP_HASH,
+      g_param_spec_enum ("hash", "Hash", "Checksum algorithm to use",
+          GST_TYPE_DEBUG_CHECKSUM_TYPE, DEFAULT_HASH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PER_PLANE,
+      g_param_spec_boolean ("per-plane", "Per plane",
+          "Checksum the visible part of every plane of raw video frames, "
+          "ignoring the padding", DEFAULT_PER_PLANE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Location",
+          "File to write the checksums to (NULL = standard output)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&gst_checksum_sink_src_template));
   gst_element_class_add_pad_template (element_class,
@@ -77,6 +129,56 @@ static void
 gst_checksum_sink_init (GstChecksumSink * checksumsink)
 {
   gst_base_sink_set_sync (GST_BASE_SINK (checksumsink), FALSE);
+
+  checksumsink->hash = DEFAULT_HASH;
+  checksumsink->per_plane = DEFAULT_PER_PLANE;
+  g_mutex_init (&checksumsink->lock);
+  g_cond_init (&checksumsink->cond);
+}
+
+static void
+gst_checksum_sink_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (object);
+
+  switch (prop_id) {
+    case PROP_HASH:
+      checksumsink->hash = g_value_get_enum (value);
+      break;
+    case PROP_PER_PLANE:
+      checksumsink->per_plane = g_value_get_boolean (value);
+      break;
+    case PROP_LOCATION:
+      g_free (checksumsink->location);
+      checksumsink->location = g_value_dup_string (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_checksum_sink_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (object);
+
+  switch (prop_id) {
+    case PROP_HASH:
+      g_value_set_enum (value, checksumsink->hash);
+      break;
+    case PROP_PER_PLANE:
+      g_value_set_boolean (value, checksumsink->per_plane);
+      break;
+    case PROP_LOCATION:
+      g_value_set_string (value, checksumsink->location);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 void
@@ -88,34 +190,140 @@ gst_checksum_sink_dispose (GObject * object)
 void
 gst_checksum_sink_finalize (GObject * object)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (object);
+
+  g_free (checksumsink->location);
+  g_mutex_clear (&checksumsink->lock);
+  g_cond_clear (&checksumsink->cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_checksum_sink_worker (gpointer data, gpointer user_data)
+{
+  GstChecksumSink *checksumsink = user_data;
+  GstChecksumSinkJob *job = data;
+  gchar *s;
+
+  s = gst_debug_checksum_buffer (job->hash, job->buffer,
+      job->per_plane ? &job->info : NULL);
+  if (checksumsink->file)
+    fprintf (checksumsink->file, "%" GST_TIME_FORMAT " %s\n",
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (job->buffer)), s);
+  else
+    g_print ("%" GST_TIME_FORMAT " %s\n",
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (job->buffer)), s);
+  g_free (s);
+
+  gst_buffer_unref (job->buffer);
+  g_slice_free (GstChecksumSinkJob, job);
+
+  g_mutex_lock (&checksumsink->lock);
+  checksumsink->pending--;
+  g_cond_signal (&checksumsink->cond);
+  g_mutex_unlock (&checksumsink->lock);
+}
+
+/* waits until there are at most @max_pending buffers left to checksum */
+static void
+gst_checksum_sink_wait (GstChecksumSink * checksumsink, guint max_pending)
+{
+  g_mutex_lock (&checksumsink->lock);
+  while (checksumsink->pending > max_pending)
+    g_cond_wait (&checksumsink->cond, &checksumsink->lock);
+  g_mutex_unlock (&checksumsink->lock);
+}
+
 static gboolean
 gst_checksum_sink_start (GstBaseSink * sink)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  if (checksumsink->location) {
+    checksumsink->file = fopen (checksumsink->location, "w");
+    if (checksumsink->file == NULL) {
+      GST_ELEMENT_ERROR (checksumsink, RESOURCE, OPEN_WRITE,
+          ("Could not open file \"%s\" for writing.",
+              checksumsink->location), GST_ERROR_SYSTEM);
+      return FALSE;
+    }
+  }
+
+  /* a single thread keeps the checksums in order */
+  checksumsink->pending = 0;
+  checksumsink->is_video = FALSE;
+  checksumsink->pool = g_thread_pool_new (gst_checksum_sink_worker,
+      checksumsink, 1, FALSE, NULL);
+
   return TRUE;
 }
 
 static gboolean
 gst_checksum_sink_stop (GstBaseSink * sink)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  if (checksumsink->pool) {
+    g_thread_pool_free (checksumsink->pool, FALSE, TRUE);
+    checksumsink->pool = NULL;
+  }
+
+  if (checksumsink->file) {
+    fclose (checksumsink->file);
+    checksumsink->file = NULL;
+  }
+
   return TRUE;
 }
 
+static gboolean
+gst_checksum_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  checksumsink->is_video =
+      gst_structure_has_name (gst_caps_get_structure (caps, 0), "video/x-raw")
+      && gst_video_info_from_caps (&checksumsink->info, caps);
+
+  return TRUE;
+}
+
+static gboolean
+gst_checksum_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  /* all checksums are written when EOS is posted */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    gst_checksum_sink_wait (checksumsink, 0);
+    if (checksumsink->file)
+      fflush (checksumsink->file);
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
 static GstFlowReturn
 gst_checksum_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
-  gchar *s;
-  GstMapInfo map;
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+  GstChecksumSinkJob *job;
 
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  s = g_compute_checksum_for_data (G_CHECKSUM_SHA1, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  g_print ("%" GST_TIME_FORMAT " %s\n",
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)), s);
+  gst_checksum_sink_wait (checksumsink, MAX_PENDING - 1);
 
-  g_free (s);
+  job = g_slice_new (GstChecksumSinkJob);
+  job->buffer = gst_buffer_ref (buffer);
+  job->hash = checksumsink->hash;
+  job->per_plane = checksumsink->per_plane && checksumsink->is_video;
+  if (job->per_plane)
+    job->info = checksumsink->info;
+
+  g_mutex_lock (&checksumsink->lock);
+  checksumsink->pending++;
+  g_mutex_unlock (&checksumsink->lock);
+
+  g_thread_pool_push (checksumsink->pool, job, NULL);
 
   return GST_FLOW_OK;
 }
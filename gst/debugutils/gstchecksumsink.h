@@ -22,6 +22,8 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
+#include <stdio.h>
 
 G_BEGIN_DECLS
 
@@ -38,6 +40,21 @@ struct _GstChecksumSink
 {
   GstBaseSink base_checksumsink;
 
+  /* properties */
+  GChecksumType hash;
+  gboolean per_plane;
+  gchar *location;
+
+  GstVideoInfo info;
+  gboolean is_video;
+
+  /* the checksums are computed and written by a single worker thread,
+   * in the order of the buffers */
+  FILE *file;
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  guint pending;
 };
 
 struct _GstChecksumSinkClass
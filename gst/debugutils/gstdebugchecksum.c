@@ -0,0 +1,326 @@
+/* GStreamer
+ *
+ * gstdebugchecksum.c: checksums shared by checksumsink and debugspy
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gstdebugchecksum.h"
+
+GType
+gst_debug_checksum_type_get_type (void)
+{
+  static GType checksum_type = 0;
+
+  static const GEnumValue checksum_values[] = {
+    {G_CHECKSUM_MD5, "Use the MD5 hashing algorithm", "md5"},
+    {G_CHECKSUM_SHA1, "Use the SHA-1 hashing algorithm", "sha1"},
+    {G_CHECKSUM_SHA256, "Use the SHA-256 hashing algorithm", "sha256"},
+    {GST_DEBUG_CHECKSUM_XXHASH64,
+        "Use the non cryptographic 64 bit xxHash algorithm", "xxhash64"},
+    {0, NULL, NULL}
+  };
+
+  if (!checksum_type)
+    checksum_type =
+        g_enum_register_static ("GstDebugChecksumType", checksum_values);
+
+  return checksum_type;
+}
+
+/* xxHash64, see https://github.com/Cyan4973/xxHash. Four independent
+ * lanes over 32 byte stripes, which compilers keep in registers. */
+
+#define PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline guint64
+xxh64_read64 (const guint8 * p)
+{
+  guint64 v;
+
+  memcpy (&v, p, 8);
+  return GUINT64_FROM_LE (v);
+}
+
+static inline guint32
+xxh64_read32 (const guint8 * p)
+{
+  guint32 v;
+
+  memcpy (&v, p, 4);
+  return GUINT32_FROM_LE (v);
+}
+
+static inline guint64
+xxh64_round (guint64 acc, guint64 input)
+{
+  acc += input * PRIME64_2;
+  acc = ROTL64 (acc, 31);
+  return acc * PRIME64_1;
+}
+
+static inline guint64
+xxh64_merge_round (guint64 acc, guint64 val)
+{
+  acc ^= xxh64_round (0, val);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+void
+gst_xxh64_reset (GstXXH64State * state, guint64 seed)
+{
+  state->total_len = 0;
+  state->v[0] = seed + PRIME64_1 + PRIME64_2;
+  state->v[1] = seed + PRIME64_2;
+  state->v[2] = seed;
+  state->v[3] = seed - PRIME64_1;
+  state->memsize = 0;
+}
+
+void
+gst_xxh64_update (GstXXH64State * state, const guint8 * data, gsize len)
+{
+  const guint8 *end = data + len;
+  guint64 v0, v1, v2, v3;
+
+  state->total_len += len;
+
+  if (state->memsize + len < 32) {
+    memcpy (state->mem + state->memsize, data, len);
+    state->memsize += len;
+    return;
+  }
+
+  v0 = state->v[0];
+  v1 = state->v[1];
+  v2 = state->v[2];
+  v3 = state->v[3];
+
+  if (state->memsize) {
+    guint fill = 32 - state->memsize;
+
+    memcpy (state->mem + state->memsize, data, fill);
+    v0 = xxh64_round (v0, xxh64_read64 (state->mem));
+    v1 = xxh64_round (v1, xxh64_read64 (state->mem + 8));
+    v2 = xxh64_round (v2, xxh64_read64 (state->mem + 16));
+    v3 = xxh64_round (v3, xxh64_read64 (state->mem + 24));
+    data += fill;
+    state->memsize = 0;
+  }
+
+  while (data + 32 <= end) {
+    v0 = xxh64_round (v0, xxh64_read64 (data));
+    v1 = xxh64_round (v1, xxh64_read64 (data + 8));
+    v2 = xxh64_round (v2, xxh64_read64 (data + 16));
+    v3 = xxh64_round (v3, xxh64_read64 (data + 24));
+    data += 32;
+  }
+
+  state->v[0] = v0;
+  state->v[1] = v1;
+  state->v[2] = v2;
+  state->v[3] = v3;
+
+  if (data < end) {
+    memcpy (state->mem, data, end - data);
+    state->memsize = end - data;
+  }
+}
+
+guint64
+gst_xxh64_digest (const GstXXH64State * state)
+{
+  const guint8 *p = state->mem;
+  const guint8 *end = state->mem + state->memsize;
+  guint64 h;
+
+  if (state->total_len >= 32) {
+    h = ROTL64 (state->v[0], 1) + ROTL64 (state->v[1], 7) +
+        ROTL64 (state->v[2], 12) + ROTL64 (state->v[3], 18);
+    h = xxh64_merge_round (h, state->v[0]);
+    h = xxh64_merge_round (h, state->v[1]);
+    h = xxh64_merge_round (h, state->v[2]);
+    h = xxh64_merge_round (h, state->v[3]);
+  } else {
+    /* v[2] is the seed */
+    h = state->v[2] + PRIME64_5;
+  }
+
+  h += state->total_len;
+
+  while (p + 8 <= end) {
+    h ^= xxh64_round (0, xxh64_read64 (p));
+    h = ROTL64 (h, 27) * PRIME64_1 + PRIME64_4;
+    p += 8;
+  }
+
+  if (p + 4 <= end) {
+    h ^= (guint64) xxh64_read32 (p) * PRIME64_1;
+    h = ROTL64 (h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+
+  while (p < end) {
+    h ^= (*p) * PRIME64_5;
+    h = ROTL64 (h, 11) * PRIME64_1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+void
+gst_debug_checksum_init (GstDebugChecksum * checksum, GChecksumType type)
+{
+  checksum->type = type;
+  if (type == GST_DEBUG_CHECKSUM_XXHASH64) {
+    checksum->checksum = NULL;
+    gst_xxh64_reset (&checksum->xxh64, 0);
+  } else {
+    checksum->checksum = g_checksum_new (type);
+  }
+}
+
+void
+gst_debug_checksum_update (GstDebugChecksum * checksum, const guint8 * data,
+    gsize len)
+{
+  if (checksum->checksum)
+    g_checksum_update (checksum->checksum, data, len);
+  else
+    gst_xxh64_update (&checksum->xxh64, data, len);
+}
+
+/* returns the hexadecimal digest and frees the checksum */
+gchar *
+gst_debug_checksum_finish (GstDebugChecksum * checksum)
+{
+  gchar *ret;
+
+  if (checksum->checksum) {
+    ret = g_strdup (g_checksum_get_string (checksum->checksum));
+    g_checksum_free (checksum->checksum);
+    checksum->checksum = NULL;
+  } else {
+    ret = g_strdup_printf ("%016" G_GINT64_MODIFIER "x",
+        gst_xxh64_digest (&checksum->xxh64));
+  }
+
+  return ret;
+}
+
+/* the visible bytes of every plane of the frame, without the padding at
+ * the end of the rows */
+static gchar *
+gst_debug_checksum_frame (GChecksumType type, GstVideoFrame * frame)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  GString *str = g_string_new (NULL);
+  guint plane, comp;
+  gint row;
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++) {
+    GstDebugChecksum checksum;
+    const guint8 *data = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+    gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+    gint row_size, height;
+    gchar *s;
+
+    /* the first component of the plane gives its size */
+    for (comp = 0; comp < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); comp++) {
+      if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, comp) == plane)
+        break;
+    }
+    if (comp == GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo))
+      continue;
+
+    height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, comp);
+    row_size = GST_VIDEO_FRAME_COMP_WIDTH (frame, comp) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp);
+    /* packed formats without a pixel stride, like v210 */
+    if (row_size <= 0 || row_size > ABS (stride))
+      row_size = ABS (stride);
+
+    gst_debug_checksum_init (&checksum, type);
+    for (row = 0; row < height; row++)
+      gst_debug_checksum_update (&checksum, data + row * stride, row_size);
+    s = gst_debug_checksum_finish (&checksum);
+
+    if (str->len)
+      g_string_append_c (str, ' ');
+    g_string_append (str, s);
+    g_free (s);
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+/**
+ * gst_debug_checksum_buffer:
+ * @type: the checksum type
+ * @buffer: a #GstBuffer
+ * @info: the video info of @buffer to checksum every plane of a raw video
+ *     frame separately, or %NULL
+ *
+ * Returns: the hexadecimal checksum of the data of @buffer, or the
+ * space separated checksums of the planes. Free with g_free().
+ */
+gchar *
+gst_debug_checksum_buffer (GChecksumType type, GstBuffer * buffer,
+    const GstVideoInfo * info)
+{
+  GstDebugChecksum checksum;
+  GstMapInfo map;
+
+  if (info) {
+    GstVideoFrame frame;
+
+    if (gst_video_frame_map (&frame, (GstVideoInfo *) info, buffer,
+            GST_MAP_READ)) {
+      gchar *ret = gst_debug_checksum_frame (type, &frame);
+
+      gst_video_frame_unmap (&frame);
+      return ret;
+    }
+    GST_WARNING ("buffer does not match the video info, checksumming all "
+        "of it");
+  }
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  gst_debug_checksum_init (&checksum, type);
+  gst_debug_checksum_update (&checksum, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+
+  return gst_debug_checksum_finish (&checksum);
+}
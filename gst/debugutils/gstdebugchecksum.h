@@ -0,0 +1,67 @@
+/* GStreamer
+ *
+ * gstdebugchecksum.h: checksums shared by checksumsink and debugspy
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_DEBUG_CHECKSUM_H__
+#define __GST_DEBUG_CHECKSUM_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+/* the GChecksumType values plus the non cryptographic hashes */
+#define GST_DEBUG_CHECKSUM_XXHASH64 ((GChecksumType) 100)
+
+#define GST_TYPE_DEBUG_CHECKSUM_TYPE (gst_debug_checksum_type_get_type ())
+GType gst_debug_checksum_type_get_type (void);
+
+/* streaming xxHash64 state */
+typedef struct
+{
+  guint64 total_len;
+  guint64 v[4];
+  guint8 mem[32];
+  guint memsize;
+} GstXXH64State;
+
+void gst_xxh64_reset (GstXXH64State * state, guint64 seed);
+void gst_xxh64_update (GstXXH64State * state, const guint8 * data, gsize len);
+guint64 gst_xxh64_digest (const GstXXH64State * state);
+
+/* a checksum of any of the types, computed over several pieces of data */
+typedef struct
+{
+  GChecksumType type;
+  GChecksum *checksum;
+  GstXXH64State xxh64;
+} GstDebugChecksum;
+
+void gst_debug_checksum_init (GstDebugChecksum * checksum,
+    GChecksumType type);
+void gst_debug_checksum_update (GstDebugChecksum * checksum,
+    const guint8 * data, gsize len);
+gchar *gst_debug_checksum_finish (GstDebugChecksum * checksum);
+
+gchar *gst_debug_checksum_buffer (GChecksumType type, GstBuffer * buffer,
+    const GstVideoInfo * info);
+
+G_END_DECLS
+
+#endif /* __GST_DEBUG_CHECKSUM_H__ */
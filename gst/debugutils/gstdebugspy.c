@@ -41,6 +41,7 @@
 #include <gst/gst.h>
 
 #include "gstdebugspy.h"
+#include "gstdebugchecksum.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_debug_spy_debug);
 #define GST_CAT_DEFAULT gst_debug_spy_debug
@@ -56,29 +57,10 @@ enum
 {
   PROP_0,
   PROP_SILENT,
-  PROP_CHECKSUM_TYPE
+  PROP_CHECKSUM_TYPE,
+  PROP_PER_PLANE
 };
 
-/* create a GType for GChecksumType */
-#define GST_DEBUG_SPY_CHECKSUM_TYPE (gst_debug_spy_checksum_get_type())
-static GType
-gst_debug_spy_checksum_get_type (void)
-{
-  static GType checksum_type = 0;
-
-  static const GEnumValue checksum_values[] = {
-    {G_CHECKSUM_MD5, "Use the MD5 hashing algorithm", "md5"},
-    {G_CHECKSUM_SHA1, "Use the SHA-1 hashing algorithm", "sha1"},
-    {G_CHECKSUM_SHA256, "Use the SHA-256 hashing algorithm", "sha256"},
-    {0, NULL, NULL}
-  };
-
-  if (!checksum_type)
-    checksum_type = g_enum_register_static ("GChecksumType", checksum_values);
-
-  return checksum_type;
-}
-
 /* the capabilities of the inputs and outputs.
  *
  * describe the real formats here.
@@ -101,6 +83,8 @@ static void gst_debug_spy_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_debug_spy_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static gboolean gst_debug_spy_set_caps (GstBaseTransform * transform,
+    GstCaps * incaps, GstCaps * outcaps);
 static GstFlowReturn gst_debug_spy_transform_ip (GstBaseTransform * transform,
     GstBuffer * buf);
 
@@ -122,6 +106,7 @@ gst_debug_spy_class_init (GstDebugSpyClass * klass)
   gobject_class->get_property = gst_debug_spy_get_property;
 
   base_transform_class->passthrough_on_same_caps = TRUE;
+  base_transform_class->set_caps = gst_debug_spy_set_caps;
   base_transform_class->transform_ip = gst_debug_spy_transform_ip;
 
   g_object_class_install_property (gobject_class, PROP_SILENT,
@@ -130,9 +115,15 @@ gst_debug_spy_class_init (GstDebugSpyClass * klass)
 
   g_object_class_install_property (gobject_class, PROP_CHECKSUM_TYPE,
       g_param_spec_enum ("checksum-type", "Checksum TYpe",
-          "Checksum algorithm to use", GST_DEBUG_SPY_CHECKSUM_TYPE,
+          "Checksum algorithm to use", GST_TYPE_DEBUG_CHECKSUM_TYPE,
           G_CHECKSUM_SHA1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_PER_PLANE,
+      g_param_spec_boolean ("per-plane", "Per plane",
+          "Checksum the visible part of every plane of raw video frames, "
+          "ignoring the padding", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "DebugSpy",
       "Filter/Analyzer/Debug",
@@ -157,6 +148,7 @@ gst_debug_spy_init (GstDebugSpy * debugspy)
 {
   debugspy->silent = FALSE;
   debugspy->checksum_type = G_CHECKSUM_SHA1;
+  debugspy->per_plane = FALSE;
 }
 
 static void
@@ -172,6 +164,9 @@ gst_debug_spy_set_property (GObject * object, guint prop_id,
     case PROP_CHECKSUM_TYPE:
       debugspy->checksum_type = g_value_get_enum (value);
       break;
+    case PROP_PER_PLANE:
+      debugspy->per_plane = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -191,6 +186,9 @@ gst_debug_spy_get_property (GObject * object, guint prop_id,
     case PROP_CHECKSUM_TYPE:
       g_value_set_enum (value, debugspy->checksum_type);
       break;
+    case PROP_PER_PLANE:
+      g_value_set_boolean (value, debugspy->per_plane);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -199,6 +197,19 @@ gst_debug_spy_get_property (GObject * object, guint prop_id,
 
 /* GstBaseTransform vmethod implementations */
 
+static gboolean
+gst_debug_spy_set_caps (GstBaseTransform * transform, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstDebugSpy *debugspy = GST_DEBUGSPY (transform);
+
+  debugspy->is_video =
+      gst_structure_has_name (gst_caps_get_structure (incaps, 0),
+      "video/x-raw") && gst_video_info_from_caps (&debugspy->info, incaps);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_debug_spy_transform_ip (GstBaseTransform * transform, GstBuffer * buf)
 {
@@ -208,12 +219,10 @@ gst_debug_spy_transform_ip (GstBaseTransform * transform, GstBuffer * buf)
     gchar *checksum;
     GstMessage *message;
     GstStructure *message_structure;
-    GstMapInfo map;
     GstCaps *caps;
 
-    gst_buffer_map (buf, &map, GST_MAP_READ);
-    checksum = g_compute_checksum_for_data (debugspy->checksum_type,
-        map.data, map.size);
+    checksum = gst_debug_checksum_buffer (debugspy->checksum_type, buf,
+        debugspy->per_plane && debugspy->is_video ? &debugspy->info : NULL);
 
     caps = gst_pad_get_current_caps (GST_BASE_TRANSFORM_SRC_PAD (transform));
     message_structure = gst_structure_new ("buffer",
@@ -222,12 +231,12 @@ gst_debug_spy_transform_ip (GstBaseTransform * transform, GstBuffer * buf)
         "duration", GST_TYPE_CLOCK_TIME, GST_BUFFER_DURATION (buf),
         "offset", G_TYPE_UINT64, GST_BUFFER_OFFSET (buf),
         "offset_end", G_TYPE_UINT64, GST_BUFFER_OFFSET_END (buf),
-        "size", G_TYPE_UINT, map.size, "caps", GST_TYPE_CAPS, caps, NULL);
+        "size", G_TYPE_UINT, (guint) gst_buffer_get_size (buf),
+        "caps", GST_TYPE_CAPS, caps, NULL);
     if (caps)
       gst_caps_unref (caps);
 
     g_free (checksum);
-    gst_buffer_unmap (buf, &map);
 
     message =
         gst_message_new_element (GST_OBJECT (transform), message_structure);
@@ -25,6 +25,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
 
 G_BEGIN_DECLS
 
@@ -49,6 +50,10 @@ struct _GstDebugSpy
 
   gboolean silent;
   GChecksumType checksum_type;
+  gboolean per_plane;
+
+  GstVideoInfo info;
+  gboolean is_video;
 };
 
 struct _GstDebugSpyClass
@@ -0,0 +1,437 @@
+/* GStreamer
+ *
+ * gstperfprobe.c: throughput and latency instrumentation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:element-perfprobe
+ *
+ * The perfprobe element measures the buffers going through it and posts
+ * the statistics of every #GstPerfProbe:interval in a "perfprobe" element
+ * message:
+ * <itemizedlist>
+ * <listitem><para>"buffers", "bytes", "buffer-rate" and "byte-rate", the
+ *   amount of data and its rate per second</para></listitem>
+ * <listitem><para>"max-gap", the longest time between two buffers, and
+ *   "jitter", the RFC 3550 estimate of the variation of the arrival times
+ *   against the timestamps, in nanoseconds</para></listitem>
+ * <listitem><para>"latency-min", "latency-avg", "latency-max" and
+ *   "latency-count", the time it took the buffers to come from the
+ *   #GstPerfProbe:upstream-probe, matched by timestamp</para></listitem>
+ * <listitem><para>"queue", "queue-level-buffers", "queue-level-bytes" and
+ *   "queue-level-time", the fill level of a queue linked to the probe
+ *   </para></listitem>
+ * </itemizedlist>
+ *
+ * The element is a passthrough. The statistics are only updated by the
+ * streaming thread, without locks, and the message is posted from there
+ * too, so nothing is posted while no buffers flow.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -m videotestsrc ! perfprobe name=in ! x264enc !
+ * perfprobe upstream-probe=in ! queue ! fakesink
+ * ]| Measures the rate and the latency of the encoder, and the fill level of
+ * the queue.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include "gstperfprobe.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_perf_probe_debug_category);
+#define GST_CAT_DEFAULT gst_perf_probe_debug_category
+
+/* prototypes */
+
+static void gst_perf_probe_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_perf_probe_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_perf_probe_finalize (GObject * object);
+
+static gboolean gst_perf_probe_start (GstBaseTransform * trans);
+static gboolean gst_perf_probe_stop (GstBaseTransform * trans);
+static GstFlowReturn gst_perf_probe_transform_ip (GstBaseTransform * trans,
+    GstBuffer * buf);
+
+enum
+{
+  PROP_0,
+  PROP_INTERVAL,
+  PROP_UPSTREAM_PROBE
+};
+
+#define DEFAULT_INTERVAL 1000
+
+/* multiplicative hash of the PTS, GST_PERF_PROBE_RING_SIZE is 2^8 */
+#define SLOT_INDEX(pts) \
+    ((guint) (((pts) * G_GUINT64_CONSTANT (0x9E3779B97F4A7C15)) >> 56))
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (GstPerfProbe, gst_perf_probe,
+    GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (gst_perf_probe_debug_category, "perfprobe", 0,
+        "debug category for perfprobe element"));
+
+static void
+gst_perf_probe_class_init (GstPerfProbeClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseTransformClass *base_transform_class =
+      GST_BASE_TRANSFORM_CLASS (klass);
+
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+
+  gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
+      "Performance probe", "Generic",
+      "Posts throughput, jitter and latency statistics of the buffers",
+      "GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>");
+
+  gobject_class->set_property = gst_perf_probe_set_property;
+  gobject_class->get_property = gst_perf_probe_get_property;
+  gobject_class->finalize = gst_perf_probe_finalize;
+  base_transform_class->start = GST_DEBUG_FUNCPTR (gst_perf_probe_start);
+  base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_perf_probe_stop);
+  base_transform_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_perf_probe_transform_ip);
+
+  g_object_class_install_property (gobject_class, PROP_INTERVAL,
+      g_param_spec_uint ("interval", "Interval", "Interval (in ms) at which "
+          "the statistics are posted (0 = never)", 0, G_MAXUINT,
+          DEFAULT_INTERVAL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_UPSTREAM_PROBE,
+      g_param_spec_string ("upstream-probe", "Upstream probe",
+          "Name of the perfprobe to measure the latency from", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_perf_probe_init (GstPerfProbe * probe)
+{
+  gint i;
+
+  probe->interval = DEFAULT_INTERVAL;
+
+  for (i = 0; i < GST_PERF_PROBE_RING_SIZE; i++)
+    probe->ring[i].pts = GST_CLOCK_TIME_NONE;
+
+  /* only look at the buffers, never copy them */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (probe), TRUE);
+}
+
+void
+gst_perf_probe_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstPerfProbe *probe = GST_PERF_PROBE (object);
+
+  switch (property_id) {
+    case PROP_INTERVAL:
+      probe->interval = g_value_get_uint (value);
+      break;
+    case PROP_UPSTREAM_PROBE:
+      GST_OBJECT_LOCK (probe);
+      g_free (probe->upstream_name);
+      probe->upstream_name = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (probe);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_perf_probe_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstPerfProbe *probe = GST_PERF_PROBE (object);
+
+  switch (property_id) {
+    case PROP_INTERVAL:
+      g_value_set_uint (value, probe->interval);
+      break;
+    case PROP_UPSTREAM_PROBE:
+      GST_OBJECT_LOCK (probe);
+      g_value_set_string (value, probe->upstream_name);
+      GST_OBJECT_UNLOCK (probe);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_perf_probe_finalize (GObject * object)
+{
+  GstPerfProbe *probe = GST_PERF_PROBE (object);
+
+  g_free (probe->upstream_name);
+
+  G_OBJECT_CLASS (gst_perf_probe_parent_class)->finalize (object);
+}
+
+static void
+gst_perf_probe_reset_stats (GstPerfProbe * probe, GstClockTime now)
+{
+  probe->interval_start = now;
+  probe->buffers = 0;
+  probe->bytes = 0;
+  probe->max_gap = 0;
+  probe->latency_count = 0;
+  probe->latency_sum = 0;
+  probe->latency_min = GST_CLOCK_TIME_NONE;
+  probe->latency_max = 0;
+}
+
+static gboolean
+gst_perf_probe_start (GstBaseTransform * trans)
+{
+  GstPerfProbe *probe = GST_PERF_PROBE (trans);
+  GstObject *parent;
+  GstElement *upstream = NULL;
+  gchar *name;
+
+  gst_perf_probe_reset_stats (probe, GST_CLOCK_TIME_NONE);
+  probe->last_arrival = GST_CLOCK_TIME_NONE;
+  probe->last_pts = GST_CLOCK_TIME_NONE;
+  probe->jitter = 0;
+
+  GST_OBJECT_LOCK (probe);
+  name = g_strdup (probe->upstream_name);
+  GST_OBJECT_UNLOCK (probe);
+
+  if (name == NULL)
+    return TRUE;
+
+  parent = gst_object_get_parent (GST_OBJECT (probe));
+  if (parent) {
+    if (GST_IS_BIN (parent))
+      upstream = gst_bin_get_by_name_recurse_up (GST_BIN (parent), name);
+    gst_object_unref (parent);
+  }
+
+  if (upstream && GST_IS_PERF_PROBE (upstream) && upstream != (gpointer) probe) {
+    GST_DEBUG_OBJECT (probe, "measuring the latency from %s", name);
+    probe->upstream = GST_PERF_PROBE (upstream);
+    g_atomic_int_inc (&probe->upstream->n_downstream);
+  } else {
+    GST_WARNING_OBJECT (probe, "no upstream perfprobe named %s", name);
+    if (upstream)
+      gst_object_unref (upstream);
+  }
+  g_free (name);
+
+  return TRUE;
+}
+
+static gboolean
+gst_perf_probe_stop (GstBaseTransform * trans)
+{
+  GstPerfProbe *probe = GST_PERF_PROBE (trans);
+
+  if (probe->upstream) {
+    g_atomic_int_add (&probe->upstream->n_downstream, -1);
+    gst_object_unref (probe->upstream);
+    probe->upstream = NULL;
+  }
+
+  return TRUE;
+}
+
+/* the first queue or queue2 linked to the probe, downstream first */
+static GstElement *
+gst_perf_probe_get_queue (GstPerfProbe * probe)
+{
+  GstPad *pads[2];
+  gint i;
+
+  pads[0] = GST_BASE_TRANSFORM_SRC_PAD (probe);
+  pads[1] = GST_BASE_TRANSFORM_SINK_PAD (probe);
+
+  for (i = 0; i < 2; i++) {
+    GstPad *peer = gst_pad_get_peer (pads[i]);
+    GstElement *element;
+
+    if (peer == NULL)
+      continue;
+
+    element = gst_pad_get_parent_element (peer);
+    gst_object_unref (peer);
+    if (element == NULL)
+      continue;
+
+    if (g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+            "current-level-time"))
+      return element;
+    gst_object_unref (element);
+  }
+
+  return NULL;
+}
+
+static void
+gst_perf_probe_post_stats (GstPerfProbe * probe, GstClockTime now)
+{
+  GstClockTime elapsed = now - probe->interval_start;
+  GstElement *queue;
+  GstStructure *s;
+
+  s = gst_structure_new ("perfprobe",
+      "buffers", G_TYPE_UINT64, probe->buffers,
+      "bytes", G_TYPE_UINT64, probe->bytes,
+      "buffer-rate", G_TYPE_DOUBLE,
+      (gdouble) probe->buffers * GST_SECOND / elapsed,
+      "byte-rate", G_TYPE_DOUBLE,
+      (gdouble) probe->bytes * GST_SECOND / elapsed,
+      "max-gap", G_TYPE_UINT64, probe->max_gap,
+      "jitter", G_TYPE_UINT64, (guint64) probe->jitter, NULL);
+
+  if (probe->latency_count > 0) {
+    gst_structure_set (s,
+        "latency-min", G_TYPE_UINT64, probe->latency_min,
+        "latency-avg", G_TYPE_UINT64,
+        probe->latency_sum / probe->latency_count,
+        "latency-max", G_TYPE_UINT64, probe->latency_max,
+        "latency-count", G_TYPE_UINT64, probe->latency_count, NULL);
+  }
+
+  queue = gst_perf_probe_get_queue (probe);
+  if (queue) {
+    guint buffers, bytes;
+    guint64 time;
+    gchar *name;
+
+    g_object_get (queue, "current-level-buffers", &buffers,
+        "current-level-bytes", &bytes, "current-level-time", &time, NULL);
+    name = gst_element_get_name (queue);
+    gst_structure_set (s, "queue", G_TYPE_STRING, name,
+        "queue-level-buffers", G_TYPE_UINT, buffers,
+        "queue-level-bytes", G_TYPE_UINT, bytes,
+        "queue-level-time", G_TYPE_UINT64, time, NULL);
+    g_free (name);
+    gst_object_unref (queue);
+  }
+
+  GST_LOG_OBJECT (probe, "posting %" GST_PTR_FORMAT, s);
+
+  gst_element_post_message (GST_ELEMENT_CAST (probe),
+      gst_message_new_element (GST_OBJECT_CAST (probe), s));
+
+  gst_perf_probe_reset_stats (probe, now);
+}
+
+/* remembers when @pts went through for the downstream probes */
+static void
+gst_perf_probe_record (GstPerfProbe * probe, GstClockTime pts,
+    GstClockTime now)
+{
+  GstPerfProbeSlot *slot = &probe->ring[SLOT_INDEX (pts)];
+
+  g_atomic_int_inc (&slot->seq);
+  slot->pts = pts;
+  slot->time = now;
+  g_atomic_int_inc (&slot->seq);
+}
+
+/* the latency since @pts went through the upstream probe, if it is still
+ * in its ring and was not being overwritten */
+static void
+gst_perf_probe_match (GstPerfProbe * probe, GstClockTime pts,
+    GstClockTime now)
+{
+  GstPerfProbeSlot *slot = &probe->upstream->ring[SLOT_INDEX (pts)];
+  GstClockTime slot_pts, slot_time, latency;
+  gint seq;
+
+  seq = g_atomic_int_get (&slot->seq);
+  if (seq & 1)
+    return;
+  slot_pts = slot->pts;
+  slot_time = slot->time;
+  if (g_atomic_int_get (&slot->seq) != seq || slot_pts != pts ||
+      slot_time > now)
+    return;
+
+  latency = now - slot_time;
+  probe->latency_count++;
+  probe->latency_sum += latency;
+  if (latency < probe->latency_min)
+    probe->latency_min = latency;
+  if (latency > probe->latency_max)
+    probe->latency_max = latency;
+}
+
+static GstFlowReturn
+gst_perf_probe_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
+{
+  GstPerfProbe *probe = GST_PERF_PROBE (trans);
+  GstClockTime now = gst_util_get_timestamp ();
+  GstClockTime pts = GST_BUFFER_TIMESTAMP (buf);
+  guint interval = probe->interval;
+
+  if (!GST_CLOCK_TIME_IS_VALID (probe->interval_start))
+    probe->interval_start = now;
+
+  probe->buffers++;
+  probe->bytes += gst_buffer_get_size (buf);
+
+  if (GST_CLOCK_TIME_IS_VALID (probe->last_arrival)) {
+    GstClockTimeDiff gap = GST_CLOCK_DIFF (probe->last_arrival, now);
+
+    if (gap > (GstClockTimeDiff) probe->max_gap)
+      probe->max_gap = gap;
+
+    /* RFC 3550 interarrival jitter */
+    if (GST_CLOCK_TIME_IS_VALID (pts) &&
+        GST_CLOCK_TIME_IS_VALID (probe->last_pts)) {
+      GstClockTimeDiff d = gap - GST_CLOCK_DIFF (probe->last_pts, pts);
+
+      probe->jitter += (ABS (d) - probe->jitter) / 16.0;
+    }
+  }
+  probe->last_arrival = now;
+  probe->last_pts = pts;
+
+  if (GST_CLOCK_TIME_IS_VALID (pts)) {
+    if (g_atomic_int_get (&probe->n_downstream) > 0)
+      gst_perf_probe_record (probe, pts, now);
+    if (probe->upstream)
+      gst_perf_probe_match (probe, pts, now);
+  }
+
+  if (interval > 0 && now - probe->interval_start >=
+      (GstClockTime) interval * GST_MSECOND)
+    gst_perf_probe_post_stats (probe, now);
+
+  return GST_FLOW_OK;
+}
@@ -0,0 +1,88 @@
+/* GStreamer
+ *
+ * gstperfprobe.h: throughput and latency instrumentation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef _GST_PERF_PROBE_H_
+#define _GST_PERF_PROBE_H_
+
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_PERF_PROBE   (gst_perf_probe_get_type())
+#define GST_PERF_PROBE(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PERF_PROBE,GstPerfProbe))
+#define GST_PERF_PROBE_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_PERF_PROBE,GstPerfProbeClass))
+#define GST_IS_PERF_PROBE(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PERF_PROBE))
+#define GST_IS_PERF_PROBE_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_PERF_PROBE))
+
+typedef struct _GstPerfProbe GstPerfProbe;
+typedef struct _GstPerfProbeClass GstPerfProbeClass;
+
+#define GST_PERF_PROBE_RING_SIZE 256
+
+/* arrival time of a PTS, written by the streaming thread of the probe and
+ * read by the downstream probes. seq is odd while the slot is written. */
+typedef struct
+{
+  volatile gint seq;
+  GstClockTime pts;
+  GstClockTime time;
+} GstPerfProbeSlot;
+
+struct _GstPerfProbe
+{
+  GstBaseTransform base_perf_probe;
+
+  /* properties */
+  guint interval;
+  gchar *upstream_name;
+
+  /* statistics of the current interval, only touched by the streaming
+   * thread */
+  GstClockTime interval_start;
+  guint64 buffers;
+  guint64 bytes;
+  GstClockTime last_arrival;
+  GstClockTime last_pts;
+  GstClockTime max_gap;
+  gdouble jitter;
+  guint64 latency_count;
+  GstClockTime latency_sum;
+  GstClockTime latency_min;
+  GstClockTime latency_max;
+
+  /* probe the latency is measured from */
+  GstPerfProbe *upstream;
+
+  /* arrival times for the downstream probes, only written when n_downstream
+   * is not 0 */
+  volatile gint n_downstream;
+  GstPerfProbeSlot ring[GST_PERF_PROBE_RING_SIZE];
+};
+
+struct _GstPerfProbeClass
+{
+  GstBaseTransformClass base_perf_probe_class;
+};
+
+GType gst_perf_probe_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -25,75 +25,271 @@
 
 #include <gst/gst.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "gstdvdspu.h"
 
 GST_DEBUG_CATEGORY_EXTERN (dvdspu_debug);
 #define GST_CAT_DEFAULT dvdspu_debug
 
-void
-gstspu_clear_comp_buffers (SpuState * state)
+SpuOverlay *
+gstspu_overlay_new (gint16 left, gint16 top, gint16 width, gint16 height)
 {
-  /* The area to clear is the line inside the disp_rect, each entry 4 bytes,
-   * of the sub-sampled UV planes. */
-  gint16 left = state->comp_left / 2;
-  gint16 right = state->comp_right / 2;
-  gint16 uv_width = sizeof (guint32) * (right - left + 1);
-
-  memset (state->comp_bufs[0] + left, 0, uv_width);
-  memset (state->comp_bufs[1] + left, 0, uv_width);
-  memset (state->comp_bufs[2] + left, 0, uv_width);
+  SpuOverlay *overlay = g_slice_new0 (SpuOverlay);
+  gint n_uv;
+
+  g_return_val_if_fail (left >= 0 && top >= 0, NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+
+  overlay->left = left;
+  overlay->top = top;
+  overlay->width = width;
+  overlay->height = height;
+  overlay->Y = g_new0 (guint16, width * height);
+  overlay->A = g_new0 (guint8, width * height);
+
+  /* The chroma blocks are aligned to even positions in the frame, so an
+   * overlay starting on an odd position covers half a block on that side */
+  overlay->uv_width = (left + width + 1) / 2 - left / 2;
+  overlay->uv_height = (top + height + 1) / 2 - top / 2;
+  n_uv = overlay->uv_width * overlay->uv_height;
+  overlay->U = g_new0 (guint32, 3 * n_uv);
+  overlay->V = overlay->U + n_uv;
+  overlay->UV_A = overlay->V + n_uv;
+
+  return overlay;
 }
 
 void
-gstspu_blend_comp_buffers (SpuState * state, guint8 * planes[3])
+gstspu_overlay_free (SpuOverlay * overlay)
+{
+  g_free (overlay->Y);
+  g_free (overlay->A);
+  g_free (overlay->U);
+  g_slice_free (SpuOverlay, overlay);
+}
+
+typedef void (*SpuBlendLumaFunc) (guint8 * dest, const guint16 * Y,
+    const guint8 * A, gint n);
+typedef void (*SpuBlendChromaFunc) (guint8 * dest, gint pstride,
+    const guint32 * C, const guint32 * A, gint n);
+
+static void
+gstspu_blend_luma_line_c (guint8 * dest, const guint16 * Y, const guint8 * A,
+    gint n)
+{
+  gint x;
+
+  for (x = 0; x < n; x++) {
+    if (A[x])
+      dest[x] = ((0xff - A[x]) * dest[x] + Y[x]) / 0xff;
+  }
+}
+
+static void
+gstspu_blend_chroma_line_c (guint8 * dest, gint pstride, const guint32 * C,
+    const guint32 * A, gint n)
+{
+  gint x;
+
+  for (x = 0; x < n; x++) {
+    /* Each entry is the sum of 4 pixels, so the inverse alpha is
+     * (4 * 0xff) - A */
+    if (A[x]) {
+      guint8 *out = dest + x * pstride;
+
+      *out = (C[x] + (4 * 0xff - A[x]) * *out) / (4 * 0xff);
+    }
+  }
+}
+
+/* The SSE2 versions blend blocks of 8 luma or 4 chroma samples and leave
+ * the rest of the line to the C versions */
+static void
+gstspu_blend_luma_line (guint8 * dest, const guint16 * Y, const guint8 * A,
+    gint n)
+{
+  gint x = 0;
+
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i max_A = _mm_set1_epi16 (0xff);
+  const __m128i one = _mm_set1_epi16 (1);
+
+  for (; x + 8 <= n; x += 8) {
+    __m128i a = _mm_loadl_epi64 ((const __m128i *) (A + x));
+    __m128i d, t;
+
+    /* Skip fully transparent pixels */
+    if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, zero)) == 0xffff)
+      continue;
+
+    a = _mm_unpacklo_epi8 (a, zero);
+    d = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (dest + x)),
+        zero);
+
+    /* (inv_A * dest + Y) / 0xff. The sum is at most 0xff * 0xff, for which
+     * (t + 1 + (t >> 8)) >> 8 is the exact quotient */
+    t = _mm_add_epi16 (_mm_mullo_epi16 (_mm_sub_epi16 (max_A, a), d),
+        _mm_loadu_si128 ((const __m128i *) (Y + x)));
+    t = _mm_srli_epi16 (_mm_add_epi16 (_mm_add_epi16 (t, one),
+            _mm_srli_epi16 (t, 8)), 8);
+    _mm_storel_epi64 ((__m128i *) (dest + x), _mm_packus_epi16 (t, t));
+  }
+#endif
+
+  gstspu_blend_luma_line_c (dest + x, Y + x, A + x, n - x);
+}
+
+static void
+gstspu_blend_chroma_line (guint8 * dest, gint pstride, const guint32 * C,
+    const guint32 * A, gint n)
 {
-  gint16 uv_end;
-  gint16 left, x;
-  guint8 *out_U;
-  guint8 *out_V;
-  guint32 *in_U;
-  guint32 *in_V;
-  guint32 *in_A;
-  gint16 comp_last_x = state->comp_right;
-
-  if (comp_last_x < state->comp_left)
-    return;                     /* Didn't draw in the comp buffers, nothing to do... */
-
-#if 0
-  GST_LOG ("Blending comp buffers from x=%d to x=%d",
-      state->comp_left, state->comp_right);
+  gint x = 0;
+
+#ifdef __SSE2__
+  if (pstride == 1) {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i max_A = _mm_set1_epi32 (4 * 0xff);
+    const __m128i one = _mm_set1_epi32 (1);
+
+    for (; x + 4 <= n; x += 4) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (A + x));
+      __m128i d, t;
+
+      if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (a, zero)) == 0xffff)
+        continue;
+
+      d = _mm_cvtsi32_si128 (GST_READ_UINT32_LE (dest + x));
+      d = _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (d, zero), zero);
+
+      /* (C + inv_A * dest) / (4 * 0xff), computed as a division by 4 and
+       * then by 0xff, which gives the same quotient */
+      t = _mm_madd_epi16 (_mm_sub_epi32 (max_A, a), d);
+      t = _mm_srli_epi32 (_mm_add_epi32 (t,
+              _mm_loadu_si128 ((const __m128i *) (C + x))), 2);
+      t = _mm_srli_epi32 (_mm_add_epi32 (_mm_add_epi32 (t, one),
+              _mm_srli_epi32 (t, 8)), 8);
+      t = _mm_packs_epi32 (t, t);
+      GST_WRITE_UINT32_LE (dest + x,
+          _mm_cvtsi128_si32 (_mm_packus_epi16 (t, t)));
+    }
+  }
 #endif
 
-  /* Set up the output pointers */
-  out_U = planes[1];            /* U plane */
-  out_V = planes[2];            /* V plane */
-
-  /* Input starts at the first pixel of the compositing buffer */
-  in_U = state->comp_bufs[0];   /* U comp buffer */
-  in_V = state->comp_bufs[1];   /* V comp buffer */
-  in_A = state->comp_bufs[2];   /* A comp buffer */
-
-  /* Calculate how many pixels to blend based on the maximum X value that was 
-   * drawn in the render_line function, divided by 2 (rounding up) to account 
-   * for UV sub-sampling */
-  uv_end = (comp_last_x + 1) / 2;
-  left = state->comp_left / 2;
-
-  out_U += left * GST_VIDEO_INFO_COMP_PSTRIDE (&state->info, 1);
-  out_V += left * GST_VIDEO_INFO_COMP_PSTRIDE (&state->info, 2);
-  for (x = left; x < uv_end; x++) {
-    guint32 tmp;
-    /* Each entry in the compositing buffer is 4 summed pixels, so the
-     * inverse alpha is (4 * 0xff) - in_A[x] */
-    guint16 inv_A = (4 * 0xff) - in_A[x];
-
-    tmp = in_U[x] + inv_A * *out_U;
-    *out_U = (guint8) (tmp / (4 * 0xff));
-
-    tmp = in_V[x] + inv_A * *out_V;
-    *out_V = (guint8) (tmp / (4 * 0xff));
-
-    out_U += GST_VIDEO_INFO_COMP_PSTRIDE (&state->info, 1);
-    out_V += GST_VIDEO_INFO_COMP_PSTRIDE (&state->info, 2);
+  gstspu_blend_chroma_line_c (dest + x * pstride, pstride, C + x, A + x,
+      n - x);
+}
+
+static void
+gstspu_overlay_blend_lines (SpuOverlay * overlay, GstVideoFrame * frame,
+    SpuBlendLumaFunc blend_luma, SpuBlendChromaFunc blend_chroma)
+{
+  gint w, h, uv_left, uv_top, uv_w, uv_h, y, c;
+  guint8 *data;
+  gint stride;
+
+  w = MIN (overlay->width, GST_VIDEO_FRAME_WIDTH (frame) - overlay->left);
+  h = MIN (overlay->height, GST_VIDEO_FRAME_HEIGHT (frame) - overlay->top);
+  if (w <= 0 || h <= 0)
+    return;
+
+  data = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  data += overlay->top * stride + overlay->left;
+  for (y = 0; y < h; y++) {
+    blend_luma (data, overlay->Y + y * overlay->width,
+        overlay->A + y * overlay->width, w);
+    data += stride;
+  }
+
+  uv_left = overlay->left / 2;
+  uv_top = overlay->top / 2;
+  uv_w = MIN (overlay->uv_width, GST_VIDEO_FRAME_COMP_WIDTH (frame, 1) -
+      uv_left);
+  uv_h = MIN (overlay->uv_height, GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1) -
+      uv_top);
+
+  for (c = 1; c <= 2; c++) {
+    const guint32 *in = (c == 1) ? overlay->U : overlay->V;
+    gint pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, c);
+
+    data = GST_VIDEO_FRAME_COMP_DATA (frame, c);
+    stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, c);
+    data += uv_top * stride + uv_left * pstride;
+    for (y = 0; y < uv_h; y++) {
+      blend_chroma (data, pstride, in + y * overlay->uv_width,
+          overlay->UV_A + y * overlay->uv_width, uv_w);
+      data += stride;
+    }
+  }
+}
+
+/* Blend the pre-multiplied overlay onto an I420, YV12 or NV12 frame */
+void
+gstspu_overlay_blend (SpuOverlay * overlay, GstVideoFrame * frame)
+{
+  gstspu_overlay_blend_lines (overlay, frame, gstspu_blend_luma_line,
+      gstspu_blend_chroma_line);
+}
+
+/* Convert the overlay into a pre-multiplied AYUV rectangle for downstream
+ * blending. The chroma of each pixel is the alpha weighted average of its
+ * 2x2 block */
+GstVideoOverlayRectangle *
+gstspu_overlay_to_rectangle (SpuOverlay * overlay)
+{
+  GstVideoOverlayRectangle *rect;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint8 *out;
+  gint x, y;
+
+  buf = gst_buffer_new_and_alloc (overlay->width * overlay->height * 4);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  out = map.data;
+  for (y = 0; y < overlay->height; y++) {
+    gint uv_row = ((overlay->top + y) / 2 - overlay->top / 2) *
+        overlay->uv_width;
+
+    for (x = 0; x < overlay->width; x++) {
+      gint i = y * overlay->width + x;
+      gint j = uv_row + (overlay->left + x) / 2 - overlay->left / 2;
+      guint32 a = overlay->A[i];
+      guint32 uv_a = overlay->UV_A[j] * 0xff;
+
+      out[0] = a;
+      out[1] = (overlay->Y[i] + 0x7f) / 0xff;
+      out[2] = uv_a ? overlay->U[j] * a / uv_a : 0;
+      out[3] = uv_a ? overlay->V[j] * a / uv_a : 0;
+      out += 4;
+    }
+  }
+  gst_buffer_unmap (buf, &map);
+
+  gst_buffer_add_video_meta (buf, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_OVERLAY_COMPOSITION_FORMAT_YUV, overlay->width,
+      overlay->height);
+  rect = gst_video_overlay_rectangle_new_raw (buf, overlay->left,
+      overlay->top, overlay->width, overlay->height,
+      GST_VIDEO_OVERLAY_FORMAT_FLAG_PREMULTIPLIED_ALPHA);
+  gst_buffer_unref (buf);
+
+  return rect;
+}
+
+/* Drop the decoded subpicture, it will be rendered again on the next
+ * frame that shows it */
+void
+gstspu_clear_overlays (SpuState * state)
+{
+  if (state->overlays)
+    g_ptr_array_set_size (state->overlays, 0);
+  if (state->composition) {
+    gst_video_overlay_composition_unref (state->composition);
+    state->composition = NULL;
   }
+  state->overlays_dirty = TRUE;
 }
@@ -178,6 +178,8 @@ gst_dvd_spu_init (GstDVDSpu * dvdspu)
 
   g_mutex_init (&dvdspu->spu_lock);
   dvdspu->pending_spus = g_queue_new ();
+  dvdspu->spu_state.overlays =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) gstspu_overlay_free);
 
   gst_dvd_spu_clear (dvdspu);
 }
@@ -216,14 +218,9 @@ static void
 gst_dvd_spu_finalize (GObject * object)
 {
   GstDVDSpu *dvdspu = GST_DVD_SPU (object);
-  gint i;
 
-  for (i = 0; i < 3; i++) {
-    if (dvdspu->spu_state.comp_bufs[i] != NULL) {
-      g_free (dvdspu->spu_state.comp_bufs[i]);
-      dvdspu->spu_state.comp_bufs[i] = NULL;
-    }
-  }
+  gstspu_clear_overlays (&dvdspu->spu_state);
+  g_ptr_array_free (dvdspu->spu_state.overlays, TRUE);
   g_queue_free (dvdspu->pending_spus);
   g_mutex_clear (&dvdspu->spu_lock);
 
@@ -269,6 +266,8 @@ gst_dvd_spu_flush_spu_info (GstDVDSpu * dvdspu, gboolean keep_events)
   state->flags &= ~(SPU_STATE_FLAGS_MASK);
   state->next_ts = GST_CLOCK_TIME_NONE;
 
+  gstspu_clear_overlays (state);
+
   switch (dvdspu->spu_input_type) {
     case SPU_INPUT_TYPE_VOBSUB:
       gstspu_vobsub_flush (dvdspu);
@@ -327,7 +326,6 @@ gst_dvd_spu_video_set_caps (GstPad * pad, GstCaps * caps)
   GstDVDSpu *dvdspu = GST_DVD_SPU (gst_pad_get_parent (pad));
   gboolean res = FALSE;
   GstVideoInfo info;
-  gint i;
   SpuState *state;
 
   if (!gst_video_info_from_caps (&info, caps))
@@ -338,10 +336,8 @@ gst_dvd_spu_video_set_caps (GstPad * pad, GstCaps * caps)
   state = &dvdspu->spu_state;
 
   state->info = info;
-  for (i = 0; i < 3; i++) {
-    state->comp_bufs[i] = g_realloc (state->comp_bufs[i],
-        sizeof (guint32) * info.width);
-  }
+  /* The overlays are clipped to the frame size */
+  gstspu_clear_overlays (state);
   DVD_SPU_UNLOCK (dvdspu);
 
   res = TRUE;
@@ -350,6 +346,39 @@ done:
   return res;
 }
 
+/* Check if downstream can blend the subpicture itself */
+static void
+gst_dvd_spu_check_overlay_meta (GstDVDSpu * dvdspu)
+{
+  GstCaps *caps;
+  GstQuery *query;
+  gboolean attach = FALSE;
+
+  caps = gst_pad_get_current_caps (dvdspu->srcpad);
+  if (caps == NULL)
+    return;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  if (!gst_pad_peer_query (dvdspu->srcpad, query)) {
+    /* no problem, we use the query defaults */
+    GST_DEBUG_OBJECT (dvdspu, "ALLOCATION query failed");
+  }
+
+  if (gst_query_find_allocation_meta (query,
+          GST_VIDEO_OVERLAY_COMPOSITION_META_API_TYPE, NULL))
+    attach = TRUE;
+
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  GST_DEBUG_OBJECT (dvdspu, "%s the subpicture to the video buffers",
+      attach ? "Attaching" : "Blending");
+
+  DVD_SPU_LOCK (dvdspu);
+  dvdspu->attach_compo_to_buffer = attach;
+  DVD_SPU_UNLOCK (dvdspu);
+}
+
 static GstCaps *
 gst_dvd_spu_video_proxy_getcaps (GstPad * pad, GstCaps * filter)
 {
@@ -417,6 +446,8 @@ gst_dvd_spu_video_event (GstPad * pad, GstObject * parent, GstEvent * event)
         res = gst_pad_push_event (dvdspu->srcpad, event);
       else
         gst_event_unref (event);
+      if (res)
+        gst_dvd_spu_check_overlay_meta (dvdspu);
       break;
     }
     case GST_EVENT_CUSTOM_DOWNSTREAM:
@@ -563,6 +594,10 @@ gst_dvd_spu_video_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   GST_LOG_OBJECT (dvdspu, "video buffer %p with TS %" GST_TIME_FORMAT,
       buf, GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buf)));
 
+  /* downstream changed, it may (no longer) support the overlay meta */
+  if (gst_pad_check_reconfigure (dvdspu->srcpad))
+    gst_dvd_spu_check_overlay_meta (dvdspu);
+
   ret = dvdspu_handle_vid_buffer (dvdspu, buf);
 
   return ret;
@@ -668,20 +703,60 @@ no_ref_frame:
 static void
 gstspu_render (GstDVDSpu * dvdspu, GstBuffer * buf)
 {
+  SpuState *state = &dvdspu->spu_state;
   GstVideoFrame frame;
+  guint i;
 
-  gst_video_frame_map (&frame, &dvdspu->spu_state.info, buf, GST_MAP_READWRITE);
+  /* Decode the subpicture only when it changed, and reuse the overlays for
+   * all the frames it is shown on */
+  if (state->overlays_dirty) {
+    gstspu_clear_overlays (state);
 
-  switch (dvdspu->spu_input_type) {
-    case SPU_INPUT_TYPE_VOBSUB:
-      gstspu_vobsub_render (dvdspu, &frame);
-      break;
-    case SPU_INPUT_TYPE_PGS:
-      gstspu_pgs_render (dvdspu, &frame);
-      break;
-    default:
-      break;
+    switch (dvdspu->spu_input_type) {
+      case SPU_INPUT_TYPE_VOBSUB:
+        gstspu_vobsub_render (dvdspu);
+        break;
+      case SPU_INPUT_TYPE_PGS:
+        gstspu_pgs_render (dvdspu);
+        break;
+      default:
+        break;
+    }
+    state->overlays_dirty = FALSE;
+
+    GST_DEBUG_OBJECT (dvdspu, "Decoded subpicture into %u overlays",
+        state->overlays->len);
   }
+
+  if (dvdspu->attach_compo_to_buffer) {
+    if (state->composition == NULL) {
+      for (i = 0; i < state->overlays->len; i++) {
+        GstVideoOverlayRectangle *rect;
+
+        rect = gstspu_overlay_to_rectangle (g_ptr_array_index (state->overlays,
+                i));
+        if (state->composition)
+          gst_video_overlay_composition_add_rectangle (state->composition,
+              rect);
+        else
+          state->composition = gst_video_overlay_composition_new (rect);
+        gst_video_overlay_rectangle_unref (rect);
+      }
+    }
+
+    if (state->composition)
+      gst_buffer_add_video_overlay_composition_meta (buf, state->composition);
+    return;
+  }
+
+  gst_video_frame_map (&frame, &state->info, buf, GST_MAP_READWRITE);
+
+  for (i = 0; i < state->overlays->len; i++)
+    gstspu_overlay_blend (g_ptr_array_index (state->overlays, i), &frame);
+
+  if (dvdspu->spu_input_type == SPU_INPUT_TYPE_VOBSUB)
+    gstspu_vobsub_draw_debug (dvdspu, &frame);
+
   gst_video_frame_unmap (&frame);
 }
 
@@ -751,6 +826,9 @@ gst_dvd_spu_handle_dvd_event (GstDVDSpu * dvdspu, GstEvent * event)
       break;
   }
 
+  if (hl_change)
+    dvdspu->spu_state.overlays_dirty = TRUE;
+
   if (hl_change && (dvdspu->spu_state.flags & SPU_STATE_STILL_FRAME)) {
     gst_dvd_spu_redraw_still (dvdspu, FALSE);
   }
@@ -71,9 +71,11 @@ struct SpuState {
 
   GstVideoInfo info;
 
-  guint32 *comp_bufs[3]; /* Compositing buffers for U+V & A */
-  guint16 comp_left;
-  guint16 comp_right;
+  /* SpuOverlays the current subpicture was decoded into, and the same as
+   * a composition when downstream does the blending */
+  GPtrArray *overlays;
+  gboolean overlays_dirty;
+  GstVideoOverlayComposition *composition;
 
   SpuVobsubState vobsub;
   SpuPgsState pgs;
@@ -116,6 +118,10 @@ struct _GstDVDSpu {
 
   /* Buffer to push after handling a DVD event, if any */
   GstBuffer *pending_frame;
+
+  /* Attach the subpicture as overlay composition meta instead of blending
+   * it, if downstream supports that */
+  gboolean attach_compo_to_buffer;
 };
 
 struct _GstDVDSpuClass {
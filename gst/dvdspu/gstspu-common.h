@@ -30,6 +30,7 @@ typedef struct _GstDVDSpu      GstDVDSpu;
 typedef struct SpuState SpuState;
 typedef struct SpuColour SpuColour;
 typedef struct SpuRect SpuRect;
+typedef struct SpuOverlay SpuOverlay;
 
 /* Describe the limits of a rectangle */
 struct SpuRect {
@@ -48,8 +49,34 @@ struct SpuColour {
   guint8 A;
 };
 
-void gstspu_clear_comp_buffers (SpuState * state);
-void gstspu_blend_comp_buffers (SpuState * state, guint8 * planes[3]);
+/* A subpicture decoded into a rectangle of pre-multiplied pixels, which
+ * can be blended on each frame without decoding the RLE data again */
+struct SpuOverlay {
+  gint16 left;
+  gint16 top;
+  gint16 width;
+  gint16 height;
+
+  /* Pre-multiplied luma and alpha, width * height entries */
+  guint16 *Y;
+  guint8 *A;
+
+  /* Pre-multiplied chroma and alpha, summed over each 2x2 block of pixels.
+   * The first entry is for the block containing (left, top) */
+  gint16 uv_width;
+  gint16 uv_height;
+  guint32 *U;
+  guint32 *V;
+  guint32 *UV_A;
+};
+
+SpuOverlay *gstspu_overlay_new (gint16 left, gint16 top, gint16 width,
+    gint16 height);
+void gstspu_overlay_free (SpuOverlay * overlay);
+void gstspu_overlay_blend (SpuOverlay * overlay, GstVideoFrame * frame);
+GstVideoOverlayRectangle *gstspu_overlay_to_rectangle (SpuOverlay * overlay);
+
+void gstspu_clear_overlays (SpuState * state);
 
 
 G_END_DECLS
@@ -169,17 +169,19 @@ dump_rle_data (GstDVDSpu * dvdspu, guint8 * data, guint32 len)
   PGS_DUMP ("\n");
 }
 
+/* Decode the RLE data of an object into an overlay */
 static void
-pgs_composition_object_render (PgsCompositionObject * obj, SpuState * state,
-    GstVideoFrame * frame)
+pgs_composition_object_render (PgsCompositionObject * obj, SpuState * state)
 {
   SpuColour *colour;
-  guint8 *planes[3];            /* YUV frame pointers */
-  gint strides[3];
+  SpuOverlay *overlay;
   guint8 *data, *end;
-  guint16 obj_w;
-  guint16 obj_h G_GNUC_UNUSED;
-  guint x, y, i, min_x, max_x;
+  guint16 obj_w, obj_h;
+  guint16 *out_Y;
+  guint8 *out_A;
+  guint32 *out_U, *out_V, *out_UV_A;
+  gint width, height;
+  guint x, y, i, max_x, max_y, uv_left;
 
   if (G_UNLIKELY (obj->rle_data == NULL || obj->rle_data_size == 0
           || obj->rle_data_used != obj->rle_data_size))
@@ -195,33 +197,31 @@ pgs_composition_object_render (PgsCompositionObject * obj, SpuState * state,
    * intersection of the crop rectangle for this object (if any) and the
    * window specified by the object's window_id */
 
-  /* Store the start of each plane */
-  planes[0] = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
-  planes[1] = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
-  planes[2] = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
-
-  strides[0] = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
-  strides[1] = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1);
-  strides[2] = GST_VIDEO_FRAME_COMP_STRIDE (frame, 2);
-
-  y = MIN (obj->y, state->info.height);
-
-  planes[0] += strides[0] * y;
-  planes[1] += strides[1] * (y / 2);
-  planes[2] += strides[2] * (y / 2);
-
   /* RLE data: */
   obj_w = GST_READ_UINT16_BE (data);
   obj_h = GST_READ_UINT16_BE (data + 2);
   data += 4;
 
-  min_x = MIN (obj->x, strides[0]);
-  max_x = MIN (obj->x + obj_w, strides[0]);
+  width = GST_VIDEO_INFO_WIDTH (&state->info);
+  height = GST_VIDEO_INFO_HEIGHT (&state->info);
+  if (obj_w == 0 || obj_h == 0 || obj->x >= width || obj->y >= height)
+    return;
+
+  /* Only the part of the object inside the frame is stored, but all the
+   * runs need decoding to find the start of the next line */
+  max_x = MIN (obj_w, width - obj->x);
+  max_y = MIN (obj_h, height - obj->y);
 
-  state->comp_left = x = min_x;
-  state->comp_right = max_x;
+  overlay = gstspu_overlay_new (obj->x, obj->y, max_x, max_y);
+  g_ptr_array_add (state->overlays, overlay);
 
-  gstspu_clear_comp_buffers (state);
+  out_Y = overlay->Y;
+  out_A = overlay->A;
+  out_U = overlay->U;
+  out_V = overlay->V;
+  out_UV_A = overlay->UV_A;
+  uv_left = obj->x / 2;
+  x = y = 0;
 
   while (data < end) {
     guint8 pal_id;
@@ -266,41 +266,36 @@ pgs_composition_object_render (PgsCompositionObject * obj, SpuState * state,
 
     colour = &state->pgs.palette[pal_id];
     if (colour->A) {
-      guint32 inv_A = 0xff - colour->A;
-      if (G_UNLIKELY (x + run_len > max_x))
-        run_len = (max_x - x);
+      guint run_end = MIN (x + run_len, max_x);
 
-      for (i = 0; i < run_len; i++) {
-        planes[0][x] = (inv_A * planes[0][x] + colour->Y) / 0xff;
+      for (i = x; i < run_end; i++) {
+        guint uv_x = (obj->x + i) / 2 - uv_left;
 
-        state->comp_bufs[0][x / 2] += colour->U;
-        state->comp_bufs[1][x / 2] += colour->V;
-        state->comp_bufs[2][x / 2] += colour->A;
-        x++;
+        out_Y[i] = colour->Y;
+        out_A[i] = colour->A;
+        out_U[uv_x] += colour->U;
+        out_V[uv_x] += colour->V;
+        out_UV_A[uv_x] += colour->A;
       }
-    } else {
-      x += run_len;
     }
+    x += run_len;
 
-    if (!run_len || x > max_x) {
-      x = min_x;
-      planes[0] += strides[0];
-
-      if (y % 2) {
-        gstspu_blend_comp_buffers (state, planes);
-        gstspu_clear_comp_buffers (state);
-
-        planes[1] += strides[1];
-        planes[2] += strides[2];
-      }
+    if (!run_len || x > obj_w) {
+      x = 0;
       y++;
-      if (y >= state->info.height)
+      if (y >= max_y)
         return;                 /* Hit the bottom */
+
+      out_Y += overlay->width;
+      out_A += overlay->width;
+      /* Two lines share each line of chroma */
+      if ((obj->y + y) % 2 == 0) {
+        out_U += overlay->uv_width;
+        out_V += overlay->uv_width;
+        out_UV_A += overlay->uv_width;
+      }
     }
   }
-
-  if (y % 2)
-    gstspu_blend_comp_buffers (state, planes);
 }
 
 static void
@@ -745,6 +740,8 @@ gstspu_pgs_execute_event (GstDVDSpu * dvdspu)
     gstspu_exec_pgs_buffer (dvdspu, state->pgs.pending_cmd);
     gst_buffer_unref (state->pgs.pending_cmd);
     state->pgs.pending_cmd = NULL;
+    /* Decode the new display set on the next frame */
+    state->overlays_dirty = TRUE;
   }
 
   state->next_ts = GST_CLOCK_TIME_NONE;
@@ -757,8 +754,9 @@ gstspu_pgs_execute_event (GstDVDSpu * dvdspu)
   return FALSE;
 }
 
+/* Decode the objects of the current display set into overlays */
 void
-gstspu_pgs_render (GstDVDSpu * dvdspu, GstVideoFrame * frame)
+gstspu_pgs_render (GstDVDSpu * dvdspu)
 {
   SpuState *state = &dvdspu->spu_state;
   PgsPresentationSegment *ps = &state->pgs.pres_seg;
@@ -770,7 +768,7 @@ gstspu_pgs_render (GstDVDSpu * dvdspu, GstVideoFrame * frame)
   for (i = 0; i < ps->objects->len; i++) {
     PgsCompositionObject *cur =
         &g_array_index (ps->objects, PgsCompositionObject, i);
-    pgs_composition_object_render (cur, state, frame);
+    pgs_composition_object_render (cur, state);
   }
 }
 
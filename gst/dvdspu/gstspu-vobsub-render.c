@@ -168,29 +168,56 @@ gstspu_vobsub_get_rle_code (SpuState * state, guint16 * rle_offset)
   return code;
 }
 
+/* Point the output at the current line of the overlay, or at nothing if
+ * the line is outside of it */
+static void
+gstspu_vobsub_setup_output_line (SpuState * state)
+{
+  SpuOverlay *overlay = state->vobsub.out_overlay;
+  gint16 y = state->vobsub.cur_Y - overlay->top;
+  gint uv_offset;
+
+  if (y < 0 || y >= overlay->height) {
+    state->vobsub.out_Y = NULL;
+    return;
+  }
+
+  state->vobsub.out_Y = overlay->Y + y * overlay->width;
+  state->vobsub.out_Y_A = overlay->A + y * overlay->width;
+
+  uv_offset = (state->vobsub.cur_Y / 2 - overlay->top / 2) * overlay->uv_width;
+  state->vobsub.out_U = overlay->U + uv_offset;
+  state->vobsub.out_V = overlay->V + uv_offset;
+  state->vobsub.out_A = overlay->UV_A + uv_offset;
+}
+
 static inline void
 gstspu_vobsub_draw_rle_run (SpuState * state, gint16 x, gint16 end,
     SpuColour * colour)
 {
+  SpuOverlay *overlay = state->vobsub.out_overlay;
+
 #if 0
   GST_LOG ("Y: %d x: %d end %d col %d %d %d %d",
       state->vobsub.cur_Y, x, end, colour->Y, colour->U, colour->V, colour->A);
 #endif
 
-  if (colour->A != 0) {
-    guint32 inv_A = 0xff - colour->A;
+  if (colour->A != 0 && state->vobsub.out_Y != NULL) {
+    gint16 left = overlay->left;
+    gint16 uv_left = left / 2;
+
+    x = MAX (x, left);
+    end = MIN (end, left + overlay->width);
 
-    /* FIXME: This could be more efficient */
+    /* Store the pre-multiplied colour, it is blended onto each frame */
     while (x < end) {
-      state->vobsub.out_Y[x] =
-          (inv_A * state->vobsub.out_Y[x] + colour->Y) / 0xff;
-      state->vobsub.out_U[x / 2] += colour->U;
-      state->vobsub.out_V[x / 2] += colour->V;
-      state->vobsub.out_A[x / 2] += colour->A;
+      state->vobsub.out_Y[x - left] = colour->Y;
+      state->vobsub.out_Y_A[x - left] = colour->A;
+      state->vobsub.out_U[x / 2 - uv_left] += colour->U;
+      state->vobsub.out_V[x / 2 - uv_left] += colour->V;
+      state->vobsub.out_A[x / 2 - uv_left] += colour->A;
       x++;
     }
-    /* Update the compositing buffer so we know how much to blend later */
-    *(state->vobsub.comp_last_x_ptr) = end - 1; /* end is the start of the *next* run */
   }
 }
 
@@ -205,12 +232,11 @@ rle_end_x (guint16 rle_code, gint16 x, gint16 end)
 }
 
 static void gstspu_vobsub_render_line_with_chgcol (SpuState * state,
-    guint8 * planes[3], guint16 * rle_offset);
+    guint16 * rle_offset);
 static gboolean gstspu_vobsub_update_chgcol (SpuState * state);
 
 static void
-gstspu_vobsub_render_line (SpuState * state, guint8 * planes[3],
-    guint16 * rle_offset)
+gstspu_vobsub_render_line (SpuState * state, guint16 * rle_offset)
 {
   gint16 x, next_x, end, rle_code, next_draw_x;
   SpuColour *colour;
@@ -222,7 +248,7 @@ gstspu_vobsub_render_line (SpuState * state, guint8 * planes[3],
       /* Check the top & bottom, because we might not be within the region yet */
       if (state->vobsub.cur_Y >= state->vobsub.cur_chg_col->top &&
           state->vobsub.cur_Y <= state->vobsub.cur_chg_col->bottom) {
-        gstspu_vobsub_render_line_with_chgcol (state, planes, rle_offset);
+        gstspu_vobsub_render_line_with_chgcol (state, rle_offset);
         return;
       }
     }
@@ -231,10 +257,7 @@ gstspu_vobsub_render_line (SpuState * state, guint8 * planes[3],
   /* No special case. Render as normal */
 
   /* Set up our output pointers */
-  state->vobsub.out_Y = planes[0];
-  state->vobsub.out_U = state->comp_bufs[0];
-  state->vobsub.out_V = state->comp_bufs[1];
-  state->vobsub.out_A = state->comp_bufs[2];
+  gstspu_vobsub_setup_output_line (state);
   /* We always need to start our RLE decoding byte_aligned */
   *rle_offset = GST_ROUND_UP_2 (*rle_offset);
 
@@ -283,8 +306,7 @@ gstspu_vobsub_update_chgcol (SpuState * state)
 }
 
 static void
-gstspu_vobsub_render_line_with_chgcol (SpuState * state, guint8 * planes[3],
-    guint16 * rle_offset)
+gstspu_vobsub_render_line_with_chgcol (SpuState * state, guint16 * rle_offset)
 {
   SpuVobsubLineCtrlI *chg_col = state->vobsub.cur_chg_col;
 
@@ -297,10 +319,7 @@ gstspu_vobsub_render_line_with_chgcol (SpuState * state, guint8 * planes[3],
   gint16 cur_reg_end;
   gint i;
 
-  state->vobsub.out_Y = planes[0];
-  state->vobsub.out_U = state->comp_bufs[0];
-  state->vobsub.out_V = state->comp_bufs[1];
-  state->vobsub.out_A = state->comp_bufs[2];
+  gstspu_vobsub_setup_output_line (state);
 
   /* We always need to start our RLE decoding byte_aligned */
   *rle_offset = GST_ROUND_UP_2 (*rle_offset);
@@ -360,31 +379,6 @@ gstspu_vobsub_render_line_with_chgcol (SpuState * state, guint8 * planes[3],
   }
 }
 
-static void
-gstspu_vobsub_blend_comp_buffers (SpuState * state, guint8 * planes[3])
-{
-  state->comp_left = state->vobsub.disp_rect.left;
-  state->comp_right =
-      MAX (state->vobsub.comp_last_x[0], state->vobsub.comp_last_x[1]);
-
-  state->comp_left = MAX (state->comp_left, state->vobsub.clip_rect.left);
-  state->comp_right = MIN (state->comp_right, state->vobsub.clip_rect.right);
-
-  gstspu_blend_comp_buffers (state, planes);
-}
-
-static void
-gstspu_vobsub_clear_comp_buffers (SpuState * state)
-{
-  state->comp_left = state->vobsub.clip_rect.left;
-  state->comp_right = state->vobsub.clip_rect.right;
-
-  gstspu_clear_comp_buffers (state);
-
-  state->vobsub.comp_last_x[0] = -1;
-  state->vobsub.comp_last_x[1] = -1;
-}
-
 static void
 gstspu_vobsub_draw_highlight (SpuState * state,
     GstVideoFrame * frame, SpuRect * rect)
@@ -409,30 +403,22 @@ gstspu_vobsub_draw_highlight (SpuState * state,
   }
 }
 
+/* Decode the current subpicture into an overlay */
 void
-gstspu_vobsub_render (GstDVDSpu * dvdspu, GstVideoFrame * frame)
+gstspu_vobsub_render (GstDVDSpu * dvdspu)
 {
   SpuState *state = &dvdspu->spu_state;
-  guint8 *planes[3];            /* YUV frame pointers */
+  SpuOverlay *overlay;
   gint y, last_y;
   gint width, height;
-  gint strides[3];
+  gint left, top, right, bottom;
 
   /* Set up our initial state */
   if (G_UNLIKELY (state->vobsub.pix_buf == NULL))
     return;
 
-  /* Store the start of each plane */
-  planes[0] = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
-  planes[1] = GST_VIDEO_FRAME_COMP_DATA (frame, 1);
-  planes[2] = GST_VIDEO_FRAME_COMP_DATA (frame, 2);
-
-  strides[0] = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
-  strides[1] = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1);
-  strides[2] = GST_VIDEO_FRAME_COMP_STRIDE (frame, 2);
-
-  width = GST_VIDEO_FRAME_WIDTH (frame);
-  height = GST_VIDEO_FRAME_HEIGHT (frame);
+  width = GST_VIDEO_INFO_WIDTH (&state->info);
+  height = GST_VIDEO_INFO_HEIGHT (&state->info);
 
   GST_DEBUG_OBJECT (dvdspu,
       "Rendering SPU. disp_rect %d,%d to %d,%d. hl_rect %d,%d to %d,%d",
@@ -530,69 +516,54 @@ gstspu_vobsub_render (GstDVDSpu * dvdspu, GstVideoFrame * frame)
         state->vobsub.clip_rect.bottom);
   }
 
+  /* Decode into an overlay covering the part of the clipped display rect
+   * that is inside the frame */
+  left = MAX (state->vobsub.clip_rect.left, 0);
+  top = MAX (state->vobsub.clip_rect.top, 0);
+  right = MIN (state->vobsub.clip_rect.right, width - 1);
+  bottom = MIN (state->vobsub.clip_rect.bottom, height - 1);
+  if (right < left || bottom < top)
+    return;
+
+  overlay = gstspu_overlay_new (left, top, right - left + 1, bottom - top + 1);
+  g_ptr_array_add (state->overlays, overlay);
+  state->vobsub.out_overlay = overlay;
+
   /* We start rendering from the first line of the display rect */
   y = state->vobsub.disp_rect.top;
   /* start_y is always an even number and we render lines in pairs from there,
-   * accumulating 2 lines of chroma then blending it. We might need to render a
-   * single line at the end if the display rect ends on an even line too. */
+   * accumulating 2 lines of chroma. We might need to render a single line at
+   * the end if the display rect ends on an even line too. */
   last_y = (state->vobsub.disp_rect.bottom - 1) & ~(0x01);
 
-  /* Update our plane references to the first line of the disp_rect */
-  planes[0] += strides[0] * y;
-  planes[1] += strides[1] * (y / 2);
-  planes[2] += strides[2] * (y / 2);
-
   for (state->vobsub.cur_Y = y; state->vobsub.cur_Y <= last_y;
       state->vobsub.cur_Y++) {
-    gboolean clip;
-
-    clip = (state->vobsub.cur_Y < state->vobsub.clip_rect.top
-        || state->vobsub.cur_Y > state->vobsub.clip_rect.bottom);
-
-    /* Reset the compositing buffer */
-    gstspu_vobsub_clear_comp_buffers (state);
     /* Render even line */
-    state->vobsub.comp_last_x_ptr = state->vobsub.comp_last_x;
-    gstspu_vobsub_render_line (state, planes, &state->vobsub.cur_offsets[0]);
-
-    /* Advance the luminance output pointer */
-    planes[0] += strides[0];
+    gstspu_vobsub_render_line (state, &state->vobsub.cur_offsets[0]);
 
     state->vobsub.cur_Y++;
 
     /* Render odd line */
-    state->vobsub.comp_last_x_ptr = state->vobsub.comp_last_x + 1;
-    gstspu_vobsub_render_line (state, planes, &state->vobsub.cur_offsets[1]);
-
-    if (!clip) {
-      /* Blend the accumulated UV compositing buffers onto the output */
-      gstspu_vobsub_blend_comp_buffers (state, planes);
-    }
-
-    /* Update all the output pointers */
-    planes[0] += strides[0];
-    planes[1] += strides[1];
-    planes[2] += strides[2];
+    gstspu_vobsub_render_line (state, &state->vobsub.cur_offsets[1]);
   }
 
   if (state->vobsub.cur_Y == state->vobsub.disp_rect.bottom) {
-    gboolean clip;
-
-    clip = (state->vobsub.cur_Y < state->vobsub.clip_rect.top
-        || state->vobsub.cur_Y > state->vobsub.clip_rect.bottom);
-
     g_assert ((state->vobsub.disp_rect.bottom & 0x01) == 0);
 
-    if (!clip) {
-      /* Render a remaining lone last even line. y already has the correct value
-       * after the above loop exited. */
-      gstspu_vobsub_clear_comp_buffers (state);
-      state->vobsub.comp_last_x_ptr = state->vobsub.comp_last_x;
-      gstspu_vobsub_render_line (state, planes, &state->vobsub.cur_offsets[0]);
-      gstspu_vobsub_blend_comp_buffers (state, planes);
-    }
+    /* Render a remaining lone last even line. y already has the correct value
+     * after the above loop exited. */
+    gstspu_vobsub_render_line (state, &state->vobsub.cur_offsets[0]);
   }
 
+  state->vobsub.out_overlay = NULL;
+  state->vobsub.out_Y = NULL;
+}
+
+void
+gstspu_vobsub_draw_debug (GstDVDSpu * dvdspu, GstVideoFrame * frame)
+{
+  SpuState *state = &dvdspu->spu_state;
+
   /* for debugging purposes, draw a faint rectangle at the edges of the disp_rect */
   if ((dvdspu_debug_flags & GST_DVD_SPU_DEBUG_RENDER_RECTANGLE) != 0) {
     gstspu_vobsub_draw_highlight (state, frame, &state->vobsub.disp_rect);
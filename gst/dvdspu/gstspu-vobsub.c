@@ -124,6 +124,9 @@ gst_dvd_spu_exec_cmd_blk (GstDVDSpu * dvdspu, guint8 * data, guint8 * end)
 {
   SpuState *state = &dvdspu->spu_state;
 
+  /* Any command can change the subpicture, decode it again when needed */
+  state->overlays_dirty = TRUE;
+
   while (data < end) {
     guint8 cmd;
 
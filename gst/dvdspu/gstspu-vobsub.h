@@ -80,8 +80,6 @@ struct SpuVobsubState {
                                    * need recalculating */
 
   /* Rendering state vars below */
-  gint16 comp_last_x[2]; /* Maximum X values we rendered into the comp buffer (odd & even) */
-  gint16 *comp_last_x_ptr; /* Ptr to the current comp_last_x value to be updated by the render */
 
   /* Current Y Position */
   gint16 cur_Y;
@@ -94,8 +92,10 @@ struct SpuVobsubState {
   SpuVobsubLineCtrlI *cur_chg_col;
   SpuVobsubLineCtrlI *cur_chg_col_end;
 
-  /* Output position tracking */
-  guint8  *out_Y;
+  /* Output position tracking, out_Y is NULL outside of the overlay */
+  SpuOverlay *out_overlay;
+  guint16 *out_Y;
+  guint8  *out_Y_A;
   guint32 *out_U;
   guint32 *out_V;
   guint32 *out_A;
@@ -103,7 +103,8 @@ struct SpuVobsubState {
 
 void gstspu_vobsub_handle_new_buf (GstDVDSpu * dvdspu, GstClockTime event_ts, GstBuffer *buf);
 gboolean gstspu_vobsub_execute_event (GstDVDSpu *dvdspu);
-void gstspu_vobsub_render (GstDVDSpu *dvdspu, GstVideoFrame *frame);
+void gstspu_vobsub_render (GstDVDSpu *dvdspu);
+void gstspu_vobsub_draw_debug (GstDVDSpu *dvdspu, GstVideoFrame *frame);
 gboolean gstspu_vobsub_handle_dvd_event (GstDVDSpu *dvdspu, GstEvent *event);
 void gstspu_vobsub_flush (GstDVDSpu *dvdspu);
 
@@ -54,6 +54,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
 
@@ -198,19 +202,6 @@ freeverb_allpass_getfeedback(freeverb_allpass* allpass)
   return allpass->feedback;
 }*/
 
-#define freeverb_allpass_process(_allpass, _input_1) \
-{ \
-  gfloat output; \
-  gfloat bufout; \
-  bufout = _allpass.buffer[_allpass.bufidx]; \
-  output = bufout-_input_1; \
-  _allpass.buffer[_allpass.bufidx] = _input_1 + (bufout * _allpass.feedback); \
-  if (++_allpass.bufidx >= _allpass.bufsize) { \
-    _allpass.bufidx = 0; \
-  } \
-  _input_1 = output; \
-}
-
 /* comb filter */
 
 typedef struct _freeverb_comb
@@ -277,17 +268,6 @@ freeverb_comb_getfeedback(freeverb_comb* comb)
   return comb->feedback;
 }*/
 
-#define freeverb_comb_process(_comb, _input_1, _output) \
-{ \
-  gfloat _tmp = _comb.buffer[_comb.bufidx]; \
-  _comb.filterstore = (_tmp * _comb.damp2) + (_comb.filterstore * _comb.damp1); \
-  _comb.buffer[_comb.bufidx] = _input_1 + (_comb.filterstore * _comb.feedback); \
-  if (++_comb.bufidx >= _comb.bufsize) { \
-    _comb.bufidx = 0; \
-  } \
-  _output += _tmp; \
-}
-
 #define numcombs 8
 #define numallpasses 4
 #define	fixedgain 0.015f
@@ -347,6 +327,137 @@ struct _GstFreeverbPrivate
   freeverb_allpass allpassR[numallpasses];
 };
 
+/* Filter banks
+ *
+ * The bank functions below run a whole block of samples through the filters
+ * of one channel, splitting the block at the next delay line wrap-around so
+ * that the inner loops are branch free. The 8 combs of a channel are
+ * independent and are computed as two vectors of 4 lanes when SSE is
+ * available. The comb outputs are summed in the same order as before, so the
+ * result is bit-identical to the per-sample code.
+ */
+#define FREEVERB_BLOCK_SIZE 256
+
+static void
+freeverb_comb_bank_process (freeverb_comb * combs, const gfloat * input,
+    gfloat * output, guint num_samples)
+{
+  gfloat *ptr[numcombs];
+  gfloat tmp[numcombs];
+  gfloat out;
+  guint i, k, n, len;
+#ifdef __SSE__
+  gfloat lanes[numcombs];
+  __m128 store0, store1, damp1_0, damp1_1, damp2_0, damp2_1, fb0, fb1, in;
+
+#define LOAD_LANES(field, v0, v1) \
+  for (i = 0; i < numcombs; i++) \
+    lanes[i] = combs[i].field; \
+  v0 = _mm_loadu_ps (lanes); \
+  v1 = _mm_loadu_ps (lanes + 4);
+
+  LOAD_LANES (filterstore, store0, store1);
+  LOAD_LANES (damp1, damp1_0, damp1_1);
+  LOAD_LANES (damp2, damp2_0, damp2_1);
+  LOAD_LANES (feedback, fb0, fb1);
+#undef LOAD_LANES
+#endif
+
+  for (n = 0; n < num_samples; n += len) {
+    len = num_samples - n;
+    for (i = 0; i < numcombs; i++) {
+      ptr[i] = combs[i].buffer + combs[i].bufidx;
+      len = MIN (len, combs[i].bufsize - combs[i].bufidx);
+    }
+
+    for (k = 0; k < len; k++) {
+      for (i = 0; i < numcombs; i++)
+        tmp[i] = ptr[i][k];
+
+#ifdef __SSE__
+      store0 = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (tmp), damp2_0),
+          _mm_mul_ps (store0, damp1_0));
+      store1 = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps (tmp + 4), damp2_1),
+          _mm_mul_ps (store1, damp1_1));
+      in = _mm_set1_ps (input[n + k]);
+      _mm_storeu_ps (lanes, _mm_add_ps (in, _mm_mul_ps (store0, fb0)));
+      _mm_storeu_ps (lanes + 4, _mm_add_ps (in, _mm_mul_ps (store1, fb1)));
+      for (i = 0; i < numcombs; i++)
+        ptr[i][k] = lanes[i];
+#else
+      for (i = 0; i < numcombs; i++) {
+        combs[i].filterstore = (tmp[i] * combs[i].damp2) +
+            (combs[i].filterstore * combs[i].damp1);
+        ptr[i][k] = input[n + k] + (combs[i].filterstore * combs[i].feedback);
+      }
+#endif
+
+      out = 0.0f;
+      for (i = 0; i < numcombs; i++)
+        out += tmp[i];
+      output[n + k] = out;
+    }
+
+    for (i = 0; i < numcombs; i++) {
+      combs[i].bufidx += len;
+      if (combs[i].bufidx >= combs[i].bufsize)
+        combs[i].bufidx = 0;
+    }
+  }
+
+#ifdef __SSE__
+  _mm_storeu_ps (lanes, store0);
+  _mm_storeu_ps (lanes + 4, store1);
+  for (i = 0; i < numcombs; i++)
+    combs[i].filterstore = lanes[i];
+#endif
+}
+
+static void
+freeverb_allpass_bank_process (freeverb_allpass * allpasses, gfloat * data,
+    guint num_samples)
+{
+  freeverb_allpass *allpass;
+  gfloat *buf, bufout, input;
+  guint i, k, n, len;
+
+  /* The allpasses are in series, but each one only depends on its own
+   * input, so the block can be run through them one after the other */
+  for (i = 0; i < numallpasses; i++) {
+    allpass = &allpasses[i];
+
+    for (n = 0; n < num_samples; n += len) {
+      len = MIN (num_samples - n, allpass->bufsize - allpass->bufidx);
+      buf = allpass->buffer + allpass->bufidx;
+
+      for (k = 0; k < len; k++) {
+        input = data[n + k];
+        bufout = buf[k];
+        buf[k] = input + (bufout * allpass->feedback);
+        data[n + k] = bufout - input;
+      }
+
+      allpass->bufidx += len;
+      if (allpass->bufidx >= allpass->bufsize)
+        allpass->bufidx = 0;
+    }
+  }
+}
+
+/* Run up to FREEVERB_BLOCK_SIZE samples through the reverb model */
+static void
+freeverb_revmodel_process (GstFreeverbPrivate * priv, const gfloat * input_l,
+    const gfloat * input_r, gfloat * output_l, gfloat * output_r,
+    guint num_samples)
+{
+  /* Accumulate comb filters in parallel */
+  freeverb_comb_bank_process (priv->combL, input_l, output_l, num_samples);
+  freeverb_comb_bank_process (priv->combR, input_r, output_r, num_samples);
+  /* Feed through allpasses in series */
+  freeverb_allpass_bank_process (priv->allpassL, output_l, num_samples);
+  freeverb_allpass_bank_process (priv->allpassR, output_r, num_samples);
+}
+
 static void
 freeverb_revmodel_init (GstFreeverb * filter)
 {
@@ -695,45 +806,44 @@ gst_freeverb_transform_m2s_int (GstFreeverb * filter,
     gint16 * idata, gint16 * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1;
+  guint i, k, len;
+  gfloat out_l1[FREEVERB_BLOCK_SIZE], out_r1[FREEVERB_BLOCK_SIZE];
+  gfloat input_1[FREEVERB_BLOCK_SIZE];
   gfloat out_l2, out_r2, input_2;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-
-    out_l1 = out_r1 = 0.0;
+  for (k = 0; k < num_samples; k += len) {
+    len = MIN (num_samples - k, FREEVERB_BLOCK_SIZE);
 
     /* The original Freeverb code expects a stereo signal and 'input_1'
      * is set to the sum of the left and right input_1 sample. Since
      * this code works on a mono signal, 'input_1' is set to twice the
      * input_1 sample. */
-    input_2 = (gfloat) * idata++;
-    input_1 = (2.0f * input_2 + DC_OFFSET) * priv->gain;
-
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+    for (i = 0; i < len; i++) {
+      input_2 = (gfloat) idata[i];
+      input_1[i] = (2.0f * input_2 + DC_OFFSET) * priv->gain;
     }
 
-    /* Remove the DC offset */
-    out_l1 -= DC_OFFSET;
-    out_r1 -= DC_OFFSET;
+    freeverb_revmodel_process (priv, input_1, input_1, out_l1, out_r1, len);
+
+    for (i = 0; i < len; i++) {
+      input_2 = (gfloat) * idata++;
 
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2 * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2 * priv->dry;
-    *odata++ = (gint16) CLAMP (out_l2, G_MININT16, G_MAXINT16);
-    *odata++ = (gint16) CLAMP (out_r2, G_MININT16, G_MAXINT16);
+      /* Remove the DC offset */
+      out_l1[i] -= DC_OFFSET;
+      out_r1[i] -= DC_OFFSET;
 
-    if (abs (out_l2) > 0 || abs (out_r2) > 0)
-      drained = FALSE;
+      /* Calculate output */
+      out_l2 = out_l1[i] * priv->wet1 + out_r1[i] * priv->wet2 +
+          input_2 * priv->dry;
+      out_r2 = out_r1[i] * priv->wet1 + out_l1[i] * priv->wet2 +
+          input_2 * priv->dry;
+      *odata++ = (gint16) CLAMP (out_l2, G_MININT16, G_MAXINT16);
+      *odata++ = (gint16) CLAMP (out_r2, G_MININT16, G_MAXINT16);
+
+      if (abs (out_l2) > 0 || abs (out_r2) > 0)
+        drained = FALSE;
+    }
   }
   return drained;
 }
@@ -743,43 +853,43 @@ gst_freeverb_transform_s2s_int (GstFreeverb * filter,
     gint16 * idata, gint16 * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1l, input_1r;
+  guint i, k, len;
+  gfloat out_l1[FREEVERB_BLOCK_SIZE], out_r1[FREEVERB_BLOCK_SIZE];
+  gfloat input_1l[FREEVERB_BLOCK_SIZE], input_1r[FREEVERB_BLOCK_SIZE];
   gfloat out_l2, out_r2, input_2l, input_2r;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
+  for (k = 0; k < num_samples; k += len) {
+    len = MIN (num_samples - k, FREEVERB_BLOCK_SIZE);
 
-    out_l1 = out_r1 = 0.0;
+    for (i = 0; i < len; i++) {
+      input_2l = (gfloat) idata[2 * i];
+      input_2r = (gfloat) idata[2 * i + 1];
+      input_1l[i] = (input_2l + DC_OFFSET) * priv->gain;
+      input_1r[i] = (input_2r + DC_OFFSET) * priv->gain;
+    }
 
-    input_2l = (gfloat) * idata++;
-    input_2r = (gfloat) * idata++;
-    input_1l = (input_2l + DC_OFFSET) * priv->gain;
-    input_1r = (input_2r + DC_OFFSET) * priv->gain;
+    freeverb_revmodel_process (priv, input_1l, input_1r, out_l1, out_r1, len);
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1l, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1r, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
-    }
+    for (i = 0; i < len; i++) {
+      input_2l = (gfloat) * idata++;
+      input_2r = (gfloat) * idata++;
 
-    /* Remove the DC offset */
-    out_l1 -= DC_OFFSET;
-    out_r1 -= DC_OFFSET;
+      /* Remove the DC offset */
+      out_l1[i] -= DC_OFFSET;
+      out_r1[i] -= DC_OFFSET;
 
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2l * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2r * priv->dry;
-    *odata++ = (gint16) CLAMP (out_l2, G_MININT16, G_MAXINT16);
-    *odata++ = (gint16) CLAMP (out_r2, G_MININT16, G_MAXINT16);
+      /* Calculate output */
+      out_l2 = out_l1[i] * priv->wet1 + out_r1[i] * priv->wet2 +
+          input_2l * priv->dry;
+      out_r2 = out_r1[i] * priv->wet1 + out_l1[i] * priv->wet2 +
+          input_2r * priv->dry;
+      *odata++ = (gint16) CLAMP (out_l2, G_MININT16, G_MAXINT16);
+      *odata++ = (gint16) CLAMP (out_r2, G_MININT16, G_MAXINT16);
 
-    if (abs (out_l2) > 0 || abs (out_r2) > 0)
-      drained = FALSE;
+      if (abs (out_l2) > 0 || abs (out_r2) > 0)
+        drained = FALSE;
+    }
   }
   return drained;
 }
@@ -789,45 +899,44 @@ gst_freeverb_transform_m2s_float (GstFreeverb * filter,
     gfloat * idata, gfloat * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1;
+  guint i, k, len;
+  gfloat out_l1[FREEVERB_BLOCK_SIZE], out_r1[FREEVERB_BLOCK_SIZE];
+  gfloat input_1[FREEVERB_BLOCK_SIZE];
   gfloat out_l2, out_r2, input_2;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-
-    out_l1 = out_r1 = 0.0;
+  for (k = 0; k < num_samples; k += len) {
+    len = MIN (num_samples - k, FREEVERB_BLOCK_SIZE);
 
     /* The original Freeverb code expects a stereo signal and 'input_1'
      * is set to the sum of the left and right input_1 sample. Since
      * this code works on a mono signal, 'input_1' is set to twice the
      * input_1 sample. */
-    input_2 = *idata++;
-    input_1 = (2.0f * input_2 + DC_OFFSET) * priv->gain;
-
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+    for (i = 0; i < len; i++) {
+      input_2 = idata[i];
+      input_1[i] = (2.0f * input_2 + DC_OFFSET) * priv->gain;
     }
 
-    /* Remove the DC offset */
-    out_l1 -= DC_OFFSET;
-    out_r1 -= DC_OFFSET;
+    freeverb_revmodel_process (priv, input_1, input_1, out_l1, out_r1, len);
+
+    for (i = 0; i < len; i++) {
+      input_2 = *idata++;
+
+      /* Remove the DC offset */
+      out_l1[i] -= DC_OFFSET;
+      out_r1[i] -= DC_OFFSET;
 
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2 * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2 * priv->dry;
-    *odata++ = out_l2;
-    *odata++ = out_r2;
+      /* Calculate output */
+      out_l2 = out_l1[i] * priv->wet1 + out_r1[i] * priv->wet2 +
+          input_2 * priv->dry;
+      out_r2 = out_r1[i] * priv->wet1 + out_l1[i] * priv->wet2 +
+          input_2 * priv->dry;
+      *odata++ = out_l2;
+      *odata++ = out_r2;
 
-    if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
-      drained = FALSE;
+      if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
+        drained = FALSE;
+    }
   }
   return drained;
 }
@@ -837,43 +946,43 @@ gst_freeverb_transform_s2s_float (GstFreeverb * filter,
     gfloat * idata, gfloat * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1l, input_1r;
+  guint i, k, len;
+  gfloat out_l1[FREEVERB_BLOCK_SIZE], out_r1[FREEVERB_BLOCK_SIZE];
+  gfloat input_1l[FREEVERB_BLOCK_SIZE], input_1r[FREEVERB_BLOCK_SIZE];
   gfloat out_l2, out_r2, input_2l, input_2r;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
+  for (k = 0; k < num_samples; k += len) {
+    len = MIN (num_samples - k, FREEVERB_BLOCK_SIZE);
 
-    out_l1 = out_r1 = 0.0;
+    for (i = 0; i < len; i++) {
+      input_2l = idata[2 * i];
+      input_2r = idata[2 * i + 1];
+      input_1l[i] = (input_2l + DC_OFFSET) * priv->gain;
+      input_1r[i] = (input_2r + DC_OFFSET) * priv->gain;
+    }
 
-    input_2l = *idata++;
-    input_2r = *idata++;
-    input_1l = (input_2l + DC_OFFSET) * priv->gain;
-    input_1r = (input_2r + DC_OFFSET) * priv->gain;
+    freeverb_revmodel_process (priv, input_1l, input_1r, out_l1, out_r1, len);
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1l, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1r, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
-    }
+    for (i = 0; i < len; i++) {
+      input_2l = *idata++;
+      input_2r = *idata++;
 
-    /* Remove the DC offset */
-    out_l1 -= DC_OFFSET;
-    out_r1 -= DC_OFFSET;
+      /* Remove the DC offset */
+      out_l1[i] -= DC_OFFSET;
+      out_r1[i] -= DC_OFFSET;
 
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2l * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2r * priv->dry;
-    *odata++ = out_l2;
-    *odata++ = out_r2;
+      /* Calculate output */
+      out_l2 = out_l1[i] * priv->wet1 + out_r1[i] * priv->wet2 +
+          input_2l * priv->dry;
+      out_r2 = out_r1[i] * priv->wet1 + out_l1[i] * priv->wet2 +
+          input_2r * priv->dry;
+      *odata++ = out_l2;
+      *odata++ = out_r2;
 
-    if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
-      drained = FALSE;
+      if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
+        drained = FALSE;
+    }
   }
   return drained;
 }
@@ -915,8 +1024,19 @@ gst_freeverb_transform (GstBaseTransform * base, GstBuffer * inbuf,
   }
 
   if (!filter->drained) {
+#ifdef __SSE__
+    /* Flush denormals to zero while processing, the DC offset keeps the
+     * filters out of the denormal range but very low gains can still end
+     * up there */
+    guint csr = _mm_getcsr ();
+
+    _mm_setcsr (csr | _MM_FLUSH_ZERO_ON);
+#endif
     filter->drained =
         filter->process (filter, inmap.data, outmap.data, num_samples);
+#ifdef __SSE__
+    _mm_setcsr (csr);
+#endif
   }
 
   if (filter->drained) {
@@ -50,6 +50,11 @@
  *
  * Gaussianblur blurs the video stream in realtime.
  *
+ * The gaussian is approximated by three passes of an extended box filter
+ * in each direction, computed with running sums, so the cost per pixel
+ * does not depend on the sigma. The frame is processed in fixed point, in
+ * bands of columns and rows spread over GstGaussianBlur::n-threads threads.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -66,6 +71,10 @@
 #include <math.h>
 #include <gst/gst.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "gstplugin.h"
 #include "gstgaussblur.h"
 
@@ -112,17 +121,43 @@ enum
 {
   PROP_0,
   PROP_SIGMA,
+  PROP_N_THREADS,
   PROP_LAST
 };
 
-static gboolean make_gaussian_kernel (GstGaussianBlur * gb, float sigma);
-static void gaussian_smooth (GstGaussianBlur * gb, guint8 * image,
-    guint8 * out_image);
+/* Number of box filter passes per direction */
+#define N_PASSES 3
+/* Largest box radius, reached for a sigma of 20 */
+#define MAX_RADIUS 20
+/* Number of values per band in the vertical pass, a multiple of 4 */
+#define STRIP_WIDTH 64
+/* Values are processed with 6 fractional bits, so that the sharpened
+ * intermediate values still fit in 16 bits */
+#define FRAC_BITS 6
+/* Precision of the tap weights. The weighted sum of the 16 bit values
+ * then still fits in 32 bits */
+#define WEIGHT_BITS 15
+
+struct GstGaussianBlurJob
+{
+  GstGaussianBlur *gb;
+  gint index;
+
+  /* vertical pass: two bands of STRIP_WIDTH values by height and the
+   * running sums, horizontal pass: two padded rows */
+  gint32 *strip[2];
+  gint32 *sums;
+  gint32 *row[2];
+};
+
+static void gst_gaussianblur_band_func (gpointer user_data, gint band,
+    gint n_bands);
 
 #define gst_gaussianblur_parent_class parent_class
 G_DEFINE_TYPE (GstGaussianBlur, gst_gaussianblur, GST_TYPE_VIDEO_FILTER);
 
 #define DEFAULT_SIGMA 1.2
+#define DEFAULT_N_THREADS 0
 
 /* Initalize the gaussianblur's class. */
 static void
@@ -152,26 +187,43 @@ gst_gaussianblur_class_init (GstGaussianBlurClass * klass)
           "Sigma value for gaussian blur (negative for sharpen)",
           -20.0, 20.0, DEFAULT_SIGMA,
           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to blur a frame with (0 = one per CPU)",
+          0, 128, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   vfilter_class->transform_frame =
       GST_DEBUG_FUNCPTR (gst_gaussianblur_transform_frame);
   vfilter_class->set_info = GST_DEBUG_FUNCPTR (gst_gaussianblur_set_info);
 }
 
+static void
+gst_gaussianblur_free_jobs (GstGaussianBlur * gb)
+{
+  gint i;
+
+  for (i = 0; i < gb->n_jobs; i++)
+    g_free (gb->jobs[i].strip[0]);
+  g_free (gb->jobs);
+  gb->jobs = NULL;
+  gb->n_jobs = 0;
+}
+
 static gboolean
 gst_gaussianblur_set_info (GstVideoFilter * filter, GstCaps * incaps,
     GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
 {
   GstGaussianBlur *gb = GST_GAUSSIANBLUR (filter);
-  guint32 n_elems;
 
   gb->width = GST_VIDEO_INFO_WIDTH (in_info);
   gb->height = GST_VIDEO_INFO_HEIGHT (in_info);
 
-  /* get stride */
-  gb->stride = GST_VIDEO_INFO_COMP_STRIDE (in_info, 0);
-  n_elems = gb->stride * gb->height;
-  gb->tempim = g_malloc (sizeof (gfloat) * n_elems);
+  /* the scratch buffers depend on the size, reallocate on the next frame */
+  gst_gaussianblur_free_jobs (gb);
+
+  g_free (gb->tempim);
+  gb->tempim = g_new (gint16, gb->width * 4 * gb->height);
 
   return TRUE;
 }
@@ -181,6 +233,8 @@ gst_gaussianblur_init (GstGaussianBlur * gb)
 {
   gb->sigma = DEFAULT_SIGMA;
   gb->cur_sigma = -1.0;
+  gb->n_threads = DEFAULT_N_THREADS;
+  gst_band_pool_init (&gb->bands, gst_gaussianblur_band_func, gb);
 }
 
 static void
@@ -188,235 +242,364 @@ gst_gaussianblur_finalize (GObject * object)
 {
   GstGaussianBlur *gb = GST_GAUSSIANBLUR (object);
 
+  gst_band_pool_clear (&gb->bands);
+  gst_gaussianblur_free_jobs (gb);
+
   g_free (gb->tempim);
   gb->tempim = NULL;
 
-  g_free (gb->smoothedim);
-  gb->smoothedim = NULL;
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/*
+ * Compute the extended box filter of which N_PASSES passes have the
+ * variance of the gaussian, see Gwosdek et al., "Theoretical foundations
+ * of gaussian convolution by extended box filtering". The box has weight 1
+ * for the taps up to the radius and alpha for the two next ones.
+ *
+ * The weights are normalised in fixed point. The outer weight gets what
+ * is left after rounding the inner one, so that the weights add up to 1
+ * within 1 / (1 << WEIGHT_BITS) and flat areas are kept as they are.
+ */
+static void
+gst_gaussianblur_compute_box (GstGaussianBlur * gb, gfloat sigma)
+{
+  gdouble var = (gdouble) sigma * sigma / N_PASSES;
+  gdouble alpha;
+  gint r;
+
+  r = floor (0.5 * sqrt (12.0 * var + 1.0) - 0.5);
+  r = CLAMP (r, 0, MAX_RADIUS);
+  alpha = (2 * r + 1) * (r * (r + 1) - 3.0 * var) /
+      (6.0 * (var - (r + 1) * (r + 1)));
 
-  g_free (gb->kernel);
-  gb->kernel = NULL;
-  g_free (gb->kernel_sum);
-  gb->kernel_sum = NULL;
+  gb->radius = r;
+  gb->inner = floor ((1 << WEIGHT_BITS) / (2 * r + 1 + 2 * alpha) + 0.5);
+  gb->outer = ((1 << WEIGHT_BITS) - (2 * r + 1) * gb->inner) / 2;
+  gb->sharpen = sigma < 0;
 
-  G_OBJECT_CLASS (parent_class)->finalize (object);
+  GST_DEBUG_OBJECT (gb, "sigma %f: radius %d, alpha %f", sigma, r, alpha);
 }
 
-static GstFlowReturn
-gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
-    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+static void
+gst_gaussianblur_setup_jobs (GstGaussianBlur * gb, gint n_jobs)
 {
-  GstGaussianBlur *filter = GST_GAUSSIANBLUR (vfilter);
-  GstClockTime timestamp;
-  gint64 stream_time;
-  gfloat sigma;
-  guint8 *src, *dest;
+  gint i, row_size;
+
+  gst_gaussianblur_free_jobs (gb);
+
+  /* a row padded by the radius plus one pixel on both sides */
+  row_size = (gb->width + 2 * (MAX_RADIUS + 1)) * 4;
+
+  gb->jobs = g_new0 (GstGaussianBlurJob, n_jobs);
+  gb->n_jobs = n_jobs;
+  for (i = 0; i < n_jobs; i++) {
+    GstGaussianBlurJob *job = &gb->jobs[i];
+    gint32 *mem;
+
+    mem = g_new (gint32, 2 * STRIP_WIDTH * gb->height + STRIP_WIDTH +
+        2 * row_size);
+    job->gb = gb;
+    job->index = i;
+    job->strip[0] = mem;
+    job->strip[1] = mem + STRIP_WIDTH * gb->height;
+    job->sums = mem + 2 * STRIP_WIDTH * gb->height;
+    job->row[0] = job->sums + STRIP_WIDTH;
+    job->row[1] = job->row[0] + row_size;
+  }
+}
 
-  /* GstController: update the properties */
-  timestamp = GST_BUFFER_TIMESTAMP (in_frame->buffer);
-  stream_time =
-      gst_segment_to_stream_time (&GST_BASE_TRANSFORM (filter)->segment,
-      GST_FORMAT_TIME, timestamp);
+#define ROUND_WEIGHTED(v) (((v) + (1 << (WEIGHT_BITS - 1))) >> WEIGHT_BITS)
 
-  GST_DEBUG_OBJECT (filter, "sync to %" GST_TIME_FORMAT,
-      GST_TIME_ARGS (timestamp));
+#ifdef __SSE2__
+/* 32 bit multiplication of signed values of which the product fits in 32
+ * bits, the low half of the unsigned product is the same */
+static inline __m128i
+mullo_epi32 (__m128i a, __m128i b)
+{
+  __m128i even = _mm_mul_epu32 (a, b);
+  __m128i odd = _mm_mul_epu32 (_mm_srli_epi64 (a, 32), _mm_srli_epi64 (b, 32));
 
-  if (GST_CLOCK_TIME_IS_VALID (stream_time))
-    gst_object_sync_values (GST_OBJECT (filter), stream_time);
+  return _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (0, 0, 2,
+              0)), _mm_shuffle_epi32 (odd, _MM_SHUFFLE (0, 0, 2, 0)));
+}
 
-  GST_OBJECT_LOCK (filter);
-  sigma = filter->sigma;
-  GST_OBJECT_UNLOCK (filter);
+/* sum * inner + (first + last) * outer, normalised */
+static inline __m128i
+weigh_epi32 (__m128i sum, __m128i first, __m128i last, __m128i inner,
+    __m128i outer)
+{
+  __m128i res;
 
-  if (filter->cur_sigma != sigma) {
-    g_free (filter->kernel);
-    filter->kernel = NULL;
-    g_free (filter->kernel_sum);
-    filter->kernel_sum = NULL;
-    filter->cur_sigma = sigma;
+  res = _mm_add_epi32 (mullo_epi32 (sum, inner),
+      mullo_epi32 (_mm_add_epi32 (first, last), outer));
+  res = _mm_add_epi32 (res, _mm_set1_epi32 (1 << (WEIGHT_BITS - 1)));
+
+  return _mm_srai_epi32 (res, WEIGHT_BITS);
+}
+#endif
+
+/*
+ * One extended box pass along a row of 4 component pixels. @src is padded
+ * with radius + 1 pixels on both sides.
+ */
+static void
+box_blur_row (const gint32 * src, gint32 * dest, gint width, gint r,
+    gint32 inner, gint32 outer)
+{
+  gint i, k;
+#ifdef __SSE2__
+  __m128i sum = _mm_setzero_si128 ();
+  __m128i vinner = _mm_set1_epi32 (inner), vouter = _mm_set1_epi32 (outer);
+
+  for (k = 1; k <= 2 * r + 1; k++)
+    sum = _mm_add_epi32 (sum, _mm_loadu_si128 ((__m128i *) (src + k * 4)));
+
+  for (i = 0; i < width; i++) {
+    __m128i first = _mm_loadu_si128 ((__m128i *) (src + i * 4));
+    __m128i last = _mm_loadu_si128 ((__m128i *) (src + (i + 2 * r + 2) * 4));
+
+    if (i > 0) {
+      sum = _mm_add_epi32 (sum,
+          _mm_loadu_si128 ((__m128i *) (src + (i + 2 * r + 1) * 4)));
+      sum = _mm_sub_epi32 (sum, first);
+    }
+    _mm_storeu_si128 ((__m128i *) (dest + i * 4),
+        weigh_epi32 (sum, first, last, vinner, vouter));
   }
-  if (filter->kernel == NULL &&
-      !make_gaussian_kernel (filter, filter->cur_sigma)) {
-    GST_ELEMENT_ERROR (filter, RESOURCE, NO_SPACE_LEFT, ("Out of memory"),
-        ("Failed to allocation gaussian kernel"));
-    return GST_FLOW_ERROR;
+#else
+  gint32 sum[4] = { 0, 0, 0, 0 };
+  gint c;
+
+  for (k = 1; k <= 2 * r + 1; k++)
+    for (c = 0; c < 4; c++)
+      sum[c] += src[k * 4 + c];
+
+  for (i = 0; i < width; i++) {
+    for (c = 0; c < 4; c++) {
+      gint32 first = src[i * 4 + c];
+      gint32 last = src[(i + 2 * r + 2) * 4 + c];
+
+      if (i > 0)
+        sum[c] += src[(i + 2 * r + 1) * 4 + c] - first;
+      dest[i * 4 + c] =
+          ROUND_WEIGHTED (sum[c] * inner + (first + last) * outer);
+    }
   }
+#endif
+}
 
-  /*
-   * Perform gaussian smoothing on the image using the input standard
-   * deviation.
-   */
-  src = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
-  dest = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0);
-  gst_video_frame_copy (out_frame, in_frame);
-  gaussian_smooth (filter, src, dest);
+/*
+ * One extended box pass down a band of @height rows of @w values, the
+ * edge rows are repeated.
+ */
+static void
+box_blur_band (const gint32 * src, gint32 * dest, gint32 * sums, gint height,
+    gint w, gint r, gint32 inner, gint32 outer)
+{
+  gint i, k, x;
 
-  return GST_FLOW_OK;
+  memset (sums, 0, w * sizeof (gint32));
+  for (k = -r; k <= r; k++) {
+    const gint32 *row = src + CLAMP (k, 0, height - 1) * w;
+
+    for (x = 0; x < w; x++)
+      sums[x] += row[x];
+  }
+
+  for (i = 0; i < height; i++) {
+    const gint32 *first = src + CLAMP (i - r - 1, 0, height - 1) * w;
+    const gint32 *next = src + CLAMP (i + r, 0, height - 1) * w;
+    const gint32 *last = src + CLAMP (i + r + 1, 0, height - 1) * w;
+    gint32 *out = dest + i * w;
+#ifdef __SSE2__
+    __m128i vinner = _mm_set1_epi32 (inner), vouter = _mm_set1_epi32 (outer);
+
+    for (x = 0; x < w; x += 4) {
+      __m128i vfirst = _mm_loadu_si128 ((__m128i *) (first + x));
+      __m128i vlast = _mm_loadu_si128 ((__m128i *) (last + x));
+      __m128i sum = _mm_loadu_si128 ((__m128i *) (sums + x));
+
+      if (i > 0) {
+        sum = _mm_add_epi32 (sum, _mm_loadu_si128 ((__m128i *) (next + x)));
+        sum = _mm_sub_epi32 (sum, vfirst);
+        _mm_storeu_si128 ((__m128i *) (sums + x), sum);
+      }
+      _mm_storeu_si128 ((__m128i *) (out + x),
+          weigh_epi32 (sum, vfirst, vlast, vinner, vouter));
+    }
+#else
+    for (x = 0; x < w; x++) {
+      if (i > 0)
+        sums[x] += next[x] - first[x];
+      out[x] = ROUND_WEIGHTED (sums[x] * inner + (first[x] + last[x]) * outer);
+    }
+#endif
+  }
 }
 
+/* Blur the bands of columns of this job from the source frame into
+ * tempim */
 static void
-blur_row_x (GstGaussianBlur * gb, guint8 * in_row, gfloat * out_row)
+gst_gaussianblur_blur_columns (GstGaussianBlur * gb, GstGaussianBlurJob * job)
 {
-  int c, cc, center;
-  float dot[4], sum;
-  int k, kmin, kmax;
-
-  center = gb->windowsize / 2;
-
-  for (c = 0; c < gb->width; c++) {
-    /* Calculate min */
-    cc = center - c;
-    kmin = MAX (0, cc);
-    cc = kmin - cc;
-    /* Calc max */
-    kmax = MIN (gb->windowsize, gb->width - cc);
-    cc *= 4;
-
-    dot[0] = dot[1] = dot[2] = dot[3] = 0.0;
-    /* Calculate sum for range */
-    sum = gb->kernel_sum[kmax - 1];
-    sum -= kmin ? gb->kernel_sum[kmin - 1] : 0.0;
-
-    for (k = kmin; k < kmax; k++) {
-      float coeff = gb->kernel[k];
-      dot[0] += (float) in_row[cc++] * coeff;
-      dot[1] += (float) in_row[cc++] * coeff;
-      dot[2] += (float) in_row[cc++] * coeff;
-      dot[3] += (float) in_row[cc++] * coeff;
+  gint row_values = gb->width * 4;
+  gint n_strips = (row_values + STRIP_WIDTH - 1) / STRIP_WIDTH;
+  gint first = job->index * n_strips / gb->n_jobs;
+  gint end = (job->index + 1) * n_strips / gb->n_jobs;
+  gint s, i, x, p;
+
+  for (s = first; s < end; s++) {
+    gint x0 = s * STRIP_WIDTH;
+    gint w = MIN (STRIP_WIDTH, row_values - x0);
+
+    for (i = 0; i < gb->height; i++) {
+      const guint8 *in = gb->src + i * gb->src_stride + x0;
+      gint32 *out = job->strip[0] + i * w;
+
+      for (x = 0; x < w; x++)
+        out[x] = in[x] << FRAC_BITS;
     }
 
-    out_row[c * 4] = dot[0] / sum;
-    out_row[c * 4 + 1] = dot[1] / sum;
-    out_row[c * 4 + 2] = dot[2] / sum;
-    out_row[c * 4 + 3] = dot[3] / sum;
+    for (p = 0; p < N_PASSES; p++)
+      box_blur_band (job->strip[p & 1], job->strip[(p + 1) & 1], job->sums,
+          gb->height, w, gb->radius, gb->inner, gb->outer);
+
+    for (i = 0; i < gb->height; i++) {
+      const guint8 *in = gb->src + i * gb->src_stride + x0;
+      const gint32 *blurred = job->strip[N_PASSES & 1] + i * w;
+      gint16 *out = gb->tempim + i * row_values + x0;
+
+      if (gb->sharpen) {
+        for (x = 0; x < w; x++)
+          out[x] = (in[x] << (FRAC_BITS + 1)) - blurred[x];
+      } else {
+        for (x = 0; x < w; x++)
+          out[x] = blurred[x];
+      }
+    }
   }
 }
 
+/* Blur the rows of this job from tempim into the destination frame */
 static void
-gaussian_smooth (GstGaussianBlur * gb, guint8 * image, guint8 * out_image)
+gst_gaussianblur_blur_rows (GstGaussianBlur * gb, GstGaussianBlurJob * job)
 {
-  int r, c, rr, center;
-  float dot[4], sum;
-  int k, kmin, kmax;
-  guint8 *in_row = image;
-  float *tmp_out_row = gb->tempim;
-  float *tmp_in_pos;
-  gint y_avail = 0;
-  guint8 *out_row;
-
-  /* Apply the gaussian kernel */
-  center = gb->windowsize / 2;
-
-  /* Blur in the y - direction. */
-  for (r = 0; r < gb->height; r++) {
-    /* Calculate input row range */
-    rr = center - r;
-    kmin = MAX (0, rr);
-    rr = kmin - rr;
-    /* Calc max */
-    kmax = MIN (gb->windowsize, gb->height - rr);
-
-    /* Precalculate sum for range */
-    sum = gb->kernel_sum[kmax - 1];
-    sum -= kmin ? gb->kernel_sum[kmin - 1] : 0.0;
-
-    /* Blur more input rows (x direction blur) */
-    while (y_avail <= (r + center) && y_avail < gb->height) {
-      blur_row_x (gb, in_row, tmp_out_row);
-      in_row += gb->stride;
-      tmp_out_row += gb->stride;
-      y_avail++;
+  gint row_values = gb->width * 4;
+  gint first = job->index * gb->height / gb->n_jobs;
+  gint end = (job->index + 1) * gb->height / gb->n_jobs;
+  gint pad = (gb->radius + 1) * 4;
+  gint i, x, p;
+
+  for (i = first; i < end; i++) {
+    const gint16 *in = gb->tempim + i * row_values;
+    guint8 *out = gb->dest + i * gb->dest_stride;
+    gint32 *res;
+
+    for (p = 0; p < N_PASSES; p++) {
+      gint32 *row = job->row[p & 1];
+
+      if (p == 0) {
+        for (x = 0; x < row_values; x++)
+          row[pad + x] = in[x];
+      }
+      /* repeat the edge pixels in the padding */
+      for (x = 0; x < pad; x++) {
+        row[x] = row[pad + (x & 3)];
+        row[pad + row_values + x] = row[pad + row_values - 4 + (x & 3)];
+      }
+      box_blur_row (row, job->row[(p + 1) & 1] + pad, gb->width, gb->radius,
+          gb->inner, gb->outer);
     }
+    res = job->row[N_PASSES & 1] + pad;
 
-    tmp_in_pos = gb->tempim + (rr * gb->stride);
-    out_row = out_image + r * gb->stride;
+    for (x = 0; x < row_values; x++) {
+      gint32 v = gb->sharpen ? 2 * in[x] - res[x] : res[x];
 
-    for (c = 0; c < gb->width; c++) {
-      float *tmp = tmp_in_pos;
+      v = (v + (1 << (FRAC_BITS - 1))) >> FRAC_BITS;
+      out[x] = CLAMP (v, 0, 255);
+    }
+  }
+}
 
-      dot[0] = dot[1] = dot[2] = dot[3] = 0.0;
-      for (k = kmin; k < kmax; k++, tmp += gb->stride) {
-        float kern = gb->kernel[k];
-        dot[0] += tmp[0] * kern;
-        dot[1] += tmp[1] * kern;
-        dot[2] += tmp[2] * kern;
-        dot[3] += tmp[3] * kern;
-      }
+static void
+gst_gaussianblur_run_job (GstGaussianBlur * gb, GstGaussianBlurJob * job)
+{
+  if (gb->pass == 0)
+    gst_gaussianblur_blur_columns (gb, job);
+  else
+    gst_gaussianblur_blur_rows (gb, job);
+}
 
-      *out_row++ = (guint8) CLAMP ((dot[0] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[1] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[2] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[3] / sum + 0.5), 0, 255);
+static void
+gst_gaussianblur_band_func (gpointer user_data, gint band, gint n_bands)
+{
+  GstGaussianBlur *gb = user_data;
 
-      tmp_in_pos += 4;
-    }
-  }
+  gst_gaussianblur_run_job (gb, &gb->jobs[band]);
 }
 
-/*
- * Create a one dimensional gaussian kernel.
- */
-static gboolean
-make_gaussian_kernel (GstGaussianBlur * gb, float sigma)
+/* Run a pass over all jobs */
+static void
+gst_gaussianblur_run_pass (GstGaussianBlur * gb, gint pass)
 {
-  int i, center, left, right;
-  float sum, sum2;
-  const float fe = -0.5 / (sigma * sigma);
-  const float dx = 1.0 / (sigma * sqrt (2 * G_PI));
-
-  center = ceil (2.5 * fabs (sigma));
-  gb->windowsize = (int) (1 + 2 * center);
-
-  gb->kernel = g_new (float, gb->windowsize);
-  gb->kernel_sum = g_new (float, gb->windowsize);
-  if (gb->kernel == NULL || gb->kernel_sum == NULL)
-    return FALSE;
-
-  if (gb->windowsize == 1) {
-    gb->kernel[0] = 1.0;
-    gb->kernel_sum[0] = 1.0;
-    return TRUE;
-  }
+  gb->pass = pass;
+  gst_band_pool_run (&gb->bands);
+}
 
-  /* Center co-efficient */
-  sum = gb->kernel[center] = dx;
+static GstFlowReturn
+gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+{
+  GstGaussianBlur *filter = GST_GAUSSIANBLUR (vfilter);
+  GstClockTime timestamp;
+  gint64 stream_time;
+  gfloat sigma;
+  gint n_threads;
 
-  /* Other coefficients */
-  left = center - 1;
-  right = center + 1;
-  for (i = 1; i <= center; i++, left--, right++) {
-    float fx = dx * pow (G_E, fe * i * i);
-    gb->kernel[right] = gb->kernel[left] = fx;
-    sum += 2 * fx;
-  }
+  /* GstController: update the properties */
+  timestamp = GST_BUFFER_TIMESTAMP (in_frame->buffer);
+  stream_time =
+      gst_segment_to_stream_time (&GST_BASE_TRANSFORM (filter)->segment,
+      GST_FORMAT_TIME, timestamp);
 
-  if (sigma < 0) {
-    sum = -sum;
-    gb->kernel[center] += 2.0 * sum;
-  }
+  GST_DEBUG_OBJECT (filter, "sync to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (timestamp));
 
-  for (i = 0; i < gb->windowsize; i++)
-    gb->kernel[i] /= sum;
+  if (GST_CLOCK_TIME_IS_VALID (stream_time))
+    gst_object_sync_values (GST_OBJECT (filter), stream_time);
+
+  GST_OBJECT_LOCK (filter);
+  sigma = filter->sigma;
+  n_threads = filter->n_threads;
+  GST_OBJECT_UNLOCK (filter);
 
-  sum2 = 0.0;
-  for (i = 0; i < gb->windowsize; i++) {
-    sum2 += gb->kernel[i];
-    gb->kernel_sum[i] = sum2;
+  if (filter->cur_sigma != sigma) {
+    gst_gaussianblur_compute_box (filter, sigma);
+    filter->cur_sigma = sigma;
   }
 
-#if 0
-  g_print ("Sigma %f: ", sigma);
-  for (i = 0; i < gb->windowsize; i++)
-    g_print ("%f ", gb->kernel[i]);
-  g_print ("\n");
-  g_print ("sums: ");
-  for (i = 0; i < gb->windowsize; i++)
-    g_print ("%f ", gb->kernel_sum[i]);
-  g_print ("\n");
-  g_print ("sum %f sum2 %f\n", sum, sum2);
-#endif
+  n_threads = gst_band_pool_configure (&filter->bands, n_threads,
+      filter->height);
+  if (filter->n_jobs != n_threads) {
+    GST_DEBUG_OBJECT (filter, "blurring with %d threads", n_threads);
+    gst_gaussianblur_setup_jobs (filter, n_threads);
+  }
 
-  return TRUE;
+  /*
+   * Perform gaussian smoothing on the image using the input standard
+   * deviation, first down the columns into tempim and then along the rows
+   * into the output frame.
+   */
+  filter->src = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
+  filter->src_stride = GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 0);
+  filter->dest = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0);
+  filter->dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 0);
+
+  gst_gaussianblur_run_pass (filter, 0);
+  gst_gaussianblur_run_pass (filter, 1);
+
+  return GST_FLOW_OK;
 }
 
 static void
@@ -430,6 +613,11 @@ gst_gaussianblur_set_property (GObject * object,
       gb->sigma = g_value_get_double (value);
       GST_OBJECT_UNLOCK (object);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (object);
+      gb->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -447,6 +635,11 @@ gst_gaussianblur_get_property (GObject * object,
       g_value_set_double (value, gb->sigma);
       GST_OBJECT_UNLOCK (gb);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (gb);
+      g_value_set_uint (value, gb->n_threads);
+      GST_OBJECT_UNLOCK (gb);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -51,6 +51,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include <gst/band-pool-private.h>
 
 G_BEGIN_DECLS
 
@@ -60,19 +61,35 @@ G_BEGIN_DECLS
 
 typedef struct GstGaussianBlur GstGaussianBlur;
 typedef struct GstGaussianBlurClass GstGaussianBlurClass;
+typedef struct GstGaussianBlurJob GstGaussianBlurJob;
 
 struct GstGaussianBlur
 {
   GstVideoFilter videofilter;
-  gint width, height, stride;
+  gint width, height;
 
   float cur_sigma, sigma;
-  int windowsize;
+  guint n_threads;
 
-  float *kernel;
-  float *kernel_sum;
-  float *tempim;
-  gint16 *smoothedim;
+  /* extended box filter for the current sigma, the weights of the inner
+   * and the two outer taps have 15 fractional bits */
+  gint radius;
+  gint32 inner, outer;
+  gboolean sharpen;
+
+  /* result of the vertical pass, 6 fractional bits */
+  gint16 *tempim;
+
+  /* frame being processed */
+  const guint8 *src;
+  guint8 *dest;
+  gint src_stride, dest_stride;
+
+  /* bands of the frame and their scratch buffers */
+  GstBandPool bands;
+  GstGaussianBlurJob *jobs;
+  gint n_jobs;
+  gint pass;
 };
 
 struct GstGaussianBlurClass
@@ -50,6 +50,11 @@
  * 30000/1001 2:3:2:3... pattern telecined stream suitable for displaying film
  * content on NTSC.
  * </refsect2>
+ *
+ * Frames that take their two fields from different input frames are woven
+ * in one pass over the output, split over #GstInterlace:n-threads threads.
+ * When the newer input frame is not needed anymore and is writable, only
+ * the field of the older frame is copied into it.
  */
 
 
@@ -59,9 +64,11 @@
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
+#include <gst/video/gstvideopool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <gst/band-pool-private.h>
 
 GST_DEBUG_CATEGORY (gst_interlace_debug);
 #define GST_CAT_DEFAULT gst_interlace_debug
@@ -91,6 +98,7 @@ struct _GstInterlace
   gboolean top_field_first;
   gint pattern;
   gboolean allow_rff;
+  guint n_threads;
 
   /* state */
   GstVideoInfo info;
@@ -104,6 +112,17 @@ struct _GstInterlace
   GstClockTime timebase;
   int fields_since_timebase;
   guint pattern_offset;         /* initial offset into the pattern */
+
+  /* woven output buffers */
+  GstBufferPool *pool;
+
+  /* frames being woven by gst_interlace_weave_band(), indexed by field.
+   * A NULL source leaves the rows of that field untouched. */
+  GstVideoFrame *dest;
+  GstVideoFrame *src[2];
+
+  /* bands of rows, woven in parallel */
+  GstBandPool bands;
 };
 
 struct _GstInterlaceClass
@@ -117,9 +136,12 @@ enum
   PROP_TOP_FIELD_FIRST,
   PROP_PATTERN,
   PROP_PATTERN_OFFSET,
-  PROP_ALLOW_RFF
+  PROP_ALLOW_RFF,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
 typedef enum
 {
   GST_INTERLACE_PATTERN_1_1,
@@ -202,6 +224,8 @@ static GstFlowReturn gst_interlace_chain (GstPad * pad, GstObject * parent,
 
 static gboolean gst_interlace_src_query (GstPad * pad, GstObject * parent,
     GstQuery * query);
+static void gst_interlace_weave_band (gpointer user_data, gint band,
+    gint n_bands);
 
 static GstStateChangeReturn gst_interlace_change_state (GstElement * element,
     GstStateChange transition);
@@ -242,6 +266,12 @@ gst_interlace_class_init (GstInterlaceClass * klass)
           "Allow generation of buffers with RFF flag set, i.e., duration of 3 fields",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to weave a frame with (0 = one per CPU)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Interlace filter", "Filter/Video",
       "Creates an interlaced video from progressive frames",
@@ -255,9 +285,26 @@ gst_interlace_class_init (GstInterlaceClass * klass)
   element_class->change_state = gst_interlace_change_state;
 }
 
+static void
+gst_interlace_free_pools (GstInterlace * interlace)
+{
+  gst_band_pool_stop (&interlace->bands);
+
+  if (interlace->pool) {
+    gst_buffer_pool_set_active (interlace->pool, FALSE);
+    gst_object_unref (interlace->pool);
+    interlace->pool = NULL;
+  }
+}
+
 static void
 gst_interlace_finalize (GObject * obj)
 {
+  GstInterlace *interlace = GST_INTERLACE (obj);
+
+  gst_interlace_free_pools (interlace);
+  gst_band_pool_clear (&interlace->bands);
+
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
@@ -293,6 +340,8 @@ gst_interlace_init (GstInterlace * interlace)
   interlace->allow_rff = FALSE;
   interlace->pattern = GST_INTERLACE_PATTERN_2_3;
   interlace->pattern_offset = 0;
+  interlace->n_threads = DEFAULT_N_THREADS;
+  gst_band_pool_init (&interlace->bands, gst_interlace_weave_band, interlace);
   gst_interlace_reset (interlace);
 }
 
@@ -366,6 +415,45 @@ gst_interlace_decorate_buffer (GstInterlace * interlace, GstBuffer * buf,
   }
 }
 
+/* pool for the frames woven from two input frames, the others are the
+ * input buffers themselves */
+static void
+gst_interlace_setup_pool (GstInterlace * interlace, GstCaps * caps,
+    GstVideoInfo * info)
+{
+  GstQuery *query;
+  GstBufferPool *pool = NULL;
+  GstStructure *config;
+  guint size, min, max;
+
+  size = GST_VIDEO_INFO_SIZE (info);
+  min = max = 0;
+
+  query = gst_query_new_allocation (caps, TRUE);
+  if (!gst_pad_peer_query (interlace->srcpad, query)) {
+    /* not a problem, we use the query defaults */
+    GST_DEBUG_OBJECT (interlace, "allocation query failed");
+  }
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+  gst_query_unref (query);
+
+  if (pool == NULL)
+    pool = gst_video_buffer_pool_new ();
+  size = MAX (size, GST_VIDEO_INFO_SIZE (info));
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, size, min, max);
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_WARNING_OBJECT (interlace, "failed to configure pool, allocating");
+    gst_object_unref (pool);
+    return;
+  }
+
+  interlace->pool = pool;
+}
+
 static gboolean
 gst_interlace_setcaps (GstInterlace * interlace, GstCaps * caps)
 {
@@ -396,6 +484,10 @@ gst_interlace_setcaps (GstInterlace * interlace, GstCaps * caps)
       interlace->src_fps_n, interlace->src_fps_d, NULL);
 
   ret = gst_pad_set_caps (interlace->srcpad, othercaps);
+
+  gst_interlace_free_pools (interlace);
+  if (ret)
+    gst_interlace_setup_pool (interlace, othercaps, &info);
   gst_caps_unref (othercaps);
 
   interlace->info = info;
@@ -604,63 +696,146 @@ gst_interlace_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
   return ret;
 }
 
+/* Writes the rows of one band of every plane in order, taking each row
+ * from the source of its field */
 static void
-copy_field (GstInterlace * interlace, GstBuffer * dest, GstBuffer * src,
-    int field_index)
+gst_interlace_weave_band (gpointer user_data, gint band, gint n_bands)
 {
-  GstVideoInfo *info = &interlace->info;
-  gint i, j, n_planes;
-  guint8 *d, *s;
-  GstVideoFrame dframe, sframe;
+  GstInterlace *interlace = user_data;
+  GstVideoFrame *dest = interlace->dest;
+  const GstVideoFormatInfo *finfo = dest->info.finfo;
+  guint plane, comp;
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (dest); plane++) {
+    gint height, row_size, first, last, j;
+    gint ds = GST_VIDEO_FRAME_PLANE_STRIDE (dest, plane);
+    guint8 *d = GST_VIDEO_FRAME_PLANE_DATA (dest, plane);
+    const guint8 *s[2] = { NULL, NULL };
+    gint ss[2] = { 0, 0 };
+
+    /* the first component of the plane gives its size */
+    for (comp = 0; comp < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); comp++) {
+      if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, comp) == plane)
+        break;
+    }
+    if (comp == GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo))
+      continue;
+
+    height = GST_VIDEO_FRAME_COMP_HEIGHT (dest, comp);
+    row_size = GST_VIDEO_FRAME_COMP_WIDTH (dest, comp) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (dest, comp);
+
+    for (j = 0; j < 2; j++) {
+      if (interlace->src[j] == NULL)
+        continue;
+      s[j] = GST_VIDEO_FRAME_PLANE_DATA (interlace->src[j], plane);
+      ss[j] = GST_VIDEO_FRAME_PLANE_STRIDE (interlace->src[j], plane);
+      row_size = MIN (row_size, ABS (ss[j]));
+    }
+    row_size = MIN (row_size, ABS (ds));
 
-  if (!gst_video_frame_map (&dframe, info, dest, GST_MAP_WRITE))
-    goto dest_map_failed;
+    first = height * band / n_bands;
+    last = height * (band + 1) / n_bands;
 
-  if (!gst_video_frame_map (&sframe, info, src, GST_MAP_READ))
-    goto src_map_failed;
+    for (j = first; j < last; j++) {
+      if (s[j & 1])
+        memcpy (d + j * ds, s[j & 1] + j * ss[j & 1], row_size);
+    }
+  }
+}
 
-  n_planes = GST_VIDEO_FRAME_N_PLANES (&dframe);
+/* Weaves the top field of @top and the bottom field of @bottom into @dest,
+ * where either source may be NULL to keep the rows of @dest */
+static gboolean
+gst_interlace_weave (GstInterlace * interlace, GstBuffer * dest,
+    GstBuffer * top, GstBuffer * bottom)
+{
+  GstVideoInfo *info = &interlace->info;
+  GstVideoFrame dframe, sframe[2];
+  GstBuffer *src[2] = { top, bottom };
+  guint n_threads;
+  gint i, n_bands;
 
-  for (i = 0; i < n_planes; i++) {
-    gint cheight, cwidth;
-    gint ss, ds;
+  if (!gst_video_frame_map (&dframe, info, dest, GST_MAP_READWRITE))
+    goto dest_map_failed;
 
-    d = GST_VIDEO_FRAME_PLANE_DATA (&dframe, i);
-    s = GST_VIDEO_FRAME_PLANE_DATA (&sframe, i);
+  for (i = 0; i < 2; i++) {
+    interlace->src[i] = NULL;
+    if (src[i] == NULL)
+      continue;
+    if (!gst_video_frame_map (&sframe[i], info, src[i], GST_MAP_READ))
+      goto src_map_failed;
+    interlace->src[i] = &sframe[i];
+  }
+  interlace->dest = &dframe;
 
-    ds = GST_VIDEO_FRAME_PLANE_STRIDE (&dframe, i);
-    ss = GST_VIDEO_FRAME_PLANE_STRIDE (&sframe, i);
+  GST_OBJECT_LOCK (interlace);
+  n_threads = interlace->n_threads;
+  GST_OBJECT_UNLOCK (interlace);
 
-    d += field_index * ds;
-    s += field_index * ss;
+  n_bands = interlace->bands.n_bands;
+  if (gst_band_pool_configure (&interlace->bands, n_threads,
+          GST_VIDEO_INFO_HEIGHT (info)) != n_bands)
+    GST_DEBUG_OBJECT (interlace, "weaving with %d threads",
+        interlace->bands.n_bands);
 
-    cheight = GST_VIDEO_FRAME_COMP_HEIGHT (&dframe, i);
-    cwidth = MIN (ABS (ss), ABS (ds));
+  gst_band_pool_run (&interlace->bands);
 
-    for (j = field_index; j < cheight; j += 2) {
-      memcpy (d, s, cwidth);
-      d += ds * 2;
-      s += ss * 2;
-    }
+  for (i = 0; i < 2; i++) {
+    if (interlace->src[i])
+      gst_video_frame_unmap (interlace->src[i]);
   }
-
   gst_video_frame_unmap (&dframe);
-  gst_video_frame_unmap (&sframe);
-  return;
+  return TRUE;
 
 dest_map_failed:
   {
     GST_ERROR_OBJECT (interlace, "failed to map dest");
-    return;
+    return FALSE;
   }
 src_map_failed:
   {
     GST_ERROR_OBJECT (interlace, "failed to map src");
+    if (i == 1 && interlace->src[0])
+      gst_video_frame_unmap (interlace->src[0]);
     gst_video_frame_unmap (&dframe);
-    return;
+    return FALSE;
   }
 }
 
+/* Takes one field from the stored frame and the other one from @buffer.
+ * When @buffer is not needed afterwards the stored field is copied into
+ * it, otherwise both are woven into a new buffer. */
+static GstFlowReturn
+gst_interlace_weave_stored (GstInterlace * interlace, GstBuffer ** buffer,
+    gboolean keep_buffer, GstBuffer ** outbuf)
+{
+  GstBuffer *fields[2];
+  GstFlowReturn ret;
+
+  fields[interlace->field_index] = interlace->stored_frame;
+  fields[interlace->field_index ^ 1] = *buffer;
+
+  if (!keep_buffer && gst_buffer_is_writable (*buffer)) {
+    GST_DEBUG_OBJECT (interlace, "copying stored field into current");
+    fields[interlace->field_index ^ 1] = NULL;
+    *outbuf = *buffer;
+    *buffer = NULL;
+  } else if (interlace->pool) {
+    ret = gst_buffer_pool_acquire_buffer (interlace->pool, outbuf, NULL);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  } else {
+    *outbuf = gst_buffer_new_and_alloc (GST_VIDEO_INFO_SIZE (&interlace->info));
+  }
+
+  if (!gst_interlace_weave (interlace, *outbuf, fields[0], fields[1])) {
+    gst_buffer_replace (outbuf, NULL);
+    return GST_FLOW_ERROR;
+  }
+
+  return GST_FLOW_OK;
+}
 
 static GstFlowReturn
 gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
@@ -735,14 +910,14 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     if (interlace->stored_fields > 0) {
       GST_DEBUG ("1 field from stored, 1 from current");
 
-      output_buffer = gst_buffer_new_and_alloc (gst_buffer_get_size (buffer));
-      /* take the first field from the stored frame */
-      copy_field (interlace, output_buffer, interlace->stored_frame,
-          interlace->field_index);
+      /* take the first field from the stored frame and the second field
+       * from the incoming buffer */
       interlace->stored_fields--;
-      /* take the second field from the incoming buffer */
-      copy_field (interlace, output_buffer, buffer, interlace->field_index ^ 1);
       current_fields--;
+      ret = gst_interlace_weave_stored (interlace, &buffer,
+          current_fields > 0, &output_buffer);
+      if (ret != GST_FLOW_OK)
+        break;
       n_output_fields = 2;
       interlaced = TRUE;
     } else {
@@ -796,7 +971,7 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   if (current_fields > 0) {
     interlace->stored_frame = buffer;
     interlace->stored_fields = current_fields;
-  } else {
+  } else if (buffer) {
     gst_buffer_unref (buffer);
   }
   return ret;
@@ -821,6 +996,11 @@ gst_interlace_set_property (GObject * object,
     case PROP_ALLOW_RFF:
       interlace->allow_rff = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (interlace);
+      interlace->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (interlace);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -846,6 +1026,11 @@ gst_interlace_get_property (GObject * object,
     case PROP_ALLOW_RFF:
       g_value_set_boolean (value, interlace->allow_rff);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (interlace);
+      g_value_set_uint (value, interlace->n_threads);
+      GST_OBJECT_UNLOCK (interlace);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -855,7 +1040,8 @@ gst_interlace_get_property (GObject * object,
 static GstStateChangeReturn
 gst_interlace_change_state (GstElement * element, GstStateChange transition)
 {
-  //GstInterlace *interlace = GST_INTERLACE (element);
+  GstInterlace *interlace = GST_INTERLACE (element);
+  GstStateChangeReturn ret;
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -865,7 +1051,17 @@ gst_interlace_change_state (GstElement * element, GstStateChange transition)
       break;
   }
 
-  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_interlace_free_pools (interlace);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
 }
 
 static gboolean
@@ -35,6 +35,13 @@
  * Unlike the adder, the liveadder mixes the streams according the their
  * timestamps and waits for some milli-seconds before trying doing the mixing.
  *
+ * When #GstLiveAdder:period-time is set, the live adder works as a mix bus:
+ * the output is cut in periods of that duration, every input buffer is added
+ * directly into the periods it overlaps and each period is pushed as one
+ * buffer. The volume of each sink pad can then be set with the "volume"
+ * property of the pad. This mode is only used with signed integer and float
+ * formats.
+ *
  * Last reviewed on 2008-02-10 (0.10.11)
  */
 
@@ -48,7 +55,13 @@
 
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define DEFAULT_LATENCY_MS 60
+#define DEFAULT_PERIOD_MS 0
+#define DEFAULT_PAD_VOLUME 1.0
 
 GST_DEBUG_CATEGORY_STATIC (live_adder_debug);
 #define GST_CAT_DEFAULT (live_adder_debug)
@@ -84,6 +97,13 @@ enum
 {
   PROP_0,
   PROP_LATENCY,
+  PROP_PERIOD_TIME
+};
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_VOLUME
 };
 
 typedef struct _GstLiveAdderPadPrivate
@@ -95,6 +115,26 @@ typedef struct _GstLiveAdderPadPrivate
 
 } GstLiveAdderPadPrivate;
 
+/* Mix bus
+ *
+ * In mix bus mode the output is cut in periods of period-time. The periods
+ * from the next one to push up to the latency ahead live in a ring, so an
+ * input buffer maps directly to the periods it overlaps and is added into
+ * them in place. Each period has its own lock, the sink pads only take the
+ * object lock to reserve the periods they mix into.
+ */
+struct _GstLiveAdderPeriod
+{
+  GMutex lock;
+  /* NULL until some input is mixed into the period */
+  GstBuffer *buffer;
+  GstMapInfo map;
+  /* number of sink pads mixing into the period, protected by the object
+   * lock. The period is not pushed until this drops to 0 */
+  guint writers;
+};
+
+G_DEFINE_TYPE (GstLiveAdderPad, gst_live_adder_pad, GST_TYPE_PAD);
 G_DEFINE_TYPE (GstLiveAdder, gst_live_adder, GST_TYPE_ELEMENT);
 
 static void gst_live_adder_finalize (GObject * object);
@@ -130,6 +170,7 @@ static gboolean gst_live_adder_sink_event (GstPad * pad, GstObject * parent,
 
 
 static void reset_pad_private (GstPad * pad);
+static void gst_live_adder_bus_free (GstLiveAdder * adder);
 
 /* clipping versions */
 #define MAKE_FUNC(name,type,ttype,min,max)                      \
@@ -147,17 +188,154 @@ static void name (type *out, type *in, gint bytes) {            \
     out[i] = (ttype)out[i] + (ttype)in[i];                      \
 }
 
+/* versions scaling the input by a volume, used by the mix bus */
+#define MAKE_VOLUME_FUNC(name,type,ttype,min,max)               \
+static void name (type *out, type *in, gint bytes,              \
+    gdouble volume) {                                           \
+  gint i;                                                       \
+  for (i = 0; i < bytes / sizeof (type); i++)                   \
+    out[i] = CLAMP ((ttype)out[i] + (ttype)(in[i] * volume),    \
+        min, max);                                              \
+}
+
+#define MAKE_VOLUME_FUNC_NC(name,type,ttype)                    \
+static void name (type *out, type *in, gint bytes,              \
+    gdouble volume) {                                           \
+  gint i;                                                       \
+  for (i = 0; i < bytes / sizeof (type); i++)                   \
+    out[i] = (ttype)out[i] + (ttype)(in[i] * volume);           \
+}
+
+#ifdef __SSE2__
+/* SSE2 versions, 16 bytes at a time with saturation for the integer
+ * formats. The remaining samples are handled by the scalar loop. */
+#define MAKE_FUNC_SSE2(name,type,ttype,min,max,vtype,load,store,add)    \
+static void name (type *out, type *in, gint bytes) {            \
+  gint i, n = bytes / sizeof (type);                            \
+  const gint step = 16 / sizeof (type);                         \
+  for (i = 0; i + step <= n; i += step)                         \
+    store ((vtype *) (out + i),                                 \
+        add (load ((vtype *) (out + i)), load ((vtype *) (in + i))));   \
+  for (; i < n; i++)                                            \
+    out[i] = CLAMP ((ttype)out[i] + (ttype)in[i], min, max);    \
+}
+
+#define MAKE_FUNC_SSE2_NC(name,type,ttype,load,store,add)      \
+static void name (type *out, type *in, gint bytes) {            \
+  gint i, n = bytes / sizeof (type);                            \
+  const gint step = 16 / sizeof (type);                         \
+  for (i = 0; i + step <= n; i += step)                         \
+    store (out + i, add (load (out + i), load (in + i)));        \
+  for (; i < n; i++)                                            \
+    out[i] = (ttype)out[i] + (ttype)in[i];                      \
+}
+
+/* SSE2 has no saturating 32 bits add, saturate where both inputs have the
+ * same sign and the sum does not */
+static inline __m128i
+adds_epi32 (__m128i a, __m128i b)
+{
+  __m128i sum = _mm_add_epi32 (a, b);
+  __m128i overflow = _mm_srai_epi32 (_mm_andnot_si128 (_mm_xor_si128 (a, b),
+          _mm_xor_si128 (a, sum)), 31);
+  __m128i saturated = _mm_xor_si128 (_mm_srai_epi32 (a, 31),
+      _mm_set1_epi32 (G_MAXINT32));
+
+  return _mm_or_si128 (_mm_and_si128 (overflow, saturated),
+      _mm_andnot_si128 (overflow, sum));
+}
+
+/* *INDENT-OFF* */
+MAKE_FUNC_SSE2 (add_int32, gint32, gint64, G_MININT32, G_MAXINT32, __m128i,
+    _mm_loadu_si128, _mm_storeu_si128, adds_epi32)
+MAKE_FUNC_SSE2 (add_int16, gint16, gint32, G_MININT16, G_MAXINT16, __m128i,
+    _mm_loadu_si128, _mm_storeu_si128, _mm_adds_epi16)
+MAKE_FUNC_SSE2 (add_int8, gint8, gint16, G_MININT8, G_MAXINT8, __m128i,
+    _mm_loadu_si128, _mm_storeu_si128, _mm_adds_epi8)
+MAKE_FUNC_SSE2_NC (add_float64, gdouble, gdouble, _mm_loadu_pd,
+    _mm_storeu_pd, _mm_add_pd)
+MAKE_FUNC_SSE2_NC (add_float32, gfloat, gfloat, _mm_loadu_ps,
+    _mm_storeu_ps, _mm_add_ps)
+/* *INDENT-ON* */
+#else
 /* *INDENT-OFF* */
 MAKE_FUNC (add_int32, gint32, gint64, G_MININT32, G_MAXINT32)
 MAKE_FUNC (add_int16, gint16, gint32, G_MININT16, G_MAXINT16)
 MAKE_FUNC (add_int8, gint8, gint16, G_MININT8, G_MAXINT8)
+MAKE_FUNC_NC (add_float64, gdouble, gdouble)
+MAKE_FUNC_NC (add_float32, gfloat, gfloat)
+/* *INDENT-ON* */
+#endif
+
+/* *INDENT-OFF* */
 MAKE_FUNC (add_uint32, guint32, guint64, 0, G_MAXUINT32)
 MAKE_FUNC (add_uint16, guint16, guint32, 0, G_MAXUINT16)
 MAKE_FUNC (add_uint8, guint8, guint16, 0, G_MAXUINT8)
-MAKE_FUNC_NC (add_float64, gdouble, gdouble)
-MAKE_FUNC_NC (add_float32, gfloat, gfloat)
+MAKE_VOLUME_FUNC (add_volume_int32, gint32, gint64, G_MININT32, G_MAXINT32)
+MAKE_VOLUME_FUNC (add_volume_int16, gint16, gint32, G_MININT16, G_MAXINT16)
+MAKE_VOLUME_FUNC (add_volume_int8, gint8, gint16, G_MININT8, G_MAXINT8)
+MAKE_VOLUME_FUNC_NC (add_volume_float64, gdouble, gdouble)
+MAKE_VOLUME_FUNC_NC (add_volume_float32, gfloat, gfloat)
 /* *INDENT-ON* */
 
+static void
+gst_live_adder_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstLiveAdderPad *pad = GST_LIVE_ADDER_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_VOLUME:
+      GST_OBJECT_LOCK (pad);
+      pad->volume = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_live_adder_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstLiveAdderPad *pad = GST_LIVE_ADDER_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_VOLUME:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_double (value, pad->volume);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_live_adder_pad_class_init (GstLiveAdderPadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->set_property = gst_live_adder_pad_set_property;
+  gobject_class->get_property = gst_live_adder_pad_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_PAD_VOLUME,
+      g_param_spec_double ("volume", "Volume",
+          "Volume of this pad (only used in mix bus mode)",
+          0.0, 10.0, DEFAULT_PAD_VOLUME,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+          G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_live_adder_pad_init (GstLiveAdderPad * pad)
+{
+  pad->volume = DEFAULT_PAD_VOLUME;
+}
+
 
 static void
 gst_live_adder_class_init (GstLiveAdderClass * klass)
@@ -189,6 +367,13 @@ gst_live_adder_class_init (GstLiveAdderClass * klass)
           "Amount of data to buffer (in milliseconds)",
           0, G_MAXUINT, DEFAULT_LATENCY_MS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PERIOD_TIME,
+      g_param_spec_uint ("period-time", "Period time",
+          "Duration of the output buffers of the mix bus (in milliseconds), "
+          "0 to mix the input buffers as they come",
+          0, G_MAXUINT, DEFAULT_PERIOD_MS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -207,10 +392,12 @@ gst_live_adder_init (GstLiveAdder * adder)
   adder->padcount = 0;
   adder->func = NULL;
   g_cond_init (&adder->not_empty_cond);
+  g_cond_init (&adder->bus_cond);
 
   adder->next_timestamp = GST_CLOCK_TIME_NONE;
 
   adder->latency_ms = DEFAULT_LATENCY_MS;
+  adder->period_ms = DEFAULT_PERIOD_MS;
 
   adder->buffers = g_queue_new ();
 }
@@ -221,7 +408,10 @@ gst_live_adder_finalize (GObject * object)
 {
   GstLiveAdder *adder = GST_LIVE_ADDER (object);
 
+  gst_live_adder_bus_free (adder);
+
   g_cond_clear (&adder->not_empty_cond);
+  g_cond_clear (&adder->bus_cond);
 
   g_queue_foreach (adder->buffers, (GFunc) gst_mini_object_unref, NULL);
   while (g_queue_pop_head (adder->buffers)) {
@@ -263,6 +453,12 @@ gst_live_adder_set_property (GObject * object,
       }
       break;
     }
+    case PROP_PERIOD_TIME:
+      /* takes effect when the mix bus is started again */
+      GST_OBJECT_LOCK (adder);
+      adder->period_ms = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (adder);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -282,6 +478,11 @@ gst_live_adder_get_property (GObject * object,
       g_value_set_uint (value, adder->latency_ms);
       GST_OBJECT_UNLOCK (adder);
       break;
+    case PROP_PERIOD_TIME:
+      GST_OBJECT_LOCK (adder);
+      g_value_set_uint (value, adder->period_ms);
+      GST_OBJECT_UNLOCK (adder);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -360,6 +561,7 @@ gst_live_adder_setcaps (GstLiveAdder * adder, GstPad * pad, GstCaps * caps)
 {
   GstIterator *iter;
   struct SetCapsIterCtx ctx;
+  GstAudioInfo info;
 
   GST_LOG_OBJECT (adder, "setting caps on pad %p,%s to %" GST_PTR_FORMAT, pad,
       GST_PAD_NAME (pad), caps);
@@ -400,35 +602,46 @@ gst_live_adder_setcaps (GstLiveAdder * adder, GstPad * pad, GstCaps * caps)
 
   GST_OBJECT_LOCK (adder);
   /* parse caps now */
-  if (!gst_audio_info_from_caps (&adder->info, caps))
+  if (!gst_audio_info_from_caps (&info, caps))
     goto not_supported;
 
-  if (GST_AUDIO_INFO_IS_INTEGER (&adder->info)) {
-    switch (GST_AUDIO_INFO_WIDTH (&adder->info)) {
+  /* the volume functions are only used by the mix bus, which needs a format
+   * where silence is 0 */
+  adder->vfunc = NULL;
+  if (GST_AUDIO_INFO_IS_INTEGER (&info)) {
+    switch (GST_AUDIO_INFO_WIDTH (&info)) {
       case 8:
-        adder->func = GST_AUDIO_INFO_IS_SIGNED (&adder->info) ?
+        adder->func = GST_AUDIO_INFO_IS_SIGNED (&info) ?
             (GstLiveAdderFunction) add_int8 : (GstLiveAdderFunction) add_uint8;
+        if (GST_AUDIO_INFO_IS_SIGNED (&info))
+          adder->vfunc = (GstLiveAdderVolumeFunction) add_volume_int8;
         break;
       case 16:
-        adder->func = GST_AUDIO_INFO_IS_SIGNED (&adder->info) ?
+        adder->func = GST_AUDIO_INFO_IS_SIGNED (&info) ?
             (GstLiveAdderFunction) add_int16 : (GstLiveAdderFunction)
             add_uint16;
+        if (GST_AUDIO_INFO_IS_SIGNED (&info))
+          adder->vfunc = (GstLiveAdderVolumeFunction) add_volume_int16;
         break;
       case 32:
-        adder->func = GST_AUDIO_INFO_IS_SIGNED (&adder->info) ?
+        adder->func = GST_AUDIO_INFO_IS_SIGNED (&info) ?
             (GstLiveAdderFunction) add_int32 : (GstLiveAdderFunction)
             add_uint32;
+        if (GST_AUDIO_INFO_IS_SIGNED (&info))
+          adder->vfunc = (GstLiveAdderVolumeFunction) add_volume_int32;
         break;
       default:
         goto not_supported;
     }
-  } else if (GST_AUDIO_INFO_IS_FLOAT (&adder->info)) {
-    switch (GST_AUDIO_INFO_WIDTH (&adder->info)) {
+  } else if (GST_AUDIO_INFO_IS_FLOAT (&info)) {
+    switch (GST_AUDIO_INFO_WIDTH (&info)) {
       case 32:
         adder->func = (GstLiveAdderFunction) add_float32;
+        adder->vfunc = (GstLiveAdderVolumeFunction) add_volume_float32;
         break;
       case 64:
         adder->func = (GstLiveAdderFunction) add_float64;
+        adder->vfunc = (GstLiveAdderVolumeFunction) add_volume_float64;
         break;
       default:
         goto not_supported;
@@ -436,6 +649,14 @@ gst_live_adder_setcaps (GstLiveAdder * adder, GstPad * pad, GstCaps * caps)
   } else {
     goto not_supported;
   }
+  adder->bus_supported = (adder->vfunc != NULL);
+
+  /* the periods of the mix bus are laid out for the old format */
+  if (GST_AUDIO_INFO_FORMAT (&info) != GST_AUDIO_INFO_FORMAT (&adder->info) ||
+      GST_AUDIO_INFO_RATE (&info) != GST_AUDIO_INFO_RATE (&adder->info) ||
+      GST_AUDIO_INFO_CHANNELS (&info) != GST_AUDIO_INFO_CHANNELS (&adder->info))
+    gst_live_adder_bus_free (adder);
+  adder->info = info;
 
   GST_OBJECT_UNLOCK (adder);
   return TRUE;
@@ -462,6 +683,9 @@ gst_live_adder_flush_start (GstLiveAdder * adder)
   g_queue_foreach (adder->buffers, (GFunc) gst_mini_object_unref, NULL);
   while (g_queue_pop_head (adder->buffers));
 
+  /* and the mix bus */
+  gst_live_adder_bus_free (adder);
+
   /* unlock clock, we just unschedule, the entry will be released by the
    * locking streaming thread. */
   if (adder->clock_id)
@@ -923,6 +1147,240 @@ gst_live_adder_length_from_duration (GstLiveAdder * adder,
   return (guint) ret;
 }
 
+/* must be called with the object lock, waits until no sink pad is mixing
+ * into the bus anymore */
+static void
+gst_live_adder_bus_free (GstLiveAdder * adder)
+{
+  guint i;
+
+again:
+  if (adder->bus == NULL)
+    return;
+
+  for (i = 0; i < adder->bus_n_periods; i++) {
+    if (adder->bus[i].writers > 0) {
+      g_cond_wait (&adder->bus_cond, GST_OBJECT_GET_LOCK (adder));
+      goto again;
+    }
+  }
+
+  GST_DEBUG_OBJECT (adder, "freeing mix bus");
+
+  for (i = 0; i < adder->bus_n_periods; i++) {
+    GstLiveAdderPeriod *period = &adder->bus[i];
+
+    if (period->buffer) {
+      gst_buffer_unmap (period->buffer, &period->map);
+      gst_buffer_unref (period->buffer);
+    }
+    g_mutex_clear (&period->lock);
+  }
+  g_free (adder->bus);
+  adder->bus = NULL;
+  adder->bus_n_periods = 0;
+  adder->bus_active = 0;
+
+  /* wake up the sink pads waiting for room in the old bus */
+  g_cond_broadcast (&adder->bus_cond);
+}
+
+/* must be called with the object lock */
+static void
+gst_live_adder_bus_new (GstLiveAdder * adder, guint64 offset)
+{
+  guint64 n_periods;
+  guint i;
+
+  adder->period_samples = MAX (1, gst_util_uint64_scale_int (adder->period_ms,
+          GST_AUDIO_INFO_RATE (&adder->info), 1000));
+
+  /* enough periods to cover the latency, plus the one being pushed and the
+   * one being started */
+  n_periods = ((guint64) adder->latency_ms + adder->period_ms - 1) /
+      adder->period_ms + 2;
+  adder->bus_n_periods = (guint) MIN (n_periods, 1024);
+  adder->bus = g_new0 (GstLiveAdderPeriod, adder->bus_n_periods);
+  for (i = 0; i < adder->bus_n_periods; i++)
+    g_mutex_init (&adder->bus[i].lock);
+
+  adder->bus_head = 0;
+  adder->bus_active = 0;
+  adder->bus_offset = offset - offset % adder->period_samples;
+
+  GST_DEBUG_OBJECT (adder, "created mix bus of %u periods of %u samples",
+      adder->bus_n_periods, adder->period_samples);
+}
+
+static inline GstClockTime
+gst_live_adder_bus_time (GstLiveAdder * adder, guint64 offset)
+{
+  return gst_util_uint64_scale_int (offset, GST_SECOND,
+      GST_AUDIO_INFO_RATE (&adder->info));
+}
+
+/* Mixes @buffer into the periods it overlaps, takes ownership of @buffer.
+ * Must be called with the object lock, which is released while mixing. */
+static GstFlowReturn
+gst_live_adder_bus_mix (GstLiveAdder * adder, GstPad * pad,
+    GstBuffer * buffer)
+{
+  guint bpf = GST_AUDIO_INFO_BPF (&adder->info);
+  guint64 start, offset, end;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstLiveAdderFunction func;
+  GstLiveAdderVolumeFunction vfunc;
+  gdouble volume;
+  GstMapInfo map;
+
+  GST_OBJECT_LOCK (pad);
+  volume = GST_LIVE_ADDER_PAD_CAST (pad)->volume;
+  GST_OBJECT_UNLOCK (pad);
+
+  start = gst_util_uint64_scale_int_round (GST_BUFFER_TIMESTAMP (buffer),
+      GST_AUDIO_INFO_RATE (&adder->info), GST_SECOND);
+  end = start + gst_buffer_get_size (buffer) / bpf;
+  offset = start;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+
+  while (offset < end) {
+    GstLiveAdderPeriod *bus;
+    guint64 bus_offset, ring_end, chunk_end;
+    guint head, n_periods, first, last, i;
+
+    if (adder->srcresult != GST_FLOW_OK) {
+      ret = adder->srcresult;
+      break;
+    }
+
+    if (adder->bus == NULL)
+      gst_live_adder_bus_new (adder, offset);
+
+    /* nothing pending, move the bus forward to the data instead of pushing
+     * silence up to it */
+    if (adder->bus_active == 0 &&
+        offset >= adder->bus_offset + adder->period_samples)
+      adder->bus_offset = offset - offset % adder->period_samples;
+
+    if (offset < adder->bus_offset) {
+      if (end <= adder->bus_offset) {
+        GST_DEBUG_OBJECT (adder, "Buffer is late, dropping");
+        break;
+      }
+      GST_DEBUG_OBJECT (adder, "Buffer is partially late, skipping %"
+          G_GUINT64_FORMAT " samples", adder->bus_offset - offset);
+      offset = adder->bus_offset;
+    }
+
+    ring_end = adder->bus_offset +
+        (guint64) adder->bus_n_periods * adder->period_samples;
+    if (offset >= ring_end) {
+      /* too far ahead, wait for the src pad to push some periods */
+      g_cond_wait (&adder->bus_cond, GST_OBJECT_GET_LOCK (adder));
+      continue;
+    }
+    chunk_end = MIN (end, ring_end);
+
+    /* reserve the periods, the src pad will not push them until we're done */
+    bus = adder->bus;
+    head = adder->bus_head;
+    n_periods = adder->bus_n_periods;
+    bus_offset = adder->bus_offset;
+    first = (offset - bus_offset) / adder->period_samples;
+    last = (chunk_end - 1 - bus_offset) / adder->period_samples;
+
+    for (i = first; i <= last; i++) {
+      GstLiveAdderPeriod *period = &bus[(head + i) % n_periods];
+
+      if (period->buffer == NULL) {
+        period->buffer = gst_buffer_new_allocate (NULL,
+            adder->period_samples * bpf, NULL);
+        gst_buffer_map (period->buffer, &period->map, GST_MAP_READWRITE);
+        memset (period->map.data, 0, period->map.size);
+        adder->bus_active++;
+      }
+      period->writers++;
+    }
+    /* setcaps can replace them once the lock is released */
+    func = adder->func;
+    vfunc = adder->vfunc;
+    GST_OBJECT_UNLOCK (adder);
+
+    for (i = first; i <= last; i++) {
+      GstLiveAdderPeriod *period = &bus[(head + i) % n_periods];
+      guint64 period_start = bus_offset + (guint64) i * adder->period_samples;
+      guint64 from = MAX (offset, period_start);
+      guint64 to = MIN (chunk_end, period_start + adder->period_samples);
+      guint8 *out = period->map.data + (from - period_start) * bpf;
+      guint8 *in = map.data + (from - start) * bpf;
+
+      g_mutex_lock (&period->lock);
+      if (volume == 1.0)
+        func (out, in, (to - from) * bpf);
+      else
+        vfunc (out, in, (to - from) * bpf, volume);
+      g_mutex_unlock (&period->lock);
+    }
+
+    GST_OBJECT_LOCK (adder);
+    for (i = first; i <= last; i++)
+      bus[(head + i) % n_periods].writers--;
+    g_cond_broadcast (&adder->bus_cond);
+    g_cond_broadcast (&adder->not_empty_cond);
+
+    offset = chunk_end;
+  }
+
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+/* Takes the next period out of the bus, must be called with the object lock.
+ * Returns NULL when flushing. */
+static GstBuffer *
+gst_live_adder_bus_pop (GstLiveAdder * adder)
+{
+  GstLiveAdderPeriod *period;
+  GstBuffer *buffer;
+  gsize size;
+
+  while (adder->bus && adder->bus[adder->bus_head].writers > 0) {
+    g_cond_wait (&adder->bus_cond, GST_OBJECT_GET_LOCK (adder));
+    if (adder->srcresult != GST_FLOW_OK)
+      return NULL;
+  }
+  if (adder->bus == NULL)
+    return NULL;
+
+  period = &adder->bus[adder->bus_head];
+  size = adder->period_samples * GST_AUDIO_INFO_BPF (&adder->info);
+
+  if (period->buffer) {
+    buffer = period->buffer;
+    gst_buffer_unmap (buffer, &period->map);
+    period->buffer = NULL;
+    adder->bus_active--;
+  } else {
+    /* nothing was mixed into this period */
+    buffer = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_memset (buffer, 0, 0, size);
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
+  }
+
+  GST_BUFFER_PTS (buffer) = gst_live_adder_bus_time (adder, adder->bus_offset);
+  GST_BUFFER_DURATION (buffer) = gst_live_adder_bus_time (adder,
+      adder->bus_offset + adder->period_samples) - GST_BUFFER_PTS (buffer);
+
+  adder->bus_offset += adder->period_samples;
+  adder->bus_head = (adder->bus_head + 1) % adder->bus_n_periods;
+  g_cond_broadcast (&adder->bus_cond);
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_live_live_adder_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -931,6 +1389,7 @@ gst_live_live_adder_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   GstFlowReturn ret = GST_FLOW_OK;
   GList *item = NULL;
   GstClockTime skip = 0;
+  GstClockTime stream_time;
   gint64 drift = 0;             /* Positive if new buffer after old buffer */
 
   GST_OBJECT_LOCK (adder);
@@ -1023,6 +1482,9 @@ gst_live_live_adder_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     goto out;
   }
 
+  stream_time = gst_segment_to_stream_time (&padprivate->segment,
+      padprivate->segment.format, GST_BUFFER_TIMESTAMP (buffer));
+
   /*
    * Make sure all incoming buffers share the same timestamping
    */
@@ -1030,6 +1492,13 @@ gst_live_live_adder_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       gst_segment_to_running_time (&padprivate->segment,
       padprivate->segment.format, GST_BUFFER_TIMESTAMP (buffer));
 
+  if (adder->bus || (adder->period_ms > 0 && adder->bus_supported)) {
+    /* update the controlled volume of the pad */
+    if (GST_CLOCK_TIME_IS_VALID (stream_time))
+      gst_object_sync_values (GST_OBJECT_CAST (pad), stream_time);
+    ret = gst_live_adder_bus_mix (adder, pad, buffer);
+    goto out;
+  }
 
   if (GST_CLOCK_TIME_IS_VALID (adder->next_timestamp) &&
       GST_BUFFER_TIMESTAMP (buffer) < adder->next_timestamp) {
@@ -1212,14 +1681,18 @@ again:
   for (;;) {
     if (adder->srcresult != GST_FLOW_OK)
       goto flushing;
-    if (!g_queue_is_empty (adder->buffers))
+    if (!g_queue_is_empty (adder->buffers) || adder->bus_active > 0)
       break;
     if (check_eos_locked (adder))
       goto eos;
     g_cond_wait (&adder->not_empty_cond, GST_OBJECT_GET_LOCK (adder));
   }
 
-  buffer_timestamp = GST_BUFFER_TIMESTAMP (g_queue_peek_head (adder->buffers));
+  if (adder->bus_active > 0)
+    buffer_timestamp = gst_live_adder_bus_time (adder, adder->bus_offset);
+  else
+    buffer_timestamp =
+        GST_BUFFER_TIMESTAMP (g_queue_peek_head (adder->buffers));
 
   clock = GST_ELEMENT_CLOCK (adder);
 
@@ -1269,7 +1742,10 @@ again:
 
 push_buffer:
 
-  buffer = g_queue_pop_head (adder->buffers);
+  if (adder->bus_active > 0)
+    buffer = gst_live_adder_bus_pop (adder);
+  else
+    buffer = g_queue_pop_head (adder->buffers);
 
   if (!buffer)
     goto again;
@@ -1362,6 +1838,8 @@ pause:
 
     /* store result */
     adder->srcresult = result;
+    /* wake up the sink pads waiting for room on the mix bus */
+    g_cond_broadcast (&adder->bus_cond);
     /* we don't post errors or anything because upstream will do that for us
      * when we pass the return value upstream. */
     gst_pad_pause_task (adder->srcpad);
@@ -1404,7 +1882,8 @@ gst_live_adder_request_new_pad (GstElement * element, GstPadTemplate * templ,
 #endif
 
   name = g_strdup_printf ("sink_%u", padcount);
-  newpad = gst_pad_new_from_template (templ, name);
+  newpad = g_object_new (GST_TYPE_LIVE_ADDER_PAD, "name", name, "direction",
+      templ->direction, "template", templ, NULL);
   GST_DEBUG_OBJECT (adder, "request new pad %s", name);
   g_free (name);
 
@@ -39,8 +39,18 @@ G_BEGIN_DECLS
 #define GST_LIVE_ADDER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj) ,GST_TYPE_LIVE_ADDER,GstLiveAdderClass))
 typedef struct _GstLiveAdder GstLiveAdder;
 typedef struct _GstLiveAdderClass GstLiveAdderClass;
+typedef struct _GstLiveAdderPeriod GstLiveAdderPeriod;
+
+#define GST_TYPE_LIVE_ADDER_PAD        (gst_live_adder_pad_get_type())
+#define GST_LIVE_ADDER_PAD(obj)        (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_LIVE_ADDER_PAD,GstLiveAdderPad))
+#define GST_LIVE_ADDER_PAD_CAST(obj)   ((GstLiveAdderPad *)(obj))
+#define GST_IS_LIVE_ADDER_PAD(obj)     (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_LIVE_ADDER_PAD))
+typedef struct _GstLiveAdderPad GstLiveAdderPad;
+typedef struct _GstLiveAdderPadClass GstLiveAdderPadClass;
 
 typedef void (*GstLiveAdderFunction) (gpointer out, gpointer in, guint size);
+typedef void (*GstLiveAdderVolumeFunction) (gpointer out, gpointer in,
+    guint size, gdouble volume);
 
 /**
  * GstLiveAdder:
@@ -71,6 +81,21 @@ struct _GstLiveAdder
 
   /* function to add samples */
   GstLiveAdderFunction func;
+  /* function to add samples scaled by the pad volume */
+  GstLiveAdderVolumeFunction vfunc;
+
+  /* mix bus mode, used instead of the buffer queue when period_ms is set and
+   * the format can be mixed from silence */
+  guint period_ms;
+  gboolean bus_supported;
+  /* ring of periods, bus[bus_head] starts at sample bus_offset */
+  GstLiveAdderPeriod *bus;
+  guint bus_n_periods;
+  guint bus_head;
+  guint bus_active;
+  guint64 bus_offset;
+  guint period_samples;
+  GCond bus_cond;
 
   GstClockTime latency_ms;
   GstClockTime peer_latency;
@@ -85,7 +110,26 @@ struct _GstLiveAdderClass
   GstElementClass parent_class;
 };
 
+/**
+ * GstLiveAdderPad:
+ *
+ * The sink pads of the live adder.
+ */
+struct _GstLiveAdderPad
+{
+  /*< private >*/
+  GstPad parent;
+
+  gdouble volume;
+};
+
+struct _GstLiveAdderPadClass
+{
+  GstPadClass parent_class;
+};
+
 GType gst_live_adder_get_type (void);
+GType gst_live_adder_pad_get_type (void);
 
 G_END_DECLS
 #endif /* __GST_LIVE_ADDER_H__ */
@@ -94,7 +94,7 @@ static void gst_mpegpsmux_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
 static void mpegpsmux_finalize (GObject * object);
-static gboolean new_packet_cb (guint8 * data, guint len, void *user_data);
+static gboolean new_packet_cb (GstBuffer * buf, void *user_data);
 
 static gboolean mpegpsdemux_prepare_srcpad (MpegPsMux * mux);
 static GstFlowReturn mpegpsmux_collected (GstCollectPads * pads,
@@ -660,19 +660,17 @@ mpegpsmux_release_pad (GstElement * element, GstPad * pad)
 }
 
 static gboolean
-new_packet_cb (guint8 * data, guint len, void *user_data)
+new_packet_cb (GstBuffer * buf, void *user_data)
 {
-  /* Called when the PsMux has prepared a packet for output. Return FALSE
-   * on error */
+  /* Called when the PsMux has prepared a pack for output: the headers
+   * followed by the payload memory shared with the input buffers. Return
+   * FALSE on error */
 
   MpegPsMux *mux = (MpegPsMux *) user_data;
-  GstBuffer *buf;
   GstFlowReturn ret;
 
-  GST_LOG_OBJECT (mux, "Outputting a packet of length %d", len);
-
-  data = g_memdup (data, len);
-  buf = gst_buffer_new_wrapped (data, len);
+  GST_LOG_OBJECT (mux, "Outputting a packet of length %" G_GSIZE_FORMAT,
+      gst_buffer_get_size (buf));
 
   GST_BUFFER_TIMESTAMP (buf) = mux->last_ts;
 
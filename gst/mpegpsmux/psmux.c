@@ -54,10 +54,10 @@
 #include "psmux.h"
 #include "crc.h"
 
-static gboolean psmux_packet_out (PsMux * mux);
-static gboolean psmux_write_pack_header (PsMux * mux);
-static gboolean psmux_write_system_header (PsMux * mux);
-static gboolean psmux_write_program_stream_map (PsMux * mux);
+static gboolean psmux_packet_out (PsMux * mux, GstBuffer * payload);
+static void psmux_write_pack_header (PsMux * mux);
+static void psmux_write_system_header (PsMux * mux);
+static void psmux_write_program_stream_map (PsMux * mux);
 
 /**
  * psmux_new:
@@ -115,7 +115,10 @@ gboolean
 psmux_write_end_code (PsMux * mux)
 {
   guint8 end_code[4] = { 0, 0, 1, PSMUX_PROGRAM_END };
-  return mux->write_func (end_code, 4, mux->write_func_data);
+
+  memcpy (mux->packet_buf, end_code, 4);
+  mux->packet_bytes_written = 4;
+  return psmux_packet_out (mux, NULL);
 }
 
 
@@ -202,18 +205,39 @@ psmux_create_stream (PsMux * mux, PsMuxStreamType stream_type)
   return stream;
 }
 
+/* Outputs the headers in packet_buf, followed by the memory of @payload
+ * if it is not NULL. Takes ownership of @payload. */
 static gboolean
-psmux_packet_out (PsMux * mux)
+psmux_packet_out (PsMux * mux, GstBuffer * payload)
 {
+  GstMemory *mem;
+  GstMapInfo map;
   gboolean res;
-  if (G_UNLIKELY (mux->write_func == NULL))
+  gsize size;
+
+  if (G_UNLIKELY (mux->write_func == NULL)) {
+    if (payload)
+      gst_buffer_unref (payload);
+    mux->packet_bytes_written = 0;
     return TRUE;
+  }
+
+  /* the headers are the only thing we copy, the payload is shared with
+   * the input buffers */
+  mem = gst_allocator_alloc (NULL, mux->packet_bytes_written, NULL);
+  gst_memory_map (mem, &map, GST_MAP_WRITE);
+  memcpy (map.data, mux->packet_buf, mux->packet_bytes_written);
+  gst_memory_unmap (mem, &map);
 
-  res = mux->write_func (mux->packet_buf, mux->packet_bytes_written,
-      mux->write_func_data);
+  if (payload == NULL)
+    payload = gst_buffer_new ();
+  gst_buffer_prepend_memory (payload, mem);
+  size = gst_buffer_get_size (payload);
+
+  res = mux->write_func (payload, mux->write_func_data);
 
   if (res) {
-    mux->bit_size += mux->packet_bytes_written;
+    mux->bit_size += size;
   }
   mux->packet_bytes_written = 0;
   return res;
@@ -231,6 +255,8 @@ psmux_packet_out (PsMux * mux)
 gboolean
 psmux_write_stream_packet (PsMux * mux, PsMuxStream * stream)
 {
+  GstBuffer *payload;
+  guint pes_hdr_len;
   gboolean res;
 
   g_return_val_if_fail (mux != NULL, FALSE);
@@ -279,14 +305,19 @@ psmux_write_stream_packet (PsMux * mux, PsMuxStream * stream)
     mux->psm_pts = mux->pts;
   }
 
-  /* Write the packet */
-  if (!(mux->packet_bytes_written =
-          psmux_stream_get_data (stream, mux->packet_buf,
-              mux->pes_max_payload + PSMUX_PES_MAX_HDR_LEN))) {
+  /* Write the packet, the headers of the pack go in front of it */
+  payload = gst_buffer_new ();
+  pes_hdr_len = psmux_stream_get_data (stream,
+      mux->packet_buf + mux->packet_bytes_written,
+      mux->pes_max_payload + PSMUX_PES_MAX_HDR_LEN, payload);
+  if (!pes_hdr_len) {
+    gst_buffer_unref (payload);
+    mux->packet_bytes_written = 0;
     return FALSE;
   }
+  mux->packet_bytes_written += pes_hdr_len;
 
-  res = psmux_packet_out (mux);
+  res = psmux_packet_out (mux, payload);
   if (!res) {
     GST_DEBUG_OBJECT (mux, "packet write false");
     return FALSE;
@@ -297,7 +328,7 @@ psmux_write_stream_packet (PsMux * mux, PsMuxStream * stream)
   return res;
 }
 
-static gboolean
+static void
 psmux_write_pack_header (PsMux * mux)
 {
   bits_buffer_t bw;
@@ -306,7 +337,7 @@ psmux_write_pack_header (PsMux * mux)
     scr = 0;
 
   /* pack_start_code */
-  bits_initwrite (&bw, 14, mux->packet_buf);
+  bits_initwrite (&bw, 14, mux->packet_buf + mux->packet_bytes_written);
   bits_write (&bw, 24, PSMUX_START_CODE_PREFIX);
   bits_write (&bw, 8, PSMUX_PACK_HEADER);
 
@@ -334,8 +365,7 @@ psmux_write_pack_header (PsMux * mux)
   bits_write (&bw, 5, 0x1f);
   bits_write (&bw, 3, 0);       /* pack_stuffing_length */
 
-  mux->packet_bytes_written = 14;
-  return psmux_packet_out (mux);
+  mux->packet_bytes_written += 14;
 }
 
 static void
@@ -393,19 +423,15 @@ psmux_ensure_system_header (PsMux * mux)
   mux->sys_header = gst_buffer_new_wrapped (data, len);
 }
 
-static gboolean
+static void
 psmux_write_system_header (PsMux * mux)
 {
-  GstMapInfo map;
-
   psmux_ensure_system_header (mux);
 
-  gst_buffer_map (mux->sys_header, &map, GST_MAP_READ);
-  memcpy (mux->packet_buf, map.data, map.size);
-  mux->packet_bytes_written = map.size;
-  gst_buffer_unmap (mux->sys_header, &map);
-
-  return psmux_packet_out (mux);
+  gst_buffer_extract (mux->sys_header, 0,
+      mux->packet_buf + mux->packet_bytes_written, PSMUX_MAX_PACKET_LEN -
+      mux->packet_bytes_written);
+  mux->packet_bytes_written += gst_buffer_get_size (mux->sys_header);
 }
 
 static void
@@ -477,19 +503,15 @@ psmux_ensure_program_stream_map (PsMux * mux)
   mux->psm = gst_buffer_new_wrapped (data, psm_size);
 }
 
-static gboolean
+static void
 psmux_write_program_stream_map (PsMux * mux)
 {
-  GstMapInfo map;
-
   psmux_ensure_program_stream_map (mux);
 
-  gst_buffer_map (mux->psm, &map, GST_MAP_READ);
-  memcpy (mux->packet_buf, map.data, map.size);
-  mux->packet_bytes_written = map.size;
-  gst_buffer_unmap (mux->psm, &map);
-
-  return psmux_packet_out (mux);
+  gst_buffer_extract (mux->psm, 0,
+      mux->packet_buf + mux->packet_bytes_written, PSMUX_MAX_PACKET_LEN -
+      mux->packet_bytes_written);
+  mux->packet_bytes_written += gst_buffer_get_size (mux->psm);
 }
 
 GList *
@@ -54,7 +54,8 @@ G_BEGIN_DECLS
 
 #define PSMUX_MAX_ES_INFO_LENGTH ((1 << 12) - 1)
 
-typedef gboolean (*PsMuxWriteFunc) (guint8 *data, guint len, void *user_data);
+/* takes ownership of @buf */
+typedef gboolean (*PsMuxWriteFunc) (GstBuffer *buf, void *user_data);
 
 struct PsMux {
   GList *streams;    /* PsMuxStream* array of all streams */
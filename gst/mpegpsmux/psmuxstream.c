@@ -219,7 +219,7 @@ static void
 psmux_stream_consume (PsMuxStream * stream, guint len)
 {
   g_assert (stream->cur_buffer != NULL);
-  g_assert (len <= stream->cur_buffer->map.size - stream->cur_buffer_consumed);
+  g_assert (len <= stream->cur_buffer->size - stream->cur_buffer_consumed);
 
   stream->cur_buffer_consumed += len;
   stream->bytes_avail -= len;
@@ -230,11 +230,10 @@ psmux_stream_consume (PsMuxStream * stream, guint len)
   if (stream->cur_buffer->pts != -1)
     stream->last_pts = stream->cur_buffer->pts;
 
-  if (stream->cur_buffer_consumed == stream->cur_buffer->map.size) {
+  if (stream->cur_buffer_consumed == stream->cur_buffer->size) {
     /* Current packet is completed, move along */
     stream->buffers = g_list_delete_link (stream->buffers, stream->buffers);
 
-    gst_buffer_unmap (stream->cur_buffer->buf, &stream->cur_buffer->map);
     gst_buffer_unref (stream->cur_buffer->buf);
     g_slice_free (PsMuxStreamBuffer, stream->cur_buffer);
     stream->cur_buffer = NULL;
@@ -261,21 +260,26 @@ psmux_stream_bytes_in_buffer (PsMuxStream * stream)
 /**
  * psmux_stream_get_data:
  * @stream: a #PsMuxStream
- * @buf: a buffer to hold the result
- * @len: the length of @buf
+ * @buf: a buffer to hold the PES header
+ * @len: the maximum length of the PES packet
+ * @payload: a #GstBuffer to append the payload to
  *
- * Write a PES packet to @buf, up to @len bytes
+ * Write the header of a PES packet of up to @len bytes to @buf and append
+ * its payload to @payload. The payload memory is shared with the buffers
+ * added with psmux_stream_add_data(), nothing is copied.
  *
- * Returns: number of bytes having been written, 0 if error
+ * Returns: number of header bytes written to @buf, 0 if error
  */
 guint
-psmux_stream_get_data (PsMuxStream * stream, guint8 * buf, guint len)
+psmux_stream_get_data (PsMuxStream * stream, guint8 * buf, guint len,
+    GstBuffer * payload)
 {
   guint8 pes_hdr_length;
   guint w;
 
   g_return_val_if_fail (stream != NULL, FALSE);
   g_return_val_if_fail (buf != NULL, FALSE);
+  g_return_val_if_fail (payload != NULL, FALSE);
   g_return_val_if_fail (len >= PSMUX_PES_MAX_HDR_LEN, FALSE);
 
   stream->cur_pes_payload_size =
@@ -307,12 +311,10 @@ psmux_stream_get_data (PsMuxStream * stream, guint8 * buf, guint len)
       pes_hdr_length, stream->cur_pes_payload_size);
   psmux_stream_write_pes_header (stream, buf);
 
-  buf += pes_hdr_length;
   w = stream->cur_pes_payload_size;     /* number of bytes of payload to write */
 
   while (w > 0) {
     guint32 avail;
-    guint8 *cur;
 
     if (stream->cur_buffer == NULL) {
       /* Start next packet */
@@ -323,23 +325,18 @@ psmux_stream_get_data (PsMuxStream * stream, guint8 * buf, guint len)
     }
 
     /* Take as much as we can from the current buffer */
-    avail = stream->cur_buffer->map.size - stream->cur_buffer_consumed;
-    cur = stream->cur_buffer->map.data + stream->cur_buffer_consumed;
-    if (avail < w) {
-      memcpy (buf, cur, avail);
-      psmux_stream_consume (stream, avail);
-
-      buf += avail;
-      w -= avail;
-    } else {
-      memcpy (buf, cur, w);
-      psmux_stream_consume (stream, w);
-
-      w = 0;
-    }
+    avail = stream->cur_buffer->size - stream->cur_buffer_consumed;
+    if (avail > w)
+      avail = w;
+
+    gst_buffer_copy_into (payload, stream->cur_buffer->buf,
+        GST_BUFFER_COPY_MEMORY, stream->cur_buffer_consumed, avail);
+    psmux_stream_consume (stream, avail);
+
+    w -= avail;
   }
 
-  return pes_hdr_length + stream->cur_pes_payload_size;
+  return pes_hdr_length;
 }
 
 static guint8
@@ -394,7 +391,7 @@ psmux_stream_find_pts_dts_within (PsMuxStream * stream, guint bound,
     /* FIXME: This isn't quite correct - if the 'bound' is within this
      * buffer, we don't know if the timestamp is before or after the split
      * so we shouldn't return it */
-    if (bound <= curbuf->map.size) {
+    if (bound <= curbuf->size) {
       *pts = curbuf->pts;
       *dts = curbuf->dts;
       return;
@@ -407,7 +404,7 @@ psmux_stream_find_pts_dts_within (PsMuxStream * stream, guint bound,
       return;
     }
 
-    bound -= curbuf->map.size;
+    bound -= curbuf->size;
   }
 }
 
@@ -495,13 +492,7 @@ psmux_stream_add_data (PsMuxStream * stream, GstBuffer * buffer,
 
   packet = g_slice_new (PsMuxStreamBuffer);
   packet->buf = buffer;
-
-  if (!gst_buffer_map (packet->buf, &packet->map, GST_MAP_READ)) {
-    GST_ERROR ("Failed to map buffer for reading");
-    gst_buffer_unref (packet->buf);
-    g_slice_free (PsMuxStreamBuffer, packet);
-    return;
-  }
+  packet->size = gst_buffer_get_size (buffer);
 
   packet->keyunit = keyunit;
   packet->pts = pts;
@@ -510,7 +501,7 @@ psmux_stream_add_data (PsMuxStream * stream, GstBuffer * buffer,
   if (stream->bytes_avail == 0)
     stream->last_pts = pts;
 
-  stream->bytes_avail += packet->map.size;
+  stream->bytes_avail += packet->size;
   /* FIXME: perhaps use GstQueueArray instead? */
   stream->buffers = g_list_append (stream->buffers, packet);
 
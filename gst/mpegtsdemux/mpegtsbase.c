@@ -56,6 +56,24 @@ static GQuark QUARK_PCR_PID;
 static GQuark QUARK_STREAMS;
 static GQuark QUARK_STREAM_TYPE;
 
+/* Selects the sections delivered to the application */
+typedef struct
+{
+  guint id;
+
+  /* -1 matches any value */
+  gint pid;
+  gint table_id;
+  gint extension;
+
+  /* Only deliver sections that changed since the last one delivered with
+   * the same pid, table_id, extension and section_number. The key is a
+   * gint64 made of those fields, the value is the version of the section,
+   * or a hash of the data for short sections which don't have a version */
+  gboolean changes_only;
+  GHashTable *seen;
+} MpegTSSectionFilter;
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -66,9 +84,24 @@ enum
 {
   PROP_0,
   PROP_PARSE_PRIVATE_SECTIONS,
+  PROP_ALL_SECTIONS,
+  PROP_EMIT_SIGNALS,
   /* FILL ME */
 };
 
+enum
+{
+  SIGNAL_SECTION,
+  SIGNAL_ADD_SECTION_FILTER,
+  SIGNAL_REMOVE_SECTION_FILTER,
+  LAST_SIGNAL
+};
+
+#define DEFAULT_ALL_SECTIONS TRUE
+#define DEFAULT_EMIT_SIGNALS FALSE
+
+static guint mpegts_base_signals[LAST_SIGNAL] = { 0 };
+
 static void mpegts_base_dispose (GObject * object);
 static void mpegts_base_finalize (GObject * object);
 static void mpegts_base_set_property (GObject * object, guint prop_id,
@@ -90,6 +123,10 @@ static gboolean mpegts_base_get_tags_from_eit (MpegTSBase * base,
     GstMpegTsSection * section);
 static gboolean remove_each_program (gpointer key, MpegTSBaseProgram * program,
     MpegTSBase * base);
+static guint mpegts_base_add_section_filter (MpegTSBase * base, gint pid,
+    gint table_id, gint extension, gboolean changes_only);
+static void mpegts_base_remove_section_filter (MpegTSBase * base, guint id);
+static void mpegts_base_section_filter_free (MpegTSSectionFilter * filter);
 
 static void
 _extra_init (void)
@@ -129,6 +166,61 @@ mpegts_base_class_init (MpegTSBaseClass * klass)
           "Parse private sections", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /* Sections are delivered to the application as mpegts-section messages,
+   * or with the section signal if emit-signals is set. By default every
+   * section is delivered, setting all-sections to FALSE restricts that to
+   * the sections matching a filter added with add-section-filter, so that
+   * no messages get created for the sections nobody is interested in. */
+  g_object_class_install_property (gobject_class, PROP_ALL_SECTIONS,
+      g_param_spec_boolean ("all-sections", "All sections",
+          "Deliver all sections, not only those matching a section filter",
+          DEFAULT_ALL_SECTIONS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_EMIT_SIGNALS,
+      g_param_spec_boolean ("emit-signals", "Emit signals",
+          "Deliver sections with the section signal instead of posting "
+          "messages", DEFAULT_EMIT_SIGNALS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* section:
+   * @section: the #GstMpegTsSection
+   *
+   * Emitted from the streaming thread for every delivered section when
+   * emit-signals is set. The section is only valid during the emission,
+   * it has to be referenced to be kept.
+   */
+  mpegts_base_signals[SIGNAL_SECTION] =
+      g_signal_new ("section", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST,
+      0, NULL, NULL, g_cclosure_marshal_generic, G_TYPE_NONE, 1,
+      GST_TYPE_MPEGTS_SECTION | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  /* add-section-filter:
+   * @pid: the PID of the sections, or -1 for any
+   * @table_id: the table_id of the sections, or -1 for any
+   * @extension: the subtable_extension of the sections, or -1 for any
+   * @changes_only: only deliver sections whose version changed
+   *
+   * Adds a filter selecting sections to deliver when all-sections is
+   * FALSE. Returns the id of the filter, to remove it later on.
+   */
+  mpegts_base_signals[SIGNAL_ADD_SECTION_FILTER] =
+      g_signal_new ("add-section-filter", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (MpegTSBaseClass, add_section_filter), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_UINT, 4, G_TYPE_INT, G_TYPE_INT,
+      G_TYPE_INT, G_TYPE_BOOLEAN);
+
+  /* remove-section-filter:
+   * @id: the id returned by add-section-filter
+   */
+  mpegts_base_signals[SIGNAL_REMOVE_SECTION_FILTER] =
+      g_signal_new ("remove-section-filter", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (MpegTSBaseClass, remove_section_filter), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_NONE, 1, G_TYPE_UINT);
+
+  klass->add_section_filter = mpegts_base_add_section_filter;
+  klass->remove_section_filter = mpegts_base_remove_section_filter;
 }
 
 static void
@@ -141,6 +233,16 @@ mpegts_base_set_property (GObject * object, guint prop_id,
     case PROP_PARSE_PRIVATE_SECTIONS:
       base->parse_private_sections = g_value_get_boolean (value);
       break;
+    case PROP_ALL_SECTIONS:
+      GST_OBJECT_LOCK (base);
+      base->all_sections = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (base);
+      break;
+    case PROP_EMIT_SIGNALS:
+      GST_OBJECT_LOCK (base);
+      base->emit_signals = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (base);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -156,16 +258,151 @@ mpegts_base_get_property (GObject * object, guint prop_id,
     case PROP_PARSE_PRIVATE_SECTIONS:
       g_value_set_boolean (value, base->parse_private_sections);
       break;
+    case PROP_ALL_SECTIONS:
+      GST_OBJECT_LOCK (base);
+      g_value_set_boolean (value, base->all_sections);
+      GST_OBJECT_UNLOCK (base);
+      break;
+    case PROP_EMIT_SIGNALS:
+      GST_OBJECT_LOCK (base);
+      g_value_set_boolean (value, base->emit_signals);
+      GST_OBJECT_UNLOCK (base);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
 }
 
 
+static guint
+mpegts_base_add_section_filter (MpegTSBase * base, gint pid, gint table_id,
+    gint extension, gboolean changes_only)
+{
+  MpegTSSectionFilter *filter;
+
+  filter = g_slice_new0 (MpegTSSectionFilter);
+  filter->pid = pid;
+  filter->table_id = table_id;
+  filter->extension = extension;
+  filter->changes_only = changes_only;
+  if (changes_only)
+    filter->seen =
+        g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+
+  GST_OBJECT_LOCK (base);
+  filter->id = ++base->last_filter_id;
+  base->section_filters = g_list_append (base->section_filters, filter);
+  GST_OBJECT_UNLOCK (base);
+
+  GST_DEBUG_OBJECT (base, "Added section filter %u (pid:%d, table_id:%d, "
+      "extension:%d, changes_only:%d)", filter->id, pid, table_id, extension,
+      changes_only);
+
+  return filter->id;
+}
+
+static void
+mpegts_base_remove_section_filter (MpegTSBase * base, guint id)
+{
+  MpegTSSectionFilter *filter = NULL;
+  GList *tmp;
+
+  GST_OBJECT_LOCK (base);
+  for (tmp = base->section_filters; tmp; tmp = tmp->next) {
+    if (((MpegTSSectionFilter *) tmp->data)->id == id) {
+      filter = tmp->data;
+      base->section_filters =
+          g_list_delete_link (base->section_filters, tmp);
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (base);
+
+  if (filter) {
+    GST_DEBUG_OBJECT (base, "Removed section filter %u", id);
+    mpegts_base_section_filter_free (filter);
+  } else
+    GST_WARNING_OBJECT (base, "No section filter with id %u", id);
+}
+
+static void
+mpegts_base_section_filter_free (MpegTSSectionFilter * filter)
+{
+  if (filter->seen)
+    g_hash_table_destroy (filter->seen);
+  g_slice_free (MpegTSSectionFilter, filter);
+}
+
+/* Call with the OBJECT_LOCK */
+static gboolean
+mpegts_base_section_filter_match (MpegTSSectionFilter * filter,
+    GstMpegTsSection * section)
+{
+  gpointer version, seen;
+  gint64 key;
+
+  if ((filter->pid != -1 && filter->pid != section->pid) ||
+      (filter->table_id != -1 && filter->table_id != section->table_id) ||
+      (filter->extension != -1 &&
+          filter->extension != section->subtable_extension))
+    return FALSE;
+
+  if (!filter->changes_only)
+    return TRUE;
+
+  key = ((gint64) section->pid << 32) | ((guint) section->table_id << 24) |
+      (section->subtable_extension << 8) | section->section_number;
+  if (section->short_section) {
+    guint hash = 5381, i;
+
+    for (i = 0; i < section->section_length; i++)
+      hash = (hash << 5) + hash + section->data[i];
+    version = GUINT_TO_POINTER (hash);
+  } else
+    version = GUINT_TO_POINTER (section->version_number);
+
+  if (g_hash_table_lookup_extended (filter->seen, &key, NULL, &seen) &&
+      seen == version)
+    return FALSE;
+
+  g_hash_table_insert (filter->seen, g_memdup (&key, sizeof (key)), version);
+
+  return TRUE;
+}
+
+/* Posts @section or emits it with the section signal, if it is selected */
+static void
+mpegts_base_deliver_section (MpegTSBase * base, GstMpegTsSection * section)
+{
+  gboolean deliver, emit_signals;
+  GList *tmp;
+
+  GST_OBJECT_LOCK (base);
+  deliver = base->all_sections;
+  /* every filter has to see the section to track its changes */
+  for (tmp = base->section_filters; tmp; tmp = tmp->next)
+    deliver |= mpegts_base_section_filter_match (tmp->data, section);
+  emit_signals = base->emit_signals;
+  GST_OBJECT_UNLOCK (base);
+
+  if (!deliver) {
+    GST_LOG_OBJECT (base, "Not delivering section (pid: 0x%04x, "
+        "table_id: 0x%02x)", section->pid, section->table_id);
+    return;
+  }
+
+  if (emit_signals)
+    g_signal_emit (base, mpegts_base_signals[SIGNAL_SECTION], 0, section);
+  else
+    gst_element_post_message (GST_ELEMENT_CAST (base),
+        gst_message_new_mpegts_section (GST_OBJECT (base), section));
+}
+
 static void
 mpegts_base_reset (MpegTSBase * base)
 {
   MpegTSBaseClass *klass = GST_MPEGTS_BASE_GET_CLASS (base);
+  GList *tmp;
 
   mpegts_packetizer_clear (base->packetizer);
   memset (base->is_pes, 0, 1024);
@@ -208,6 +445,17 @@ mpegts_base_reset (MpegTSBase * base)
   base->upstream_live = FALSE;
   base->queried_latency = FALSE;
 
+  /* the stream might be a different one, deliver the current sections
+   * again */
+  GST_OBJECT_LOCK (base);
+  for (tmp = base->section_filters; tmp; tmp = tmp->next) {
+    MpegTSSectionFilter *filter = tmp->data;
+
+    if (filter->seen)
+      g_hash_table_remove_all (filter->seen);
+  }
+  GST_OBJECT_UNLOCK (base);
+
   g_hash_table_foreach_remove (base->programs, (GHRFunc) remove_each_program,
       base);
 
@@ -240,6 +488,9 @@ mpegts_base_init (MpegTSBase * base)
   base->push_data = TRUE;
   base->push_section = TRUE;
 
+  base->all_sections = DEFAULT_ALL_SECTIONS;
+  base->emit_signals = DEFAULT_EMIT_SIGNALS;
+
   mpegts_base_reset (base);
 }
 
@@ -270,6 +521,9 @@ mpegts_base_finalize (GObject * object)
   }
   g_hash_table_destroy (base->programs);
 
+  g_list_free_full (base->section_filters,
+      (GDestroyNotify) mpegts_base_section_filter_free);
+
   if (G_OBJECT_CLASS (parent_class)->finalize)
     G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -915,10 +1169,9 @@ mpegts_base_handle_psi (MpegTSBase * base, GstMpegTsSection * section)
       break;
   }
 
-  /* Finally post message (if it wasn't corrupted) */
+  /* Finally deliver it (if it wasn't corrupted) */
   if (post_message)
-    gst_element_post_message (GST_ELEMENT_CAST (base),
-        gst_message_new_mpegts_section (GST_OBJECT (base), section));
+    mpegts_base_deliver_section (base, section);
   gst_mpegts_section_unref (section);
 }
 
@@ -158,6 +158,14 @@ struct _MpegTSBase {
   /* Whether to push data and/or sections to subclasses */
   gboolean push_data;
   gboolean push_section;
+
+  /* Section delivery to the application, protected by the OBJECT_LOCK.
+   * Sections are delivered if all_sections is set or if they match one of
+   * the section_filters */
+  gboolean all_sections;
+  gboolean emit_signals;
+  GList *section_filters;
+  guint last_filter_id;
 };
 
 struct _MpegTSBaseClass {
@@ -193,6 +201,11 @@ struct _MpegTSBaseClass {
   /* Notifies subclasses input buffer has been handled */
   GstFlowReturn (*input_done) (MpegTSBase *base, GstBuffer *buffer);
 
+  /* action signals */
+  guint (*add_section_filter) (MpegTSBase *base, gint pid, gint table_id,
+			       gint extension, gboolean changes_only);
+  void (*remove_section_filter) (MpegTSBase *base, guint id);
+
   /* signals */
   void (*pat_info) (GstStructure *pat);
   void (*pmt_info) (GstStructure *pmt);
@@ -30,6 +30,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <gst/base/gstbytewriter.h>
+
 #include "mpegtsbase.h"
 #include "mpegtsparse.h"
 #include "gstmpegdesc.h"
@@ -59,8 +61,11 @@ struct _MpegTSParsePad
   gint program_number;
   MpegTSParseProgram *program;
 
-  /* set to FALSE before a push and TRUE after */
-  gboolean pushed;
+  /* packets collected from the current input buffer, pushed as a single
+   * buffer once the whole input buffer has been parsed */
+  GstByteWriter batch;
+  /* size of the previous batch, to allocate the next one at once */
+  guint batch_size_hint;
 
   /* the return of the latest push */
   GstFlowReturn flow_return;
@@ -108,6 +113,7 @@ static gboolean push_event (MpegTSBase * base, GstEvent * event);
 
 #define mpegts_parse_parent_class parent_class
 G_DEFINE_TYPE (MpegTSParse2, mpegts_parse, GST_TYPE_MPEGTS_BASE);
+static void mpegts_parse_finalize (GObject * object);
 static void mpegts_parse_reset (MpegTSBase * base);
 static GstFlowReturn mpegts_parse_input_done (MpegTSBase * base,
     GstBuffer * buffer);
@@ -115,9 +121,13 @@ static GstFlowReturn mpegts_parse_input_done (MpegTSBase * base,
 static void
 mpegts_parse_class_init (MpegTSParse2Class * klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *element_class;
   MpegTSBaseClass *ts_class;
 
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = mpegts_parse_finalize;
+
   element_class = GST_ELEMENT_CLASS (klass);
   element_class->pad_removed = mpegts_parse_pad_removed;
   element_class->request_new_pad = mpegts_parse_request_new_pad;
@@ -159,11 +169,33 @@ mpegts_parse_init (MpegTSParse2 * parse)
 
   parse->have_group_id = FALSE;
   parse->group_id = G_MAXUINT;
+
+  parse->pid_pads = g_new0 (GPtrArray *, 0x2000);
+  parse->all_pads = g_ptr_array_new ();
+  parse->pid_pads_dirty = TRUE;
+}
+
+static void
+mpegts_parse_finalize (GObject * object)
+{
+  MpegTSParse2 *parse = GST_MPEGTS_PARSE (object);
+  guint i;
+
+  for (i = 0; i < 0x2000; i++) {
+    if (parse->pid_pads[i])
+      g_ptr_array_free (parse->pid_pads[i], TRUE);
+  }
+  g_free (parse->pid_pads);
+  g_ptr_array_free (parse->all_pads, TRUE);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
 mpegts_parse_reset (MpegTSBase * base)
 {
+  GList *tmp;
+
   /* Set the various know PIDs we are interested in */
 
   /* CAT */
@@ -190,6 +222,18 @@ mpegts_parse_reset (MpegTSBase * base)
   GST_MPEGTS_PARSE (base)->first = TRUE;
   GST_MPEGTS_PARSE (base)->have_group_id = FALSE;
   GST_MPEGTS_PARSE (base)->group_id = G_MAXUINT;
+
+  GST_OBJECT_LOCK (base);
+  GST_MPEGTS_PARSE (base)->pid_pads_dirty = TRUE;
+  /* drop the packets collected before a flush or seek */
+  for (tmp = GST_MPEGTS_PARSE (base)->srcpads; tmp; tmp = tmp->next) {
+    MpegTSParsePad *tspad = gst_pad_get_element_private (tmp->data);
+
+    gst_byte_writer_reset (&tspad->batch);
+    gst_byte_writer_init (&tspad->batch);
+    tspad->batch_size_hint = 0;
+  }
+  GST_OBJECT_UNLOCK (base);
 }
 
 static void
@@ -280,7 +324,7 @@ mpegts_parse_create_tspad (MpegTSParse2 * parse, const gchar * pad_name)
   tspad->pad = pad;
   tspad->program_number = -1;
   tspad->program = NULL;
-  tspad->pushed = FALSE;
+  gst_byte_writer_init (&tspad->batch);
   tspad->flow_return = GST_FLOW_NOT_LINKED;
   gst_pad_set_element_private (pad, tspad);
 
@@ -291,6 +335,7 @@ static void
 mpegts_parse_destroy_tspad (MpegTSParse2 * parse, MpegTSParsePad * tspad)
 {
   /* free the wrapper */
+  gst_byte_writer_reset (&tspad->batch);
   g_free (tspad);
 }
 
@@ -304,16 +349,20 @@ mpegts_parse_pad_removed (GstElement * element, GstPad * pad)
   if (gst_pad_get_direction (pad) == GST_PAD_SINK)
     return;
 
+  GST_OBJECT_LOCK (parse);
   tspad = (MpegTSParsePad *) gst_pad_get_element_private (pad);
   if (tspad) {
+    gst_pad_set_element_private (pad, NULL);
     mpegts_parse_destroy_tspad (parse, tspad);
 
     parse->srcpads = g_list_remove_all (parse->srcpads, pad);
+    parse->pid_pads_dirty = TRUE;
   }
   if (parse->srcpads == NULL) {
     base->push_data = FALSE;
     base->push_section = FALSE;
   }
+  GST_OBJECT_UNLOCK (parse);
 
   if (GST_ELEMENT_CLASS (parent_class)->pad_removed)
     GST_ELEMENT_CLASS (parent_class)->pad_removed (element, pad);
@@ -355,9 +404,12 @@ mpegts_parse_request_new_pad (GstElement * element, GstPadTemplate * template,
   }
 
   pad = tspad->pad;
+  GST_OBJECT_LOCK (parse);
   parse->srcpads = g_list_append (parse->srcpads, pad);
+  parse->pid_pads_dirty = TRUE;
   base->push_data = TRUE;
   base->push_section = TRUE;
+  GST_OBJECT_UNLOCK (parse);
 
   gst_pad_set_active (pad, TRUE);
 
@@ -396,11 +448,10 @@ mpegts_parse_release_pad (GstElement * element, GstPad * pad)
   gst_element_remove_pad (element, pad);
 }
 
-static GstFlowReturn
-mpegts_parse_tspad_push_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
-    GstMpegTsSection * section, MpegTSPacketizerPacket * packet)
+static gboolean
+mpegts_parse_tspad_want_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
+    GstMpegTsSection * section)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
   gboolean to_push = TRUE;
 
   if (tspad->program_number != -1) {
@@ -423,55 +474,69 @@ mpegts_parse_tspad_push_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
       "pushing section: %d program number: %d table_id: %d", to_push,
       tspad->program_number, section->table_id);
 
-  if (to_push) {
-    GstBuffer *buf =
-        gst_buffer_new_and_alloc (packet->data_end - packet->data_start);
-    gst_buffer_fill (buf, 0, packet->data_start,
-        packet->data_end - packet->data_start);
-    ret = gst_pad_push (tspad->pad, buf);
-  }
-
-  return ret;
+  return to_push;
 }
 
-static GstFlowReturn
-mpegts_parse_tspad_push (MpegTSParse2 * parse, MpegTSParsePad * tspad,
-    MpegTSPacketizerPacket * packet)
+/* Rebuild the PID => pads table, called with the object lock */
+static void
+mpegts_parse_update_pid_pads (MpegTSParse2 * parse)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  MpegTSBaseStream **pad_pids = NULL;
+  GList *tmp, *stmp;
+  guint i;
 
-  if (tspad->program_number != -1) {
-    if (tspad->program) {
-      MpegTSBaseProgram *bp = (MpegTSBaseProgram *) tspad->program;
-      pad_pids = bp->streams;
-    } else {
-      /* there's a program filter on the pad but the PMT for the program has not
-       * been parsed yet, ignore the pad until we get a PMT */
-      goto out;
-    }
+  for (i = 0; i < 0x2000; i++) {
+    if (parse->pid_pads[i])
+      g_ptr_array_set_size (parse->pid_pads[i], 0);
   }
+  g_ptr_array_set_size (parse->all_pads, 0);
 
-  if (pad_pids == NULL || pad_pids[packet->pid]) {
-    GstBuffer *buf =
-        gst_buffer_new_and_alloc (packet->data_end - packet->data_start);
-    gst_buffer_fill (buf, 0, packet->data_start,
-        packet->data_end - packet->data_start);
-    /* push if there's no filter or if the pid is in the filter */
-    ret = gst_pad_push (tspad->pad, buf);
+  for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+    MpegTSParsePad *tspad = gst_pad_get_element_private ((GstPad *) tmp->data);
+    MpegTSBaseProgram *bp;
+
+    if (tspad->program_number == -1) {
+      g_ptr_array_add (parse->all_pads, tspad);
+      continue;
+    }
+
+    /* there's a program filter on the pad but the PMT for the program has not
+     * been parsed yet, ignore the pad until we get a PMT */
+    if (tspad->program == NULL)
+      continue;
+
+    bp = (MpegTSBaseProgram *) tspad->program;
+    for (stmp = bp->stream_list; stmp; stmp = stmp->next) {
+      MpegTSBaseStream *stream = (MpegTSBaseStream *) stmp->data;
+
+      if (parse->pid_pads[stream->pid] == NULL)
+        parse->pid_pads[stream->pid] = g_ptr_array_new ();
+      g_ptr_array_add (parse->pid_pads[stream->pid], tspad);
+    }
   }
 
-out:
-  return ret;
+  parse->pid_pads_dirty = FALSE;
 }
 
 static void
-pad_clear_for_push (GstPad * pad, MpegTSParse2 * parse)
+mpegts_parse_tspad_add_packet (MpegTSParse2 * parse, MpegTSParsePad * tspad,
+    MpegTSPacketizerPacket * packet)
 {
-  MpegTSParsePad *tspad = (MpegTSParsePad *) gst_pad_get_element_private (pad);
+  GstByteWriter *batch = &tspad->batch;
 
-  tspad->flow_return = GST_FLOW_NOT_LINKED;
-  tspad->pushed = FALSE;
+  /* Reserve room for all the packets of the input buffer at once */
+  if (gst_byte_writer_get_size (batch) == 0
+      && !gst_byte_writer_ensure_free_space (batch, tspad->batch_size_hint))
+    goto error;
+
+  if (!gst_byte_writer_put_data (batch, packet->data_start,
+          packet->data_end - packet->data_start))
+    goto error;
+
+  return;
+
+error:
+  GST_WARNING_OBJECT (parse, "could not queue packet for pad %s:%s",
+      GST_DEBUG_PAD_NAME (tspad->pad));
 }
 
 static GstFlowReturn
@@ -479,79 +544,113 @@ mpegts_parse_push (MpegTSBase * base, MpegTSPacketizerPacket * packet,
     GstMpegTsSection * section)
 {
   MpegTSParse2 *parse = (MpegTSParse2 *) base;
-  guint32 pads_cookie;
-  gboolean done = FALSE;
-  GstPad *pad = NULL;
   MpegTSParsePad *tspad;
-  GstFlowReturn ret;
-  GList *srcpads;
+  GPtrArray *pads;
+  GList *tmp;
+  guint i;
 
+  /* Packets are only collected here, they are pushed per pad once the whole
+   * input buffer has been parsed (see mpegts_parse_input_done) */
   GST_OBJECT_LOCK (parse);
-  srcpads = parse->srcpads;
+  if (G_UNLIKELY (parse->pid_pads_dirty))
+    mpegts_parse_update_pid_pads (parse);
+
+  if (section) {
+    for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+      tspad = gst_pad_get_element_private ((GstPad *) tmp->data);
+      if (mpegts_parse_tspad_want_section (parse, tspad, section))
+        mpegts_parse_tspad_add_packet (parse, tspad, packet);
+    }
+  } else {
+    /* push if there's no filter or if the pid is in the filter */
+    for (i = 0; i < parse->all_pads->len; i++)
+      mpegts_parse_tspad_add_packet (parse,
+          g_ptr_array_index (parse->all_pads, i), packet);
+
+    pads = parse->pid_pads[packet->pid];
+    if (pads) {
+      for (i = 0; i < pads->len; i++)
+        mpegts_parse_tspad_add_packet (parse, g_ptr_array_index (pads, i),
+            packet);
+    }
+  }
+  GST_OBJECT_UNLOCK (parse);
 
-  /* clear tspad->pushed on pads */
-  g_list_foreach (srcpads, (GFunc) pad_clear_for_push, parse);
-  if (srcpads)
-    ret = GST_FLOW_NOT_LINKED;
-  else
-    ret = GST_FLOW_OK;
+  return GST_FLOW_OK;
+}
+
+typedef struct
+{
+  GstPad *pad;
+  GstBuffer *buffer;
+} MpegTSParseBatch;
+
+/* Push the packets collected for each request pad */
+static GstFlowReturn
+mpegts_parse_push_batches (MpegTSParse2 * parse)
+{
+  MpegTSParseBatch *batches;
+  MpegTSParsePad *tspad;
+  GstFlowReturn ret;
+  guint i, n_pads, n_batches = 0;
+  GList *tmp;
+
+  GST_OBJECT_LOCK (parse);
+  n_pads = g_list_length (parse->srcpads);
+  if (n_pads == 0) {
+    GST_OBJECT_UNLOCK (parse);
+    return GST_FLOW_OK;
+  }
 
-  /* Get cookie and source pads list */
-  pads_cookie = GST_ELEMENT_CAST (parse)->pads_cookie;
-  if (G_LIKELY (srcpads)) {
-    pad = GST_PAD_CAST (srcpads->data);
-    g_object_ref (pad);
+  batches = g_newa (MpegTSParseBatch, n_pads);
+  for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+    tspad = gst_pad_get_element_private ((GstPad *) tmp->data);
+    tspad->batch_size_hint = gst_byte_writer_get_size (&tspad->batch);
+    if (tspad->batch_size_hint == 0)
+      continue;
+
+    batches[n_batches].pad = gst_object_ref (tspad->pad);
+    batches[n_batches].buffer =
+        gst_byte_writer_reset_and_get_buffer (&tspad->batch);
+    gst_byte_writer_init (&tspad->batch);
+    n_batches++;
   }
   GST_OBJECT_UNLOCK (parse);
 
-  while (pad && !done) {
-    tspad = gst_pad_get_element_private (pad);
+  ret = GST_FLOW_NOT_LINKED;
+  for (i = 0; i < n_batches; i++) {
+    GstFlowReturn pad_ret;
 
-    if (G_LIKELY (!tspad->pushed)) {
-      if (section) {
-        tspad->flow_return =
-            mpegts_parse_tspad_push_section (parse, tspad, section, packet);
-      } else {
-        tspad->flow_return = mpegts_parse_tspad_push (parse, tspad, packet);
-      }
-      tspad->pushed = TRUE;
+    if (G_UNLIKELY (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED)) {
+      /* an error happened on a previous pad, just drop the rest */
+      gst_buffer_unref (batches[i].buffer);
+      gst_object_unref (batches[i].pad);
+      continue;
+    }
 
-      if (G_UNLIKELY (tspad->flow_return != GST_FLOW_OK
-              && tspad->flow_return != GST_FLOW_NOT_LINKED)) {
-        /* return the error upstream */
-        ret = tspad->flow_return;
-        done = TRUE;
-      }
+    GST_LOG_OBJECT (parse, "pushing %" G_GSIZE_FORMAT " bytes on %s:%s",
+        gst_buffer_get_size (batches[i].buffer),
+        GST_DEBUG_PAD_NAME (batches[i].pad));
 
-    }
+    pad_ret = gst_pad_push (batches[i].pad, batches[i].buffer);
 
-    if (ret == GST_FLOW_NOT_LINKED)
-      ret = tspad->flow_return;
-
-    g_object_unref (pad);
-
-    if (G_UNLIKELY (!done)) {
-      GST_OBJECT_LOCK (parse);
-      if (G_UNLIKELY (pads_cookie != GST_ELEMENT_CAST (parse)->pads_cookie)) {
-        /* resync */
-        GST_DEBUG ("resync");
-        pads_cookie = GST_ELEMENT_CAST (parse)->pads_cookie;
-        srcpads = parse->srcpads;
-      } else {
-        GST_DEBUG ("getting next pad");
-        /* Get next pad */
-        srcpads = g_list_next (srcpads);
-      }
+    GST_OBJECT_LOCK (parse);
+    tspad = gst_pad_get_element_private (batches[i].pad);
+    if (tspad)
+      tspad->flow_return = pad_ret;
+    GST_OBJECT_UNLOCK (parse);
+    gst_object_unref (batches[i].pad);
 
-      if (srcpads) {
-        pad = GST_PAD_CAST (srcpads->data);
-        g_object_ref (pad);
-      } else
-        done = TRUE;
-      GST_OBJECT_UNLOCK (parse);
-    }
+    /* return errors upstream, and NOT_LINKED only if no pad is linked */
+    if (ret == GST_FLOW_NOT_LINKED || (pad_ret != GST_FLOW_OK
+            && pad_ret != GST_FLOW_NOT_LINKED))
+      ret = pad_ret;
   }
 
+  /* pads that didn't get any data this time don't count as not linked */
+  if (n_batches < n_pads && ret == GST_FLOW_NOT_LINKED)
+    ret = GST_FLOW_OK;
+
   return ret;
 }
 
@@ -559,10 +658,18 @@ static GstFlowReturn
 mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
 {
   MpegTSParse2 *parse = GST_MPEGTS_PARSE (base);
+  GstFlowReturn ret;
 
   if (G_UNLIKELY (parse->first))
     prepare_src_pad (base, parse);
 
+  ret = mpegts_parse_push_batches (parse);
+
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
   return gst_pad_push (parse->srcpad, buffer);
 }
 
@@ -589,12 +696,15 @@ mpegts_parse_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
   MpegTSParsePad *tspad;
 
   /* If we have a request pad for that program, activate it */
+  GST_OBJECT_LOCK (parse);
   tspad = find_pad_for_program (parse, program->program_number);
 
   if (tspad) {
     tspad->program = parseprogram;
     parseprogram->tspad = tspad;
   }
+  parse->pid_pads_dirty = TRUE;
+  GST_OBJECT_UNLOCK (parse);
 }
 
 static void
@@ -605,12 +715,15 @@ mpegts_parse_program_stopped (MpegTSBase * base, MpegTSBaseProgram * program)
   MpegTSParsePad *tspad;
 
   /* If we have a request pad for that program, activate it */
+  GST_OBJECT_LOCK (parse);
   tspad = find_pad_for_program (parse, program->program_number);
 
   if (tspad) {
     tspad->program = NULL;
     parseprogram->tspad = NULL;
   }
+  parse->pid_pads_dirty = TRUE;
+  GST_OBJECT_UNLOCK (parse);
 }
 
 static gboolean
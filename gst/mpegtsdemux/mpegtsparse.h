@@ -56,6 +56,13 @@ struct _MpegTSParse2 {
 
   GList *srcpads;
 
+  /* PID => request pads that want the PES packets of that PID, and pads
+   * without program filter which want all of them. Rebuilt from srcpads
+   * when pads or programs change. Protected by the object lock */
+  GPtrArray **pid_pads;
+  GPtrArray *all_pads;
+  gboolean pid_pads_dirty;
+
   /* state */
   gboolean first;
 };
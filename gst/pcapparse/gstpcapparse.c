@@ -20,11 +20,18 @@
 /**
  * SECTION:element-pcapparse
  *
- * Extracts payloads from Ethernet-encapsulated IP packets.
+ * Extracts payloads from Ethernet-encapsulated IP packets of pcap and
+ * pcapng captures.
  * Use #GstPcapParse:src-ip, #GstPcapParse:dst-ip,
  * #GstPcapParse:src-port and #GstPcapParse:dst-port to restrict which packets
  * should be included.
  *
+ * With #GstPcapParse:split-flows, the payloads of every UDP or TCP flow go
+ * to their own src_%u pad instead, the stream-id of the pad names the flow.
+ * The payloads are pushed as sub-buffers of the input. When upstream
+ * supports it, the capture is pulled in large blocks and
+ * #GstPcapParse:pace can push the packets at the pace they were captured.
+ *
  * <refsect2>
  * <title>Example pipelines</title>
  * |[
@@ -32,6 +39,10 @@
  * ! ffdec_h264 ! fakesink
  * ]| Read from a pcap dump file using filesrc, extract the raw UDP packets,
  * depayload and decode them.
+ * |[
+ * gst-launch-1.0 filesrc location=feeds.pcapng ! pcapparse split-flows=true
+ * pace=true name=p p.src_0 ! udpsink port=5000 p.src_1 ! udpsink port=5002
+ * ]| Replay the first two flows of a capture at the capture pace.
  * </refsect2>
  */
 
@@ -65,9 +76,17 @@ enum
   PROP_DST_PORT,
   PROP_CAPS,
   PROP_TS_OFFSET,
+  PROP_SPLIT_FLOWS,
+  PROP_PACE,
   PROP_LAST
 };
 
+#define DEFAULT_SPLIT_FLOWS FALSE
+#define DEFAULT_PACE FALSE
+
+/* size of the reads in pull mode */
+#define PULL_BLOCK_SIZE (1024 * 1024)
+
 GST_DEBUG_CATEGORY_STATIC (gst_pcap_parse_debug);
 #define GST_CAT_DEFAULT gst_pcap_parse_debug
 
@@ -81,22 +100,55 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate flow_src_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS_ANY);
+
 static void gst_pcap_parse_finalize (GObject * object);
 static void gst_pcap_parse_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 static void gst_pcap_parse_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 
+static GstStateChangeReturn gst_pcap_parse_change_state (GstElement *
+    element, GstStateChange transition);
+
 static void gst_pcap_parse_reset (GstPcapParse * self);
 
 static GstFlowReturn gst_pcap_parse_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
 static gboolean gst_pcap_sink_event (GstPad * pad,
     GstObject * parent, GstEvent * event);
+static gboolean gst_pcap_parse_sink_activate (GstPad * sinkpad,
+    GstObject * parent);
+static gboolean gst_pcap_parse_sink_activate_mode (GstPad * pad,
+    GstObject * parent, GstPadMode mode, gboolean active);
 
 #define parent_class gst_pcap_parse_parent_class
 G_DEFINE_TYPE (GstPcapParse, gst_pcap_parse, GST_TYPE_ELEMENT);
 
+static guint
+gst_pcap_parse_flow_key_hash (gconstpointer v)
+{
+  const GstPcapParseFlowKey *key = v;
+
+  return key->src_ip ^ (key->dst_ip * 31) ^
+      ((key->src_port << 16) | key->dst_port) ^ key->protocol;
+}
+
+static gboolean
+gst_pcap_parse_flow_key_equal (gconstpointer a, gconstpointer b)
+{
+  const GstPcapParseFlowKey *ka = a;
+  const GstPcapParseFlowKey *kb = b;
+
+  return ka->src_ip == kb->src_ip && ka->dst_ip == kb->dst_ip &&
+      ka->src_port == kb->src_port && ka->dst_port == kb->dst_port &&
+      ka->protocol == kb->protocol;
+}
+
 static void
 gst_pcap_parse_class_init (GstPcapParseClass * klass)
 {
@@ -137,10 +189,25 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
           "Relative timestamp offset (ns) to apply (-1 = use absolute packet time)",
           -1, G_MAXINT64, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_SPLIT_FLOWS,
+      g_param_spec_boolean ("split-flows", "Split flows",
+          "Output every source/destination IP:port and protocol flow on its "
+          "own src_%u pad", DEFAULT_SPLIT_FLOWS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PACE,
+      g_param_spec_boolean ("pace", "Pace",
+          "Push the packets at the pace of their capture timestamps",
+          DEFAULT_PACE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_pcap_parse_change_state);
+
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&sink_template));
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&src_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&flow_src_template));
 
   gst_element_class_set_static_metadata (element_class, "PCapParse",
       "Raw/Parser",
@@ -159,6 +226,10 @@ gst_pcap_parse_init (GstPcapParse * self)
   gst_pad_use_fixed_caps (self->sink_pad);
   gst_pad_set_event_function (self->sink_pad,
       GST_DEBUG_FUNCPTR (gst_pcap_sink_event));
+  gst_pad_set_activate_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate));
+  gst_pad_set_activatemode_function (self->sink_pad,
+      GST_DEBUG_FUNCPTR (gst_pcap_parse_sink_activate_mode));
   gst_element_add_pad (GST_ELEMENT (self), self->sink_pad);
 
   self->src_pad = gst_pad_new_from_static_template (&src_template, "src");
@@ -170,8 +241,15 @@ gst_pcap_parse_init (GstPcapParse * self)
   self->src_port = -1;
   self->dst_port = -1;
   self->offset = -1;
+  self->split_flows = DEFAULT_SPLIT_FLOWS;
+  self->pace = DEFAULT_PACE;
 
   self->adapter = gst_adapter_new ();
+  self->interfaces = g_array_new (FALSE, FALSE,
+      sizeof (GstPcapParseInterface));
+  self->flows = g_hash_table_new (gst_pcap_parse_flow_key_hash,
+      gst_pcap_parse_flow_key_equal);
+  g_cond_init (&self->pace_cond);
 
   gst_pcap_parse_reset (self);
 }
@@ -182,6 +260,9 @@ gst_pcap_parse_finalize (GObject * object)
   GstPcapParse *self = GST_PCAP_PARSE (object);
 
   g_object_unref (self->adapter);
+  g_array_free (self->interfaces, TRUE);
+  g_hash_table_destroy (self->flows);
+  g_cond_clear (&self->pace_cond);
   if (self->caps)
     gst_caps_unref (self->caps);
 
@@ -243,6 +324,14 @@ gst_pcap_parse_get_property (GObject * object, guint prop_id,
       g_value_set_int64 (value, self->offset);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      g_value_set_boolean (value, self->split_flows);
+      break;
+
+    case PROP_PACE:
+      g_value_set_boolean (value, self->pace);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -297,6 +386,14 @@ gst_pcap_parse_set_property (GObject * object, guint prop_id,
       self->offset = g_value_get_int64 (value);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      self->split_flows = g_value_get_boolean (value);
+      break;
+
+    case PROP_PACE:
+      self->pace = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -307,7 +404,9 @@ static void
 gst_pcap_parse_reset (GstPcapParse * self)
 {
   self->initialized = FALSE;
+  self->pcapng = FALSE;
   self->swap_endian = FALSE;
+  self->nanosecond_ts = FALSE;
   self->cur_packet_size = -1;
   self->buffer_offset = 0;
   self->cur_ts = GST_CLOCK_TIME_NONE;
@@ -315,6 +414,61 @@ gst_pcap_parse_reset (GstPcapParse * self)
   self->newsegment_sent = FALSE;
 
   gst_adapter_clear (self->adapter);
+  g_array_set_size (self->interfaces, 0);
+}
+
+static void
+gst_pcap_parse_remove_flows (GstPcapParse * self)
+{
+  GList *flows, *l;
+
+  GST_OBJECT_LOCK (self);
+  flows = g_hash_table_get_values (self->flows);
+  g_hash_table_remove_all (self->flows);
+  self->n_flows = 0;
+  GST_OBJECT_UNLOCK (self);
+
+  for (l = flows; l; l = l->next) {
+    GstPcapParseFlow *flow = l->data;
+
+    gst_element_remove_pad (GST_ELEMENT (self), flow->pad);
+    g_slice_free (GstPcapParseFlow, flow);
+  }
+  g_list_free (flows);
+}
+
+/* pushes @event on the src pad and on the pads of all flows. The events
+ * come from other threads than the streaming thread adding the flows, so
+ * the pads are collected under the lock and the events pushed outside. */
+static gboolean
+gst_pcap_parse_push_event (GstPcapParse * self, GstEvent * event)
+{
+  GHashTableIter iter;
+  GstPcapParseFlow *flow;
+  GList *pads = NULL, *l;
+
+  GST_OBJECT_LOCK (self);
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow))
+    pads = g_list_prepend (pads, gst_object_ref (flow->pad));
+  GST_OBJECT_UNLOCK (self);
+
+  for (l = pads; l; l = l->next)
+    gst_pad_push_event (l->data, gst_event_ref (event));
+  g_list_free_full (pads, (GDestroyNotify) gst_object_unref);
+
+  return gst_pad_push_event (self->src_pad, event);
+}
+
+static guint16
+gst_pcap_parse_read_uint16 (GstPcapParse * self, const guint8 * p)
+{
+  guint16 val = *((guint16 *) p);
+
+  if (self->swap_endian)
+    return GUINT16_SWAP_LE_BE (val);
+  else
+    return val;
 }
 
 static guint32
@@ -341,11 +495,22 @@ gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 #define IP_PROTO_UDP      17
 #define IP_PROTO_TCP      6
 
+/* pcapng block types */
+#define PCAPNG_SECTION_HEADER         0x0a0d0d0a
+#define PCAPNG_INTERFACE_DESCRIPTION  0x00000001
+#define PCAPNG_SIMPLE_PACKET          0x00000003
+#define PCAPNG_ENHANCED_PACKET        0x00000006
+
+#define PCAPNG_BYTE_ORDER_MAGIC       0x1a2b3c4d
+
+#define PCAPNG_OPT_END                0
+#define PCAPNG_OPT_IF_TSRESOL         9
+
 
 static gboolean
-gst_pcap_parse_scan_frame (GstPcapParse * self,
-    const guint8 * buf,
-    gint buf_size, const guint8 ** payload, gint * payload_size)
+gst_pcap_parse_scan_frame (GstPcapParse * self, guint linktype,
+    const guint8 * buf, gint buf_size, const guint8 ** payload,
+    gint * payload_size, GstPcapParseFlowKey * key)
 {
   const guint8 *buf_ip = 0;
   const guint8 *buf_proto;
@@ -359,7 +524,7 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   guint16 dst_port;
   guint16 len;
 
-  switch (self->linktype) {
+  switch (linktype) {
     case DLT_ETHER:
       if (buf_size < ETH_HEADER_LEN + IP_HEADER_MIN_LEN + UDP_HEADER_LEN)
         return FALSE;
@@ -421,9 +586,15 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
 
     /* all remaining data following tcp header is payload */
     *payload = buf_proto + len;
-    *payload_size = self->cur_packet_size - (buf_proto - buf) - len;
+    *payload_size = buf_size - (buf_proto - buf) - len;
   }
 
+  key->src_ip = ip_src_addr;
+  key->dst_ip = ip_dst_addr;
+  key->src_port = src_port;
+  key->dst_port = dst_port;
+  key->protocol = ip_protocol;
+
   /* but still filter as configured */
   if (self->src_ip >= 0 && ip_src_addr != self->src_ip)
     return FALSE;
@@ -440,10 +611,294 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   return TRUE;
 }
 
+/* the segment starts at the first packet, the flows share it */
+static void
+gst_pcap_parse_start_segment (GstPcapParse * self)
+{
+  gst_segment_init (&self->segment, GST_FORMAT_TIME);
+  if (GST_CLOCK_TIME_IS_VALID (self->cur_ts))
+    self->segment.start = self->cur_ts;
+  self->newsegment_sent = TRUE;
+
+  if (!self->split_flows) {
+    if (self->caps)
+      gst_pad_set_caps (self->src_pad, self->caps);
+    gst_pad_push_event (self->src_pad, gst_event_new_segment (&self->segment));
+  }
+}
+
+static GstPcapParseFlow *
+gst_pcap_parse_get_flow (GstPcapParse * self, const GstPcapParseFlowKey * key)
+{
+  GstPcapParseFlow *flow;
+  gchar *name, *src_ip, *stream_id;
+
+  flow = g_hash_table_lookup (self->flows, key);
+  if (flow)
+    return flow;
+
+  flow = g_slice_new0 (GstPcapParseFlow);
+  flow->key = *key;
+  flow->last_ret = GST_FLOW_OK;
+
+  name = g_strdup_printf ("src_%u", self->n_flows++);
+  flow->pad = gst_pad_new_from_static_template (&flow_src_template, name);
+  g_free (name);
+  gst_pad_use_fixed_caps (flow->pad);
+  gst_pad_set_active (flow->pad, TRUE);
+
+  /* the stream-id tells the application which flow the pad is for */
+  src_ip = g_strdup (get_ip_address_as_string (key->src_ip));
+  stream_id = gst_pad_create_stream_id_printf (flow->pad,
+      GST_ELEMENT_CAST (self), "%s:%u-%s:%u/%u", src_ip, key->src_port,
+      get_ip_address_as_string (key->dst_ip), key->dst_port, key->protocol);
+  g_free (src_ip);
+
+  GST_DEBUG_OBJECT (self, "new flow %s on pad %s", stream_id,
+      GST_PAD_NAME (flow->pad));
+
+  gst_pad_push_event (flow->pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+  if (self->caps)
+    gst_pad_set_caps (flow->pad, self->caps);
+  gst_pad_push_event (flow->pad, gst_event_new_segment (&self->segment));
+
+  GST_OBJECT_LOCK (self);
+  g_hash_table_insert (self->flows, &flow->key, flow);
+  GST_OBJECT_UNLOCK (self);
+  gst_element_add_pad (GST_ELEMENT (self), flow->pad);
+
+  return flow;
+}
+
+/* unlinked flows are skipped, it is only an error if none is linked */
 static GstFlowReturn
-gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_pcap_parse_push_flow (GstPcapParse * self, GstPcapParseFlow * flow,
+    GstBuffer * buffer)
+{
+  GHashTableIter iter;
+  GstFlowReturn ret;
+
+  ret = flow->last_ret = gst_pad_push (flow->pad, buffer);
+  if (ret != GST_FLOW_NOT_LINKED)
+    return ret;
+
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow)) {
+    if (flow->last_ret != GST_FLOW_NOT_LINKED)
+      return GST_FLOW_OK;
+  }
+
+  return GST_FLOW_NOT_LINKED;
+}
+
+/* waits until the clock reaches the running time of @ts */
+static GstFlowReturn
+gst_pcap_parse_wait (GstPcapParse * self, GstClockTime ts)
+{
+  GstClock *clock;
+  GstClockID id;
+  GstClockReturn cret;
+
+  if (!GST_CLOCK_TIME_IS_VALID (ts) || ts < self->segment.start)
+    return GST_FLOW_OK;
+
+  GST_OBJECT_LOCK (self);
+  do {
+    /* the base time is only valid again once back in PLAYING */
+    while (self->paused && !self->flushing)
+      g_cond_wait (&self->pace_cond, GST_OBJECT_GET_LOCK (self));
+    if (self->flushing) {
+      GST_OBJECT_UNLOCK (self);
+      return GST_FLOW_FLUSHING;
+    }
+    clock = GST_ELEMENT_CLOCK (self);
+    if (clock == NULL) {
+      GST_OBJECT_UNLOCK (self);
+      return GST_FLOW_OK;
+    }
+    id = gst_clock_new_single_shot_id (clock,
+        GST_ELEMENT_CAST (self)->base_time + ts - self->segment.start);
+    self->clock_id = id;
+    GST_OBJECT_UNLOCK (self);
+
+    cret = gst_clock_id_wait (id, NULL);
+
+    GST_OBJECT_LOCK (self);
+    gst_clock_id_unref (id);
+    self->clock_id = NULL;
+    /* unscheduled when flushing or pausing, wait again with the new base
+     * time after pausing */
+  } while (cret == GST_CLOCK_UNSCHEDULED);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_FLOW_OK;
+}
+
+/* Pushes the payload of the packet at @offset in @buffer, mapped at @data,
+ * as a sub-buffer of @buffer */
+static GstFlowReturn
+gst_pcap_parse_handle_packet (GstPcapParse * self, GstBuffer * buffer,
+    const guint8 * data, gsize offset, gint size, guint linktype)
+{
+  GstPcapParseFlowKey key;
+  GstPcapParseFlow *flow = NULL;
+  const guint8 *payload_data;
+  gint payload_size;
+  GstBuffer *out_buf;
+  GstFlowReturn ret;
+
+  GST_LOG_OBJECT (self, "examining packet size %d", size);
+
+  if (!gst_pcap_parse_scan_frame (self, linktype, data + offset, size,
+          &payload_data, &payload_size, &key))
+    return GST_FLOW_OK;
+
+  if (GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
+    if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
+      self->base_ts = self->cur_ts;
+    if (self->offset >= 0) {
+      self->cur_ts -= self->base_ts;
+      self->cur_ts += self->offset;
+    }
+  }
+
+  if (!self->newsegment_sent)
+    gst_pcap_parse_start_segment (self);
+
+  if (self->split_flows)
+    flow = gst_pcap_parse_get_flow (self, &key);
+
+  if (self->pace) {
+    ret = gst_pcap_parse_wait (self, self->cur_ts);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
+  out_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY,
+      payload_data - data, payload_size);
+  GST_BUFFER_TIMESTAMP (out_buf) = self->cur_ts;
+
+  if (flow)
+    ret = gst_pcap_parse_push_flow (self, flow, out_buf);
+  else
+    ret = gst_pad_push (self->src_pad, out_buf);
+
+  self->buffer_offset += payload_size;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_handle_block (GstPcapParse * self, guint32 block_type,
+    GstBuffer * block)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstPcapParseInterface *iface;
+  GstMapInfo map;
+  const guint8 *data;
+  gsize size;
+
+  gst_buffer_map (block, &map, GST_MAP_READ);
+  data = map.data;
+  size = map.size;
+
+  switch (block_type) {
+    case PCAPNG_SECTION_HEADER:
+      /* the interfaces are numbered per section */
+      g_array_set_size (self->interfaces, 0);
+      break;
+    case PCAPNG_INTERFACE_DESCRIPTION:
+    {
+      GstPcapParseInterface new_iface;
+      gsize pos = 16;
+
+      if (size < 20)
+        break;
+
+      new_iface.linktype = gst_pcap_parse_read_uint16 (self, data + 8);
+      new_iface.ts_rate = 1000000;
+
+      while (pos + 4 <= size - 4) {
+        guint16 code = gst_pcap_parse_read_uint16 (self, data + pos);
+        guint16 len = gst_pcap_parse_read_uint16 (self, data + pos + 2);
+
+        if (code == PCAPNG_OPT_END || pos + 4 + len > size - 4)
+          break;
+
+        if (code == PCAPNG_OPT_IF_TSRESOL && len >= 1) {
+          guint8 resol = data[pos + 4];
+
+          /* negative power of 2 if the high bit is set, of 10 otherwise */
+          if (resol & 0x80) {
+            if ((resol & 0x7f) < 64)
+              new_iface.ts_rate = G_GUINT64_CONSTANT (1) << (resol & 0x7f);
+          } else if (resol <= 19) {
+            new_iface.ts_rate = 1;
+            while (resol--)
+              new_iface.ts_rate *= 10;
+          }
+        }
+        pos += 4 + GST_ROUND_UP_4 (len);
+      }
+
+      GST_DEBUG_OBJECT (self, "interface %u: linktype %u, %" G_GUINT64_FORMAT
+          " timestamp units per second", self->interfaces->len,
+          new_iface.linktype, new_iface.ts_rate);
+      g_array_append_val (self->interfaces, new_iface);
+      break;
+    }
+    case PCAPNG_ENHANCED_PACKET:
+    {
+      guint32 if_id, cap_len;
+      guint64 ts;
+
+      if (size < 32)
+        break;
+
+      if_id = gst_pcap_parse_read_uint32 (self, data + 8);
+      ts = ((guint64) gst_pcap_parse_read_uint32 (self, data + 12) << 32) |
+          gst_pcap_parse_read_uint32 (self, data + 16);
+      cap_len = gst_pcap_parse_read_uint32 (self, data + 20);
+
+      if (if_id >= self->interfaces->len || cap_len > size - 32) {
+        GST_WARNING_OBJECT (self, "invalid enhanced packet block");
+        break;
+      }
+
+      iface = &g_array_index (self->interfaces, GstPcapParseInterface, if_id);
+      self->cur_ts = gst_util_uint64_scale (ts, GST_SECOND, iface->ts_rate);
+      ret = gst_pcap_parse_handle_packet (self, block, data, 28, cap_len,
+          iface->linktype);
+      break;
+    }
+    case PCAPNG_SIMPLE_PACKET:
+    {
+      guint32 cap_len;
+
+      if (size < 16 || self->interfaces->len == 0)
+        break;
+
+      cap_len = MIN (gst_pcap_parse_read_uint32 (self, data + 8), size - 16);
+      iface = &g_array_index (self->interfaces, GstPcapParseInterface, 0);
+      self->cur_ts = GST_CLOCK_TIME_NONE;
+      ret = gst_pcap_parse_handle_packet (self, block, data, 12, cap_len,
+          iface->linktype);
+      break;
+    }
+    default:
+      GST_LOG_OBJECT (self, "skipping block type 0x%08x", block_type);
+      break;
+  }
+
+  gst_buffer_unmap (block, &map);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_process (GstPcapParse * self, GstBuffer * buffer)
 {
-  GstPcapParse *self = GST_PCAP_PARSE (parent);
   GstFlowReturn ret = GST_FLOW_OK;
 
   gst_adapter_push (self->adapter, buffer);
@@ -454,63 +909,66 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
     avail = gst_adapter_available (self->adapter);
 
-    if (self->initialized) {
+    if (self->initialized && self->pcapng) {
+      guint32 block_type;
+      guint32 block_len;
+      GstBuffer *block;
+
+      if (avail < 12)
+        break;
+
+      data = gst_adapter_map (self->adapter, 12);
+
+      block_type = gst_pcap_parse_read_uint32 (self, data);
+      if (block_type == PCAPNG_SECTION_HEADER) {
+        guint32 magic = *((guint32 *) (data + 8));
+
+        if (magic == PCAPNG_BYTE_ORDER_MAGIC) {
+          self->swap_endian = FALSE;
+        } else if (magic == GUINT32_SWAP_LE_BE (PCAPNG_BYTE_ORDER_MAGIC)) {
+          self->swap_endian = TRUE;
+        } else {
+          gst_adapter_unmap (self->adapter);
+          GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+              ("Invalid pcapng byte order magic %X", magic));
+          ret = GST_FLOW_ERROR;
+          goto out;
+        }
+      }
+      block_len = gst_pcap_parse_read_uint32 (self, data + 4);
+
+      gst_adapter_unmap (self->adapter);
+
+      if (block_len < 12 || block_len % 4 != 0) {
+        GST_ELEMENT_ERROR (self, STREAM, DECODE, (NULL),
+            ("Invalid pcapng block length %u", block_len));
+        ret = GST_FLOW_ERROR;
+        goto out;
+      }
+
+      if (avail < block_len)
+        break;
+
+      /* a sub-buffer of the input unless the block spans input buffers */
+      block = gst_adapter_take_buffer (self->adapter, block_len);
+      ret = gst_pcap_parse_handle_block (self, block_type, block);
+      gst_buffer_unref (block);
+    } else if (self->initialized) {
       if (self->cur_packet_size >= 0) {
         if (avail < self->cur_packet_size)
           break;
 
         if (self->cur_packet_size > 0) {
-          const guint8 *payload_data;
-          gint payload_size;
-
-          data = gst_adapter_map (self->adapter, self->cur_packet_size);
+          GstBuffer *packet;
+          GstMapInfo map;
 
-          GST_LOG_OBJECT (self, "examining packet size %" G_GINT64_FORMAT,
+          packet = gst_adapter_take_buffer (self->adapter,
               self->cur_packet_size);
-
-          if (gst_pcap_parse_scan_frame (self, data, self->cur_packet_size,
-                  &payload_data, &payload_size)) {
-            GstBuffer *out_buf;
-            GstMapInfo map;
-
-            out_buf = gst_buffer_new_and_alloc (payload_size);
-            if (out_buf) {
-
-              if (GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-                if (!GST_CLOCK_TIME_IS_VALID (self->base_ts))
-                  self->base_ts = self->cur_ts;
-                if (self->offset >= 0) {
-                  self->cur_ts -= self->base_ts;
-                  self->cur_ts += self->offset;
-                }
-              }
-
-              gst_buffer_map (out_buf, &map, GST_MAP_WRITE);
-              memcpy (map.data, payload_data, payload_size);
-              gst_buffer_unmap (out_buf, &map);
-              GST_BUFFER_TIMESTAMP (out_buf) = self->cur_ts;
-
-              if (!self->newsegment_sent &&
-                  GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-                GstSegment segment;
-
-                if (self->caps)
-                  gst_pad_set_caps (self->src_pad, self->caps);
-                gst_segment_init (&segment, GST_FORMAT_TIME);
-                segment.start = self->cur_ts;
-                gst_pad_push_event (self->src_pad,
-                    gst_event_new_segment (&segment));
-                self->newsegment_sent = TRUE;
-              }
-
-              ret = gst_pad_push (self->src_pad, out_buf);
-
-              self->buffer_offset += payload_size;
-            }
-          }
-
-          gst_adapter_unmap (self->adapter);
-          gst_adapter_flush (self->adapter, self->cur_packet_size);
+          gst_buffer_map (packet, &map, GST_MAP_READ);
+          ret = gst_pcap_parse_handle_packet (self, packet, map.data, 0,
+              map.size, self->linktype);
+          gst_buffer_unmap (packet, &map);
+          gst_buffer_unref (packet);
         }
 
         self->cur_packet_size = -1;
@@ -532,7 +990,9 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         gst_adapter_unmap (self->adapter);
         gst_adapter_flush (self->adapter, 16);
 
-        self->cur_ts = ts_sec * GST_SECOND + ts_usec * GST_USECOND;
+        /* the fraction is in nanoseconds in the nanosecond format */
+        self->cur_ts = ts_sec * GST_SECOND +
+            ts_usec * (self->nanosecond_ts ? 1 : GST_USECOND);
         self->cur_packet_size = incl_len;
       }
     } else {
@@ -540,27 +1000,43 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       guint32 linktype;
       guint16 major_version;
 
+      if (avail < 4)
+        break;
+
+      data = gst_adapter_map (self->adapter, 4);
+      magic = *((guint32 *) data);
+      gst_adapter_unmap (self->adapter);
+
+      /* the section header is handled as a block */
+      if (magic == PCAPNG_SECTION_HEADER) {
+        GST_DEBUG_OBJECT (self, "pcapng file");
+        self->pcapng = TRUE;
+        self->initialized = TRUE;
+        continue;
+      }
+
       if (avail < 24)
         break;
 
       data = gst_adapter_map (self->adapter, 24);
 
-      magic = *((guint32 *) data);
       major_version = *((guint16 *) (data + 4));
-      linktype = gst_pcap_parse_read_uint32 (self, data + 20);
+      linktype = *((guint32 *) (data + 20));
       gst_adapter_unmap (self->adapter);
 
-      if (magic == 0xa1b2c3d4) {
+      if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
         self->swap_endian = FALSE;
-      } else if (magic == 0xd4c3b2a1) {
+      } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
         self->swap_endian = TRUE;
         major_version = major_version << 8 | major_version >> 8;
+        linktype = GUINT32_SWAP_LE_BE (linktype);
       } else {
         GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
             ("File is not a libpcap file, magic is %X", magic));
         ret = GST_FLOW_ERROR;
         goto out;
       }
+      self->nanosecond_ts = magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
 
       if (major_version != 2) {
         GST_ELEMENT_ERROR (self, STREAM, WRONG_TYPE, (NULL),
@@ -592,6 +1068,178 @@ out:
   return ret;
 }
 
+static GstFlowReturn
+gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  return gst_pcap_parse_process (GST_PCAP_PARSE (parent), buffer);
+}
+
+static void
+gst_pcap_parse_loop (GstPad * pad)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (GST_PAD_PARENT (pad));
+  GstBuffer *buffer = NULL;
+  GstFlowReturn ret;
+
+  if (self->pull_offset == 0) {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id (self->src_pad,
+        GST_ELEMENT_CAST (self), NULL);
+    gst_pad_push_event (self->src_pad, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+  }
+
+  ret = gst_pad_pull_range (pad, self->pull_offset, PULL_BLOCK_SIZE, &buffer);
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  self->pull_offset += gst_buffer_get_size (buffer);
+
+  ret = gst_pcap_parse_process (self, buffer);
+  if (ret != GST_FLOW_OK)
+    goto pause;
+
+  return;
+
+pause:
+  {
+    const gchar *reason = gst_flow_get_name (ret);
+
+    GST_DEBUG_OBJECT (self, "pausing task, reason %s", reason);
+    gst_pad_pause_task (pad);
+    if (ret == GST_FLOW_EOS) {
+      gst_pcap_parse_push_event (self, gst_event_new_eos ());
+    } else if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Internal data flow error."),
+          ("streaming task paused, reason %s (%d)", reason, ret));
+      gst_pcap_parse_push_event (self, gst_event_new_eos ());
+    }
+  }
+}
+
+static gboolean
+gst_pcap_parse_sink_activate (GstPad * sinkpad, GstObject * parent)
+{
+  GstQuery *query;
+  gboolean pull_mode;
+
+  query = gst_query_new_scheduling ();
+
+  if (!gst_pad_peer_query (sinkpad, query)) {
+    gst_query_unref (query);
+    goto activate_push;
+  }
+
+  pull_mode = gst_query_has_scheduling_mode_with_flags (query,
+      GST_PAD_MODE_PULL, GST_SCHEDULING_FLAG_SEEKABLE);
+  gst_query_unref (query);
+
+  if (!pull_mode)
+    goto activate_push;
+
+  GST_DEBUG_OBJECT (sinkpad, "activating pull");
+  return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PULL, TRUE);
+
+activate_push:
+  {
+    GST_DEBUG_OBJECT (sinkpad, "activating push");
+    return gst_pad_activate_mode (sinkpad, GST_PAD_MODE_PUSH, TRUE);
+  }
+}
+
+static gboolean
+gst_pcap_parse_sink_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      res = TRUE;
+      break;
+    case GST_PAD_MODE_PULL:
+      if (active) {
+        self->pull_offset = 0;
+        res = gst_pad_start_task (pad, (GstTaskFunction) gst_pcap_parse_loop,
+            pad, NULL);
+      } else {
+        res = gst_pad_stop_task (pad);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+  return res;
+}
+
+static void
+gst_pcap_parse_set_flushing (GstPcapParse * self, gboolean flushing)
+{
+  GST_OBJECT_LOCK (self);
+  self->flushing = flushing;
+  if (flushing && self->clock_id)
+    gst_clock_id_unschedule (self->clock_id);
+  g_cond_broadcast (&self->pace_cond);
+  GST_OBJECT_UNLOCK (self);
+}
+
+/* the base time changes while paused, so a pending wait is cancelled when
+ * pausing and scheduled again with the new base time in PLAYING */
+static void
+gst_pcap_parse_set_paused (GstPcapParse * self, gboolean paused)
+{
+  GST_OBJECT_LOCK (self);
+  self->paused = paused;
+  if (paused && self->clock_id)
+    gst_clock_id_unschedule (self->clock_id);
+  g_cond_broadcast (&self->pace_cond);
+  GST_OBJECT_UNLOCK (self);
+}
+
+static GstStateChangeReturn
+gst_pcap_parse_change_state (GstElement * element, GstStateChange transition)
+{
+  GstPcapParse *self = GST_PCAP_PARSE (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_pcap_parse_set_paused (self, FALSE);
+      gst_pcap_parse_set_flushing (self, FALSE);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      /* the new base time is already set */
+      gst_pcap_parse_set_paused (self, FALSE);
+      break;
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      gst_pcap_parse_set_paused (self, TRUE);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* wake up the streaming thread if it is pacing */
+      gst_pcap_parse_set_flushing (self, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_pcap_parse_reset (self);
+      gst_pcap_parse_remove_flows (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 static gboolean
 gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -603,6 +1251,17 @@ gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       /* Drop it, we'll replace it with our own */
       gst_event_unref (event);
       break;
+    case GST_EVENT_FLUSH_START:
+      gst_pcap_parse_set_flushing (self, TRUE);
+      ret = gst_pcap_parse_push_event (self, event);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_pcap_parse_set_flushing (self, FALSE);
+      ret = gst_pcap_parse_push_event (self, event);
+      break;
+    case GST_EVENT_EOS:
+      ret = gst_pcap_parse_push_event (self, event);
+      break;
     default:
       ret = gst_pad_push_event (self->src_pad, event);
       break;
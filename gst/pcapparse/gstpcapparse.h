@@ -38,6 +38,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstPcapParse      GstPcapParse;
 typedef struct _GstPcapParseClass GstPcapParseClass;
+typedef struct _GstPcapParseFlow  GstPcapParseFlow;
 
 typedef enum
 {
@@ -51,6 +52,30 @@ typedef enum
   DLT_SLL = 113
 } GstPcapParseLinktype;
 
+/* the 5-tuple of a flow, addresses in network byte order */
+typedef struct
+{
+  guint32 src_ip;
+  guint32 dst_ip;
+  guint16 src_port;
+  guint16 dst_port;
+  guint8 protocol;
+} GstPcapParseFlowKey;
+
+struct _GstPcapParseFlow
+{
+  GstPcapParseFlowKey key;
+  GstPad *pad;
+  GstFlowReturn last_ret;
+};
+
+/* pcapng interface description */
+typedef struct
+{
+  guint16 linktype;
+  guint64 ts_rate;
+} GstPcapParseInterface;
+
 /**
  * GstPcapParse:
  *
@@ -72,19 +97,39 @@ struct _GstPcapParse
   gint32 dst_port;
   GstCaps *caps;
   gint64 offset;
+  gboolean split_flows;
+  gboolean pace;
 
   /* state */
   GstAdapter * adapter;
   gboolean initialized;
+  gboolean pcapng;
   gboolean swap_endian;
+  gboolean nanosecond_ts;
   gint64 cur_packet_size;
   GstClockTime cur_ts;
   GstClockTime base_ts;
   GstPcapParseLinktype linktype;
+  GArray *interfaces;
 
   gboolean newsegment_sent;
+  GstSegment segment;
 
   gint64 buffer_offset;
+
+  /* pull mode */
+  guint64 pull_offset;
+
+  /* pacing, protected by the object lock */
+  GstClockID clock_id;
+  gboolean flushing;
+  gboolean paused;
+  GCond pace_cond;
+
+  /* GstPcapParseFlow with a src_%u pad for each 5-tuple, added by the
+   * streaming thread, protected by the object lock */
+  GHashTable *flows;
+  guint n_flows;
 };
 
 struct _GstPcapParseClass
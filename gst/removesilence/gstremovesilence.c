@@ -23,6 +23,18 @@
  *
  * Removes all silence periods from an audio stream, dropping silence buffers.
  *
+ * The stream is analysed in blocks of 256 frames, which continue across
+ * buffers. Frames after the last complete block of a buffer keep the state
+ * of that block. Buffers that only contain silence are dropped, leading and
+ * trailing silent frames of the other buffers are cut off. With multiple
+ * channels, a block is considered voice as soon as one of the channels
+ * contains voice.
+ *
+ * Unless #GstRemoveSilence:silent is %TRUE, an element message named
+ * "removesilence" is posted on the bus at every transition, with a
+ * "silence_detected" or "silence_finished" field holding the stream time of
+ * the transition as a #guint64.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -45,6 +57,7 @@
 GST_DEBUG_CATEGORY_STATIC (gst_remove_silence_debug);
 #define GST_CAT_DEFAULT gst_remove_silence_debug
 #define DEFAULT_VAD_HYSTERESIS  480     /* 60 mseg */
+#define DEFAULT_SILENT          TRUE
 
 /* Filter signals and args */
 enum
@@ -57,7 +70,8 @@ enum
 {
   PROP_0,
   PROP_REMOVE,
-  PROP_HYSTERESIS
+  PROP_HYSTERESIS,
+  PROP_SILENT
 };
 
 
@@ -65,17 +79,19 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw, "
-        "format = (string) " GST_AUDIO_NE (S16) ", "
+        "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (S32) ", "
+        GST_AUDIO_NE (F32) " }, "
         "layout = (string) interleaved, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 1"));
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ]"));
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw, "
-        "format = (string) " GST_AUDIO_NE (S16) ", "
+        "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (S32) ", "
+        GST_AUDIO_NE (F32) " }, "
         "layout = (string) interleaved, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 1"));
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ]"));
 
 
 #define DEBUG_INIT(bla) \
@@ -90,8 +106,12 @@ static void gst_remove_silence_set_property (GObject * object, guint prop_id,
 static void gst_remove_silence_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
+static gboolean gst_remove_silence_set_caps (GstBaseTransform * base,
+    GstCaps * incaps, GstCaps * outcaps);
 static GstFlowReturn gst_remove_silence_transform_ip (GstBaseTransform * base,
     GstBuffer * buf);
+static gboolean gst_remove_silence_sink_event (GstBaseTransform * base,
+    GstEvent * event);
 static void gst_remove_silence_finalize (GObject * obj);
 static void gst_remove_silence_reset (GstRemoveSilence * filter);
 
@@ -122,6 +142,11 @@ gst_remove_silence_class_init (GstRemoveSilenceClass * klass)
           "Set the hysteresis (on samples) used on the internal VAD",
           1, G_MAXUINT64, DEFAULT_VAD_HYSTERESIS, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_SILENT,
+      g_param_spec_boolean ("silent", "Silent",
+          "Disable/enable bus message notifications for silence detected/finished",
+          DEFAULT_SILENT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "RemoveSilence",
       "Filter/Effect/Audio",
@@ -134,8 +159,12 @@ gst_remove_silence_class_init (GstRemoveSilenceClass * klass)
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&sink_template));
 
+  GST_BASE_TRANSFORM_CLASS (klass)->set_caps =
+      GST_DEBUG_FUNCPTR (gst_remove_silence_set_caps);
   GST_BASE_TRANSFORM_CLASS (klass)->transform_ip =
       GST_DEBUG_FUNCPTR (gst_remove_silence_transform_ip);
+  GST_BASE_TRANSFORM_CLASS (klass)->sink_event =
+      GST_DEBUG_FUNCPTR (gst_remove_silence_sink_event);
 }
 
 /* initialize the new element
@@ -148,6 +177,8 @@ gst_remove_silence_init (GstRemoveSilence * filter)
 {
   filter->vad = vad_new (DEFAULT_VAD_HYSTERESIS);
   filter->remove = FALSE;
+  filter->silent = DEFAULT_SILENT;
+  gst_audio_info_init (&filter->info);
 
   if (!filter->vad) {
     GST_DEBUG ("Error initializing VAD !!");
@@ -164,6 +195,7 @@ gst_remove_silence_reset (GstRemoveSilence * filter)
   if (filter->vad) {
     vad_reset (filter->vad);
   }
+  filter->state = VAD_SILENCE;
   GST_DEBUG ("VAD Reseted");
 }
 
@@ -174,6 +206,8 @@ gst_remove_silence_finalize (GObject * obj)
   GST_DEBUG ("Destroying VAD");
   vad_destroy (filter->vad);
   filter->vad = NULL;
+  g_free (filter->states);
+  filter->states = NULL;
   GST_DEBUG ("VAD Destroyed");
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
@@ -191,6 +225,9 @@ gst_remove_silence_set_property (GObject * object, guint prop_id,
     case PROP_HYSTERESIS:
       vad_set_hysteresis (filter->vad, g_value_get_uint64 (value));
       break;
+    case PROP_SILENT:
+      filter->silent = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -210,27 +247,165 @@ gst_remove_silence_get_property (GObject * object, guint prop_id,
     case PROP_HYSTERESIS:
       g_value_set_uint64 (value, vad_get_hysteresis (filter->vad));
       break;
+    case PROP_SILENT:
+      g_value_set_boolean (value, filter->silent);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static gboolean
+gst_remove_silence_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstRemoveSilence *filter = GST_REMOVE_SILENCE (trans);
+  GstAudioInfo info;
+  VADFormat format;
+
+  if (!gst_audio_info_from_caps (&info, incaps))
+    goto invalid_caps;
+
+  switch (GST_AUDIO_INFO_FORMAT (&info)) {
+    case GST_AUDIO_FORMAT_S16:
+      format = VAD_FORMAT_S16;
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      format = VAD_FORMAT_S32;
+      break;
+    case GST_AUDIO_FORMAT_F32:
+      format = VAD_FORMAT_F32;
+      break;
+    default:
+      goto invalid_caps;
+  }
+
+  GST_DEBUG_OBJECT (filter, "analysing %s with %d channels",
+      GST_AUDIO_INFO_NAME (&info), GST_AUDIO_INFO_CHANNELS (&info));
+
+  vad_set_format (filter->vad, format, GST_AUDIO_INFO_CHANNELS (&info));
+  filter->state = VAD_SILENCE;
+  filter->info = info;
+
+  return TRUE;
+
+invalid_caps:
+  {
+    GST_WARNING_OBJECT (filter, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+}
+
+static GstClockTime
+gst_remove_silence_frames_to_time (GstRemoveSilence * filter, guint64 frames)
+{
+  return gst_util_uint64_scale_int (frames, GST_SECOND,
+      GST_AUDIO_INFO_RATE (&filter->info));
+}
+
+static gboolean
+gst_remove_silence_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstRemoveSilence *filter = GST_REMOVE_SILENCE (trans);
+
+  /* the partial block belongs to the old position */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+    gst_remove_silence_reset (filter);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+/* @offset is the first frame of the block in @buf, negative if the block
+ * started in the previous buffer */
+static void
+gst_remove_silence_post_transition (GstRemoveSilence * filter,
+    GstBuffer * buf, gint offset, gint state)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM (filter);
+  GstClockTime ts = GST_BUFFER_PTS (buf);
+  GstStructure *s;
+
+  if (GST_CLOCK_TIME_IS_VALID (ts)) {
+    if (offset >= 0) {
+      ts += gst_remove_silence_frames_to_time (filter, offset);
+    } else {
+      GstClockTime diff = gst_remove_silence_frames_to_time (filter, -offset);
+
+      ts = ts > diff ? ts - diff : 0;
+    }
+    ts = gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME, ts);
+  }
+
+  GST_DEBUG_OBJECT (filter, "%s at %" GST_TIME_FORMAT,
+      state == VAD_SILENCE ? "Silence detected" : "Silence finished",
+      GST_TIME_ARGS (ts));
+
+  if (filter->silent)
+    return;
+
+  s = gst_structure_new ("removesilence",
+      state == VAD_SILENCE ? "silence_detected" : "silence_finished",
+      G_TYPE_UINT64, ts, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (filter),
+      gst_message_new_element (GST_OBJECT_CAST (filter), s));
+}
+
 static GstFlowReturn
 gst_remove_silence_transform_ip (GstBaseTransform * trans, GstBuffer * inbuf)
 {
   GstRemoveSilence *filter = NULL;
-  int frame_type;
+  gint n_frames, n_blocks, pending, bpf, i;
+  gint start, end;
   GstMapInfo map;
 
   filter = GST_REMOVE_SILENCE (trans);
 
+  bpf = GST_AUDIO_INFO_BPF (&filter->info);
+  if (G_UNLIKELY (bpf == 0))
+    return GST_FLOW_NOT_NEGOTIATED;
+
   gst_buffer_map (inbuf, &map, GST_MAP_READ);
-  frame_type =
-      vad_update (filter->vad, (gint16 *) map.data, map.size / sizeof (gint16));
+  n_frames = map.size / bpf;
+  /* block i starts at frame i * VAD_BLOCK_SIZE - pending of the buffer */
+  pending = vad_get_pending (filter->vad);
+  n_blocks = (pending + n_frames) / VAD_BLOCK_SIZE;
+  if (n_blocks > filter->n_states) {
+    g_free (filter->states);
+    filter->states = g_new (guint8, n_blocks);
+    filter->n_states = n_blocks;
+  }
+  n_blocks = vad_update (filter->vad, map.data, n_frames, filter->states);
   gst_buffer_unmap (inbuf, &map);
 
-  if (frame_type == VAD_SILENCE) {
+  /* range of voice frames */
+  start = end = -1;
+  for (i = 0; i < n_blocks; i++) {
+    gint offset = i * VAD_BLOCK_SIZE - pending;
+
+    if (filter->states[i] != filter->state) {
+      filter->state = filter->states[i];
+      gst_remove_silence_post_transition (filter, inbuf, offset,
+          filter->state);
+    }
+    if (filter->states[i] == VAD_VOICE) {
+      if (start < 0)
+        start = MAX (offset, 0);
+      end = offset + VAD_BLOCK_SIZE;
+    }
+  }
+  /* the frames of the incomplete block keep the current state */
+  if (filter->state == VAD_VOICE) {
+    gint offset = MAX (n_blocks * VAD_BLOCK_SIZE - pending, 0);
+
+    if (offset < n_frames) {
+      if (start < 0)
+        start = offset;
+      end = n_frames;
+    }
+  }
+
+  if (start < 0) {
 
     GST_DEBUG ("Silence detected");
 
@@ -239,6 +414,22 @@ gst_remove_silence_transform_ip (GstBaseTransform * trans, GstBuffer * inbuf)
       return GST_BASE_TRANSFORM_FLOW_DROPPED;
     }
 
+  } else if (filter->remove && (start > 0 || end < n_frames)) {
+    /* Cut the silent frames at both ends of the buffer */
+    GST_DEBUG_OBJECT (filter, "Keeping frames %d to %d of %d", start, end,
+        n_frames);
+
+    gst_buffer_resize (inbuf, start * bpf, (end - start) * bpf);
+    if (GST_BUFFER_PTS_IS_VALID (inbuf)) {
+      GST_BUFFER_PTS (inbuf) += gst_remove_silence_frames_to_time (filter,
+          start);
+      GST_BUFFER_DURATION (inbuf) =
+          gst_remove_silence_frames_to_time (filter, end - start);
+    }
+    if (GST_BUFFER_OFFSET_IS_VALID (inbuf)) {
+      GST_BUFFER_OFFSET (inbuf) += start;
+      GST_BUFFER_OFFSET_END (inbuf) = GST_BUFFER_OFFSET (inbuf) + end - start;
+    }
   }
 
   return GST_FLOW_OK;
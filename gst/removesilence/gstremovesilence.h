@@ -24,6 +24,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
 #include "vad_private.h"
 
 G_BEGIN_DECLS
@@ -43,6 +44,14 @@ typedef struct _GstRemoveSilence {
   GstBaseTransform parent;
   VADFilter* vad;
   gboolean remove;
+  gboolean silent;
+
+  GstAudioInfo info;
+  /* per block VAD decisions of the current buffer */
+  guint8 *states;
+  gint n_states;
+  /* state after the last block, to detect segment boundaries */
+  gint state;
 } GstRemoveSilence;
 
 typedef struct _GstRemoveSilenceClass {
@@ -22,69 +22,85 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <glib.h>
 #include "vad_private.h"
 
-#define VAD_POWER_ALPHA     0x0800      /* Q16 */
-#define VAD_POWER_THRESHOLD 0x000010C7  /* -60 dB (square wave) */
-#define VAD_ZCR_THRESHOLD   0
-#define VAD_BUFFER_SIZE     256
-
-
-union pgen
-{
-  guint64 a;
-  gpointer v;
-  guint64 *l;
-  guchar *b;
-  guint16 *w;
-  gint16 *s;
-};
-
-struct _cqueue_s
-{
-  union pgen base;
-  union pgen tail;
-  union pgen head;
-  gint size;
-};
-
-typedef struct _cqueue_s cqueue_t;
+/* The power estimate is a first order IIR on the squared, normalised samples
+ * with a per-sample smoothing factor of 1/32 (0x0800 in Q16). It is applied
+ * once per block on the mean power of the block, with the factor raised to
+ * the number of samples in the block. */
+#define VAD_POWER_ALPHA     (1.0 / 32.0)
+#define VAD_POWER_THRESHOLD 1e-6        /* -60 dB (square wave) */
 
 struct _vad_s
 {
-  gint16 vad_buffer[VAD_BUFFER_SIZE];
-  cqueue_t cqueue;
+  VADFormat format;
+  gint channels;
+  /* one block of deinterleaved, normalised samples per channel */
+  gfloat *block;
+  /* number of frames of the block received so far */
+  gint fill;
+  /* per channel power estimate and last sample of the previous block */
+  gdouble *power;
+  gfloat *last;
+  /* (1 - VAD_POWER_ALPHA) ^ n for all block lengths */
+  gdouble decay[VAD_BLOCK_SIZE + 1];
   gint vad_state;
   guint64 hysteresis;
   guint64 vad_samples;
-  guint64 vad_power;
-  long vad_zcr;
 };
 
 VADFilter *
 vad_new (guint64 hysteresis)
 {
-  VADFilter *vad = malloc (sizeof (VADFilter));
-  vad_reset (vad);
+  VADFilter *vad = g_new0 (VADFilter, 1);
+  gint i;
+
+  for (i = 0; i <= VAD_BLOCK_SIZE; i++)
+    vad->decay[i] = pow (1.0 - VAD_POWER_ALPHA, i);
+
+  vad_set_format (vad, VAD_FORMAT_S16, 1);
   vad->hysteresis = hysteresis;
   return vad;
 }
 
+void
+vad_set_format (VADFilter * p, VADFormat format, gint channels)
+{
+  g_return_if_fail (channels > 0);
+
+  if (p->channels != channels) {
+    g_free (p->block);
+    g_free (p->power);
+    g_free (p->last);
+    p->block = g_new (gfloat, channels * VAD_BLOCK_SIZE);
+    p->power = g_new (gdouble, channels);
+    p->last = g_new (gfloat, channels);
+    p->channels = channels;
+  }
+  p->format = format;
+
+  vad_reset (p);
+}
+
 void
 vad_reset (VADFilter * vad)
 {
-  memset (vad, 0, sizeof (*vad));
-  vad->cqueue.base.s = vad->vad_buffer;
-  vad->cqueue.tail.a = vad->cqueue.head.a = 0;
-  vad->cqueue.size = VAD_BUFFER_SIZE;
+  memset (vad->power, 0, sizeof (gdouble) * vad->channels);
+  memset (vad->last, 0, sizeof (gfloat) * vad->channels);
+  vad->vad_samples = 0;
   vad->vad_state = VAD_SILENCE;
+  vad->fill = 0;
 }
 
 void
 vad_destroy (VADFilter * p)
 {
-  free (p);
+  g_free (p->block);
+  g_free (p->power);
+  g_free (p->last);
+  g_free (p);
 }
 
 void
@@ -100,37 +116,110 @@ vad_get_hysteresis (struct _vad_s *p)
 }
 
 gint
-vad_update (struct _vad_s * p, gint16 * data, gint len)
+vad_get_pending (VADFilter * p)
 {
-  guint64 tail;
-  gint frame_type;
-  gint16 sample;
-  gint i;
+  return p->fill;
+}
 
-  for (i = 0; i < len; i++) {
-    p->vad_power = VAD_POWER_ALPHA * ((data[i] * data[i] >> 14) & 0xFFFF) +
-        (0xFFFF - VAD_POWER_ALPHA) * (p->vad_power >> 16) +
-        ((0xFFFF - VAD_POWER_ALPHA) * (p->vad_power & 0xFFFF) >> 16);
-    /* Update VAD buffer */
-    p->cqueue.base.s[p->cqueue.head.a] = data[i];
-    p->cqueue.head.a = (p->cqueue.head.a + 1) & (p->cqueue.size - 1);
-    if (p->cqueue.head.a == p->cqueue.tail.a)
-      p->cqueue.tail.a = (p->cqueue.tail.a + 1) & (p->cqueue.size - 1);
-  }
+#define DEINTERLEAVE(type, scale) \
+G_STMT_START { \
+  const type *in = (const type *) data; \
+  \
+  if (channels == 1) { \
+    gfloat *out = p->block + offset; \
+    \
+    for (i = 0; i < len; i++) \
+      out[i] = in[i] * (scale); \
+  } else { \
+    for (c = 0; c < channels; c++) { \
+      gfloat *out = p->block + c * VAD_BLOCK_SIZE + offset; \
+      \
+      for (i = 0; i < len; i++) \
+        out[i] = in[i * channels + c] * (scale); \
+    } \
+  } \
+} G_STMT_END
+
+/* Converts len frames to planar float in the range [-1.0, 1.0], at offset
+ * in the block */
+static void
+vad_deinterleave (VADFilter * p, gconstpointer data, gint offset, gint len)
+{
+  gint channels = p->channels;
+  gint i, c;
 
-  tail = p->cqueue.tail.a;
-  p->vad_zcr = 0;
-  for (;;) {
-    sample = p->cqueue.base.s[tail];
-    tail = (tail + 1) & (p->cqueue.size - 1);
-    if (tail == p->cqueue.head.a)
+  switch (p->format) {
+    case VAD_FORMAT_S16:
+      DEINTERLEAVE (gint16, 1.0f / 32768.0f);
+      break;
+    case VAD_FORMAT_S32:
+      DEINTERLEAVE (gint32, 1.0f / 2147483648.0f);
+      break;
+    case VAD_FORMAT_F32:
+      DEINTERLEAVE (gfloat, 1.0f);
       break;
-    p->vad_zcr +=
-        ((sample & 0x8000) != (p->cqueue.base.s[tail] & 0x8000)) ? 1 : -1;
   }
+}
+
+#undef DEINTERLEAVE
+
+/* Mean power and number of zero crossings of one channel of the block. The
+ * loops keep several independent accumulators so that the compiler can
+ * vectorize them without reassociating floating point sums. */
+static gdouble
+vad_block_stats (const gfloat * x, gint len, gfloat last, gint * crossings)
+{
+  gfloat acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+  gint zc[4] = { 0, 0, 0, 0 };
+  gint i, n;
+
+  n = len & ~3;
+  for (i = 0; i < n; i += 4) {
+    acc[0] += x[i] * x[i];
+    acc[1] += x[i + 1] * x[i + 1];
+    acc[2] += x[i + 2] * x[i + 2];
+    acc[3] += x[i + 3] * x[i + 3];
+  }
+  for (; i < len; i++)
+    acc[0] += x[i] * x[i];
+
+  zc[0] = (last < 0.0f) != (x[0] < 0.0f);
+  n = 1 + ((len - 1) & ~3);
+  for (i = 1; i < n; i += 4) {
+    zc[0] += (x[i - 1] < 0.0f) != (x[i] < 0.0f);
+    zc[1] += (x[i] < 0.0f) != (x[i + 1] < 0.0f);
+    zc[2] += (x[i + 1] < 0.0f) != (x[i + 2] < 0.0f);
+    zc[3] += (x[i + 2] < 0.0f) != (x[i + 3] < 0.0f);
+  }
+  for (; i < len; i++)
+    zc[0] += (x[i - 1] < 0.0f) != (x[i] < 0.0f);
+
+  *crossings = zc[0] + zc[1] + zc[2] + zc[3];
+  return ((gdouble) acc[0] + acc[1] + acc[2] + acc[3]) / len;
+}
+
+/* Runs one block of len frames, the block must already be deinterleaved */
+static gint
+vad_update_block (VADFilter * p, gint len)
+{
+  gdouble decay = p->decay[len];
+  gint frame_type = VAD_SILENCE;
+  gint c, crossings;
+  gdouble power;
+
+  for (c = 0; c < p->channels; c++) {
+    const gfloat *x = p->block + c * VAD_BLOCK_SIZE;
 
-  frame_type = (p->vad_power > VAD_POWER_THRESHOLD
-      && p->vad_zcr < VAD_ZCR_THRESHOLD) ? VAD_VOICE : VAD_SILENCE;
+    power = vad_block_stats (x, len, p->last[c], &crossings);
+    p->power[c] = decay * p->power[c] + (1.0 - decay) * power;
+    p->last[c] = x[len - 1];
+
+    /* Voice is loud enough and crosses zero less often than every other
+     * sample, which rules out most of the noise. Any voiced channel makes
+     * the whole block voiced. */
+    if (p->power[c] > VAD_POWER_THRESHOLD && crossings * 2 < len)
+      frame_type = VAD_VOICE;
+  }
 
   if (p->vad_state != frame_type) {
     /* Voice to silence transition */
@@ -150,3 +239,35 @@ vad_update (struct _vad_s * p, gint16 * data, gint len)
 
   return p->vad_state;
 }
+
+/* The frames that don't complete a block are kept for the next call, so
+ * that the decisions don't depend on how the stream is split in buffers.
+ * Returns the number of blocks completed, whose states are stored in
+ * states. */
+gint
+vad_update (struct _vad_s * p, gconstpointer data, gint n_frames,
+    guint8 * states)
+{
+  const guint8 *in = data;
+  gint stride = p->channels * (p->format == VAD_FORMAT_S16 ? 2 : 4);
+  gint n_blocks = 0, len;
+
+  while (n_frames > 0) {
+    len = MIN (n_frames, VAD_BLOCK_SIZE - p->fill);
+
+    vad_deinterleave (p, in, p->fill, len);
+    p->fill += len;
+    in += len * stride;
+    n_frames -= len;
+
+    if (p->fill == VAD_BLOCK_SIZE) {
+      vad_update_block (p, VAD_BLOCK_SIZE);
+      p->fill = 0;
+      if (states)
+        states[n_blocks] = p->vad_state;
+      n_blocks++;
+    }
+  }
+
+  return n_blocks;
+}
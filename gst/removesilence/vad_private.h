@@ -26,10 +26,22 @@
 #define VAD_SILENCE  0
 #define VAD_VOICE    1
 
+/* Number of frames the VAD takes a decision on at a time */
+#define VAD_BLOCK_SIZE 256
+
+typedef enum {
+  VAD_FORMAT_S16,
+  VAD_FORMAT_S32,
+  VAD_FORMAT_F32
+} VADFormat;
 
 typedef struct _vad_s VADFilter;
 
-gint vad_update(VADFilter *p, gint16 *data, gint len);
+gint vad_update(VADFilter *p, gconstpointer data, gint n_frames, guint8 *states);
+
+gint vad_get_pending(VADFilter *p);
+
+void vad_set_format(VADFilter *p, VADFormat format, gint channels);
 
 void vad_set_hysteresis(VADFilter *p, guint64 hysteresis);
 
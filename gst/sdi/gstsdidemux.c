@@ -64,23 +64,6 @@ enum
 
 /* pad templates */
 
-#define GST_VIDEO_CAPS_NTSC(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=480," \
-  "framerate=30000/1001,interlaced=TRUE,pixel-aspect-ratio=10/11," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-#define GST_VIDEO_CAPS_NTSC_WIDE(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=480," \
-  "framerate=30000/1001,interlaced=TRUE,pixel-aspect-ratio=40/33," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-#define GST_VIDEO_CAPS_PAL(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=576," \
-  "framerate=25/1,interlaced=TRUE,pixel-aspect-ratio=12/11," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-#define GST_VIDEO_CAPS_PAL_WIDE(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=576," \
-  "framerate=25/1,interlaced=TRUE,pixel-aspect-ratio=16/11," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-
 static GstStaticPadTemplate gst_sdi_demux_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -92,8 +75,7 @@ static GstStaticPadTemplate gst_sdi_demux_src_template =
     GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_NTSC ("UYVY") ";"
-        GST_VIDEO_CAPS_PAL ("UYVY"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_SDI ("{UYVY,v210}"))
     );
 
 /* class initialization */
@@ -153,7 +135,7 @@ gst_sdi_demux_init (GstSdiDemux * sdidemux, GstSdiDemuxClass * sdidemux_class)
       GST_DEBUG_FUNCPTR (gst_sdi_demux_src_getcaps));
   gst_element_add_pad (GST_ELEMENT (sdidemux), sdidemux->srcpad);
 
-
+  sdidemux->adapter = gst_adapter_new ();
 }
 
 void
@@ -185,9 +167,16 @@ gst_sdi_demux_get_property (GObject * object, guint property_id,
 void
 gst_sdi_demux_dispose (GObject * object)
 {
+  GstSdiDemux *sdidemux;
+
   g_return_if_fail (GST_IS_SDI_DEMUX (object));
+  sdidemux = GST_SDI_DEMUX (object);
 
   /* clean up as possible.  may be called multiple times */
+  if (sdidemux->output_buffer) {
+    gst_buffer_unref (sdidemux->output_buffer);
+    sdidemux->output_buffer = NULL;
+  }
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
@@ -198,6 +187,7 @@ gst_sdi_demux_finalize (GObject * object)
   g_return_if_fail (GST_IS_SDI_DEMUX (object));
 
   /* clean up object here */
+  g_object_unref (GST_SDI_DEMUX (object)->adapter);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -213,85 +203,99 @@ gst_sdi_demux_change_state (GstElement * element, GstStateChange transition)
 static GstCaps *
 gst_sdi_demux_src_getcaps (GstPad * pad)
 {
-  return gst_caps_from_string (GST_VIDEO_CAPS_NTSC ("UYVY"));
-}
+  GstSdiDemux *sdidemux;
+  GstCaps *caps;
 
-static void
-gst_sdi_demux_get_output_buffer (GstSdiDemux * sdidemux)
-{
-  sdidemux->output_buffer =
-      gst_buffer_new_and_alloc (720 * sdidemux->format->active_lines * 2);
-  gst_buffer_set_caps (sdidemux->output_buffer,
-      gst_caps_from_string (GST_VIDEO_CAPS_PAL ("UYVY")));
-  GST_BUFFER_TIMESTAMP (sdidemux->output_buffer) =
-      GST_SECOND * sdidemux->frame_number;
-  sdidemux->frame_number++;
+  sdidemux = GST_SDI_DEMUX (gst_pad_get_parent (pad));
+
+  if (sdidemux->format)
+    caps = gst_sdi_format_get_caps (sdidemux->format);
+  else
+    caps = gst_caps_copy (gst_pad_get_pad_template_caps (pad));
+
+  gst_object_unref (sdidemux);
+  return caps;
 }
 
-static guint32
-get_word10 (guint8 * ptr)
+static gboolean
+gst_sdi_demux_negotiate (GstSdiDemux * sdidemux)
 {
-  guint32 a;
+  GstCaps *caps, *peercaps;
+  GstStructure *s;
+
+  caps = gst_sdi_format_get_caps (sdidemux->format);
+  peercaps = gst_pad_peer_get_caps (sdidemux->srcpad);
+  if (peercaps) {
+    GstCaps *icaps = gst_caps_intersect (caps, peercaps);
 
-  a = (((ptr[0] >> 2) | (ptr[1] << 6)) & 0xff) << 24;
-  a |= (((ptr[1] >> 4) | (ptr[2] << 4)) & 0xff) << 16;
-  a |= (((ptr[2] >> 6) | (ptr[3] << 2)) & 0xff) << 8;
-  a |= ptr[4];
+    gst_caps_unref (caps);
+    gst_caps_unref (peercaps);
+    caps = icaps;
+  }
 
-  return a;
+  if (gst_caps_is_empty (caps)) {
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+
+  /* UYVY is preferred over v210 */
+  gst_caps_truncate (caps);
+  s = gst_caps_get_structure (caps, 0);
+  gst_structure_get_fourcc (s, "format", &sdidemux->fourcc);
+  sdidemux->stride =
+      gst_sdi_format_get_stride (sdidemux->format, sdidemux->fourcc);
+
+  GST_DEBUG_OBJECT (sdidemux, "negotiated %" GST_PTR_FORMAT, caps);
+  sdidemux->negotiated = gst_pad_set_caps (sdidemux->srcpad, caps);
+  gst_caps_unref (caps);
+
+  return sdidemux->negotiated;
 }
 
 static void
-line10_copy (guint8 * dest, guint8 * src, int n)
+gst_sdi_demux_get_output_buffer (GstSdiDemux * sdidemux)
 {
-  int i;
-  guint32 a;
-  for (i = 0; i < n; i++) {
-    a = get_word10 (src);
-    GST_WRITE_UINT32_BE (dest, a);
-    src += 5;
-    dest += 4;
-  }
+  GstSdiFormat *format = sdidemux->format;
 
+  sdidemux->output_buffer =
+      gst_buffer_new_and_alloc (sdidemux->stride * format->active_lines);
+  gst_buffer_set_caps (sdidemux->output_buffer,
+      GST_PAD_CAPS (sdidemux->srcpad));
+  GST_BUFFER_TIMESTAMP (sdidemux->output_buffer) =
+      gst_util_uint64_scale (sdidemux->frame_number,
+      format->fps_d * GST_SECOND, format->fps_n);
+  GST_BUFFER_DURATION (sdidemux->output_buffer) =
+      gst_util_uint64_scale (sdidemux->frame_number + 1,
+      format->fps_d * GST_SECOND, format->fps_n) -
+      GST_BUFFER_TIMESTAMP (sdidemux->output_buffer);
+  sdidemux->frame_number++;
 }
 
-
 static GstFlowReturn
-copy_line (GstSdiDemux * sdidemux, guint8 * line)
+copy_line (GstSdiDemux * sdidemux, const guint8 * line)
 {
-  guint8 *output_data;
   GstFlowReturn ret = GST_FLOW_OK;
   GstSdiFormat *format = sdidemux->format;
-
-  output_data = GST_BUFFER_DATA (sdidemux->output_buffer);
-
-  /* line is one less than the video line */
-  if (sdidemux->line >= format->start0 - 1 &&
-      sdidemux->line < format->start0 - 1 + format->active_lines / 2) {
-#if 0
-    memcpy (output_data + 720 * 2 * ((sdidemux->line -
-                (format->start0 - 1)) * 2 + (!format->tff)),
-        line + (format->width - 720) * 2, 720 * 2);
-#else
-    line10_copy (output_data + 720 * 2 * ((sdidemux->line -
-                (format->start0 - 1)) * 2 + (!format->tff)),
-        line + (format->width - 720) / 2 * 5, 720 / 2);
-#endif
-  }
-  if (sdidemux->line >= format->start1 - 1 &&
-      sdidemux->line < format->start1 - 1 + format->active_lines / 2) {
-#if 0
-    memcpy (output_data + 720 * 2 * ((sdidemux->line -
-                (format->start1 - 1)) * 2 + (format->tff)),
-        line + (format->width - 720) * 2, 720 * 2);
-#else
-    line10_copy (output_data + 720 * 2 * ((sdidemux->line -
-                (format->start1 - 1)) * 2 + (format->tff)),
-        line + (format->width - 720) / 2 * 5, 720 / 2);
-#endif
+  int row;
+
+  row = gst_sdi_format_get_row (format, sdidemux->line);
+  if (row >= 0) {
+    guint8 *dest = GST_BUFFER_DATA (sdidemux->output_buffer) +
+        sdidemux->stride * row;
+    const guint8 *src = line + GST_SDI_FORMAT_ACTIVE_OFFSET (format);
+    int n_samples = format->active_width * 2;
+
+    if (sdidemux->fourcc == GST_MAKE_FOURCC ('v', '2', '1', '0')) {
+      int size = (n_samples + 11) / 12 * 16;
+
+      gst_sdi_unpack_v210 (dest, src, n_samples);
+      if (size < sdidemux->stride)
+        memset (dest + size, 0, sdidemux->stride - size);
+    } else {
+      gst_sdi_unpack_8 (dest, src, n_samples);
+    }
   }
 
-  sdidemux->offset = 0;
   sdidemux->line++;
   if (sdidemux->line == format->lines) {
     ret = gst_pad_push (sdidemux->srcpad, sdidemux->output_buffer);
@@ -302,181 +306,145 @@ copy_line (GstSdiDemux * sdidemux, guint8 * line)
   return ret;
 }
 
-#define SDI_IS_SYNC(a) (((a)&0xffffff80) == 0xff000080)
-#define SDI_SYNC_F(a) (((a)>>6)&1)
-#define SDI_SYNC_V(a) (((a)>>5)&1)
-#define SDI_SYNC_H(a) (((a)>>4)&1)
+/* longest line, and enough data to find the EAV after it */
+#define SDI_MAX_LINE_SIZE (2640 / 2 * 5)
+#define SDI_SEARCH_SIZE (2 * SDI_MAX_LINE_SIZE + 10)
+
+/* Skips to the next EAV and detects the format from the distance to the
+ * EAV after it. Returns FALSE when more data is needed. */
+static gboolean
+gst_sdi_demux_sync (GstSdiDemux * sdidemux)
+{
+  const GstSdiFormat *format;
+  const guint8 *data;
+  gboolean hd, next_hd;
+  int size, offset, next;
+
+  while (TRUE) {
+    size = MIN (gst_adapter_available (sdidemux->adapter), SDI_SEARCH_SIZE);
+    size -= size % 5;
+    if (size < 10)
+      return FALSE;
+
+    data = gst_adapter_peek (sdidemux->adapter, size);
+    offset = gst_sdi_find_eav (data, size, &hd);
+    if (offset < 0) {
+      GST_LOG_OBJECT (sdidemux, "no sync in %d bytes", size);
+      gst_adapter_flush (sdidemux->adapter, size - 5);
+      continue;
+    }
+    if (offset > 0) {
+      gst_adapter_flush (sdidemux->adapter, offset);
+      continue;
+    }
+
+    next = gst_sdi_find_eav (data + 5, size - 5, &next_hd);
+    if (next < 0) {
+      if (size < SDI_SEARCH_SIZE)
+        return FALSE;
+      gst_adapter_flush (sdidemux->adapter, 5);
+      continue;
+    }
 
-GstSdiFormat sd_ntsc = { 525, 480, 858, 20, 283, 0 };
-GstSdiFormat sd_pal = { 625, 576, 864, 23, 336, 1 };
+    format = gst_sdi_format_from_line_size ((next + 5) / 5 * 4, hd);
+    if (format == NULL || hd != next_hd) {
+      GST_DEBUG_OBJECT (sdidemux, "no format with %d byte lines", next + 5);
+      gst_adapter_flush (sdidemux->adapter, 5);
+      continue;
+    }
+    break;
+  }
+
+  if (format != sdidemux->format) {
+    GST_DEBUG_OBJECT (sdidemux, "%dx%d%c format", format->active_width,
+        format->active_lines, format->interlaced ? 'i' : 'p');
+    if (sdidemux->output_buffer) {
+      gst_buffer_unref (sdidemux->output_buffer);
+      sdidemux->output_buffer = NULL;
+    }
+    sdidemux->format = (GstSdiFormat *) format;
+    sdidemux->negotiated = FALSE;
+  }
+
+  sdidemux->have_hsync = TRUE;
+  sdidemux->have_vsync = FALSE;
+  sdidemux->line = 0;
+
+  return TRUE;
+}
 
 static GstFlowReturn
 gst_sdi_demux_chain (GstPad * pad, GstBuffer * buffer)
 {
   GstSdiDemux *sdidemux;
-  int offset = 0;
-  guint8 *data = GST_BUFFER_DATA (buffer);
-  int size = GST_BUFFER_SIZE (buffer);
   GstFlowReturn ret = GST_FLOW_OK;
   GstSdiFormat *format;
 
   sdidemux = GST_SDI_DEMUX (gst_pad_get_parent (pad));
-  sdidemux->format = &sd_pal;
-  format = sdidemux->format;
 
   GST_DEBUG_OBJECT (sdidemux, "chain");
 
   if (GST_BUFFER_IS_DISCONT (buffer)) {
+    gst_adapter_clear (sdidemux->adapter);
     sdidemux->have_hsync = FALSE;
     sdidemux->have_vsync = FALSE;
   }
+  gst_adapter_push (sdidemux->adapter, buffer);
 
-  if (!sdidemux->have_hsync) {
-#if 0
-    for (offset = 0; offset < size; offset += 4) {
-      guint32 sync = READ_UINT32_BE (data + offset);
-      GST_ERROR ("sync value %08x", sync);
-      if (SDI_IS_SYNC (sync) && SDI_SYNC_H (sync)) {
-        sdidemux->have_hsync = TRUE;
-        sdidemux->line = 0;
-        sdidemux->offset = 0;
-        break;
-      }
-    }
-#else
-    for (offset = 0; offset < size; offset += 5) {
-      guint32 sync = get_word10 (data + offset);
-      //GST_ERROR("sync value %08x", sync);
-      if (SDI_IS_SYNC (sync) && SDI_SYNC_H (sync)) {
-        sdidemux->have_hsync = TRUE;
-        sdidemux->line = 0;
-        sdidemux->offset = 0;
-        break;
-      }
-    }
-#endif
-    if (!sdidemux->have_hsync) {
-      GST_ERROR ("no sync");
-      goto out;
-    }
-  }
-
-  if (sdidemux->output_buffer == NULL) {
-    gst_sdi_demux_get_output_buffer (sdidemux);
-  }
-#if 0
-  if (sdidemux->offset) {
-    int n;
-
-    /* second half of a line */
-    n = MIN (size - offset, format->width * 2 - sdidemux->offset);
+  while (ret == GST_FLOW_OK) {
+    const guint8 *data;
+    guint32 sync;
+    int line_size;
 
-    memcpy (sdidemux->stored_line + sdidemux->offset, data + offset, n);
-
-    offset += n;
-    sdidemux->offset += n;
+    if (!sdidemux->have_hsync && !gst_sdi_demux_sync (sdidemux))
+      break;
 
-    if (sdidemux->offset == format->width * 2) {
-      guint32 sync =
-          GST_READ_UINT32_BE (data + offset + (format->width - 720 - 2) * 2);
+    format = sdidemux->format;
+    if (!sdidemux->negotiated && !gst_sdi_demux_negotiate (sdidemux)) {
+      ret = GST_FLOW_NOT_NEGOTIATED;
+      break;
+    }
+    if (sdidemux->output_buffer == NULL)
+      gst_sdi_demux_get_output_buffer (sdidemux);
 
-      //GST_ERROR("%08x", sync);
-      if (!sdidemux->have_vsync) {
-        //GST_ERROR("%08x", GST_READ_UINT32_BE(data+offset));
-        if (SDI_IS_SYNC (sync) && !SDI_SYNC_F (sync) &&
-            SDI_SYNC_F (sdidemux->last_sync)) {
-          sdidemux->have_vsync = TRUE;
-        }
-        sdidemux->line = 0;
-      }
+    line_size = GST_SDI_FORMAT_LINE_SIZE (format);
+    if (gst_adapter_available (sdidemux->adapter) < line_size)
+      break;
 
-      ret = copy_line (sdidemux, sdidemux->stored_line);
+    /* only lines split over two buffers are copied */
+    data = gst_adapter_peek (sdidemux->adapter, line_size);
 
-      sdidemux->last_sync = sync;
+    sync = gst_sdi_format_read_sav (format, data);
+    if (!SDI_IS_SYNC (sync)) {
+      GST_DEBUG_OBJECT (sdidemux, "lost sync");
+      gst_adapter_flush (sdidemux->adapter, 5);
+      sdidemux->have_hsync = FALSE;
+      continue;
     }
-  }
 
-  while (size - offset >= format->width * 2) {
-    guint32 sync =
-        GST_READ_UINT32_BE (data + offset + (format->width - 720 - 2) * 2);
-
-    //GST_ERROR("%08x", sync);
     if (!sdidemux->have_vsync) {
-      if (SDI_IS_SYNC (sync) && !SDI_SYNC_F (sync) &&
-          SDI_SYNC_F (sdidemux->last_sync)) {
-        sdidemux->have_vsync = TRUE;
-      }
-      sdidemux->line = 0;
-    }
-
-    ret = copy_line (sdidemux, data + offset);
-    offset += format->width * 2;
-
-    sdidemux->last_sync = sync;
-  }
-
-  if (size - offset > 0) {
-    memcpy (sdidemux->stored_line, data + offset, size - offset);
-    sdidemux->offset = size - offset;
-  }
-#else
-  if (sdidemux->offset) {
-    int n;
-
-    /* second half of a line */
-    n = MIN (size - offset, format->width / 2 * 5 - sdidemux->offset);
-
-    memcpy (sdidemux->stored_line + sdidemux->offset, data + offset, n);
-
-    offset += n;
-    sdidemux->offset += n;
-
-    if (sdidemux->offset == (format->width / 2) * 5) {
-      guint32 sync =
-          get_word10 (data + offset + ((format->width - 720 - 2) / 2) * 5);
-
-      if (!sdidemux->have_vsync) {
-        //GST_ERROR("%08x", GST_READ_UINT32_BE(data+offset));
-        if (SDI_IS_SYNC (sync) && !SDI_SYNC_F (sync) &&
-            SDI_SYNC_F (sdidemux->last_sync)) {
+      /* first line of the first field, or first active line */
+      if (format->interlaced) {
+        if (!SDI_SYNC_F (sync) && SDI_SYNC_F (sdidemux->last_sync)) {
           sdidemux->have_vsync = TRUE;
+          sdidemux->line = format->field0 - 1;
+        }
+      } else {
+        if (!SDI_SYNC_V (sync) && SDI_SYNC_V (sdidemux->last_sync)) {
+          sdidemux->have_vsync = TRUE;
+          sdidemux->line = format->start0 - 1;
         }
-        sdidemux->line = 0;
-      }
-
-      ret = copy_line (sdidemux, sdidemux->stored_line);
-
-      sdidemux->last_sync = sync;
-    }
-  }
-
-  while (size - offset >= format->width / 2 * 5) {
-    guint32 sync =
-        get_word10 (data + offset + ((format->width - 720 - 2) / 2) * 5);
-
-    //GST_ERROR("%08x", sync);
-    if (!sdidemux->have_vsync) {
-      if (SDI_IS_SYNC (sync) && !SDI_SYNC_F (sync) &&
-          SDI_SYNC_F (sdidemux->last_sync)) {
-        sdidemux->have_vsync = TRUE;
       }
-      sdidemux->line = 0;
+      if (!sdidemux->have_vsync)
+        sdidemux->line = 0;
     }
 
-    ret = copy_line (sdidemux, data + offset);
-    offset += (format->width / 2) * 5;
+    ret = copy_line (sdidemux, data);
+    gst_adapter_flush (sdidemux->adapter, line_size);
 
     sdidemux->last_sync = sync;
   }
 
-  if (size - offset > 0) {
-    memcpy (sdidemux->stored_line, data + offset, size - offset);
-    sdidemux->offset = size - offset;
-  }
-#endif
-
-out:
-  gst_buffer_unref (buffer);
   gst_object_unref (sdidemux);
   return ret;
 }
@@ -496,6 +464,9 @@ gst_sdi_demux_sink_event (GstPad * pad, GstEvent * event)
       res = gst_pad_push_event (sdidemux->srcpad, event);
       break;
     case GST_EVENT_FLUSH_STOP:
+      gst_adapter_clear (sdidemux->adapter);
+      sdidemux->have_hsync = FALSE;
+      sdidemux->have_vsync = FALSE;
       res = gst_pad_push_event (sdidemux->srcpad, event);
       break;
     case GST_EVENT_NEWSEGMENT:
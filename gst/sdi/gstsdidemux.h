@@ -22,6 +22,8 @@
 
 #include <gst/gst.h>
 #include <gst/gst.h>
+#include <gst/base/gstadapter.h>
+#include "gstsdiformat.h"
 
 G_BEGIN_DECLS
 
@@ -33,7 +35,6 @@ G_BEGIN_DECLS
 
 typedef struct _GstSdiDemux GstSdiDemux;
 typedef struct _GstSdiDemuxClass GstSdiDemuxClass;
-typedef struct _GstSdiFormat GstSdiFormat;
 
 struct _GstSdiDemux
 {
@@ -41,27 +42,20 @@ struct _GstSdiDemux
   GstPad *sinkpad;
   GstPad *srcpad;
 
+  GstAdapter *adapter;
   GstBuffer *output_buffer;
   int line;
-  int offset;
 
   gboolean have_hsync;
   gboolean have_vsync;
-  guchar stored_line[2160]; /* 864/2*5 */
 
   int frame_number;
   guint32 last_sync;
   GstSdiFormat *format;
-};
 
-struct _GstSdiFormat
-{
-  int lines;
-  int active_lines;
-  int width;
-  int start0;
-  int start1;
-  int tff;
+  gboolean negotiated;
+  guint32 fourcc;
+  int stride;
 };
 
 struct _GstSdiDemuxClass
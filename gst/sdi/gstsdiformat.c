@@ -0,0 +1,163 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "gstsdiformat.h"
+
+static const GstSdiFormat formats[] = {
+  /* SMPTE 125M */
+  {525, 480, 858, 20, 283, 0, 720, TRUE, 4, 266, 30000, 1001, 10, 11, FALSE},
+  /* ITU-R BT.656 */
+  {625, 576, 864, 23, 336, 1, 720, TRUE, 1, 313, 25, 1, 12, 11, FALSE},
+  /* SMPTE 274M */
+  {1125, 1080, 2200, 21, 584, 1, 1920, TRUE, 1, 564, 30000, 1001, 1, 1, TRUE},
+  {1125, 1080, 2640, 21, 584, 1, 1920, TRUE, 1, 564, 25, 1, 1, 1, TRUE},
+  /* SMPTE 296M */
+  {750, 720, 1650, 26, 0, 0, 1280, FALSE, 0, 0, 60000, 1001, 1, 1, TRUE},
+  {750, 720, 1980, 26, 0, 0, 1280, FALSE, 0, 0, 50, 1, 1, 1, TRUE}
+};
+
+const GstSdiFormat *
+gst_sdi_format_from_line_size (int samples, gboolean hd)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    if (formats[i].width * 2 == samples && formats[i].hd == hd)
+      return &formats[i];
+  }
+
+  return NULL;
+}
+
+const GstSdiFormat *
+gst_sdi_format_from_video (int width, int height, int fps_n, int fps_d)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    if (formats[i].active_width == width &&
+        formats[i].active_lines == height &&
+        formats[i].fps_n == fps_n && formats[i].fps_d == fps_d)
+      return &formats[i];
+  }
+
+  return NULL;
+}
+
+GstCaps *
+gst_sdi_format_get_caps (const GstSdiFormat * format)
+{
+  static const guint32 fourccs[] = {
+    GST_MAKE_FOURCC ('U', 'Y', 'V', 'Y'),
+    GST_MAKE_FOURCC ('v', '2', '1', '0')
+  };
+  GstCaps *caps;
+  int i;
+
+  caps = gst_caps_new_empty ();
+  for (i = 0; i < G_N_ELEMENTS (fourccs); i++) {
+    GstStructure *s;
+
+    s = gst_structure_new ("video/x-raw-yuv",
+        "format", GST_TYPE_FOURCC, fourccs[i],
+        "width", G_TYPE_INT, format->active_width,
+        "height", G_TYPE_INT, format->active_lines,
+        "framerate", GST_TYPE_FRACTION, format->fps_n, format->fps_d,
+        "interlaced", G_TYPE_BOOLEAN, format->interlaced,
+        "pixel-aspect-ratio", GST_TYPE_FRACTION, format->par_n,
+        format->par_d, "color-matrix", G_TYPE_STRING,
+        format->hd ? "hdtv" : "sdtv", NULL);
+    if (!format->hd)
+      gst_structure_set (s, "chroma-site", G_TYPE_STRING, "mpeg2", NULL);
+    gst_caps_append_structure (caps, s);
+  }
+
+  return caps;
+}
+
+int
+gst_sdi_format_get_stride (const GstSdiFormat * format, guint32 fourcc)
+{
+  if (fourcc == GST_MAKE_FOURCC ('v', '2', '1', '0'))
+    return (format->active_width + 47) / 48 * 128;
+
+  return format->active_width * 2;
+}
+
+/* returns the row of the frame carried by @line, or -1 for blanking */
+int
+gst_sdi_format_get_row (const GstSdiFormat * format, int line)
+{
+  int half = format->active_lines / 2;
+
+  /* line is one less than the video line */
+  if (!format->interlaced) {
+    if (line >= format->start0 - 1 &&
+        line < format->start0 - 1 + format->active_lines)
+      return line - (format->start0 - 1);
+    return -1;
+  }
+
+  if (line >= format->start0 - 1 && line < format->start0 - 1 + half)
+    return (line - (format->start0 - 1)) * 2 + (!format->tff);
+  if (line >= format->start1 - 1 && line < format->start1 - 1 + half)
+    return (line - (format->start1 - 1)) * 2 + (format->tff);
+
+  return -1;
+}
+
+/* the 10 bit XYZ word of the EAV or SAV of @line, with its protection
+ * bits */
+guint
+gst_sdi_format_get_xyz (const GstSdiFormat * format, int line, gboolean eav)
+{
+  guint f, v, h;
+
+  f = format->interlaced && (line + 1 >= format->field1 ||
+      line + 1 < format->field0);
+  v = gst_sdi_format_get_row (format, line) < 0;
+  h = eav ? 1 : 0;
+
+  return 0x200 | (f << 8) | (v << 7) | (h << 6) | ((v ^ h) << 5) |
+      ((f ^ h) << 4) | ((f ^ v) << 3) | ((f ^ v ^ h) << 2);
+}
+
+/* returns the SAV in front of the active video of @line in the form of
+ * an SD sync word, or 0 if there is none */
+guint32
+gst_sdi_format_read_sav (const GstSdiFormat * format, const guint8 * line)
+{
+  const guint8 *sav = line + GST_SDI_FORMAT_ACTIVE_OFFSET (format);
+  guint32 a, b;
+
+  if (!format->hd)
+    return gst_sdi_get_word10 (sav - 5);
+
+  a = gst_sdi_get_word10 (sav - 10);
+  b = gst_sdi_get_word10 (sav - 5);
+  if (a != 0xffff0000 || (b >> 16) != 0 || (b >> 8 & 0xff) != (b & 0xff))
+    return 0;
+
+  return 0xff000000 | (b & 0xff);
+}
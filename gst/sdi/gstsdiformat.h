@@ -0,0 +1,101 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_SDI_FORMAT_H_
+#define _GST_SDI_FORMAT_H_
+
+#include <gst/gst.h>
+#include "gstsdipack.h"
+
+G_BEGIN_DECLS
+
+#define GST_VIDEO_CAPS_NTSC(fourcc) \
+  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=480," \
+  "framerate=30000/1001,interlaced=TRUE,pixel-aspect-ratio=10/11," \
+  "chroma-site=mpeg2,color-matrix=sdtv"
+#define GST_VIDEO_CAPS_NTSC_WIDE(fourcc) \
+  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=480," \
+  "framerate=30000/1001,interlaced=TRUE,pixel-aspect-ratio=40/33," \
+  "chroma-site=mpeg2,color-matrix=sdtv"
+#define GST_VIDEO_CAPS_PAL(fourcc) \
+  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=576," \
+  "framerate=25/1,interlaced=TRUE,pixel-aspect-ratio=12/11," \
+  "chroma-site=mpeg2,color-matrix=sdtv"
+#define GST_VIDEO_CAPS_PAL_WIDE(fourcc) \
+  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=576," \
+  "framerate=25/1,interlaced=TRUE,pixel-aspect-ratio=16/11," \
+  "chroma-site=mpeg2,color-matrix=sdtv"
+#define GST_VIDEO_CAPS_1080I(fourcc) \
+  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=1920,height=1080," \
+  "framerate={30000/1001,25/1},interlaced=TRUE,pixel-aspect-ratio=1/1," \
+  "color-matrix=hdtv"
+#define GST_VIDEO_CAPS_720P(fourcc) \
+  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=1280,height=720," \
+  "framerate={60000/1001,50/1},interlaced=FALSE,pixel-aspect-ratio=1/1," \
+  "color-matrix=hdtv"
+
+#define GST_VIDEO_CAPS_SDI(fourcc) \
+  GST_VIDEO_CAPS_NTSC (fourcc) ";" GST_VIDEO_CAPS_PAL (fourcc) ";" \
+  GST_VIDEO_CAPS_1080I (fourcc) ";" GST_VIDEO_CAPS_720P (fourcc)
+
+typedef struct _GstSdiFormat GstSdiFormat;
+
+/* Lines are counted from 0 and start with the EAV, followed by the
+ * horizontal blanking, the SAV and the active video. Samples are stored
+ * as 4 10 bit words in 5 bytes, least significant bits first. HD lines
+ * interleave the chroma and luma streams and repeat every timing
+ * reference word. */
+struct _GstSdiFormat
+{
+  int lines;
+  int active_lines;
+  int width;
+  int start0;
+  int start1;
+  int tff;
+
+  int active_width;
+  gboolean interlaced;
+  /* first video line of the first field, and of the second field. F is
+   * set from field1 to the end of the frame and before field0. */
+  int field0;
+  int field1;
+  int fps_n, fps_d;
+  int par_n, par_d;
+  gboolean hd;
+};
+
+const GstSdiFormat *gst_sdi_format_from_line_size (int samples, gboolean hd);
+const GstSdiFormat *gst_sdi_format_from_video (int width, int height,
+    int fps_n, int fps_d);
+GstCaps *gst_sdi_format_get_caps (const GstSdiFormat * format);
+int gst_sdi_format_get_stride (const GstSdiFormat * format, guint32 fourcc);
+int gst_sdi_format_get_row (const GstSdiFormat * format, int line);
+guint gst_sdi_format_get_xyz (const GstSdiFormat * format, int line,
+    gboolean eav);
+guint32 gst_sdi_format_read_sav (const GstSdiFormat * format,
+    const guint8 * line);
+
+#define GST_SDI_FORMAT_LINE_SIZE(format) ((format)->width / 2 * 5)
+#define GST_SDI_FORMAT_ACTIVE_OFFSET(format) \
+  (((format)->width - (format)->active_width) / 2 * 5)
+
+G_END_DECLS
+
+#endif
@@ -55,6 +55,7 @@ static GstStateChangeReturn
 gst_sdi_mux_change_state (GstElement * element, GstStateChange transition);
 static const GstQueryType *gst_sdi_mux_get_query_types (GstElement * element);
 static gboolean gst_sdi_mux_query (GstElement * element, GstQuery * query);
+static gboolean gst_sdi_mux_sink_setcaps (GstPad * pad, GstCaps * caps);
 static GstFlowReturn gst_sdi_mux_chain (GstPad * pad, GstBuffer * buffer);
 static gboolean gst_sdi_mux_sink_event (GstPad * pad, GstEvent * event);
 static gboolean gst_sdi_mux_src_event (GstPad * pad, GstEvent * event);
@@ -66,29 +67,11 @@ enum
 
 /* pad templates */
 
-#define GST_VIDEO_CAPS_NTSC(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=480," \
-  "framerate=30000/1001,interlaced=TRUE,pixel-aspect-ratio=10/11," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-#define GST_VIDEO_CAPS_NTSC_WIDE(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=480," \
-  "framerate=30000/1001,interlaced=TRUE,pixel-aspect-ratio=40/33," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-#define GST_VIDEO_CAPS_PAL(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=576," \
-  "framerate=25/1,interlaced=TRUE,pixel-aspect-ratio=12/11," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-#define GST_VIDEO_CAPS_PAL_WIDE(fourcc) \
-  "video/x-raw-yuv,format=(fourcc)" fourcc ",width=720,height=576," \
-  "framerate=25/1,interlaced=TRUE,pixel-aspect-ratio=16/11," \
-  "chroma-site=mpeg2,color-matrix=sdtv"
-
 static GstStaticPadTemplate gst_sdi_mux_sink_template =
     GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_NTSC ("{UYVY,v210}") ";"
-        GST_VIDEO_CAPS_PAL ("{UYVY,v210}"))
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_SDI ("{UYVY,v210}"))
     );
 
 static GstStaticPadTemplate gst_sdi_mux_src_template =
@@ -96,7 +79,7 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS
-    ("application/x-raw-sdi,rate=270,format=(fourcc){UYVY,v210}")
+    ("application/x-raw-sdi,rate={270,1485},format=(fourcc){UYVY,v210}")
     );
 
 /* class initialization */
@@ -149,6 +132,8 @@ gst_sdi_mux_init (GstSdiMux * sdimux, GstSdiMuxClass * sdimux_class)
       GST_DEBUG_FUNCPTR (gst_sdi_mux_sink_event));
   gst_pad_set_chain_function (sdimux->sinkpad,
       GST_DEBUG_FUNCPTR (gst_sdi_mux_chain));
+  gst_pad_set_setcaps_function (sdimux->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_sdi_mux_sink_setcaps));
   gst_element_add_pad (GST_ELEMENT (sdimux), sdimux->sinkpad);
 
   sdimux->srcpad = gst_pad_new_from_static_template (&gst_sdi_mux_src_template,
@@ -201,6 +186,7 @@ gst_sdi_mux_finalize (GObject * object)
   g_return_if_fail (GST_IS_SDI_MUX (object));
 
   /* clean up object here */
+  g_free (GST_SDI_MUX (object)->samples);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -242,18 +228,204 @@ gst_sdi_mux_query (GstElement * element, GstQuery * query)
   return FALSE;
 }
 
+static gboolean
+gst_sdi_mux_sink_setcaps (GstPad * pad, GstCaps * caps)
+{
+  GstSdiMux *sdimux;
+  GstStructure *s;
+  const GstSdiFormat *format;
+  GstCaps *srccaps;
+  int width, height, fps_n, fps_d;
+  guint32 fourcc;
+  gboolean ret;
+
+  sdimux = GST_SDI_MUX (gst_pad_get_parent (pad));
+
+  s = gst_caps_get_structure (caps, 0);
+  if (!gst_structure_get_int (s, "width", &width) ||
+      !gst_structure_get_int (s, "height", &height) ||
+      !gst_structure_get_fraction (s, "framerate", &fps_n, &fps_d) ||
+      !gst_structure_get_fourcc (s, "format", &fourcc)) {
+    gst_object_unref (sdimux);
+    return FALSE;
+  }
+
+  format = gst_sdi_format_from_video (width, height, fps_n, fps_d);
+  if (format == NULL) {
+    GST_ERROR_OBJECT (sdimux, "no SDI format for %" GST_PTR_FORMAT, caps);
+    gst_object_unref (sdimux);
+    return FALSE;
+  }
+
+  srccaps = gst_caps_new_simple ("application/x-raw-sdi",
+      "rate", G_TYPE_INT, format->hd ? 1485 : 270,
+      "format", GST_TYPE_FOURCC, fourcc, NULL);
+  ret = gst_pad_set_caps (sdimux->srcpad, srccaps);
+  gst_caps_unref (srccaps);
+
+  if (ret) {
+    sdimux->format = format;
+    sdimux->fourcc = fourcc;
+    sdimux->stride = gst_sdi_format_get_stride (format, fourcc);
+    g_free (sdimux->samples);
+    sdimux->samples = g_new (guint16, format->width * 2);
+    sdimux->crc[0] = sdimux->crc[1] = 0;
+  }
+
+  gst_object_unref (sdimux);
+  return ret;
+}
+
+/* CRC-18 of HD lines, x^18 + x^5 + x^4 + 1, over every other word */
+static guint32
+sdi_crc_update (guint32 crc, const guint16 * words, int n)
+{
+  int i, j;
+
+  for (i = 0; i < n; i += 2) {
+    guint w = words[i];
+
+    for (j = 0; j < 10; j++) {
+      guint fb = (crc ^ (w >> j)) & 1;
+
+      crc >>= 1;
+      if (fb)
+        crc ^= 0x23000;
+    }
+  }
+
+  return crc;
+}
+
+static void
+sdi_write_timing (guint16 * dest, guint xyz, gboolean hd)
+{
+  static const guint16 preamble[] = { 0x3ff, 0, 0 };
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    *dest++ = preamble[i];
+    if (hd)
+      *dest++ = preamble[i];
+  }
+  *dest++ = xyz;
+  if (hd)
+    *dest = xyz;
+}
+
+/* Fills the samples of @line, starting with the EAV that ends the active
+ * video of the line before it. */
+static void
+gst_sdi_mux_write_line (GstSdiMux * sdimux, guint8 * dest, int line,
+    const guint8 * frame)
+{
+  const GstSdiFormat *format = sdimux->format;
+  guint16 *samples = sdimux->samples;
+  int prev = (line + format->lines - 1) % format->lines;
+  int active = (format->width - format->active_width) * 2;
+  int n_active = format->active_width * 2;
+  int i, pos, row;
+
+  sdi_write_timing (samples, gst_sdi_format_get_xyz (format, prev, TRUE),
+      format->hd);
+  pos = format->hd ? 8 : 4;
+
+  if (format->hd) {
+    guint ln0, ln1;
+    guint32 crc;
+
+    /* line number and CRC of the line before */
+    ln0 = ((prev + 1) & 0x7f) << 2;
+    ln0 |= (~ln0 & 0x100) << 1;
+    ln1 = 0x200 | (((prev + 1) >> 7) & 0xf) << 2;
+    samples[pos++] = ln0;
+    samples[pos++] = ln0;
+    samples[pos++] = ln1;
+    samples[pos++] = ln1;
+
+    for (i = 0; i < 2; i++) {
+      crc = sdi_crc_update (sdimux->crc[i], samples + i, 12);
+      samples[pos + i] = (crc & 0x1ff) | (~crc & 0x100) << 1;
+      samples[pos + 2 + i] = ((crc >> 9) & 0x1ff) | (~crc & 0x20000) >> 8;
+    }
+    pos += 4;
+  }
+
+  /* horizontal blanking */
+  for (; pos < active - (format->hd ? 8 : 4); pos += 2) {
+    samples[pos] = 0x200;
+    samples[pos + 1] = 0x040;
+  }
+
+  sdi_write_timing (samples + pos, gst_sdi_format_get_xyz (format, line,
+          FALSE), format->hd);
+
+  row = gst_sdi_format_get_row (format, line);
+  if (row < 0) {
+    for (i = active; i < active + n_active; i += 2) {
+      samples[i] = 0x200;
+      samples[i + 1] = 0x040;
+    }
+  } else if (sdimux->fourcc == GST_MAKE_FOURCC ('v', '2', '1', '0')) {
+    gst_sdi_v210_to_16 (samples + active, frame + row * sdimux->stride,
+        n_active);
+  } else {
+    const guint8 *src = frame + row * sdimux->stride;
+
+    for (i = 0; i < n_active; i++)
+      samples[active + i] = src[i] << 2;
+  }
+
+  if (format->hd) {
+    sdimux->crc[0] = sdi_crc_update (0, samples + active, n_active);
+    sdimux->crc[1] = sdi_crc_update (0, samples + active + 1, n_active);
+  }
+
+  gst_sdi_pack_16 (dest, samples, format->width * 2);
+}
+
 static GstFlowReturn
 gst_sdi_mux_chain (GstPad * pad, GstBuffer * buffer)
 {
   GstSdiMux *sdimux;
+  GstBuffer *outbuf;
+  GstFlowReturn ret;
+  int line, line_size;
 
   sdimux = GST_SDI_MUX (gst_pad_get_parent (pad));
 
   GST_DEBUG_OBJECT (sdimux, "chain");
 
+  if (sdimux->format == NULL) {
+    gst_buffer_unref (buffer);
+    gst_object_unref (sdimux);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  if (GST_BUFFER_SIZE (buffer) <
+      sdimux->stride * sdimux->format->active_lines) {
+    GST_ELEMENT_ERROR (sdimux, STREAM, FORMAT, (NULL),
+        ("buffer of %u bytes is too small", GST_BUFFER_SIZE (buffer)));
+    gst_buffer_unref (buffer);
+    gst_object_unref (sdimux);
+    return GST_FLOW_ERROR;
+  }
+
+  line_size = GST_SDI_FORMAT_LINE_SIZE (sdimux->format);
+  outbuf = gst_buffer_new_and_alloc (line_size * sdimux->format->lines);
+  gst_buffer_copy_metadata (outbuf, buffer, GST_BUFFER_COPY_TIMESTAMPS);
+  gst_buffer_set_caps (outbuf, GST_PAD_CAPS (sdimux->srcpad));
+
+  for (line = 0; line < sdimux->format->lines; line++) {
+    gst_sdi_mux_write_line (sdimux, GST_BUFFER_DATA (outbuf) +
+        line * line_size, line, GST_BUFFER_DATA (buffer));
+  }
+  gst_buffer_unref (buffer);
+
+  ret = gst_pad_push (sdimux->srcpad, outbuf);
 
   gst_object_unref (sdimux);
-  return GST_FLOW_OK;
+  return ret;
 }
 
 static gboolean
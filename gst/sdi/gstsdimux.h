@@ -22,6 +22,7 @@
 
 #include <gst/gst.h>
 #include <gst/gst.h>
+#include "gstsdiformat.h"
 
 G_BEGIN_DECLS
 
@@ -40,6 +41,15 @@ struct _GstSdiMux
 
   GstPad *srcpad;
   GstPad *sinkpad;
+
+  const GstSdiFormat *format;
+  guint32 fourcc;
+  int stride;
+
+  /* one line of 10 bit samples */
+  guint16 *samples;
+  /* CRCs of the active video of the previous HD line */
+  guint32 crc[2];
 };
 
 struct _GstSdiMuxClass
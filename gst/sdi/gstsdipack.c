@@ -0,0 +1,309 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ *
+ * gstsdipack.c: packing of the 10 bit samples of SDI lines
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstsdipack.h"
+
+/* The SSSE3 unpackers are compiled for that target only and selected at
+ * runtime. SSE2 is part of x86-64, so the sync search always uses it. */
+#if defined(HAVE_CPU_X86_64) && defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SDI_HAVE_SIMD 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+guint32
+gst_sdi_get_word10 (const guint8 * ptr)
+{
+  guint32 a;
+
+  a = (((ptr[0] >> 2) | (ptr[1] << 6)) & 0xff) << 24;
+  a |= (((ptr[1] >> 4) | (ptr[2] << 4)) & 0xff) << 16;
+  a |= (((ptr[2] >> 6) | (ptr[3] << 2)) & 0xff) << 8;
+  a |= ptr[4];
+
+  return a;
+}
+
+/* SD: 3FF 000 000 XYZ, HD: 3FF 3FF 000 000 000 000 XYZ XYZ, needs 10
+ * bytes */
+static inline gboolean
+sdi_is_eav (const guint8 * data, gboolean * hd)
+{
+  guint32 a = gst_sdi_get_word10 (data);
+  guint32 b;
+
+  if (SDI_IS_SYNC (a)) {
+    *hd = FALSE;
+    return SDI_SYNC_H (a);
+  }
+
+  if (a != 0xffff0000)
+    return FALSE;
+
+  b = gst_sdi_get_word10 (data + 5);
+  *hd = TRUE;
+  return (b >> 16) == 0 && (b >> 8 & 0xff) == (b & 0xff) &&
+      SDI_IS_SYNC (0xff000000 | (b & 0xff)) && SDI_SYNC_H (b);
+}
+
+/* the scalar search, from @offset on, a multiple of 5 */
+static int
+find_eav_c (const guint8 * data, int offset, int size, gboolean * hd)
+{
+  for (; offset + 10 <= size; offset += 5) {
+    if (data[offset] >= 0xfc && sdi_is_eav (data + offset, hd))
+      return offset;
+  }
+
+  return -1;
+}
+
+/**
+ * gst_sdi_find_eav:
+ * @data: packed 10 bit samples
+ * @size: size of @data
+ * @hd: set to %TRUE when the EAV is an HD one
+ *
+ * Looks for an EAV starting at a multiple of 5 bytes.
+ *
+ * Returns: the offset of the EAV, or -1
+ */
+int
+gst_sdi_find_eav (const guint8 * data, int size, gboolean * hd)
+{
+  int offset = 0;
+
+#ifdef SDI_HAVE_SIMD
+  {
+    /* the bytes of a 16 byte block that start a group of samples, by
+     * offset % 5 of the block */
+    static const int group_mask[5] = {
+      0x8421, 0x4210, 0x2108, 0x1084, 0x0842
+    };
+    const __m128i fc = _mm_set1_epi8 ((char) 0xfc);
+    int phase = 0;
+
+    /* the first word of a timing reference is 3FC-3FF, so only groups
+     * starting with a byte >= 0xfc are looked at */
+    for (; offset + 16 + 10 <= size; offset += 16) {
+      __m128i x = _mm_loadu_si128 ((const __m128i *) (data + offset));
+      int m = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_and_si128 (x, fc), fc));
+
+      m &= group_mask[phase];
+      while (m) {
+        int i = offset + __builtin_ctz (m);
+
+        if (sdi_is_eav (data + i, hd))
+          return i;
+        m &= m - 1;
+      }
+      phase = (phase + 1) % 5;
+    }
+    offset = (offset + 4) / 5 * 5;
+  }
+#endif
+
+  return find_eav_c (data, offset, size, hd);
+}
+
+#ifdef SDI_HAVE_SIMD
+#define SSSE3_INLINE static inline \
+    __attribute__ ((target ("ssse3"), always_inline))
+#define SSSE3_FUNC static __attribute__ ((target ("ssse3")))
+
+/* 8 samples from 10 bytes, each in a 16 bit lane together with the
+ * bits of the next byte. Loads 16 bytes. */
+SSSE3_INLINE __m128i
+load_words_ssse3 (const guint8 * src)
+{
+  const __m128i shuf = _mm_setr_epi8 (0, 1, 1, 2, 2, 3, 3, 4,
+      5, 6, 6, 7, 7, 8, 8, 9);
+
+  return _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) src), shuf);
+}
+
+/* the SIMD loops read 6 bytes past the samples they convert, so they stop
+ * well before the end of the line and leave the rest to the C code */
+SSSE3_FUNC int
+unpack_8_ssse3 (guint8 * dest, const guint8 * src, int n_samples)
+{
+  const __m128i mul = _mm_setr_epi16 (1 << 14, 1 << 12, 1 << 10, 1 << 8,
+      1 << 14, 1 << 12, 1 << 10, 1 << 8);
+  const __m128i mask = _mm_set1_epi16 (0xff);
+  int i;
+
+  for (i = 0; i + 24 <= n_samples; i += 16) {
+    __m128i a = _mm_mulhi_epu16 (load_words_ssse3 (src), mul);
+    __m128i b = _mm_mulhi_epu16 (load_words_ssse3 (src + 10), mul);
+
+    a = _mm_and_si128 (a, mask);
+    b = _mm_and_si128 (b, mask);
+    _mm_storeu_si128 ((__m128i *) (dest + i), _mm_packus_epi16 (a, b));
+    src += 20;
+  }
+
+  return i;
+}
+
+SSSE3_FUNC int
+unpack_16_ssse3 (guint16 * dest, const guint8 * src, int n_samples)
+{
+  const __m128i mul = _mm_setr_epi16 (64, 16, 4, 1, 64, 16, 4, 1);
+  int i;
+
+  for (i = 0; i + 24 <= n_samples; i += 16) {
+    __m128i a = _mm_mullo_epi16 (load_words_ssse3 (src), mul);
+    __m128i b = _mm_mullo_epi16 (load_words_ssse3 (src + 10), mul);
+
+    _mm_storeu_si128 ((__m128i *) (dest + i), _mm_srli_epi16 (a, 6));
+    _mm_storeu_si128 ((__m128i *) (dest + i + 8), _mm_srli_epi16 (b, 6));
+    src += 20;
+  }
+
+  return i;
+}
+#endif
+
+static inline guint64
+read_group (const guint8 * src)
+{
+  return src[0] | (src[1] << 8) | (src[2] << 16) | ((guint64) src[3] << 24) |
+      ((guint64) src[4] << 32);
+}
+
+/* the scalar unpackers, from sample @i on, a multiple of 4 */
+static void
+unpack_8_c (guint8 * dest, const guint8 * src, int i, int n_samples)
+{
+  for (src += i / 4 * 5; i < n_samples; i += 4, src += 5) {
+    guint64 v = read_group (src);
+
+    dest[i] = v >> 2;
+    dest[i + 1] = v >> 12;
+    dest[i + 2] = v >> 22;
+    dest[i + 3] = v >> 32;
+  }
+}
+
+static void
+unpack_16_c (guint16 * dest, const guint8 * src, int i, int n_samples)
+{
+  for (src += i / 4 * 5; i < n_samples; i += 4, src += 5) {
+    guint64 v = read_group (src);
+
+    dest[i] = v & 0x3ff;
+    dest[i + 1] = (v >> 10) & 0x3ff;
+    dest[i + 2] = (v >> 20) & 0x3ff;
+    dest[i + 3] = (v >> 30) & 0x3ff;
+  }
+}
+
+/* the 8 most significant bits of @n_samples samples, a multiple of 4 */
+void
+gst_sdi_unpack_8 (guint8 * dest, const guint8 * src, int n_samples)
+{
+  int i = 0;
+
+#ifdef SDI_HAVE_SIMD
+  if (__builtin_cpu_supports ("ssse3"))
+    i = unpack_8_ssse3 (dest, src, n_samples);
+#endif
+
+  unpack_8_c (dest, src, i, n_samples);
+}
+
+void
+gst_sdi_unpack_16 (guint16 * dest, const guint8 * src, int n_samples)
+{
+  int i = 0;
+
+#ifdef SDI_HAVE_SIMD
+  if (__builtin_cpu_supports ("ssse3"))
+    i = unpack_16_ssse3 (dest, src, n_samples);
+#endif
+
+  unpack_16_c (dest, src, i, n_samples);
+}
+
+/* v210 stores the samples in the same Cb Y Cr Y order, three to a 32 bit
+ * word. Writes (n_samples + 11) / 12 blocks of 16 bytes. */
+void
+gst_sdi_unpack_v210 (guint8 * dest, const guint8 * src, int n_samples)
+{
+  guint16 tmp[GST_SDI_MAX_SAMPLES + 12];
+  int i, n;
+
+  g_return_if_fail (n_samples <= GST_SDI_MAX_SAMPLES);
+
+  gst_sdi_unpack_16 (tmp, src, n_samples);
+  n = (n_samples + 11) / 12 * 12;
+  for (i = n_samples; i < n; i++)
+    tmp[i] = 0;
+
+  for (i = 0; i < n; i += 3) {
+    GST_WRITE_UINT32_LE (dest, tmp[i] | (tmp[i + 1] << 10) |
+        (tmp[i + 2] << 20));
+    dest += 4;
+  }
+}
+
+void
+gst_sdi_v210_to_16 (guint16 * dest, const guint8 * src, int n_samples)
+{
+  int i;
+
+  for (i = 0; i + 3 <= n_samples; i += 3) {
+    guint32 v = GST_READ_UINT32_LE (src);
+
+    dest[i] = v & 0x3ff;
+    dest[i + 1] = (v >> 10) & 0x3ff;
+    dest[i + 2] = (v >> 20) & 0x3ff;
+    src += 4;
+  }
+  if (i < n_samples) {
+    guint32 v = GST_READ_UINT32_LE (src);
+
+    for (; i < n_samples; i++, v >>= 10)
+      dest[i] = v & 0x3ff;
+  }
+}
+
+void
+gst_sdi_pack_16 (guint8 * dest, const guint16 * src, int n_samples)
+{
+  int i;
+
+  for (i = 0; i < n_samples; i += 4, dest += 5) {
+    guint64 v = (src[i] & 0x3ff) | ((src[i + 1] & 0x3ff) << 10) |
+        ((src[i + 2] & 0x3ff) << 20) | ((guint64) (src[i + 3] & 0x3ff) << 30);
+
+    dest[0] = v;
+    dest[1] = v >> 8;
+    dest[2] = v >> 16;
+    dest[3] = v >> 24;
+    dest[4] = v >> 32;
+  }
+}
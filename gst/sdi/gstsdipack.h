@@ -0,0 +1,49 @@
+/* GStreamer
+ * Copyright (C) 2010 David Schleef <ds@schleef.org>
+ *
+ * gstsdipack.h: packing of the 10 bit samples of SDI lines
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_SDI_PACK_H_
+#define _GST_SDI_PACK_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* sync words, as returned by gst_sdi_get_word10() */
+#define SDI_IS_SYNC(a) (((a)&0xffffff80) == 0xff000080)
+#define SDI_SYNC_F(a) (((a)>>6)&1)
+#define SDI_SYNC_V(a) (((a)>>5)&1)
+#define SDI_SYNC_H(a) (((a)>>4)&1)
+
+/* samples of the widest active line */
+#define GST_SDI_MAX_SAMPLES (1920 * 2)
+
+guint32 gst_sdi_get_word10 (const guint8 * ptr);
+int gst_sdi_find_eav (const guint8 * data, int size, gboolean * hd);
+
+void gst_sdi_unpack_8 (guint8 * dest, const guint8 * src, int n_samples);
+void gst_sdi_unpack_16 (guint16 * dest, const guint8 * src, int n_samples);
+void gst_sdi_unpack_v210 (guint8 * dest, const guint8 * src, int n_samples);
+void gst_sdi_pack_16 (guint8 * dest, const guint16 * src, int n_samples);
+void gst_sdi_v210_to_16 (guint16 * dest, const guint8 * src, int n_samples);
+
+G_END_DECLS
+
+#endif
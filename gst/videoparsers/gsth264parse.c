@@ -27,8 +27,6 @@
 #endif
 
 #include <gst/base/gstbytereader.h>
-#include <gst/base/gstbytewriter.h>
-#include <gst/base/gstadapter.h>
 #include <gst/video/video.h>
 #include "gsth264parse.h"
 
@@ -77,6 +75,7 @@ static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
 G_DEFINE_TYPE (GstH264Parse, gst_h264_parse, GST_TYPE_BASE_PARSE);
 
 static void gst_h264_parse_finalize (GObject * object);
+static void gst_h264_parse_output_clear (GstH264ParseOutput * out);
 
 static gboolean gst_h264_parse_start (GstBaseParse * parse);
 static gboolean gst_h264_parse_stop (GstBaseParse * parse);
@@ -145,7 +144,6 @@ gst_h264_parse_class_init (GstH264ParseClass * klass)
 static void
 gst_h264_parse_init (GstH264Parse * h264parse)
 {
-  h264parse->frame_out = gst_adapter_new ();
   gst_base_parse_set_pts_interpolation (GST_BASE_PARSE (h264parse), FALSE);
 }
 
@@ -155,7 +153,7 @@ gst_h264_parse_finalize (GObject * object)
 {
   GstH264Parse *h264parse = GST_H264_PARSE (object);
 
-  g_object_unref (h264parse->frame_out);
+  gst_h264_parse_output_clear (&h264parse->frame_out);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -174,7 +172,7 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   h264parse->sei_pos = -1;
   h264parse->keyframe = FALSE;
   h264parse->frame_start = FALSE;
-  gst_adapter_clear (h264parse->frame_out);
+  gst_h264_parse_output_clear (&h264parse->frame_out);
 }
 
 static void
@@ -372,31 +370,177 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
   h264parse->transform = (in_format != h264parse->format);
 }
 
-static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+static const guint8 h264_start_code[4] = { 0x00, 0x00, 0x00, 0x01 };
+
+/* appends the nal of @size bytes at @offset in @src to @dest, preceded by
+ * the start code or length prefix of @format. The nal payload is not copied,
+ * @dest shares the memory of @src. */
+static gboolean
+gst_h264_parse_append_nal (GstH264Parse * h264parse, GstBuffer * dest,
+    guint format, GstBuffer * src, guint offset, guint size)
 {
-  GstBuffer *buf;
-  guint nl = h264parse->nal_length_size;
-  guint32 tmp;
+  GstMemory *prefix;
 
   GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
+    guint nl = h264parse->nal_length_size;
+    guint32 tmp;
+    GstMapInfo map;
+
     tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    prefix = gst_allocator_alloc (NULL, nl, NULL);
+    gst_memory_map (prefix, &map, GST_MAP_WRITE);
+    memcpy (map.data, &tmp, nl);
+    gst_memory_unmap (prefix, &map);
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work. 
      * There are legit cases where nl in avc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
-    nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    prefix = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        (gpointer) h264_start_code, sizeof (h264_start_code), 0,
+        sizeof (h264_start_code), NULL, NULL);
+  }
+
+  gst_buffer_append_memory (dest, prefix);
+  return gst_buffer_copy_into (dest, src, GST_BUFFER_COPY_MEMORY, offset,
+      size);
+}
+
+/* same as gst_h264_parse_append_nal(), but copies the nal into @bw */
+static gboolean
+gst_h264_parse_put_nal (GstH264Parse * h264parse, GstByteWriter * bw,
+    guint format, GstBuffer * src, guint offset, guint size)
+{
+  gboolean ok;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  if (format == GST_H264_PARSE_FORMAT_AVC
+      || format == GST_H264_PARSE_FORMAT_AVC3) {
+    guint nl = h264parse->nal_length_size;
+    guint32 tmp;
+
+    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    ok = gst_byte_writer_put_data (bw, (const guint8 *) &tmp, nl);
+  } else {
+    ok = gst_byte_writer_put_data (bw, h264_start_code,
+        sizeof (h264_start_code));
+  }
+
+  return ok && gst_byte_writer_put_buffer (bw, src, offset, size);
+}
+
+static void
+gst_h264_parse_output_clear (GstH264ParseOutput * out)
+{
+  gst_buffer_replace (&out->buffer, NULL);
+  if (out->copied) {
+    gst_byte_writer_reset (&out->bw);
+    out->copied = FALSE;
+  }
+}
+
+static gsize
+gst_h264_parse_output_get_size (GstH264ParseOutput * out)
+{
+  if (out->copied)
+    return gst_byte_writer_get_pos (&out->bw);
+
+  return out->buffer ? gst_buffer_get_size (out->buffer) : 0;
+}
+
+/* makes room for @n_memory more memories in @out. A buffer can only hold
+ * gst_buffer_get_max_memory() memories and merges them into a new one
+ * beyond that, so rather copy the output once into the byte writer and
+ * append everything that follows to it. */
+static void
+gst_h264_parse_output_reserve (GstH264Parse * h264parse,
+    GstH264ParseOutput * out, guint n_memory, gsize size)
+{
+  if (out->copied)
+    return;
+
+  if (out->buffer)
+    n_memory += gst_buffer_n_memory (out->buffer);
+
+  if (n_memory <= gst_buffer_get_max_memory ()) {
+    if (!out->buffer)
+      out->buffer = gst_buffer_new ();
+    return;
+  }
+
+  GST_DEBUG_OBJECT (h264parse, "output needs %u memories, copying", n_memory);
+  size += gst_h264_parse_output_get_size (out);
+  gst_byte_writer_init_with_size (&out->bw, size, FALSE);
+  if (out->buffer) {
+    gst_byte_writer_put_buffer (&out->bw, out->buffer, 0, -1);
+    gst_buffer_replace (&out->buffer, NULL);
+  }
+  out->copied = TRUE;
+}
+
+/* appends @size bytes at @offset in @src to @out as they are,
+ * -1 appends everything up to the end of @src */
+static gboolean
+gst_h264_parse_output_add (GstH264Parse * h264parse, GstH264ParseOutput * out,
+    GstBuffer * src, guint offset, gssize size)
+{
+  if (size == -1)
+    size = gst_buffer_get_size (src) - offset;
+
+  gst_h264_parse_output_reserve (h264parse, out, gst_buffer_n_memory (src),
+      size);
+  if (out->copied)
+    return gst_byte_writer_put_buffer (&out->bw, src, offset, size);
+
+  return gst_buffer_copy_into (out->buffer, src, GST_BUFFER_COPY_MEMORY,
+      offset, size);
+}
+
+/* appends the nal at @offset in @src to @out, see
+ * gst_h264_parse_append_nal() */
+static gboolean
+gst_h264_parse_output_add_nal (GstH264Parse * h264parse,
+    GstH264ParseOutput * out, guint format, GstBuffer * src, guint offset,
+    guint size)
+{
+  gst_h264_parse_output_reserve (h264parse, out,
+      1 + gst_buffer_n_memory (src), 4 + size);
+  if (out->copied)
+    return gst_h264_parse_put_nal (h264parse, &out->bw, format, src, offset,
+        size);
+
+  return gst_h264_parse_append_nal (h264parse, out->buffer, format, src,
+      offset, size);
+}
+
+/* returns the collected output, or NULL if nothing was added */
+static GstBuffer *
+gst_h264_parse_output_finish (GstH264ParseOutput * out)
+{
+  GstBuffer *buf;
+
+  if (out->copied) {
+    buf = gst_byte_writer_reset_and_get_buffer (&out->bw);
+    out->copied = FALSE;
+  } else {
+    buf = out->buffer;
+    out->buffer = NULL;
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
-  gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
+  return buf;
+}
+
+static GstBuffer *
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format,
+    GstBuffer * src, guint offset, guint size)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new ();
+  gst_h264_parse_append_nal (h264parse, buf, format, src, offset, size);
 
   return buf;
 }
@@ -459,9 +603,11 @@ _nal_name (GstH264NalUnitType nal_type)
 }
 #endif
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload,
+ * nalu->data is the mapped data of @buffer */
 static void
-gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
+gst_h264_parse_process_nal (GstH264Parse * h264parse, GstBuffer * buffer,
+    GstH264NalUnit * nalu)
 {
   guint nal_type;
   GstH264PPS pps = { 0, };
@@ -552,7 +698,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       /* mark SEI pos */
       if (h264parse->sei_pos == -1) {
         if (h264parse->transform)
-          h264parse->sei_pos = gst_adapter_available (h264parse->frame_out);
+          h264parse->sei_pos =
+              gst_h264_parse_output_get_size (&h264parse->frame_out);
         else
           h264parse->sei_pos = nalu->sc_offset;
         GST_DEBUG_OBJECT (h264parse, "marking SEI in frame at offset %d",
@@ -596,7 +743,8 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       /* mind replacement buffer if applicable */
       if (h264parse->idr_pos == -1) {
         if (h264parse->transform)
-          h264parse->idr_pos = gst_adapter_available (h264parse->frame_out);
+          h264parse->idr_pos =
+              gst_h264_parse_output_get_size (&h264parse->frame_out);
         else
           h264parse->idr_pos = nalu->sc_offset;
         GST_DEBUG_OBJECT (h264parse, "marking IDR in frame at offset %d",
@@ -613,15 +761,13 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       gst_h264_parser_parse_nal (nalparser, nalu);
   }
 
-  /* if AVC output needed, collect properly prefixed nal in adapter,
-   * and use that to replace outgoing buffer data later on */
+  /* if AVC output needed, collect properly prefixed nal in a buffer
+   * sharing the input memory, and use that to replace outgoing buffer
+   * data later on */
   if (h264parse->transform) {
-    GstBuffer *buf;
-
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
-    gst_adapter_push (h264parse->frame_out, buf);
+    gst_h264_parse_output_add_nal (h264parse, &h264parse->frame_out,
+        h264parse->format, buffer, nalu->offset, nalu->size);
   }
 }
 
@@ -711,7 +857,7 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h264_parse_process_nal (h264parse, &nalu);
+    gst_h264_parse_process_nal (h264parse, buffer, &nalu);
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -919,7 +1065,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
     if (nalu.type == GST_H264_NAL_SPS ||
         nalu.type == GST_H264_NAL_PPS ||
         (h264parse->have_sps && h264parse->have_pps)) {
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, buffer, &nalu);
     } else {
       GST_WARNING_OBJECT (h264parse,
           "no SPS/PPS yet, nal Type: %d %s, Size: %u will be dropped",
@@ -1493,8 +1639,7 @@ static GstFlowReturn
 gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
   GstH264Parse *h264parse;
-  GstBuffer *buffer;
-  guint av;
+  GstBuffer *buffer, *buf;
 
   h264parse = GST_H264_PARSE (parse);
   buffer = frame->buffer;
@@ -1514,11 +1659,7 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
 
   /* replace with transformed AVC output if applicable */
-  av = gst_adapter_available (h264parse->frame_out);
-  if (av) {
-    GstBuffer *buf;
-
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+  if ((buf = gst_h264_parse_output_finish (&h264parse->frame_out))) {
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -1533,12 +1674,8 @@ static GstFlowReturn
 gst_h264_parse_push_codec_buffer (GstH264Parse * h264parse, GstBuffer * nal,
     GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format, nal, 0,
+      gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -1709,54 +1846,40 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
             }
           }
         } else {
-          /* insert config NALs into AU */
-          GstByteWriter bw;
+          /* insert config NALs into AU, sharing the memory of the AU
+           * and of the stored SPS/PPS rather than copying them */
+          GstH264ParseOutput out = { NULL, };
           GstBuffer *new_buf;
-          const gboolean bs = h264parse->format == GST_H264_PARSE_FORMAT_BYTE;
-          const gint nls = 4 - h264parse->nal_length_size;
-          gboolean ok;
+          gboolean ok = TRUE;
 
-          gst_byte_writer_init_with_size (&bw, gst_buffer_get_size (buffer),
-              FALSE);
-          ok = gst_byte_writer_put_buffer (&bw, buffer, 0, h264parse->idr_pos);
+          if (h264parse->idr_pos > 0)
+            ok &= gst_h264_parse_output_add (h264parse, &out, buffer, 0,
+                h264parse->idr_pos);
           GST_DEBUG_OBJECT (h264parse, "- inserting SPS/PPS");
           for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
             if ((codec_nal = h264parse->sps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h264parse, "inserting SPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              ok &= gst_h264_parse_output_add_nal (h264parse, &out,
+                  h264parse->format, codec_nal, 0,
+                  gst_buffer_get_size (codec_nal));
               h264parse->last_report = new_ts;
             }
           }
           for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
             if ((codec_nal = h264parse->pps_nals[i])) {
-              gsize nal_size = gst_buffer_get_size (codec_nal);
               GST_DEBUG_OBJECT (h264parse, "inserting PPS nal");
-              if (bs) {
-                ok &= gst_byte_writer_put_uint32_be (&bw, 1);
-              } else {
-                ok &= gst_byte_writer_put_uint32_be (&bw,
-                    (nal_size << (nls * 8)));
-                ok &= gst_byte_writer_set_pos (&bw,
-                    gst_byte_writer_get_pos (&bw) - nls);
-              }
-              ok &= gst_byte_writer_put_buffer (&bw, codec_nal, 0, nal_size);
+              ok &= gst_h264_parse_output_add_nal (h264parse, &out,
+                  h264parse->format, codec_nal, 0,
+                  gst_buffer_get_size (codec_nal));
               h264parse->last_report = new_ts;
             }
           }
-          ok &=
-              gst_byte_writer_put_buffer (&bw, buffer, h264parse->idr_pos, -1);
-          /* collect result and push */
-          new_buf = gst_byte_writer_reset_and_get_buffer (&bw);
+          if ((gsize) h264parse->idr_pos < gst_buffer_get_size (buffer))
+            ok &= gst_h264_parse_output_add (h264parse, &out, buffer,
+                h264parse->idr_pos, -1);
+          if (G_UNLIKELY (!ok))
+            GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
+          new_buf = gst_h264_parse_output_finish (&out);
           gst_buffer_copy_into (new_buf, buffer, GST_BUFFER_COPY_METADATA, 0,
               -1);
           /* should already be keyframe/IDR, but it may not have been,
@@ -1764,10 +1887,6 @@ gst_h264_parse_pre_push_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
           GST_BUFFER_FLAG_UNSET (new_buf, GST_BUFFER_FLAG_DELTA_UNIT);
           gst_buffer_replace (&frame->out_buffer, new_buf);
           gst_buffer_unref (new_buf);
-          /* some result checking seems to make some compilers happy */
-          if (G_UNLIKELY (!ok)) {
-            GST_ERROR_OBJECT (h264parse, "failed to insert SPS/PPS");
-          }
         }
       }
       /* we pushed whatever we had */
@@ -1869,7 +1988,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, codec_data, &nalu);
       off = nalu.offset + nalu.size;
     }
 
@@ -1884,7 +2003,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, codec_data, &nalu);
       off = nalu.offset + nalu.size;
     }
 
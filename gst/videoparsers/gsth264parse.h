@@ -27,12 +27,22 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbaseparse.h>
+#include <gst/base/gstbytewriter.h>
 #include <gst/codecparsers/gsth264parser.h>
 
 G_BEGIN_DECLS
 
 typedef struct _H264Params H264Params;
 
+/* transformed output, prefixed NALs sharing the input memory as long as
+ * they fit in one buffer, copied into the byte writer otherwise */
+typedef struct
+{
+  GstBuffer *buffer;
+  GstByteWriter bw;
+  gboolean copied;
+} GstH264ParseOutput;
+
 #define GST_TYPE_H264_PARSE \
   (gst_h264_parse_get_type())
 #define GST_H264_PARSE(obj) \
@@ -101,7 +111,7 @@ struct _GstH264Parse
   /*guint next_sc_pos;*/
   gint idr_pos, sei_pos;
   gboolean update_caps;
-  GstAdapter *frame_out;
+  GstH264ParseOutput frame_out;
   gboolean keyframe;
   gboolean frame_start;
   /* AU state */
@@ -26,6 +26,11 @@
  * inverse telecine and deinterlace cases that are handled by the
  * deinterlace element.
  *
+ * Every frame is filtered with the previous and the next frame, which adds
+ * one frame of latency. With GstYadif:double-rate, each field is
+ * turned into a frame and the framerate is doubled. The rows of a frame
+ * are split over GstYadif:n-threads threads.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -45,6 +50,8 @@
 #include <gst/video/video.h>
 #include "gstyadif.h"
 
+#include <string.h>
+
 GST_DEBUG_CATEGORY_STATIC (gst_yadif_debug_category);
 #define GST_CAT_DEFAULT gst_yadif_debug_category
 
@@ -66,24 +73,42 @@ static gboolean gst_yadif_get_unit_size (GstBaseTransform * trans,
     GstCaps * caps, gsize * size);
 static gboolean gst_yadif_start (GstBaseTransform * trans);
 static gboolean gst_yadif_stop (GstBaseTransform * trans);
+static gboolean gst_yadif_sink_event (GstBaseTransform * trans,
+    GstEvent * event);
+static gboolean gst_yadif_query (GstBaseTransform * trans,
+    GstPadDirection direction, GstQuery * query);
+static gboolean gst_yadif_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query);
 static GstFlowReturn gst_yadif_transform (GstBaseTransform * trans,
     GstBuffer * inbuf, GstBuffer * outbuf);
+static void gst_yadif_band_func (gpointer user_data, gint band,
+    gint n_bands);
 
 enum
 {
   PROP_0,
-  PROP_MODE
+  PROP_MODE,
+  PROP_DOUBLE_RATE,
+  PROP_N_THREADS
 };
 
 #define DEFAULT_MODE GST_DEINTERLACE_MODE_AUTO
+#define DEFAULT_DOUBLE_RATE FALSE
+#define DEFAULT_N_THREADS 0
 
 /* pad templates */
 
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define YADIF_FORMATS "{Y42B,I420,Y444,I420_10LE,I422_10LE,Y444_10LE}"
+#else
+#define YADIF_FORMATS "{Y42B,I420,Y444,I420_10BE,I422_10BE,Y444_10BE}"
+#endif
+
 static GstStaticPadTemplate gst_yadif_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (YADIF_FORMATS)
         ",interlace-mode=(string){interleaved,mixed,progressive}")
     );
 
@@ -91,7 +116,7 @@ static GstStaticPadTemplate gst_yadif_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{Y42B,I420,Y444}")
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (YADIF_FORMATS)
         ",interlace-mode=(string)progressive")
     );
 
@@ -151,6 +176,10 @@ gst_yadif_class_init (GstYadifClass * klass)
       GST_DEBUG_FUNCPTR (gst_yadif_get_unit_size);
   base_transform_class->start = GST_DEBUG_FUNCPTR (gst_yadif_start);
   base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_yadif_stop);
+  base_transform_class->sink_event = GST_DEBUG_FUNCPTR (gst_yadif_sink_event);
+  base_transform_class->query = GST_DEBUG_FUNCPTR (gst_yadif_query);
+  base_transform_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_yadif_propose_allocation);
   base_transform_class->transform = GST_DEBUG_FUNCPTR (gst_yadif_transform);
 
   g_object_class_install_property (gobject_class, PROP_MODE,
@@ -160,6 +189,16 @@ gst_yadif_class_init (GstYadifClass * klass)
           DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_DOUBLE_RATE,
+      g_param_spec_boolean ("double-rate", "Double rate",
+          "Output one frame per field, at twice the input framerate",
+          DEFAULT_DOUBLE_RATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to deinterlace a frame with (0 = one per CPU)",
+          0, 128, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -171,6 +210,10 @@ gst_yadif_init (GstYadif * yadif)
 
   yadif->srcpad = gst_pad_new_from_static_template (&gst_yadif_src_template,
       "src");
+
+  yadif->double_rate = DEFAULT_DOUBLE_RATE;
+  yadif->n_threads = DEFAULT_N_THREADS;
+  gst_band_pool_init (&yadif->bands, gst_yadif_band_func, yadif);
 }
 
 void
@@ -183,6 +226,18 @@ gst_yadif_set_property (GObject * object, guint property_id,
     case PROP_MODE:
       yadif->mode = g_value_get_enum (value);
       break;
+    case PROP_DOUBLE_RATE:
+      GST_OBJECT_LOCK (yadif);
+      yadif->double_rate = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (yadif);
+      /* the output framerate changes */
+      gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (yadif));
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (yadif);
+      yadif->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -199,6 +254,16 @@ gst_yadif_get_property (GObject * object, guint property_id,
     case PROP_MODE:
       g_value_set_enum (value, yadif->mode);
       break;
+    case PROP_DOUBLE_RATE:
+      GST_OBJECT_LOCK (yadif);
+      g_value_set_boolean (value, yadif->double_rate);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (yadif);
+      g_value_set_uint (value, yadif->n_threads);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -215,16 +280,78 @@ gst_yadif_dispose (GObject * object)
   G_OBJECT_CLASS (gst_yadif_parent_class)->dispose (object);
 }
 
+static void
+gst_yadif_clear_frame (GstVideoFrame * frame)
+{
+  if (frame->buffer)
+    gst_video_frame_unmap (frame);
+  memset (frame, 0, sizeof (GstVideoFrame));
+}
+
+static void
+gst_yadif_clear_history (GstYadif * yadif)
+{
+  gst_yadif_clear_frame (&yadif->prev_frame);
+  gst_yadif_clear_frame (&yadif->cur_frame);
+  gst_yadif_clear_frame (&yadif->next_frame);
+}
+
 void
 gst_yadif_finalize (GObject * object)
 {
-  /* GstYadif *yadif = GST_YADIF (object); */
+  GstYadif *yadif = GST_YADIF (object);
 
-  /* clean up object here */
+  gst_yadif_clear_history (yadif);
+  gst_band_pool_clear (&yadif->bands);
 
   G_OBJECT_CLASS (gst_yadif_parent_class)->finalize (object);
 }
 
+/* multiplies the framerates in @caps by @num / @den */
+static void
+gst_yadif_scale_framerate (GstCaps * caps, gint num, gint den)
+{
+  guint i;
+
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    GstStructure *s = gst_caps_get_structure (caps, i);
+    const GValue *v = gst_structure_get_value (s, "framerate");
+    gint n, d, max_n, max_d;
+
+    if (v == NULL)
+      continue;
+
+    if (GST_VALUE_HOLDS_FRACTION (v)) {
+      n = gst_value_get_fraction_numerator (v);
+      d = gst_value_get_fraction_denominator (v);
+      if (!gst_util_fraction_multiply (n, d, num, den, &n, &d)) {
+        n = G_MAXINT;
+        d = 1;
+      }
+      gst_structure_set (s, "framerate", GST_TYPE_FRACTION, n, d, NULL);
+    } else if (GST_VALUE_HOLDS_FRACTION_RANGE (v)) {
+      const GValue *min = gst_value_get_fraction_range_min (v);
+      const GValue *max = gst_value_get_fraction_range_max (v);
+
+      n = gst_value_get_fraction_numerator (min);
+      d = gst_value_get_fraction_denominator (min);
+      if (!gst_util_fraction_multiply (n, d, num, den, &n, &d)) {
+        n = G_MAXINT;
+        d = 1;
+      }
+      max_n = gst_value_get_fraction_numerator (max);
+      max_d = gst_value_get_fraction_denominator (max);
+      if (!gst_util_fraction_multiply (max_n, max_d, num, den, &max_n,
+              &max_d)) {
+        max_n = G_MAXINT;
+        max_d = 1;
+      }
+      gst_structure_set (s, "framerate", GST_TYPE_FRACTION_RANGE, n, d,
+          max_n, max_d, NULL);
+    }
+  }
+}
+
 
 static GstCaps *
 gst_yadif_transform_caps (GstBaseTransform * trans,
@@ -256,6 +383,15 @@ gst_yadif_transform_caps (GstBaseTransform * trans,
         "progressive", NULL);
   }
 
+  GST_OBJECT_LOCK (trans);
+  if (GST_YADIF (trans)->double_rate) {
+    if (direction == GST_PAD_SINK)
+      gst_yadif_scale_framerate (othercaps, 2, 1);
+    else
+      gst_yadif_scale_framerate (othercaps, 1, 2);
+  }
+  GST_OBJECT_UNLOCK (trans);
+
   return othercaps;
 }
 
@@ -267,6 +403,10 @@ gst_yadif_set_caps (GstBaseTransform * trans, GstCaps * incaps,
 
   gst_video_info_from_caps (&yadif->video_info, incaps);
 
+  /* the history and the bands are for the previous format */
+  gst_yadif_clear_history (yadif);
+  gst_band_pool_stop (&yadif->bands);
+
   return TRUE;
 }
 
@@ -293,38 +433,138 @@ gst_yadif_start (GstBaseTransform * trans)
 static gboolean
 gst_yadif_stop (GstBaseTransform * trans)
 {
+  GstYadif *yadif = GST_YADIF (trans);
+
+  gst_yadif_clear_history (yadif);
+  gst_band_pool_stop (&yadif->bands);
 
   return TRUE;
 }
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
+static void
+gst_yadif_band_func (gpointer user_data, gint band, gint n_bands)
+{
+  yadif_filter_band (user_data, band, n_bands);
+}
+
+/* Filter all bands of the field, the first one in the calling thread */
+static void
+gst_yadif_filter (GstYadif * yadif, GstVideoFrame * dest, int parity,
+    int tff)
+{
+  guint n_threads;
+  gint n_bands;
+
+  GST_OBJECT_LOCK (yadif);
+  n_threads = yadif->n_threads;
+  GST_OBJECT_UNLOCK (yadif);
+
+  n_bands = yadif->bands.n_bands;
+  if (gst_band_pool_configure (&yadif->bands, n_threads,
+          GST_VIDEO_INFO_HEIGHT (&yadif->video_info)) != n_bands)
+    GST_DEBUG_OBJECT (yadif, "deinterlacing with %d threads",
+        yadif->bands.n_bands);
+
+  yadif->cur = &yadif->cur_frame;
+  yadif->prev = yadif->prev_frame.buffer ? &yadif->prev_frame : yadif->cur;
+  yadif->next = yadif->next_frame.buffer ? &yadif->next_frame : yadif->cur;
+  yadif->dest = dest;
+  yadif->parity = parity;
+  yadif->tff = tff;
+
+  gst_band_pool_run (&yadif->bands);
+}
+
+static GstClockTime
+gst_yadif_get_frame_duration (GstYadif * yadif)
+{
+  const GstVideoInfo *vi = &yadif->video_info;
+
+  if (GST_VIDEO_INFO_FPS_N (vi) <= 0 || GST_VIDEO_INFO_FPS_D (vi) <= 0)
+    return GST_CLOCK_TIME_NONE;
+
+  return gst_util_uint64_scale_int (GST_SECOND, GST_VIDEO_INFO_FPS_D (vi),
+      GST_VIDEO_INFO_FPS_N (vi));
+}
 
 static GstFlowReturn
-gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
-    GstBuffer * outbuf)
+gst_yadif_alloc_output (GstYadif * yadif, GstBuffer ** outbuf)
 {
-  GstYadif *yadif = GST_YADIF (trans);
-  int parity;
+  GstBufferPool *pool;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  pool = gst_base_transform_get_buffer_pool (GST_BASE_TRANSFORM (yadif));
+  if (pool) {
+    ret = gst_buffer_pool_acquire_buffer (pool, outbuf, NULL);
+    gst_object_unref (pool);
+  } else {
+    *outbuf = gst_buffer_new_allocate (NULL,
+        GST_VIDEO_INFO_SIZE (&yadif->video_info), NULL);
+  }
+
+  return ret;
+}
+
+/* Deinterlaces field @field of cur_frame, the first or only one with 0,
+ * into @outbuf */
+static GstFlowReturn
+gst_yadif_output_field (GstYadif * yadif, GstBuffer * outbuf, int field,
+    gboolean double_rate)
+{
+  GstBuffer *cur = yadif->cur_frame.buffer;
+  GstVideoInterlaceMode interlace_mode;
+  GstClockTime duration;
+  gboolean interlaced;
   int tff;
 
-  parity = 0;
-  tff = 0;
+  interlace_mode = GST_VIDEO_INFO_INTERLACE_MODE (&yadif->video_info);
+  interlaced = yadif->mode == GST_DEINTERLACE_MODE_INTERLACED ||
+      (yadif->mode == GST_DEINTERLACE_MODE_AUTO &&
+      (interlace_mode == GST_VIDEO_INTERLACE_MODE_INTERLEAVED ||
+          (interlace_mode == GST_VIDEO_INTERLACE_MODE_MIXED &&
+              GST_BUFFER_FLAG_IS_SET (cur,
+                  GST_VIDEO_BUFFER_FLAG_INTERLACED))));
+  tff = GST_BUFFER_FLAG_IS_SET (cur, GST_VIDEO_BUFFER_FLAG_TFF) ? 1 : 0;
 
   if (!gst_video_frame_map (&yadif->dest_frame, &yadif->video_info, outbuf,
           GST_MAP_WRITE))
     goto dest_map_failed;
 
-  if (!gst_video_frame_map (&yadif->cur_frame, &yadif->video_info, inbuf,
-          GST_MAP_READ))
-    goto src_map_failed;
+  if (interlaced) {
+    /* the first field is the one of the top lines if tff, the missing lines
+     * are the ones of the other field */
+    gst_yadif_filter (yadif, &yadif->dest_frame, tff ^ (field == 0), tff);
+  } else {
+    gst_video_frame_copy (&yadif->dest_frame, &yadif->cur_frame);
+  }
 
-  yadif->next_frame = yadif->cur_frame;
-  yadif->prev_frame = yadif->cur_frame;
+  gst_video_frame_unmap (&yadif->dest_frame);
 
-  yadif_filter (yadif, parity, tff);
+  GST_BUFFER_TIMESTAMP (outbuf) = GST_BUFFER_TIMESTAMP (cur);
+  GST_BUFFER_DURATION (outbuf) = GST_BUFFER_DURATION (cur);
+  GST_BUFFER_OFFSET (outbuf) = GST_BUFFER_OFFSET (cur);
+  GST_BUFFER_OFFSET_END (outbuf) = GST_BUFFER_OFFSET_END (cur);
+  if (double_rate) {
+    duration = GST_BUFFER_DURATION (cur);
+    if (!GST_CLOCK_TIME_IS_VALID (duration))
+      duration = gst_yadif_get_frame_duration (yadif);
+    if (GST_CLOCK_TIME_IS_VALID (duration)) {
+      GST_BUFFER_DURATION (outbuf) = duration / 2;
+      if (field == 1 && GST_BUFFER_TIMESTAMP_IS_VALID (cur))
+        GST_BUFFER_TIMESTAMP (outbuf) += duration / 2;
+    }
+    GST_BUFFER_OFFSET (outbuf) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_OFFSET_END (outbuf) = GST_BUFFER_OFFSET_NONE;
+  }
+  if (GST_BUFFER_FLAG_IS_SET (cur, GST_BUFFER_FLAG_DISCONT) && field == 0)
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+  else
+    GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_DISCONT);
+  GST_BUFFER_FLAG_UNSET (outbuf, GST_VIDEO_BUFFER_FLAG_INTERLACED);
+  GST_BUFFER_FLAG_UNSET (outbuf, GST_VIDEO_BUFFER_FLAG_TFF);
+  GST_BUFFER_FLAG_UNSET (outbuf, GST_VIDEO_BUFFER_FLAG_RFF);
+  GST_BUFFER_FLAG_UNSET (outbuf, GST_VIDEO_BUFFER_FLAG_ONEFIELD);
 
-  gst_video_frame_unmap (&yadif->dest_frame);
-  gst_video_frame_unmap (&yadif->cur_frame);
   return GST_FLOW_OK;
 
 dest_map_failed:
@@ -332,15 +572,188 @@ dest_map_failed:
     GST_ERROR_OBJECT (yadif, "failed to map dest");
     return GST_FLOW_ERROR;
   }
+}
+
+/* Deinterlaces cur_frame into @outbuf. With double rate, the frame of the
+ * first field is pushed from here and @outbuf gets the second one. */
+static GstFlowReturn
+gst_yadif_output_frame (GstYadif * yadif, GstBuffer * outbuf)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM (yadif);
+  GstBuffer *first;
+  GstFlowReturn ret;
+  gboolean double_rate;
+
+  GST_OBJECT_LOCK (yadif);
+  double_rate = yadif->double_rate;
+  GST_OBJECT_UNLOCK (yadif);
+
+  if (!double_rate)
+    return gst_yadif_output_field (yadif, outbuf, 0, FALSE);
+
+  ret = gst_yadif_alloc_output (yadif, &first);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  ret = gst_yadif_output_field (yadif, first, 0, TRUE);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (first);
+    return ret;
+  }
+
+  ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (trans), first);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  return gst_yadif_output_field (yadif, outbuf, 1, TRUE);
+}
+
+/* outputs the last frame of the history, with itself as the next frame */
+static GstFlowReturn
+gst_yadif_drain (GstYadif * yadif)
+{
+  GstBuffer *outbuf;
+  GstFlowReturn ret;
+
+  if (yadif->next_frame.buffer == NULL)
+    return GST_FLOW_OK;
+
+  gst_yadif_clear_frame (&yadif->prev_frame);
+  yadif->prev_frame = yadif->cur_frame;
+  yadif->cur_frame = yadif->next_frame;
+  memset (&yadif->next_frame, 0, sizeof (GstVideoFrame));
+
+  ret = gst_yadif_alloc_output (yadif, &outbuf);
+  if (ret == GST_FLOW_OK) {
+    ret = gst_yadif_output_frame (yadif, outbuf);
+    if (ret == GST_FLOW_OK)
+      ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (yadif), outbuf);
+    else
+      gst_buffer_unref (outbuf);
+  }
+
+  gst_yadif_clear_history (yadif);
+
+  return ret;
+}
+
+static gboolean
+gst_yadif_sink_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstYadif *yadif = GST_YADIF (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      gst_yadif_drain (yadif);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_yadif_clear_history (yadif);
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (gst_yadif_parent_class)->sink_event (trans,
+      event);
+}
+
+static gboolean
+gst_yadif_query (GstBaseTransform * trans, GstPadDirection direction,
+    GstQuery * query)
+{
+  GstYadif *yadif = GST_YADIF (trans);
+  GstClockTime min, max, latency;
+  gboolean live;
+
+  if (direction != GST_PAD_SRC || GST_QUERY_TYPE (query) != GST_QUERY_LATENCY)
+    return GST_BASE_TRANSFORM_CLASS (gst_yadif_parent_class)->query (trans,
+        direction, query);
+
+  if (!gst_pad_peer_query (GST_BASE_TRANSFORM_SINK_PAD (trans), query))
+    return FALSE;
+
+  /* every frame waits for the next one */
+  latency = gst_yadif_get_frame_duration (yadif);
+  if (GST_CLOCK_TIME_IS_VALID (latency)) {
+    gst_query_parse_latency (query, &live, &min, &max);
+    GST_DEBUG_OBJECT (yadif, "adding %" GST_TIME_FORMAT " of latency",
+        GST_TIME_ARGS (latency));
+    min += latency;
+    if (GST_CLOCK_TIME_IS_VALID (max))
+      max += latency;
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_yadif_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstBufferPool *pool;
+  guint i, size, min, max;
+
+  GST_BASE_TRANSFORM_CLASS (gst_yadif_parent_class)->propose_allocation
+      (trans, decide_query, query);
+
+  if (gst_query_get_n_allocation_pools (query) == 0) {
+    GstCaps *caps;
+    GstVideoInfo info;
+
+    gst_query_parse_allocation (query, &caps, NULL);
+    if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+      return FALSE;
+    gst_query_add_allocation_pool (query, NULL, GST_VIDEO_INFO_SIZE (&info),
+        0, 0);
+  }
+
+  /* the history holds on to the two input frames before the one being
+   * filtered, upstream must not wait for them to be released */
+  for (i = 0; i < gst_query_get_n_allocation_pools (query); i++) {
+    gst_query_parse_nth_allocation_pool (query, i, &pool, &size, &min, &max);
+    min += 2;
+    if (max != 0)
+      max += 2;
+    GST_DEBUG_OBJECT (trans, "pool %u needs %u to %u buffers", i, min, max);
+    gst_query_set_nth_allocation_pool (query, i, pool, size, min, max);
+    if (pool)
+      gst_object_unref (pool);
+  }
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
+    GstBuffer * outbuf)
+{
+  GstYadif *yadif = GST_YADIF (trans);
+
+  /* slide the history, the frames keep the buffers alive without copies */
+  gst_yadif_clear_frame (&yadif->prev_frame);
+  yadif->prev_frame = yadif->cur_frame;
+  yadif->cur_frame = yadif->next_frame;
+  memset (&yadif->next_frame, 0, sizeof (GstVideoFrame));
+
+  if (!gst_video_frame_map (&yadif->next_frame, &yadif->video_info, inbuf,
+          GST_MAP_READ))
+    goto src_map_failed;
+
+  /* the first frame is output once the second one is there */
+  if (yadif->cur_frame.buffer == NULL)
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+
+  return gst_yadif_output_frame (yadif, outbuf);
+
 src_map_failed:
   {
     GST_ERROR_OBJECT (yadif, "failed to map src");
-    gst_video_frame_unmap (&yadif->dest_frame);
+    memset (&yadif->next_frame, 0, sizeof (GstVideoFrame));
     return GST_FLOW_ERROR;
   }
 }
 
-
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
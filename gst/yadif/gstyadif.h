@@ -23,6 +23,7 @@
 
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <gst/band-pool-private.h>
 
 G_BEGIN_DECLS
 
@@ -49,13 +50,28 @@ struct _GstYadif
   GstPad *srcpad;
 
   GstDeinterlaceMode mode;
+  gboolean double_rate;
+  guint n_threads;
 
   GstVideoInfo video_info;
 
+  /* three frame history, the mapped frames hold a ref on their buffers */
   GstVideoFrame prev_frame;
   GstVideoFrame cur_frame;
   GstVideoFrame next_frame;
   GstVideoFrame dest_frame;
+
+  /* field being filtered by yadif_filter_band(), prev and next point to
+   * cur_frame when there is no such frame in the history */
+  const GstVideoFrame *prev;
+  const GstVideoFrame *cur;
+  const GstVideoFrame *next;
+  GstVideoFrame *dest;
+  int parity;
+  int tff;
+
+  /* bands of rows, filtered in parallel */
+  GstBandPool bands;
 };
 
 struct _GstYadifClass
@@ -65,6 +81,8 @@ struct _GstYadifClass
 
 GType gst_yadif_get_type (void);
 
+void yadif_filter_band (GstYadif * yadif, int band, int n_bands);
+
 G_END_DECLS
 
 #endif
@@ -26,6 +26,14 @@
 #include <gstyadif.h>
 #include <string.h>
 
+/* The AVX2 line filter is compiled for the AVX2 target only and selected
+ * at runtime, the rest of the plugin keeps the default target */
+#if defined(HAVE_CPU_X86_64) && defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define YADIF_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
 #undef NDEBUG
 #include <assert.h>
 
@@ -97,68 +105,246 @@ filter_line_c (guint8 * dst,
 
 FILTER}
 
-#if 0
 static void
-filter_line_c_16bit (guint16 * dst,
-    guint16 * prev, guint16 * cur, guint16 * next,
+filter_line_c_16bit (guint8 * dst8,
+    guint8 * prev8, guint8 * cur8, guint8 * next8,
     int w, int prefs, int mrefs, int parity, int mode)
 {
   int x;
+  guint16 *dst = (guint16 *) dst8;
+  guint16 *prev = (guint16 *) prev8;
+  guint16 *cur = (guint16 *) cur8;
+  guint16 *next = (guint16 *) next8;
   guint16 *prev2 = parity ? prev : cur;
   guint16 *next2 = parity ? cur : next;
   mrefs /= 2;
   prefs /= 2;
 
 FILTER}
+
+#ifdef YADIF_HAVE_AVX2
+#define AVX2_INLINE static inline \
+    __attribute__ ((target ("avx2"), always_inline))
+
+/* 16 pixels of 8 or 16 bits, as 16 bit values */
+AVX2_INLINE __m256i
+load_avx2 (const guint8 * p, int bpc)
+{
+  if (bpc == 1)
+    return _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) p));
+  return _mm256_loadu_si256 ((const __m256i *) p);
+}
+
+/* CHECK(j) of the C version for the pixels selected by @cond, returns the
+ * pixels for which direction @j scored better */
+AVX2_INLINE __m256i
+check_avx2 (const guint8 * cur, int mrefs, int prefs, int j, int bpc,
+    __m256i cond, __m256i * spatial_score, __m256i * spatial_pred)
+{
+  __m256i m0 = load_avx2 (cur + mrefs + (j - 1) * bpc, bpc);
+  __m256i m1 = load_avx2 (cur + mrefs + j * bpc, bpc);
+  __m256i m2 = load_avx2 (cur + mrefs + (j + 1) * bpc, bpc);
+  __m256i p0 = load_avx2 (cur + prefs + (-j - 1) * bpc, bpc);
+  __m256i p1 = load_avx2 (cur + prefs - j * bpc, bpc);
+  __m256i p2 = load_avx2 (cur + prefs + (-j + 1) * bpc, bpc);
+  __m256i score, better;
+
+  score = _mm256_add_epi16 (_mm256_abs_epi16 (_mm256_sub_epi16 (m0, p0)),
+      _mm256_abs_epi16 (_mm256_sub_epi16 (m1, p1)));
+  score = _mm256_add_epi16 (score,
+      _mm256_abs_epi16 (_mm256_sub_epi16 (m2, p2)));
+
+  better = _mm256_and_si256 (cond, _mm256_cmpgt_epi16 (*spatial_score,
+          score));
+  *spatial_score = _mm256_blendv_epi8 (*spatial_score, score, better);
+  *spatial_pred = _mm256_blendv_epi8 (*spatial_pred,
+      _mm256_srli_epi16 (_mm256_add_epi16 (m1, p1), 1), better);
+
+  return better;
+}
+
+/* The FILTER of the C version on 16 pixels at a time, for 8 bit and up to
+ * 14 bit samples so that all sums fit in 16 bits. Returns the number of
+ * pixels done, the remainder is left to the C version. */
+AVX2_INLINE int
+filter_line_avx2_core (guint8 * dst, const guint8 * prev, const guint8 * cur,
+    const guint8 * next, int w, int prefs, int mrefs, int parity, int mode,
+    int bpc)
+{
+  const guint8 *prev2 = parity ? prev : cur;
+  const guint8 *next2 = parity ? cur : next;
+  const __m256i one = _mm256_set1_epi16 (1);
+  const __m256i all = _mm256_set1_epi16 (-1);
+  int x;
+
+  for (x = 0; x + 16 <= w; x += 16) {
+    int o = x * bpc;
+    __m256i c = load_avx2 (cur + o + mrefs, bpc);
+    __m256i e = load_avx2 (cur + o + prefs, bpc);
+    __m256i p2 = load_avx2 (prev2 + o, bpc);
+    __m256i n2 = load_avx2 (next2 + o, bpc);
+    __m256i d = _mm256_srli_epi16 (_mm256_add_epi16 (p2, n2), 1);
+    __m256i diff, tdiff, spatial_pred, spatial_score, better;
+
+    diff = _mm256_srli_epi16 (_mm256_abs_epi16 (_mm256_sub_epi16 (p2, n2)), 1);
+    tdiff = _mm256_add_epi16 (_mm256_abs_epi16 (_mm256_sub_epi16 (load_avx2
+                (prev + o + mrefs, bpc), c)),
+        _mm256_abs_epi16 (_mm256_sub_epi16 (load_avx2 (prev + o + prefs, bpc),
+                e)));
+    diff = _mm256_max_epi16 (diff, _mm256_srli_epi16 (tdiff, 1));
+    tdiff = _mm256_add_epi16 (_mm256_abs_epi16 (_mm256_sub_epi16 (load_avx2
+                (next + o + mrefs, bpc), c)),
+        _mm256_abs_epi16 (_mm256_sub_epi16 (load_avx2 (next + o + prefs, bpc),
+                e)));
+    diff = _mm256_max_epi16 (diff, _mm256_srli_epi16 (tdiff, 1));
+
+    spatial_pred = _mm256_srli_epi16 (_mm256_add_epi16 (c, e), 1);
+    spatial_score = _mm256_add_epi16 (_mm256_abs_epi16 (_mm256_sub_epi16
+            (load_avx2 (cur + o + mrefs - bpc, bpc), load_avx2 (cur + o +
+                    prefs - bpc, bpc))),
+        _mm256_abs_epi16 (_mm256_sub_epi16 (c, e)));
+    spatial_score = _mm256_add_epi16 (spatial_score,
+        _mm256_abs_epi16 (_mm256_sub_epi16 (load_avx2 (cur + o + mrefs + bpc,
+                    bpc), load_avx2 (cur + o + prefs + bpc, bpc))));
+    spatial_score = _mm256_sub_epi16 (spatial_score, one);
+
+    better = check_avx2 (cur + o, mrefs, prefs, -1, bpc, all, &spatial_score,
+        &spatial_pred);
+    check_avx2 (cur + o, mrefs, prefs, -2, bpc, better, &spatial_score,
+        &spatial_pred);
+    better = check_avx2 (cur + o, mrefs, prefs, 1, bpc, all, &spatial_score,
+        &spatial_pred);
+    check_avx2 (cur + o, mrefs, prefs, 2, bpc, better, &spatial_score,
+        &spatial_pred);
+
+    if (mode < 2) {
+      __m256i b = _mm256_srli_epi16 (_mm256_add_epi16 (load_avx2 (prev2 + o +
+                  2 * mrefs, bpc), load_avx2 (next2 + o + 2 * mrefs, bpc)), 1);
+      __m256i f = _mm256_srli_epi16 (_mm256_add_epi16 (load_avx2 (prev2 + o +
+                  2 * prefs, bpc), load_avx2 (next2 + o + 2 * prefs, bpc)), 1);
+      __m256i de = _mm256_sub_epi16 (d, e);
+      __m256i dc = _mm256_sub_epi16 (d, c);
+      __m256i bc = _mm256_sub_epi16 (b, c);
+      __m256i fe = _mm256_sub_epi16 (f, e);
+      __m256i max, min;
+
+      max = _mm256_max_epi16 (_mm256_max_epi16 (de, dc),
+          _mm256_min_epi16 (bc, fe));
+      min = _mm256_min_epi16 (_mm256_min_epi16 (de, dc),
+          _mm256_max_epi16 (bc, fe));
+      diff = _mm256_max_epi16 (_mm256_max_epi16 (diff, min),
+          _mm256_sub_epi16 (_mm256_setzero_si256 (), max));
+    }
+
+    spatial_pred = _mm256_min_epi16 (spatial_pred, _mm256_add_epi16 (d, diff));
+    spatial_pred = _mm256_max_epi16 (spatial_pred, _mm256_sub_epi16 (d, diff));
+
+    if (bpc == 1)
+      _mm_storeu_si128 ((__m128i *) (dst + o),
+          _mm_packus_epi16 (_mm256_castsi256_si128 (spatial_pred),
+              _mm256_extracti128_si256 (spatial_pred, 1)));
+    else
+      _mm256_storeu_si256 ((__m256i *) (dst + o), spatial_pred);
+  }
+
+  return x;
+}
+
+static __attribute__ ((target ("avx2")))
+void
+filter_line_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+
+  x = filter_line_avx2_core (dst, prev, cur, next, w, prefs, mrefs, parity,
+      mode, 1);
+  if (x < w)
+    filter_line_c (dst + x, prev + x, cur + x, next + x, w - x, prefs, mrefs,
+        parity, mode);
+}
+
+static __attribute__ ((target ("avx2")))
+void
+filter_line_avx2_16bit (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+
+  x = filter_line_avx2_core (dst, prev, cur, next, w, prefs, mrefs, parity,
+      mode, 2);
+  if (x < w)
+    filter_line_c_16bit (dst + 2 * x, prev + 2 * x, cur + 2 * x,
+        next + 2 * x, w - x, prefs, mrefs, parity, mode);
+}
 #endif
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
 #ifdef HAVE_CPU_X86_64
 void filter_line_x86_64 (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode);
 #endif
 
+typedef void (*YadifFilterLine) (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+/* best line filter for samples of @bpc bytes */
+static YadifFilterLine
+yadif_get_filter_line (int bpc)
+{
+#ifdef YADIF_HAVE_AVX2
+  if (__builtin_cpu_supports ("avx2"))
+    return bpc == 1 ? filter_line_avx2 : filter_line_avx2_16bit;
+#endif
+  if (bpc != 1)
+    return filter_line_c_16bit;
+#ifdef HAVE_CPU_X86_64
+  return filter_line_x86_64;
+#else
+  return filter_line_c;
+#endif
+}
+
+/* Deinterlaces band @band out of @n_bands of the rows of every plane of
+ * yadif->cur into yadif->dest. The bands can be filtered concurrently. */
 void
-yadif_filter (GstYadif * yadif, int parity, int tff)
+yadif_filter_band (GstYadif * yadif, int band, int n_bands)
 {
   int y, i;
-  const GstVideoInfo *vi = &yadif->video_info;
-  const GstVideoFormatInfo *vfi = vi->finfo;
+  const GstVideoFrame *cur = yadif->cur;
+  const GstVideoFormatInfo *vfi = cur->info.finfo;
+  int parity = yadif->parity;
+  int tff = yadif->tff;
 
   for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (vfi); i++) {
-    int w = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (vfi, i, vi->width);
-    int h = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (vfi, i, vi->height);
-    int refs = GST_VIDEO_INFO_COMP_STRIDE (vi, i);
-    int df = GST_VIDEO_INFO_COMP_PSTRIDE (vi, i);
-    guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->prev_frame, i);
-    guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->cur_frame, i);
-    guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->next_frame, i);
-    guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->dest_frame, i);
-
-    for (y = 0; y < h; y++) {
+    int w = GST_VIDEO_FRAME_COMP_WIDTH (cur, i);
+    int h = GST_VIDEO_FRAME_COMP_HEIGHT (cur, i);
+    int refs = GST_VIDEO_FRAME_COMP_STRIDE (cur, i);
+    int dest_refs = GST_VIDEO_FRAME_COMP_STRIDE (yadif->dest, i);
+    int df = GST_VIDEO_FRAME_COMP_PSTRIDE (cur, i);
+    guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (yadif->prev, i);
+    guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (cur, i);
+    guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (yadif->next, i);
+    guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (yadif->dest, i);
+    YadifFilterLine filter_line = yadif_get_filter_line (df);
+    int y_end = h * (band + 1) / n_bands;
+
+    for (y = h * band / n_bands; y < y_end; y++) {
+      guint8 *dst = dest_data + y * dest_refs;
+      guint8 *cur = cur_data + y * refs;
+
       if ((y ^ parity) & 1) {
         guint8 *prev = prev_data + y * refs;
-        guint8 *cur = cur_data + y * refs;
         guint8 *next = next_data + y * refs;
-        guint8 *dst = dest_data + y * refs;
-        int mode = ((y == 1) || (y + 2 == h)) ? 2 : yadif->mode;
-#if HAVE_CPU_X86_64
-        if (0) {
-          filter_line_c (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        } else {
-          filter_line_x86_64 (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        }
-#else
-        filter_line_c (dst, prev, cur, next, w,
+        /* no spatial interlacing check next to the edges */
+        int mode = ((y == 1) || (y + 2 == h)) ? 2 : 0;
+
+        filter_line (dst, prev, cur, next, w,
             y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-#endif
       } else {
-        guint8 *dst = dest_data + y * refs;
-        guint8 *cur = cur_data + y * refs;
-
         memcpy (dst, cur, w * df);
       }
     }
@@ -0,0 +1,177 @@
+/* GStreamer
+ *
+ * audiovisualizer.c: speed of the audiovisualizer shaders on 1080p frames
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* the shaders and the upscaling are internal to the base class */
+#include "../../gst/audiovisualizers/gstaudiovisualizer.c"
+#undef GST_CAT_DEFAULT
+
+#include <string.h>
+
+#include "benchutils.h"
+
+/* a scope that draws nothing, only the shaders are measured */
+
+#define GST_TYPE_BENCH_SCOPE (gst_bench_scope_get_type())
+typedef struct _GstBenchScope GstBenchScope;
+typedef struct _GstBenchScopeClass GstBenchScopeClass;
+
+struct _GstBenchScope
+{
+  GstAudioVisualizer parent;
+};
+
+struct _GstBenchScopeClass
+{
+  GstAudioVisualizerClass parent_class;
+};
+
+static GType gst_bench_scope_get_type (void);
+
+G_DEFINE_TYPE (GstBenchScope, gst_bench_scope, GST_TYPE_AUDIO_VISUALIZER);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("xRGB")));
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw, format = (string) " GST_AUDIO_NE (S16)));
+
+static void
+gst_bench_scope_class_init (GstBenchScopeClass * g_class)
+{
+  GstElementClass *element_class = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&sink_template));
+}
+
+static void
+gst_bench_scope_init (GstBenchScope * scope)
+{
+}
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define N_FRAMES 100
+
+typedef struct
+{
+  GstAudioVisualizer *scope;
+  guint downscale;
+  GstVideoFrame src, dest, small, small_shaded;
+} BenchShader;
+
+static void
+map_frame (GstVideoFrame * frame, gint width, gint height)
+{
+  GstVideoInfo info;
+  GstBuffer *buf;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_xRGB, width, height);
+  buf = gst_buffer_new_allocate (NULL, info.size, NULL);
+  gst_video_frame_map (frame, &info, buf, GST_MAP_READWRITE);
+  memset (GST_VIDEO_FRAME_PLANE_DATA (frame, 0), 0x80, info.size);
+  gst_buffer_unref (buf);
+}
+
+/* Shades N_FRAMES 1080p frames, at a reduced resolution and upscaled when
+ * downscale is set. The bytes are those of the 1080p frames. */
+static gboolean
+bench_shader (GstBenchResult * result, gpointer user_data)
+{
+  BenchShader *bench = user_data;
+  GstAudioVisualizer *scope = bench->scope;
+  gint n;
+
+  gst_bench_timer_start (result);
+
+  for (n = 0; n < N_FRAMES; n++) {
+    if (bench->downscale > 1) {
+      scope->shader (scope, &bench->small, &bench->small_shaded);
+      gst_audio_visualizer_upscale (&bench->small, &bench->dest);
+    } else {
+      scope->shader (scope, &bench->src, &bench->dest);
+    }
+  }
+
+  gst_bench_timer_stop (result);
+
+  result->bytes = (guint64) N_FRAMES * GST_VIDEO_FRAME_SIZE (&bench->dest);
+  result->out_bytes = result->bytes;
+  result->buffers = result->packets = N_FRAMES;
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  static const guint downscales[] = { 1, 4 };
+  GEnumClass *shaders;
+  BenchShader bench;
+  guint d;
+  gint shader;
+
+  if (!gst_bench_init (&argc, &argv, "Benchmarks the audiovisualizer "
+          "shaders on 1080p xRGB frames, and at a quarter of the resolution "
+          "with the upscaling."))
+    return 1;
+
+  bench.scope = g_object_new (GST_TYPE_BENCH_SCOPE, NULL);
+  gst_object_ref_sink (bench.scope);
+  map_frame (&bench.src, WIDTH, HEIGHT);
+  map_frame (&bench.dest, WIDTH, HEIGHT);
+
+  shaders = g_type_class_ref (GST_TYPE_AUDIO_VISUALIZER_SHADER);
+  for (d = 0; d < G_N_ELEMENTS (downscales); d++) {
+    bench.downscale = downscales[d];
+    map_frame (&bench.small, WIDTH / bench.downscale,
+        HEIGHT / bench.downscale);
+    map_frame (&bench.small_shaded, WIDTH / bench.downscale,
+        HEIGHT / bench.downscale);
+
+    for (shader = GST_AUDIO_VISUALIZER_SHADER_FADE;
+        shader <= GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_VERT_IN;
+        shader++) {
+      gchar *name;
+
+      g_object_set (bench.scope, "shader", shader, NULL);
+      name = g_strdup_printf ("audiovisualizer-%s-downscale%u",
+          g_enum_get_value (shaders, shader)->value_nick, bench.downscale);
+      gst_bench_run (name, bench_shader, &bench);
+      g_free (name);
+    }
+
+    gst_video_frame_unmap (&bench.small);
+    gst_video_frame_unmap (&bench.small_shaded);
+  }
+  g_type_class_unref (shaders);
+
+  gst_video_frame_unmap (&bench.src);
+  gst_video_frame_unmap (&bench.dest);
+  gst_object_unref (bench.scope);
+
+  return gst_bench_deinit ();
+}
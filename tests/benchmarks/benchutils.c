@@ -0,0 +1,645 @@
+/* GStreamer
+ *
+ * benchutils.c: common code for the throughput benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Every benchmark prints one line with a JSON object on stdout:
+ *
+ *   {"name": "h264parse", "bytes": 33554432, "seconds": 0.081234,
+ *    "mb_per_s": 413.06, "packets_per_s": 15632.1,
+ *    "allocs_per_buffer": 12.02, "ns_per_nal": 25104.3}
+ *
+ * MB are 10^6 bytes of input. Packets are output buffers unless the
+ * benchmark says otherwise, allocations are counted per output buffer and
+ * are null when GLib can't count them (GLib >= 2.46 ignores
+ * g_mem_set_vtable()). ns_per_nal is only given for H.264.
+ *
+ * With --baseline the lines of an earlier run are read back, the change
+ * of the throughput is added to every line and the program fails when a
+ * benchmark got slower than --tolerance allows. Messages go to stderr. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchutils.h"
+
+static gint iterations = 5;
+static gint stream_size = 32;
+static gchar *baseline = NULL;
+static gdouble tolerance = 10.0;
+static gchar **filters = NULL;
+
+static gchar **baseline_lines = NULL;
+static gboolean failed = FALSE;
+
+/* allocation counting, the counter is only reliable while no other
+ * thread allocates */
+static volatile gint n_allocs = 0;
+static gboolean counting_allocs = FALSE;
+
+static gpointer
+counting_malloc (gsize n_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return malloc (n_bytes);
+}
+
+static gpointer
+counting_realloc (gpointer mem, gsize n_bytes)
+{
+  if (mem == NULL)
+    g_atomic_int_inc (&n_allocs);
+  return realloc (mem, n_bytes);
+}
+
+static gpointer
+counting_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable counting_vtable = {
+  counting_malloc, counting_realloc, free, counting_calloc,
+  counting_malloc, counting_realloc
+};
+
+static GOptionEntry options[] = {
+  {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+      "Number of iterations, the fastest one is reported (default 5)", "N"},
+  {"size", 's', 0, G_OPTION_ARG_INT, &stream_size,
+      "Size of the synthetic streams in MB (default 32)", "MB"},
+  {"baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline,
+      "Compare with the results of an earlier run", "FILE"},
+  {"tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &tolerance,
+      "Slowdown in percent tolerated against the baseline (default 10)",
+      "PERCENT"},
+  {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &filters, NULL,
+      "[BENCHMARK-PATTERN...]"},
+  {NULL}
+};
+
+/**
+ * gst_bench_init:
+ * @argc: pointer to the number of arguments
+ * @argv: pointer to the arguments
+ * @summary: description of the benchmarks for --help
+ *
+ * Initializes GStreamer and parses the command line. Must be called first
+ * thing in main(), before GLib allocates any memory.
+ *
+ * Returns: %FALSE if the program should exit.
+ */
+gboolean
+gst_bench_init (int *argc, char ***argv, const gchar * summary)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  gint before;
+
+  g_mem_set_vtable (&counting_vtable);
+  /* make GSlice allocations go through the vtable as well */
+  g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+  before = g_atomic_int_get (&n_allocs);
+  g_free (g_malloc (16));
+  counting_allocs = g_atomic_int_get (&n_allocs) != before;
+
+  ctx = g_option_context_new ("- throughput benchmarks");
+  g_option_context_set_summary (ctx, summary);
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, argc, argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_error_free (err);
+    g_option_context_free (ctx);
+    return FALSE;
+  }
+  g_option_context_free (ctx);
+
+  if (iterations < 1 || stream_size < 1) {
+    g_printerr ("Invalid number of iterations or stream size\n");
+    return FALSE;
+  }
+
+  if (baseline) {
+    gchar *contents;
+
+    if (!g_file_get_contents (baseline, &contents, NULL, &err)) {
+      g_printerr ("Could not read baseline: %s\n", err->message);
+      g_error_free (err);
+      return FALSE;
+    }
+    baseline_lines = g_strsplit (contents, "\n", -1);
+    g_free (contents);
+  }
+
+  if (!counting_allocs)
+    g_printerr ("Memory allocations can't be counted with this GLib\n");
+
+  return TRUE;
+}
+
+/**
+ * gst_bench_deinit:
+ *
+ * Returns: the exit status of the program, failure if a benchmark failed or
+ * regressed against the baseline.
+ */
+gint
+gst_bench_deinit (void)
+{
+  g_strfreev (baseline_lines);
+  g_strfreev (filters);
+  g_free (baseline);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * gst_bench_get_stream_size:
+ *
+ * Returns: the size synthetic streams should have.
+ */
+gsize
+gst_bench_get_stream_size (void)
+{
+  return stream_size * (gsize) 1000000;
+}
+
+static gboolean
+gst_bench_is_selected (const gchar * name)
+{
+  gchar **f;
+
+  if (filters == NULL)
+    return TRUE;
+
+  for (f = filters; *f; f++) {
+    if (g_pattern_match_simple (*f, name))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* looks up the value of @key in the baseline line of @name, -1 if there
+ * is none */
+static gdouble
+gst_bench_get_baseline (const gchar * name, const gchar * key)
+{
+  gchar *name_str, *key_str;
+  gdouble value = -1.0;
+  gchar **line;
+
+  if (baseline_lines == NULL)
+    return -1.0;
+
+  name_str = g_strdup_printf ("\"name\": \"%s\"", name);
+  key_str = g_strdup_printf ("\"%s\": ", key);
+  for (line = baseline_lines; *line; line++) {
+    const gchar *v;
+
+    if (strstr (*line, name_str) && (v = strstr (*line, key_str))) {
+      value = g_ascii_strtod (v + strlen (key_str), NULL);
+      break;
+    }
+  }
+  g_free (name_str);
+  g_free (key_str);
+
+  return value;
+}
+
+static void
+gst_bench_report (const GstBenchResult * result)
+{
+  gdouble secs = (gdouble) result->time / GST_SECOND;
+  gdouble mb_per_s = result->bytes / 1e6 / secs;
+  gdouble base;
+  GString *line;
+
+  line = g_string_new (NULL);
+  g_string_append_printf (line, "{\"name\": \"%s\", \"bytes\": %"
+      G_GUINT64_FORMAT ", \"seconds\": %.6f, \"mb_per_s\": %.2f, "
+      "\"packets_per_s\": %.1f", result->name, result->bytes, secs, mb_per_s,
+      result->packets / secs);
+
+  if (result->allocs >= 0 && result->buffers > 0)
+    g_string_append_printf (line, ", \"allocs_per_buffer\": %.2f",
+        (gdouble) result->allocs / result->buffers);
+  else
+    g_string_append (line, ", \"allocs_per_buffer\": null");
+
+  if (result->nals > 0)
+    g_string_append_printf (line, ", \"ns_per_nal\": %.1f",
+        (gdouble) result->time / result->nals);
+  else
+    g_string_append (line, ", \"ns_per_nal\": null");
+
+  base = gst_bench_get_baseline (result->name, "mb_per_s");
+  if (base > 0.0) {
+    gdouble change = 100.0 * (mb_per_s - base) / base;
+
+    g_string_append_printf (line, ", \"baseline_mb_per_s\": %.2f, "
+        "\"change_percent\": %.1f", base, change);
+    if (change < -tolerance) {
+      g_printerr ("%s: %.1f%% slower than the baseline\n", result->name,
+          -change);
+      failed = TRUE;
+    }
+  }
+
+  g_string_append (line, "}");
+  g_print ("%s\n", line->str);
+  g_string_free (line, TRUE);
+}
+
+/**
+ * gst_bench_run:
+ * @name: name of the benchmark
+ * @func: function running one iteration
+ * @user_data: user data for @func
+ *
+ * Runs the benchmark @name unless it was not selected on the command line
+ * and reports the fastest iteration.
+ *
+ * Returns: %FALSE if the benchmark failed.
+ */
+gboolean
+gst_bench_run (const gchar * name, GstBenchFunc func, gpointer user_data)
+{
+  GstBenchResult best = { NULL, };
+  gint i;
+
+  if (!gst_bench_is_selected (name))
+    return TRUE;
+
+  for (i = 0; i < iterations; i++) {
+    GstBenchResult result = { NULL, };
+
+    result.name = name;
+    if (!func (&result, user_data)) {
+      g_printerr ("%s: failed\n", name);
+      failed = TRUE;
+      return FALSE;
+    }
+    if (i == 0 || result.time < best.time)
+      best = result;
+  }
+
+  gst_bench_report (&best);
+
+  return TRUE;
+}
+
+void
+gst_bench_timer_start (GstBenchResult * result)
+{
+  g_atomic_int_set (&n_allocs, 0);
+  result->time = gst_util_get_timestamp ();
+}
+
+void
+gst_bench_timer_stop (GstBenchResult * result)
+{
+  result->time = gst_util_get_timestamp () - result->time;
+  result->allocs = counting_allocs ? g_atomic_int_get (&n_allocs) : -1;
+}
+
+/* Drives a single element: buffers are pushed from our own source pad
+ * and received on our own sink pads, so that nothing but the element is
+ * measured. The output can be collected, honouring the byte segments
+ * muxers send to rewrite their headers. */
+
+typedef struct
+{
+  GstElement *element;
+  GstPad *srcpad;
+  GstPad *request_pad;
+  GList *sinkpads;
+  GByteArray *output;
+  guint64 offset;
+  guint64 out_bytes;
+  guint64 out_buffers;
+} GstBenchHarness;
+
+static GstFlowReturn
+gst_bench_harness_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstBenchHarness *h = gst_pad_get_element_private (pad);
+  gsize size = gst_buffer_get_size (buffer);
+
+  h->out_buffers++;
+  h->out_bytes += size;
+
+  if (h->output) {
+    if (h->offset + size > h->output->len)
+      g_byte_array_set_size (h->output, h->offset + size);
+    gst_buffer_extract (buffer, 0, h->output->data + h->offset, size);
+    h->offset += size;
+  }
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_bench_harness_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstBenchHarness *h = gst_pad_get_element_private (pad);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+    const GstSegment *segment;
+
+    gst_event_parse_segment (event, &segment);
+    if (segment->format == GST_FORMAT_BYTES)
+      h->offset = segment->start;
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstPad *
+gst_bench_harness_add_sinkpad (GstBenchHarness * h, GstPad * srcpad)
+{
+  GstPad *sinkpad;
+
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_element_private (sinkpad, h);
+  gst_pad_set_chain_function (sinkpad, gst_bench_harness_chain);
+  gst_pad_set_event_function (sinkpad, gst_bench_harness_event);
+  gst_pad_set_active (sinkpad, TRUE);
+  if (gst_pad_link (srcpad, sinkpad) != GST_PAD_LINK_OK) {
+    gst_object_unref (sinkpad);
+    return NULL;
+  }
+  h->sinkpads = g_list_prepend (h->sinkpads, sinkpad);
+
+  return sinkpad;
+}
+
+static void
+gst_bench_harness_pad_added (GstElement * element, GstPad * pad,
+    GstBenchHarness * h)
+{
+  if (GST_PAD_IS_SRC (pad))
+    gst_bench_harness_add_sinkpad (h, pad);
+}
+
+/* gst_element_get_compatible_pad() doesn't look at the caps when it
+ * requests pads, so find the template ourselves */
+static GstPad *
+gst_bench_harness_request_sinkpad (GstElement * element, GstCaps * caps)
+{
+  GList *l;
+
+  l = gst_element_class_get_pad_template_list (GST_ELEMENT_GET_CLASS
+      (element));
+  for (; l; l = l->next) {
+    GstPadTemplate *templ = l->data;
+    GstCaps *templ_caps;
+    gboolean match;
+
+    if (GST_PAD_TEMPLATE_DIRECTION (templ) != GST_PAD_SINK ||
+        GST_PAD_TEMPLATE_PRESENCE (templ) != GST_PAD_REQUEST)
+      continue;
+
+    templ_caps = gst_pad_template_get_caps (templ);
+    match = gst_caps_can_intersect (templ_caps, caps);
+    gst_caps_unref (templ_caps);
+    if (match)
+      return gst_element_request_pad (element, templ, NULL, NULL);
+  }
+
+  return NULL;
+}
+
+static void
+gst_bench_harness_free (GstBenchHarness * h)
+{
+  GList *l;
+
+  gst_element_set_state (h->element, GST_STATE_NULL);
+
+  if (h->request_pad) {
+    gst_element_release_request_pad (h->element, h->request_pad);
+    gst_object_unref (h->request_pad);
+  }
+
+  for (l = h->sinkpads; l; l = l->next)
+    gst_pad_set_active (GST_PAD (l->data), FALSE);
+  g_list_free_full (h->sinkpads, gst_object_unref);
+  gst_pad_set_active (h->srcpad, FALSE);
+  gst_object_unref (h->srcpad);
+  gst_object_unref (h->element);
+  g_slice_free (GstBenchHarness, h);
+}
+
+static GstBenchHarness *
+gst_bench_harness_new (const gchar * factory, const GstBenchStream * stream,
+    GByteArray * output)
+{
+  GstBenchHarness *h = g_slice_new0 (GstBenchHarness);
+  GstPad *sinkpad, *srcpad;
+  GstSegment segment;
+  gboolean timed;
+  gchar **args;
+  guint i;
+
+  /* the factory name can be followed by property=value pairs */
+  args = g_strsplit (factory, " ", -1);
+  h->element = gst_element_factory_make (args[0], NULL);
+  if (h->element == NULL) {
+    g_printerr ("Could not create %s\n", factory);
+    g_strfreev (args);
+    g_slice_free (GstBenchHarness, h);
+    return NULL;
+  }
+  gst_object_ref_sink (h->element);
+  for (i = 1; args[i]; i++) {
+    gchar *value = strchr (args[i], '=');
+
+    if (value) {
+      *value++ = '\0';
+      gst_util_set_object_arg (G_OBJECT (h->element), args[i], value);
+    }
+  }
+  g_strfreev (args);
+  h->output = output;
+
+  h->srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_active (h->srcpad, TRUE);
+
+  sinkpad = gst_element_get_static_pad (h->element, "sink");
+  if (sinkpad == NULL) {
+    sinkpad = gst_bench_harness_request_sinkpad (h->element, stream->caps);
+    if (sinkpad)
+      h->request_pad = gst_object_ref (sinkpad);
+  }
+
+  srcpad = gst_element_get_static_pad (h->element, "src");
+  if (srcpad) {
+    gst_bench_harness_add_sinkpad (h, srcpad);
+    gst_object_unref (srcpad);
+  } else {
+    g_signal_connect (h->element, "pad-added",
+        G_CALLBACK (gst_bench_harness_pad_added), h);
+  }
+
+  if (sinkpad == NULL || gst_pad_link (h->srcpad, sinkpad) != GST_PAD_LINK_OK) {
+    g_printerr ("Could not link to %s\n", factory);
+    if (sinkpad)
+      gst_object_unref (sinkpad);
+    gst_bench_harness_free (h);
+    return NULL;
+  }
+  gst_object_unref (sinkpad);
+
+  if (gst_element_set_state (h->element,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_printerr ("Could not start %s\n", factory);
+    gst_bench_harness_free (h);
+    return NULL;
+  }
+
+  timed = GST_CLOCK_TIME_IS_VALID (g_array_index (stream->chunks,
+          GstBenchChunk, 0).pts);
+  gst_segment_init (&segment, timed ? GST_FORMAT_TIME : GST_FORMAT_BYTES);
+  gst_pad_push_event (h->srcpad, gst_event_new_stream_start ("bench"));
+  gst_pad_push_event (h->srcpad, gst_event_new_caps (stream->caps));
+  gst_pad_push_event (h->srcpad, gst_event_new_segment (&segment));
+
+  return h;
+}
+
+/**
+ * gst_bench_process:
+ * @factory: the element to run, optionally followed by space separated
+ *     property=value pairs
+ * @stream: the input
+ * @result: the result to fill in or %NULL
+ * @output: array to collect the output in or %NULL
+ *
+ * Pushes @stream through a new @factory element. When @result is given
+ * the pushing is measured and the input and output are accounted in it.
+ *
+ * Returns: %FALSE if the element could not be set up or returned an error.
+ */
+gboolean
+gst_bench_process (const gchar * factory, const GstBenchStream * stream,
+    GstBenchResult * result, GByteArray * output)
+{
+  GstBenchHarness *h;
+  GstBuffer **buffers;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i, n_chunks = stream->chunks->len;
+
+  if (stream->chunks->len == 0)
+    return FALSE;
+
+  h = gst_bench_harness_new (factory, stream, output);
+  if (h == NULL)
+    return FALSE;
+
+  /* wrap the data before measuring, we're not interested in our own
+   * allocations */
+  buffers = g_new (GstBuffer *, n_chunks);
+  for (i = 0; i < n_chunks; i++) {
+    GstBenchChunk *chunk = &g_array_index (stream->chunks, GstBenchChunk, i);
+
+    buffers[i] = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        stream->data->data + chunk->offset, chunk->size, 0, chunk->size,
+        NULL, NULL);
+    GST_BUFFER_PTS (buffers[i]) = chunk->pts;
+    GST_BUFFER_DTS (buffers[i]) = chunk->dts;
+    if (!chunk->keyframe)
+      GST_BUFFER_FLAG_SET (buffers[i], GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+
+  if (result)
+    gst_bench_timer_start (result);
+
+  for (i = 0; i < n_chunks; i++) {
+    ret = gst_pad_push (h->srcpad, buffers[i]);
+    if (ret != GST_FLOW_OK)
+      break;
+  }
+  gst_pad_push_event (h->srcpad, gst_event_new_eos ());
+
+  if (result) {
+    gst_bench_timer_stop (result);
+    result->bytes = gst_bench_stream_get_size (stream);
+    result->out_bytes = h->out_bytes;
+    result->buffers = result->packets = h->out_buffers;
+    result->nals = stream->n_nals;
+  }
+
+  /* drop what wasn't pushed after an error */
+  for (i++; i < n_chunks; i++)
+    gst_buffer_unref (buffers[i]);
+  g_free (buffers);
+
+  gst_bench_harness_free (h);
+
+  if (ret != GST_FLOW_OK) {
+    g_printerr ("%s returned %s\n", factory, gst_flow_get_name (ret));
+    return FALSE;
+  }
+  if (result && result->buffers == 0) {
+    g_printerr ("%s did not output anything\n", factory);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+typedef struct
+{
+  const gchar *factory;
+  const GstBenchStream *stream;
+} GstBenchElement;
+
+static gboolean
+gst_bench_element_func (GstBenchResult * result, gpointer user_data)
+{
+  GstBenchElement *bench = user_data;
+
+  return gst_bench_process (bench->factory, bench->stream, result, NULL);
+}
+
+/**
+ * gst_bench_run_element:
+ * @name: name of the benchmark
+ * @factory: the element to run, as for gst_bench_process()
+ * @stream: the input
+ *
+ * Benchmarks @factory on @stream, see gst_bench_run().
+ *
+ * Returns: %FALSE if the benchmark failed.
+ */
+gboolean
+gst_bench_run_element (const gchar * name, const gchar * factory,
+    const GstBenchStream * stream)
+{
+  GstBenchElement bench = { factory, stream };
+
+  return gst_bench_run (name, gst_bench_element_func, &bench);
+}
@@ -0,0 +1,91 @@
+/* GStreamer
+ *
+ * benchutils.h: common code for the throughput benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_BENCH_UTILS_H__
+#define __GST_BENCH_UTILS_H__
+
+#include <gst/gst.h>
+
+#include "streams.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GstBenchResult GstBenchResult;
+
+/**
+ * GstBenchResult:
+ * @name: name of the benchmark
+ * @bytes: number of input bytes processed
+ * @out_bytes: number of output bytes produced
+ * @buffers: number of output buffers, or parsed units for the libraries
+ * @packets: number of packets, the output buffers unless the benchmark
+ *     counts something more meaningful like transport stream packets
+ * @nals: number of H.264 NAL units processed, 0 for other formats
+ * @time: time spent in the measured part
+ * @allocs: number of memory allocations in the measured part, -1 when the
+ *     allocations can't be counted
+ *
+ * The figures of one iteration of a benchmark. Only the fastest iteration
+ * is reported.
+ */
+struct _GstBenchResult
+{
+  const gchar *name;
+  guint64 bytes;
+  guint64 out_bytes;
+  guint64 buffers;
+  guint64 packets;
+  guint64 nals;
+  GstClockTime time;
+  gint64 allocs;
+};
+
+/**
+ * GstBenchFunc:
+ * @result: the result to fill in
+ * @user_data: user data passed to gst_bench_run()
+ *
+ * Runs one iteration of a benchmark. The measured part must be enclosed in
+ * gst_bench_timer_start() and gst_bench_timer_stop(), the setup around it
+ * is not accounted.
+ *
+ * Returns: %FALSE if the benchmark failed.
+ */
+typedef gboolean (*GstBenchFunc) (GstBenchResult * result, gpointer user_data);
+
+gboolean gst_bench_init (int *argc, char ***argv, const gchar * summary);
+gint gst_bench_deinit (void);
+
+gsize gst_bench_get_stream_size (void);
+
+gboolean gst_bench_run (const gchar * name, GstBenchFunc func,
+    gpointer user_data);
+void gst_bench_timer_start (GstBenchResult * result);
+void gst_bench_timer_stop (GstBenchResult * result);
+
+gboolean gst_bench_process (const gchar * factory,
+    const GstBenchStream * stream, GstBenchResult * result,
+    GByteArray * output);
+gboolean gst_bench_run_element (const gchar * name, const gchar * factory,
+    const GstBenchStream * stream);
+
+G_END_DECLS
+
+#endif /* __GST_BENCH_UTILS_H__ */
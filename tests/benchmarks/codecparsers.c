@@ -0,0 +1,162 @@
+/* GStreamer
+ *
+ * codecparsers.c: throughput of the codecparsers library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+
+#include "benchutils.h"
+
+/* Splits the whole stream into NAL units and parses the headers the way
+ * h264parse does. Allocations are counted per NAL unit. */
+static gboolean
+bench_h264_parser (GstBenchResult * result, gpointer user_data)
+{
+  GstBenchStream *stream = user_data;
+  const guint8 *data = stream->data->data;
+  gsize size = stream->data->len;
+  GstH264NalParser *parser;
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice;
+  GstH264SPS sps;
+  GstH264PPS pps;
+  guint n_nals = 0;
+
+  parser = gst_h264_nal_parser_new ();
+
+  gst_bench_timer_start (result);
+
+  res = gst_h264_parser_identify_nalu (parser, data, 0, size, &nalu);
+  while (res == GST_H264_PARSER_OK || res == GST_H264_PARSER_NO_NAL_END) {
+    switch (nalu.type) {
+      case GST_H264_NAL_SPS:
+        res = gst_h264_parser_parse_sps (parser, &nalu, &sps, TRUE);
+        break;
+      case GST_H264_NAL_PPS:
+        res = gst_h264_parser_parse_pps (parser, &nalu, &pps);
+        break;
+      case GST_H264_NAL_SLICE:
+      case GST_H264_NAL_SLICE_IDR:
+        res = gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice, TRUE,
+            TRUE);
+        break;
+      default:
+        res = gst_h264_parser_parse_nal (parser, &nalu);
+        break;
+    }
+    if (res != GST_H264_PARSER_OK)
+      break;
+
+    n_nals++;
+    if (nalu.offset + nalu.size >= size)
+      break;
+    res = gst_h264_parser_identify_nalu (parser, data,
+        nalu.offset + nalu.size, size, &nalu);
+  }
+
+  gst_bench_timer_stop (result);
+
+  gst_h264_nal_parser_free (parser);
+
+  result->bytes = size;
+  result->buffers = result->packets = result->nals = n_nals;
+
+  return n_nals == stream->n_nals;
+}
+
+/* Splits the whole stream into packets and parses the headers the way
+ * mpegvideoparse does. Allocations are counted per packet. */
+static gboolean
+bench_mpeg_video_parser (GstBenchResult * result, gpointer user_data)
+{
+  GstBenchStream *stream = user_data;
+  const guint8 *data = stream->data->data;
+  gsize size = stream->data->len;
+  GstMpegVideoPacket packet;
+  GstMpegVideoSequenceHdr seqhdr;
+  GstMpegVideoSequenceExt seqext;
+  GstMpegVideoPictureHdr pichdr;
+  GstMpegVideoPictureExt picext;
+  GstMpegVideoGop gop;
+  guint offset = 0, n_packets = 0;
+  gboolean ret = TRUE;
+
+  gst_bench_timer_start (result);
+
+  while (ret && gst_mpeg_video_parse (&packet, data, size, offset)) {
+    switch (packet.type) {
+      case GST_MPEG_VIDEO_PACKET_SEQUENCE:
+        ret = gst_mpeg_video_packet_parse_sequence_header (&packet, &seqhdr);
+        break;
+      case GST_MPEG_VIDEO_PACKET_EXTENSION:
+        if (packet.data[packet.offset] >> 4 ==
+            GST_MPEG_VIDEO_PACKET_EXT_SEQUENCE)
+          ret = gst_mpeg_video_packet_parse_sequence_extension (&packet,
+              &seqext);
+        else
+          ret = gst_mpeg_video_packet_parse_picture_extension (&packet,
+              &picext);
+        break;
+      case GST_MPEG_VIDEO_PACKET_GOP:
+        ret = gst_mpeg_video_packet_parse_gop (&packet, &gop);
+        break;
+      case GST_MPEG_VIDEO_PACKET_PICTURE:
+        ret = gst_mpeg_video_packet_parse_picture_header (&packet, &pichdr);
+        break;
+      default:
+        break;
+    }
+
+    n_packets++;
+    if (packet.size < 0)
+      break;
+    offset = packet.offset + packet.size;
+  }
+
+  gst_bench_timer_stop (result);
+
+  result->bytes = size;
+  result->buffers = result->packets = n_packets;
+
+  return ret && n_packets > 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  GstBenchStream *stream;
+  gsize size;
+
+  if (!gst_bench_init (&argc, &argv, "Benchmarks the H.264 and MPEG video "
+          "parsers of the codecparsers library."))
+    return 1;
+
+  size = gst_bench_get_stream_size ();
+
+  stream = gst_bench_stream_new_h264 (size);
+  gst_bench_run ("h264parser", bench_h264_parser, stream);
+  gst_bench_stream_free (stream);
+
+  stream = gst_bench_stream_new_mpeg2 (size);
+  gst_bench_run ("mpegvideoparser", bench_mpeg_video_parser, stream);
+  gst_bench_stream_free (stream);
+
+  return gst_bench_deinit ();
+}
@@ -0,0 +1,58 @@
+/* GStreamer
+ *
+ * gaussianblur.c: throughput of gaussianblur on 1080p frames
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "benchutils.h"
+
+int
+main (int argc, char **argv)
+{
+  static const gdouble sigmas[] = { 1.0, 5.0, 20.0, -5.0 };
+  static const guint threads[] = { 1, 0 };
+  GstBenchStream *video;
+  guint i, t;
+
+  if (!gst_bench_init (&argc, &argv, "Benchmarks gaussianblur on 1080p "
+          "AYUV frames. The throughput should not depend on the sigma, "
+          "n-threads=0 uses one thread per CPU."))
+    return 1;
+
+  video = gst_bench_stream_new_ayuv (gst_bench_get_stream_size (), 1920,
+      1080);
+
+  for (t = 0; t < G_N_ELEMENTS (threads); t++) {
+    for (i = 0; i < G_N_ELEMENTS (sigmas); i++) {
+      gchar sigma[G_ASCII_DTOSTR_BUF_SIZE];
+      gchar *name, *factory;
+
+      g_ascii_dtostr (sigma, sizeof (sigma), sigmas[i]);
+      name = g_strdup_printf ("gaussianblur-sigma%s-threads%u", sigma,
+          threads[t]);
+      factory = g_strdup_printf ("gaussianblur sigma=%s n-threads=%u", sigma,
+          threads[t]);
+      gst_bench_run_element (name, factory, video);
+      g_free (factory);
+      g_free (name);
+    }
+  }
+
+  gst_bench_stream_free (video);
+
+  return gst_bench_deinit ();
+}
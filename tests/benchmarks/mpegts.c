@@ -0,0 +1,91 @@
+/* GStreamer
+ *
+ * mpegts.c: throughput of mpegtsmux, tsparse and tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "benchutils.h"
+
+#define TS_PACKET_SIZE 188
+
+typedef struct
+{
+  const gchar *factory;
+  const GstBenchStream *stream;
+  gboolean count_input;
+} TsBench;
+
+/* packets are the transport stream packets going in or out */
+static gboolean
+bench_ts_element (GstBenchResult * result, gpointer user_data)
+{
+  TsBench *bench = user_data;
+
+  if (!gst_bench_process (bench->factory, bench->stream, result, NULL))
+    return FALSE;
+
+  if (bench->count_input)
+    result->packets = result->bytes / TS_PACKET_SIZE;
+  else
+    result->packets = result->out_bytes / TS_PACKET_SIZE;
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GstBenchStream *h264, *ts;
+  GByteArray *data;
+  TsBench bench;
+
+  if (!gst_bench_init (&argc, &argv, "Benchmarks mpegtsmux on H.264 and "
+          "tsparse and tsdemux on its output."))
+    return 1;
+
+  h264 = gst_bench_stream_new_h264 (gst_bench_get_stream_size ());
+
+  bench.factory = "mpegtsmux";
+  bench.stream = h264;
+  bench.count_input = FALSE;
+  gst_bench_run ("mpegtsmux", bench_ts_element, &bench);
+
+  /* the muxed stream is the input of the demuxers */
+  data = g_byte_array_new ();
+  if (!gst_bench_process ("mpegtsmux", h264, NULL, data)) {
+    g_printerr ("Could not create the transport stream\n");
+    g_byte_array_unref (data);
+    gst_bench_stream_free (h264);
+    gst_bench_deinit ();
+    return 1;
+  }
+  gst_bench_stream_free (h264);
+
+  ts = gst_bench_stream_new_from_data (data, "video/mpegts, "
+      "systemstream = (boolean) true, packetsize = (int) 188");
+
+  bench.stream = ts;
+  bench.count_input = TRUE;
+  bench.factory = "tsparse";
+  gst_bench_run ("tsparse", bench_ts_element, &bench);
+  bench.factory = "tsdemux";
+  gst_bench_run ("tsdemux", bench_ts_element, &bench);
+
+  gst_bench_stream_free (ts);
+
+  return gst_bench_deinit ();
+}
@@ -0,0 +1,54 @@
+/* GStreamer
+ *
+ * mxf.c: throughput of mxfmux and mxfdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "benchutils.h"
+
+int
+main (int argc, char **argv)
+{
+  GstBenchStream *video, *mxf;
+  GByteArray *data;
+
+  if (!gst_bench_init (&argc, &argv, "Benchmarks mxfmux on uncompressed "
+          "video and mxfdemux on its output."))
+    return 1;
+
+  video = gst_bench_stream_new_raw_video (gst_bench_get_stream_size ());
+
+  gst_bench_run_element ("mxfmux", "mxfmux", video);
+
+  /* the muxed file, with the header rewritten at the end, is the input
+   * of the demuxer */
+  data = g_byte_array_new ();
+  if (!gst_bench_process ("mxfmux", video, NULL, data)) {
+    g_printerr ("Could not create the MXF file\n");
+    g_byte_array_unref (data);
+    gst_bench_stream_free (video);
+    gst_bench_deinit ();
+    return 1;
+  }
+  gst_bench_stream_free (video);
+
+  mxf = gst_bench_stream_new_from_data (data, "application/mxf");
+  gst_bench_run_element ("mxfdemux", "mxfdemux", mxf);
+  gst_bench_stream_free (mxf);
+
+  return gst_bench_deinit ();
+}
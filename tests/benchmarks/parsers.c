@@ -0,0 +1,63 @@
+/* GStreamer
+ *
+ * parsers.c: throughput of the video parser elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "benchutils.h"
+
+/* every parser is run on the stream as it comes from a file and on the
+ * frame aligned stream it gets from a demuxer */
+static void
+run_parser (const gchar * name, const gchar * factory,
+    GstBenchStream * stream, const gchar * unaligned_caps)
+{
+  GstBenchStream *unaligned;
+  gchar *aligned_name;
+
+  unaligned = gst_bench_stream_new_unaligned (stream, unaligned_caps);
+  gst_bench_run_element (name, factory, unaligned);
+  gst_bench_stream_free (unaligned);
+
+  aligned_name = g_strconcat (name, "-aligned", NULL);
+  gst_bench_run_element (aligned_name, factory, stream);
+  g_free (aligned_name);
+
+  gst_bench_stream_free (stream);
+}
+
+int
+main (int argc, char **argv)
+{
+  gsize size;
+
+  if (!gst_bench_init (&argc, &argv, "Benchmarks h264parse, "
+          "mpegvideoparse and jpegparse."))
+    return 1;
+
+  size = gst_bench_get_stream_size ();
+
+  run_parser ("h264parse", "h264parse", gst_bench_stream_new_h264 (size),
+      "video/x-h264, stream-format = (string) byte-stream");
+  run_parser ("mpegvideoparse", "mpegvideoparse",
+      gst_bench_stream_new_mpeg2 (size),
+      "video/mpeg, mpegversion = (int) 2, systemstream = (boolean) false");
+  run_parser ("jpegparse", "jpegparse", gst_bench_stream_new_jpeg (size),
+      "image/jpeg");
+
+  return gst_bench_deinit ();
+}
@@ -0,0 +1,674 @@
+/* GStreamer
+ *
+ * streams.c: synthetic streams for the throughput benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The streams have valid headers and random payload: the parsers and
+ * muxers only look at the headers, and random payload makes sure no
+ * start codes are found where there are none. A fixed seed keeps the
+ * streams identical between runs so that results can be compared. */
+
+#include <string.h>
+
+#include "streams.h"
+
+#define SEED 0x5eed
+
+#define FRAME_DURATION (GST_SECOND / 25)
+
+typedef struct
+{
+  GByteArray *data;
+  guint8 cache;
+  guint bits;
+} BitWriter;
+
+static void
+bit_writer_init (BitWriter * bw, GByteArray * data)
+{
+  bw->data = data;
+  bw->cache = 0;
+  bw->bits = 0;
+}
+
+static void
+bit_writer_put (BitWriter * bw, guint32 value, guint nbits)
+{
+  while (nbits--) {
+    bw->cache = (bw->cache << 1) | ((value >> nbits) & 1);
+    if (++bw->bits == 8) {
+      g_byte_array_append (bw->data, &bw->cache, 1);
+      bw->cache = 0;
+      bw->bits = 0;
+    }
+  }
+}
+
+/* pads with @bit until the next byte boundary */
+static void
+bit_writer_align (BitWriter * bw, guint bit)
+{
+  while (bw->bits)
+    bit_writer_put (bw, bit, 1);
+}
+
+static void
+bit_writer_put_ue (BitWriter * bw, guint32 value)
+{
+  guint nbits = g_bit_storage (value + 1);
+
+  bit_writer_put (bw, 0, nbits - 1);
+  bit_writer_put (bw, value + 1, nbits);
+}
+
+static void
+bit_writer_put_se (BitWriter * bw, gint32 value)
+{
+  bit_writer_put_ue (bw, value > 0 ? 2 * value - 1 : -2 * value);
+}
+
+static void
+bit_writer_put_trailing_bits (BitWriter * bw)
+{
+  bit_writer_put (bw, 1, 1);
+  bit_writer_align (bw, 0);
+}
+
+static void
+put_bytes (GByteArray * data, const guint8 * bytes, guint len)
+{
+  g_byte_array_append (data, bytes, len);
+}
+
+static void
+put_start_code (GByteArray * data, guint8 code)
+{
+  const guint8 sc[] = { 0x00, 0x00, 0x01, code };
+
+  put_bytes (data, sc, 4);
+}
+
+static void
+put_random (GRand * rand, GByteArray * data, guint len)
+{
+  guint i;
+
+  for (i = 0; i < len; i++) {
+    guint8 b = g_rand_int (rand);
+
+    g_byte_array_append (data, &b, 1);
+  }
+}
+
+static GstBenchStream *
+gst_bench_stream_new (const gchar * caps)
+{
+  GstBenchStream *stream = g_slice_new0 (GstBenchStream);
+
+  stream->data = g_byte_array_new ();
+  stream->chunks = g_array_new (FALSE, TRUE, sizeof (GstBenchChunk));
+  stream->caps = gst_caps_from_string (caps);
+
+  return stream;
+}
+
+static void
+gst_bench_stream_add_chunk (GstBenchStream * stream, guint offset, guint size,
+    guint frame, gboolean keyframe)
+{
+  GstBenchChunk chunk;
+
+  chunk.offset = offset;
+  chunk.size = size;
+  chunk.pts = chunk.dts = frame * FRAME_DURATION;
+  chunk.keyframe = keyframe;
+  g_array_append_val (stream->chunks, chunk);
+}
+
+static void
+gst_bench_stream_add_blocks (GstBenchStream * stream)
+{
+  GstBenchChunk chunk = { 0, };
+
+  chunk.pts = chunk.dts = GST_CLOCK_TIME_NONE;
+  chunk.keyframe = TRUE;
+  for (chunk.offset = 0; chunk.offset < stream->data->len;
+      chunk.offset += GST_BENCH_BLOCKSIZE) {
+    chunk.size = MIN (GST_BENCH_BLOCKSIZE, stream->data->len - chunk.offset);
+    g_array_append_val (stream->chunks, chunk);
+  }
+}
+
+/* H.264: 1280x720 constrained baseline, an IDR every 30 frames, 4 slices
+ * per frame and an AUD, SPS and PPS in front of every IDR */
+
+#define H264_WIDTH_MBS 80
+#define H264_HEIGHT_MBS 45
+#define H264_SLICES 4
+#define H264_GOP 30
+#define H264_LOG2_MAX_FRAME_NUM 4
+#define H264_LOG2_MAX_POC_LSB 6
+
+/* writes @rbsp as a NAL unit, inserting emulation prevention bytes */
+static void
+put_nal (GByteArray * data, guint8 header, const GByteArray * rbsp)
+{
+  const guint8 sc[] = { 0x00, 0x00, 0x00, 0x01 };
+  const guint8 epb = 0x03;
+  guint i, zeros = 0;
+
+  put_bytes (data, sc, 4);
+  put_bytes (data, &header, 1);
+  for (i = 0; i < rbsp->len; i++) {
+    if (zeros >= 2 && rbsp->data[i] <= 0x03) {
+      put_bytes (data, &epb, 1);
+      zeros = 0;
+    }
+    put_bytes (data, &rbsp->data[i], 1);
+    zeros = rbsp->data[i] ? 0 : zeros + 1;
+  }
+}
+
+static void
+put_h264_sps (GByteArray * data, GByteArray * rbsp)
+{
+  BitWriter bw;
+
+  bit_writer_init (&bw, rbsp);
+  bit_writer_put (&bw, 66, 8); /* profile_idc */
+  bit_writer_put (&bw, 0xc0, 8);       /* constraint_set0/1 */
+  bit_writer_put (&bw, 31, 8); /* level_idc */
+  bit_writer_put_ue (&bw, 0);   /* seq_parameter_set_id */
+  bit_writer_put_ue (&bw, H264_LOG2_MAX_FRAME_NUM - 4);
+  bit_writer_put_ue (&bw, 0);   /* pic_order_cnt_type */
+  bit_writer_put_ue (&bw, H264_LOG2_MAX_POC_LSB - 4);
+  bit_writer_put_ue (&bw, 1);   /* max_num_ref_frames */
+  bit_writer_put (&bw, 0, 1);   /* gaps_in_frame_num_value_allowed_flag */
+  bit_writer_put_ue (&bw, H264_WIDTH_MBS - 1);
+  bit_writer_put_ue (&bw, H264_HEIGHT_MBS - 1);
+  bit_writer_put (&bw, 1, 1);   /* frame_mbs_only_flag */
+  bit_writer_put (&bw, 1, 1);   /* direct_8x8_inference_flag */
+  bit_writer_put (&bw, 0, 1);   /* frame_cropping_flag */
+  bit_writer_put (&bw, 0, 1);   /* vui_parameters_present_flag */
+  bit_writer_put_trailing_bits (&bw);
+
+  put_nal (data, 0x67, rbsp);
+}
+
+static void
+put_h264_pps (GByteArray * data, GByteArray * rbsp)
+{
+  BitWriter bw;
+
+  bit_writer_init (&bw, rbsp);
+  bit_writer_put_ue (&bw, 0);   /* pic_parameter_set_id */
+  bit_writer_put_ue (&bw, 0);   /* seq_parameter_set_id */
+  bit_writer_put (&bw, 0, 1);   /* entropy_coding_mode_flag */
+  bit_writer_put (&bw, 0, 1);   /* bottom_field_pic_order_in_frame_present */
+  bit_writer_put_ue (&bw, 0);   /* num_slice_groups_minus1 */
+  bit_writer_put_ue (&bw, 0);   /* num_ref_idx_l0_default_active_minus1 */
+  bit_writer_put_ue (&bw, 0);   /* num_ref_idx_l1_default_active_minus1 */
+  bit_writer_put (&bw, 0, 1);   /* weighted_pred_flag */
+  bit_writer_put (&bw, 0, 2);   /* weighted_bipred_idc */
+  bit_writer_put_se (&bw, 0);   /* pic_init_qp_minus26 */
+  bit_writer_put_se (&bw, 0);   /* pic_init_qs_minus26 */
+  bit_writer_put_se (&bw, 0);   /* chroma_qp_index_offset */
+  bit_writer_put (&bw, 0, 1);   /* deblocking_filter_control_present_flag */
+  bit_writer_put (&bw, 0, 1);   /* constrained_intra_pred_flag */
+  bit_writer_put (&bw, 0, 1);   /* redundant_pic_cnt_present_flag */
+  bit_writer_put_trailing_bits (&bw);
+
+  put_nal (data, 0x68, rbsp);
+}
+
+static void
+put_h264_aud (GByteArray * data, GByteArray * rbsp, gboolean idr)
+{
+  BitWriter bw;
+
+  bit_writer_init (&bw, rbsp);
+  bit_writer_put (&bw, idr ? 0 : 1, 3); /* primary_pic_type */
+  bit_writer_put_trailing_bits (&bw);
+
+  put_nal (data, 0x09, rbsp);
+}
+
+static void
+put_h264_slice (GRand * rand, GByteArray * data, GByteArray * rbsp,
+    guint frame, guint first_mb, guint size)
+{
+  guint gop_frame = frame % H264_GOP;
+  gboolean idr = gop_frame == 0;
+  BitWriter bw;
+
+  bit_writer_init (&bw, rbsp);
+  bit_writer_put_ue (&bw, first_mb);
+  bit_writer_put_ue (&bw, idr ? 7 : 5); /* slice_type, I or P */
+  bit_writer_put_ue (&bw, 0);   /* pic_parameter_set_id */
+  bit_writer_put (&bw, gop_frame, H264_LOG2_MAX_FRAME_NUM);
+  if (idr)
+    bit_writer_put_ue (&bw, (frame / H264_GOP) & 1);    /* idr_pic_id */
+  bit_writer_put (&bw, 2 * gop_frame, H264_LOG2_MAX_POC_LSB);
+  if (!idr) {
+    bit_writer_put (&bw, 0, 1); /* num_ref_idx_active_override_flag */
+    bit_writer_put (&bw, 0, 1); /* ref_pic_list_modification_flag_l0 */
+  }
+  /* dec_ref_pic_marking */
+  if (idr)
+    bit_writer_put (&bw, 0, 2);
+  else
+    bit_writer_put (&bw, 0, 1);
+  bit_writer_put_se (&bw, 0);   /* slice_qp_delta */
+
+  /* slice data */
+  while (bw.bits)
+    bit_writer_put (&bw, g_rand_int (rand), 1);
+  put_random (rand, rbsp, size);
+  bit_writer_put_trailing_bits (&bw);
+
+  put_nal (data, idr ? 0x65 : 0x41, rbsp);
+}
+
+/**
+ * gst_bench_stream_new_h264:
+ * @size: approximate size of the stream
+ *
+ * Generates an H.264 byte-stream with one chunk per access unit.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_h264 (gsize size)
+{
+  GstBenchStream *stream;
+  GByteArray *rbsp = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (SEED);
+  guint frame, i;
+
+  stream = gst_bench_stream_new ("video/x-h264, "
+      "stream-format = (string) byte-stream, alignment = (string) au, "
+      "width = (int) 1280, height = (int) 720, framerate = (fraction) 25/1");
+
+  for (frame = 0; stream->data->len < size; frame++) {
+    gboolean idr = frame % H264_GOP == 0;
+    guint offset = stream->data->len;
+    guint slice_size;
+
+    slice_size = g_rand_int_range (rand, idr ? 12000 : 2000,
+        idr ? 20000 : 5000);
+
+    g_byte_array_set_size (rbsp, 0);
+    put_h264_aud (stream->data, rbsp, idr);
+    stream->n_nals++;
+    if (idr) {
+      g_byte_array_set_size (rbsp, 0);
+      put_h264_sps (stream->data, rbsp);
+      g_byte_array_set_size (rbsp, 0);
+      put_h264_pps (stream->data, rbsp);
+      stream->n_nals += 2;
+    }
+    for (i = 0; i < H264_SLICES; i++) {
+      g_byte_array_set_size (rbsp, 0);
+      put_h264_slice (rand, stream->data, rbsp, frame,
+          i * H264_WIDTH_MBS * H264_HEIGHT_MBS / H264_SLICES, slice_size);
+      stream->n_nals++;
+    }
+
+    gst_bench_stream_add_chunk (stream, offset, stream->data->len - offset,
+        frame, idr);
+  }
+
+  g_rand_free (rand);
+  g_byte_array_unref (rbsp);
+
+  return stream;
+}
+
+/* MPEG-2 video: 720x576 main profile, I and P frames only, a GOP every
+ * 12 frames and one slice per macroblock row */
+
+#define MPEG2_WIDTH 720
+#define MPEG2_HEIGHT 576
+#define MPEG2_GOP 12
+
+static void
+put_mpeg2_sequence (GByteArray * data, guint frame)
+{
+  BitWriter bw;
+  guint secs = frame / 25;
+
+  bit_writer_init (&bw, data);
+
+  put_start_code (data, 0xb3);
+  bit_writer_put (&bw, MPEG2_WIDTH, 12);
+  bit_writer_put (&bw, MPEG2_HEIGHT, 12);
+  bit_writer_put (&bw, 2, 4);   /* aspect_ratio_information, 4:3 */
+  bit_writer_put (&bw, 3, 4);   /* frame_rate_code, 25 */
+  bit_writer_put (&bw, 15000000 / 400, 18);     /* bit_rate_value */
+  bit_writer_put (&bw, 1, 1);   /* marker_bit */
+  bit_writer_put (&bw, 112, 10);        /* vbv_buffer_size_value */
+  bit_writer_put (&bw, 0, 1);   /* constrained_parameters_flag */
+  bit_writer_put (&bw, 0, 2);   /* load_{non_,}intra_quantiser_matrix */
+  bit_writer_align (&bw, 0);
+
+  put_start_code (data, 0xb5);
+  bit_writer_put (&bw, 1, 4);   /* sequence extension */
+  bit_writer_put (&bw, 0x48, 8);        /* main profile, main level */
+  bit_writer_put (&bw, 1, 1);   /* progressive_sequence */
+  bit_writer_put (&bw, 1, 2);   /* chroma_format, 4:2:0 */
+  bit_writer_put (&bw, 0, 4);   /* {horizontal,vertical}_size_extension */
+  bit_writer_put (&bw, 0, 12);  /* bit_rate_extension */
+  bit_writer_put (&bw, 1, 1);   /* marker_bit */
+  bit_writer_put (&bw, 0, 8);   /* vbv_buffer_size_extension */
+  bit_writer_put (&bw, 1, 1);   /* low_delay */
+  bit_writer_put (&bw, 0, 7);   /* frame_rate_extension_{n,d} */
+  bit_writer_align (&bw, 0);
+
+  put_start_code (data, 0xb8);
+  bit_writer_put (&bw, 0, 1);   /* drop_frame_flag */
+  bit_writer_put (&bw, secs / 3600, 5);
+  bit_writer_put (&bw, (secs / 60) % 60, 6);
+  bit_writer_put (&bw, 1, 1);   /* marker_bit */
+  bit_writer_put (&bw, secs % 60, 6);
+  bit_writer_put (&bw, frame % 25, 6);
+  bit_writer_put (&bw, 1, 1);   /* closed_gop */
+  bit_writer_put (&bw, 0, 1);   /* broken_link */
+  bit_writer_align (&bw, 0);
+}
+
+static void
+put_mpeg2_picture (GRand * rand, GByteArray * data, guint frame, guint size)
+{
+  gboolean intra = frame % MPEG2_GOP == 0;
+  BitWriter bw;
+  guint row, i;
+
+  bit_writer_init (&bw, data);
+
+  put_start_code (data, 0x00);
+  bit_writer_put (&bw, frame % MPEG2_GOP, 10);  /* temporal_reference */
+  bit_writer_put (&bw, intra ? 1 : 2, 3);       /* picture_coding_type */
+  bit_writer_put (&bw, 0xffff, 16);     /* vbv_delay */
+  if (!intra)
+    bit_writer_put (&bw, 0x7, 4);       /* full_pel/forward_f_code */
+  bit_writer_put (&bw, 0, 1);   /* extra_bit_picture */
+  bit_writer_align (&bw, 0);
+
+  put_start_code (data, 0xb5);
+  bit_writer_put (&bw, 8, 4);   /* picture coding extension */
+  bit_writer_put (&bw, intra ? 0xff : 0x22, 8); /* f_code[0] */
+  bit_writer_put (&bw, 0xff, 8);        /* f_code[1] */
+  bit_writer_put (&bw, 0, 2);   /* intra_dc_precision */
+  bit_writer_put (&bw, 3, 2);   /* picture_structure, frame */
+  bit_writer_put (&bw, 0, 1);   /* top_field_first */
+  bit_writer_put (&bw, 1, 1);   /* frame_pred_frame_dct */
+  bit_writer_put (&bw, 0, 6);   /* concealment_motion_vectors .. rff */
+  bit_writer_put (&bw, 1, 1);   /* chroma_420_type */
+  bit_writer_put (&bw, 1, 1);   /* progressive_frame */
+  bit_writer_put (&bw, 0, 1);   /* composite_display_flag */
+  bit_writer_align (&bw, 0);
+
+  for (row = 0; row < MPEG2_HEIGHT / 16; row++) {
+    guint8 qscale = 8 << 3;
+
+    put_start_code (data, row + 1);
+    put_bytes (data, &qscale, 1);
+    /* no zero bytes, so that there are no start codes in the payload */
+    for (i = 0; i < size; i++) {
+      guint8 b = g_rand_int_range (rand, 1, 256);
+
+      put_bytes (data, &b, 1);
+    }
+  }
+}
+
+/**
+ * gst_bench_stream_new_mpeg2:
+ * @size: approximate size of the stream
+ *
+ * Generates an MPEG-2 video elementary stream with one chunk per frame.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_mpeg2 (gsize size)
+{
+  GstBenchStream *stream;
+  GRand *rand = g_rand_new_with_seed (SEED);
+  guint frame;
+
+  stream = gst_bench_stream_new ("video/mpeg, mpegversion = (int) 2, "
+      "systemstream = (boolean) false, width = (int) 720, "
+      "height = (int) 576, framerate = (fraction) 25/1");
+
+  for (frame = 0; stream->data->len < size; frame++) {
+    gboolean intra = frame % MPEG2_GOP == 0;
+    guint offset = stream->data->len;
+
+    if (intra)
+      put_mpeg2_sequence (stream->data, frame);
+    put_mpeg2_picture (rand, stream->data, frame,
+        g_rand_int_range (rand, intra ? 2000 : 400, intra ? 3000 : 800));
+
+    gst_bench_stream_add_chunk (stream, offset, stream->data->len - offset,
+        frame, intra);
+  }
+
+  g_rand_free (rand);
+
+  return stream;
+}
+
+/* JPEG: 640x480 baseline 4:2:0 frames, the tables are only there to be
+ * skipped, jpegparse does not look into them */
+
+static const guint8 jpeg_header[] = {
+  0xff, 0xd8,                   /* SOI */
+  0xff, 0xe0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01,
+  0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,     /* APP0 */
+  0xff, 0xdb, 0x00, 0x43, 0x00  /* DQT, followed by 64 entries */
+};
+
+static const guint8 jpeg_frame[] = {
+  0xff, 0xc0, 0x00, 0x11, 0x08, 0x01, 0xe0, 0x02, 0x80, 0x03,
+  0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01, /* SOF0 */
+  0xff, 0xc4, 0x00, 0x13, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   /* DHT */
+  0xff, 0xda, 0x00, 0x0c, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11,
+  0x00, 0x3f, 0x00              /* SOS */
+};
+
+/**
+ * gst_bench_stream_new_jpeg:
+ * @size: approximate size of the stream
+ *
+ * Generates a stream of JPEG images with one chunk per image.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_jpeg (gsize size)
+{
+  const guint8 eoi[] = { 0xff, 0xd9 };
+  const guint8 stuffing = 0x00;
+  GstBenchStream *stream;
+  GRand *rand = g_rand_new_with_seed (SEED);
+  guint frame, i, len;
+
+  stream = gst_bench_stream_new ("image/jpeg, width = (int) 640, "
+      "height = (int) 480, framerate = (fraction) 25/1");
+
+  for (frame = 0; stream->data->len < size; frame++) {
+    guint offset = stream->data->len;
+
+    put_bytes (stream->data, jpeg_header, sizeof (jpeg_header));
+    for (i = 0; i < 64; i++) {
+      guint8 q = 1 + i / 4;
+
+      put_bytes (stream->data, &q, 1);
+    }
+    put_bytes (stream->data, jpeg_frame, sizeof (jpeg_frame));
+
+    /* entropy coded data, 0xff is followed by a stuffing byte */
+    len = g_rand_int_range (rand, 30000, 50000);
+    for (i = 0; i < len; i++) {
+      guint8 b = g_rand_int (rand);
+
+      put_bytes (stream->data, &b, 1);
+      if (b == 0xff)
+        put_bytes (stream->data, &stuffing, 1);
+    }
+    put_bytes (stream->data, eoi, sizeof (eoi));
+
+    gst_bench_stream_add_chunk (stream, offset, stream->data->len - offset,
+        frame, TRUE);
+  }
+
+  g_rand_free (rand);
+
+  return stream;
+}
+
+/* frames of random data, all sharing the same data */
+static GstBenchStream *
+gst_bench_stream_new_video (gsize size, const gchar * caps, guint frame_size)
+{
+  GstBenchStream *stream = gst_bench_stream_new (caps);
+  GRand *rand = g_rand_new_with_seed (SEED);
+  guint frame;
+
+  put_random (rand, stream->data, frame_size);
+  for (frame = 0; (gsize) frame * frame_size < size; frame++)
+    gst_bench_stream_add_chunk (stream, 0, frame_size, frame, TRUE);
+
+  g_rand_free (rand);
+
+  return stream;
+}
+
+/**
+ * gst_bench_stream_new_raw_video:
+ * @size: approximate size of the stream
+ *
+ * Generates a stream of 720x576 UYVY frames. All frames share the same
+ * data.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_raw_video (gsize size)
+{
+  return gst_bench_stream_new_video (size,
+      "video/x-raw, format = (string) UYVY, "
+      "width = (int) 720, height = (int) 576, framerate = (fraction) 25/1, "
+      "pixel-aspect-ratio = (fraction) 16/15, "
+      "interlace-mode = (string) progressive", 720 * 576 * 2);
+}
+
+/**
+ * gst_bench_stream_new_ayuv:
+ * @size: approximate size of the stream
+ * @width: width of the frames
+ * @height: height of the frames
+ *
+ * Generates a stream of @width x @height AYUV frames, at least one. All
+ * frames share the same data.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_ayuv (gsize size, gint width, gint height)
+{
+  GstBenchStream *stream;
+  gchar *caps;
+
+  caps = g_strdup_printf ("video/x-raw, format = (string) AYUV, "
+      "width = (int) %d, height = (int) %d, framerate = (fraction) 25/1, "
+      "pixel-aspect-ratio = (fraction) 1/1, "
+      "interlace-mode = (string) progressive", width, height);
+  stream = gst_bench_stream_new_video (size, caps, width * height * 4);
+  g_free (caps);
+
+  return stream;
+}
+
+/**
+ * gst_bench_stream_new_from_data:
+ * @data: (transfer full): the stream data
+ * @caps: the caps of the stream
+ *
+ * Makes a stream of @data, pushed in #GST_BENCH_BLOCKSIZE chunks without
+ * timestamps, the way filesrc would push it.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_from_data (GByteArray * data, const gchar * caps)
+{
+  GstBenchStream *stream = gst_bench_stream_new (caps);
+
+  g_byte_array_unref (stream->data);
+  stream->data = data;
+  gst_bench_stream_add_blocks (stream);
+
+  return stream;
+}
+
+/**
+ * gst_bench_stream_new_unaligned:
+ * @stream: a stream
+ * @caps: the caps of the new stream
+ *
+ * Makes a stream with the data of @stream, pushed in #GST_BENCH_BLOCKSIZE
+ * chunks without timestamps. @stream must not share data between chunks.
+ *
+ * Returns: the new stream.
+ */
+GstBenchStream *
+gst_bench_stream_new_unaligned (const GstBenchStream * stream,
+    const gchar * caps)
+{
+  GstBenchStream *unaligned;
+
+  unaligned =
+      gst_bench_stream_new_from_data (g_byte_array_ref (stream->data), caps);
+  unaligned->n_nals = stream->n_nals;
+
+  return unaligned;
+}
+
+void
+gst_bench_stream_free (GstBenchStream * stream)
+{
+  g_byte_array_unref (stream->data);
+  g_array_free (stream->chunks, TRUE);
+  gst_caps_unref (stream->caps);
+  g_slice_free (GstBenchStream, stream);
+}
+
+gsize
+gst_bench_stream_get_size (const GstBenchStream * stream)
+{
+  gsize size = 0;
+  guint i;
+
+  for (i = 0; i < stream->chunks->len; i++)
+    size += g_array_index (stream->chunks, GstBenchChunk, i).size;
+
+  return size;
+}
@@ -0,0 +1,89 @@
+/* GStreamer
+ *
+ * streams.h: synthetic streams for the throughput benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_BENCH_STREAMS_H__
+#define __GST_BENCH_STREAMS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* blocksize streams are chunked with when they are not frame aligned,
+ * the same as the default of filesrc */
+#define GST_BENCH_BLOCKSIZE 4096
+
+typedef struct _GstBenchChunk GstBenchChunk;
+typedef struct _GstBenchStream GstBenchStream;
+
+/**
+ * GstBenchChunk:
+ * @offset: offset of the chunk in the stream data
+ * @size: size of the chunk
+ * @pts: presentation timestamp or #GST_CLOCK_TIME_NONE
+ * @dts: decoding timestamp or #GST_CLOCK_TIME_NONE
+ * @keyframe: %TRUE if the chunk can be decoded on its own
+ *
+ * One input buffer of a stream.
+ */
+struct _GstBenchChunk
+{
+  guint offset;
+  guint size;
+  GstClockTime pts;
+  GstClockTime dts;
+  gboolean keyframe;
+};
+
+/**
+ * GstBenchStream:
+ * @data: the stream data
+ * @chunks: the #GstBenchChunk the stream is pushed in
+ * @caps: the caps of the stream
+ * @n_nals: number of H.264 NAL units in the stream, 0 for other formats
+ *
+ * A stream generated in memory. Chunks may refer to the same data more
+ * than once, so the size of the stream is the sum of the chunk sizes and
+ * not the size of @data.
+ */
+struct _GstBenchStream
+{
+  GByteArray *data;
+  GArray *chunks;
+  GstCaps *caps;
+  guint n_nals;
+};
+
+GstBenchStream *gst_bench_stream_new_h264 (gsize size);
+GstBenchStream *gst_bench_stream_new_mpeg2 (gsize size);
+GstBenchStream *gst_bench_stream_new_jpeg (gsize size);
+GstBenchStream *gst_bench_stream_new_raw_video (gsize size);
+GstBenchStream *gst_bench_stream_new_ayuv (gsize size, gint width,
+    gint height);
+GstBenchStream *gst_bench_stream_new_from_data (GByteArray * data,
+    const gchar * caps);
+GstBenchStream *gst_bench_stream_new_unaligned (const GstBenchStream * stream,
+    const gchar * caps);
+void gst_bench_stream_free (GstBenchStream * stream);
+
+gsize gst_bench_stream_get_size (const GstBenchStream * stream);
+
+G_END_DECLS
+
+#endif /* __GST_BENCH_STREAMS_H__ */
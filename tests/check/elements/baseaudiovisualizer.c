@@ -65,10 +65,24 @@ static GType gst_test_scope_get_type (void);
 
 G_DEFINE_TYPE (GstTestScope, gst_test_scope, GST_TYPE_AUDIO_VISUALIZER);
 
+/* draws a white pixel in the top left corner */
+static gboolean
+gst_test_scope_render (GstAudioVisualizer * scope, GstBuffer * audio,
+    GstVideoFrame * video)
+{
+  guint32 *vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
+
+  vdata[0] = 0x00ffffff;
+  return TRUE;
+}
+
 static void
 gst_test_scope_class_init (GstTestScopeClass * g_class)
 {
   GstElementClass *element_class = GST_ELEMENT_CLASS (g_class);
+  GstAudioVisualizerClass *scope_class = GST_AUDIO_VISUALIZER_CLASS (g_class);
+
+  scope_class->render = GST_DEBUG_FUNCPTR (gst_test_scope_render);
 
   gst_element_class_set_static_metadata (element_class, "test scope",
       "Visualization",
@@ -154,6 +168,196 @@ GST_START_TEST (count_in_out)
 
 GST_END_TEST;
 
+GST_START_TEST (downscale)
+{
+  GstElement *elem;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GstMapInfo map;
+  guint32 *vdata;
+  gint x, y;
+
+  elem = gst_check_setup_element ("testscope");
+  g_object_set (elem, "downscale", 4, NULL);
+  srcpad = gst_check_setup_src_pad (elem, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (elem, &sinktemplate);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (elem,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (CAPS);
+  gst_check_setup_events (srcpad, elem, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  buffer = gst_buffer_new_and_alloc (44100 * 2 * sizeof (gint16));
+  fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 30);
+
+  /* the scope renders at 80x60, so its pixel covers 4x4 output pixels */
+  fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&GST_AUDIO_VISUALIZER
+          (elem)->vinfo), 80);
+  fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&GST_AUDIO_VISUALIZER
+          (elem)->vinfo), 60);
+
+  buffer = GST_BUFFER (g_list_last (buffers)->data);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), 320 * 240 * 4);
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  vdata = (guint32 *) map.data;
+  for (y = 0; y < 5; y++) {
+    for (x = 0; x < 5; x++) {
+      guint32 expected = (x < 4 && y < 4) ? 0x00ffffff : 0;
+
+      fail_unless_equals_int (vdata[y * 320 + x], expected);
+    }
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  /* clean up */
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (elem);
+  gst_check_teardown_sink_pad (elem);
+  gst_check_teardown_element (elem);
+}
+
+GST_END_TEST;
+
+/* where the shader takes the pixel at x,y from, or FALSE if it leaves it
+ * alone */
+static gboolean
+shader_source (GstAudioVisualizerShader shader, gint x, gint y, gint w, gint h,
+    gint * sx, gint * sy)
+{
+  *sx = x;
+  *sy = y;
+
+  switch (shader) {
+    case GST_AUDIO_VISUALIZER_SHADER_FADE:
+      return TRUE;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_UP:
+      *sy = y + 1;
+      return y < h - 1;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_DOWN:
+      *sy = y - 1;
+      return y > 0;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_LEFT:
+      *sx = x + 1;
+      return x < w - 1;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_RIGHT:
+      *sx = x - 1;
+      return x > 0;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_HORIZ_OUT:
+      *sy = (y < h / 2) ? y + 1 : y - 1;
+      return y != h / 2;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_HORIZ_IN:
+      *sy = (y < h / 2) ? y - 1 : y + 1;
+      return y > 0 && y < h - 1;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_VERT_OUT:
+      *sx = (x < w / 2) ? x + 1 : x - 1;
+      return x != w / 2;
+    case GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_VERT_IN:
+      *sx = (x < w / 2) ? x - 1 : x + 1;
+      return x > 0 && x < w - 1;
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+  }
+}
+
+static guint32
+shade_reference (guint32 p, guint32 amount)
+{
+  guint32 r = 0;
+  gint c;
+
+  for (c = 0; c < 24; c += 8) {
+    gint v = ((p >> c) & 0xff) - ((amount >> c) & 0xff);
+
+    r |= (guint32) MAX (v, 0) << c;
+  }
+  return r;
+}
+
+static void
+map_test_frame (GstVideoFrame * frame, gint width, gint height)
+{
+  GstVideoInfo info;
+  GstBuffer *buf;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_xRGB, width, height);
+  buf = gst_buffer_new_allocate (NULL, info.size, NULL);
+  fail_unless (gst_video_frame_map (frame, &info, buf, GST_MAP_READWRITE));
+  gst_buffer_unref (buf);
+}
+
+static void
+unmap_test_frame (GstVideoFrame * frame)
+{
+  gst_video_frame_unmap (frame);
+}
+
+GST_START_TEST (shaders)
+{
+  /* odd sizes to get the unrolled and the tail parts of the kernels */
+  static const gint sizes[][2] = { {37, 10}, {37, 11}, {3, 3}, {64, 4} };
+  GstAudioVisualizer *scope;
+  GstVideoFrame sframe, dframe;
+  guint32 amount = 0x00105aff;
+  gint shader, i, x, y, sx, sy;
+
+  scope = g_object_new (GST_TYPE_TEST_SCOPE, NULL);
+  g_object_set (scope, "shade-amount", amount, NULL);
+
+  for (shader = GST_AUDIO_VISUALIZER_SHADER_FADE;
+      shader <= GST_AUDIO_VISUALIZER_SHADER_FADE_AND_MOVE_VERT_IN; shader++) {
+    g_object_set (scope, "shader", shader, NULL);
+    fail_unless (scope->shader != NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+      gint w = sizes[i][0], h = sizes[i][1];
+      guint32 *s, *d;
+
+      map_test_frame (&sframe, w, h);
+      map_test_frame (&dframe, w, h);
+      s = GST_VIDEO_FRAME_PLANE_DATA (&sframe, 0);
+      d = GST_VIDEO_FRAME_PLANE_DATA (&dframe, 0);
+      for (x = 0; x < w * h; x++) {
+        s[x] = g_random_int ();
+        d[x] = 0xdeadbeef;
+      }
+
+      scope->shader (scope, &sframe, &dframe);
+
+      for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+          guint32 expected = 0xdeadbeef;
+
+          if (shader_source (shader, x, y, w, h, &sx, &sy))
+            expected = shade_reference (s[sy * w + sx], amount);
+          fail_unless (d[y * w + x] == expected,
+              "shader %d, %dx%d: pixel %d,%d is 0x%08x instead of 0x%08x",
+              shader, w, h, x, y, d[y * w + x], expected);
+        }
+      }
+
+      unmap_test_frame (&sframe);
+      unmap_test_frame (&dframe);
+    }
+  }
+
+  gst_object_unref (scope);
+}
+
+GST_END_TEST;
+
 static void
 baseaudiovisualizer_init (void)
 {
@@ -170,6 +374,8 @@ baseaudiovisualizer_suite (void)
   tcase_add_checked_fixture (tc_chain, baseaudiovisualizer_init, NULL);
 
   tcase_add_test (tc_chain, count_in_out);
+  tcase_add_test (tc_chain, downscale);
+  tcase_add_test (tc_chain, shaders);
 
   return s;
 }
@@ -916,6 +916,72 @@ GST_START_TEST (test_multiple_video_recordings)
 
 GST_END_TEST;
 
+GST_START_TEST (test_warm_video_recordings)
+{
+  gint i;
+
+  if (!camera)
+    return;
+
+  g_object_set (camera, "mode", 2, "location", video_filename,
+      "warm-recording", TRUE, NULL);
+
+  if (gst_element_set_state (GST_ELEMENT (camera), GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE) {
+    GST_WARNING ("setting camerabin to PLAYING failed");
+    gst_element_set_state (GST_ELEMENT (camera), GST_STATE_NULL);
+    gst_object_unref (camera);
+    camera = NULL;
+  }
+
+  GST_INFO ("starting capture");
+  fail_unless (camera != NULL);
+  for (i = 0; i < 2; i++) {
+    GstMessage *msg;
+    guint64 latency = 0;
+
+    /* the file for the first recording was opened when going to PAUSED,
+     * the later ones are prepared asynchronously after video-done */
+    if (i == 0)
+      fail_unless (g_file_test (make_const_file_name (video_filename, i),
+              G_FILE_TEST_EXISTS));
+
+    g_signal_emit_by_name (camera, "start-capture", NULL);
+
+    msg = wait_for_element_message (camera, "video-capture-started",
+        GST_CLOCK_TIME_NONE);
+    fail_unless (msg != NULL);
+    fail_unless (gst_structure_get_uint64 (gst_message_get_structure (msg),
+            "latency", &latency));
+    GST_INFO ("recording %d started after %" GST_TIME_FORMAT, i,
+        GST_TIME_ARGS (latency));
+    gst_message_unref (msg);
+
+    g_timeout_add_seconds (VIDEO_DURATION, (GSourceFunc) g_main_loop_quit,
+        main_loop);
+    g_main_loop_run (main_loop);
+    g_signal_emit_by_name (camera, "stop-capture", NULL);
+
+    msg = wait_for_element_message (camera, "video-done", GST_CLOCK_TIME_NONE);
+    fail_unless (msg != NULL);
+    gst_message_unref (msg);
+
+    wait_for_idle_state ();
+  }
+  gst_element_set_state (GST_ELEMENT (camera), GST_STATE_NULL);
+
+  /* the file prepared for a third recording is gone again */
+  fail_if (g_file_test (make_const_file_name (video_filename, 2),
+          G_FILE_TEST_EXISTS));
+
+  for (i = 0; i < 2; i++) {
+    check_file_validity (video_filename, i, NULL, 0, 0, WITH_AUDIO);
+    remove_file (video_filename, i);
+  }
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_image_video_cycle)
 {
   gint i;
@@ -1604,6 +1670,7 @@ camerabin_suite (void)
       GST_WARNING ("Skipping image capture test because -good 0.10.27 is "
           "needed");
     tcase_add_test (tc_basic, test_multiple_video_recordings);
+    tcase_add_test (tc_basic, test_warm_video_recordings);
 
     tcase_add_test (tc_basic, test_image_capture_previews);
     tcase_add_test (tc_basic, test_image_capture_with_tags);
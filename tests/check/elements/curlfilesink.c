@@ -434,6 +434,55 @@ GST_START_TEST (test_missing_path)
 
 GST_END_TEST;
 
+GST_START_TEST (test_missing_path_queued)
+{
+  GstElement *sink;
+  GstCaps *caps;
+  const gchar *location = "file:///missing/path/";
+  gchar *file_name = g_strdup_printf ("curlfilesink_%d", g_random_int ());
+  const gchar *file_content = "line 1\r\n";
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint i;
+
+  sink = setup_curlfilesink ();
+
+  g_object_set (G_OBJECT (sink), "location", location, NULL);
+  g_object_set (G_OBJECT (sink), "file-name", file_name, NULL);
+  g_free (file_name);
+  g_object_set (G_OBJECT (sink), "max-size-bytes", 4 * 1024 * 1024, NULL);
+
+  /* start playing */
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+  caps = gst_caps_from_string ("application/x-gst-check");
+  gst_check_setup_events (srcpad, sink, caps, GST_FORMAT_BYTES);
+
+  /* the first buffer is only queued */
+  test_set_and_play_buffer (file_content);
+
+  /* the error of the transfer thread is returned by a later render */
+  for (i = 0; i < 500 && ret == GST_FLOW_OK; i++) {
+    GstBuffer *buffer;
+
+    g_usleep (10 * 1000);
+    buffer = gst_buffer_new ();
+    gst_buffer_insert_memory (buffer, 0,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+            (gpointer) file_content, strlen (file_content), 0,
+            strlen (file_content), NULL, NULL));
+    ret = gst_pad_push (srcpad, buffer);
+  }
+  fail_unless (ret == GST_FLOW_ERROR);
+
+  /* eos */
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+
+  gst_caps_unref (caps);
+  cleanup_curlfilesink (sink);
+}
+
+GST_END_TEST;
+
 static Suite *
 curlsink_suite (void)
 {
@@ -447,6 +496,7 @@ curlsink_suite (void)
   tcase_add_test (tc_chain, test_one_big_file);
   tcase_add_test (tc_chain, test_two_files);
   tcase_add_test (tc_chain, test_missing_path);
+  tcase_add_test (tc_chain, test_missing_path_queued);
   tcase_add_test (tc_chain, test_create_dirs);
 
   return s;
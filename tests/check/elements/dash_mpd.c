@@ -0,0 +1,157 @@
+/* GStreamer
+ *
+ * unit test for the DASH MPD parser
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "../../ext/dash/gstmpdparser.c"
+#undef GST_CAT_DEFAULT
+
+GST_DEBUG_CATEGORY (gst_dash_demux_debug);
+
+/* a live MPD where only the AdaptationSet has a SegmentTemplate, the usual
+ * layout of live streams */
+#define MPD_ADAPT_SET_TEMPLATE(timeline) \
+    "<?xml version=\"1.0\"?>" \
+    "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\"" \
+    "     minimumUpdatePeriod=\"PT2S\"" \
+    "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\">" \
+    "  <Period id=\"p0\" start=\"PT0S\">" \
+    "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">" \
+    "      <SegmentTemplate timescale=\"10\" media=\"$Number$.m4s\"" \
+    "                       startNumber=\"1\">" \
+    "        <SegmentTimeline>" timeline "</SegmentTimeline>" \
+    "      </SegmentTemplate>" \
+    "      <Representation id=\"v0\" bandwidth=\"250000\"" \
+    "                      width=\"320\" height=\"240\"/>" \
+    "    </AdaptationSet>" \
+    "  </Period>" \
+    "</MPD>"
+
+static GstMpdClient *
+setup_client (const gchar * xml)
+{
+  GstMpdClient *client = gst_mpd_client_new ();
+
+  fail_unless (gst_mpd_parse (client, xml, strlen (xml)));
+  fail_unless (gst_mpd_client_setup_media_presentation (client));
+  fail_unless (gst_mpd_client_setup_streaming (client, GST_STREAM_VIDEO, ""));
+
+  return client;
+}
+
+GST_START_TEST (test_update_adaptation_set_template)
+{
+  const gchar *xml = MPD_ADAPT_SET_TEMPLATE ("<S t=\"0\" d=\"20\" r=\"2\"/>");
+  const gchar *update = MPD_ADAPT_SET_TEMPLATE ("<S t=\"20\" d=\"20\" r=\"3\"/>");
+  GstMpdClient *client;
+  GstActiveStream *stream;
+  GstAdaptationSetNode *adapt_set;
+  GstMultSegmentBaseType *mult_seg;
+  GstMediaSegment *segment;
+  GstSNode *S;
+
+  client = setup_client (xml);
+  stream = gst_mpdparser_get_active_stream_by_index (client, 0);
+  fail_unless (stream != NULL);
+  fail_unless_equals_int (stream->segments->len, 3);
+
+  /* the first segment expired and two were added */
+  fail_unless (gst_mpd_client_update (client, update, strlen (update)));
+
+  adapt_set = stream->cur_adapt_set;
+  fail_unless (adapt_set->SegmentTemplate != NULL);
+  fail_unless (stream->cur_seg_template == adapt_set->SegmentTemplate);
+  mult_seg = adapt_set->SegmentTemplate->MultSegBaseType;
+  fail_unless_equals_int (mult_seg->startNumber, 2);
+  fail_unless_equals_int (g_queue_get_length (&mult_seg->SegmentTimeline->S),
+      1);
+  S = g_queue_peek_head (&mult_seg->SegmentTimeline->S);
+  fail_unless_equals_uint64 (S->t, 20);
+  fail_unless_equals_uint64 (S->d, 20);
+  fail_unless_equals_int (S->r, 3);
+
+  fail_unless_equals_int (stream->segments->len, 4);
+  segment = g_ptr_array_index (stream->segments, 0);
+  fail_unless_equals_int (segment->number, 2);
+  fail_unless_equals_uint64 (segment->start_time, 2 * GST_SECOND);
+  segment = g_ptr_array_index (stream->segments, 3);
+  fail_unless_equals_int (segment->number, 5);
+  fail_unless_equals_uint64 (segment->start, 80);
+  fail_unless_equals_uint64 (segment->start_time, 8 * GST_SECOND);
+  fail_unless_equals_uint64 (segment->duration, 2 * GST_SECOND);
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_template_added)
+{
+  const gchar *xml = MPD_ADAPT_SET_TEMPLATE ("<S t=\"0\" d=\"20\" r=\"2\"/>");
+  const gchar *update =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" type=\"dynamic\""
+      "     minimumUpdatePeriod=\"PT2S\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\">"
+      "  <Period id=\"p0\" start=\"PT0S\">"
+      "    <AdaptationSet id=\"1\" mimeType=\"video/mp4\">"
+      "      <SegmentTemplate timescale=\"10\" media=\"$Number$.m4s\""
+      "                       startNumber=\"1\">"
+      "        <SegmentTimeline><S t=\"0\" d=\"20\" r=\"3\"/></SegmentTimeline>"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"v0\" bandwidth=\"250000\""
+      "                      width=\"320\" height=\"240\">"
+      "        <SegmentTemplate media=\"v0-$Number$.m4s\"/>"
+      "      </Representation>"
+      "    </AdaptationSet>"
+      "  </Period>"
+      "</MPD>";
+  GstMpdClient *client;
+  GstActiveStream *stream;
+
+  client = setup_client (xml);
+  stream = gst_mpdparser_get_active_stream_by_index (client, 0);
+
+  /* needs a full parse, the current client must not be touched */
+  fail_if (gst_mpd_client_update (client, update, strlen (update)));
+  fail_unless_equals_int (stream->segments->len, 3);
+
+  gst_mpd_client_free (client);
+}
+
+GST_END_TEST;
+
+static Suite *
+dash_mpd_suite (void)
+{
+  Suite *s = suite_create ("dash_mpd");
+  TCase *tc_chain = tcase_create ("update");
+
+  GST_DEBUG_CATEGORY_INIT (gst_dash_demux_debug, "mpd-test", 0,
+      "DASH MPD parser test");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_update_adaptation_set_template);
+  tcase_add_test (tc_chain, test_update_template_added);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dash_mpd);
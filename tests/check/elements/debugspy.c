@@ -0,0 +1,203 @@
+/* GStreamer
+ *
+ * unit test for debugspy
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+/* the xxHash64 implementation */
+#include "../../gst/debugutils/gstdebugchecksum.c"
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static guint64
+xxh64 (const guint8 * data, gsize len, gsize piece)
+{
+  GstXXH64State state;
+  gsize i;
+
+  gst_xxh64_reset (&state, 0);
+  for (i = 0; i < len; i += piece)
+    gst_xxh64_update (&state, data + i, MIN (piece, len - i));
+
+  return gst_xxh64_digest (&state);
+}
+
+GST_START_TEST (test_xxh64)
+{
+  guint8 data[1000];
+  guint i;
+
+  /* reference values of xxHash64 with the seed 0 */
+  fail_unless_equals_uint64 (xxh64 (NULL, 0, 1),
+      G_GUINT64_CONSTANT (0xef46db3751d8e999));
+  fail_unless_equals_uint64 (xxh64 ((const guint8 *) "abc", 3, 3),
+      G_GUINT64_CONSTANT (0x44bc2cf5ad770999));
+
+  /* the result does not depend on how the data is split, within and
+   * across the 32 byte stripes */
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i * 7 + 3;
+  fail_unless_equals_uint64 (xxh64 (data, sizeof (data), sizeof (data)),
+      G_GUINT64_CONSTANT (0x5f235fa033f1a3fb));
+  fail_unless_equals_uint64 (xxh64 (data, sizeof (data), 37),
+      G_GUINT64_CONSTANT (0x5f235fa033f1a3fb));
+  fail_unless_equals_uint64 (xxh64 (data, 80, 5),
+      G_GUINT64_CONSTANT (0x1efb52c793e16467));
+}
+
+GST_END_TEST;
+
+static GstElement *
+setup_debugspy (gboolean per_plane, GstBus ** bus)
+{
+  GstElement *debugspy;
+  GstVideoInfo info;
+  GstCaps *caps;
+
+  debugspy = gst_check_setup_element ("debugspy");
+  gst_util_set_object_arg (G_OBJECT (debugspy), "checksum-type", "xxhash64");
+  g_object_set (debugspy, "per-plane", per_plane, NULL);
+  mysrcpad = gst_check_setup_src_pad (debugspy, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (debugspy, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  *bus = gst_bus_new ();
+  gst_element_set_bus (debugspy, *bus);
+
+  fail_unless (gst_element_set_state (debugspy,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* rows of 6 and 3 bytes, padded to 8 and 4 */
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, 6, 4);
+  caps = gst_video_info_to_caps (&info);
+  gst_check_setup_events (mysrcpad, debugspy, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return debugspy;
+}
+
+static void
+cleanup_debugspy (GstElement * debugspy, GstBus * bus)
+{
+  gst_element_set_state (debugspy, GST_STATE_NULL);
+  gst_element_set_bus (debugspy, NULL);
+  gst_object_unref (bus);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (debugspy);
+  gst_check_teardown_sink_pad (debugspy);
+  gst_check_teardown_element (debugspy);
+}
+
+/* pushes an I420 frame with 'a', 'b' and 'c' in the visible part of the
+ * planes and 0xff in the padding, and checks the posted checksum */
+static void
+check_frame_checksum (GstElement * debugspy, GstBus * bus,
+    const gchar * expected)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  GstMessage *msg;
+  const GstStructure *s;
+  gint row;
+
+  buf = gst_buffer_new_allocate (NULL, 48, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0xff, map.size);
+  for (row = 0; row < 4; row++)
+    memset (map.data + row * 8, 'a', 6);
+  for (row = 0; row < 2; row++) {
+    memset (map.data + 32 + row * 4, 'b', 3);
+    memset (map.data + 40 + row * 4, 'c', 3);
+  }
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_name (s, "buffer"));
+  fail_unless_equals_string (gst_structure_get_string (s, "checksum"),
+      expected);
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_checksum)
+{
+  GstElement *debugspy;
+  GstBus *bus;
+
+  /* all the bytes, with the padding */
+  debugspy = setup_debugspy (FALSE, &bus);
+  check_frame_checksum (debugspy, bus, "0a821fcef6063f96");
+  cleanup_debugspy (debugspy, bus);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_checksum_per_plane)
+{
+  GstElement *debugspy;
+  GstBus *bus;
+
+  /* 24 times 'a', 6 times 'b' and 6 times 'c' */
+  debugspy = setup_debugspy (TRUE, &bus);
+  check_frame_checksum (debugspy, bus,
+      "2165434d658e73e5 6b9324e7dec826d1 323e0f7d2666b17d");
+  cleanup_debugspy (debugspy, bus);
+}
+
+GST_END_TEST;
+
+static Suite *
+debugspy_suite (void)
+{
+  Suite *s = suite_create ("debugspy");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_xxh64);
+  tcase_add_test (tc_chain, test_checksum);
+  tcase_add_test (tc_chain, test_checksum_per_plane);
+
+  return s;
+}
+
+GST_CHECK_MAIN (debugspy);
@@ -0,0 +1,201 @@
+/* GStreamer
+ *
+ * unit test for the subpicture blending of dvdspu
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+/* the SSE2 and the scalar blending */
+#include "../../gst/dvdspu/gstdvdspu-render.c"
+
+GST_DEBUG_CATEGORY (dvdspu_debug);
+
+#define FRAME_WIDTH 67
+#define FRAME_HEIGHT 35
+
+/* overlays at even and odd positions, with and without a tail for the
+ * scalar code, and clipped by the right and bottom edges */
+static const gint16 geometries[][4] = {
+  {0, 0, 64, 32},
+  {1, 1, 37, 13},
+  {2, 3, 9, 2},
+  {5, 7, 8, 1},
+  {3, 2, 66, 34},
+  {60, 30, 20, 20},
+};
+
+/* An overlay as rendered from SPU or PGS data: pre-multiplied luma, and
+ * chroma and alpha summed over the 2x2 blocks. The alpha is mostly fully
+ * transparent or opaque, as in subtitles, with some antialiasing. */
+static SpuOverlay *
+make_overlay (gint16 left, gint16 top, gint16 width, gint16 height)
+{
+  SpuOverlay *overlay;
+  gint x, y;
+
+  overlay = gstspu_overlay_new (left, top, width, height);
+  for (y = 0; y < height; y++) {
+    gint uv_row = ((top + y) / 2 - top / 2) * overlay->uv_width;
+
+    for (x = 0; x < width; x++) {
+      gint i = y * width + x;
+      gint j = uv_row + (left + x) / 2 - left / 2;
+      guint8 a;
+
+      switch (g_random_int_range (0, 4)) {
+        case 0:
+          a = 0;
+          break;
+        case 1:
+          a = g_random_int_range (1, 0xff);
+          break;
+        default:
+          a = 0xff;
+          break;
+      }
+      overlay->A[i] = a;
+      overlay->Y[i] = g_random_int_range (0, 0x100) * a;
+      overlay->U[j] += g_random_int_range (0, 0x100) * a;
+      overlay->V[j] += g_random_int_range (0, 0x100) * a;
+      overlay->UV_A[j] += a;
+    }
+  }
+
+  return overlay;
+}
+
+static void
+check_blend (GstVideoFormat format)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame, ref_frame;
+  GstBuffer *buf, *ref;
+  GstMapInfo map;
+  guint i, n;
+
+  g_random_set_seed (1);
+  gst_video_info_set_format (&info, format, FRAME_WIDTH, FRAME_HEIGHT);
+
+  for (i = 0; i < G_N_ELEMENTS (geometries); i++) {
+    for (n = 0; n < 10; n++) {
+      SpuOverlay *overlay;
+      gsize j;
+
+      overlay = make_overlay (geometries[i][0], geometries[i][1],
+          geometries[i][2], geometries[i][3]);
+
+      buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+      gst_buffer_map (buf, &map, GST_MAP_WRITE);
+      for (j = 0; j < map.size; j++)
+        map.data[j] = g_random_int_range (0, 0x100);
+      gst_buffer_unmap (buf, &map);
+      ref = gst_buffer_copy (buf);
+
+      fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_WRITE));
+      gstspu_overlay_blend (overlay, &frame);
+      gst_video_frame_unmap (&frame);
+
+      fail_unless (gst_video_frame_map (&ref_frame, &info, ref,
+              GST_MAP_WRITE));
+      gstspu_overlay_blend_lines (overlay, &ref_frame,
+          gstspu_blend_luma_line_c, gstspu_blend_chroma_line_c);
+      gst_video_frame_unmap (&ref_frame);
+
+      gst_buffer_map (ref, &map, GST_MAP_READ);
+      fail_unless (gst_buffer_memcmp (buf, 0, map.data, map.size) == 0,
+          "%s, overlay %ux%u at %u,%u: the blends differ",
+          gst_video_format_to_string (format), geometries[i][2],
+          geometries[i][3], geometries[i][0], geometries[i][1]);
+      gst_buffer_unmap (ref, &map);
+
+      gst_buffer_unref (buf);
+      gst_buffer_unref (ref);
+      gstspu_overlay_free (overlay);
+    }
+  }
+}
+
+GST_START_TEST (test_blend_i420)
+{
+  check_blend (GST_VIDEO_FORMAT_I420);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_blend_nv12)
+{
+  /* interleaved chroma, only the luma has a SIMD path */
+  check_blend (GST_VIDEO_FORMAT_NV12);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_blend_values)
+{
+  guint8 dest[] = { 0x00, 0x80, 0xff, 0x40, 0x10, 0x20, 0x30, 0x40, 0x50 };
+  guint8 ref[G_N_ELEMENTS (dest)];
+  guint16 Y[G_N_ELEMENTS (dest)];
+  guint8 A[G_N_ELEMENTS (dest)];
+  guint i;
+
+  /* opaque white, half transparent black, transparent, and the tail */
+  for (i = 0; i < G_N_ELEMENTS (dest); i++) {
+    switch (i % 3) {
+      case 0:
+        A[i] = 0xff;
+        Y[i] = 0xff * 0xff;
+        ref[i] = 0xff;
+        break;
+      case 1:
+        A[i] = 0x80;
+        Y[i] = 0;
+        ref[i] = (0x7f * dest[i]) / 0xff;
+        break;
+      default:
+        A[i] = 0;
+        Y[i] = 0;
+        ref[i] = dest[i];
+        break;
+    }
+  }
+
+  gstspu_blend_luma_line (dest, Y, A, G_N_ELEMENTS (dest));
+  for (i = 0; i < G_N_ELEMENTS (dest); i++)
+    fail_unless_equals_int (dest[i], ref[i]);
+}
+
+GST_END_TEST;
+
+static Suite *
+dvdspu_suite (void)
+{
+  Suite *s = suite_create ("dvdspu");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_blend_i420);
+  tcase_add_test (tc_chain, test_blend_nv12);
+  tcase_add_test (tc_chain, test_blend_values);
+
+  return s;
+}
+
+GST_CHECK_MAIN (dvdspu);
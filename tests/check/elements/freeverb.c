@@ -0,0 +1,356 @@
+/* GStreamer
+ *
+ * unit test for freeverb
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/audio/audio.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+#define FREEVERB_CAPS_TEMPLATE_STRING "audio/x-raw, " \
+    "format = (string) { " GST_AUDIO_NE (F32) ", " GST_AUDIO_NE (S16) " }, " \
+    "rate = (int) 44100, " \
+    "channels = (int) [ 1, 2 ], " \
+    "layout = (string) interleaved"
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (FREEVERB_CAPS_TEMPLATE_STRING));
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (FREEVERB_CAPS_TEMPLATE_STRING));
+
+/* Straight per-sample implementation of the reverb model with the element's
+ * default settings at 44.1kHz, the element must produce the exact same
+ * output */
+#define DC_OFFSET 1e-8
+#define NUM_COMBS 8
+#define NUM_ALLPASSES 4
+
+typedef struct
+{
+  gfloat feedback, filterstore, damp1, damp2;
+  gfloat *buffer;
+  gint bufsize, bufidx;
+} RefFilter;
+
+typedef struct
+{
+  RefFilter combL[NUM_COMBS], combR[NUM_COMBS];
+  RefFilter allpassL[NUM_ALLPASSES], allpassR[NUM_ALLPASSES];
+  gfloat gain, wet1, wet2, dry;
+} RefModel;
+
+static const gint comb_tuning[NUM_COMBS] =
+    { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+static const gint allpass_tuning[NUM_ALLPASSES] = { 556, 441, 341, 225 };
+
+static void
+ref_filter_init (RefFilter * f, gint size, gfloat feedback, gfloat damp)
+{
+  gint i;
+
+  f->feedback = feedback;
+  f->filterstore = 0;
+  f->damp1 = damp;
+  f->damp2 = 1 - damp;
+  f->buffer = g_new (gfloat, size);
+  f->bufsize = size;
+  f->bufidx = 0;
+  for (i = 0; i < size; i++)
+    f->buffer[i] = DC_OFFSET;
+}
+
+static void
+ref_model_init (RefModel * m)
+{
+  gfloat room_size = 0.5f, damping = 0.2f, width = 1.0f, level = 0.5f;
+  gfloat roomsize = (room_size * 0.28f) + 0.7f;
+  gfloat wet = level * 1.0f;
+  gint i;
+
+  for (i = 0; i < NUM_COMBS; i++) {
+    ref_filter_init (&m->combL[i], comb_tuning[i], roomsize, damping);
+    ref_filter_init (&m->combR[i], comb_tuning[i] + 23, roomsize, damping);
+  }
+  for (i = 0; i < NUM_ALLPASSES; i++) {
+    ref_filter_init (&m->allpassL[i], allpass_tuning[i], 0.5f, 0.0f);
+    ref_filter_init (&m->allpassR[i], allpass_tuning[i] + 23, 0.5f, 0.0f);
+  }
+  m->gain = 0.015f;
+  m->dry = (1.0 - level) * 1.0f;
+  m->wet1 = wet * (width / 2.0f + 0.5f);
+  m->wet2 = wet * ((1.0f - width) / 2.0f);
+}
+
+static void
+ref_model_free (RefModel * m)
+{
+  gint i;
+
+  for (i = 0; i < NUM_COMBS; i++) {
+    g_free (m->combL[i].buffer);
+    g_free (m->combR[i].buffer);
+  }
+  for (i = 0; i < NUM_ALLPASSES; i++) {
+    g_free (m->allpassL[i].buffer);
+    g_free (m->allpassR[i].buffer);
+  }
+}
+
+static gfloat
+ref_comb_process (RefFilter * f, gfloat input)
+{
+  gfloat tmp = f->buffer[f->bufidx];
+
+  f->filterstore = (tmp * f->damp2) + (f->filterstore * f->damp1);
+  f->buffer[f->bufidx] = input + (f->filterstore * f->feedback);
+  if (++f->bufidx >= f->bufsize)
+    f->bufidx = 0;
+  return tmp;
+}
+
+static gfloat
+ref_allpass_process (RefFilter * f, gfloat input)
+{
+  gfloat bufout = f->buffer[f->bufidx];
+
+  f->buffer[f->bufidx] = input + (bufout * f->feedback);
+  if (++f->bufidx >= f->bufsize)
+    f->bufidx = 0;
+  return bufout - input;
+}
+
+static void
+ref_model_process (RefModel * m, gfloat input_2l, gfloat input_2r,
+    gboolean mono, gfloat * out_l2, gfloat * out_r2)
+{
+  gfloat input_1l, input_1r, out_l1 = 0.0, out_r1 = 0.0;
+  gint i;
+
+  if (mono) {
+    input_1l = input_1r = (2.0f * input_2l + DC_OFFSET) * m->gain;
+  } else {
+    input_1l = (input_2l + DC_OFFSET) * m->gain;
+    input_1r = (input_2r + DC_OFFSET) * m->gain;
+  }
+
+  for (i = 0; i < NUM_COMBS; i++) {
+    out_l1 += ref_comb_process (&m->combL[i], input_1l);
+    out_r1 += ref_comb_process (&m->combR[i], input_1r);
+  }
+  for (i = 0; i < NUM_ALLPASSES; i++) {
+    out_l1 = ref_allpass_process (&m->allpassL[i], out_l1);
+    out_r1 = ref_allpass_process (&m->allpassR[i], out_r1);
+  }
+  out_l1 -= DC_OFFSET;
+  out_r1 -= DC_OFFSET;
+
+  *out_l2 = out_l1 * m->wet1 + out_r1 * m->wet2 + input_2l * m->dry;
+  *out_r2 = out_r1 * m->wet1 + out_l1 * m->wet2 + input_2r * m->dry;
+}
+
+static GstElement *
+setup_freeverb (const gchar * format, gint channels)
+{
+  GstElement *freeverb;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_freeverb");
+  freeverb = gst_check_setup_element ("freeverb");
+  mysrcpad = gst_check_setup_src_pad (freeverb, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (freeverb, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (freeverb,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, format,
+      "rate", G_TYPE_INT, 44100,
+      "channels", G_TYPE_INT, channels,
+      "layout", G_TYPE_STRING, "interleaved", NULL);
+  gst_check_setup_events (mysrcpad, freeverb, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return freeverb;
+}
+
+static void
+cleanup_freeverb (GstElement * freeverb)
+{
+  GST_DEBUG ("cleanup_freeverb");
+  gst_element_set_state (freeverb, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (freeverb);
+  gst_check_teardown_sink_pad (freeverb);
+  gst_check_teardown_element (freeverb);
+}
+
+/* buffer sizes that straddle the internal block size and the delay line
+ * lengths in different ways */
+static const gint buffer_sizes[] = { 1, 37, 255, 256, 257, 1000, 1617, 4096 };
+
+#define NUM_SAMPLES_TOTAL (1 + 37 + 255 + 256 + 257 + 1000 + 1617 + 4096)
+
+static gfloat
+test_signal (gint n, gint channel)
+{
+  /* a short noise-like burst followed by silence to get a long tail */
+  if (n >= 2000)
+    return 0.0;
+  return (gfloat) ((((n * 7919 + channel * 104729) % 2003) - 1001) * 16);
+}
+
+static void
+do_test (gboolean is_float, gint channels)
+{
+  GstElement *freeverb;
+  RefModel ref;
+  GList *l;
+  gint i, j, n = 0;
+
+  freeverb = setup_freeverb (is_float ? GST_AUDIO_NE (F32) :
+      GST_AUDIO_NE (S16), channels);
+
+  for (i = 0; i < G_N_ELEMENTS (buffer_sizes); i++) {
+    gint size = buffer_sizes[i];
+    gint bps = is_float ? sizeof (gfloat) : sizeof (gint16);
+    GstBuffer *inbuffer;
+    GstMapInfo map;
+
+    inbuffer = gst_buffer_new_and_alloc (size * channels * bps);
+    gst_buffer_map (inbuffer, &map, GST_MAP_WRITE);
+    for (j = 0; j < size * channels; j++) {
+      gfloat v = test_signal (n + j / channels, j % channels);
+
+      if (is_float)
+        ((gfloat *) map.data)[j] = v / 32768.0;
+      else
+        ((gint16 *) map.data)[j] = (gint16) v;
+    }
+    gst_buffer_unmap (inbuffer, &map);
+    n += size;
+
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+  fail_unless_equals_int (n, NUM_SAMPLES_TOTAL);
+  fail_unless_equals_int (g_list_length (buffers),
+      G_N_ELEMENTS (buffer_sizes));
+
+  ref_model_init (&ref);
+  n = 0;
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+    gint size;
+
+    gst_buffer_map (GST_BUFFER (l->data), &map, GST_MAP_READ);
+    size = map.size / (2 * (is_float ? sizeof (gfloat) : sizeof (gint16)));
+    for (j = 0; j < size; j++, n++) {
+      gfloat in_l, in_r, out_l, out_r;
+
+      in_l = test_signal (n, 0);
+      in_r = channels == 2 ? test_signal (n, 1) : in_l;
+      if (is_float) {
+        in_l = (gfloat) (in_l / 32768.0);
+        in_r = (gfloat) (in_r / 32768.0);
+      }
+      ref_model_process (&ref, in_l, in_r, channels == 1, &out_l, &out_r);
+
+      if (is_float) {
+        const gfloat *data = (const gfloat *) map.data;
+
+        fail_unless (memcmp (&data[2 * j], &out_l, sizeof (gfloat)) == 0,
+            "left sample %d differs: %g != %g", n, data[2 * j], out_l);
+        fail_unless (memcmp (&data[2 * j + 1], &out_r, sizeof (gfloat)) == 0,
+            "right sample %d differs: %g != %g", n, data[2 * j + 1], out_r);
+      } else {
+        const gint16 *data = (const gint16 *) map.data;
+
+        fail_unless_equals_int (data[2 * j],
+            (gint16) CLAMP (out_l, G_MININT16, G_MAXINT16));
+        fail_unless_equals_int (data[2 * j + 1],
+            (gint16) CLAMP (out_r, G_MININT16, G_MAXINT16));
+      }
+    }
+    gst_buffer_unmap (GST_BUFFER (l->data), &map);
+  }
+  fail_unless_equals_int (n, NUM_SAMPLES_TOTAL);
+  ref_model_free (&ref);
+
+  cleanup_freeverb (freeverb);
+}
+
+GST_START_TEST (test_mono_to_stereo_int)
+{
+  do_test (FALSE, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stereo_to_stereo_int)
+{
+  do_test (FALSE, 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mono_to_stereo_float)
+{
+  do_test (TRUE, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stereo_to_stereo_float)
+{
+  do_test (TRUE, 2);
+}
+
+GST_END_TEST;
+
+static Suite *
+freeverb_suite (void)
+{
+  Suite *s = suite_create ("freeverb");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mono_to_stereo_int);
+  tcase_add_test (tc_chain, test_stereo_to_stereo_int);
+  tcase_add_test (tc_chain, test_mono_to_stereo_float);
+  tcase_add_test (tc_chain, test_stereo_to_stereo_float);
+
+  return s;
+}
+
+GST_CHECK_MAIN (freeverb);
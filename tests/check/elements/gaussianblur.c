@@ -0,0 +1,289 @@
+/* GStreamer
+ *
+ * unit test for gaussianblur
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+#define GAUSSIANBLUR_CAPS_TEMPLATE_STRING GST_VIDEO_CAPS_MAKE ("AYUV")
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GAUSSIANBLUR_CAPS_TEMPLATE_STRING));
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GAUSSIANBLUR_CAPS_TEMPLATE_STRING));
+
+static GstElement *
+setup_gaussianblur (gint width, gint height, gdouble sigma, guint n_threads)
+{
+  GstElement *gaussianblur;
+  GstVideoInfo info;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_gaussianblur");
+  gaussianblur = gst_check_setup_element ("gaussianblur");
+  g_object_set (gaussianblur, "sigma", sigma, "n-threads", n_threads, NULL);
+  mysrcpad = gst_check_setup_src_pad (gaussianblur, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (gaussianblur, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (gaussianblur,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_AYUV, width, height);
+  caps = gst_video_info_to_caps (&info);
+  gst_check_setup_events (mysrcpad, gaussianblur, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return gaussianblur;
+}
+
+static void
+cleanup_gaussianblur (GstElement * gaussianblur)
+{
+  GST_DEBUG ("cleanup_gaussianblur");
+  gst_element_set_state (gaussianblur, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (gaussianblur);
+  gst_check_teardown_sink_pad (gaussianblur);
+  gst_check_teardown_element (gaussianblur);
+}
+
+typedef guint8 (*PixelFunc) (gint x, gint y, gint c);
+
+static guint8
+pixel_uniform (gint x, gint y, gint c)
+{
+  return 40 + 50 * c;
+}
+
+static guint8
+pixel_impulse (gint x, gint y, gint c)
+{
+  return (x == 50 && y == 20 && c == 1) ? 255 : 0;
+}
+
+static guint8
+pixel_noise (gint x, gint y, gint c)
+{
+  return ((x * 7919 + y * 104729 + c * 1009) % 2003) & 0xff;
+}
+
+static guint8
+pixel_edge (gint x, gint y, gint c)
+{
+  return x < 50 ? 64 : 192;
+}
+
+/* Blurs a frame of @width x @height filled by @func and returns the
+ * mapped output buffer in @map */
+static GstBuffer *
+blur_frame (gint width, gint height, gdouble sigma, guint n_threads,
+    PixelFunc func, GstMapInfo * map)
+{
+  GstElement *gaussianblur;
+  GstBuffer *inbuffer, *outbuffer;
+  GstMapInfo inmap;
+  gint x, y, c;
+
+  gaussianblur = setup_gaussianblur (width, height, sigma, n_threads);
+
+  inbuffer = gst_buffer_new_and_alloc (width * height * 4);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 0;
+  gst_buffer_map (inbuffer, &inmap, GST_MAP_WRITE);
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      for (c = 0; c < 4; c++)
+        inmap.data[(y * width + x) * 4 + c] = func (x, y, c);
+  gst_buffer_unmap (inbuffer, &inmap);
+
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  outbuffer = gst_buffer_ref (GST_BUFFER (buffers->data));
+  cleanup_gaussianblur (gaussianblur);
+
+  gst_buffer_map (outbuffer, map, GST_MAP_READ);
+  fail_unless_equals_int (map->size, width * height * 4);
+
+  return outbuffer;
+}
+
+#define WIDTH 101
+#define HEIGHT 41
+#define PIXEL(map,x,y,c) ((map).data[((y) * WIDTH + (x)) * 4 + (c)])
+
+GST_START_TEST (test_uniform)
+{
+  static const gdouble sigmas[] = { 0.5, 1.2, 5.0, 20.0, -1.0, -5.0 };
+  gint i, x, y, c;
+
+  for (i = 0; i < G_N_ELEMENTS (sigmas); i++) {
+    GstBuffer *outbuffer;
+    GstMapInfo map;
+
+    outbuffer = blur_frame (WIDTH, HEIGHT, sigmas[i], 0, pixel_uniform, &map);
+    for (y = 0; y < HEIGHT; y++)
+      for (x = 0; x < WIDTH; x++)
+        for (c = 0; c < 4; c++)
+          fail_unless_equals_int (PIXEL (map, x, y, c), pixel_uniform (x, y,
+                  c));
+    gst_buffer_unmap (outbuffer, &map);
+    gst_buffer_unref (outbuffer);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_identity)
+{
+  GstBuffer *outbuffer;
+  GstMapInfo map;
+  gint x, y, c;
+
+  outbuffer = blur_frame (WIDTH, HEIGHT, 0.0, 0, pixel_noise, &map);
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      for (c = 0; c < 4; c++)
+        fail_unless_equals_int (PIXEL (map, x, y, c), pixel_noise (x, y, c));
+  gst_buffer_unmap (outbuffer, &map);
+  gst_buffer_unref (outbuffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_impulse)
+{
+  GstBuffer *outbuffer;
+  GstMapInfo map;
+  gint d, sum = 0, x, y;
+
+  outbuffer = blur_frame (WIDTH, HEIGHT, 3.0, 0, pixel_impulse, &map);
+
+  /* the response is symmetric and decreases away from the centre */
+  for (d = 1; d < 15; d++) {
+    fail_unless_equals_int (PIXEL (map, 50 - d, 20, 1),
+        PIXEL (map, 50 + d, 20, 1));
+    fail_unless_equals_int (PIXEL (map, 50, 20 - d, 1),
+        PIXEL (map, 50, 20 + d, 1));
+    fail_unless_equals_int (PIXEL (map, 50 - d, 20, 1),
+        PIXEL (map, 50, 20 - d, 1));
+    fail_unless (PIXEL (map, 50 + d, 20, 1) <= PIXEL (map, 50 + d - 1, 20, 1));
+  }
+  fail_unless (PIXEL (map, 50, 20, 1) > 0);
+  fail_unless (PIXEL (map, 50, 20, 1) < 255);
+
+  /* the other components are untouched and the energy is roughly kept */
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++) {
+      fail_unless_equals_int (PIXEL (map, x, y, 0), 0);
+      fail_unless_equals_int (PIXEL (map, x, y, 2), 0);
+      fail_unless_equals_int (PIXEL (map, x, y, 3), 0);
+      sum += PIXEL (map, x, y, 1);
+    }
+  fail_unless (sum > 200 && sum < 310, "sum is %d", sum);
+
+  gst_buffer_unmap (outbuffer, &map);
+  gst_buffer_unref (outbuffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sharpen)
+{
+  GstBuffer *outbuffer;
+  GstMapInfo map;
+  gint y;
+
+  outbuffer = blur_frame (WIDTH, HEIGHT, -2.0, 0, pixel_edge, &map);
+
+  /* sharpening overshoots on both sides of the edge */
+  for (y = 0; y < HEIGHT; y++) {
+    fail_unless (PIXEL (map, 49, y, 0) < 64);
+    fail_unless (PIXEL (map, 50, y, 0) > 192);
+    fail_unless_equals_int (PIXEL (map, 0, y, 0), 64);
+    fail_unless_equals_int (PIXEL (map, WIDTH - 1, y, 0), 192);
+  }
+
+  gst_buffer_unmap (outbuffer, &map);
+  gst_buffer_unref (outbuffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads)
+{
+  static const gdouble sigmas[] = { 1.2, 7.0, -3.0 };
+  gint i, n;
+
+  /* the result must not depend on how the frame is split up */
+  for (i = 0; i < G_N_ELEMENTS (sigmas); i++) {
+    GstBuffer *refbuffer;
+    GstMapInfo refmap;
+
+    refbuffer = blur_frame (WIDTH, HEIGHT, sigmas[i], 1, pixel_noise, &refmap);
+    for (n = 2; n <= 5; n++) {
+      GstBuffer *outbuffer;
+      GstMapInfo map;
+
+      outbuffer = blur_frame (WIDTH, HEIGHT, sigmas[i], n, pixel_noise, &map);
+      fail_unless (memcmp (map.data, refmap.data, map.size) == 0);
+      gst_buffer_unmap (outbuffer, &map);
+      gst_buffer_unref (outbuffer);
+    }
+    gst_buffer_unmap (refbuffer, &refmap);
+    gst_buffer_unref (refbuffer);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+gaussianblur_suite (void)
+{
+  Suite *s = suite_create ("gaussianblur");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_uniform);
+  tcase_add_test (tc_chain, test_identity);
+  tcase_add_test (tc_chain, test_impulse);
+  tcase_add_test (tc_chain, test_sharpen);
+  tcase_add_test (tc_chain, test_threads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gaussianblur);
@@ -348,6 +348,92 @@ h264parse_packetized_suite (void)
   return s;
 }
 
+/* more slices than a buffer holds memories, so the converted AU can't be
+ * composed of the input memory and is copied instead */
+#define N_SLICES 20
+
+GST_START_TEST (test_parse_multi_slice)
+{
+  GstElement *h264parse;
+  GstPad *srcpad, *sinkpad;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint8 *data, *expected;
+  gsize size, offset;
+  gint i;
+
+  h264parse = gst_check_setup_element ("h264parse");
+  srcpad = gst_check_setup_src_pad (h264parse, &srctemplate);
+  sinkpad = gst_check_setup_sink_pad (h264parse, &sinktemplate_avc_au);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL);
+  gst_check_setup_events (srcpad, h264parse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+  fail_unless_equals_int (gst_element_set_state (h264parse,
+          GST_STATE_PLAYING), GST_STATE_CHANGE_SUCCESS);
+
+  /* SPS, PPS and one picture, all start codes replaced by nal lengths */
+  size = sizeof (h264_sps) + sizeof (h264_pps) +
+      N_SLICES * sizeof (h264_idrframe);
+  data = g_malloc (size);
+  expected = g_malloc (size);
+  memcpy (data, h264_sps, sizeof (h264_sps));
+  GST_WRITE_UINT32_BE (expected, sizeof (h264_sps) - 4);
+  memcpy (expected + 4, h264_sps + 4, sizeof (h264_sps) - 4);
+  offset = sizeof (h264_sps);
+  memcpy (data + offset, h264_pps, sizeof (h264_pps));
+  GST_WRITE_UINT32_BE (expected + offset, sizeof (h264_pps) - 4);
+  memcpy (expected + offset + 4, h264_pps + 4, sizeof (h264_pps) - 4);
+  offset += sizeof (h264_pps);
+  for (i = 0; i < N_SLICES; i++) {
+    memcpy (data + offset, h264_idrframe, sizeof (h264_idrframe));
+    /* first_mb_in_slice = 1, continues the picture */
+    if (i > 0)
+      data[offset + 5] = 0x48;
+    GST_WRITE_UINT32_BE (expected + offset, sizeof (h264_idrframe) - 4);
+    memcpy (expected + offset + 4, data + offset + 4,
+        sizeof (h264_idrframe) - 4);
+    offset += sizeof (h264_idrframe);
+  }
+
+  buf = gst_buffer_new_wrapped (data, size);
+  fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buf = buffers->data;
+  fail_unless (gst_buffer_n_memory (buf) <= gst_buffer_get_max_memory ());
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, size);
+  fail_unless (memcmp (map.data, expected, size) == 0);
+  gst_buffer_unmap (buf, &map);
+  g_free (expected);
+
+  gst_element_set_state (h264parse, GST_STATE_NULL);
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (h264parse);
+  gst_check_teardown_sink_pad (h264parse);
+  gst_check_teardown_element (h264parse);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_multi_slice_suite (void)
+{
+  Suite *s = suite_create ("h264parse_multi_slice");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_multi_slice);
+
+  return s;
+}
+
 
 /*
  * TODO:
@@ -438,5 +524,11 @@ main (int argc, char **argv)
   nf += srunner_ntests_failed (sr);
   srunner_free (sr);
 
+  s = h264parse_multi_slice_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
   return nf;
 }
@@ -0,0 +1,260 @@
+/* GStreamer
+ *
+ * unit test for interlace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("I420")));
+
+#define WIDTH 16
+#define HEIGHT 8
+#define N_FRAMES 4
+
+/* an output frame, with the input frames its top and bottom fields come
+ * from */
+typedef struct
+{
+  gint top;
+  gint bottom;
+  gint n_fields;
+  GstBufferFlags flags;
+} Output;
+
+static GstVideoInfo info;
+
+static GstElement *
+setup_interlace (const gchar * pattern, gboolean allow_rff)
+{
+  GstElement *interlace;
+  GstCaps *caps;
+
+  interlace = gst_check_setup_element ("interlace");
+  gst_util_set_object_arg (G_OBJECT (interlace), "field-pattern", pattern);
+  /* bands of 2 and 3 rows */
+  g_object_set (interlace, "allow-rff", allow_rff, "n-threads", 3, NULL);
+  mysrcpad = gst_check_setup_src_pad (interlace, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (interlace, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (interlace,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, WIDTH, HEIGHT);
+  GST_VIDEO_INFO_FPS_N (&info) = 24;
+  GST_VIDEO_INFO_FPS_D (&info) = 1;
+  caps = gst_video_info_to_caps (&info);
+  gst_check_setup_events (mysrcpad, interlace, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return interlace;
+}
+
+static void
+cleanup_interlace (GstElement * interlace)
+{
+  gst_element_set_state (interlace, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (interlace);
+  gst_check_teardown_sink_pad (interlace);
+  gst_check_teardown_element (interlace);
+}
+
+/* every sample of input frame @i */
+#define FRAME_VALUE(i) (0x10 * ((i) + 1))
+
+static void
+push_frames (void)
+{
+  GstVideoFrame frame;
+  GstBuffer *buf;
+  guint i, plane;
+  gint row;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+    fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_WRITE));
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (&frame); plane++) {
+      guint8 *data = GST_VIDEO_FRAME_PLANE_DATA (&frame, plane);
+      gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, plane);
+
+      for (row = 0; row < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, plane); row++)
+        memset (data + row * stride, FRAME_VALUE (i), stride);
+    }
+    gst_video_frame_unmap (&frame);
+
+    GST_BUFFER_TIMESTAMP (buf) = gst_util_uint64_scale (i, GST_SECOND, 24);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 24;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+}
+
+/* checks the woven fields, timestamps and flags of the output for a
+ * field rate of @field_rate */
+static void
+check_outputs (const Output * outputs, guint n_outputs, gint field_rate)
+{
+  const GstBufferFlags flags = GST_VIDEO_BUFFER_FLAG_TFF |
+      GST_VIDEO_BUFFER_FLAG_RFF | GST_VIDEO_BUFFER_FLAG_ONEFIELD |
+      GST_VIDEO_BUFFER_FLAG_INTERLACED;
+  GstVideoFrame frame;
+  GList *l;
+  guint i, plane;
+  gint row, x, fields = 0;
+
+  fail_unless_equals_int (g_list_length (buffers), n_outputs);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+    const Output *out = &outputs[i];
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf),
+        gst_util_uint64_scale (GST_SECOND, fields, field_rate));
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf),
+        gst_util_uint64_scale (GST_SECOND, out->n_fields, field_rate));
+    fail_unless_equals_int (GST_BUFFER_FLAGS (buf) & flags, out->flags);
+    fields += out->n_fields;
+
+    fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_READ));
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (&frame); plane++) {
+      const guint8 *data = GST_VIDEO_FRAME_PLANE_DATA (&frame, plane);
+      gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (&frame, plane);
+
+      for (row = 0; row < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, plane); row++) {
+        gint expected = FRAME_VALUE ((row & 1) ? out->bottom : out->top);
+
+        for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame, plane); x++)
+          fail_unless (data[row * stride + x] == expected,
+              "output %u, plane %u, row %d: %d instead of %d", i, plane, row,
+              data[row * stride + x], expected);
+      }
+    }
+    gst_video_frame_unmap (&frame);
+  }
+}
+
+GST_START_TEST (test_weave_2_3)
+{
+  /* the second field of every 3 field frame is woven with the next one */
+  static const Output outputs[] = {
+    {0, 0, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {1, 1, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {1, 2, 2, GST_VIDEO_BUFFER_FLAG_TFF | GST_VIDEO_BUFFER_FLAG_INTERLACED},
+    {2, 3, 2, GST_VIDEO_BUFFER_FLAG_TFF | GST_VIDEO_BUFFER_FLAG_INTERLACED},
+    {3, 3, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+  };
+  GstElement *interlace;
+
+  interlace = setup_interlace ("2:3", FALSE);
+  push_frames ();
+  check_outputs (outputs, G_N_ELEMENTS (outputs), 60);
+  cleanup_interlace (interlace);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_weave_2_3_rff)
+{
+  /* the 3 field frames are repeated with RFF, which swaps the field order
+   * of the following frames */
+  static const Output outputs[] = {
+    {0, 0, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {1, 1, 3, GST_VIDEO_BUFFER_FLAG_TFF | GST_VIDEO_BUFFER_FLAG_RFF},
+    {2, 2, 2, 0},
+    {3, 3, 3, GST_VIDEO_BUFFER_FLAG_RFF},
+  };
+  GstElement *interlace;
+
+  interlace = setup_interlace ("2:3", TRUE);
+  push_frames ();
+  check_outputs (outputs, G_N_ELEMENTS (outputs), 60);
+  cleanup_interlace (interlace);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_weave_2_3_3_2)
+{
+  static const Output outputs[] = {
+    {0, 0, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {1, 1, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {1, 2, 2, GST_VIDEO_BUFFER_FLAG_TFF | GST_VIDEO_BUFFER_FLAG_INTERLACED},
+    {2, 2, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {3, 3, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+  };
+  GstElement *interlace;
+
+  interlace = setup_interlace ("2:3:3:2", FALSE);
+  push_frames ();
+  check_outputs (outputs, G_N_ELEMENTS (outputs), 60);
+  cleanup_interlace (interlace);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_weave_1_1)
+{
+  /* the top field of the stored frame is copied into the next frame */
+  static const Output outputs[] = {
+    {0, 1, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+    {2, 3, 2, GST_VIDEO_BUFFER_FLAG_TFF},
+  };
+  GstElement *interlace;
+
+  interlace = setup_interlace ("1:1", FALSE);
+  push_frames ();
+  check_outputs (outputs, G_N_ELEMENTS (outputs), 24);
+  cleanup_interlace (interlace);
+}
+
+GST_END_TEST;
+
+static Suite *
+interlace_suite (void)
+{
+  Suite *s = suite_create ("interlace");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_weave_2_3);
+  tcase_add_test (tc_chain, test_weave_2_3_rff);
+  tcase_add_test (tc_chain, test_weave_2_3_3_2);
+  tcase_add_test (tc_chain, test_weave_1_1);
+
+  return s;
+}
+
+GST_CHECK_MAIN (interlace);
@@ -0,0 +1,265 @@
+/* GStreamer
+ *
+ * unit test for liveadder
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/audio/audio.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * sink pad we create; otherwise we always have to do get_pad, get_peer,
+ * and then remove references in every test function */
+static GstPad *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define RATE 8000
+#define PERIOD_MS 10
+/* samples of a period */
+#define PERIOD (RATE * PERIOD_MS / 1000)
+
+#define CAPS_STRING "audio/x-raw, " \
+    "format = (string) " GST_AUDIO_NE (S16) ", " \
+    "layout = (string) interleaved, " \
+    "rate = (int) 8000, " \
+    "channels = (int) 1"
+
+#define N_INPUTS 2
+
+static GstPad *srcpads[N_INPUTS];
+static GstPad *adder_sinkpads[N_INPUTS];
+
+/* sets up a liveadder in mix bus mode with two inputs, synchronising on a
+ * test clock that stays at 0 until the test advances it */
+static GstElement *
+setup_liveadder (GstClock ** clock)
+{
+  GstElement *adder;
+  GstCaps *caps;
+  gint i;
+
+  adder = gst_check_setup_element ("liveadder");
+  g_object_set (adder, "latency", 100, "period-time", PERIOD_MS, NULL);
+  mysinkpad = gst_check_setup_sink_pad (adder, &sinktemplate);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  for (i = 0; i < N_INPUTS; i++) {
+    adder_sinkpads[i] = gst_element_get_request_pad (adder, "sink_%u");
+    fail_unless (adder_sinkpads[i] != NULL);
+    srcpads[i] = gst_pad_new_from_static_template (&srctemplate, "src");
+    fail_unless (gst_pad_link (srcpads[i],
+            adder_sinkpads[i]) == GST_PAD_LINK_OK);
+    gst_pad_set_active (srcpads[i], TRUE);
+  }
+
+  *clock = gst_test_clock_new ();
+  gst_element_set_clock (adder, *clock);
+  gst_element_set_base_time (adder, 0);
+
+  fail_unless (gst_element_set_state (adder,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (CAPS_STRING);
+  for (i = 0; i < N_INPUTS; i++)
+    gst_check_setup_events (srcpads[i], adder, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return adder;
+}
+
+static void
+cleanup_liveadder (GstElement * adder, GstClock * clock)
+{
+  gint i;
+
+  gst_element_set_state (adder, GST_STATE_NULL);
+  gst_object_unref (clock);
+
+  gst_check_drop_buffers ();
+  for (i = 0; i < N_INPUTS; i++) {
+    gst_pad_set_active (srcpads[i], FALSE);
+    gst_pad_unlink (srcpads[i], adder_sinkpads[i]);
+    gst_element_release_request_pad (adder, adder_sinkpads[i]);
+    gst_object_unref (adder_sinkpads[i]);
+    gst_object_unref (srcpads[i]);
+  }
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_sink_pad (adder);
+  gst_check_teardown_element (adder);
+}
+
+/* pushes @n samples of @value starting at sample @offset into input @i */
+static void
+push_samples (gint i, guint64 offset, guint n, gint16 value)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gint16 *samples;
+  guint j;
+
+  buf = gst_buffer_new_allocate (NULL, n * sizeof (gint16), NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  samples = (gint16 *) map.data;
+  for (j = 0; j < n; j++)
+    samples[j] = value;
+  gst_buffer_unmap (buf, &map);
+  GST_BUFFER_TIMESTAMP (buf) = gst_util_uint64_scale_int (offset, GST_SECOND,
+      RATE);
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (n, GST_SECOND, RATE);
+  GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+
+  fail_unless_equals_int (gst_pad_push (srcpads[i], buf), GST_FLOW_OK);
+}
+
+/* lets the periods out by advancing the clock past their latency and waits
+ * until @n_periods were pushed */
+static void
+wait_for_periods (GstClock * clock, guint n_periods)
+{
+  gst_test_clock_set_time (GST_TEST_CLOCK (clock), GST_SECOND);
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < n_periods)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+}
+
+/* checks the timestamps, the size and the samples of period @n */
+static void
+check_period (guint n, const gint16 * expected)
+{
+  GstBuffer *buf = g_list_nth_data (buffers, n);
+  GstMapInfo map;
+  gint16 *samples;
+  guint i;
+
+  fail_unless (buf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf),
+      n * PERIOD_MS * GST_MSECOND);
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf),
+      PERIOD_MS * GST_MSECOND);
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, PERIOD * sizeof (gint16));
+  samples = (gint16 *) map.data;
+  for (i = 0; i < PERIOD; i++)
+    fail_unless (samples[i] == expected[i],
+        "period %u, sample %u: %d instead of %d", n, i, samples[i],
+        expected[i]);
+  gst_buffer_unmap (buf, &map);
+}
+
+GST_START_TEST (test_mix_bus_overlap)
+{
+  GstElement *adder;
+  GstClock *clock;
+  gint16 expected[3 * PERIOD];
+  guint i;
+
+  adder = setup_liveadder (&clock);
+
+  /* 20 ms from 5 ms, and 10 ms from 12.5 ms overlapping it, neither of
+   * them on a period boundary */
+  push_samples (0, PERIOD / 2, 2 * PERIOD, 1000);
+  push_samples (1, PERIOD + PERIOD / 4, PERIOD, -300);
+  wait_for_periods (clock, 3);
+
+  /* the periods start at 0 and cover both inputs, with silence around
+   * them */
+  for (i = 0; i < 3 * PERIOD; i++) {
+    expected[i] = 0;
+    if (i >= PERIOD / 2 && i < PERIOD / 2 + 2 * PERIOD)
+      expected[i] += 1000;
+    if (i >= PERIOD + PERIOD / 4 && i < 2 * PERIOD + PERIOD / 4)
+      expected[i] -= 300;
+  }
+  for (i = 0; i < 3; i++) {
+    check_period (i, expected + i * PERIOD);
+    fail_if (GST_BUFFER_FLAG_IS_SET (g_list_nth_data (buffers, i),
+            GST_BUFFER_FLAG_GAP));
+  }
+
+  cleanup_liveadder (adder, clock);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mix_bus_gap)
+{
+  GstElement *adder;
+  GstClock *clock;
+  gint16 expected[PERIOD];
+  guint i;
+
+  adder = setup_liveadder (&clock);
+
+  /* the second input at half the volume, saturating the sum */
+  g_object_set (adder_sinkpads[1], "volume", 0.5, NULL);
+
+  push_samples (0, 0, PERIOD, 30000);
+  push_samples (1, 0, PERIOD, 10000);
+  /* nothing in the second period */
+  push_samples (0, 2 * PERIOD, PERIOD, -1000);
+  wait_for_periods (clock, 3);
+
+  for (i = 0; i < PERIOD; i++)
+    expected[i] = G_MAXINT16;
+  check_period (0, expected);
+  fail_if (GST_BUFFER_FLAG_IS_SET (buffers->data, GST_BUFFER_FLAG_GAP));
+
+  for (i = 0; i < PERIOD; i++)
+    expected[i] = 0;
+  check_period (1, expected);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buffers->next->data,
+          GST_BUFFER_FLAG_GAP));
+
+  for (i = 0; i < PERIOD; i++)
+    expected[i] = -1000;
+  check_period (2, expected);
+  fail_if (GST_BUFFER_FLAG_IS_SET (buffers->next->next->data,
+          GST_BUFFER_FLAG_GAP));
+
+  cleanup_liveadder (adder, clock);
+}
+
+GST_END_TEST;
+
+static Suite *
+liveadder_suite (void)
+{
+  Suite *s = suite_create ("liveadder");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mix_bus_overlap);
+  tcase_add_test (tc_chain, test_mix_bus_gap);
+
+  return s;
+}
+
+GST_CHECK_MAIN (liveadder);
@@ -0,0 +1,269 @@
+/* GStreamer
+ *
+ * unit test for mpegpsmux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpeg"));
+
+#define VIDEO_CAPS_STRING "video/mpeg, " \
+                          "mpegversion = (int) 2, " \
+                          "systemstream = (boolean) false"
+
+/* pack header with an SCR of 90000 (1 second) and the default mux rate of
+ * 1024 * 50 bytes/s */
+static const guint8 pack_header[] = {
+  0x00, 0x00, 0x01, 0xba, 0x44, 0x00, 0x16, 0xfc, 0x84, 0x01,
+  0x00, 0x10, 0x03, 0xf8
+};
+
+/* system header with a rate bound of 2048, one video stream 0xe0 and a
+ * buffer bound of 400 kB */
+static const guint8 system_header[] = {
+  0x00, 0x00, 0x01, 0xbb, 0x00, 0x09, 0x80, 0x10, 0x01, 0x00,
+  0x21, 0x7f, 0xe0, 0xe1, 0x90
+};
+
+/* program stream map with the MPEG-2 video stream 0xe0 */
+static const guint8 program_stream_map[] = {
+  0x00, 0x00, 0x01, 0xbc, 0x00, 0x0e, 0xe1, 0xff, 0x00, 0x00,
+  0x00, 0x04, 0x02, 0xe0, 0x00, 0x00, 0xa6, 0xdf, 0x32, 0x3c
+};
+
+/* PES headers of the two buffers, with a PTS of 90000 and 93600 */
+static const guint8 pes_header_1[] = {
+  0x00, 0x00, 0x01, 0xe0, 0x03, 0xf0, 0x81, 0x80, 0x05, 0x21,
+  0x00, 0x05, 0xbf, 0x21
+};
+
+static const guint8 pes_header_2[] = {
+  0x00, 0x00, 0x01, 0xe0, 0x01, 0xfc, 0x81, 0x80, 0x05, 0x21,
+  0x00, 0x05, 0xdb, 0x41
+};
+
+static const guint8 end_code[] = { 0x00, 0x00, 0x01, 0xb9 };
+
+#define PAYLOAD_SIZE_1 1000
+#define PAYLOAD_SIZE_2 500
+
+static GstElement *
+setup_psmux (GstPad ** muxsinkpad)
+{
+  GstElement *mux;
+  GstCaps *caps;
+
+  mux = gst_check_setup_element ("mpegpsmux");
+  mysrcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  *muxsinkpad = gst_element_get_request_pad (mux, "sink_%u");
+  fail_unless (*muxsinkpad != NULL);
+  fail_unless (gst_pad_link (mysrcpad, *muxsinkpad) == GST_PAD_LINK_OK);
+  mysinkpad = gst_check_setup_sink_pad (mux, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return mux;
+}
+
+static void
+cleanup_psmux (GstElement * mux, GstPad * muxsinkpad)
+{
+  gst_element_set_state (mux, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_unlink (mysrcpad, muxsinkpad);
+  gst_element_release_request_pad (mux, muxsinkpad);
+  gst_object_unref (muxsinkpad);
+  gst_object_unref (mysrcpad);
+  mysrcpad = NULL;
+  gst_check_teardown_sink_pad (mux);
+  gst_check_teardown_element (mux);
+}
+
+static void
+push_buffer (gsize size, GstClockTime pts, gboolean delta, guint8 first)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize i;
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < size; i++)
+    map.data[i] = first + i;
+  gst_buffer_unmap (buf, &map);
+  GST_BUFFER_PTS (buf) = pts;
+  if (delta)
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+}
+
+/* checks that @size bytes of the counting pattern starting at @first are
+ * at @data */
+static void
+check_payload (const guint8 * data, gsize size, guint8 first)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    fail_unless (data[i] == (guint8) (first + i),
+        "payload byte %" G_GSIZE_FORMAT ": 0x%02x instead of 0x%02x", i,
+        data[i], (guint8) (first + i));
+}
+
+static void
+check_bytes (const guint8 * data, const guint8 * expected, gsize size,
+    const gchar * what)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    fail_unless (data[i] == expected[i],
+        "%s byte %" G_GSIZE_FORMAT ": 0x%02x instead of 0x%02x", what, i,
+        data[i], expected[i]);
+}
+
+GST_START_TEST (test_headers_and_payload)
+{
+  GstElement *mux;
+  GstPad *muxsinkpad;
+  GstBuffer *buf;
+  GstMapInfo map;
+  const guint8 *data;
+
+  mux = setup_psmux (&muxsinkpad);
+
+  push_buffer (PAYLOAD_SIZE_1, GST_SECOND, FALSE, 0);
+  push_buffer (PAYLOAD_SIZE_2, GST_SECOND + 40 * GST_MSECOND, TRUE, 0x80);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  fail_unless_equals_int (g_list_length (buffers), 3);
+
+  /* the first pack starts with all the headers */
+  buf = GST_BUFFER (buffers->data);
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      sizeof (pack_header) + sizeof (system_header) +
+      sizeof (program_stream_map) + sizeof (pes_header_1) + PAYLOAD_SIZE_1);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  data = map.data;
+  check_bytes (data, pack_header, sizeof (pack_header), "pack header");
+  data += sizeof (pack_header);
+  check_bytes (data, system_header, sizeof (system_header), "system header");
+  data += sizeof (system_header);
+  check_bytes (data, program_stream_map, sizeof (program_stream_map),
+      "program stream map");
+  data += sizeof (program_stream_map);
+  check_bytes (data, pes_header_1, sizeof (pes_header_1), "PES header");
+  data += sizeof (pes_header_1);
+  check_payload (data, PAYLOAD_SIZE_1, 0);
+  gst_buffer_unmap (buf, &map);
+
+  /* the second one within the pack of the first, without headers */
+  buf = GST_BUFFER (buffers->next->data);
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      sizeof (pes_header_2) + PAYLOAD_SIZE_2);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  check_bytes (map.data, pes_header_2, sizeof (pes_header_2), "PES header");
+  check_payload (map.data + sizeof (pes_header_2), PAYLOAD_SIZE_2, 0x80);
+  gst_buffer_unmap (buf, &map);
+
+  buf = GST_BUFFER (buffers->next->next->data);
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (end_code));
+  fail_unless (gst_buffer_memcmp (buf, 0, end_code, sizeof (end_code)) == 0);
+
+  cleanup_psmux (mux, muxsinkpad);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_streamheader)
+{
+  GstElement *mux;
+  GstPad *muxsinkpad;
+  GstCaps *caps;
+  const GValue *streamheader;
+  GstBuffer *buf;
+
+  mux = setup_psmux (&muxsinkpad);
+
+  push_buffer (PAYLOAD_SIZE_1, GST_SECOND, FALSE, 0);
+
+  /* the system header and the program stream map */
+  caps = gst_pad_get_current_caps (mysinkpad);
+  fail_unless (caps != NULL);
+  streamheader = gst_structure_get_value (gst_caps_get_structure (caps, 0),
+      "streamheader");
+  fail_unless (streamheader != NULL);
+  fail_unless (GST_VALUE_HOLDS_ARRAY (streamheader));
+  fail_unless_equals_int (gst_value_array_get_size (streamheader), 2);
+
+  buf = gst_value_get_buffer (gst_value_array_get_value (streamheader, 0));
+  fail_unless_equals_int (gst_buffer_get_size (buf), sizeof (system_header));
+  fail_unless (gst_buffer_memcmp (buf, 0, system_header,
+          sizeof (system_header)) == 0);
+  buf = gst_value_get_buffer (gst_value_array_get_value (streamheader, 1));
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      sizeof (program_stream_map));
+  fail_unless (gst_buffer_memcmp (buf, 0, program_stream_map,
+          sizeof (program_stream_map)) == 0);
+  gst_caps_unref (caps);
+
+  cleanup_psmux (mux, muxsinkpad);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegpsmux_suite (void)
+{
+  Suite *s = suite_create ("mpegpsmux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_headers_and_payload);
+  tcase_add_test (tc_chain, test_streamheader);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegpsmux);
@@ -0,0 +1,647 @@
+/* GStreamer
+ *
+ * unit test for pcapparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("raw/x-pcap"));
+
+/* what arrived on the pad of a flow */
+typedef struct
+{
+  GstPad *pad;
+  GList *buffers;
+  gboolean eos;
+} Flow;
+
+static GList *flows;
+
+#define PCAP_HEADER_LEN 24
+#define RECORD_HEADER_LEN 16
+/* ethernet, IPv4 and UDP headers */
+#define UDP_PACKET_HEADER_LEN (14 + 20 + 8)
+
+/* the microsecond and the nanosecond format */
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+
+static guint8 *
+write_pcap_header (guint8 * data, guint32 magic)
+{
+  GST_WRITE_UINT32_LE (data, magic);
+  GST_WRITE_UINT16_LE (data + 4, 2);
+  GST_WRITE_UINT16_LE (data + 6, 4);
+  GST_WRITE_UINT32_LE (data + 8, 0);
+  GST_WRITE_UINT32_LE (data + 12, 0);
+  GST_WRITE_UINT32_LE (data + 16, 65535);
+  /* ethernet */
+  GST_WRITE_UINT32_LE (data + 20, 1);
+
+  return data + PCAP_HEADER_LEN;
+}
+
+/* writes an ethernet frame with an UDP packet from port @src_port to
+ * @dst_port on 127.0.0.1 with @size bytes of @payload */
+static guint8 *
+write_udp_frame (guint8 * data, guint16 src_port, guint16 dst_port,
+    guint8 payload, guint size)
+{
+  guint len = UDP_PACKET_HEADER_LEN + size;
+  guint8 *ip, *udp;
+
+  memset (data, 0, UDP_PACKET_HEADER_LEN);
+  GST_WRITE_UINT16_BE (data + 12, 0x0800);
+
+  ip = data + 14;
+  ip[0] = 0x45;
+  GST_WRITE_UINT16_BE (ip + 2, 20 + 8 + size);
+  ip[8] = 64;
+  ip[9] = 17;
+  GST_WRITE_UINT32_BE (ip + 12, 0x7f000001);
+  GST_WRITE_UINT32_BE (ip + 16, 0x7f000001);
+
+  udp = ip + 20;
+  GST_WRITE_UINT16_BE (udp, src_port);
+  GST_WRITE_UINT16_BE (udp + 2, dst_port);
+  GST_WRITE_UINT16_BE (udp + 4, 8 + size);
+
+  memset (udp + 8, payload, size);
+
+  return data + len;
+}
+
+/* writes a record with an UDP frame, @ts_frac is in microseconds or
+ * nanoseconds depending on the format */
+static guint8 *
+write_udp_packet (guint8 * data, guint ts_frac, guint16 src_port,
+    guint16 dst_port, guint8 payload, guint size)
+{
+  guint len = UDP_PACKET_HEADER_LEN + size;
+
+  GST_WRITE_UINT32_LE (data, 0);
+  GST_WRITE_UINT32_LE (data + 4, ts_frac);
+  GST_WRITE_UINT32_LE (data + 8, len);
+  GST_WRITE_UINT32_LE (data + 12, len);
+
+  return write_udp_frame (data + RECORD_HEADER_LEN, src_port, dst_port,
+      payload, size);
+}
+
+static void
+write_uint16 (guint8 * data, guint16 val, gboolean big_endian)
+{
+  if (big_endian)
+    GST_WRITE_UINT16_BE (data, val);
+  else
+    GST_WRITE_UINT16_LE (data, val);
+}
+
+static void
+write_uint32 (guint8 * data, guint32 val, gboolean big_endian)
+{
+  if (big_endian)
+    GST_WRITE_UINT32_BE (data, val);
+  else
+    GST_WRITE_UINT32_LE (data, val);
+}
+
+/* pcapng block types */
+#define SECTION_HEADER 0x0a0d0d0a
+#define INTERFACE_DESCRIPTION 0x00000001
+#define SIMPLE_PACKET 0x00000003
+#define NAME_RESOLUTION 0x00000004
+#define ENHANCED_PACKET 0x00000006
+
+/* writes a pcapng block with @len bytes of @body, padded to 32 bits */
+static guint8 *
+write_pcapng_block (guint8 * data, guint32 type, const guint8 * body,
+    guint len, gboolean big_endian)
+{
+  guint block_len = 12 + GST_ROUND_UP_4 (len);
+
+  write_uint32 (data, type, big_endian);
+  write_uint32 (data + 4, block_len, big_endian);
+  memcpy (data + 8, body, len);
+  memset (data + 8 + len, 0, GST_ROUND_UP_4 (len) - len);
+  write_uint32 (data + block_len - 4, block_len, big_endian);
+
+  return data + block_len;
+}
+
+/* an ethernet interface, with timestamps in units of 10^-@tsresol seconds
+ * if @tsresol isn't 0 */
+static guint8 *
+write_pcapng_interface (guint8 * data, guint8 tsresol, gboolean big_endian)
+{
+  guint8 body[20] = { 0, };
+  guint len = 8;
+
+  write_uint16 (body, 1, big_endian);
+  write_uint32 (body + 4, 65535, big_endian);
+  if (tsresol) {
+    /* if_tsresol, then opt_endofopt */
+    write_uint16 (body + 8, 9, big_endian);
+    write_uint16 (body + 10, 1, big_endian);
+    body[12] = tsresol;
+    len = 20;
+  }
+
+  return write_pcapng_block (data, INTERFACE_DESCRIPTION, body, len,
+      big_endian);
+}
+
+/* an enhanced packet block on interface @if_id */
+static guint8 *
+write_pcapng_packet (guint8 * data, guint32 if_id, guint64 ts, guint8 payload,
+    guint size, gboolean big_endian)
+{
+  guint len = UDP_PACKET_HEADER_LEN + size;
+  guint8 *body = g_malloc (20 + len);
+
+  write_uint32 (body, if_id, big_endian);
+  write_uint32 (body + 4, ts >> 32, big_endian);
+  write_uint32 (body + 8, ts & 0xffffffff, big_endian);
+  write_uint32 (body + 12, len, big_endian);
+  write_uint32 (body + 16, len, big_endian);
+  write_udp_frame (body + 20, 5004, 5000, payload, size);
+  data = write_pcapng_block (data, ENHANCED_PACKET, body, 20 + len,
+      big_endian);
+  g_free (body);
+
+  return data;
+}
+
+/* a simple packet block, which has no timestamp */
+static guint8 *
+write_pcapng_simple_packet (guint8 * data, guint8 payload, guint size,
+    gboolean big_endian)
+{
+  guint len = UDP_PACKET_HEADER_LEN + size;
+  guint8 *body = g_malloc (4 + len);
+
+  write_uint32 (body, len, big_endian);
+  write_udp_frame (body + 4, 5004, 5000, payload, size);
+  data = write_pcapng_block (data, SIMPLE_PACKET, body, 4 + len, big_endian);
+  g_free (body);
+
+  return data;
+}
+
+static GstFlowReturn
+flow_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  Flow *flow = g_object_get_data (G_OBJECT (pad), "flow");
+
+  flow->buffers = g_list_append (flow->buffers, buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+flow_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  Flow *flow = g_object_get_data (G_OBJECT (pad), "flow");
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    flow->eos = TRUE;
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+pad_added_cb (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  Flow *flow = g_new0 (Flow, 1);
+
+  flow->pad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  g_object_set_data (G_OBJECT (flow->pad), "flow", flow);
+  gst_pad_set_chain_function (flow->pad, flow_chain);
+  gst_pad_set_event_function (flow->pad, flow_event);
+  gst_pad_set_active (flow->pad, TRUE);
+  fail_unless_equals_int (gst_pad_link (pad, flow->pad), GST_PAD_LINK_OK);
+
+  flows = g_list_append (flows, flow);
+}
+
+static void
+check_flow (Flow * flow, guint8 payload, const GstClockTime * timestamps,
+    guint n_buffers)
+{
+  GList *l;
+  guint i;
+
+  fail_unless (flow->eos);
+  fail_unless_equals_int (g_list_length (flow->buffers), n_buffers);
+  for (l = flow->buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf), timestamps[i]);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 100 + i);
+    fail_unless_equals_int (map.data[0], payload);
+    fail_unless_equals_int (map.data[map.size - 1], payload);
+    gst_buffer_unmap (buf, &map);
+  }
+}
+
+static void
+free_flow (Flow * flow)
+{
+  gst_pad_set_active (flow->pad, FALSE);
+  gst_object_unref (flow->pad);
+  g_list_free_full (flow->buffers, (GDestroyNotify) gst_buffer_unref);
+  g_free (flow);
+}
+
+GST_START_TEST (test_split_flows)
+{
+  static const GstClockTime ts_a[] = { 0, 20 * GST_MSECOND, 40 * GST_MSECOND };
+  static const GstClockTime ts_b[] = { 10 * GST_MSECOND, 30 * GST_MSECOND };
+  GstElement *pcapparse;
+  GstCaps *caps;
+  GstBuffer *buf;
+  guint8 *data, *p;
+  gsize size;
+
+  pcapparse = gst_check_setup_element ("pcapparse");
+  g_object_set (pcapparse, "split-flows", TRUE, NULL);
+  g_signal_connect (pcapparse, "pad-added", G_CALLBACK (pad_added_cb), NULL);
+  mysrcpad = gst_check_setup_src_pad (pcapparse, &srctemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  fail_unless (gst_element_set_state (pcapparse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("raw/x-pcap");
+  gst_check_setup_events (mysrcpad, pcapparse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  /* two flows taking turns, 5004 -> 5000 and 5006 -> 5002 */
+  size = PCAP_HEADER_LEN +
+      5 * (RECORD_HEADER_LEN + UDP_PACKET_HEADER_LEN + 102);
+  p = data = g_malloc0 (size);
+  p = write_pcap_header (p, PCAP_MAGIC);
+  p = write_udp_packet (p, 0, 5004, 5000, 0xaa, 100);
+  p = write_udp_packet (p, 10000, 5006, 5002, 0xbb, 100);
+  p = write_udp_packet (p, 20000, 5004, 5000, 0xaa, 101);
+  p = write_udp_packet (p, 30000, 5006, 5002, 0xbb, 101);
+  p = write_udp_packet (p, 40000, 5004, 5000, 0xaa, 102);
+  size = p - data;
+
+  /* split in the middle of a packet */
+  buf = gst_buffer_new_wrapped (g_memdup (data, 100), 100);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  buf = gst_buffer_new_wrapped (g_memdup (data + 100, size - 100),
+      size - 100);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  g_free (data);
+
+  gst_pad_push_event (mysrcpad, gst_event_new_eos ());
+
+  fail_unless_equals_int (g_list_length (flows), 2);
+  check_flow (flows->data, 0xaa, ts_a, G_N_ELEMENTS (ts_a));
+  check_flow (flows->next->data, 0xbb, ts_b, G_N_ELEMENTS (ts_b));
+
+  gst_element_set_state (pcapparse, GST_STATE_NULL);
+  g_list_free_full (flows, (GDestroyNotify) free_flow);
+  flows = NULL;
+
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (pcapparse);
+  gst_check_teardown_element (pcapparse);
+}
+
+GST_END_TEST;
+
+static GstElement *
+setup_pcapparse (void)
+{
+  GstElement *pcapparse;
+  GstCaps *caps;
+
+  pcapparse = gst_check_setup_element ("pcapparse");
+  mysrcpad = gst_check_setup_src_pad (pcapparse, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (pcapparse, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (pcapparse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("raw/x-pcap");
+  gst_check_setup_events (mysrcpad, pcapparse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  return pcapparse;
+}
+
+static void
+cleanup_pcapparse (GstElement * pcapparse)
+{
+  gst_element_set_state (pcapparse, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (pcapparse);
+  gst_check_teardown_sink_pad (pcapparse);
+  gst_check_teardown_element (pcapparse);
+}
+
+/* pushes @size bytes of @data in two buffers, split in a record */
+static void
+push_capture (const guint8 * data, gsize size)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_new_wrapped (g_memdup (data, 100), 100);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  buf = gst_buffer_new_wrapped (g_memdup (data + 100, size - 100),
+      size - 100);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  gst_pad_push_event (mysrcpad, gst_event_new_eos ());
+}
+
+/* checks that buffer i has 100 + i bytes of @payloads[i] */
+static void
+check_buffers (const guint8 * payloads, const GstClockTime * timestamps,
+    guint n_buffers)
+{
+  GList *l;
+  guint i;
+
+  fail_unless_equals_int (g_list_length (buffers), n_buffers);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf), timestamps[i]);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 100 + i);
+    fail_unless_equals_int (map.data[0], payloads[i]);
+    fail_unless_equals_int (map.data[map.size - 1], payloads[i]);
+    gst_buffer_unmap (buf, &map);
+  }
+}
+
+GST_START_TEST (test_nanosecond_timestamps)
+{
+  static const guint8 payloads[] = { 0xaa, 0xbb };
+  static const GstClockTime timestamps[] = { 1500, 2000250 };
+  GstElement *pcapparse;
+  guint8 *data, *p;
+
+  pcapparse = setup_pcapparse ();
+
+  p = data = g_malloc0 (PCAP_HEADER_LEN +
+      2 * (RECORD_HEADER_LEN + UDP_PACKET_HEADER_LEN + 101));
+  p = write_pcap_header (p, PCAP_MAGIC_NSEC);
+  p = write_udp_packet (p, 1500, 5004, 5000, 0xaa, 100);
+  p = write_udp_packet (p, 2000250, 5004, 5000, 0xbb, 101);
+  push_capture (data, p - data);
+  g_free (data);
+
+  check_buffers (payloads, timestamps, G_N_ELEMENTS (payloads));
+
+  cleanup_pcapparse (pcapparse);
+}
+
+GST_END_TEST;
+
+static void
+check_pcapng (gboolean big_endian)
+{
+  static const guint8 payloads[] = { 0xaa, 0xbb, 0xcc };
+  static const GstClockTime timestamps[] = {
+    GST_SECOND + 123, 2 * GST_SECOND, GST_CLOCK_TIME_NONE
+  };
+  GstElement *pcapparse;
+  guint8 shb[16], nrb[4] = { 0, };
+  guint8 *data, *p;
+
+  pcapparse = setup_pcapparse ();
+
+  p = data = g_malloc0 (1024);
+  /* byte order magic, version 1.0 and an unknown section length */
+  write_uint32 (shb, 0x1a2b3c4d, big_endian);
+  write_uint16 (shb + 4, 1, big_endian);
+  write_uint16 (shb + 6, 0, big_endian);
+  memset (shb + 8, 0xff, 8);
+  p = write_pcapng_block (p, SECTION_HEADER, shb, sizeof (shb), big_endian);
+  /* nanoseconds, then the default microseconds */
+  p = write_pcapng_interface (p, 9, big_endian);
+  p = write_pcapng_interface (p, 0, big_endian);
+  p = write_pcapng_packet (p, 0, G_GUINT64_CONSTANT (1000000123), 0xaa, 100,
+      big_endian);
+  /* skipped */
+  p = write_pcapng_block (p, NAME_RESOLUTION, nrb, sizeof (nrb), big_endian);
+  p = write_pcapng_packet (p, 1, 2000000, 0xbb, 101, big_endian);
+  /* on the first interface */
+  p = write_pcapng_simple_packet (p, 0xcc, 102, big_endian);
+  push_capture (data, p - data);
+  g_free (data);
+
+  check_buffers (payloads, timestamps, G_N_ELEMENTS (payloads));
+
+  cleanup_pcapparse (pcapparse);
+}
+
+GST_START_TEST (test_pcapng)
+{
+  check_pcapng (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pcapng_big_endian)
+{
+  check_pcapng (TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pace)
+{
+  static const guint8 payloads[] = { 0xaa, 0xbb, 0xcc };
+  static const GstClockTime timestamps[] = {
+    0, 20 * GST_MSECOND, 40 * GST_MSECOND
+  };
+  GstElement *pcapparse;
+  GstClock *clock;
+  GstClockTime base_time;
+  guint8 *data, *p;
+
+  pcapparse = setup_pcapparse ();
+  g_object_set (pcapparse, "pace", TRUE, NULL);
+  clock = gst_system_clock_obtain ();
+  gst_element_set_clock (pcapparse, clock);
+  base_time = gst_clock_get_time (clock);
+  gst_element_set_base_time (pcapparse, base_time);
+
+  p = data = g_malloc0 (PCAP_HEADER_LEN +
+      3 * (RECORD_HEADER_LEN + UDP_PACKET_HEADER_LEN + 102));
+  p = write_pcap_header (p, PCAP_MAGIC);
+  p = write_udp_packet (p, 0, 5004, 5000, 0xaa, 100);
+  p = write_udp_packet (p, 20000, 5004, 5000, 0xbb, 101);
+  p = write_udp_packet (p, 40000, 5004, 5000, 0xcc, 102);
+  push_capture (data, p - data);
+  g_free (data);
+
+  /* the last packet was held back until 40 ms after the first one */
+  fail_unless (gst_clock_get_time (clock) - base_time >= 40 * GST_MSECOND);
+  check_buffers (payloads, timestamps, G_N_ELEMENTS (payloads));
+
+  gst_element_set_clock (pcapparse, NULL);
+  gst_object_unref (clock);
+  cleanup_pcapparse (pcapparse);
+}
+
+GST_END_TEST;
+
+/* the capture pulled by pcapparse */
+static guint8 *pull_data;
+static gsize pull_size;
+
+static GstFlowReturn
+pull_getrange (GstPad * pad, GstObject * parent, guint64 offset,
+    guint length, GstBuffer ** buffer)
+{
+  if (offset >= pull_size)
+    return GST_FLOW_EOS;
+
+  length = MIN (length, pull_size - offset);
+  *buffer = gst_buffer_new_wrapped (g_memdup (pull_data + offset, length),
+      length);
+  GST_BUFFER_OFFSET (*buffer) = offset;
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+pull_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_SCHEDULING) {
+    gst_query_set_scheduling (query, GST_SCHEDULING_FLAG_SEEKABLE, 1, -1, 0);
+    gst_query_add_scheduling_mode (query, GST_PAD_MODE_PULL);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+#define PULL_PACKETS 800
+#define PULL_PAYLOAD_SIZE 1400
+
+GST_START_TEST (test_pull_mode)
+{
+  GstElement *pcapparse;
+  GList *l;
+  guint8 *p;
+  guint i;
+
+  /* more than the 1 MiB pulled at once, so that records span two pulls */
+  pull_size = PCAP_HEADER_LEN + PULL_PACKETS *
+      (RECORD_HEADER_LEN + UDP_PACKET_HEADER_LEN + PULL_PAYLOAD_SIZE);
+  p = pull_data = g_malloc0 (pull_size);
+  p = write_pcap_header (p, PCAP_MAGIC);
+  for (i = 0; i < PULL_PACKETS; i++)
+    p = write_udp_packet (p, i * 1000, 5004, 5000, i & 0xff,
+        PULL_PAYLOAD_SIZE);
+  fail_unless (pull_size > 1024 * 1024);
+
+  pcapparse = gst_check_setup_element ("pcapparse");
+  mysrcpad = gst_check_setup_src_pad (pcapparse, &srctemplate);
+  gst_pad_set_getrange_function (mysrcpad, pull_getrange);
+  gst_pad_set_query_function (mysrcpad, pull_query);
+  mysinkpad = gst_check_setup_sink_pad (pcapparse, &sinktemplate);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  /* activates our src pad in pull mode and starts the task */
+  fail_unless (gst_element_set_state (pcapparse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+  fail_unless (GST_PAD_MODE (mysrcpad) == GST_PAD_MODE_PULL);
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < PULL_PACKETS)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf), i * GST_MSECOND);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, PULL_PAYLOAD_SIZE);
+    fail_unless_equals_int (map.data[0], i & 0xff);
+    fail_unless_equals_int (map.data[map.size - 1], i & 0xff);
+    gst_buffer_unmap (buf, &map);
+  }
+
+  gst_element_set_state (pcapparse, GST_STATE_NULL);
+  g_free (pull_data);
+  pull_data = NULL;
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (pcapparse);
+  gst_check_teardown_sink_pad (pcapparse);
+  gst_check_teardown_element (pcapparse);
+}
+
+GST_END_TEST;
+
+static Suite *
+pcapparse_suite (void)
+{
+  Suite *s = suite_create ("pcapparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_split_flows);
+  tcase_add_test (tc_chain, test_nanosecond_timestamps);
+  tcase_add_test (tc_chain, test_pcapng);
+  tcase_add_test (tc_chain, test_pcapng_big_endian);
+  tcase_add_test (tc_chain, test_pace);
+  tcase_add_test (tc_chain, test_pull_mode);
+
+  return s;
+}
+
+GST_CHECK_MAIN (pcapparse);
@@ -0,0 +1,219 @@
+/* GStreamer
+ *
+ * unit test for perfprobe
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define BUFFER_SIZE 100
+
+/* pushes a buffer with @pts, a few milliseconds after the previous one so
+ * that the 1 ms interval of the probes is over */
+static void
+push_buffer (GstClockTime pts)
+{
+  GstBuffer *buf;
+
+  g_usleep (2000);
+  buf = gst_buffer_new_allocate (NULL, BUFFER_SIZE, NULL);
+  GST_BUFFER_TIMESTAMP (buf) = pts;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+}
+
+static void
+start_stream (GstElement * element, GstElement * first)
+{
+  GstCaps *caps;
+
+  fail_unless (gst_element_set_state (element,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_empty_simple ("application/x-test");
+  gst_check_setup_events (mysrcpad, first, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+}
+
+/* the statistics posted by @probe */
+static GstMessage *
+pop_stats (GstBus * bus, GstElement * probe)
+{
+  GstMessage *msg;
+
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  fail_unless (GST_MESSAGE_SRC (msg) == GST_OBJECT_CAST (probe));
+  fail_unless (gst_structure_has_name (gst_message_get_structure (msg),
+          "perfprobe"));
+
+  return msg;
+}
+
+static void
+check_throughput (const GstStructure * s, guint64 n_buffers)
+{
+  guint64 buffers, bytes, max_gap;
+  gdouble buffer_rate, byte_rate;
+
+  fail_unless (gst_structure_get_uint64 (s, "buffers", &buffers));
+  fail_unless_equals_uint64 (buffers, n_buffers);
+  fail_unless (gst_structure_get_uint64 (s, "bytes", &bytes));
+  fail_unless_equals_uint64 (bytes, n_buffers * BUFFER_SIZE);
+  fail_unless (gst_structure_get_double (s, "buffer-rate", &buffer_rate));
+  fail_unless (gst_structure_get_double (s, "byte-rate", &byte_rate));
+  fail_unless (buffer_rate > 0);
+  fail_unless (byte_rate > 0);
+  /* same interval */
+  fail_unless (byte_rate / buffer_rate > BUFFER_SIZE - 0.01);
+  fail_unless (byte_rate / buffer_rate < BUFFER_SIZE + 0.01);
+  fail_unless (gst_structure_get_uint64 (s, "max-gap", &max_gap));
+  fail_unless (max_gap >= 2 * GST_MSECOND);
+  fail_unless (gst_structure_has_field_typed (s, "jitter", G_TYPE_UINT64));
+}
+
+GST_START_TEST (test_throughput)
+{
+  GstElement *probe;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+
+  probe = gst_check_setup_element ("perfprobe");
+  g_object_set (probe, "interval", 1, NULL);
+  mysrcpad = gst_check_setup_src_pad (probe, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (probe, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  bus = gst_bus_new ();
+  gst_element_set_bus (probe, bus);
+
+  start_stream (probe, probe);
+
+  /* the first buffer starts the interval, the second ends it */
+  push_buffer (0);
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+  push_buffer (40 * GST_MSECOND);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+
+  msg = pop_stats (bus, probe);
+  s = gst_message_get_structure (msg);
+  check_throughput (s, 2);
+  /* not linked to another probe or a queue */
+  fail_if (gst_structure_has_field (s, "latency-count"));
+  fail_if (gst_structure_has_field (s, "queue"));
+  gst_message_unref (msg);
+
+  gst_element_set_state (probe, GST_STATE_NULL);
+  gst_element_set_bus (probe, NULL);
+  gst_object_unref (bus);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (probe);
+  gst_check_teardown_sink_pad (probe);
+  gst_check_teardown_element (probe);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_latency)
+{
+  GstElement *pipeline, *in, *out;
+  GstBus *bus;
+  GstMessage *msg;
+  const GstStructure *s;
+  guint64 count, min, avg, max;
+
+  pipeline = gst_pipeline_new (NULL);
+  in = gst_element_factory_make ("perfprobe", "in");
+  out = gst_element_factory_make ("perfprobe", "out");
+  fail_unless (in != NULL && out != NULL);
+  /* only the downstream probe posts statistics */
+  g_object_set (in, "interval", 0, NULL);
+  g_object_set (out, "interval", 1, "upstream-probe", "in", NULL);
+  gst_bin_add_many (GST_BIN (pipeline), in, out, NULL);
+  fail_unless (gst_element_link (in, out));
+
+  mysrcpad = gst_check_setup_src_pad (in, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (out, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+  start_stream (pipeline, in);
+
+  push_buffer (0);
+  push_buffer (40 * GST_MSECOND);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+
+  msg = pop_stats (bus, out);
+  s = gst_message_get_structure (msg);
+  check_throughput (s, 2);
+  /* both buffers were seen by the upstream probe first */
+  fail_unless (gst_structure_get_uint64 (s, "latency-count", &count));
+  fail_unless_equals_uint64 (count, 2);
+  fail_unless (gst_structure_get_uint64 (s, "latency-min", &min));
+  fail_unless (gst_structure_get_uint64 (s, "latency-avg", &avg));
+  fail_unless (gst_structure_get_uint64 (s, "latency-max", &max));
+  fail_unless (min <= avg);
+  fail_unless (avg <= max);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (in);
+  gst_check_teardown_sink_pad (out);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+perfprobe_suite (void)
+{
+  Suite *s = suite_create ("perfprobe");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_throughput);
+  tcase_add_test (tc_chain, test_latency);
+
+  return s;
+}
+
+GST_CHECK_MAIN (perfprobe);
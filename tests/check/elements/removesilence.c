@@ -0,0 +1,233 @@
+/* GStreamer
+ *
+ * unit test for removesilence
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/audio/audio.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define RATE 8000
+/* frames the VAD takes a decision on at a time */
+#define BLOCK 256
+
+#define CAPS_STRING "audio/x-raw, " \
+    "format = (string) " GST_AUDIO_NE (S16) ", " \
+    "layout = (string) interleaved, " \
+    "rate = (int) 8000, " \
+    "channels = (int) %d"
+
+/* one period of a 500 Hz tone at -6 dB, crossing zero every 8 frames */
+static const gint16 tone[16] = {
+  0, 6269, 11585, 15136, 16384, 15136, 11585, 6269,
+  0, -6269, -11585, -15136, -16384, -15136, -11585, -6269
+};
+
+static GstElement *
+setup_removesilence (gint channels)
+{
+  GstElement *removesilence;
+  GstCaps *caps;
+  gchar *caps_str;
+
+  removesilence = gst_check_setup_element ("removesilence");
+  /* leave the voice state at the first silent block */
+  g_object_set (removesilence, "remove", TRUE, "hysteresis",
+      (guint64) BLOCK, NULL);
+  mysrcpad = gst_check_setup_src_pad (removesilence, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (removesilence, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (removesilence,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps_str = g_strdup_printf (CAPS_STRING, channels);
+  caps = gst_caps_from_string (caps_str);
+  gst_check_setup_events (mysrcpad, removesilence, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+  g_free (caps_str);
+
+  return removesilence;
+}
+
+static void
+cleanup_removesilence (GstElement * removesilence)
+{
+  gst_element_set_state (removesilence, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (removesilence);
+  gst_check_teardown_sink_pad (removesilence);
+  gst_check_teardown_element (removesilence);
+}
+
+/* Pushes frames @offset to @offset + @n of a stream that is silent except
+ * for the tone from frame @tone_start to @tone_end. The tone is only in the
+ * last channel, the others stay silent. */
+static void
+push_frames (gint channels, guint64 offset, guint n, guint64 tone_start,
+    guint64 tone_end)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gint16 *samples;
+  guint i;
+
+  buf = gst_buffer_new_allocate (NULL, n * channels * sizeof (gint16), NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  samples = (gint16 *) map.data;
+  memset (samples, 0, map.size);
+  for (i = 0; i < n; i++) {
+    guint64 frame = offset + i;
+
+    if (frame >= tone_start && frame < tone_end)
+      samples[i * channels + channels - 1] =
+          tone[(frame - tone_start) % G_N_ELEMENTS (tone)];
+  }
+  gst_buffer_unmap (buf, &map);
+  GST_BUFFER_TIMESTAMP (buf) = gst_util_uint64_scale_int (offset, GST_SECOND,
+      RATE);
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale_int (n, GST_SECOND, RATE);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+}
+
+/* checks that buffer @n starts at frame @offset and has @n_frames frames */
+static void
+check_buffer (guint n, gint channels, guint64 offset, guint n_frames)
+{
+  GstBuffer *buf = g_list_nth_data (buffers, n);
+
+  fail_unless (buf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf),
+      gst_util_uint64_scale_int (offset, GST_SECOND, RATE));
+  fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf),
+      gst_util_uint64_scale_int (n_frames, GST_SECOND, RATE));
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      n_frames * channels * sizeof (gint16));
+}
+
+/* 4 blocks of silence, 4 of tone and 4 of silence, one block per buffer */
+static void
+check_blocks (gint channels)
+{
+  GstElement *removesilence;
+  guint i;
+
+  removesilence = setup_removesilence (channels);
+
+  for (i = 0; i < 12; i++)
+    push_frames (channels, i * BLOCK, BLOCK, 4 * BLOCK, 8 * BLOCK);
+
+  /* The leading silence is dropped. The power estimate still is above the
+   * threshold for the first silent block after the tone, the others are
+   * dropped. */
+  fail_unless_equals_int (g_list_length (buffers), 5);
+  for (i = 0; i < 5; i++)
+    check_buffer (i, channels, (4 + i) * BLOCK, BLOCK);
+
+  cleanup_removesilence (removesilence);
+}
+
+GST_START_TEST (test_remove_mono)
+{
+  check_blocks (1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_remove_stereo)
+{
+  /* the tone in the right channel only makes the blocks voiced */
+  check_blocks (2);
+}
+
+GST_END_TEST;
+
+/* Buffers of 3 blocks, with the tone from the second block of the second
+ * buffer to the first block of the third one */
+static void
+check_trim (gint channels)
+{
+  GstElement *removesilence;
+  guint i;
+
+  removesilence = setup_removesilence (channels);
+
+  for (i = 0; i < 4; i++)
+    push_frames (channels, i * 3 * BLOCK, 3 * BLOCK, 4 * BLOCK, 7 * BLOCK);
+
+  /* the silent blocks at both ends of the voice are cut off, with the one
+   * block of decay after the tone */
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  check_buffer (0, channels, 4 * BLOCK, 2 * BLOCK);
+  check_buffer (1, channels, 6 * BLOCK, 2 * BLOCK);
+
+  cleanup_removesilence (removesilence);
+}
+
+GST_START_TEST (test_trim_mono)
+{
+  check_trim (1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_trim_stereo)
+{
+  check_trim (2);
+}
+
+GST_END_TEST;
+
+static Suite *
+removesilence_suite (void)
+{
+  Suite *s = suite_create ("removesilence");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_remove_mono);
+  tcase_add_test (tc_chain, test_remove_stereo);
+  tcase_add_test (tc_chain, test_trim_mono);
+  tcase_add_test (tc_chain, test_trim_stereo);
+
+  return s;
+}
+
+GST_CHECK_MAIN (removesilence);
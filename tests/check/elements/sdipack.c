@@ -0,0 +1,253 @@
+/* GStreamer
+ *
+ * unit test for the sample packing of sdidemux and sdimux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+/* the SIMD and the scalar code paths */
+#include "../../gst/sdi/gstsdipack.c"
+
+#define MAX_SAMPLES GST_SDI_MAX_SAMPLES
+#define MAX_SIZE (MAX_SAMPLES / 4 * 5)
+
+/* the sample counts tried, around the 16 sample blocks of the SIMD code */
+static const int sample_counts[] = {
+  4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 100, 720 * 2, MAX_SAMPLES
+};
+
+static void
+fill_random (guint8 * data, int size)
+{
+  int i;
+
+  for (i = 0; i < size; i++)
+    data[i] = g_random_int_range (0, 256);
+}
+
+GST_START_TEST (test_unpack_8)
+{
+  guint8 *src, *dest, *ref;
+  guint i;
+
+  g_random_set_seed (1);
+  /* past the end of the line, as in the demuxer */
+  src = g_malloc (MAX_SIZE + 16);
+  dest = g_malloc (MAX_SAMPLES);
+  ref = g_malloc (MAX_SAMPLES);
+  fill_random (src, MAX_SIZE + 16);
+
+#ifdef SDI_HAVE_SIMD
+  if (!__builtin_cpu_supports ("ssse3"))
+    GST_INFO ("no SSSE3, comparing the scalar code with itself");
+#endif
+
+  for (i = 0; i < G_N_ELEMENTS (sample_counts); i++) {
+    int n = sample_counts[i];
+
+    memset (dest, 0xaa, MAX_SAMPLES);
+    memset (ref, 0xaa, MAX_SAMPLES);
+    gst_sdi_unpack_8 (dest, src, n);
+    unpack_8_c (ref, src, 0, n);
+    fail_unless (memcmp (dest, ref, MAX_SAMPLES) == 0,
+        "unpacking %d samples to 8 bits differs", n);
+  }
+
+  g_free (src);
+  g_free (dest);
+  g_free (ref);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_unpack_16)
+{
+  guint8 *src;
+  guint16 *dest, *ref;
+  guint i;
+
+  g_random_set_seed (1);
+  src = g_malloc (MAX_SIZE + 16);
+  dest = g_new (guint16, MAX_SAMPLES);
+  ref = g_new (guint16, MAX_SAMPLES);
+  fill_random (src, MAX_SIZE + 16);
+
+  for (i = 0; i < G_N_ELEMENTS (sample_counts); i++) {
+    int n = sample_counts[i];
+
+    memset (dest, 0xaa, MAX_SAMPLES * 2);
+    memset (ref, 0xaa, MAX_SAMPLES * 2);
+    gst_sdi_unpack_16 (dest, src, n);
+    unpack_16_c (ref, src, 0, n);
+    fail_unless (memcmp (dest, ref, MAX_SAMPLES * 2) == 0,
+        "unpacking %d samples to 16 bits differs", n);
+  }
+
+  g_free (src);
+  g_free (dest);
+  g_free (ref);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pack_16)
+{
+  guint16 *samples, *unpacked;
+  guint8 *packed, *v210;
+  int i;
+
+  g_random_set_seed (1);
+  samples = g_new (guint16, MAX_SAMPLES);
+  unpacked = g_new (guint16, MAX_SAMPLES);
+  packed = g_malloc (MAX_SIZE + 16);
+  /* 12 samples in 16 bytes */
+  v210 = g_malloc (MAX_SAMPLES / 12 * 16);
+
+  for (i = 0; i < MAX_SAMPLES; i++)
+    samples[i] = g_random_int_range (0, 1024);
+
+  gst_sdi_pack_16 (packed, samples, MAX_SAMPLES);
+  gst_sdi_unpack_16 (unpacked, packed, MAX_SAMPLES);
+  fail_unless (memcmp (samples, unpacked, MAX_SAMPLES * 2) == 0);
+
+  /* the same samples through v210 */
+  memset (unpacked, 0, MAX_SAMPLES * 2);
+  gst_sdi_unpack_v210 (v210, packed, MAX_SAMPLES);
+  gst_sdi_v210_to_16 (unpacked, v210, MAX_SAMPLES);
+  fail_unless (memcmp (samples, unpacked, MAX_SAMPLES * 2) == 0);
+
+  g_free (samples);
+  g_free (unpacked);
+  g_free (packed);
+  g_free (v210);
+}
+
+GST_END_TEST;
+
+#define EAV_SAMPLES 800
+#define EAV_SIZE (EAV_SAMPLES / 4 * 5)
+/* EAV of the first field, active line */
+#define XYZ 0x274
+
+/* a line of samples without timing references, with an EAV at sample
+ * @pos if @pos >= 0 */
+static void
+make_line (guint8 * data, int pos, gboolean hd)
+{
+  guint16 samples[EAV_SAMPLES];
+  int i;
+
+  for (i = 0; i < EAV_SAMPLES; i++)
+    samples[i] = g_random_int_range (0x040, 0x3c1);
+
+  if (pos >= 0 && hd) {
+    static const guint16 eav[] = { 0x3ff, 0x3ff, 0, 0, 0, 0, XYZ, XYZ };
+
+    memcpy (samples + pos, eav, sizeof (eav));
+  } else if (pos >= 0) {
+    static const guint16 eav[] = { 0x3ff, 0, 0, XYZ };
+
+    memcpy (samples + pos, eav, sizeof (eav));
+  }
+
+  gst_sdi_pack_16 (data, samples, EAV_SAMPLES);
+}
+
+static void
+check_find_eav (const guint8 * data, int expected, gboolean expected_hd)
+{
+  gboolean hd = !expected_hd, ref_hd = !expected_hd;
+  int offset;
+
+  offset = gst_sdi_find_eav (data, EAV_SIZE, &hd);
+  fail_unless_equals_int (offset, expected);
+  fail_unless_equals_int (find_eav_c (data, 0, EAV_SIZE, &ref_hd), expected);
+  if (expected >= 0) {
+    fail_unless_equals_int (hd, expected_hd);
+    fail_unless_equals_int (ref_hd, expected_hd);
+  }
+}
+
+GST_START_TEST (test_find_eav)
+{
+  guint8 data[EAV_SIZE];
+  int pos;
+
+  g_random_set_seed (1);
+
+  make_line (data, -1, FALSE);
+  check_find_eav (data, -1, FALSE);
+
+  /* every group, so every phase of the 16 byte blocks. Both need the 10
+   * bytes of two groups. */
+  for (pos = 0; pos + 8 <= EAV_SAMPLES; pos += 4) {
+    make_line (data, pos, FALSE);
+    check_find_eav (data, pos / 4 * 5, FALSE);
+    make_line (data, pos, TRUE);
+    check_find_eav (data, pos / 4 * 5, TRUE);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_find_eav_random)
+{
+  guint16 words[] = { 0, 0x3ff, XYZ, 0 };
+  guint16 samples[EAV_SAMPLES];
+  guint8 data[EAV_SIZE];
+  gboolean hd, ref_hd;
+  int i, j, offset;
+
+  /* the same first match on lines made of the words of timing references
+   * and noise, with partial and complete SD and HD EAVs */
+  g_random_set_seed (1);
+  for (i = 0; i < 1000; i++) {
+    for (j = 0; j < EAV_SAMPLES; j++) {
+      words[3] = g_random_int_range (0, 1024);
+      samples[j] = words[g_random_int_range (0, 4)];
+    }
+    gst_sdi_pack_16 (data, samples, EAV_SAMPLES);
+
+    offset = gst_sdi_find_eav (data, EAV_SIZE, &hd);
+    fail_unless_equals_int (offset, find_eav_c (data, 0, EAV_SIZE, &ref_hd));
+    if (offset >= 0)
+      fail_unless_equals_int (hd, ref_hd);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+sdipack_suite (void)
+{
+  Suite *s = suite_create ("sdipack");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_unpack_8);
+  tcase_add_test (tc_chain, test_unpack_16);
+  tcase_add_test (tc_chain, test_pack_16);
+  tcase_add_test (tc_chain, test_find_eav);
+  tcase_add_test (tc_chain, test_find_eav_random);
+
+  return s;
+}
+
+GST_CHECK_MAIN (sdipack);
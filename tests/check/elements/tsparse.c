@@ -0,0 +1,392 @@
+/* GStreamer
+ *
+ * unit test for the section delivery of tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/mpegts/mpegts.h>
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true"));
+
+#define PACKET_SIZE 188
+
+/* PIDs which tsparse always parses sections on */
+#define PID_TDT 0x14
+#define PID_SYNC 0x15
+#define PID_ATSC 0x1ffb
+
+#define TABLE_ID_TDT 0x70
+#define TABLE_ID_LONG 0xc7
+
+/* the sections emitted with the section signal */
+static GList *sections;
+static guint8 continuity[0x2000];
+
+static void
+section_cb (GstElement * parse, GstMpegTsSection * section, gpointer user_data)
+{
+  sections = g_list_append (sections, gst_mpegts_section_ref (section));
+}
+
+/* pushes @section in a packet of @pid, starting right after the pointer
+ * field and followed by stuffing */
+static void
+push_section (guint16 pid, const guint8 * section, gsize size)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  buf = gst_buffer_new_allocate (NULL, PACKET_SIZE, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0xff, PACKET_SIZE);
+  map.data[0] = 0x47;
+  /* payload_unit_start_indicator */
+  map.data[1] = 0x40 | (pid >> 8);
+  map.data[2] = pid & 0xff;
+  /* payload only */
+  map.data[3] = 0x10 | continuity[pid];
+  continuity[pid] = (continuity[pid] + 1) & 0xf;
+  map.data[4] = 0;
+  memcpy (map.data + 5, section, size);
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+}
+
+/* a short section without a version, differing by @seconds */
+static void
+push_tdt (guint16 pid, guint8 seconds)
+{
+  const guint8 tdt[] = {
+    TABLE_ID_TDT, 0x70, 0x05, 0xde, 0xad, 0x12, 0x34, seconds
+  };
+
+  push_section (pid, tdt, sizeof (tdt));
+}
+
+/* a long section with a single data byte and a CRC, which isn't checked */
+static void
+push_long (guint16 pid, guint16 extension, guint8 version)
+{
+  const guint8 section[] = {
+    TABLE_ID_LONG, 0xb0, 0x0a, extension >> 8, extension & 0xff,
+    0xc1 | (version << 1), 0x00, 0x00, 0x42, 0x00, 0x00, 0x00, 0x00
+  };
+
+  push_section (pid, section, sizeof (section));
+}
+
+static GstElement *
+setup_tsparse (void)
+{
+  GstElement *parse;
+  GstCaps *caps;
+  guint8 null_packet[PACKET_SIZE - 5];
+  guint i;
+
+  parse = gst_check_setup_element ("tsparse");
+  mysrcpad = gst_check_setup_src_pad (parse, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (parse, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  g_signal_connect (parse, "section", G_CALLBACK (section_cb), NULL);
+
+  fail_unless (gst_element_set_state (parse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("video/mpegts, systemstream = (boolean) true");
+  gst_check_setup_events (mysrcpad, parse, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  /* null packets, so that the packet size is known before the sections */
+  memset (continuity, 0, sizeof (continuity));
+  memset (null_packet, 0xff, sizeof (null_packet));
+  for (i = 0; i < 5; i++)
+    push_section (0x1fff, null_packet, sizeof (null_packet));
+
+  return parse;
+}
+
+static void
+cleanup_tsparse (GstElement * parse)
+{
+  gst_element_set_state (parse, GST_STATE_NULL);
+
+  g_list_free_full (sections, (GDestroyNotify) gst_mini_object_unref);
+  sections = NULL;
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (parse);
+  gst_check_teardown_sink_pad (parse);
+  gst_check_teardown_element (parse);
+}
+
+static guint
+add_filter (GstElement * parse, gint pid, gint table_id, gint extension,
+    gboolean changes_only)
+{
+  guint id = 0;
+
+  g_signal_emit_by_name (parse, "add-section-filter", pid, table_id,
+      extension, changes_only, &id);
+  fail_unless (id != 0);
+
+  return id;
+}
+
+/* checks that the next section emitted is the one of @pid and @table_id,
+ * with @last_byte as its last byte before the CRC, if any */
+static void
+check_section (guint16 pid, guint8 table_id, guint8 last_byte)
+{
+  GstMpegTsSection *section;
+
+  fail_unless (sections != NULL, "no section emitted");
+  section = sections->data;
+  sections = g_list_delete_link (sections, sections);
+
+  fail_unless_equals_int (section->pid, pid);
+  fail_unless_equals_int (section->table_id, table_id);
+  if (section->short_section)
+    fail_unless_equals_int (section->data[section->section_length - 1],
+        last_byte);
+  else
+    fail_unless_equals_int (section->data[section->section_length - 5],
+        last_byte);
+  gst_mpegts_section_unref (section);
+}
+
+static void
+check_no_section (void)
+{
+  fail_unless_equals_int (g_list_length (sections), 0);
+}
+
+GST_START_TEST (test_properties)
+{
+  GstElement *parse;
+  gboolean all_sections, emit_signals;
+
+  parse = gst_element_factory_make ("tsparse", NULL);
+
+  /* the defaults post every section on the bus */
+  g_object_get (parse, "all-sections", &all_sections, "emit-signals",
+      &emit_signals, NULL);
+  fail_unless (all_sections);
+  fail_unless (!emit_signals);
+
+  g_object_set (parse, "all-sections", FALSE, "emit-signals", TRUE, NULL);
+  g_object_get (parse, "all-sections", &all_sections, "emit-signals",
+      &emit_signals, NULL);
+  fail_unless (!all_sections);
+  fail_unless (emit_signals);
+
+  gst_object_unref (parse);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_section_delivery)
+{
+  GstElement *parse;
+  GstMpegTsSection *section;
+  GstMessage *msg;
+  GstBus *bus;
+
+  parse = setup_tsparse ();
+  bus = gst_bus_new ();
+  gst_element_set_bus (parse, bus);
+
+  /* posted on the bus by default */
+  push_tdt (PID_TDT, 1);
+  check_no_section ();
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (msg != NULL);
+  section = gst_message_parse_mpegts_section (msg);
+  fail_unless (section != NULL);
+  fail_unless_equals_int (section->pid, PID_TDT);
+  fail_unless_equals_int (section->table_id, TABLE_ID_TDT);
+  gst_mpegts_section_unref (section);
+  gst_message_unref (msg);
+
+  /* or emitted from the streaming thread, every time it is seen */
+  g_object_set (parse, "emit-signals", TRUE, NULL);
+  push_tdt (PID_TDT, 1);
+  push_tdt (PID_TDT, 1);
+  push_long (PID_ATSC, 1, 0);
+  check_section (PID_TDT, TABLE_ID_TDT, 1);
+  check_section (PID_TDT, TABLE_ID_TDT, 1);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+  check_no_section ();
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  gst_element_set_bus (parse, NULL);
+  gst_object_unref (bus);
+  cleanup_tsparse (parse);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_filter_match)
+{
+  GstElement *parse;
+
+  parse = setup_tsparse ();
+  g_object_set (parse, "all-sections", FALSE, "emit-signals", TRUE, NULL);
+
+  /* nothing without a filter */
+  push_tdt (PID_TDT, 1);
+  check_no_section ();
+
+  /* by PID */
+  add_filter (parse, PID_SYNC, -1, -1, FALSE);
+  push_tdt (PID_TDT, 2);
+  check_no_section ();
+  push_tdt (PID_SYNC, 2);
+  check_section (PID_SYNC, TABLE_ID_TDT, 2);
+
+  /* by table_id and extension, on any PID */
+  add_filter (parse, -1, TABLE_ID_LONG, 2, FALSE);
+  push_long (PID_ATSC, 1, 0);
+  check_no_section ();
+  push_long (PID_ATSC, 2, 0);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+
+  /* all-sections still delivers the others */
+  g_object_set (parse, "all-sections", TRUE, NULL);
+  push_long (PID_ATSC, 3, 0);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+  push_tdt (PID_TDT, 3);
+  check_section (PID_TDT, TABLE_ID_TDT, 3);
+
+  cleanup_tsparse (parse);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_changes_only)
+{
+  GstElement *parse;
+
+  parse = setup_tsparse ();
+  g_object_set (parse, "all-sections", FALSE, "emit-signals", TRUE, NULL);
+  add_filter (parse, -1, -1, -1, TRUE);
+
+  /* short sections are compared by their content */
+  push_tdt (PID_TDT, 1);
+  check_section (PID_TDT, TABLE_ID_TDT, 1);
+  push_tdt (PID_TDT, 1);
+  check_no_section ();
+  push_tdt (PID_TDT, 2);
+  check_section (PID_TDT, TABLE_ID_TDT, 2);
+
+  /* the same section on another PID is tracked on its own */
+  push_tdt (PID_SYNC, 2);
+  check_section (PID_SYNC, TABLE_ID_TDT, 2);
+  push_tdt (PID_TDT, 2);
+  push_tdt (PID_SYNC, 2);
+  check_no_section ();
+
+  /* long sections by their version, also when it goes back */
+  push_long (PID_ATSC, 1, 0);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+  push_long (PID_ATSC, 1, 0);
+  check_no_section ();
+  push_long (PID_ATSC, 1, 1);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+  push_long (PID_ATSC, 1, 0);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+
+  /* and by their extension */
+  push_long (PID_ATSC, 2, 0);
+  check_section (PID_ATSC, TABLE_ID_LONG, 0x42);
+
+  cleanup_tsparse (parse);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_remove_filter)
+{
+  GstElement *parse;
+  guint id;
+
+  parse = setup_tsparse ();
+  g_object_set (parse, "all-sections", FALSE, "emit-signals", TRUE, NULL);
+
+  id = add_filter (parse, PID_TDT, -1, -1, FALSE);
+  push_tdt (PID_TDT, 1);
+  check_section (PID_TDT, TABLE_ID_TDT, 1);
+  g_signal_emit_by_name (parse, "remove-section-filter", id);
+  push_tdt (PID_TDT, 2);
+  check_no_section ();
+
+  /* a new filter doesn't know the sections passed by the removed one */
+  id = add_filter (parse, PID_TDT, -1, -1, TRUE);
+  push_tdt (PID_TDT, 3);
+  check_section (PID_TDT, TABLE_ID_TDT, 3);
+  g_signal_emit_by_name (parse, "remove-section-filter", id);
+  add_filter (parse, PID_TDT, -1, -1, TRUE);
+  push_tdt (PID_TDT, 3);
+  check_section (PID_TDT, TABLE_ID_TDT, 3);
+
+  /* removing the first one again keeps the second one, which has seen the
+   * section */
+  g_signal_emit_by_name (parse, "remove-section-filter", id);
+  push_tdt (PID_TDT, 3);
+  check_no_section ();
+
+  cleanup_tsparse (parse);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsparse_suite (void)
+{
+  Suite *s = suite_create ("tsparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_properties);
+  tcase_add_test (tc_chain, test_section_delivery);
+  tcase_add_test (tc_chain, test_filter_match);
+  tcase_add_test (tc_chain, test_changes_only);
+  tcase_add_test (tc_chain, test_remove_filter);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsparse);
@@ -0,0 +1,261 @@
+/* GStreamer
+ *
+ * unit test for yadif
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+/* the line filters */
+#include "../../gst/yadif/vf_yadif.c"
+#include "../../gst/yadif/yadif.c"
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad, *mysinkpad;
+
+#define YADIF_CAPS_TEMPLATE_STRING GST_VIDEO_CAPS_MAKE ("I420")
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (YADIF_CAPS_TEMPLATE_STRING));
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (YADIF_CAPS_TEMPLATE_STRING));
+
+/* rows of the three frames around the filtered line */
+#define STRIDE 256
+#define ROWS 5
+
+static void
+fill_random (guint8 * data, gint size, gint bpc, guint max)
+{
+  gint i;
+
+  for (i = 0; i < size / bpc; i++) {
+    if (bpc == 1)
+      data[i] = g_random_int_range (0, max);
+    else
+      ((guint16 *) data)[i] = g_random_int_range (0, max);
+  }
+}
+
+/* compares @filter_line on random lines of @w samples of @bpc bytes with
+ * the C filter */
+static void
+check_filter_line (YadifFilterLine filter_line, gint w, gint bpc)
+{
+  guint8 prev[ROWS * STRIDE], cur[ROWS * STRIDE], next[ROWS * STRIDE];
+  guint8 expected[STRIDE], dst[STRIDE];
+  YadifFilterLine filter_line_ref;
+  gint i, line, refs, parity, mode;
+
+  filter_line_ref = bpc == 1 ? filter_line_c : filter_line_c_16bit;
+  line = (ROWS / 2) * STRIDE;
+  refs = STRIDE;
+
+  for (i = 0; i < 64; i++) {
+    /* small values to get temporal and spatial matches, full range for
+     * the clipping */
+    guint max = (i & 1) ? (bpc == 1 ? 256 : 1024) : 16;
+
+    fill_random (prev, sizeof (prev), bpc, max);
+    fill_random (cur, sizeof (cur), bpc, max);
+    fill_random (next, sizeof (next), bpc, max);
+
+    for (parity = 0; parity < 2; parity++) {
+      for (mode = 0; mode <= 2; mode += 2) {
+        memset (expected, 0, sizeof (expected));
+        memset (dst, 0, sizeof (dst));
+        filter_line_ref (expected, prev + line, cur + line, next + line, w,
+            refs, -refs, parity, mode);
+        filter_line (dst, prev + line, cur + line, next + line, w, refs,
+            -refs, parity, mode);
+        fail_unless (memcmp (dst, expected, sizeof (dst)) == 0,
+            "line %d, parity %d, mode %d differs from the C filter", i,
+            parity, mode);
+      }
+    }
+  }
+}
+
+GST_START_TEST (test_filter_line_simd)
+{
+  g_random_set_seed (1);
+
+#ifdef HAVE_CPU_X86_64
+  check_filter_line (filter_line_x86_64, 96, 1);
+#endif
+#ifdef YADIF_HAVE_AVX2
+  if (__builtin_cpu_supports ("avx2")) {
+    /* with a tail for the C filter */
+    check_filter_line (filter_line_avx2, 101, 1);
+    check_filter_line (filter_line_avx2_16bit, 101, 2);
+  }
+#endif
+}
+
+GST_END_TEST;
+
+static GstElement *
+setup_yadif (gboolean double_rate)
+{
+  GstElement *yadif;
+  GstVideoInfo info;
+  GstCaps *caps;
+
+  GST_DEBUG ("setup_yadif");
+  yadif = gst_check_setup_element ("yadif");
+  g_object_set (yadif, "double-rate", double_rate, "n-threads", 2, NULL);
+  mysrcpad = gst_check_setup_src_pad (yadif, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (yadif, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (yadif,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, 64, 48);
+  GST_VIDEO_INFO_INTERLACE_MODE (&info) = GST_VIDEO_INTERLACE_MODE_INTERLEAVED;
+  GST_VIDEO_INFO_FPS_N (&info) = 25;
+  GST_VIDEO_INFO_FPS_D (&info) = 1;
+  caps = gst_video_info_to_caps (&info);
+  gst_check_setup_events (mysrcpad, yadif, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return yadif;
+}
+
+static void
+cleanup_yadif (GstElement * yadif)
+{
+  GST_DEBUG ("cleanup_yadif");
+  gst_element_set_state (yadif, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (yadif);
+  gst_check_teardown_sink_pad (yadif);
+  gst_check_teardown_element (yadif);
+}
+
+#define N_FRAMES 4
+#define FRAME_DURATION (GST_SECOND / 25)
+
+/* pushes N_FRAMES frames and EOS, and checks that @n_expected evenly
+ * spaced frames come out */
+static void
+push_frames (GstElement * yadif, guint n_expected)
+{
+  GstBuffer *buf;
+  GList *l;
+  GstClockTime duration = FRAME_DURATION * N_FRAMES / n_expected;
+  guint i;
+
+  for (i = 0; i < N_FRAMES; i++) {
+    buf = gst_buffer_new_allocate (NULL, 64 * 48 * 3 / 2, NULL);
+    gst_buffer_memset (buf, 0, 16 * (i + 1), 64 * 48 * 3 / 2);
+    GST_BUFFER_TIMESTAMP (buf) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    GST_BUFFER_FLAG_SET (buf, GST_VIDEO_BUFFER_FLAG_TFF);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+  /* one frame is kept for the temporal filter until EOS */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (buffers), n_expected);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    buf = l->data;
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf), i * duration);
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf), duration);
+    fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_TFF));
+  }
+}
+
+GST_START_TEST (test_single_rate)
+{
+  GstElement *yadif;
+
+  yadif = setup_yadif (FALSE);
+  push_frames (yadif, N_FRAMES);
+  cleanup_yadif (yadif);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_double_rate)
+{
+  GstElement *yadif;
+
+  yadif = setup_yadif (TRUE);
+  push_frames (yadif, 2 * N_FRAMES);
+  cleanup_yadif (yadif);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_propose_allocation)
+{
+  GstElement *yadif;
+  GstCaps *caps;
+  GstQuery *query;
+  guint size, min;
+
+  yadif = setup_yadif (FALSE);
+
+  caps = gst_pad_get_current_caps (mysrcpad);
+  query = gst_query_new_allocation (caps, TRUE);
+  gst_caps_unref (caps);
+  fail_unless (gst_pad_peer_query (mysrcpad, query));
+
+  /* two frames besides the one being filtered stay in the history */
+  fail_unless (gst_query_get_n_allocation_pools (query) > 0);
+  gst_query_parse_nth_allocation_pool (query, 0, NULL, &size, &min, NULL);
+  fail_unless_equals_int (size, 64 * 48 * 3 / 2);
+  fail_unless_equals_int (min, 2);
+  gst_query_unref (query);
+
+  cleanup_yadif (yadif);
+}
+
+GST_END_TEST;
+
+static Suite *
+yadif_suite (void)
+{
+  Suite *s = suite_create ("yadif");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_filter_line_simd);
+  tcase_add_test (tc_chain, test_single_rate);
+  tcase_add_test (tc_chain, test_double_rate);
+  tcase_add_test (tc_chain, test_propose_allocation);
+
+  return s;
+}
+
+GST_CHECK_MAIN (yadif);
@@ -0,0 +1,109 @@
+/* GStreamer
+ *
+ * unit test for the MPEG-TS helper library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/mpegts/mpegts.h>
+
+/* converts @text, as the provider name of a service descriptor */
+static gchar *
+convert_text (const guint8 * text, guint8 length)
+{
+  GPtrArray *descriptors;
+  GstMpegTsDescriptor *desc;
+  guint8 data[260];
+  gchar *provider_name = NULL, *service_name = NULL;
+
+  /* tag, length, service type, provider and an empty service name */
+  data[0] = 0x48;
+  data[1] = length + 3;
+  data[2] = 0x01;
+  data[3] = length;
+  memcpy (data + 4, text, length);
+  data[4 + length] = 0;
+
+  descriptors = gst_mpegts_parse_descriptors (data, length + 5);
+  fail_unless (descriptors != NULL);
+  fail_unless_equals_int (descriptors->len, 1);
+  desc = g_ptr_array_index (descriptors, 0);
+  fail_unless (gst_mpegts_descriptor_parse_dvb_service (desc, NULL,
+          &service_name, &provider_name));
+  fail_unless_equals_string (service_name, "");
+  g_free (service_name);
+  g_ptr_array_unref (descriptors);
+
+  return provider_name;
+}
+
+#define assert_converted(text, expected)                            \
+  G_STMT_START {                                                    \
+    gchar *converted = convert_text ((const guint8 *) text,         \
+        sizeof (text) - 1);                                         \
+    fail_unless_equals_string (converted, expected);                \
+    g_free (converted);                                             \
+  } G_STMT_END
+
+GST_START_TEST (test_text_iso6937)
+{
+  /* diacritical marks compose with the following character */
+  assert_converted ("Caf\xc2" "e", "Caf\xc3\xa9");
+  assert_converted ("\xc8u\xc1" " ", "\xc3\xbc`");
+  assert_converted ("\xa4 \xa6 \xa8", "\xe2\x82\xac # \xc2\xa4");
+  /* emphasis codes are dropped, the line break is replaced */
+  assert_converted ("a\x86" "b\x87\x8a" "c", "ab\nc");
+  /* unused in ISO 6937, falls back to ISO 8859-9 */
+  assert_converted ("\xcc", "\xc3\x8c");
+
+  /* served from the cache the second time */
+  assert_converted ("Caf\xc2" "e", "Caf\xc3\xa9");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_text_iso8859)
+{
+  /* 0x01 selects ISO 8859-5 */
+  assert_converted ("\x01\xb0\xb1", "\xd0\x90\xd0\x91");
+  /* 0x10 0x00 0x02 selects ISO 8859-2 */
+  assert_converted ("\x10\x00\x02\xa1\x8a", "\xc4\x84\n");
+  assert_converted ("\x10\x00\x01" "caf\xe9", "caf\xc3\xa9");
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegts_suite (void)
+{
+  Suite *s = suite_create ("mpegts library");
+  TCase *tc_chain = tcase_create ("text");
+
+  gst_mpegts_initialize ();
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_text_iso6937);
+  tcase_add_test (tc_chain, test_text_iso8859);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegts);
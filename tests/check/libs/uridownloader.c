@@ -0,0 +1,292 @@
+/* GStreamer
+ *
+ * unit test for the uridownloader library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesrc.h>
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gsturidownloader.h>
+
+/* the downloader keeps the sources of that many hosts */
+#define MAX_SOURCES 4
+
+#define RESOURCE_SIZE 1000
+
+/* a seekable source for the testdl:// URIs, serving RESOURCE_SIZE bytes of
+ * a counting pattern for any of them */
+
+#define GST_TYPE_TEST_DL_SRC (gst_test_dl_src_get_type ())
+typedef struct _GstTestDlSrc GstTestDlSrc;
+typedef struct _GstTestDlSrcClass GstTestDlSrcClass;
+
+struct _GstTestDlSrc
+{
+  GstBaseSrc parent;
+
+  gchar *uri;
+};
+
+struct _GstTestDlSrcClass
+{
+  GstBaseSrcClass parent_class;
+};
+
+static GType gst_test_dl_src_get_type (void);
+static void gst_test_dl_src_uri_handler_init (gpointer g_iface,
+    gpointer iface_data);
+
+G_DEFINE_TYPE_WITH_CODE (GstTestDlSrc, gst_test_dl_src, GST_TYPE_BASE_SRC,
+    G_IMPLEMENT_INTERFACE (GST_TYPE_URI_HANDLER,
+        gst_test_dl_src_uri_handler_init));
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* source elements alive, the downloader must not keep more than
+ * MAX_SOURCES of them */
+static gint n_sources;
+
+static void
+gst_test_dl_src_finalize (GObject * object)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) object;
+
+  g_free (src->uri);
+  g_atomic_int_add (&n_sources, -1);
+
+  G_OBJECT_CLASS (gst_test_dl_src_parent_class)->finalize (object);
+}
+
+static gboolean
+gst_test_dl_src_is_seekable (GstBaseSrc * basesrc)
+{
+  return TRUE;
+}
+
+static gboolean
+gst_test_dl_src_get_size (GstBaseSrc * basesrc, guint64 * size)
+{
+  *size = RESOURCE_SIZE;
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_test_dl_src_fill (GstBaseSrc * basesrc, guint64 offset, guint length,
+    GstBuffer * buf)
+{
+  GstMapInfo map;
+  guint i;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++)
+    map.data[i] = offset + i;
+  gst_buffer_unmap (buf, &map);
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_test_dl_src_class_init (GstTestDlSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSrcClass *basesrc_class = GST_BASE_SRC_CLASS (klass);
+
+  gobject_class->finalize = gst_test_dl_src_finalize;
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_set_static_metadata (element_class, "Download test source",
+      "Source", "Serves the testdl:// URIs", "GStreamer");
+
+  basesrc_class->is_seekable = gst_test_dl_src_is_seekable;
+  basesrc_class->get_size = gst_test_dl_src_get_size;
+  basesrc_class->fill = gst_test_dl_src_fill;
+}
+
+static void
+gst_test_dl_src_init (GstTestDlSrc * src)
+{
+  g_atomic_int_inc (&n_sources);
+}
+
+static GstURIType
+gst_test_dl_src_uri_get_type (GType type)
+{
+  return GST_URI_SRC;
+}
+
+static const gchar *const *
+gst_test_dl_src_uri_get_protocols (GType type)
+{
+  static const gchar *protocols[] = { "testdl", NULL };
+
+  return protocols;
+}
+
+static gchar *
+gst_test_dl_src_uri_get_uri (GstURIHandler * handler)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) handler;
+
+  return g_strdup (src->uri);
+}
+
+/* also accepted when PLAYING, like the HTTP sources */
+static gboolean
+gst_test_dl_src_uri_set_uri (GstURIHandler * handler, const gchar * uri,
+    GError ** error)
+{
+  GstTestDlSrc *src = (GstTestDlSrc *) handler;
+
+  g_free (src->uri);
+  src->uri = g_strdup (uri);
+
+  return TRUE;
+}
+
+static void
+gst_test_dl_src_uri_handler_init (gpointer g_iface, gpointer iface_data)
+{
+  GstURIHandlerInterface *iface = (GstURIHandlerInterface *) g_iface;
+
+  iface->get_type = gst_test_dl_src_uri_get_type;
+  iface->get_protocols = gst_test_dl_src_uri_get_protocols;
+  iface->get_uri = gst_test_dl_src_uri_get_uri;
+  iface->set_uri = gst_test_dl_src_uri_set_uri;
+}
+
+/* fetches @uri and checks the data, and whether the source element of a
+ * previous download was reused */
+static void
+fetch_uri (GstUriDownloader * downloader, const gchar * uri,
+    gboolean expect_reused)
+{
+  GstFragment *download;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i;
+
+  download = gst_uri_downloader_fetch_uri (downloader, uri);
+  fail_unless (download != NULL, "%s was not fetched", uri);
+  fail_unless (download->completed);
+  fail_unless (download->source_reused == expect_reused,
+      "the source for %s was %s", uri,
+      download->source_reused ? "reused" : "not reused");
+
+  buf = gst_fragment_get_buffer (download);
+  fail_unless (buf != NULL);
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, RESOURCE_SIZE);
+  for (i = 0; i < map.size; i++)
+    fail_unless (map.data[i] == (guint8) i);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  g_object_unref (download);
+}
+
+GST_START_TEST (test_source_reuse)
+{
+  GstUriDownloader *downloader;
+
+  fail_unless (gst_element_register (NULL, "testdlsrc", GST_RANK_PRIMARY,
+          GST_TYPE_TEST_DL_SRC));
+
+  downloader = gst_uri_downloader_new ();
+
+  /* one source per host, kept PLAYING between the downloads */
+  fetch_uri (downloader, "testdl://host0/first", FALSE);
+  fetch_uri (downloader, "testdl://host0/second", TRUE);
+  fetch_uri (downloader, "testdl://host1/first", FALSE);
+  fetch_uri (downloader, "testdl://host0/third", TRUE);
+  fetch_uri (downloader, "testdl://host1/second", TRUE);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), 2);
+
+  /* the query and the port are part of the host */
+  fetch_uri (downloader, "testdl://host0?query", TRUE);
+  fetch_uri (downloader, "testdl://host0:8080/first", FALSE);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), 3);
+
+  g_object_unref (downloader);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_source_eviction)
+{
+  GstUriDownloader *downloader;
+  gchar *uri;
+  gint i;
+
+  fail_unless (gst_element_register (NULL, "testdlsrc", GST_RANK_PRIMARY,
+          GST_TYPE_TEST_DL_SRC));
+
+  downloader = gst_uri_downloader_new ();
+
+  for (i = 0; i < MAX_SOURCES; i++) {
+    uri = g_strdup_printf ("testdl://host%d/first", i);
+    fetch_uri (downloader, uri, FALSE);
+    g_free (uri);
+  }
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), MAX_SOURCES);
+
+  /* host0 is used again, host1 becomes the least recently used one and
+   * its source is shut down for host4 */
+  fetch_uri (downloader, "testdl://host0/second", TRUE);
+  fetch_uri (downloader, "testdl://host4/first", FALSE);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), MAX_SOURCES);
+
+  fetch_uri (downloader, "testdl://host0/third", TRUE);
+  fetch_uri (downloader, "testdl://host2/second", TRUE);
+  fetch_uri (downloader, "testdl://host4/second", TRUE);
+  fetch_uri (downloader, "testdl://host1/second", FALSE);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), MAX_SOURCES);
+
+  /* host3 was evicted for host1 */
+  fetch_uri (downloader, "testdl://host3/second", FALSE);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), MAX_SOURCES);
+
+  g_object_unref (downloader);
+  fail_unless_equals_int (g_atomic_int_get (&n_sources), 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+uridownloader_suite (void)
+{
+  Suite *s = suite_create ("uridownloader");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_source_reuse);
+  tcase_add_test (tc_chain, test_source_eviction);
+
+  return s;
+}
+
+GST_CHECK_MAIN (uridownloader);